@@ -88,6 +88,50 @@ hse_kvdb_compact(struct hse_kvdb *kvdb, unsigned int flags);
 hse_err_t
 hse_kvdb_compact_status_get(struct hse_kvdb *kvdb, struct hse_kvdb_compact_status *status);
 
+/** @brief Opaque handle to a KVDB snapshot. */
+struct hse_kvdb_snapshot;
+
+/** @brief Create a snapshot of a KVDB.
+ *
+ * A snapshot is a read-only view of every KVS in the KVDB as of the time of
+ * the call. It is independent of transactions and may be shared by any
+ * number of threads and used with hse_kvs_snapshot_get() and
+ * hse_kvs_snapshot_cursor_create() until it is released.
+ *
+ * A snapshot holds back the KVDB sequence number horizon, which prevents
+ * compaction from discarding versions of keys that are visible to it, so
+ * long-lived snapshots increase space amplification.
+ *
+ * @note This function is thread safe.
+ *
+ * @param kvdb: KVDB handle.
+ * @param[out] snap: Snapshot handle.
+ *
+ * @remark @p kvdb must not be NULL.
+ * @remark @p snap must not be NULL.
+ *
+ * @returns Error status.
+ */
+hse_err_t
+hse_kvdb_snapshot_create(struct hse_kvdb *kvdb, struct hse_kvdb_snapshot **snap);
+
+/** @brief Release a snapshot.
+ *
+ * Cursors created from the snapshot remain usable after it is released. The
+ * snapshot's view, and the versions of keys visible to it, are retained until
+ * the last such cursor is destroyed or has its view updated.
+ *
+ * @note This function is thread safe with respect to other snapshots.
+ *
+ * @param kvdb: KVDB handle.
+ * @param snap: Snapshot handle, may be NULL.
+ *
+ * @remark @p kvdb must not be NULL.
+ * @remark All snapshots must be released before the KVDB is closed.
+ */
+void
+hse_kvdb_snapshot_release(struct hse_kvdb *kvdb, struct hse_kvdb_snapshot *snap);
+
 /**@} KVDB */
 
 /** @addtogroup KVS Key-Value Store (KVS)
@@ -150,6 +194,175 @@ hse_kvs_prefix_probe(
     size_t valbuf_sz,
     size_t *val_len);
 
+/** @brief Merge an operand into the value of a key.
+ *
+ * Applies @p operand to the value of @p key using the merge operator
+ * configured for the KVS via the "value.merge.operator" create-time parameter,
+ * which is fixed for the life of the KVS:
+ *
+ * @arg add_u64 - Add a native endian 64-bit unsigned integer to the value.
+ * The operand must be exactly 8 bytes. A missing value, or one whose length
+ * is not 8 bytes, is treated as zero.
+ * @arg append - Append the operand to the value. The result is truncated at
+ * HSE_KVS_VALUE_LEN_MAX bytes.
+ *
+ * Outside of a transaction the operand is stored without reading the current
+ * value and is resolved lazily, by gets and cursors and when the data is
+ * ingested into the cN tree. Within a transaction the merge is resolved
+ * immediately into a put.
+ *
+ * @note This function is thread safe.
+ *
+ * <b>Flags:</b>
+ * @arg HSE_KVS_PUT_PRIO - Operation will not be throttled.
+ *
+ * @param kvs: KVS handle.
+ * @param flags: Flags for operation specialization.
+ * @param txn: Transaction context (optional).
+ * @param key: Key.
+ * @param key_len: Length of @p key.
+ * @param operand: Merge operand.
+ * @param operand_len: Length of @p operand.
+ *
+ * @remark @p kvs must not be NULL.
+ * @remark @p key must not be NULL.
+ * @remark @p key_len must be within the range of [1, HSE_KVS_KEY_LEN_MAX].
+ * @remark @p operand must not be NULL unless @p operand_len is 0.
+ * @remark @p operand_len must be within the range of [0, HSE_KVS_VALUE_LEN_MAX].
+ * @remark The KVS must have a merge operator configured, otherwise ENOTSUP is
+ * returned.
+ *
+ * @returns Error status.
+ */
+hse_err_t
+hse_kvs_merge(
+    struct hse_kvs *kvs,
+    unsigned int flags,
+    struct hse_kvdb_txn *txn,
+    const void *key,
+    size_t key_len,
+    const void *operand,
+    size_t operand_len);
+
+/** @brief Delete all key-value pairs in a range of keys.
+ *
+ * Deletes every key @p k such that @p start <= @p k < @p end, in memcmp()
+ * order, by recording a single range tombstone. The cost of the call does
+ * not depend on the number of keys in the range. Keys put after the range
+ * delete are not affected by it.
+ *
+ * Range tombstones are checked by every get, prefix probe and cursor read,
+ * so they are intended for deleting large, coarse ranges rather than as a
+ * substitute for hse_kvs_delete().
+ *
+ * @note This function is thread safe.
+ *
+ * @param kvs: KVS handle.
+ * @param flags: Flags for operation specialization.
+ * @param txn: Transaction context, must be NULL.
+ * @param start: First key of the range.
+ * @param start_len: Length of @p start.
+ * @param end: End of the range (exclusive).
+ * @param end_len: Length of @p end.
+ *
+ * @remark @p kvs must not be NULL.
+ * @remark @p flags must be 0.
+ * @remark Range deletes are not supported within a transaction, ENOTSUP is
+ * returned if @p txn is not NULL.
+ * @remark @p start and @p end must not be NULL.
+ * @remark @p start_len and @p end_len must be within the range of
+ * [1, HSE_KVS_KEY_LEN_MAX].
+ * @remark @p start must sort before @p end.
+ *
+ * @returns Error status.
+ */
+hse_err_t
+hse_kvs_range_delete(
+    struct hse_kvs *kvs,
+    unsigned int flags,
+    struct hse_kvdb_txn *txn,
+    const void *start,
+    size_t start_len,
+    const void *end,
+    size_t end_len);
+
+/** @brief Retrieve the value for a key as of a snapshot.
+ *
+ * Behaves like hse_kvs_get(), but only sees the data that was visible when
+ * @p snap was created.
+ *
+ * @note This function is thread safe.
+ *
+ * <b>Flags:</b>
+ * @arg 0 - Reserved for future use.
+ *
+ * @param kvs: KVS handle.
+ * @param flags: Flags for operation specialization.
+ * @param snap: Snapshot handle.
+ * @param key: Key.
+ * @param key_len: Length of @p key.
+ * @param[out] found: Whether or not @p key was found.
+ * @param valbuf: Buffer into which the value associated with @p key will be
+ * copied (optional).
+ * @param valbuf_sz: Size of @p valbuf.
+ * @param[out] val_len: Actual length of value if @p key was found.
+ *
+ * @remark @p kvs must not be NULL.
+ * @remark @p snap must not be NULL.
+ * @remark @p key must not be NULL.
+ * @remark @p key_len must be within the range of [1, HSE_KVS_KEY_LEN_MAX].
+ * @remark @p found must not be NULL.
+ * @remark @p val_len must not be NULL.
+ *
+ * @returns Error status.
+ */
+hse_err_t
+hse_kvs_snapshot_get(
+    struct hse_kvs *kvs,
+    unsigned int flags,
+    struct hse_kvdb_snapshot *snap,
+    const void *key,
+    size_t key_len,
+    bool *found,
+    void *valbuf,
+    size_t valbuf_sz,
+    size_t *val_len);
+
+/** @brief Create a cursor over a snapshot.
+ *
+ * Behaves like hse_kvs_cursor_create(), but the cursor iterates over the
+ * data that was visible when @p snap was created. The cursor does not
+ * depend on @p snap after creation. hse_kvs_cursor_update_view() moves the
+ * cursor to the current view of the KVS, leaving the snapshot behind.
+ *
+ * @note This function is thread safe.
+ *
+ * <b>Flags:</b>
+ * @arg HSE_CURSOR_CREATE_REV - Iterate in reverse lexicographical order.
+ *
+ * @param kvs: KVS to iterate over.
+ * @param flags: Flags for operation specialization.
+ * @param snap: Snapshot handle.
+ * @param filter: Iteration limited to keys matching this prefix filter
+ * (optional).
+ * @param filter_len: Length of @p filter (optional).
+ * @param[out] cursor: Cursor handle.
+ *
+ * @remark @p kvs must not be NULL.
+ * @remark @p snap must not be NULL.
+ * @remark @p cursor must not be NULL.
+ *
+ * @returns Error status.
+ */
+hse_err_t
+hse_kvs_snapshot_cursor_create(
+    struct hse_kvs *kvs,
+    unsigned int flags,
+    struct hse_kvdb_snapshot *snap,
+    const void *filter,
+    size_t filter_len,
+    struct hse_kvs_cursor **cursor);
+
 /**@} KVS */
 
 #pragma GCC visibility pop
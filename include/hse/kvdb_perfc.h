@@ -18,6 +18,9 @@ enum kvdb_perfc_sidx_kvdbop {
     PERFC_RA_KVDBOP_KVS_PUT,
     PERFC_RA_KVDBOP_KVS_PUTB,
 
+    PERFC_RA_KVDBOP_KVS_MERGE,
+    PERFC_RA_KVDBOP_KVS_MERGEB,
+
     PERFC_RA_KVDBOP_KVDB_TXN_BEGIN,
     PERFC_RA_KVDBOP_KVDB_TXN_COMMIT,
     PERFC_RA_KVDBOP_KVDB_TXN_ABORT,
@@ -37,6 +40,8 @@ enum kvdb_perfc_sidx_kvdbop {
     PERFC_RA_KVDBOP_KVS_PFX_DEL,
     PERFC_RA_KVDBOP_KVS_PFX_DELB,
 
+    PERFC_RA_KVDBOP_KVS_RANGE_DEL,
+
     PERFC_RA_KVDBOP_KVS_PFXPROBE,
 
     PERFC_RA_KVDBOP_KVDB_SYNC,
@@ -108,6 +113,10 @@ enum kvdb_perfc_sidx_kvdb_metrics {
     PERFC_BA_KVDBMETRICS_CURHORIZON,
     PERFC_BA_KVDBMETRICS_HORIZON,
     PERFC_BA_KVDBMETRICS_CURCNT,
+    PERFC_BA_KVDBMETRICS_SNAPCNT,
+    PERFC_BA_KVDBMETRICS_HPCBYTES,
+    PERFC_BA_KVDBMETRICS_HPCKBLKS,
+    PERFC_RA_KVDBMETRICS_HPCSKIP,
     PERFC_RA_KVDBMETRICS_CURRETIRED,
     PERFC_RA_KVDBMETRICS_CUREVICTED,
     PERFC_DI_KVDBMETRICS_THROTTLE,
@@ -201,10 +210,21 @@ enum kvdb_perfc_sidx_pkvsl {
     PERFC_LT_PKVSL_KVS_DEL,
     PERFC_LT_PKVSL_KVS_PFX_PROBE,
     PERFC_LT_PKVSL_KVS_PFX_DEL,
+    PERFC_LT_PKVSL_KVS_MERGE,
+    PERFC_LT_PKVSL_KVS_RANGE_DEL,
 
     PERFC_EN_PKVSL
 };
 
+/* "KVSWAIT" counts time an operation on a KVS spends blocked, by reason */
+enum kvdb_perfc_sidx_kvswait {
+    PERFC_LT_KVSWAIT_THROTTLE,
+    PERFC_LT_KVSWAIT_C0FULL,
+    PERFC_LT_KVSWAIT_WALBUF,
+    PERFC_RA_KVSWAIT_COLLIDE,
+    PERFC_EN_KVSWAIT
+};
+
 /* "PKVDBL" stands for Public KVDB interface Latencies" */
 enum kvdb_perfc_sidx_pkvdbl {
     PERFC_LT_PKVDBL_KVDB_TXN_BEGIN,
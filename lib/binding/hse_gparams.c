@@ -371,6 +371,27 @@ static const struct param_spec pspecs[] = {
             },
         },
     },
+    {
+        .ps_name = "rtrace.sample_ppm",
+        .ps_description = "sample rate of request tracing (parts per million)",
+        .ps_flags = PARAM_EXPERIMENTAL | PARAM_WRITABLE,
+        .ps_type = PARAM_TYPE_U32,
+        .ps_offset = offsetof(struct hse_gparams, gp_rtrace_ppm),
+        .ps_size = PARAM_SZ(struct hse_gparams, gp_rtrace_ppm),
+        .ps_convert = param_default_converter,
+        .ps_validate = param_default_validator,
+        .ps_stringify = param_default_stringify,
+        .ps_jsonify = param_default_jsonify,
+        .ps_default_value = {
+            .as_uscalar = 0,
+        },
+        .ps_bounds = {
+            .as_uscalar = {
+                .ps_min = 0,
+                .ps_max = 1000000,
+            },
+        },
+    },
     {
         .ps_name = "rest.enabled",
         .ps_description = "Enable the REST server",
@@ -40,8 +40,10 @@
 #include <hse/rest/status.h>
 #include <hse/util/err_ctx.h>
 #include <hse/util/event_counter.h>
+#include <hse/util/keycmp.h>
 #include <hse/util/mutex.h>
 #include <hse/util/platform.h>
+#include <hse/util/rtrace.h>
 #include <hse/util/vlb.h>
 
 /* clang-format off */
@@ -62,6 +64,7 @@
 #define ENDPOINT_FMT_KMC_VMSTAT "/kmc/vmstat"
 #define ENDPOINT_FMT_PARAMS     "/params"
 #define ENDPOINT_FMT_PERFC      "/perfc"
+#define ENDPOINT_FMT_RTRACE     "/rtrace"
 #define ENDPOINT_FMT_WORKQUEUES "/workqueues"
 
 static DEFINE_MUTEX(hse_lock);
@@ -75,6 +78,9 @@ static bool hse_initialized = false;
 extern enum rest_status
 rest_get_workqueues(const struct rest_request *req, struct rest_response *resp, void *arg);
 
+extern enum rest_status
+rest_get_rtrace(const struct rest_request *req, struct rest_response *resp, void *arg);
+
 extern enum rest_status
 rest_kmc_get_vmstat(const struct rest_request *req, struct rest_response *resp, void *arg);
 
@@ -314,6 +320,7 @@ remove_global_endpoints(void)
     rest_server_remove_endpoint(ENDPOINT_FMT_KMC_VMSTAT);
     rest_server_remove_endpoint(ENDPOINT_FMT_PARAMS);
     rest_server_remove_endpoint(ENDPOINT_FMT_PERFC);
+    rest_server_remove_endpoint(ENDPOINT_FMT_RTRACE);
     rest_server_remove_endpoint(ENDPOINT_FMT_WORKQUEUES);
 }
 
@@ -334,6 +341,9 @@ add_global_endpoints(void)
         {
             [REST_METHOD_GET] = rest_get_workqueues,
         },
+        {
+            [REST_METHOD_GET] = rest_get_rtrace,
+        },
     };
 
     merr_t err;
@@ -368,6 +378,12 @@ add_global_endpoints(void)
         goto out;
     }
 
+    err = rest_server_add_endpoint(REST_ENDPOINT_EXACT, handlers[4], NULL, ENDPOINT_FMT_RTRACE);
+    if (err) {
+        log_errx("Failed to add REST endpoint (" ENDPOINT_FMT_RTRACE ")", err);
+        goto out;
+    }
+
 out:
     if (err)
         remove_global_endpoints();
@@ -1224,7 +1240,9 @@ hse_kvs_put(
     kvs_ktuple_init_nohash(&kt, key, key_len);
     kvs_vtuple_init(&vt, (void *)val, val_len);
 
+    rtrace_begin(RTRACE_OP_PUT);
     err = ikvdb_kvs_put(handle, flags, txn, &kt, &vt);
+    rtrace_end();
     ev(err);
 
     if (!err)
@@ -1235,12 +1253,53 @@ hse_kvs_put(
 }
 
 hse_err_t
-hse_kvs_get(
+hse_kvs_merge(
     struct hse_kvs *handle,
     const unsigned int flags,
     struct hse_kvdb_txn * const txn,
     const void *key,
     size_t key_len,
+    const void *operand,
+    size_t operand_len)
+{
+    struct kvs_ktuple kt;
+    struct kvs_vtuple vt;
+    merr_t err;
+
+    if (HSE_UNLIKELY(!handle || !key || (operand_len > 0 && !operand) || flags & ~HSE_KVS_PUT_PRIO))
+        return merr(EINVAL);
+
+    if (HSE_UNLIKELY(key_len > HSE_KVS_KEY_LEN_MAX))
+        return merr(ENAMETOOLONG);
+
+    if (HSE_UNLIKELY(key_len == 0))
+        return merr(ENOENT);
+
+    if (HSE_UNLIKELY(operand_len > HSE_KVS_VALUE_LEN_MAX))
+        return merr(EMSGSIZE);
+
+    kvs_ktuple_init_nohash(&kt, key, key_len);
+    kvs_vtuple_init(&vt, (void *)operand, operand_len);
+
+    err = ikvdb_kvs_merge(handle, flags, txn, &kt, &vt);
+    ev(err);
+
+    if (!err)
+        PERFC_INCADD_RU(
+            &kvdb_pc, PERFC_RA_KVDBOP_KVS_MERGE, PERFC_RA_KVDBOP_KVS_MERGEB,
+            key_len + operand_len);
+
+    return err;
+}
+
+static hse_err_t
+kvs_get_common(
+    struct hse_kvs *handle,
+    const unsigned int flags,
+    struct hse_kvdb_txn * const txn,
+    struct hse_kvdb_snapshot * const snap,
+    const void *key,
+    size_t key_len,
     bool *found,
     void *valbuf,
     size_t valbuf_sz,
@@ -1274,7 +1333,12 @@ hse_kvs_get(
     kvs_ktuple_init_nohash(&kt, key, key_len);
     kvs_buf_init(&vbuf, valbuf, valbuf_sz);
 
-    err = ikvdb_kvs_get(handle, flags, txn, &kt, &res, &vbuf);
+    rtrace_begin(RTRACE_OP_GET);
+    if (snap)
+        err = ikvdb_kvs_snapshot_get(handle, flags, snap, &kt, &res, &vbuf);
+    else
+        err = ikvdb_kvs_get(handle, flags, txn, &kt, &res, &vbuf);
+    rtrace_end();
     if (ev(err))
         return err;
 
@@ -1293,6 +1357,41 @@ hse_kvs_get(
     return 0;
 }
 
+hse_err_t
+hse_kvs_get(
+    struct hse_kvs *handle,
+    const unsigned int flags,
+    struct hse_kvdb_txn * const txn,
+    const void *key,
+    size_t key_len,
+    bool *found,
+    void *valbuf,
+    size_t valbuf_sz,
+    size_t *val_len)
+{
+    return kvs_get_common(
+        handle, flags, txn, NULL, key, key_len, found, valbuf, valbuf_sz, val_len);
+}
+
+hse_err_t
+hse_kvs_snapshot_get(
+    struct hse_kvs *handle,
+    const unsigned int flags,
+    struct hse_kvdb_snapshot * const snap,
+    const void *key,
+    size_t key_len,
+    bool *found,
+    void *valbuf,
+    size_t valbuf_sz,
+    size_t *val_len)
+{
+    if (HSE_UNLIKELY(!snap))
+        return merr(EINVAL);
+
+    return kvs_get_common(
+        handle, flags, NULL, snap, key, key_len, found, valbuf, valbuf_sz, val_len);
+}
+
 /**
  * hse_kvs_delete() - remove the supplied key and associated value from the KVS
  */
@@ -1387,6 +1486,10 @@ hse_kvs_prefix_probe(
         if (val_len)
             *val_len = vbuf.b_len;
         break;
+    case FOUND_MOPND:
+        /* Merge operands are resolved by kvs_pfx_probe(). */
+        assert(0);
+        return merr(EBUG);
     case FOUND_MULTIPLE:
         *found = HSE_KVS_PFX_FOUND_MUL;
         if (key_len)
@@ -1434,6 +1537,46 @@ hse_kvs_prefix_delete(
     return err;
 }
 
+hse_err_t
+hse_kvs_range_delete(
+    struct hse_kvs *handle,
+    const unsigned int flags,
+    struct hse_kvdb_txn * const txn,
+    const void *start,
+    size_t start_len,
+    const void *end,
+    size_t end_len)
+{
+    struct kvs_ktuple skt, ekt;
+    merr_t err;
+
+    if (HSE_UNLIKELY(!handle || !start || !end || flags != 0))
+        return merr(EINVAL);
+
+    if (HSE_UNLIKELY(txn))
+        return merr(ENOTSUP);
+
+    if (HSE_UNLIKELY(start_len > HSE_KVS_KEY_LEN_MAX || end_len > HSE_KVS_KEY_LEN_MAX))
+        return merr(ENAMETOOLONG);
+
+    if (HSE_UNLIKELY(start_len == 0 || end_len == 0))
+        return merr(ENOENT);
+
+    if (HSE_UNLIKELY(keycmp(start, start_len, end, end_len) >= 0))
+        return merr(EINVAL);
+
+    kvs_ktuple_init_nohash(&skt, start, start_len);
+    kvs_ktuple_init_nohash(&ekt, end, end_len);
+
+    err = ikvdb_kvs_range_delete(handle, flags, &skt, &ekt);
+    ev(err);
+
+    if (!err)
+        PERFC_INC_RU(&kvdb_pc, PERFC_RA_KVDBOP_KVS_RANGE_DEL);
+
+    return err;
+}
+
 hse_err_t
 hse_kvdb_sync(struct hse_kvdb *handle, const unsigned int flags)
 {
@@ -1618,6 +1761,29 @@ hse_kvs_cursor_create(
     return err;
 }
 
+hse_err_t
+hse_kvs_snapshot_cursor_create(
+    struct hse_kvs *handle,
+    const unsigned int flags,
+    struct hse_kvdb_snapshot * const snap,
+    const void *prefix,
+    size_t pfx_len,
+    struct hse_kvs_cursor **cursor)
+{
+    merr_t err;
+
+    if (HSE_UNLIKELY(!handle || !snap || !cursor || (pfx_len && !prefix) ||
+                     flags & ~HSE_CURSOR_CREATE_MASK))
+        return merr(EINVAL);
+
+    PERFC_INC_RU(&kvdb_pc, PERFC_RA_KVDBOP_KVS_CURSOR_CREATE);
+
+    err = ikvdb_kvs_snapshot_cursor_create(handle, flags, snap, prefix, pfx_len, cursor);
+    ev(err);
+
+    return err;
+}
+
 hse_err_t
 hse_kvs_cursor_update_view(struct hse_kvs_cursor *cursor, const unsigned int flags)
 {
@@ -1712,7 +1878,9 @@ hse_kvs_cursor_read(
     if (HSE_UNLIKELY(!!val ^ !!vlen))
         return merr(EINVAL);
 
+    rtrace_begin(RTRACE_OP_CURSOR_READ);
     err = ikvdb_kvs_cursor_read(cursor, flags, key, klen, val, vlen, eof);
+    rtrace_end();
     ev(err);
 
     if (!err && !*eof) {
@@ -1747,8 +1915,10 @@ hse_kvs_cursor_read_copy(
     if (HSE_UNLIKELY(!valbuf && valbuf_sz > 0))
         return merr(EINVAL);
 
+    rtrace_begin(RTRACE_OP_CURSOR_READ);
     err = ikvdb_kvs_cursor_read_copy(
         cursor, flags, keybuf, keybuf_sz, key_len, valbuf, valbuf_sz, val_len, eof);
+    rtrace_end();
     ev(err);
 
     if (!err && !*eof) {
@@ -1802,6 +1972,29 @@ hse_kvdb_compact_status_get(struct hse_kvdb *handle, struct hse_kvdb_compact_sta
     return 0;
 }
 
+hse_err_t
+hse_kvdb_snapshot_create(struct hse_kvdb *handle, struct hse_kvdb_snapshot **snap)
+{
+    merr_t err;
+
+    if (HSE_UNLIKELY(!handle || !snap))
+        return merr(EINVAL);
+
+    err = ikvdb_snapshot_create((struct ikvdb *)handle, snap);
+    ev(err);
+
+    return err;
+}
+
+void
+hse_kvdb_snapshot_release(struct hse_kvdb *handle, struct hse_kvdb_snapshot *snap)
+{
+    if (HSE_UNLIKELY(!handle || !snap))
+        return;
+
+    ikvdb_snapshot_release((struct ikvdb *)handle, snap);
+}
+
 size_t
 hse_strerror(hse_err_t err, char *buf, size_t buf_sz)
 {
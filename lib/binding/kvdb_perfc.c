@@ -18,11 +18,14 @@ struct perfc_name kvdb_perfc_op[] _dt_section = {
     NE(PERFC_RA_KVDBOP_KVS_GETB,        1, "kvs_get klen+vlen",       "r_kvs_get_bytes(/s)"),
     NE(PERFC_RA_KVDBOP_KVS_PUT,         1, "kvs_put rate",            "r_kvs_put(/s)"),
     NE(PERFC_RA_KVDBOP_KVS_PUTB,        1, "kvs_put klen+vlen",       "r_kvs_put_bytes(/s)"),
+    NE(PERFC_RA_KVDBOP_KVS_MERGE,       1, "kvs_merge rate",          "r_kvs_merge(/s)"),
+    NE(PERFC_RA_KVDBOP_KVS_MERGEB,      1, "kvs_merge klen+vlen",     "r_kvs_merge_bytes(/s)"),
     NE(PERFC_RA_KVDBOP_KVS_DEL,         1, "kvs_delete rate",         "r_kvs_delete(/s)"),
     NE(PERFC_RA_KVDBOP_KVS_DELB,        1, "kvs_del klen",            "r_kvs_del_bytes(/s)"),
     NE(PERFC_RA_KVDBOP_KVS_PFX_DELB,    1, "kvs_pfxdel klen",         "r_kvs_pfxdel_bytes(/s)"),
     NE(PERFC_RA_KVDBOP_KVS_PFXPROBE,    1, "kvs_prefix_probe rate",   "r_kvs_prefix_probe(/s)"),
     NE(PERFC_RA_KVDBOP_KVS_PFX_DEL,     1, "kvs_prefix_delete rate",  "r_kvs_prefix_delete(/s)"),
+    NE(PERFC_RA_KVDBOP_KVS_RANGE_DEL,   1, "kvs_range_delete rate",   "r_kvs_range_delete(/s)"),
     NE(PERFC_RA_KVDBOP_KVDB_SYNC,       1, "kvdb_sync rate",          "r_kvdb_sync(/s)"),
     NE(PERFC_RA_KVDBOP_KVDB_TXN_ALLOC,  1, "kvdb_txn_alloc rate",     "r_kvdb_txn_alloc(/s)"),
     NE(PERFC_RA_KVDBOP_KVDB_TXN_FREE,   1, "kvdb_txn_free rate",      "r_kvdb_txn_free(/s)"),
@@ -77,6 +80,10 @@ NE_CHECK(c0_metrics_perfc, PERFC_EN_C0METRICS, "c0_metrics_perfc table/enum mism
 
 struct perfc_name kvdb_metrics_perfc[] _dt_section = {
     NE(PERFC_BA_KVDBMETRICS_CURCNT,     0, "Active cursor count",         "c_cur_active"),
+    NE(PERFC_BA_KVDBMETRICS_SNAPCNT,    0, "Active snapshot count",       "c_snap_active"),
+    NE(PERFC_BA_KVDBMETRICS_HPCBYTES,   0, "Hugepage cache bytes",        "c_hpc_bytes"),
+    NE(PERFC_BA_KVDBMETRICS_HPCKBLKS,   0, "Hugepage cached kblocks",     "c_hpc_kblks"),
+    NE(PERFC_RA_KVDBMETRICS_HPCSKIP,    0, "Hugepage cache skip rate",    "r_hpc_skip(/s)"),
     NE(PERFC_RA_KVDBMETRICS_CURRETIRED, 0, "Cached cursor retired rate",  "r_cur_retired(/s)"),
     NE(PERFC_RA_KVDBMETRICS_CUREVICTED, 0, "Cached cursor eviction rate", "r_cur_evicted(/s)"),
 
@@ -117,10 +117,32 @@ c0_prefix_del(struct c0 *handle, struct kvs_ktuple *kt, uintptr_t seqnoref)
     return c0sk_prefix_del(self->c0_c0sk, self->c0_index, kt, seqnoref);
 }
 
+merr_t
+c0_range_del(
+    struct c0 *handle,
+    struct kvs_ktuple *start,
+    const struct kvs_ktuple *end,
+    uintptr_t seqnoref)
+{
+    struct c0_impl *self = c0_h2r(handle);
+
+    assert(self->c0_index < HSE_KVS_COUNT_MAX);
+    return c0sk_range_del(self->c0_c0sk, self->c0_index, start, end, seqnoref);
+}
+
 /*
  * Tombstone indicated by:
  *     return value == 0 && res == FOUND_TOMB
  */
+merr_t
+c0_merge(struct c0 *handle, struct kvs_ktuple *kt, const struct kvs_vtuple *vt, uintptr_t seqnoref)
+{
+    struct c0_impl *self = c0_h2r(handle);
+
+    assert(self->c0_index < HSE_KVS_COUNT_MAX);
+    return c0sk_merge(self->c0_c0sk, self->c0_index, kt, vt, seqnoref);
+}
+
 merr_t
 c0_get(
     struct c0 *handle,
@@ -139,6 +161,39 @@ c0_get(
         self->c0_c0sk, self->c0_index, self->c0_pfx_len, kt, view_seqno, seqnoref, res, vbuf);
 }
 
+merr_t
+c0_get_merged(
+    struct c0 *handle,
+    struct kvs_ktuple *kt,
+    uint64_t view_seqno,
+    enum key_lookup_res *res,
+    struct kvs_buf *vbuf)
+{
+    struct c0_impl *self = c0_h2r(handle);
+
+    assert(self->c0_index < HSE_KVS_COUNT_MAX);
+    return c0sk_get_merged(
+        self->c0_c0sk, self->c0_index, self->c0_pfx_len, kt, view_seqno, res, vbuf);
+}
+
+merr_t
+c0_get_merged_onto(
+    struct c0 *handle,
+    struct kvs_ktuple *kt,
+    uint64_t view_seqno,
+    const void *base,
+    uint32_t base_len,
+    enum key_lookup_res *res,
+    struct kvs_buf *vbuf)
+{
+    struct c0_impl *self = c0_h2r(handle);
+
+    assert(self->c0_index < HSE_KVS_COUNT_MAX);
+    return c0sk_get_merged_onto(
+        self->c0_c0sk, self->c0_index, self->c0_pfx_len, kt, view_seqno, base, base_len, res,
+        vbuf);
+}
+
 merr_t
 c0_pfx_probe(
     struct c0 *handle,
@@ -304,6 +359,12 @@ c0_cursor_update(struct c0_cursor *c0cur, uint64_t seqno, uint32_t *flags_out)
     return c0sk_cursor_update(c0cur, seqno, flags_out);
 }
 
+merr_t
+c0_cursor_rtombs(struct c0_cursor *c0cur, struct rtomb_vec *rv)
+{
+    return c0sk_cursor_rtombs(c0cur, rv);
+}
+
 merr_t
 c0_cursor_destroy(struct c0_cursor *c0cur)
 {
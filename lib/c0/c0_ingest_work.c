@@ -31,6 +31,10 @@ c0_ingest_work_fini(struct c0_ingest_work *w)
     assert(w->c0iw_magic == (uintptr_t)w);
     w->c0iw_magic = 0xdeadc0de;
 
+    free(w->c0iw_mres.mr_entv);
+    free(w->c0iw_mres.mr_buf);
+    c0sk_mscratch_fini(&w->c0iw_mscratch);
+
     /* GCOV_EXCL_START */
 
     if (w->t0 > 0) {
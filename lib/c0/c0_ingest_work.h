@@ -16,6 +16,8 @@
 #include <hse/ikvdb/limits.h>
 #include <hse/util/platform.h>
 
+#include "c0sk_internal.h"
+
 /* clang-format off */
 
 /**
@@ -34,6 +36,8 @@
  * @c0iw_coalescec:
  * @c0iw_tingesting:    time of most recent call to c0kvms_ingesting()
  * @c0iw_usage:         finalized usage metrics
+ * @c0iw_mres:          per-operand results for resolving merge operands
+ * @c0iw_mscratch:      lookup buffers for resolving merge operands
  *
  * [HSE_REVISIT]
  */
@@ -69,6 +73,9 @@ struct c0_ingest_work {
     uint64_t c0iw_vbytes;
     uint64_t c0iw_mask;
 
+    struct c0sk_mres     c0iw_mres;
+    struct c0sk_mscratch c0iw_mscratch;
+
     /* Establishing view for ingest */
     uint64_t c0iw_ingest_max_seqno;
     uint64_t c0iw_ingest_min_seqno;
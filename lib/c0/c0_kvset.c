@@ -8,6 +8,8 @@
 #include <hse/ikvdb/c0_kvset.h>
 #include <hse/ikvdb/c0_kvset_iterator.h>
 #include <hse/ikvdb/limits.h>
+#include <hse/ikvdb/merge_op.h>
+#include <hse/ikvdb/rtomb.h>
 #include <hse/util/bonsai_tree.h>
 #include <hse/util/compression_lz4.h>
 #include <hse/util/event_counter.h>
@@ -217,6 +219,18 @@ c0kvs_seqno_set(struct c0_kvset_impl *c0kvs, struct bonsai_val *bv)
     return seq;
 }
 
+/**
+ * struct c0_rtomb - a range tombstone in c0
+ * @c0rt_next:  next older range tombstone
+ * @c0rt_rt:    the range tombstone (keys follow this struct)
+ * @c0rt_skidx: kvs index
+ */
+struct c0_rtomb {
+    struct c0_rtomb *c0rt_next;
+    struct rtomb c0rt_rt;
+    uint16_t c0rt_skidx;
+};
+
 /**
  * c0kvs_ior_cb() - Callback method to update stats on insert/replace and
  *                  attach a value element to the values list.
@@ -446,6 +460,7 @@ c0kvs_create(atomic_ulong *kvdb_seqno, atomic_ulong *kvms_seqno, struct c0_kvset
     set->c0s_cheap = cheap;
     atomic_set(&set->c0s_finalized, 0);
     mutex_init(&set->c0s_mutex);
+    set->c0s_rtombs = NULL;
 
     err = bn_create(cheap, c0kvs_ior_cb, set, &set->c0s_broot);
     if (ev(err)) {
@@ -513,6 +528,7 @@ c0kvs_reset(struct c0_kvset *handle, size_t sz)
 
     bn_reset(set->c0s_broot);
 
+    set->c0s_rtombs = NULL;
     atomic_set(&set->c0s_finalized, 0);
     set->c0s_num_entries = 0;
     set->c0s_num_tombstones = 0;
@@ -593,6 +609,111 @@ c0kvs_put(
     return c0kvs_putdel(self, &skey, &sval, &kt->kt_seqno);
 }
 
+merr_t
+c0kvs_merge(
+    struct c0_kvset *handle,
+    uint16_t skidx,
+    struct kvs_ktuple *kt,
+    const struct kvs_vtuple *vt,
+    uintptr_t seqnoref,
+    enum merge_op op)
+{
+    struct c0_kvset_impl *self = c0_kvset_h2r(handle);
+    struct bonsai_val *old = NULL;
+    struct bonsai_kv *kv = NULL;
+    struct bonsai_skey skey;
+    struct bonsai_sval sval;
+    uint64_t xlen;
+    void *data, *buf;
+    merr_t err = 0;
+
+    assert(kvs_vtuple_is_mopnd(vt));
+    assert(HSE_SQNREF_SINGLE_P(seqnoref) || HSE_SQNREF_ORDNL_P(seqnoref));
+
+    bn_skey_init(kt->kt_data, kt->kt_len, kt->kt_flags, skidx, &skey);
+
+    data = vt->vt_data;
+    xlen = vt->vt_xlen;
+    buf = NULL;
+
+    c0kvs_lock(self);
+
+    /* Assign the seqno here rather than in c0kvs_ior_cb() so that we can
+     * find a value with the same seqno and fold the operand into it.  The
+     * result replaces that value, which keeps the value list from growing
+     * with each merge.  The combined value remains an operand only if the
+     * value it replaces was an operand.
+     */
+    if (HSE_SQNREF_SINGLE_P(seqnoref)) {
+        uint64_t seq = atomic_read(self->c0s_kvdb_seqno);
+
+        if (HSE_UNLIKELY(atomic_read(self->c0s_kvms_seqno) != HSE_SQNREF_INVALID))
+            seq = atomic_read(self->c0s_kvms_seqno);
+
+        seqnoref = HSE_ORDNL_TO_SQNREF(seq);
+    }
+
+    if (bn_find(self->c0s_broot, &skey, &kv)) {
+        for (old = rcu_dereference(kv->bkv_values); old; old = rcu_dereference(old->bv_next)) {
+            if (old->bv_seqnoref == seqnoref)
+                break;
+        }
+    }
+
+    if (old) {
+        uint32_t len = 0, sz;
+
+        if (!HSE_CORE_IS_TOMB(old->bv_value))
+            len = bonsai_val_ulen(old);
+
+        sz = merge_op_result_len(op, len, kvs_vtuple_vlen(vt));
+        sz = max_t(uint32_t, sz, len);
+
+        buf = malloc(sz);
+        if (ev(!buf && sz > 0)) {
+            err = merr(ENOMEM);
+            goto unlock;
+        }
+
+        if (len > 0 && bonsai_val_clen(old) > 0) {
+            uint outlen;
+
+            err = compress_lz4_ops.cop_decompress(
+                old->bv_value, bonsai_val_clen(old), buf, sz, &outlen);
+            if (ev(err))
+                goto unlock;
+
+            len = outlen;
+        } else if (len > 0) {
+            memcpy(buf, old->bv_value, len);
+        }
+
+        merge_op_apply(op, buf, sz, &len, vt->vt_data, kvs_vtuple_vlen(vt));
+
+        data = buf;
+        xlen = len;
+        if (bonsai_val_is_mopnd(old))
+            xlen |= HSE_CORE_XLEN_MOPND;
+    }
+
+    bn_sval_init(data, xlen, seqnoref, &sval);
+
+    err = bn_insert_or_replace(self->c0s_broot, &skey, &sval);
+
+unlock:
+    c0kvs_unlock(self);
+
+    free(buf);
+
+    /* See c0kvs_putdel() */
+    assert(atomic_read(&self->c0s_finalized) == 0);
+
+    if (!err)
+        kt->kt_seqno = HSE_SQNREF_TO_ORDNL(sval.bsv_seqnoref);
+
+    return err;
+}
+
 merr_t
 c0kvs_del(struct c0_kvset *handle, uint16_t skidx, struct kvs_ktuple *key, uintptr_t seqnoref)
 {
@@ -623,6 +744,108 @@ c0kvs_prefix_del(
     return c0kvs_putdel(self, &skey, &sval, &key->kt_seqno);
 }
 
+merr_t
+c0kvs_range_del(
+    struct c0_kvset *handle,
+    uint16_t skidx,
+    struct kvs_ktuple *start,
+    const struct kvs_ktuple *end,
+    uintptr_t seqnoref)
+{
+    struct c0_kvset_impl *self = c0_kvset_h2r(handle);
+    struct c0_rtomb *c0rt;
+    char *kdata;
+    uint64_t seq;
+
+    c0kvs_lock(self);
+    c0rt = cheap_memalign(
+        self->c0s_cheap, __alignof__(*c0rt), sizeof(*c0rt) + start->kt_len + end->kt_len);
+    if (!c0rt) {
+        c0kvs_unlock(self);
+        return merr(ENOMEM);
+    }
+
+    kdata = (char *)(c0rt + 1);
+    memcpy(kdata, start->kt_data, start->kt_len);
+    memcpy(kdata + start->kt_len, end->kt_data, end->kt_len);
+
+    c0rt->c0rt_rt.rt_start = kdata;
+    c0rt->c0rt_rt.rt_slen = start->kt_len;
+    c0rt->c0rt_rt.rt_end = kdata + start->kt_len;
+    c0rt->c0rt_rt.rt_elen = end->kt_len;
+    c0rt->c0rt_skidx = skidx;
+
+    /* Same seqno assignment as for ptombs, see c0kvs_seqno_set().
+     */
+    if (seqnoref == HSE_SQNREF_SINGLE) {
+        seq = atomic_inc_return(self->c0s_kvdb_seqno);
+
+        if (HSE_UNLIKELY(atomic_read(self->c0s_kvms_seqno) != HSE_SQNREF_INVALID))
+            seq = atomic_inc_return(self->c0s_kvms_seqno);
+    } else {
+        seq = HSE_SQNREF_TO_ORDNL(seqnoref);
+    }
+
+    c0rt->c0rt_rt.rt_seqno = seq;
+    c0rt->c0rt_next = self->c0s_rtombs;
+
+    rcu_assign_pointer(self->c0s_rtombs, c0rt);
+
+    self->c0s_num_tombstones++;
+    self->c0s_memsz += sizeof(*c0rt) + start->kt_len + end->kt_len;
+    c0kvs_unlock(self);
+
+    start->kt_seqno = seq;
+
+    return 0;
+}
+
+uint64_t
+c0kvs_rtomb_lookup(
+    struct c0_kvset *handle,
+    uint16_t skidx,
+    const struct kvs_ktuple *kt,
+    uint64_t view_seq)
+{
+    struct c0_kvset_impl *self = c0_kvset_h2r(handle);
+    struct c0_rtomb *c0rt;
+    uint64_t seq = 0;
+
+    /* The list is only ever prepended to and is never pruned while the
+     * c0kvset is reachable, so no lock is required to traverse it.
+     */
+    for (c0rt = rcu_dereference(self->c0s_rtombs); c0rt; c0rt = c0rt->c0rt_next) {
+        const struct rtomb *rt = &c0rt->c0rt_rt;
+
+        if (rt->rt_seqno > view_seq || rt->rt_seqno <= seq || c0rt->c0rt_skidx != skidx)
+            continue;
+
+        if (rtomb_covers(rt, kt->kt_data, kt->kt_len))
+            seq = rt->rt_seqno;
+    }
+
+    return seq;
+}
+
+merr_t
+c0kvs_rtombs_get(struct c0_kvset *handle, uint16_t skidx, struct rtomb_vec *rv)
+{
+    struct c0_kvset_impl *self = c0_kvset_h2r(handle);
+    struct c0_rtomb *c0rt;
+    merr_t err;
+
+    for (c0rt = rcu_dereference(self->c0s_rtombs); c0rt; c0rt = c0rt->c0rt_next) {
+        if (c0rt->c0rt_skidx != skidx)
+            continue;
+
+        err = rtomb_vec_add(rv, &c0rt->c0rt_rt);
+        if (ev(err))
+            return err;
+    }
+
+    return 0;
+}
+
 uint64_t
 c0kvs_get_element_count(struct c0_kvset *handle)
 {
@@ -733,7 +956,7 @@ c0kvs_get_excl(
         }
     }
 
-    *res = FOUND_VAL;
+    *res = bonsai_val_is_mopnd(val) ? FOUND_MOPND : FOUND_VAL;
 
     return 0;
 }
@@ -815,6 +1038,7 @@ c0kvs_pfx_probe_cmn(
              * hide mutations local to txn. So fallthrough and
              * count this key
              */
+            val_seq = UINT64_MAX;
         } else {
             if (val_seq < pt_seq)
                 continue;
@@ -823,7 +1047,8 @@ c0kvs_pfx_probe_cmn(
         }
 
         /* add to tomblist if a tombstone was encountered */
-        if (HSE_CORE_IS_TOMB(val->bv_value)) {
+        if (HSE_CORE_IS_TOMB(val->bv_value) ||
+            qctx_rtomb_hides(qctx, kv->bkv_key, klen, view_seqno, val_seq)) {
             err = qctx_tomb_insert(qctx, kv->bkv_key, klen);
             if (ev(err))
                 break;
@@ -14,6 +14,7 @@
 
 #define c0_kvset_h2r(handle) container_of(handle, struct c0_kvset_impl, c0s_handle)
 
+struct c0_rtomb;
 struct kvs_buf;
 struct kvs_ktuple;
 struct query_ctx;
@@ -33,6 +34,7 @@ enum key_lookup_res;
  * @c0s_kvdb_seqno:        pointer to kvdb seqno
  * @c0s_kvms_seqno:        pointer to kvms seqno
  * @c0s_mutex:             mutex for bonsai tree updates
+ * @c0s_rtombs:            range tombstones, newest first (ptomb c0kvset only)
  * @c0s_num_entries:       how many entries (includes tombstones)
  * @c0s_num_tombstones:    how many tombstones
  * @c0s_keyb:              total key bytes
@@ -60,6 +62,7 @@ struct c0_kvset_impl {
     atomic_ulong *c0s_kvms_seqno;
 
     struct mutex c0s_mutex HSE_ACP_ALIGNED;
+    struct c0_rtomb *c0s_rtombs;
 
     uint32_t c0s_num_entries HSE_L1D_ALIGNED;
     uint32_t c0s_num_tombstones;
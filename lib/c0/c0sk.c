@@ -33,7 +33,9 @@
 #include <hse/ikvdb/kvdb_ctxn.h>
 #include <hse/ikvdb/kvdb_perfc.h>
 #include <hse/ikvdb/kvdb_rparams.h>
+#include <hse/ikvdb/kvs_cparams.h>
 #include <hse/ikvdb/rparam_debug_flags.h>
+#include <hse/ikvdb/rtomb.h>
 
 #include "c0_cursor.h"
 #include "c0sk_internal.h"
@@ -256,6 +258,30 @@ c0sk_put(
     return err;
 }
 
+merr_t
+c0sk_merge(
+    struct c0sk *handle,
+    uint16_t skidx,
+    struct kvs_ktuple *kt,
+    const struct kvs_vtuple *vt,
+    uintptr_t seqnoref)
+{
+    struct c0sk_impl *self = c0sk_h2r(handle);
+    uint64_t start;
+    merr_t err;
+
+    start = perfc_lat_startu(&self->c0sk_pc_op, PERFC_LT_C0SKOP_PUT);
+
+    err = c0sk_putdel(self, skidx, C0SK_OP_MERGE, kt, vt, seqnoref);
+
+    if (start > 0) {
+        perfc_lat_record(&self->c0sk_pc_op, PERFC_LT_C0SKOP_PUT, start);
+        perfc_inc(&self->c0sk_pc_op, PERFC_RA_C0SKOP_PUT);
+    }
+
+    return err;
+}
+
 merr_t
 c0sk_del(struct c0sk *handle, uint16_t skidx, struct kvs_ktuple *kt, uintptr_t seqnoref)
 {
@@ -283,30 +309,50 @@ c0sk_prefix_del(struct c0sk *handle, uint16_t skidx, struct kvs_ktuple *kt, uint
     return c0sk_putdel(self, skidx, C0SK_OP_PREFIX_DEL, kt, NULL, seqnoref);
 }
 
+merr_t
+c0sk_range_del(
+    struct c0sk *handle,
+    uint16_t skidx,
+    struct kvs_ktuple *start,
+    const struct kvs_ktuple *end,
+    uintptr_t seqnoref)
+{
+    struct c0sk_impl *self = c0sk_h2r(handle);
+    struct kvs_vtuple vt;
+
+    kvs_vtuple_init(&vt, (void *)end->kt_data, end->kt_len);
+
+    return c0sk_putdel(self, skidx, C0SK_OP_RANGE_DEL, start, &vt, seqnoref);
+}
+
 /*
  * Tombstone indicated by:
  *     return value == 0 && res == FOUND_TOMB
+ *
+ * On return *val_seqp and *pfx_seqp (if not NULL) contain the seqnos
+ * of the value and of the newest ptomb or range tombstone that were
+ * found (zero if none).
  */
-merr_t
-c0sk_get(
-    struct c0sk *handle,
+static merr_t
+c0sk_get_impl(
+    struct c0sk_impl *self,
     uint16_t skidx,
     uint32_t pfx_len,
     const struct kvs_ktuple *kt,
     uint64_t view_seq,
     uintptr_t seqref,
     enum key_lookup_res *res,
-    struct kvs_buf *vbuf)
+    struct kvs_buf *vbuf,
+    uint64_t *val_seqp,
+    uint64_t *pfx_seqp)
 {
     struct c0_kvmultiset *c0kvms;
-    struct c0sk_impl *self;
     uintptr_t key_seqref = 0, ptomb_seqref = 0;
     uint64_t start;
-    uint64_t pfx_seq = 0, val_seq = 0;
+    uint64_t pfx_seq = 0, val_seq = 0, rt_seq = 0;
     uint64_t seq;
     merr_t err = 0;
 
-    self = c0sk_h2r(handle);
     *res = NOT_FOUND;
 
     start = perfc_lat_startl(&self->c0sk_pc_op, PERFC_LT_C0SKOP_GET);
@@ -334,6 +380,10 @@ c0sk_get(
                 pfx_seq = seq;
         }
 
+        seq = c0kvs_rtomb_lookup(c0kvms_ptomb_c0kvset_get(c0kvms), skidx, kt, view_seq);
+        if (seq > rt_seq)
+            rt_seq = seq;
+
         /* Search for latest value of key w/ seqno <= iseqno. */
         c0kvs = c0kvms_get_hashed_c0kvset(c0kvms, kt->kt_hash);
         err = c0kvs_get_rcu(c0kvs, skidx, kt, view_seq, seqref, res, vbuf, &key_seqref);
@@ -350,6 +400,9 @@ c0sk_get(
     if (pfx_seq > val_seq) {
         *res = FOUND_PTMB;
         vbuf->b_len = 0;
+    } else if (rt_seq > val_seq) {
+        *res = FOUND_TMB;
+        vbuf->b_len = 0;
     }
 
     if (start > 0) {
@@ -357,9 +410,346 @@ c0sk_get(
         perfc_inc(&self->c0sk_pc_op, PERFC_RA_C0SKOP_GET);
     }
 
+    if (val_seqp)
+        *val_seqp = val_seq;
+    if (pfx_seqp)
+        *pfx_seqp = max_t(uint64_t, pfx_seq, rt_seq);
+
     return err;
 }
 
+merr_t
+c0sk_get(
+    struct c0sk *handle,
+    uint16_t skidx,
+    uint32_t pfx_len,
+    const struct kvs_ktuple *kt,
+    uint64_t view_seq,
+    uintptr_t seqref,
+    enum key_lookup_res *res,
+    struct kvs_buf *vbuf)
+{
+    struct c0sk_impl *self = c0sk_h2r(handle);
+
+    return c0sk_get_impl(self, skidx, pfx_len, kt, view_seq, seqref, res, vbuf, NULL, NULL);
+}
+
+/**
+ * struct c0sk_mopnd - trailer of a merge operand collected in ms_obuf
+ * @mo_seq: operand seqno
+ * @mo_len: operand length
+ *
+ * Each operand is stored as its data followed by this trailer, so the
+ * operands, collected newest first, can be applied oldest first by walking
+ * back from the end of the buffer.
+ */
+struct c0sk_mopnd {
+    uint64_t mo_seq;
+    uint32_t mo_len;
+};
+
+/* Thread-local initial buffers for c0sk_get_merged(), large enough for the
+ * common case of short counters and appends.
+ */
+static thread_local char c0sk_mvbuf_tls[4096];
+static thread_local char c0sk_mobuf_tls[4096];
+
+void
+c0sk_mscratch_fini(struct c0sk_mscratch *ms)
+{
+    if (ms->ms_vbuf != ms->ms_vinit)
+        free(ms->ms_vbuf);
+    if (ms->ms_obuf != ms->ms_oinit)
+        free(ms->ms_obuf);
+
+    ms->ms_vbuf = ms->ms_vinit;
+    ms->ms_obuf = ms->ms_oinit;
+
+    if (!ms->ms_vinit)
+        ms->ms_vbufsz = 0;
+    if (!ms->ms_oinit)
+        ms->ms_obufsz = 0;
+}
+
+/* Grows a scratch buffer to at least @need bytes, preserving the first @keep.
+ */
+static merr_t
+c0sk_mscratch_grow(char **bufp, size_t *bufszp, const char *init, size_t need, size_t keep)
+{
+    size_t sz = max_t(size_t, *bufszp * 2, need);
+    char *p;
+
+    if (*bufp == init) {
+        p = malloc(sz);
+        if (p && keep > 0)
+            memcpy(p, init, keep);
+    } else {
+        p = realloc(*bufp, sz);
+    }
+
+    if (ev(!p))
+        return merr(ENOMEM);
+
+    *bufp = p;
+    *bufszp = sz;
+
+    return 0;
+}
+
+static merr_t
+c0sk_mres_add(struct c0sk_mres *mres, uint64_t seq, const void *data, uint32_t len)
+{
+    if (mres->mr_cnt == mres->mr_max) {
+        uint32_t max = mres->mr_max ? mres->mr_max * 2 : 16;
+        void *p = realloc(mres->mr_entv, max * sizeof(*mres->mr_entv));
+
+        if (ev(!p))
+            return merr(ENOMEM);
+
+        mres->mr_entv = p;
+        mres->mr_max = max;
+    }
+
+    if (mres->mr_len + len > mres->mr_bufsz) {
+        size_t sz = max_t(size_t, mres->mr_bufsz * 2, mres->mr_len + len);
+        void *p;
+
+        sz = max_t(size_t, sz, 4096);
+        p = realloc(mres->mr_buf, sz);
+        if (ev(!p))
+            return merr(ENOMEM);
+
+        mres->mr_buf = p;
+        mres->mr_bufsz = sz;
+    }
+
+    memcpy(mres->mr_buf + mres->mr_len, data, len);
+
+    mres->mr_entv[mres->mr_cnt].me_seq = seq;
+    mres->mr_entv[mres->mr_cnt].me_off = mres->mr_len;
+    mres->mr_entv[mres->mr_cnt].me_len = len;
+    mres->mr_cnt++;
+    mres->mr_len += len;
+
+    return 0;
+}
+
+merr_t
+c0sk_get_merged_impl(
+    struct c0sk_impl *self,
+    uint16_t skidx,
+    uint32_t pfx_len,
+    struct kvs_ktuple *kt,
+    uint64_t view_seq,
+    const struct kvs_buf *base,
+    enum key_lookup_res *res,
+    struct kvs_buf *vbuf,
+    struct c0sk_mscratch *ms,
+    struct c0sk_mres *mres)
+{
+    struct cn *cn = self->c0sk_cnv[skidx];
+    struct c0sk_mopnd mo;
+    enum merge_op op;
+    size_t ooff = 0;
+    uint32_t len, copylen;
+    struct kvs_buf sbuf;
+    bool found;
+    merr_t err;
+
+    assert(cn);
+    op = cn_get_cparams(cn)->merge_op;
+
+    if (mres) {
+        mres->mr_cnt = 0;
+        mres->mr_len = 0;
+    }
+
+    if (ms->ms_vbufsz < 1024) {
+        err = c0sk_mscratch_grow(&ms->ms_vbuf, &ms->ms_vbufsz, ms->ms_vinit, 1024, 0);
+        if (ev(err))
+            return err;
+    }
+
+    /* Walk back through the key's history collecting operands (newest
+     * first) until we hit a value, a tombstone, or nothing at all.
+     * Operands never leave c0, so lc and cn are searched only for the
+     * base value, and not at all if the caller supplied it.
+     */
+    while (1) {
+        uint64_t val_seq = 0, pfx_seq = 0;
+
+        kvs_buf_init(&sbuf, ms->ms_vbuf, ms->ms_vbufsz);
+
+        err = c0sk_get_impl(
+            self, skidx, pfx_len, kt, view_seq, 0, res, &sbuf, &val_seq, &pfx_seq);
+
+        if (!err && *res == NOT_FOUND && base) {
+            if (base->b_len > ms->ms_vbufsz) {
+                err = c0sk_mscratch_grow(
+                    &ms->ms_vbuf, &ms->ms_vbufsz, ms->ms_vinit, base->b_len, 0);
+                if (ev(err))
+                    return err;
+            }
+
+            if (base->b_len > 0)
+                memcpy(ms->ms_vbuf, base->b_buf, base->b_len);
+            sbuf.b_len = base->b_len;
+            *res = FOUND_VAL;
+            break;
+        }
+
+        if (!err && *res == NOT_FOUND)
+            err = lc_get(self->c0sk_lc, skidx, pfx_len, kt, view_seq, 0, res, &sbuf);
+
+        if (!err && *res == NOT_FOUND)
+            err = cn_get(cn, kt, view_seq, res, &sbuf);
+
+        if (ev(err))
+            return err;
+
+        if ((*res == FOUND_VAL || *res == FOUND_MOPND) && sbuf.b_len > ms->ms_vbufsz) {
+            err = c0sk_mscratch_grow(&ms->ms_vbuf, &ms->ms_vbufsz, ms->ms_vinit, sbuf.b_len, 0);
+            if (ev(err))
+                return err;
+
+            continue; /* retry with a large enough buffer */
+        }
+
+        if (*res != FOUND_MOPND)
+            break;
+
+        if (ooff + sbuf.b_len + sizeof(mo) > ms->ms_obufsz) {
+            err = c0sk_mscratch_grow(
+                &ms->ms_obuf, &ms->ms_obufsz, ms->ms_oinit, ooff + sbuf.b_len + sizeof(mo), ooff);
+            if (ev(err))
+                return err;
+        }
+
+        mo.mo_seq = val_seq;
+        mo.mo_len = sbuf.b_len;
+
+        memcpy(ms->ms_obuf + ooff, sbuf.b_buf, sbuf.b_len);
+        ooff += sbuf.b_len;
+        memcpy(ms->ms_obuf + ooff, &mo, sizeof(mo));
+        ooff += sizeof(mo);
+
+        /* An operand with the same seqno as a ptomb follows the ptomb. */
+        assert(val_seq > 0);
+        if (pfx_seq >= val_seq) {
+            *res = FOUND_PTMB;
+            break;
+        }
+
+        view_seq = val_seq - 1;
+    }
+
+    /* Apply the operands oldest to newest to the base value (if any).
+     */
+    len = (*res == FOUND_VAL) ? sbuf.b_len : 0;
+    found = (ooff > 0 || *res == FOUND_VAL);
+
+    while (ooff > 0) {
+        const char *data;
+        size_t sz;
+
+        ooff -= sizeof(mo);
+        memcpy(&mo, ms->ms_obuf + ooff, sizeof(mo));
+        ooff -= mo.mo_len;
+        data = ms->ms_obuf + ooff;
+
+        sz = max_t(uint32_t, merge_op_result_len(op, len, mo.mo_len), len);
+        if (sz > ms->ms_vbufsz) {
+            err = c0sk_mscratch_grow(&ms->ms_vbuf, &ms->ms_vbufsz, ms->ms_vinit, sz, len);
+            if (ev(err))
+                return err;
+        }
+
+        merge_op_apply(op, ms->ms_vbuf, ms->ms_vbufsz, &len, data, mo.mo_len);
+
+        if (mres) {
+            err = c0sk_mres_add(mres, mo.mo_seq, ms->ms_vbuf, len);
+            if (err)
+                return err;
+        }
+    }
+
+    if (found) {
+        *res = FOUND_VAL;
+
+        copylen = min_t(uint32_t, len, vbuf->b_buf_sz);
+        if (copylen > 0 && vbuf->b_buf)
+            memcpy(vbuf->b_buf, ms->ms_vbuf, copylen);
+
+        vbuf->b_len = len;
+    }
+
+    return 0;
+}
+
+/* Runs c0sk_get_merged_impl() on the calling thread's merge scratch.
+ */
+static merr_t
+c0sk_get_merged_tls(
+    struct c0sk *handle,
+    uint16_t skidx,
+    uint32_t pfx_len,
+    struct kvs_ktuple *kt,
+    uint64_t view_seq,
+    const struct kvs_buf *base,
+    enum key_lookup_res *res,
+    struct kvs_buf *vbuf)
+{
+    struct c0sk_mscratch ms = {
+        .ms_vbuf = c0sk_mvbuf_tls,
+        .ms_obuf = c0sk_mobuf_tls,
+        .ms_vinit = c0sk_mvbuf_tls,
+        .ms_oinit = c0sk_mobuf_tls,
+        .ms_vbufsz = sizeof(c0sk_mvbuf_tls),
+        .ms_obufsz = sizeof(c0sk_mobuf_tls),
+    };
+    merr_t err;
+
+    err = c0sk_get_merged_impl(
+        c0sk_h2r(handle), skidx, pfx_len, kt, view_seq, base, res, vbuf, &ms, NULL);
+
+    c0sk_mscratch_fini(&ms);
+
+    return err;
+}
+
+merr_t
+c0sk_get_merged(
+    struct c0sk *handle,
+    uint16_t skidx,
+    uint32_t pfx_len,
+    struct kvs_ktuple *kt,
+    uint64_t view_seq,
+    enum key_lookup_res *res,
+    struct kvs_buf *vbuf)
+{
+    return c0sk_get_merged_tls(handle, skidx, pfx_len, kt, view_seq, NULL, res, vbuf);
+}
+
+merr_t
+c0sk_get_merged_onto(
+    struct c0sk *handle,
+    uint16_t skidx,
+    uint32_t pfx_len,
+    struct kvs_ktuple *kt,
+    uint64_t view_seq,
+    const void *base,
+    uint32_t base_len,
+    enum key_lookup_res *res,
+    struct kvs_buf *vbuf)
+{
+    struct kvs_buf bbuf;
+
+    kvs_buf_init(&bbuf, (void *)base, base_len);
+    bbuf.b_len = base_len;
+
+    return c0sk_get_merged_tls(handle, skidx, pfx_len, kt, view_seq, &bbuf, res, vbuf);
+}
+
 merr_t
 c0sk_pfx_probe(
     struct c0sk *handle,
@@ -403,6 +793,13 @@ c0sk_pfx_probe(
             pfx_seq = HSE_SQNREF_TO_ORDNL(ptomb_seqref);
         }
 
+        c0kvs = c0kvms_ptomb_c0kvset_get(c0kvms);
+        err = c0kvs_rtombs_get(c0kvs, skidx, &qctx->rtombs);
+        if (ev(err))
+            break;
+
+        rtomb_vec_sort(&qctx->rtombs);
+
         err = c0kvms_pfx_probe_rcu(
             c0kvms, skidx, kt, view_seq, seqref, sfx_len, res, qctx, kbuf, vbuf, pfx_seq);
         if (ev(err))
@@ -1038,6 +1435,29 @@ c0sk_cursor_bind_txn(struct c0_cursor *cur, struct kvdb_ctxn *ctxn)
     cur->c0cur_ctxn = ctxn;
 }
 
+merr_t
+c0sk_cursor_rtombs(struct c0_cursor *cur, struct rtomb_vec *rv)
+{
+    merr_t err = 0;
+
+    rtomb_vec_reset(rv);
+
+    /* The cursor holds a ref on each kvms it iterates over, which keeps
+     * the rtomb keys valid until the next cursor update.
+     */
+    rcu_read_lock();
+    for (int i = 0; i < cur->c0cur_cnt && !err; i++) {
+        struct c0_kvmultiset *kvms = cur->c0cur_curv[i]->c0mc_kvms;
+
+        err = c0kvs_rtombs_get(c0kvms_ptomb_c0kvset_get(kvms), cur->c0cur_skidx, rv);
+    }
+    rcu_read_unlock();
+
+    rtomb_vec_sort(rv);
+
+    return err;
+}
+
 merr_t
 c0sk_cursor_destroy(struct c0_cursor *cur)
 {
@@ -1198,6 +1618,7 @@ c0sk_cursor_read(struct c0_cursor *cur, struct kvs_cursor_element *elem, bool *e
         key2kobj(&elem->kce_kobj, bkv->bkv_key, key_imm_klen(&bkv->bkv_key_imm));
 
         elem->kce_is_ptomb = false;
+        elem->kce_is_mopnd = false;
         elem->kce_complen = 0;
         elem->kce_seqnoref = val->bv_seqnoref;
 
@@ -1208,6 +1629,7 @@ c0sk_cursor_read(struct c0_cursor *cur, struct kvs_cursor_element *elem, bool *e
         } else {
             kvs_vtuple_init(&elem->kce_vt, val->bv_value, bonsai_val_ulen(val));
             elem->kce_complen = bonsai_val_clen(val);
+            elem->kce_is_mopnd = bonsai_val_is_mopnd(val);
         }
 
         *eof = false;
@@ -19,9 +19,13 @@
 #include <hse/ikvdb/kvdb_ctxn.h>
 #include <hse/ikvdb/kvdb_perfc.h>
 #include <hse/ikvdb/kvdb_rparams.h>
+#include <hse/ikvdb/kvs_cparams.h>
+#include <hse/ikvdb/kvs_wait.h>
 #include <hse/ikvdb/kvset_builder.h>
 #include <hse/ikvdb/lc.h>
+#include <hse/ikvdb/limits.h>
 #include <hse/ikvdb/rparam_debug_flags.h>
+#include <hse/ikvdb/rtomb.h>
 #include <hse/ikvdb/throttle.h>
 #include <hse/util/alloc.h>
 #include <hse/util/bkv_collection.h>
@@ -255,32 +259,78 @@ c0sk_bkv_sort_vals(struct bonsai_kv *bkv, struct bonsai_val **val_head)
     } while (unsorted > 0);
 }
 
-/**
- * c0sk_cningest_cb() - Callback function for bkv_collection. Called once for every pair of
- *                      key and its value list.
+/* Merge operands never reach cN: each operand is replaced by the value it
+ * resolves to at its seqno.  The kvms being ingested remains visible in c0
+ * until the ingest completes, so the lookup sees the operand itself along
+ * with everything older in c0, lc and cn.
  *
- * @rock:  Context - ingest worker object
- * @bkv:   Key
- * @vlist: List of values
+ * A key's operands are visited newest first.  The lookup for the newest one
+ * records the value at every older operand it applies (in c0iw_mres), so the
+ * rest of the run is served from those results without further lookups.  A
+ * new lookup is needed only when a value or tombstone splits the operands.
  */
 static merr_t
-c0sk_cningest_cb(void *rock, struct bonsai_kv *bkv, struct bonsai_val *vlist)
+c0sk_cningest_mopnd(
+    struct c0_ingest_work *ingest,
+    struct bonsai_kv *bkv,
+    struct kvset_builder *bldr,
+    const struct key_obj *ko,
+    uint64_t seqno)
 {
-    struct c0_ingest_work *ingest = rock;
-    struct bonsai_val *val;
-    merr_t err;
-    uint64_t seqno_prev, pt_seqno_prev;
-    struct key_obj ko;
+    struct c0sk_impl *c0sk = c0sk_h2r(ingest->c0iw_c0sk);
+    struct c0sk_mres *mres = &ingest->c0iw_mres;
+    uint32_t i;
 
-    uint16_t skidx = key_immediate_index(&bkv->bkv_key_imm);
+    for (i = mres->mr_cnt; i > 0 && mres->mr_entv[i - 1].me_seq > seqno; --i)
+        ;
+
+    if (i == 0 || mres->mr_entv[i - 1].me_seq != seqno) {
+        uint16_t skidx = key_immediate_index(&bkv->bkv_key_imm);
+        uint32_t klen = key_imm_klen(&bkv->bkv_key_imm);
+        struct cn *cn = c0sk->c0sk_cnv[skidx];
+        enum key_lookup_res res;
+        struct kvs_ktuple kt;
+        struct kvs_buf vbuf;
+        merr_t err;
+
+        kvs_ktuple_init_nohash(&kt, bkv->bkv_key, klen);
+        kt.kt_hash = key_hash64(kt.kt_data, klen - cn_get_rp(cn)->kvs_sfxlen);
+        kvs_buf_init(&vbuf, NULL, 0);
+
+        err = c0sk_get_merged_impl(
+            c0sk, skidx, cn_get_cparams(cn)->pfx_len, &kt, seqno, NULL, &res, &vbuf,
+            &ingest->c0iw_mscratch, mres);
+        if (ev(err))
+            return err;
+
+        assert(res == FOUND_VAL);
+        assert(mres->mr_cnt > 0 && mres->mr_entv[mres->mr_cnt - 1].me_seq == seqno);
+
+        i = mres->mr_cnt;
+    }
+
+    /* Results for this and newer operands are no longer needed. */
+    mres->mr_cnt = --i;
+
+    return kvset_builder_add_val(
+        bldr, ko, mres->mr_buf + mres->mr_entv[i].me_off, mres->mr_entv[i].me_len, seqno, 0);
+}
+
+/**
+ * c0sk_cningest_bldr_get() - Get the kvset builder for the given kvs, creating
+ *                            it on first use
+ *
+ * @ingest: ingest worker object
+ * @skidx:  kvs index
+ * @bldrp:  (output) kvset builder
+ */
+static merr_t
+c0sk_cningest_bldr_get(struct c0_ingest_work *ingest, uint16_t skidx, struct kvset_builder **bldrp)
+{
     struct c0sk_impl *c0sk = c0sk_h2r(ingest->c0iw_c0sk);
     struct cn *cn = c0sk->c0sk_cnv[skidx];
-    struct kvset_builder **kvbldrs = ingest->c0iw_bldrs;
-    struct kvset_builder *bldr = kvbldrs[skidx];
-    size_t klen, vlen;
-
-    assert(bkv);
-    assert(vlist);
+    struct kvset_builder *bldr = ingest->c0iw_bldrs[skidx];
+    merr_t err;
 
     if (!bldr) {
         assert(cn);
@@ -298,11 +348,87 @@ c0sk_cningest_cb(void *rock, struct bonsai_kv *bkv, struct bonsai_val *vlist)
             return err;
         }
 
-        kvbldrs[skidx] = bldr;
+        ingest->c0iw_bldrs[skidx] = bldr;
+    }
+
+    *bldrp = bldr;
+
+    return 0;
+}
+
+/**
+ * c0sk_cningest_rtombs() - Add the range tombstones of a kvms to the kvset
+ *                          builders of their respective kvs
+ *
+ * @ingest: ingest worker object
+ */
+static merr_t
+c0sk_cningest_rtombs(struct c0_ingest_work *ingest)
+{
+    struct c0_kvset *c0kvs = c0kvms_ptomb_c0kvset_get(ingest->c0iw_c0kvms);
+    struct c0sk_impl *c0sk = c0sk_h2r(ingest->c0iw_c0sk);
+    struct rtomb_vec rv;
+    merr_t err = 0;
+
+    rtomb_vec_init(&rv);
+
+    for (uint16_t skidx = 0; skidx < HSE_KVS_COUNT_MAX && !err; skidx++) {
+        struct kvset_builder *bldr;
+
+        if (!c0sk->c0sk_cnv[skidx])
+            continue;
+
+        rtomb_vec_reset(&rv);
+
+        err = c0kvs_rtombs_get(c0kvs, skidx, &rv);
+        if (err || rv.rv_cnt == 0)
+            continue;
+
+        err = c0sk_cningest_bldr_get(ingest, skidx, &bldr);
+        if (err)
+            break;
+
+        for (uint32_t i = 0; i < rv.rv_cnt && !err; i++)
+            err = kvset_builder_add_rtomb(bldr, rv.rv_rtv + i);
     }
 
+    rtomb_vec_fini(&rv);
+
+    return err;
+}
+
+/**
+ * c0sk_cningest_cb() - Callback function for bkv_collection. Called once for every pair of
+ *                      key and its value list.
+ *
+ * @rock:  Context - ingest worker object
+ * @bkv:   Key
+ * @vlist: List of values
+ */
+static merr_t
+c0sk_cningest_cb(void *rock, struct bonsai_kv *bkv, struct bonsai_val *vlist)
+{
+    struct c0_ingest_work *ingest = rock;
+    struct bonsai_val *val;
+    merr_t err;
+    uint64_t seqno_prev, pt_seqno_prev;
+    struct key_obj ko;
+
+    uint16_t skidx = key_immediate_index(&bkv->bkv_key_imm);
+    struct c0sk_impl *c0sk = c0sk_h2r(ingest->c0iw_c0sk);
+    struct kvset_builder *bldr;
+    size_t klen, vlen;
+
+    assert(bkv);
+    assert(vlist);
+
+    err = c0sk_cningest_bldr_get(ingest, skidx, &bldr);
+    if (ev(err))
+        return err;
+
     c0sk_bkv_sort_vals(bkv, &vlist);
 
+    ingest->c0iw_mres.mr_cnt = 0;
     seqno_prev = UINT64_MAX;
     pt_seqno_prev = UINT64_MAX;
     klen = key_imm_klen(&bkv->bkv_key_imm);
@@ -331,8 +457,11 @@ c0sk_cningest_cb(void *rock, struct bonsai_kv *bkv, struct bonsai_val *vlist)
 
         vlen += bonsai_val_vlen(val);
 
-        err = kvset_builder_add_val(
-            bldr, &ko, val->bv_value, bonsai_val_ulen(val), seqno, bonsai_val_clen(val));
+        if (bonsai_val_is_mopnd(val))
+            err = c0sk_cningest_mopnd(ingest, bkv, bldr, &ko, seqno);
+        else
+            err = kvset_builder_add_val(
+                bldr, &ko, val->bv_value, bonsai_val_ulen(val), seqno, bonsai_val_clen(val));
 
         if (ev(err))
             return err;
@@ -417,10 +546,43 @@ c0sk_cningest_walcb(
     c0sk->c0sk_cb->kc_cningest_cb(ikvdb, seqno, gen, txhorizon, post_ingest);
 }
 
+/* c0sk_lc_spill() - flush the active kvms early if LC is waiting on it
+ *
+ * LC can only release a committed txn's values once the kvms holding the txn's
+ * last put has been ingested. When LC is over its memory bound and that kvms is
+ * still the active one, queue it for ingest now rather than waiting for it to
+ * fill up. Values of uncommitted txns cannot be spilled and remain in LC.
+ */
+static void
+c0sk_lc_spill(struct c0sk_impl *self, uint64_t spill_gen)
+{
+    struct c0_kvmultiset *first;
+    uint64_t first_gen = UINT64_MAX;
+
+    if (self->c0sk_closing)
+        return;
+
+    rcu_read_lock();
+    first = c0sk_get_first_c0kvms(&self->c0sk_handle);
+    if (first)
+        first_gen = c0kvms_gen_read(first);
+    rcu_read_unlock();
+
+    if (spill_gen < first_gen)
+        return; /* an ingest of that kvms is already queued */
+
+    ev(c0sk_flush_current_multiset(self, NULL, false));
+}
+
 /* Initial number of entries in cn ingest's bkv_collection.
  */
 #define CN_INGEST_BKV_CNT (4UL << 20)
 
+/* c0sk_merge_loop() - route the values from minheap to either cn_list or lc_list
+ *
+ * %spill_genp is set to the largest kvms gen that holds the tail of a committed txn
+ * whose values were kept in LC only because that tail is not part of this ingest.
+ */
 static merr_t
 c0sk_merge_loop(
     struct bin_heap *minheap,
@@ -428,7 +590,8 @@ c0sk_merge_loop(
     uint64_t max_seqno,
     uint64_t kvms_gen,
     struct bkv_collection *cn_list,
-    struct lc_builder *lc_list)
+    struct lc_builder *lc_list,
+    uint64_t *spill_genp)
 {
     struct bonsai_kv *bkv, *bkv_prev;
     struct bonsai_val *cn_val_head, *lc_val_head;
@@ -487,6 +650,7 @@ c0sk_merge_loop(
             bool seqno_in_view;
             bool all_txn_entries;
             uint64_t seqno = 0;
+            uint64_t cgen = 0;
 
             state = seqnoref_to_seqno(val->bv_seqnoref, &seqno);
             assert(seqno < UINT64_MAX);
@@ -503,8 +667,17 @@ c0sk_merge_loop(
             }
 
             seqno_in_view = state == HSE_SQNREF_STATE_DEFINED && seqno <= max_seqno;
-            all_txn_entries = HSE_SQNREF_INDIRECT_P(val->bv_seqnoref) &&
-                kvms_gen >= c0snr_get_cgen((uintptr_t *)val->bv_seqnoref);
+            if (HSE_SQNREF_INDIRECT_P(val->bv_seqnoref))
+                cgen = c0snr_get_cgen((uintptr_t *)val->bv_seqnoref);
+            all_txn_entries = HSE_SQNREF_INDIRECT_P(val->bv_seqnoref) && kvms_gen >= cgen;
+
+            /* A committed txn whose tail lives in a newer kvms stays in LC until that kvms
+             * is ingested. Remember the newest such kvms so that the caller can flush it
+             * early when LC is over its memory bound.
+             */
+            if (seqno_in_view && HSE_SQNREF_INDIRECT_P(val->bv_seqnoref) && !all_txn_entries &&
+                cgen > *spill_genp)
+                *spill_genp = cgen;
 
             /* In addition to being within this ingest's view, a kv-tuple must also satisfy one of
              * the following criteria to be eligible for ingest to cn:
@@ -597,6 +770,7 @@ c0sk_ingest_worker(struct work_struct *work)
     struct lc_builder *lc_list = { 0 };
     uint64_t kvms_gen = c0kvms_gen_read(kvms);
     uint64_t txhorizon = c0kvms_txhorizon_get(kvms);
+    uint64_t spill_gen = 0;
     int i;
     uint64_t go = 0;
     bool debug = c0sk->c0sk_kvdb_rp->c0_debug & C0_DEBUG_INGSPILL;
@@ -652,7 +826,8 @@ c0sk_ingest_worker(struct work_struct *work)
      */
     kvdb_ctxn_set_wait_commits(c0sk->c0sk_ctxn_set, 0);
 
-    err = c0sk_merge_loop(kvms_minheap, min_seq, max_seq, kvms_gen, cn_list[0], lc_list);
+    err = c0sk_merge_loop(
+        kvms_minheap, min_seq, max_seq, kvms_gen, cn_list[0], lc_list, &spill_gen);
     if (ev(err))
         goto health_err;
 
@@ -685,7 +860,8 @@ c0sk_ingest_worker(struct work_struct *work)
      */
     err = bin_heap_prepare(lc_minheap, ingest->c0iw_lc_iterc, ingest->c0iw_lc_sourcev);
     if (!err) {
-        err = c0sk_merge_loop(lc_minheap, min_seq, max_seq, kvms_gen, cn_list[1], NULL);
+        err = c0sk_merge_loop(
+            lc_minheap, min_seq, max_seq, kvms_gen, cn_list[1], NULL, &spill_gen);
         if (!err) {
             ingest->t5 = get_time_ns();
 
@@ -723,6 +899,10 @@ c0sk_ingest_worker(struct work_struct *work)
     if (ev(err))
         goto health_err;
 
+    err = c0sk_cningest_rtombs(ingest);
+    if (ev(err))
+        goto health_err;
+
     /* Prevent any other thread from accessing this thread's local storage via c0iw_thr_tls.
      */
     ingest->c0iw_thr_tls = NULL;
@@ -808,9 +988,13 @@ exit_err:
         const uint new = (get_time_ns() - ingest->c0iw_tenqueued) / 1000000;
         uint old;
 
-        if (atomic_read(&c0sk->c0sk_replaying) == 0)
+        if (atomic_read(&c0sk->c0sk_replaying) == 0) {
             lc_ingest_seqno_set(lc, max_seq);
 
+            if (spill_gen > 0 && lc_mem_exceeded(lc))
+                c0sk_lc_spill(c0sk, spill_gen);
+        }
+
         /* Update the running average finish latency (i.e., the time
          * taken to ingest the kvms) for use in adjusting the throttle.
          */
@@ -1246,6 +1430,7 @@ c0sk_putdel(
     uintptr_t *priv = (uintptr_t *)seqnoref;
     bool is_txn = (!HSE_SQNREF_SINGLE_P(seqnoref) && !HSE_SQNREF_ORDNL_P(seqnoref));
     uint64_t dst_gen = 0;
+    uint64_t wstart = 0;
     merr_t err;
 
     while (1) {
@@ -1296,8 +1481,20 @@ c0sk_putdel(
 
         if (op == C0SK_OP_PUT) {
             err = c0kvs_put(kvs, skidx, kt, vt, seqnoref);
+        } else if (op == C0SK_OP_MERGE) {
+            const struct kvs_cparams *cp = cn_get_cparams(self->c0sk_cnv[skidx]);
+
+            err = c0kvs_merge(kvs, skidx, kt, vt, seqnoref, cp->merge_op);
         } else if (op == C0SK_OP_DEL) {
             err = c0kvs_del(kvs, skidx, kt, seqnoref);
+        } else if (op == C0SK_OP_RANGE_DEL) {
+            struct kvs_ktuple end;
+
+            /* The end of the range travels in the value slot. */
+            kvs_ktuple_init_nohash(&end, vt->vt_data, kvs_vtuple_vlen(vt));
+
+            kvs = c0kvms_ptomb_c0kvset_get(dst);
+            err = c0kvs_range_del(kvs, skidx, kt, &end, seqnoref);
         } else {
             assert(op == C0SK_OP_PREFIX_DEL);
 
@@ -1333,10 +1530,18 @@ c0sk_putdel(
         if (merr_errno(err) != ENOMEM)
             break;
 
+        /* The active kvms is full, account the time until it has been
+         * swapped out from under us to the caller's KVS.
+         */
+        if (!wstart)
+            wstart = kvs_wait_start();
+
         c0sk_queue_ingest(self, dst);
         c0kvms_putref(dst);
     }
 
+    kvs_wait_record(PERFC_LT_KVSWAIT_C0FULL, wstart);
+
     kt->kt_dgen = dst_gen;
 
     return err;
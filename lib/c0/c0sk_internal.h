@@ -194,6 +194,8 @@ enum c0sk_op {
     C0SK_OP_PUT,
     C0SK_OP_DEL,
     C0SK_OP_PREFIX_DEL,
+    C0SK_OP_MERGE,
+    C0SK_OP_RANGE_DEL,
 };
 
 /**
@@ -225,6 +227,86 @@ c0sk_putdel(
 struct cn *
 c0sk_get_cn(struct c0sk_impl *c0sk, uint64_t skidx);
 
+/**
+ * struct c0sk_mres - values of a key at each of its merge operands
+ * @mr_entv:  (seqno, offset, length) of each result, oldest operand first
+ * @mr_buf:   result values
+ * @mr_cnt:   number of valid entries in @mr_entv
+ * @mr_max:   capacity of @mr_entv
+ * @mr_len:   bytes used in @mr_buf
+ * @mr_bufsz: capacity of @mr_buf
+ *
+ * Filled in by c0sk_get_merged_impl() so that c0 ingest can resolve all of
+ * a key's operands with a single lookup.  The buffers are retained across
+ * lookups and are freed by the owner.
+ */
+struct c0sk_mres {
+    struct {
+        uint64_t me_seq;
+        size_t me_off;
+        uint32_t me_len;
+    } *mr_entv;
+    char *mr_buf;
+    uint32_t mr_cnt;
+    uint32_t mr_max;
+    size_t mr_len;
+    size_t mr_bufsz;
+};
+
+/**
+ * struct c0sk_mscratch - reusable buffers for c0sk_get_merged_impl()
+ * @ms_vbuf:   base value, folded in place as operands are applied
+ * @ms_obuf:   operands collected while walking back through the key
+ * @ms_vinit:  initial @ms_vbuf not owned by the scratch (or NULL)
+ * @ms_oinit:  initial @ms_obuf not owned by the scratch (or NULL)
+ * @ms_vbufsz: capacity of @ms_vbuf
+ * @ms_obufsz: capacity of @ms_obuf
+ *
+ * The buffers grow on demand and are retained across lookups, so a lookup
+ * allocates only when a key's history outgrows every lookup before it.
+ * Buffers other than @ms_vinit and @ms_oinit are freed by c0sk_mscratch_fini().
+ */
+struct c0sk_mscratch {
+    char *ms_vbuf;
+    char *ms_obuf;
+    char *ms_vinit;
+    char *ms_oinit;
+    size_t ms_vbufsz;
+    size_t ms_obufsz;
+};
+
+/**
+ * c0sk_mscratch_fini() - Free the buffers grown by a merge scratch
+ * @ms: merge scratch
+ *
+ * Leaves @ms reset to its initial buffers, ready for reuse.
+ */
+void
+c0sk_mscratch_fini(struct c0sk_mscratch *ms);
+
+/**
+ * c0sk_get_merged_impl() - c0sk_get_merged() with optional per-operand results
+ * @base: if not NULL, the value below c0 to which the operands are applied
+ *        (see c0sk_get_merged_onto()), otherwise lc and cn are searched
+ * @ms:   scratch buffers for the lookup
+ * @mres: if not NULL, reset and then filled with the value of the key at
+ *        each operand applied (see struct c0sk_mres)
+ *
+ * See c0sk_get_merged() for the remaining parameters.
+ */
+merr_t
+c0sk_get_merged_impl(
+    struct c0sk_impl *self,
+    uint16_t skidx,
+    uint32_t pfx_len,
+    struct kvs_ktuple *kt,
+    uint64_t view_seq,
+    const struct kvs_buf *base,
+    enum key_lookup_res *res,
+    struct kvs_buf *vbuf,
+    struct c0sk_mscratch *ms,
+    struct c0sk_mres *mres);
+
 #if HSE_MOCKING
 #include "c0sk_internal_ut.h"
 #endif
@@ -218,6 +218,7 @@ cn_get_perfc(struct cn *cn, enum cn_action action)
         return &cn->cn_pc_kcompact;
 
     case CN_ACTION_COMPACT_KV:
+    case CN_ACTION_MIGRATE:
         return &cn->cn_pc_kvcompact;
 
     case CN_ACTION_ZSPILL:
@@ -364,6 +365,25 @@ cn_pfx_probe(
     return cn_tree_prefix_probe(cn->cn_tree, &cn->cn_pc_get, kt, seq, res, qctx, kbuf, vbuf);
 }
 
+/* The leading vblocks of a k-compact output are adopted from its inputs
+ * and are not committed or deleted with it.  Only the vblocks which follow
+ * them, holding values relocated out of sparse inputs, belong to it.
+ */
+static struct blk_list
+cn_mblocks_vblks(const struct kvset_mblocks *mblks, bool kcompact)
+{
+    struct blk_list vblks = mblks->vblks;
+
+    if (kcompact) {
+        uint32_t adopted = min_t(uint32_t, mblks->bl_vadopted, vblks.idc);
+
+        vblks.idv += adopted;
+        vblks.idc -= adopted;
+    }
+
+    return vblks;
+}
+
 merr_t
 cn_mblocks_commit(
     struct mpool *mp,
@@ -375,6 +395,8 @@ cn_mblocks_commit(
     uint32_t i;
 
     for (i = 0; i < num_lists; i++) {
+        struct blk_list vblks = cn_mblocks_vblks(&list[i], mutation == CN_MUT_KCOMPACT);
+
         /* This check is similar to the check in commit_mblocks() where the
          * bounds on the for loop uses the block count of the block list. Here
          * we always have at least 1 hblock to validate, and we do that by
@@ -392,11 +414,9 @@ cn_mblocks_commit(
         if (ev(err))
             return err;
 
-        if (mutation != CN_MUT_KCOMPACT) {
-            err = commit_mblocks(mp, &list[i].vblks);
-            if (ev(err))
-                return err;
-        }
+        err = commit_mblocks(mp, &vblks);
+        if (ev(err))
+            return err;
     }
 
     return 0;
@@ -406,12 +426,13 @@ void
 cn_mblocks_destroy(struct mpool *mp, uint32_t num_lists, struct kvset_mblocks *list, bool kcompact)
 {
     for (uint32_t i = 0; i < num_lists; i++) {
+        struct blk_list vblks = cn_mblocks_vblks(&list[i], kcompact);
+
         delete_mblock(mp, list[i].hblk_id);
         list[i].hblk_id = 0;
 
         delete_mblocks(mp, &list[i].kblks);
-        if (!kcompact)
-            delete_mblocks(mp, &list[i].vblks);
+        delete_mblocks(mp, &vblks);
     }
 }
 
@@ -752,10 +773,31 @@ cn_maint_task(struct work_struct *work)
         cn->cn_maint_wq, &cn->cn_maint_dwork, msecs_to_jiffies(cn->rp->cn_maint_delay));
 }
 
+/**
+ * struct cn_kvset_open - one kvset to be opened by cndb_cn_ctx_open()
+ * @ko_work:    work struct for the open workqueue
+ * @ko_tree:    tree the kvset belongs to
+ * @ko_km:      kvset metadata, owns its kblock and vblock lists
+ * @ko_kvsetid: kvset ID
+ * @ko_kvset:   opened kvset (output)
+ * @ko_err:     kvset_open() status (output)
+ */
+struct cn_kvset_open {
+    struct work_struct ko_work;
+    struct cn_tree *ko_tree;
+    struct kvset_meta ko_km;
+    uint64_t ko_kvsetid;
+    struct kvset *ko_kvset;
+    merr_t ko_err;
+};
+
 struct cndb_cn_ctx {
     struct cn_tree *tree;
     struct map *nodemap;
     uint64_t max_dgen;
+    struct cn_kvset_open *openv;
+    uint32_t openc;
+    uint32_t openmax;
 };
 
 static merr_t
@@ -782,6 +824,9 @@ cndb_cn_ctx_init(struct cndb_cn_ctx *ctx, struct cn_tree *tree, struct cn_tree_n
     ctx->nodemap = nodemap;
     ctx->tree = tree;
     ctx->max_dgen = 0;
+    ctx->openv = NULL;
+    ctx->openc = 0;
+    ctx->openmax = 0;
 
     return 0;
 }
@@ -792,51 +837,212 @@ cndb_cn_ctx_fini(struct cndb_cn_ctx *ctx)
     INVARIANT(ctx);
     INVARIANT(ctx->nodemap);
 
+    for (uint32_t i = 0; i < ctx->openc; i++) {
+        blk_list_free(&ctx->openv[i].ko_km.km_kblk_list);
+        blk_list_free(&ctx->openv[i].ko_km.km_vblk_list);
+    }
+
+    free(ctx->openv);
     map_destroy(ctx->nodemap);
 }
 
 /*
- * Callback invoked by cndb_cn_instantiate() to place kvsets into tree nodes.
+ * Callback invoked by cndb_cn_instantiate() to collect the kvsets of a KVS.
  *
  * This callback is invoked once for each kvset in a KVS.  Each callback
  * contains a node ID, a kvset ID, and other metadata needed to open the
- * on-media kvset.  It opens the kvsets and adds them to tree nodes, creating
- * the tree nodes as needed.
+ * on-media kvset.  The kvsets are opened afterward by cndb_cn_ctx_open().
  */
 static merr_t
 cndb_cn_callback(void *arg, struct kvset_meta *km, uint64_t kvsetid)
 {
     struct cndb_cn_ctx *ctx = arg;
-    struct cn_tree_node *node;
-    struct kvset *kvset;
-    merr_t err;
+    struct cn_kvset_open *ko;
+
+    if (ctx->openc == ctx->openmax) {
+        uint32_t max = ctx->openmax ? ctx->openmax * 2 : 64;
 
-    node = map_lookup_ptr(ctx->nodemap, km->km_nodeid);
-    if (!node) {
-        node = cn_node_alloc(ctx->tree, km->km_nodeid);
-        if (ev(!node))
+        ko = realloc(ctx->openv, max * sizeof(*ko));
+        if (ev(!ko))
             return merr(ENOMEM);
 
-        map_insert_ptr(ctx->nodemap, km->km_nodeid, node);
+        ctx->openv = ko;
+        ctx->openmax = max;
+    }
+
+    ko = ctx->openv + ctx->openc++;
+    memset(ko, 0, sizeof(*ko));
 
-        list_add_tail(&node->tn_link, &ctx->tree->ct_nodes);
-        ctx->tree->ct_fanout++;
+    ko->ko_tree = ctx->tree;
+    ko->ko_kvsetid = kvsetid;
+
+    /* Take ownership of the block lists, leaving empty lists for
+     * cndb_cn_instantiate() to free.
+     */
+    ko->ko_km = *km;
+    blk_list_init(&km->km_kblk_list);
+    blk_list_init(&km->km_vblk_list);
+
+    return 0;
+}
+
+static void
+cndb_cn_open_cb(struct work_struct *work)
+{
+    struct cn_kvset_open *ko = container_of(work, struct cn_kvset_open, ko_work);
+
+    ko->ko_err = kvset_open(ko->ko_tree, ko->ko_kvsetid, &ko->ko_km, &ko->ko_kvset);
+}
+
+/**
+ * cndb_cn_ctx_open() - open the collected kvsets and add them to tree nodes
+ * @ctx: context filled in by cndb_cn_callback()
+ * @wq:  workqueue on which to open the kvsets, or NULL to open them inline
+ *
+ * The kvsets are opened concurrently, but are added to the tree serially
+ * and in cndb order once all the opens have finished, creating the tree
+ * nodes as needed.  If any open fails, every kvset that was opened is
+ * released and none are added to the tree.  Kvsets added before a later
+ * insert failure are released when the tree is destroyed.
+ */
+static merr_t
+cndb_cn_ctx_open(struct cndb_cn_ctx *ctx, struct workqueue_struct *wq)
+{
+    merr_t err = 0;
+
+    for (uint32_t i = 0; i < ctx->openc; i++) {
+        struct cn_kvset_open *ko = ctx->openv + i;
+
+        INIT_WORK(&ko->ko_work, cndb_cn_open_cb);
+
+        if (!wq || !queue_work(wq, &ko->ko_work))
+            cndb_cn_open_cb(&ko->ko_work);
     }
 
-    err = kvset_open(ctx->tree, kvsetid, km, &kvset);
-    if (ev(err))
-        return err;
+    if (wq)
+        flush_workqueue(wq);
+
+    /* Check all the opens before inserting any kvset so that a failure
+     * leaves the tree untouched.
+     */
+    for (uint32_t i = 0; i < ctx->openc && !err; i++)
+        err = ctx->openv[i].ko_err;
 
-    err = cn_node_insert_kvset(node, kvset);
     if (ev(err)) {
-        kvset_put_ref(kvset);
+        for (uint32_t i = 0; i < ctx->openc; i++) {
+            if (!ctx->openv[i].ko_err)
+                kvset_put_ref(ctx->openv[i].ko_kvset);
+        }
+
         return err;
     }
 
-    if (ctx->max_dgen < km->km_dgen_hi)
-        ctx->max_dgen = km->km_dgen_hi;
+    for (uint32_t i = 0; i < ctx->openc; i++) {
+        struct cn_kvset_open *ko = ctx->openv + i;
+        struct kvset_meta *km = &ko->ko_km;
+        struct cn_tree_node *node;
 
-    return 0;
+        if (err) {
+            kvset_put_ref(ko->ko_kvset);
+            continue;
+        }
+
+        node = map_lookup_ptr(ctx->nodemap, km->km_nodeid);
+        if (!node) {
+            node = cn_node_alloc(ctx->tree, km->km_nodeid);
+            if (ev(!node)) {
+                kvset_put_ref(ko->ko_kvset);
+                err = merr(ENOMEM);
+                continue;
+            }
+
+            map_insert_ptr(ctx->nodemap, km->km_nodeid, node);
+
+            list_add_tail(&node->tn_link, &ctx->tree->ct_nodes);
+            ctx->tree->ct_fanout++;
+        }
+
+        err = cn_node_insert_kvset(node, ko->ko_kvset);
+        if (ev(err)) {
+            kvset_put_ref(ko->ko_kvset);
+            continue;
+        }
+
+        if (ctx->max_dgen < km->km_dgen_hi)
+            ctx->max_dgen = km->km_dgen_hi;
+    }
+
+    return err;
+}
+
+/**
+ * struct cn_kvset_preload - deferred wbtree and bloom preload and hpcache load
+ * @kp_work:    cn work struct
+ * @kp_kvsetc:  number of kvsets in @kp_kvsetv
+ * @kp_kvsetv:  kvsets to preload, each holding a ref
+ */
+struct cn_kvset_preload {
+    struct cn_work kp_work;
+    uint32_t kp_kvsetc;
+    struct kvset *kp_kvsetv[];
+};
+
+static void
+cn_kvset_preload_cb(struct cn_work *work)
+{
+    struct cn_kvset_preload *kp = container_of(work, struct cn_kvset_preload, kp_work);
+    struct cn *cn = work->cnw_cnref;
+
+    for (uint32_t i = 0; i < kp->kp_kvsetc; i++) {
+        if (!atomic_read(&cn->cn_maint_cancel))
+            kvset_preload(kp->kp_kvsetv[i]);
+
+        kvset_put_ref(kp->kp_kvsetv[i]);
+    }
+
+    free(kp);
+}
+
+/* Preload the kblocks of all the kvsets opened by cn_open() on the maint
+ * workqueue so that opening a large KVS doesn't wait on readahead or on
+ * copying kblock indexes into the hpcache (the preload runs inline if
+ * maintenance is disabled).  Must be called before
+ * the tree is visible to compaction.
+ */
+static void
+cn_kvset_preload_submit(struct cn *cn)
+{
+    struct cn_kvset_preload *kp;
+    struct kvset_list_entry *le;
+    struct cn_tree_node *tn;
+    uint32_t kvsetc = 0;
+
+    if (!cn->rp->cn_mcache_wbt && !cn->rp->cn_bloom_preload &&
+        !(cn->cn_kvdb && cn->cn_kvdb->cn_hpcache))
+        return;
+
+    cn_tree_foreach_node(tn, cn->cn_tree) {
+        list_for_each_entry(le, &tn->tn_kvset_list, le_link)
+            ++kvsetc;
+    }
+
+    if (!kvsetc)
+        return;
+
+    kp = malloc(sizeof(*kp) + kvsetc * sizeof(kp->kp_kvsetv[0]));
+    if (ev(!kp))
+        return;
+
+    kp->kp_kvsetc = 0;
+
+    cn_tree_foreach_node(tn, cn->cn_tree) {
+        list_for_each_entry(le, &tn->tn_kvset_list, le_link) {
+            kvset_get_ref(le->le_kvset);
+            kp->kp_kvsetv[kp->kp_kvsetc++] = le->le_kvset;
+        }
+    }
+
+    cn_work_submit(cn, cn_kvset_preload_cb, &kp->kp_work);
 }
 
 static enum rest_status
@@ -1007,6 +1213,8 @@ cn_open(
         goto err_exit;
 
     err = cndb_cn_instantiate(cndb, cnid, &ctx, cndb_cn_callback);
+    if (!err)
+        err = cndb_cn_ctx_open(&ctx, cn_kvdb->cn_open_wq);
     atomic_set(&cn->cn_ingest_dgen, ctx.max_dgen);
     cndb_cn_ctx_fini(&ctx);
     if (ev(err))
@@ -1143,6 +1351,8 @@ cn_open(
         cn->cn_maint_wq = cn_kvdb->cn_maint_wq;
         cn->cn_io_wq = cn_kvdb->cn_io_wq;
 
+        cn_kvset_preload_submit(cn);
+
         if (cn_is_capped(cn)) {
             cn->cn_maint_running = true;
 
@@ -1163,6 +1373,8 @@ cn_open(
 
             csched_tree_add(cn->csched, cn->cn_tree);
         }
+    } else {
+        cn_kvset_preload_submit(cn);
     }
 
     if (hse_gparams.gp_rest.enabled) {
@@ -1393,6 +1605,12 @@ cn_cursor_update(struct cn_cursor *cur, uint64_t seqno, bool *updated)
     return err;
 }
 
+void
+cn_cursor_invalidate(struct cn_cursor *cur)
+{
+    cur->cncur_dgen = 0;
+}
+
 merr_t
 cn_cursor_seek(struct cn_cursor *cursor, const void *key, uint32_t len, struct kc_filter *filter)
 {
@@ -1434,6 +1652,24 @@ cn_cursor_es_get(struct cn_cursor *cncur)
     return &cncur->cncur_es;
 }
 
+struct kvset *
+cn_cursor_elem_pin(struct cn_cursor *cncur)
+{
+    struct kvset *ks = cncur->cncur_elem_ks;
+
+    if (ks)
+        kvset_get_ref(ks);
+
+    return ks;
+}
+
+void
+cn_cursor_elem_unpin(struct kvset *ks)
+{
+    if (ks)
+        kvset_put_ref(ks);
+}
+
 void
 cn_cursor_destroy(struct cn_cursor *cur)
 {
@@ -12,6 +12,7 @@
 
 #include <hse/error/merr.h>
 #include <hse/ikvdb/cursor.h>
+#include <hse/ikvdb/rtomb.h>
 #include <hse/util/bin_heap.h>
 #include <hse/util/table.h>
 
@@ -42,8 +43,17 @@ struct cn_level_cursor {
     struct cn_cursor *cnlc_cncur;
     uint64_t cnlc_dgen_hi;
     uint64_t cnlc_dgen_lo;
+    struct rtomb_vec cnlc_rtombs;
     bool cnlc_islast;
 
+    /* Iterators and kvset refs set aside by a cursor update or seek so
+     * that cn_lcur_init() can reuse the iterators of unchanged kvsets.
+     */
+    struct table *cnlc_stash_tab;
+    struct element_source **cnlc_stash_esrcv;
+    size_t cnlc_stash_esrcc;
+    uint32_t cnlc_stash_iterc;
+
     uint cnlc_next_eklen;
     unsigned char cnlc_next_ekey[HSE_KVS_KEY_LEN_MAX];
 };
@@ -70,6 +80,7 @@ struct cn_level_cursor {
  * @cncur_filter:
  * @cncur_pt_kobj:     ptomb key obj (key in kblk OR pt_buf[] right after cur update)
  * @cncur_pt_seq:      ptomb's seqno
+ * @cncur_elem_ks:     kvset that backs the key and value in cncur_elem
  */
 struct cn_cursor {
     struct element_source cncur_es;
@@ -91,6 +102,7 @@ struct cn_cursor {
     enum kvset_iter_flags cncur_flags;
 
     struct kvs_cursor_element cncur_elem;
+    struct kvset *cncur_elem_ks;
 
     /* bitflags */
     uint32_t cncur_reverse : 1;
@@ -121,6 +133,17 @@ cn_cursor_create(
 merr_t
 cn_cursor_update(struct cn_cursor *cursor, uint64_t seqno, bool *updated);
 
+/**
+ * cn_cursor_invalidate() - force the next update to re-collect all kvsets
+ * @cursor: cn cursor
+ *
+ * Kvsets that cannot hold the cursor's prefix are skipped when they are
+ * collected, so this must be called whenever the prefix buffer given to
+ * cn_cursor_create() is rewritten with a different prefix.
+ */
+void
+cn_cursor_invalidate(struct cn_cursor *cursor);
+
 /* MTF_MOCK */
 merr_t
 cn_cursor_seek(
@@ -149,6 +172,22 @@ cn_cursor_es_make(struct cn_cursor *cncur);
 struct element_source *
 cn_cursor_es_get(struct cn_cursor *cncur);
 
+/**
+ * cn_cursor_elem_pin() - pin the kvset backing the cursor's current element
+ * @cncur: cn cursor
+ *
+ * The returned kvset (if not NULL) keeps the key and value pointers of the
+ * current element valid after the cursor has advanced, until it is passed
+ * to cn_cursor_elem_unpin().
+ */
+/* MTF_MOCK */
+struct kvset *
+cn_cursor_elem_pin(struct cn_cursor *cncur);
+
+/* MTF_MOCK */
+void
+cn_cursor_elem_unpin(struct kvset *ks);
+
 #if HSE_MOCKING
 #include "cn_cursor_ut.h"
 #endif /* HSE_MOCKING */
@@ -12,10 +12,18 @@
 #include <hse/util/event_counter.h>
 #include <hse/util/slab.h>
 
+#include "hpcache.h"
+
 merr_t
-cn_kvdb_create(uint cn_maint_threads, uint cn_io_threads, struct cn_kvdb **out)
+cn_kvdb_create(
+    uint cn_maint_threads,
+    uint cn_io_threads,
+    uint cn_open_threads,
+    size_t hpcache_sz,
+    struct cn_kvdb **out)
 {
     struct cn_kvdb *self;
+    merr_t err;
 
     self = calloc(1, sizeof(*self));
     if (ev(!self))
@@ -34,6 +42,26 @@ cn_kvdb_create(uint cn_maint_threads, uint cn_io_threads, struct cn_kvdb **out)
         return merr(ENOMEM);
     }
 
+    /* Kvset opens are mostly mmap() and header reads, so cn_open() fans
+     * them out over this queue.  It idles once all the kvses are open.
+     */
+    self->cn_open_wq = alloc_workqueue("hse_cn_open", 0, 1, cn_open_threads);
+    if (ev(!self->cn_open_wq)) {
+        destroy_workqueue(self->cn_io_wq);
+        destroy_workqueue(self->cn_maint_wq);
+        free(self);
+        return merr(ENOMEM);
+    }
+
+    err = hpcache_create(hpcache_sz, &self->cn_hpcache);
+    if (ev(err)) {
+        destroy_workqueue(self->cn_open_wq);
+        destroy_workqueue(self->cn_io_wq);
+        destroy_workqueue(self->cn_maint_wq);
+        free(self);
+        return err;
+    }
+
     *out = self;
 
     return 0;
@@ -45,6 +73,8 @@ cn_kvdb_destroy(struct cn_kvdb *h)
     if (h) {
         destroy_workqueue(h->cn_maint_wq);
         destroy_workqueue(h->cn_io_wq);
+        destroy_workqueue(h->cn_open_wq);
+        hpcache_destroy(h->cn_hpcache);
         free(h);
     }
 }
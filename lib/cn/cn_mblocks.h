@@ -48,6 +48,8 @@ cn_mb_est_alen(size_t max_captgt, size_t alloc_unit, size_t payload, unsigned in
  * @num_lists:
  * @list:
  * @mutation:
+ *      If CN_MUT_KCOMPACT, the first bl_vadopted vblocks of each list
+ *      belong to the input kvsets and are not committed.
  * @vcommitted:
  *      Ignored if the mutation is CN_MUT_KCOMPACT
  *      Else, number of vblocks already committed.
@@ -63,6 +65,9 @@ cn_mblocks_commit(
     struct kvset_mblocks *list,
     enum cn_mutation mutation);
 
+/* As with cn_mblocks_commit(), a k-compact output's adopted vblocks are
+ * left alone.
+ */
 /* MTF_MOCK */
 void
 cn_mblocks_destroy(struct mpool *ds, uint32_t num_lists, struct kvset_mblocks *list, bool kcompact);
@@ -7,6 +7,7 @@
 #define HSE_KVDB_CN_METRICS_H
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 #include <sys/types.h>
@@ -70,6 +71,16 @@ kvset_vgarb(const struct kvset_stats *kst)
     return kst->kst_vgarb;
 }
 
+/**
+ * True if at least pct percent of a kvset's vblocks is garbage, in which
+ * case a k-compaction copies its live values rather than keep its vblocks.
+ */
+static inline bool
+kvset_vreloc(const struct kvset_stats *kst, uint pct)
+{
+    return pct > 0 && kst->kst_vgarb > 0 && kst->kst_vgarb * 100 >= kst->kst_vwlen * pct;
+}
+
 /**
  * Node metrics used by compaction scheduler
  */
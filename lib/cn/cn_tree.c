@@ -28,7 +28,9 @@
 #include <hse/ikvdb/key_hash.h>
 #include <hse/ikvdb/kvdb_health.h>
 #include <hse/ikvdb/kvs_rparams.h>
+#include <hse/ikvdb/kvset_builder.h>
 #include <hse/ikvdb/limits.h>
+#include <hse/ikvdb/rtomb.h>
 #include <hse/ikvdb/sched_sts.h>
 #include <hse/logging/logging.h>
 #include <hse/mpool/mpool.h>
@@ -67,6 +69,7 @@
 #include "kvcompact.h"
 #include "kvset.h"
 #include "kvset_internal.h"
+#include "mbset.h"
 #include "move.h"
 #include "node_split.h"
 #include "route.h"
@@ -204,6 +207,7 @@ cn_tree_create(
     cv_init(&tree->ct_ss_cv);
     tree->ct_rspill_dt = 1;
     atomic_set(&tree->ct_split_cnt, 0);
+    atomic_set(&tree->ct_fg_reads, 0);
     tree->ct_kvdb_health = health;
 
     tree->ct_root = cn_node_alloc(tree, 0);
@@ -952,6 +956,7 @@ cn_tree_prefix_probe(
         return err;
 
     key_disc_init(kt->kt_data, kt->kt_len, &kdisc);
+    cn_tree_fg_read(tree);
 
     rmlock_rlock(&tree->ct_lock, &lock);
     node = tree->ct_root;
@@ -1049,6 +1054,7 @@ cn_tree_lookup(
     }
 
     key_disc_init(kt->kt_data, kt->kt_len, &kdisc);
+    cn_tree_fg_read(tree);
 
     rmlock_rlock(&tree->ct_lock, &lock);
     node = tree->ct_root;
@@ -1121,6 +1127,42 @@ cn_node_comp_token_put(struct cn_tree_node *tn)
     assert(b);
 }
 
+merr_t
+cn_compaction_rtombs(
+    struct cn_compaction_work *w,
+    struct kvset_builder *bldr,
+    struct rtomb_vec *rv)
+{
+    merr_t err;
+
+    for (uint i = 0; i < w->cw_kvset_cnt; i++) {
+        const struct rtomb *rtv;
+        uint32_t cnt;
+
+        cnt = kvset_get_rtombs(kvset_iter_kvset_get(w->cw_inputv[i]), &rtv);
+
+        for (uint32_t j = 0; j < cnt; j++) {
+            err = rtomb_vec_add(rv, rtv + j);
+            if (ev(err))
+                return err;
+
+            /* An rtomb older than the horizon can be dropped along with
+             * everything it covers once there is nothing older beneath it.
+             */
+            if (!bldr || (w->cw_drop_tombs && rtv[j].rt_seqno <= w->cw_horizon))
+                continue;
+
+            err = kvset_builder_add_rtomb(bldr, rtv + j);
+            if (ev(err))
+                return err;
+        }
+    }
+
+    rtomb_vec_sort(rv);
+
+    return 0;
+}
+
 /**
  * cn_tree_capped_evict() - evict unneeded vblock pages
  * @tree:   cn_tree pointer
@@ -1297,6 +1339,45 @@ err_out:
     return;
 }
 
+/**
+ * cn_tree_vreloc_select() - select k-compact inputs for value relocation
+ *
+ * The live values of an input kvset whose vblocks hold at least cw_vgc_pct
+ * percent garbage are copied into new vblocks, so that its vblocks can be
+ * deleted.  The vblocks of all other inputs are kept, as usual.  Keys are
+ * rewritten either way as each vref embeds its vblock index and offset.
+ */
+static merr_t
+cn_tree_vreloc_select(struct cn_compaction_work *w)
+{
+    struct kvset_list_entry *le;
+    bool reloc = false;
+    uint i;
+
+    if (w->cw_vgc_pct == 0)
+        return 0;
+
+    w->cw_vreloc = calloc(w->cw_kvset_cnt, sizeof(*w->cw_vreloc));
+    if (!w->cw_vreloc)
+        return merr(ENOMEM);
+
+    /* cw_vreloc[] is ordered newest to oldest, like the input iterators. */
+    for (i = 0, le = w->cw_mark; i < w->cw_kvset_cnt; i++, le = list_prev_entry(le, le_link)) {
+        const struct kvset_stats *stats = kvset_statsp(le->le_kvset);
+        const uint j = w->cw_kvset_cnt - 1 - i;
+
+        w->cw_vreloc[j] = kvset_vreloc(stats, w->cw_vgc_pct);
+        reloc |= w->cw_vreloc[j];
+    }
+
+    if (!reloc) {
+        free(w->cw_vreloc);
+        w->cw_vreloc = NULL;
+    }
+
+    return 0;
+}
+
 static merr_t
 cn_tree_prepare_compaction(struct cn_compaction_work *w)
 {
@@ -1306,16 +1387,20 @@ cn_tree_prepare_compaction(struct cn_compaction_work *w)
     struct cn_tree_node *node = w->cw_node;
     struct kvset_list_entry *le;
     struct kv_iterator **ins = NULL;
+    struct rtomb_vec rtombs;
     merr_t err = 0;
     size_t outsz = 0;
     uint32_t n_outs = 1;
     uint i;
     const bool kcompact = (w->cw_action == CN_ACTION_COMPACT_K);
     const bool split = (w->cw_action == CN_ACTION_SPLIT);
+    const bool migrate = (w->cw_action == CN_ACTION_MIGRATE);
 
     if (w->cw_action == CN_ACTION_ZSPILL || w->cw_action == CN_ACTION_JOIN)
         return 0; /* no resources needed for zspill/join */
 
+    rtomb_vec_init(&rtombs);
+
     /* If we are k/kv-compacting, we only have a single output.
      *
      * Node split creates at most twice the number of kvsets as the source node (n_outs)
@@ -1327,7 +1412,7 @@ cn_tree_prepare_compaction(struct cn_compaction_work *w)
 
         n_outs = 2 * w->cw_kvset_cnt;
     } else {
-        if (kcompact || w->cw_action == CN_ACTION_COMPACT_KV)
+        if (kcompact || migrate || w->cw_action == CN_ACTION_COMPACT_KV)
             n_outs = 1;
 
         ins = calloc(w->cw_kvset_cnt, sizeof(*ins));
@@ -1379,6 +1464,26 @@ cn_tree_prepare_compaction(struct cn_compaction_work *w)
 
     vra_wq = cn_get_maint_wq(node->tn_tree->cn);
 
+    /* Gather the rtombs of all inputs before creating the iterators so that
+     * kblocks hidden by an rtomb from a newer input are never read.
+     */
+    for (i = 0, le = w->cw_mark; !split && !migrate && i < w->cw_kvset_cnt;
+         i++, le = list_prev_entry(le, le_link))
+    {
+        const struct rtomb *rtv;
+        uint32_t cnt;
+
+        cnt = kvset_get_rtombs(le->le_kvset, &rtv);
+
+        for (uint32_t j = 0; j < cnt; j++) {
+            err = rtomb_vec_add(&rtombs, rtv + j);
+            if (ev(err))
+                goto err_exit;
+        }
+    }
+
+    rtomb_vec_sort(&rtombs);
+
     /*
      * Create one iterator for each input kvset.  The list 'ins' must be
      * ordered such that 'ins[i]' is newer then 'ins[i+1]'.  We walk the
@@ -1390,9 +1495,10 @@ cn_tree_prepare_compaction(struct cn_compaction_work *w)
      * Just be careful not to try to iterate outside the range of marked
      * kvsets.
      *
-     * Node splits do not need input iterators because there's no merge loop.
+     * Node splits and migrations do not need input iterators because there's
+     * no merge loop.
      */
-    for (i = 0, le = w->cw_mark; !split && i < w->cw_kvset_cnt;
+    for (i = 0, le = w->cw_mark; !split && !migrate && i < w->cw_kvset_cnt;
          i++, le = list_prev_entry(le, le_link))
     {
 
@@ -1407,14 +1513,27 @@ cn_tree_prepare_compaction(struct cn_compaction_work *w)
             goto err_exit;
 
         kvset_iter_set_stats(*iter, &w->cw_stats);
+        kvset_iter_set_tbkt(*iter, w->cw_tbkt_rd);
+
+        if (rtombs.rv_cnt > 0) {
+            err = kvset_iter_skip_covered(*iter, rtombs.rv_rtv, rtombs.rv_cnt, w->cw_horizon);
+            if (ev(err))
+                goto err_exit;
+        }
     }
 
+    rtomb_vec_fini(&rtombs);
+
     /* k-compaction keeps all the vblocks from the source kvsets
      * vbm_blkv[0] is the id of the first vblock of the newest kvset
      * vbm_blkv[n] is the id of the last vblock of the oldest kvset
      */
     if (kcompact) {
-        err = kvset_keep_vblocks(&vbm, w->cw_vgmap, ins, w->cw_kvset_cnt);
+        err = cn_tree_vreloc_select(w);
+        if (ev(err))
+            goto err_exit;
+
+        err = kvset_keep_vblocks(&vbm, w->cw_vgmap, ins, w->cw_kvset_cnt, w->cw_vreloc);
         if (ev(err))
             goto err_exit;
     }
@@ -1433,6 +1552,8 @@ cn_tree_prepare_compaction(struct cn_compaction_work *w)
     return 0;
 
 err_exit:
+    rtomb_vec_fini(&rtombs);
+
     if (ins) {
         for (i = 0; i < w->cw_kvset_cnt; i++)
             if (ins[i])
@@ -1457,6 +1578,22 @@ err_exit:
  * SECTION: Cn Tree Compaction (k-compaction, kv-compaction, spill)
  */
 
+/* Vblocks holding values relocated by a k-compact follow the adopted vblocks.
+ */
+static struct blk_list
+cn_comp_vreloc_blks(struct cn_compaction_work *w)
+{
+    struct blk_list *vblks = &w->cw_outv[0].vblks;
+    struct blk_list tail = { 0 };
+
+    assert(w->cw_vreloc_vblks <= vblks->idc);
+
+    tail.idv = vblks->idv + (vblks->idc - w->cw_vreloc_vblks);
+    tail.idc = w->cw_vreloc_vblks;
+
+    return tail;
+}
+
 /**
  * cn_comp_update_kvcompact() - Update tree after k-compact and kv-compact
  * See section comment for more info.
@@ -1497,14 +1634,19 @@ cn_comp_update_kvcompact(struct cn_compaction_work *work, struct kvset *new_kvse
 
     rmlock_wunlock(&tree->ct_lock);
 
-    /* Delete retired kvsets. */
+    /* Delete retired kvsets (newest first).  The vblocks of kvsets whose
+     * values were relocated are not referenced by the new kvset.
+     */
+    i = 0;
     list_for_each_entry_safe(le, tmp, &retired_kvsets, le_link) {
+        bool keepv = work->cw_keep_vblks && !(work->cw_vreloc && work->cw_vreloc[i]);
 
         assert(kvset_get_dgen(le->le_kvset) >= work->cw_dgen_hi_min);
         assert(kvset_get_dgen(le->le_kvset) <= work->cw_dgen_hi);
 
-        kvset_mark_mblocks_for_delete(le->le_kvset, work->cw_keep_vblks);
+        kvset_mark_mblocks_for_delete(le->le_kvset, keepv);
         kvset_put_ref(le->le_kvset);
+        i++;
     }
 }
 
@@ -1767,7 +1909,9 @@ cn_comp_commit(struct cn_compaction_work *w)
 {
     struct kvset **kvsets = 0;
     struct mbset ***vecs = 0;
+    struct mbset *vreloc_mbs = NULL;
     uint *cnts = 0;
+    uint vecc = 0;
     void **cookiev = 0;
     uint alloc_len;
     const bool is_kcompact = (w->cw_action == CN_ACTION_COMPACT_K);
@@ -1798,10 +1942,12 @@ cn_comp_commit(struct cn_compaction_work *w)
     if (use_mbsets && w->cw_keep_vblks) {
         /* For k-compaction, create new kvset with references to
          * mbsets from input kvsets instead of creating new mbsets.
-         * We need extra allocations for this.
+         * We need extra allocations for this, plus one slot for the
+         * mbset of vblocks written for relocated values.
          */
-        alloc_len += sizeof(*vecs) * w->cw_kvset_cnt;
-        alloc_len += sizeof(*cnts) * w->cw_kvset_cnt;
+        vecc = w->cw_kvset_cnt + (w->cw_vreloc_vblks > 0);
+        alloc_len += sizeof(*vecs) * vecc;
+        alloc_len += sizeof(*cnts) * vecc;
     }
 
     /* Round up alloc_len so that cookiev is correctly aligned */
@@ -1819,19 +1965,32 @@ cn_comp_commit(struct cn_compaction_work *w)
         uint i;
 
         vecs = (void *)(kvsets + w->cw_outc);
-        cnts = (void *)(vecs + w->cw_kvset_cnt);
+        cnts = (void *)(vecs + vecc);
 
         /* The kvset represented by vecs[i] must be newer than
          * the kvset represented by vecs[i+1] (that is, in same order
          * as the vector of iterators used in the compaction/merge
-         * loops).
+         * loops).  Relocated vblocks follow all the adopted vblocks.
          */
         le = w->cw_mark;
         i = w->cw_kvset_cnt;
         while (i--) {
             vecs[i] = kvset_get_vbsetv(le->le_kvset, &cnts[i]);
+            if (w->cw_vreloc && w->cw_vreloc[i])
+                cnts[i] = 0;
             le = list_prev_entry(le, le_link);
         }
+
+        if (w->cw_vreloc_vblks > 0) {
+            struct blk_list vblks = cn_comp_vreloc_blks(w);
+
+            err = kvset_vbset_create(w->cw_tree, vblks.idc, vblks.idv, &vreloc_mbs);
+            if (err)
+                goto done;
+
+            vecs[w->cw_kvset_cnt] = &vreloc_mbs;
+            cnts[w->cw_kvset_cnt] = 1;
+        }
     }
 
     err = cndb_record_txstart(
@@ -1921,8 +2080,8 @@ cn_comp_commit(struct cn_compaction_work *w)
 
         if (use_mbsets) {
             err = kvset_open2(
-                w->cw_tree, w->cw_kvsetidv[i], &km, w->cw_keep_vblks ? w->cw_kvset_cnt : 0, cnts,
-                vecs, &kvsets[i]);
+                w->cw_tree, w->cw_kvsetidv[i], &km, w->cw_keep_vblks ? vecc : 0, cnts, vecs,
+                &kvsets[i]);
         } else {
             err = kvset_open(w->cw_tree, w->cw_kvsetidv[i], &km, &kvsets[i]);
         }
@@ -1979,6 +2138,13 @@ cn_comp_commit(struct cn_compaction_work *w)
     case CN_ACTION_JOIN:
         assert(0);
         break;
+
+    case CN_ACTION_MIGRATE:
+        /* A migrated kvset is as hot as its source.
+         */
+        kvset_set_heat(kvsets[0], kvset_get_heat(w->cw_mark->le_kvset));
+        cn_comp_update_kvcompact(w, kvsets[0]);
+        break;
     }
 
 done:
@@ -1999,6 +2165,10 @@ done:
             cn_split_nodes_free(w, split_nodev);
     }
 
+    /* kvset_open2() takes its own mbset ref */
+    if (vreloc_mbs)
+        mbset_put_ref(vreloc_mbs);
+
     /* always free these ptrs */
     free(kvsets);
 }
@@ -2115,6 +2285,7 @@ cn_comp_cleanup(struct cn_compaction_work *w)
         cn_node_comp_token_put(w->cw_node);
 
     free(w->cw_vbmap.vbm_blkv);
+    free(w->cw_vreloc);
 
     if (w->cw_vgmap) {
         if (kcompact) {
@@ -2684,6 +2855,10 @@ cn_comp_compact(struct cn_compaction_work *w)
     case CN_ACTION_JOIN:
         err = cn_join(w);
         break;
+
+    case CN_ACTION_MIGRATE:
+        err = cn_migrate(w);
+        break;
     }
 
     w->cw_t3_build = get_time_ns();
@@ -8,6 +8,8 @@
 
 #include <stdint.h>
 
+#include <hse/types.h>
+
 #include <hse/ikvdb/csched.h>
 #include <hse/ikvdb/sched_sts.h>
 #include <hse/util/atomic.h>
@@ -23,9 +25,12 @@
 struct cn_tree;
 struct cn_tree_node;
 struct kv_iterator;
+struct kvset_builder;
 struct kvset_list_entry;
 struct kvset_mblocks;
+struct tbkt;
 struct kvset;
+struct rtomb_vec;
 
 enum cn_action {
     CN_ACTION_NONE = 0,
@@ -35,6 +40,7 @@ enum cn_action {
     CN_ACTION_ZSPILL,
     CN_ACTION_SPLIT,
     CN_ACTION_JOIN,
+    CN_ACTION_MIGRATE,
 };
 
 static inline const char *
@@ -55,6 +61,8 @@ cn_action2str(enum cn_action action)
         return "split";
     case CN_ACTION_JOIN:
         return "join";
+    case CN_ACTION_MIGRATE:
+        return "migrate";
     }
 
     return "invalid";
@@ -113,7 +121,15 @@ struct cn_work_est {
  * @cw_keep_vblks:   indicates whether or not vblocks should be deleted or
  *                   if they should transferred from input kvsets to
  *                   output kvets (e.g., in k-compaction).
+ * @cw_mclass:       target media class of a kvset migration
+ * @cw_vgc_pct:      relocate the values of input kvsets whose vblocks hold at
+ *                   least this percentage of garbage (k-compact only, 0 = never)
+ * @cw_vreloc:       per input kvset (newest first), true if its live values are
+ *                   copied into new vblocks rather than its vblocks being kept
+ * @cw_vreloc_vblks: number of new vblocks written for relocated values
  * @cw_tagv:         uniquely identify kvsets for cndb journal
+ * @cw_tbkt_rd:      compaction read budget, or NULL if unrestricted
+ * @cw_tbkt_wr:      compaction write budget, or NULL if unrestricted
  * @cw_stats:        debug stats
  * @cw_t0_enqueue:   debug stats
  * @cw_t1_qtime:     debug stats
@@ -169,6 +185,8 @@ struct cn_compaction_work {
     struct cn_samp_stats cw_samp_pre;
     struct cn_samp_stats cw_samp_post;
     struct cn_work_est cw_est;
+    struct tbkt *cw_tbkt_rd;
+    struct tbkt *cw_tbkt_wr;
     struct cn_merge_stats cw_stats;
     struct cn_merge_stats cw_stats_prev;
 
@@ -184,6 +202,10 @@ struct cn_compaction_work {
     struct vgmap **cw_vgmap;        /* used during k-compact and split */
     struct kvset_vblk_map cw_vbmap; /* used only during k-compact */
     bool cw_keep_vblks;
+    enum hse_mclass cw_mclass; /* used only during migrate */
+    uint cw_vgc_pct;           /* used only during k-compact */
+    bool *cw_vreloc;
+    uint32_t cw_vreloc_vblks;
 
     /* Used only for node split */
     struct {
@@ -234,6 +256,18 @@ cn_node_comp_token_get(struct cn_tree_node *tn);
 void
 cn_node_comp_token_put(struct cn_tree_node *tn);
 
+/**
+ * cn_compaction_rtombs() - gather the range tombstones of a compaction's inputs
+ * @w:    compaction work
+ * @bldr: output kvset builder to receive the rtombs that must be retained (may be NULL)
+ * @rv:   (output) sorted vector of all input rtombs, for dropping covered values
+ */
+merr_t
+cn_compaction_rtombs(
+    struct cn_compaction_work *w,
+    struct kvset_builder *bldr,
+    struct rtomb_vec *rv);
+
 #if HSE_MOCKING
 #include "cn_tree_compact_ut.h"
 #endif /* HSE_MOCKING */
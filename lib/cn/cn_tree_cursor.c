@@ -95,6 +95,59 @@ cn_kv_cmp_rev(const void *a_blob, const void *b_blob)
     return key_obj_cmp(&b->kobj, &a->kobj);
 }
 
+/* Return true if a prefix cursor can skip the kvset because none of its keys
+ * can match the prefix.  The [min, max] key range says nothing about ptombs
+ * shorter than the cursor's prefix nor about range tombstones, so kvsets with
+ * either are always kept.
+ */
+static bool
+cn_lcur_kvset_skip(const struct cn_cursor *cur, const struct kvset *kvset)
+{
+    const struct rtomb *rtv;
+    const void *key;
+    uint16_t klen;
+
+    if (!cur->cncur_pfxlen)
+        return false;
+
+    if (cur->cncur_pfxlen > cur->cncur_tree_pfxlen && kvset_has_ptree(kvset))
+        return false;
+
+    if (kvset_get_rtombs(kvset, &rtv) > 0)
+        return false;
+
+    kvset_minkey(kvset, &key, &klen);
+    if (keycmp_prefix(cur->cncur_pfx, cur->cncur_pfxlen, key, klen) < 0)
+        return true;
+
+    kvset_maxkey(kvset, &key, &klen);
+
+    return keycmp_prefix(cur->cncur_pfx, cur->cncur_pfxlen, key, klen) > 0;
+}
+
+/* Return true if no node past rtn, in the cursor's direction, can hold a key
+ * that matches the cursor's prefix.  A node's edge key is the largest key it
+ * may hold, so the nodes past it hold only larger keys (and likewise, the
+ * nodes before it hold keys no larger than the previous node's edge key).
+ */
+static bool
+cn_lcur_pfx_islast(const struct cn_cursor *cur, struct route_node *rtn)
+{
+    if (!cur->cncur_pfxlen)
+        return false;
+
+    if (cur->cncur_reverse) {
+        if (route_node_isfirst(rtn))
+            return true;
+
+        rtn = route_node_prev(rtn);
+
+        return route_node_keycmp_prefix(cur->cncur_pfx, cur->cncur_pfxlen, rtn) > 0;
+    }
+
+    return route_node_keycmp_prefix(cur->cncur_pfx, cur->cncur_pfxlen, rtn) < 0;
+}
+
 MTF_STATIC merr_t
 cn_tree_kvset_refs(struct cn_tree_node *node, struct cn_level_cursor *lcur)
 {
@@ -115,14 +168,20 @@ cn_tree_kvset_refs(struct cn_tree_node *node, struct cn_level_cursor *lcur)
         if (!lcur->cnlc_dgen_hi)
             lcur->cnlc_dgen_hi = dgen;
 
+        lcur->cnlc_dgen_lo = dgen;
+
+        /* Skip kvsets that cannot hold the prefix before any of their
+         * wbt pages are touched by an iterator create or seek.
+         */
+        if (cn_lcur_kvset_skip(lcur->cnlc_cncur, kvset))
+            continue;
+
         k = table_append(tab);
         if (ev(!k))
             return merr(ENOMEM);
 
         kvset_get_ref(kvset);
         k->kvset = kvset;
-
-        lcur->cnlc_dgen_lo = dgen;
     }
 
     return 0;
@@ -142,6 +201,74 @@ kvref_tab_putref(void *arg)
 static bool
 cn_lcur_read(struct element_source *, void **);
 
+/* Find and take ownership of the stashed iterator for the given kvset.
+ *
+ * Kvsets in a node are ordered by dgen, newest first, so a single pass over
+ * the stash (tracked by *hint) suffices to diff it against the node's current
+ * list of kvsets.  The stash's ref on a matched kvset is dropped since the
+ * new kvref table holds its own.
+ */
+MTF_STATIC struct kv_iterator *
+cn_lcur_stash_take(struct cn_level_cursor *lcur, struct kvset *kvset, uint *hint)
+{
+    struct table *tab = lcur->cnlc_stash_tab;
+    uint64_t dgen = kvset_get_dgen(kvset);
+    uint i;
+
+    while (*hint < lcur->cnlc_stash_iterc) {
+        struct kvref *k = table_at(tab, *hint);
+
+        if (k->kvset && kvset_get_dgen(k->kvset) <= dgen)
+            break;
+
+        ++*hint;
+    }
+
+    for (i = *hint; i < lcur->cnlc_stash_iterc; i++) {
+        struct kvref *k = table_at(tab, i);
+        struct kv_iterator *it;
+
+        if (!k->kvset)
+            continue;
+
+        if (kvset_get_dgen(k->kvset) != dgen)
+            break;
+
+        if (k->kvset != kvset)
+            continue;
+
+        it = kvset_cursor_es_h2r(lcur->cnlc_stash_esrcv[i]);
+        lcur->cnlc_stash_esrcv[i] = NULL;
+
+        kvset_put_ref(k->kvset);
+        k->kvset = NULL;
+
+        return it;
+    }
+
+    return NULL;
+}
+
+/* Release the iterators and kvset refs that weren't reused from the stash.
+ */
+MTF_STATIC void
+cn_lcur_stash_release(struct cn_level_cursor *lcur)
+{
+    uint i;
+
+    for (i = 0; i < lcur->cnlc_stash_iterc; i++) {
+        if (lcur->cnlc_stash_esrcv[i])
+            kvset_iter_release(kvset_cursor_es_h2r(lcur->cnlc_stash_esrcv[i]));
+    }
+
+    lcur->cnlc_stash_iterc = 0;
+
+    if (lcur->cnlc_stash_tab) {
+        table_apply(lcur->cnlc_stash_tab, kvref_tab_putref);
+        table_reset(lcur->cnlc_stash_tab);
+    }
+}
+
 MTF_STATIC merr_t
 cn_lcur_init(struct cn_level_cursor *lcur)
 {
@@ -152,9 +279,9 @@ cn_lcur_init(struct cn_level_cursor *lcur)
     struct workqueue_struct *maint_wq = cn_get_maint_wq(cncur->cncur_cn);
 
     uint iterc = table_len(tab);
-    uint i, bh_align = 16;
+    uint i, hint = 0, bh_align = 16;
     size_t bh_max_cnt;
-    merr_t err;
+    merr_t err = 0;
 
     lcur->cnlc_iterc = 0;
     lcur->cnlc_es = es_make(cn_lcur_read, 0, 0);
@@ -174,18 +301,38 @@ cn_lcur_init(struct cn_level_cursor *lcur)
 
     esrc = lcur->cnlc_esrcv;
 
-    for (i = 0; i < iterc; i++) {
+    rtomb_vec_reset(&lcur->cnlc_rtombs);
+
+    for (i = 0; i < iterc && !err; i++) {
         struct kvref *k = table_at(tab, i);
+        const struct rtomb *rtv;
         struct kv_iterator *it;
+        uint32_t rtc;
 
-        err = kvset_iter_create(k->kvset, NULL, maint_wq, NULL, cncur->cncur_flags, &it);
-        if (ev(err))
-            return err;
+        it = cn_lcur_stash_take(lcur, k->kvset, &hint);
+        if (!it) {
+            err = kvset_iter_create(k->kvset, NULL, maint_wq, NULL, cncur->cncur_flags, &it);
+            if (ev(err))
+                break;
+        }
 
         *esrc++ = kvset_iter_es_get(it);
         ++lcur->cnlc_iterc;
+
+        /* The kvset ref held by the kvref table keeps the rtomb keys valid.
+         */
+        rtc = kvset_get_rtombs(k->kvset, &rtv);
+        for (uint32_t j = 0; j < rtc && !err; j++)
+            err = rtomb_vec_add(&lcur->cnlc_rtombs, rtv + j);
     }
 
+    cn_lcur_stash_release(lcur);
+
+    if (ev(err))
+        return err;
+
+    rtomb_vec_sort(&lcur->cnlc_rtombs);
+
     if (!lcur->cnlc_iterc)
         return 0;
 
@@ -216,11 +363,48 @@ cn_lcur_kvset_release(struct cn_level_cursor *lcur)
         kvset_iter_release(kvset_cursor_es_h2r(lcur->cnlc_esrcv[i]));
 
     lcur->cnlc_iterc = 0;
+    rtomb_vec_reset(&lcur->cnlc_rtombs);
 
     table_apply(lcur->cnlc_kvref_tab, kvref_tab_putref);
     table_reset(lcur->cnlc_kvref_tab);
 }
 
+/* Set aside a level cursor's iterators and kvset refs rather than releasing
+ * them, so that the next cn_lcur_init() can reuse the iterators of kvsets
+ * that are still in the node.  If there's already a stash then the level
+ * cursor has had no iterators since, and there is nothing to add to it.
+ */
+MTF_STATIC void
+cn_lcur_kvset_stash(struct cn_level_cursor *lcur)
+{
+    struct element_source **esrcv;
+    struct table *tab;
+    size_t esrcc;
+
+    if (lcur->cnlc_stash_iterc > 0 || !lcur->cnlc_stash_tab) {
+        cn_lcur_kvset_release(lcur);
+        return;
+    }
+
+    cn_lcur_stash_release(lcur);
+
+    tab = lcur->cnlc_stash_tab;
+    lcur->cnlc_stash_tab = lcur->cnlc_kvref_tab;
+    lcur->cnlc_kvref_tab = tab;
+
+    esrcv = lcur->cnlc_stash_esrcv;
+    esrcc = lcur->cnlc_stash_esrcc;
+    lcur->cnlc_stash_esrcv = lcur->cnlc_esrcv;
+    lcur->cnlc_stash_esrcc = lcur->cnlc_esrcc;
+    lcur->cnlc_esrcv = esrcv;
+    lcur->cnlc_esrcc = esrcc;
+
+    lcur->cnlc_stash_iterc = lcur->cnlc_iterc;
+    lcur->cnlc_iterc = 0;
+
+    rtomb_vec_reset(&lcur->cnlc_rtombs);
+}
+
 merr_t
 cn_tree_cursor_create(struct cn_cursor *cur)
 {
@@ -239,11 +423,13 @@ cn_tree_cursor_create(struct cn_cursor *cur)
         lcur->cnlc_iterc = 0;
         if (!lcur->cnlc_kvref_tab)
             lcur->cnlc_kvref_tab = table_create(kvref_tab_cnt, sizeof(struct kvref), false);
+        if (!lcur->cnlc_stash_tab)
+            lcur->cnlc_stash_tab = table_create(kvref_tab_cnt, sizeof(struct kvref), false);
 
         lcur->cnlc_esrcc = 64;
         lcur->cnlc_esrcv = malloc(lcur->cnlc_esrcc * sizeof(*lcur->cnlc_esrcv));
 
-        if (!lcur->cnlc_kvref_tab || !lcur->cnlc_esrcv) {
+        if (!lcur->cnlc_kvref_tab || !lcur->cnlc_stash_tab || !lcur->cnlc_esrcv) {
             err = merr(ENOMEM);
             goto out;
         }
@@ -254,6 +440,7 @@ cn_tree_cursor_create(struct cn_cursor *cur)
         cur->cncur_flags |= kvset_iter_flag_reverse;
 
     lcur = &cur->cncur_lcur[0];
+    cn_tree_fg_read(tree);
 
     rmlock_rlock(&tree->ct_lock, &lock);
     err = cn_tree_kvset_refs(tree->ct_root, lcur);
@@ -279,6 +466,8 @@ out:
 
             cn_lcur_kvset_release(lcur);
             table_destroy(lcur->cnlc_kvref_tab);
+            table_destroy(lcur->cnlc_stash_tab);
+            rtomb_vec_fini(&lcur->cnlc_rtombs);
             free(lcur->cnlc_esrcv);
         }
     }
@@ -295,9 +484,13 @@ cn_tree_cursor_destroy(struct cn_cursor *cur)
         struct cn_level_cursor *lcur = &cur->cncur_lcur[i];
 
         cn_lcur_kvset_release(lcur);
+        cn_lcur_stash_release(lcur);
 
         table_destroy(lcur->cnlc_kvref_tab);
+        table_destroy(lcur->cnlc_stash_tab);
+        free(lcur->cnlc_stash_esrcv);
         bin_heap_destroy(lcur->cnlc_bh);
+        rtomb_vec_fini(&lcur->cnlc_rtombs);
         free(lcur->cnlc_esrcv);
     }
 
@@ -365,6 +558,8 @@ cn_lcur_advance(struct cn_level_cursor *lcur)
             rtn_ekey = rtn_curr;
         }
 
+        lcur->cnlc_islast = lcur->cnlc_islast || cn_lcur_pfx_islast(cncur, rtn_curr);
+
         first_pass = false;
         cncur->cncur_merr = cn_tree_kvset_refs(route_node_tnode(rtn_curr), lcur);
         if (ev(cncur->cncur_merr))
@@ -433,7 +628,10 @@ cn_tree_cursor_seek(struct cn_cursor *cur, const void *key, uint32_t len, struct
     bool first_pass = true;
     int i;
 
-    cn_lcur_kvset_release(lcur);
+    /* Reuse the iterators of kvsets that are still in the node if the seek
+     * lands in the same node as before.
+     */
+    cn_lcur_kvset_stash(lcur);
 
     rmlock_rlock(&tree->ct_lock, &lock);
 
@@ -455,6 +653,8 @@ cn_tree_cursor_seek(struct cn_cursor *cur, const void *key, uint32_t len, struct
             rtn_ekey = rtn_curr;
         }
 
+        lcur->cnlc_islast = lcur->cnlc_islast || cn_lcur_pfx_islast(cur, rtn_curr);
+
         first_pass = false;
         err = cn_tree_kvset_refs(route_node_tnode(rtn_curr), lcur);
         if (ev(err))
@@ -531,10 +731,12 @@ cn_tree_cursor_update(struct cn_cursor *cur)
     int i;
     merr_t err;
 
-    /* Release resources.
+    /* Set aside the current iterators rather than releasing them.  The root's
+     * kvsets are re-collected below, and the leaf's on the seek that must
+     * follow an update, and only kvsets not seen before get new iterators.
      */
     for (i = 0; i < NUM_LEVELS; i++)
-        cn_lcur_kvset_release(&cur->cncur_lcur[i]);
+        cn_lcur_kvset_stash(&cur->cncur_lcur[i]);
 
     /* Re-acquire Level 0 resources.
      */
@@ -645,6 +847,29 @@ cn_tree_cursor_advance_safe(struct cn_cursor *cur)
     kvset_put_ref(ks);
 }
 
+/* Return true if a value with seqno seq is hidden by a range tombstone in either the root
+ * or the current leaf node.  Rtombs may extend beyond the node that holds them, but they are
+ * genuine deletions and so may be applied to any key in their range.
+ */
+static bool
+cur_item_rtomb_hides(struct cn_cursor *cur, const struct key_obj *kobj, uint64_t seq)
+{
+    char kbuf[HSE_KVS_KEY_LEN_MAX];
+    uint klen;
+
+    if (!cur->cncur_lcur[0].cnlc_rtombs.rv_cnt && !cur->cncur_lcur[1].cnlc_rtombs.rv_cnt)
+        return false;
+
+    key_obj_copy(kbuf, sizeof(kbuf), &klen, kobj);
+
+    for (int i = 0; i < NUM_LEVELS; i++) {
+        if (rtomb_vec_lookup(&cur->cncur_lcur[i].cnlc_rtombs, kbuf, klen, cur->cncur_seqno) > seq)
+            return true;
+    }
+
+    return false;
+}
+
 merr_t
 cn_tree_cursor_read(struct cn_cursor *cur, struct kvs_cursor_element *elem, bool *eof)
 {
@@ -712,6 +937,11 @@ cn_tree_cursor_read(struct cn_cursor *cur, struct kvs_cursor_element *elem, bool
         if (!found)
             continue; /* Key doesn't have a value in the cursor's view. */
 
+        if (vtype != VTYPE_PTOMB && cur_item_rtomb_hides(cur, &item->kobj, seq)) {
+            found = false;
+            continue; /* Key is hidden by a range tombstone. */
+        }
+
         cur->cncur_merr =
             kvset_iter_val_get(kv_iter, &item->vctx, vtype, vbidx, vboff, &vdata, &vlen, &complen);
         if (ev(cur->cncur_merr))
@@ -748,10 +978,13 @@ cn_tree_cursor_read(struct cn_cursor *cur, struct kvs_cursor_element *elem, bool
 
     } while (!found);
 
+    cur->cncur_elem_ks = kvset_iter_kvset_get(kv_iter);
+
     elem->kce_kobj = item->kobj;
     kvs_vtuple_init(&elem->kce_vt, (void *)vdata, vlen);
     elem->kce_complen = complen;
     elem->kce_is_ptomb = false; /* cn never returns a ptomb */
+    elem->kce_is_mopnd = false;
     elem->kce_seqnoref = HSE_ORDNL_TO_SQNREF(seq);
 
     cur->cncur_stats.ms_keys_out++;
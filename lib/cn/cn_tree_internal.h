@@ -77,6 +77,8 @@ struct cn_kle_hdr {
  * @ct_rspill_slp: number of rspill jobs waiting on a split to finish
  * @ct_split_cnt:  number of pending or running split jobs
  * @ct_split_dly:  time at which a new splits may be requested
+ * @ct_fg_reads:   non-zero if there have been foreground reads since csched
+ *                 last checked (see cn_tree_fg_read())
  * @ct_sched:
  * @ct_kvdb_health: for monitoring KDVB health
  * @ct_last_ptseq:
@@ -114,6 +116,7 @@ struct cn_tree {
     atomic_uint ct_split_cnt;
     uint64_t ct_split_dly;
     uint64_t ct_sgen;
+    atomic_uint ct_fg_reads;
 
     union {
         struct sp3_tree sp3t HSE_L1D_ALIGNED;
@@ -220,6 +223,16 @@ cn_node_isleaf(const struct cn_tree_node *tn)
     return !cn_node_isroot(tn);
 }
 
+/* Note foreground read activity on the tree.  The flag is read and cleared
+ * by csched, so the cacheline is written at most once per check interval.
+ */
+static HSE_ALWAYS_INLINE void
+cn_tree_fg_read(struct cn_tree *tree)
+{
+    if (!atomic_read(&tree->ct_fg_reads))
+        atomic_set(&tree->ct_fg_reads, 1);
+}
+
 enum hse_mclass
 cn_tree_node_mclass(struct cn_tree_node *tn, enum hse_mclass_policy_dtype dtype);
 
@@ -21,6 +21,7 @@
 #include <hse/ikvdb/kvdb_rparams.h>
 #include <hse/ikvdb/sched_sts.h>
 #include <hse/ikvdb/throttle.h>
+#include <hse/mpool/mpool.h>
 #include <hse/rest/headers.h>
 #include <hse/rest/method.h>
 #include <hse/rest/params.h>
@@ -32,6 +33,7 @@
 #include <hse/util/event_counter.h>
 #include <hse/util/platform.h>
 #include <hse/util/slab.h>
+#include <hse/util/token_bucket.h>
 
 #include "cn_tree_compact.h"
 #include "cn_tree_internal.h"
@@ -189,6 +191,8 @@ struct sp3_qinfo {
  * @sp_dlist_lock:  dirty-node/dirty-tree list lock
  * @sp_dlist_idx:   the current active dirty-node/dirty-tree list
  * @sp_dtree_listv: vector of lists of dirty trees with dirty nodes
+ * @sp_tbkt_rd:   compaction read budget (bytes/sec, zero if unrestricted)
+ * @sp_tbkt_wr:   compaction write budget (bytes/sec, zero if unrestricted)
  * @mon_wq:       monitor thread workqueue
  * @mon_work:     monitor thread work struct
  * @name:         name for logging and data tree
@@ -284,6 +288,11 @@ struct sp3 {
     struct cn_merge_stats sp_mstatsv[CN_RULE_MAX] HSE_L1D_ALIGNED;
     struct rusage sp_rusage;
 
+    /* Shared, adjusted by the monitor and consumed by compaction threads.
+     */
+    struct tbkt sp_tbkt_rd;
+    struct tbkt sp_tbkt_wr;
+
     /* The following fields are rarely touched.
      */
     struct workqueue_struct *mon_wq;
@@ -646,6 +655,19 @@ sp3_refresh_thresholds(struct sp3 *sp)
 
     thresh.split_cnt_max = qthreads(sp, SP3_QNUM_SPLIT);
 
+    /* Garbage k-compactions relocate the values of kvsets whose vblocks
+     * hold at least vgc_pct garbage (0 falls back to kv-compaction).
+     */
+    thresh.vgc_pct = sp->rp->csched_vgc_pct;
+
+    /* kvset heat migration settings.  The staging usage estimate is
+     * maintained by sp3_heat_check() and is not a tunable.
+     */
+    thresh.heat_hot = sp->rp->csched_heat_hot;
+    thresh.heat_cold = thresh.heat_hot / SP3_HEAT_COLD_DIV;
+    thresh.heat_staging_max = sp->rp->csched_heat_staging_max << 20;
+    thresh.heat_staging_used = sp->thresh.heat_staging_used;
+
     /* If thresholds have not changed there's nothing to do.  Otherwise, need to
      * recompute work trees.
      */
@@ -660,13 +682,15 @@ sp3_refresh_thresholds(struct sp3 *sp)
 
     // clang-format off
     log_info("sp3 thresholds: rspill: min/max/wlenmb %u/%u/%lu, lcomp: max/pct/keys %u/%u%%/%u,"
-             " llen: min/max %u/%u, idlec: %u, idlem: %u, lscat: hwm/max %u/%u split %u",
+             " llen: min/max %u/%u, idlec: %u, idlem: %u, lscat: hwm/max %u/%u split %u,"
+             " vgc: %u%%, heat: hot/cold/stagingmb %lu/%lu/%lu",
         thresh.rspill_runlen_min, thresh.rspill_runlen_max, thresh.rspill_wlen_max >> 20,
         thresh.lcomp_runlen_max, thresh.lcomp_join_pct, thresh.lcomp_split_keys >> 20,
         thresh.llen_runlen_min, thresh.llen_runlen_max,
         thresh.llen_idlec, thresh.llen_idlem,
         thresh.lscat_hwm, thresh.lscat_runlen_max,
-        thresh.split_cnt_max);
+        thresh.split_cnt_max, thresh.vgc_pct,
+        thresh.heat_hot, thresh.heat_cold, thresh.heat_staging_max >> 20);
     // clang-format on
 }
 
@@ -1465,6 +1489,10 @@ sp3_comp_thread_name(
     case CN_ACTION_JOIN:
         a = "nj";
         break;
+
+    case CN_ACTION_MIGRATE:
+        a = "mg";
+        break;
     }
 
     switch (rule) {
@@ -1491,6 +1519,9 @@ sp3_comp_thread_name(
     case CN_RULE_GARBAGE:
         r = "gb";
         break;
+    case CN_RULE_VGC:
+        r = "vg";
+        break;
     case CN_RULE_LENGTH_MIN:
         r = "ls";
         break;
@@ -1534,6 +1565,12 @@ sp3_comp_thread_name(
     case CN_RULE_JOIN:
         r = "nj";
         break;
+    case CN_RULE_HOT:
+        r = "ht";
+        break;
+    case CN_RULE_COLD:
+        r = "cd";
+        break;
     case CN_RULE_MAX:
         r = "xx";
         break;
@@ -1734,6 +1771,17 @@ sp3_submit(struct sp3 *sp, struct cn_compaction_work *w, uint qnum)
     w->cw_debug = csched_rp_dbg_comp(sp->rp);
     w->cw_qnum = qnum;
 
+    /* Root spills are exempt from the compaction I/O budget as they
+     * must keep pace with ingest to avoid throttling the application.
+     */
+    if (w->cw_action == CN_ACTION_SPILL || w->cw_action == CN_ACTION_ZSPILL) {
+        w->cw_tbkt_rd = NULL;
+        w->cw_tbkt_wr = NULL;
+    } else {
+        w->cw_tbkt_rd = &sp->sp_tbkt_rd;
+        w->cw_tbkt_wr = &sp->sp_tbkt_wr;
+    }
+
     memset(&w->cw_stats, 0, sizeof(w->cw_stats));
     w->cw_stats.ms_jobs = 1;
 
@@ -2343,6 +2391,14 @@ sp3_schedule(struct sp3 *sp)
 
             job = sp3_check_rb_tree(sp, sp->rr_wtype, 0, qnum);
             break;
+
+        case wtype_heat:
+            qnum = SP3_QNUM_SHARED;
+            if (sp->samp_reduce || qfull(sp, qnum))
+                break;
+
+            job = sp3_check_rb_tree(sp, sp->rr_wtype, 0, qnum);
+            break;
         }
     }
 }
@@ -2497,6 +2553,108 @@ sp3_update_samp(struct sp3 *sp)
     }
 }
 
+/* Decay the heat of every kvset in every managed tree, recompute the
+ * amount of staging space consumed by cN, and queue leaf nodes which
+ * have a kvset that should be migrated into or out of staging.
+ */
+static void
+sp3_heat_check(struct sp3 *sp)
+{
+    struct cn_tree *tree;
+    size_t used = 0;
+
+    if (!sp->thresh.heat_staging_max)
+        return;
+
+    list_for_each_entry(tree, &sp->mon_tlist, ct_sched.sp3t.spt_tlink) {
+        struct cn_tree_node *tn;
+        void *lock;
+
+        if (!mpool_mclass_is_configured(tree->mp, HSE_MCLASS_STAGING))
+            continue;
+
+        rmlock_rlock(&tree->ct_lock, &lock);
+        cn_tree_foreach_node(tn, tree) {
+            struct kvset_list_entry *le;
+
+            list_for_each_entry(le, &tn->tn_kvset_list, le_link) {
+                kvset_heat_decay(le->le_kvset);
+                used += kvset_get_staging_alen(le->le_kvset);
+            }
+        }
+        rmlock_runlock(lock);
+    }
+
+    sp->thresh.heat_staging_used = used;
+
+    list_for_each_entry(tree, &sp->mon_tlist, ct_sched.sp3t.spt_tlink) {
+        struct cn_tree_node *tn;
+        void *lock;
+
+        if (!mpool_mclass_is_configured(tree->mp, HSE_MCLASS_STAGING))
+            continue;
+
+        rmlock_rlock(&tree->ct_lock, &lock);
+        cn_tree_foreach_leaf(tn, tree) {
+            struct sp3_node *spn = tn2spn(tn);
+            struct kvset_list_entry *le;
+            enum cn_rule rule;
+            uint64_t heat;
+
+            if (!spn->spn_managed || atomic_read(&tn->tn_busycnt) > 0)
+                continue;
+
+            le = sp3_work_heat_candidate(tn, &sp->thresh, &rule);
+            if (!le) {
+                sp3_node_remove(sp, spn, wtype_heat);
+                continue;
+            }
+
+            /* Hottest promotions first, or coldest evictions first.
+             */
+            heat = kvset_get_heat(le->le_kvset);
+            sp3_node_insert(sp, spn, wtype_heat, rule == CN_RULE_HOT ? heat : UINT64_MAX - heat);
+        }
+        rmlock_runlock(lock);
+    }
+}
+
+/* Adjust the compaction I/O budget.  Compaction runs unrestricted while
+ * the foreground is idle.  If there have been any foreground reads since
+ * the last check then compaction yields by limiting its read and write
+ * rates to the configured budget (if any).
+ */
+static void
+sp3_iobudget_check(struct sp3 *sp)
+{
+    uint64_t rd = sp->rp->csched_io_rd_mbps << 20;
+    uint64_t wr = sp->rp->csched_io_wr_mbps << 20;
+    struct cn_tree *tree;
+    bool busy = false;
+
+    list_for_each_entry(tree, &sp->mon_tlist, ct_sched.sp3t.spt_tlink) {
+        if (atomic_read(&tree->ct_fg_reads)) {
+            atomic_set(&tree->ct_fg_reads, 0);
+            busy = true;
+        }
+    }
+
+    if (!busy)
+        rd = wr = 0;
+
+    /* A burst of a quarter second's worth of tokens smooths out the
+     * large (kblock and vblock sized) requests made by compaction.  The
+     * buckets are reset on each mode switch so that a bucket being
+     * restricted starts out full, rather than with whatever balance and
+     * refill time it was left with when it was last restricted.
+     */
+    if (rd != tbkt_rate_get(&sp->sp_tbkt_rd))
+        tbkt_reinit(&sp->sp_tbkt_rd, rd / 4, rd);
+
+    if (wr != tbkt_rate_get(&sp->sp_tbkt_wr))
+        tbkt_reinit(&sp->sp_tbkt_wr, wr / 4, wr);
+}
+
 struct periodic_check {
     const uint64_t interval;
     uint64_t next;
@@ -2511,6 +2669,7 @@ sp3_monitor(struct work_struct *work)
     struct periodic_check chk_sched = { .interval = NSEC_PER_SEC * 3 };
     struct periodic_check chk_refresh = { .interval = NSEC_PER_SEC * 17 };
     struct periodic_check chk_shape = { .interval = NSEC_PER_SEC * 23 };
+    struct periodic_check chk_heat = { .interval = NSEC_PER_SEC * 31 };
     struct periodic_check chk_stats = { .interval = NSEC_PER_SEC * 300 };
 
     chk_refresh.next = get_time_ns() + chk_refresh.interval;
@@ -2584,6 +2743,7 @@ sp3_monitor(struct work_struct *work)
         if (now > chk_qos.next) {
             chk_qos.next = now + chk_qos.interval;
             sp3_qos_check(sp);
+            sp3_iobudget_check(sp);
         }
 
         if (now > chk_shape.next) {
@@ -2591,6 +2751,11 @@ sp3_monitor(struct work_struct *work)
             sp3_tree_shape_check(sp);
         }
 
+        if (now > chk_heat.next) {
+            chk_heat.next = now + chk_heat.interval;
+            sp3_heat_check(sp);
+        }
+
         if (now > chk_stats.next) {
             chk_stats.next = now + chk_stats.interval;
             sp3_stats(sp);
@@ -2853,6 +3018,9 @@ sp3_create(
     for (size_t tx = 0; tx < NELEM(sp->rbt); tx++)
         sp->rbt[tx] = RB_ROOT;
 
+    tbkt_init(&sp->sp_tbkt_rd, 0, 0);
+    tbkt_init(&sp->sp_tbkt_wr, 0, 0);
+
     atomic_set(&sp->running, 1);
 
     mutex_init(&sp->mon_lock);
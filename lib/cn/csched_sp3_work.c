@@ -42,13 +42,13 @@ sp3_node_is_idle(struct cn_tree_node *tn)
 static void
 sp3_work_estimate(struct cn_compaction_work *w)
 {
-    uint64_t keys, halen, kalen, valen, vgarb;
+    uint64_t keys, halen, kalen, valen, vgarb, rvalen, rvgarb;
     struct kvset_list_entry *le;
     int64_t consume, produce;
     bool src_is_leaf, dst_is_leaf;
     uint percent_keep;
 
-    keys = halen = kalen = valen = vgarb = 0;
+    keys = halen = kalen = valen = vgarb = rvalen = rvgarb = 0;
     le = w->cw_mark;
 
     for (uint i = 0; i < w->cw_kvset_cnt; i++) {
@@ -60,6 +60,11 @@ sp3_work_estimate(struct cn_compaction_work *w)
         valen += stats->kst_valen;
         vgarb += stats->kst_vgarb;
 
+        if (kvset_vreloc(stats, w->cw_vgc_pct)) {
+            rvalen += stats->kst_valen;
+            rvgarb += stats->kst_vgarb;
+        }
+
         le = list_prev_entry(le, le_link);
     }
 
@@ -74,9 +79,12 @@ sp3_work_estimate(struct cn_compaction_work *w)
         break;
 
     case CN_ACTION_COMPACT_K:
-        /* Assume no garbage collection, thus percent_keep == 100 */
-        consume = halen + kalen;
+        /* Assume no garbage collection, thus percent_keep == 100, other
+         * than in the vblocks of kvsets whose values are relocated.
+         */
+        consume = halen + kalen + rvalen;
         dst_is_leaf = src_is_leaf;
+        w->cw_est.cwe_samp.l_vgarb = -rvgarb;
         break;
 
     case CN_ACTION_COMPACT_KV:
@@ -112,6 +120,12 @@ sp3_work_estimate(struct cn_compaction_work *w)
         percent_keep = 100;
         dst_is_leaf = true;
         break;
+
+    case CN_ACTION_MIGRATE:
+        consume = halen + kalen + valen;
+        percent_keep = 100;
+        dst_is_leaf = src_is_leaf;
+        break;
     }
 
     produce = consume * percent_keep / 100;
@@ -677,18 +691,37 @@ sp3_work_wtype_garbage(
         return kvsets;
     }
 
-    /* There is no low-hanging fruit, so until we have zcompact
-     * we must issue a heavy-weight kv-compaction.
-     */
     head = &tn->tn_kvset_list;
     *mark = list_last_entry_or_null(head, typeof(*le), le_link);
+
+    kvsets = cn_ns_kvsets(&tn->tn_ns);
+    kvsets = min_t(uint, kvsets, thresh->lcomp_runlen_max);
+
+    /* If any kvset in the run has vblocks that are mostly garbage then
+     * issue a k-compaction which copies only the live values of such
+     * kvsets into new vblocks and keeps the vblocks of all the others.
+     */
+    le = *mark;
+    for (uint i = 0; le && i < kvsets; i++) {
+        if (kvset_vreloc(kvset_statsp(le->le_kvset), thresh->vgc_pct)) {
+            *action = CN_ACTION_COMPACT_K;
+            *rule = CN_RULE_VGC;
+            ev_debug(1);
+
+            return kvsets;
+        }
+
+        le = list_prev_entry_or_null(le, le_link, head);
+    }
+
+    /* There is no low-hanging fruit, so we must issue a heavy-weight
+     * kv-compaction.
+     */
     *action = CN_ACTION_COMPACT_KV;
     *rule = CN_RULE_GARBAGE;
     ev_debug(1);
 
-    kvsets = cn_ns_kvsets(&tn->tn_ns);
-
-    return min_t(uint, kvsets, thresh->lcomp_runlen_max);
+    return kvsets;
 }
 
 static uint
@@ -922,6 +955,72 @@ sp3_work_wtype_length(
     return 0;
 }
 
+struct kvset_list_entry *
+sp3_work_heat_candidate(
+    struct cn_tree_node *tn,
+    const struct sp3_thresholds *thresh,
+    enum cn_rule *rule)
+{
+    struct kvset_list_entry *le, *best = NULL;
+    size_t avail = 0;
+    uint64_t best_heat;
+    bool evict;
+
+    if (!thresh->heat_staging_max || !cn_node_isleaf(tn))
+        return NULL;
+
+    evict = thresh->heat_staging_used > thresh->heat_staging_max;
+    if (!evict)
+        avail = thresh->heat_staging_max - thresh->heat_staging_used;
+
+    best_heat = evict ? UINT64_MAX : 0;
+
+    list_for_each_entry(le, &tn->tn_kvset_list, le_link) {
+        const struct kvset_stats *stats = kvset_statsp(le->le_kvset);
+        size_t alen = stats->kst_halen + stats->kst_kalen + stats->kst_valen;
+        size_t staged = kvset_get_staging_alen(le->le_kvset);
+        uint64_t heat = kvset_get_heat(le->le_kvset);
+
+        if (kvset_get_work(le->le_kvset))
+            continue;
+
+        if (evict) {
+            if (staged > 0 && heat < thresh->heat_cold && heat < best_heat) {
+                best_heat = heat;
+                best = le;
+            }
+        } else {
+            if (heat >= thresh->heat_hot && heat > best_heat && staged < alen &&
+                alen - staged <= avail) {
+                best_heat = heat;
+                best = le;
+            }
+        }
+    }
+
+    if (best)
+        *rule = evict ? CN_RULE_COLD : CN_RULE_HOT;
+
+    return best;
+}
+
+static uint
+sp3_work_wtype_heat(
+    struct sp3_node *spn,
+    struct sp3_thresholds *thresh,
+    struct kvset_list_entry **mark,
+    enum cn_action *action,
+    enum cn_rule *rule)
+{
+    *mark = sp3_work_heat_candidate(spn2tn(spn), thresh, rule);
+    if (!*mark)
+        return 0;
+
+    *action = CN_ACTION_MIGRATE;
+
+    return 1;
+}
+
 /**
  * sp3_work() - determine if a given node needs maintenance
  * @tn: the cn tree node to check
@@ -1038,6 +1137,10 @@ sp3_work(
             n_kvsets = sp3_work_wtype_idle(spn, thresh, &mark, &action, &rule);
             break;
 
+        case wtype_heat:
+            n_kvsets = sp3_work_wtype_heat(spn, thresh, &mark, &action, &rule);
+            break;
+
         default:
             assert(0);
             break;
@@ -1124,14 +1227,34 @@ sp3_work(
     }
 
     w->cw_compc = kvset_get_compc(mark->le_kvset);
+    w->cw_vgc_pct = (rule == CN_RULE_VGC) ? thresh->vgc_pct : 0;
 
-    /* If mark is at the end of the list or the compc of the first kvset
-     * past the mark is higher than the mark's then we can advance the
-     * compc for the new kvset.
-     */
-    le = list_next_entry_or_null(mark, le_link, &tn->tn_kvset_list);
-    if (!le || w->cw_compc < kvset_get_compc(le->le_kvset))
-        w->cw_compc++;
+    if (action == CN_ACTION_MIGRATE) {
+        const struct kvset_stats *stats = kvset_statsp(mark->le_kvset);
+        size_t alen = stats->kst_halen + stats->kst_kalen + stats->kst_valen;
+        size_t staged = kvset_get_staging_alen(mark->le_kvset);
+
+        /* A migrated kvset is a byte-for-byte copy of its source, so it
+         * retains the source's compc.  Charge (or credit) the staging
+         * estimate now so that subsequent selections respect the budget
+         * until the next heat check recomputes it.
+         */
+        if (rule == CN_RULE_HOT) {
+            w->cw_mclass = HSE_MCLASS_STAGING;
+            thresh->heat_staging_used += alen - staged;
+        } else {
+            w->cw_mclass = HSE_MCLASS_CAPACITY;
+            thresh->heat_staging_used -= min_t(size_t, staged, thresh->heat_staging_used);
+        }
+    } else {
+        /* If mark is at the end of the list or the compc of the first kvset
+         * past the mark is higher than the mark's then we can advance the
+         * compc for the new kvset.
+         */
+        le = list_next_entry_or_null(mark, le_link, &tn->tn_kvset_list);
+        if (!le || w->cw_compc < kvset_get_compc(le->le_kvset))
+            w->cw_compc++;
+    }
 
     cn_node_stats_get(tn, &w->cw_ns);
 
@@ -12,6 +12,7 @@
 #include <sys/types.h>
 
 #include <hse/error/merr.h>
+#include <hse/ikvdb/csched.h>
 
 /* MTF_MOCK_DECL(csched_sp3_work) */
 
@@ -52,20 +53,29 @@
 #define SP3_LCOMP_SPLIT_KEYS_MAX        (UINT_MAX)
 #define SP3_LCOMP_SPLIT_KEYS_DEFAULT    (256u << 20)
 
+/* Kvset heat thresholds.  A leaf kvset is migrated to the staging media
+ * class once its heat reaches csched_heat_hot, and becomes a candidate for
+ * eviction back to capacity once its heat decays below hot / SP3_HEAT_COLD_DIV.
+ */
+#define SP3_HEAT_COLD_DIV               (16u)
+
 /* clang-format on */
 
 struct sp3_node;
 struct cn_compaction_work;
+struct cn_tree_node;
+struct kvset_list_entry;
 
 /* The first work types up to but not including wtype_root are used to index
  * the work tree arrays, so be sure to add new work types before wtype_root.
  */
 enum sp3_work_type {
     wtype_length = 0u, /* leaf nodes: k-compact to reduce node length */
-    wtype_garbage,     /* leaf nodes: kv-compact to reduce garbage */
+    wtype_garbage,     /* leaf nodes: k/kv-compact to reduce garbage */
     wtype_scatter,     /* leaf nodes: kv-compact to reduce vgroup scatter */
     wtype_split,       /* leaf nodes: split to eliminate large nodes */
     wtype_join,        /* leaf nodes: join to eliminate small nodes */
+    wtype_heat,        /* leaf nodes: migrate kvsets between media classes by heat */
     wtype_idle,        /* root+leaf nodes: kv-compact idle nodes */
     wtype_root,        /* root node: spill to leaves */
     wtype_MAX
@@ -85,6 +95,11 @@ struct sp3_thresholds {
     uint8_t llen_idlec;
     uint8_t llen_idlem;
     uint8_t split_cnt_max; /* max node splits per batch */
+    uint8_t vgc_pct;       /* min kvset vblock garbage pct for value relocation */
+    uint64_t heat_hot;         /* min heat to promote a kvset to staging */
+    uint64_t heat_cold;        /* max heat to evict a kvset from staging */
+    size_t heat_staging_max;   /* staging budget (bytes), zero disables migration */
+    size_t heat_staging_used;  /* estimated staging bytes used by leaf kvsets */
 };
 
 /* MTF_MOCK */
@@ -102,6 +117,23 @@ sp3_work_joinable(struct cn_tree_node *right, const struct sp3_thresholds *thres
 bool
 sp3_work_splittable(struct cn_tree_node *tn, const struct sp3_thresholds *thresh);
 
+/**
+ * sp3_work_heat_candidate() - select a leaf kvset to migrate by heat
+ * @tn:     leaf node, caller must hold the tree lock
+ * @thresh: thresholds, including the current staging usage estimate
+ * @rule:   (out) CN_RULE_HOT to promote to staging, CN_RULE_COLD to evict
+ *
+ * Promotes the hottest kvset that fits within the staging budget, or, if
+ * the budget is exceeded, evicts the coldest kvset with blocks in staging.
+ *
+ * Return: the selected kvset's list entry, or NULL if there is none
+ */
+struct kvset_list_entry *
+sp3_work_heat_candidate(
+    struct cn_tree_node *tn,
+    const struct sp3_thresholds *thresh,
+    enum cn_rule *rule);
+
 #if HSE_MOCKING
 #include "csched_sp3_work_ut.h"
 #endif /* HSE_MOCKING */
@@ -15,6 +15,7 @@
 #include <hse/ikvdb/cn.h>
 #include <hse/ikvdb/kvset_builder.h>
 #include <hse/ikvdb/mclass_policy.h>
+#include <hse/ikvdb/rtomb.h>
 #include <hse/util/alloc.h>
 #include <hse/util/event_counter.h>
 #include <hse/util/hlog.h>
@@ -38,6 +39,10 @@ struct hblock_builder {
     unsigned int ptree_pgc;
     uint32_t max_size;
     uint32_t nptombs;
+    uint32_t nrtombs;
+    size_t rtombs_len;
+    size_t rtombs_sz;
+    uint8_t *rtombs;
     enum hse_mclass_policy_age agegroup;
 };
 
@@ -152,6 +157,102 @@ hbb_add_ptomb(
     return !added ? merr(EXFULL) : err;
 }
 
+merr_t
+hbb_add_rtomb(struct hblock_builder *bld, const struct rtomb *rt)
+{
+    struct rtomb_omf *omf;
+    size_t len, pgc;
+
+    len = RTOMB_OMF_LEN(rt->rt_slen, rt->rt_elen);
+
+    pgc = roundup(bld->rtombs_len + len, PAGE_SIZE) / PAGE_SIZE;
+    if (pgc + bld->ptree_pgc > available_pgc(bld))
+        return merr(EXFULL);
+
+    if (bld->rtombs_len + len > bld->rtombs_sz) {
+        size_t sz = max_t(size_t, bld->rtombs_sz * 2, PAGE_SIZE);
+        uint8_t *buf;
+
+        while (sz < bld->rtombs_len + len)
+            sz *= 2;
+
+        buf = realloc(bld->rtombs, sz);
+        if (ev(!buf))
+            return merr(ENOMEM);
+
+        bld->rtombs = buf;
+        bld->rtombs_sz = sz;
+    }
+
+    omf = (void *)(bld->rtombs + bld->rtombs_len);
+    memset(omf, 0, len);
+    omf_set_rto_seqno(omf, rt->rt_seqno);
+    omf_set_rto_slen(omf, rt->rt_slen);
+    omf_set_rto_elen(omf, rt->rt_elen);
+    memcpy(omf + 1, rt->rt_start, rt->rt_slen);
+    memcpy((uint8_t *)(omf + 1) + rt->rt_slen, rt->rt_end, rt->rt_elen);
+
+    bld->rtombs_len += len;
+    bld->nrtombs++;
+
+    return 0;
+}
+
+static int
+rtomb_omf_cmp(const void *lhs, const void *rhs)
+{
+    const struct rtomb_omf *a = *(const struct rtomb_omf **)lhs;
+    const struct rtomb_omf *b = *(const struct rtomb_omf **)rhs;
+
+    return keycmp(a + 1, omf_rto_slen(a), b + 1, omf_rto_slen(b));
+}
+
+/* Serialize the buffered range tombstones, sorted by start key, into a
+ * page aligned region suitable for the hblock.
+ */
+static merr_t
+rtombs_freeze(struct hblock_builder *bld, void **bufp, uint32_t *pgcp)
+{
+    const struct rtomb_omf **omfv;
+    uint8_t *buf, *cur;
+    size_t sz, off;
+    uint32_t i;
+
+    omfv = malloc(bld->nrtombs * sizeof(*omfv));
+    if (ev(!omfv))
+        return merr(ENOMEM);
+
+    for (off = 0, i = 0; i < bld->nrtombs; i++) {
+        omfv[i] = (void *)(bld->rtombs + off);
+        off += RTOMB_OMF_LEN(omf_rto_slen(omfv[i]), omf_rto_elen(omfv[i]));
+    }
+
+    qsort(omfv, bld->nrtombs, sizeof(*omfv), rtomb_omf_cmp);
+
+    sz = roundup(bld->rtombs_len, PAGE_SIZE);
+    buf = aligned_alloc(PAGE_SIZE, sz);
+    if (ev(!buf)) {
+        free(omfv);
+        return merr(ENOMEM);
+    }
+
+    memset(buf + bld->rtombs_len, 0, sz - bld->rtombs_len);
+
+    for (cur = buf, i = 0; i < bld->nrtombs; i++) {
+        size_t len = RTOMB_OMF_LEN(omf_rto_slen(omfv[i]), omf_rto_elen(omfv[i]));
+
+        memcpy(cur, omfv[i], len);
+        cur += len;
+    }
+
+    free(omfv);
+
+    *bufp = buf;
+    *pgcp = sz / PAGE_SIZE;
+
+    return 0;
+}
+
 merr_t
 hbb_create(struct hblock_builder **bld_out, const struct cn * const cn, struct perfc_set *pc)
 {
@@ -165,6 +266,10 @@ hbb_create(struct hblock_builder **bld_out, const struct cn * const cn, struct p
         return merr(ENOMEM);
 
     bld->nptombs = 0;
+    bld->nrtombs = 0;
+    bld->rtombs_len = 0;
+    bld->rtombs_sz = 0;
+    bld->rtombs = NULL;
     bld->mpool = cn_get_mpool(cn);
     bld->cn = cn;
     bld->pc = pc;
@@ -200,6 +305,7 @@ hbb_destroy(struct hblock_builder *bld)
         return;
 
     wbb_destroy(bld->ptree);
+    free(bld->rtombs);
     free(bld);
 }
 
@@ -223,7 +329,8 @@ hbb_finish(
     merr_t err;
     enum hse_mclass mclass;
     uint64_t blkid = 0;
-    uint32_t vgmap_pgc = 0;
+    uint32_t vgmap_pgc = 0, rtomb_pgc = 0;
+    void *rtombs = NULL;
     struct iovec *iov = NULL;
     unsigned int iov_max, iov_idx = 0;
     size_t wlen = 0, sz;
@@ -237,10 +344,10 @@ hbb_finish(
         return merr(EINVAL);
 
     /* In the event that no kblocks were emitted and there are no entries in the
-     * ptree, there is no data within containing kvset. Skip the allocation of
-     * the hblock. This kvset will not be written to disk.
+     * ptree nor any range tombstones, there is no data within containing kvset.
+     * Skip the allocation of the hblock. This kvset will not be written to disk.
      */
-    if (num_kblocks == 0 && (!wbb_entries(bld->ptree) && !ptree))
+    if (num_kblocks == 0 && (!wbb_entries(bld->ptree) && !ptree) && bld->nrtombs == 0)
         return 0;
 
     assert(!ptree || (ptree_desc && ptree_pgc > 0));
@@ -270,6 +377,9 @@ hbb_finish(
         iov_max += 1 + wbb_max_inodec_get(bld->ptree) + wbb_kmd_pgc_get(bld->ptree);
     }
 
+    if (bld->nrtombs > 0)
+        iov_max++;
+
     sz = HBLOCK_HDR_LEN + (vgmap ? (vgmap_pgc * PAGE_SIZE) : 0);
     hdr = aligned_alloc(PAGE_SIZE, sz);
     if (!hdr)
@@ -321,6 +431,21 @@ hbb_finish(
         hdr, min_seqno, max_seqno, num_ptombs, num_kblocks, num_vblocks, ptree_pgc, vgmap_pgc,
         min_pfxp, max_pfxp);
 
+    /* Range tombstones follow the prefix tombstone tree.
+     */
+    if (bld->nrtombs > 0) {
+        err = rtombs_freeze(bld, &rtombs, &rtomb_pgc);
+        if (err)
+            goto out;
+
+        iov[iov_idx].iov_base = rtombs;
+        iov[iov_idx++].iov_len = rtomb_pgc * PAGE_SIZE;
+
+        omf_set_hbh_rtomb_off_pg(hdr, HBLOCK_HDR_PAGES + vgmap_pgc + HLOG_PGC + ptree_pgc);
+        omf_set_hbh_rtomb_len_pg(hdr, rtomb_pgc);
+        omf_set_hbh_num_rtombs(hdr, bld->nrtombs);
+    }
+
     if (vgmap)
         make_vgroup_map(vgmap, ((char *)hdr) + HBLOCK_HDR_LEN);
 
@@ -355,6 +480,7 @@ out:
             mpool_mblock_delete(bld->mpool, blkid);
     }
 
+    free(rtombs);
     free(iov);
     free(hdr);
 
@@ -393,6 +519,12 @@ hbb_get_nptombs(const struct hblock_builder *bld)
     return bld->nptombs;
 }
 
+uint32_t
+hbb_get_nrtombs(const struct hblock_builder *bld)
+{
+    return bld->nrtombs;
+}
+
 #if HSE_MOCKING
 #include "hblock_builder_ut_impl.i"
 #endif /* HSE_MOCKING */
@@ -22,6 +22,7 @@ struct kvs_block;
 struct key_stats;
 struct vgmap;
 struct perfc_set;
+struct rtomb;
 struct wbt_desc;
 
 /* MTF_MOCK */
@@ -33,6 +34,17 @@ hbb_add_ptomb(
     unsigned int kmd_len,
     struct key_stats *stats);
 
+/**
+ * hbb_add_rtomb() - add a range tombstone to the hblock
+ * @bld: hblock builder
+ * @rt:  range tombstone, may be added in any order
+ *
+ * Return: EXFULL if the hblock has no room left for the range tombstone
+ */
+/* MTF_MOCK */
+merr_t
+hbb_add_rtomb(struct hblock_builder *bld, const struct rtomb *rt);
+
 /* MTF_MOCK */
 merr_t
 hbb_create(struct hblock_builder **bld_out, const struct cn *cn, struct perfc_set *pc);
@@ -65,6 +77,9 @@ hbb_set_agegroup(struct hblock_builder *bld, enum hse_mclass_policy_age age) HSE
 uint32_t
 hbb_get_nptombs(const struct hblock_builder *bld);
 
+uint32_t
+hbb_get_nrtombs(const struct hblock_builder *bld);
+
 #if HSE_MOCKING
 #include "hblock_builder_ut.h"
 #endif /* HSE_MOCKING */
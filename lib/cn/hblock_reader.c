@@ -9,8 +9,10 @@
 #include <errno.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 #include <hse/error/merr.h>
+#include <hse/ikvdb/rtomb.h>
 #include <hse/util/compiler.h>
 #include <hse/util/event_counter.h>
 
@@ -27,7 +29,9 @@ hblock_hdr_valid(const struct hblock_hdr_omf *omf)
     const uint32_t version = omf_hbh_version(omf);
     const uint32_t magic = omf_hbh_magic(omf);
 
-    return HSE_LIKELY(magic == HBLOCK_HDR_MAGIC && version == HBLOCK_HDR_VERSION);
+    return HSE_LIKELY(
+        magic == HBLOCK_HDR_MAGIC && version >= HBLOCK_HDR_VERSION1 &&
+        version <= HBLOCK_HDR_VERSION);
 }
 
 void
@@ -187,6 +191,64 @@ hbr_read_ptree(
     *ptree_pgc = ptd->wbd_n_pages;
 }
 
+merr_t
+hbr_read_rtombs(const struct kvs_mblk_desc *hbd, struct rtomb **rtvp, uint32_t *cntp)
+{
+    const struct hblock_hdr_omf *hb_hdr = hbd->map_base;
+    const uint8_t *cur, *end;
+    struct rtomb *rtv;
+    uint32_t cnt;
+
+    *rtvp = NULL;
+    *cntp = 0;
+
+    /* Version 1 hblocks predate range tombstones.
+     */
+    if (omf_hbh_version(hb_hdr) < HBLOCK_HDR_VERSION2)
+        return 0;
+
+    cnt = omf_hbh_num_rtombs(hb_hdr);
+    if (cnt == 0)
+        return 0;
+
+    if (ev(omf_hbh_rtomb_off_pg(hb_hdr) + omf_hbh_rtomb_len_pg(hb_hdr) > hbd->wlen_pages))
+        return merr(EPROTO);
+
+    rtv = malloc(cnt * sizeof(*rtv));
+    if (ev(!rtv))
+        return merr(ENOMEM);
+
+    cur = hbd->map_base + (omf_hbh_rtomb_off_pg(hb_hdr) * PAGE_SIZE);
+    end = cur + (omf_hbh_rtomb_len_pg(hb_hdr) * PAGE_SIZE);
+
+    for (uint32_t i = 0; i < cnt; i++) {
+        const struct rtomb_omf *omf = (const void *)cur;
+        struct rtomb *rt = rtv + i;
+
+        if (ev(cur + sizeof(*omf) > end)) {
+            free(rtv);
+            return merr(EPROTO);
+        }
+
+        rt->rt_seqno = omf_rto_seqno(omf);
+        rt->rt_slen = omf_rto_slen(omf);
+        rt->rt_elen = omf_rto_elen(omf);
+        rt->rt_start = omf + 1;
+        rt->rt_end = (const uint8_t *)(omf + 1) + rt->rt_slen;
+
+        cur += RTOMB_OMF_LEN(rt->rt_slen, rt->rt_elen);
+        if (ev(cur > end)) {
+            free(rtv);
+            return merr(EPROTO);
+        }
+    }
+
+    *rtvp = rtv;
+    *cntp = cnt;
+
+    return 0;
+}
+
 #if HSE_MOCKING
 #include "hblock_reader_ut_impl.i"
 #endif /* HSE_MOCKING */
@@ -15,6 +15,7 @@
 #include <hse/util/compiler.h>
 
 struct kvs_mblk_desc;
+struct rtomb;
 struct wbt_desc;
 struct vgmap;
 
@@ -120,6 +121,16 @@ hbr_read_ptree(
     uint8_t **ptree,
     uint32_t *ptree_pgc);
 
+/**
+ * hbr_read_rtombs() - read the range tombstones of an hblock
+ * @hbd:  hblock descriptor
+ * @rtvp: (output) vector of rtombs sorted by start key, to be freed by the
+ *        caller; the rtomb keys point into the hblock's mapping
+ * @cntp: (output) number of rtombs in @rtvp
+ */
+merr_t
+hbr_read_rtombs(const struct kvs_mblk_desc *hbd, struct rtomb **rtvp, uint32_t *cntp);
+
 #if HSE_MOCKING
 #include "hblock_reader_ut.h"
 #endif /* HSE_MOCKING */
@@ -0,0 +1,269 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <sys/mman.h>
+
+#include <hse/ikvdb/kvdb_perfc.h>
+#include <hse/util/assert.h>
+#include <hse/util/event_counter.h>
+#include <hse/util/list.h>
+#include <hse/util/mutex.h>
+#include <hse/util/page.h>
+#include <hse/util/perfc.h>
+
+#include "hpcache.h"
+
+/* clang-format off */
+
+#define HPCACHE_RGN_PAGES   (HPCACHE_RGN_SZ / PAGE_SIZE)
+#define HPCACHE_MAP_BITS    (sizeof(uint64_t) * CHAR_BIT)
+
+/* clang-format on */
+
+/**
+ * struct hpcache_region - a huge page from which allocations are carved
+ * @hr_link:    link on the cache's region list
+ * @hr_base:    base address of the region
+ * @hr_nfree:   number of free pages in the region
+ * @hr_hugetlb: region was mapped from the hugetlbfs pool
+ * @hr_freemap: bitmap of free pages (a set bit is a free page)
+ * @hr_lenv:    length in pages of the allocation starting at each page
+ */
+struct hpcache_region {
+    struct list_head hr_link;
+    void            *hr_base;
+    uint             hr_nfree;
+    bool             hr_hugetlb;
+    uint64_t         hr_freemap[HPCACHE_RGN_PAGES / HPCACHE_MAP_BITS];
+    uint16_t         hr_lenv[HPCACHE_RGN_PAGES];
+};
+
+/**
+ * struct hpcache - huge page backed memory cache
+ * @hpc_lock:   protects all fields and the regions' free maps
+ * @hpc_rgnl:   list of regions in existence
+ * @hpc_rgnc:   number of regions in existence
+ * @hpc_rgnmax: max number of regions allowed by the budget
+ *
+ * Allocations are only ever made at kvset open and preload, so a mutex
+ * suffices.
+ *
+ * An allocation is a run of contiguous pages, placed first-fit in the
+ * first region with a large enough run of free pages.  Freed pages are
+ * available for reuse immediately, regardless of what else is still live
+ * in their region.  Once all of a region's pages are free the region is
+ * released, returning its slot to the budget, unless it's the last one.
+ */
+struct hpcache {
+    struct mutex     hpc_lock;
+    struct list_head hpc_rgnl;
+    size_t           hpc_rgnc;
+    size_t           hpc_rgnmax;
+};
+
+static inline bool
+hpcache_page_isfree(const struct hpcache_region *rgn, uint pg)
+{
+    return rgn->hr_freemap[pg / HPCACHE_MAP_BITS] & (1ul << (pg % HPCACHE_MAP_BITS));
+}
+
+static void
+hpcache_pages_mark(struct hpcache_region *rgn, uint pg, uint npages, bool isfree)
+{
+    for (uint i = pg; i < pg + npages; i++) {
+        uint64_t mask = 1ul << (i % HPCACHE_MAP_BITS);
+
+        if (isfree)
+            rgn->hr_freemap[i / HPCACHE_MAP_BITS] |= mask;
+        else
+            rgn->hr_freemap[i / HPCACHE_MAP_BITS] &= ~mask;
+    }
+
+    if (isfree)
+        rgn->hr_nfree += npages;
+    else
+        rgn->hr_nfree -= npages;
+}
+
+/* Return the first page of the lowest run of @npages free pages in @rgn,
+ * or -1 if there is no such run.
+ */
+static int
+hpcache_region_find(const struct hpcache_region *rgn, uint npages)
+{
+    uint run = 0;
+
+    if (rgn->hr_nfree < npages)
+        return -1;
+
+    for (uint pg = 0; pg < HPCACHE_RGN_PAGES; pg++) {
+        run = hpcache_page_isfree(rgn, pg) ? run + 1 : 0;
+        if (run == npages)
+            return pg + 1 - npages;
+    }
+
+    return -1;
+}
+
+static struct hpcache_region *
+hpcache_region_create(struct hpcache *hpc)
+{
+    struct hpcache_region *rgn;
+
+    if (hpc->hpc_rgnc >= hpc->hpc_rgnmax)
+        return NULL;
+
+    rgn = calloc(1, sizeof(*rgn));
+    if (ev(!rgn))
+        return NULL;
+
+    rgn->hr_base = mmap(NULL, HPCACHE_RGN_SZ, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (rgn->hr_base != MAP_FAILED) {
+        rgn->hr_hugetlb = true;
+    } else {
+        /* No hugetlbfs pages reserved, fall back to transparent huge pages. */
+        rgn->hr_base = aligned_alloc(HPCACHE_RGN_SZ, HPCACHE_RGN_SZ);
+        if (ev(!rgn->hr_base)) {
+            free(rgn);
+            return NULL;
+        }
+
+        madvise(rgn->hr_base, HPCACHE_RGN_SZ, MADV_HUGEPAGE);
+    }
+
+    hpcache_pages_mark(rgn, 0, HPCACHE_RGN_PAGES, true);
+
+    list_add_tail(&rgn->hr_link, &hpc->hpc_rgnl);
+    hpc->hpc_rgnc++;
+
+    perfc_add(&kvdb_metrics_pc, PERFC_BA_KVDBMETRICS_HPCBYTES, HPCACHE_RGN_SZ);
+
+    return rgn;
+}
+
+static void
+hpcache_region_destroy(struct hpcache *hpc, struct hpcache_region *rgn)
+{
+    assert(rgn->hr_nfree == HPCACHE_RGN_PAGES);
+
+    if (rgn->hr_hugetlb)
+        munmap(rgn->hr_base, HPCACHE_RGN_SZ);
+    else
+        free(rgn->hr_base);
+
+    list_del(&rgn->hr_link);
+    hpc->hpc_rgnc--;
+    free(rgn);
+
+    perfc_sub(&kvdb_metrics_pc, PERFC_BA_KVDBMETRICS_HPCBYTES, HPCACHE_RGN_SZ);
+}
+
+merr_t
+hpcache_create(size_t budget, struct hpcache **hpcp)
+{
+    struct hpcache *hpc;
+
+    *hpcp = NULL;
+
+    if (budget < HPCACHE_RGN_SZ)
+        return 0;
+
+    hpc = calloc(1, sizeof(*hpc));
+    if (ev(!hpc))
+        return merr(ENOMEM);
+
+    mutex_init(&hpc->hpc_lock);
+    INIT_LIST_HEAD(&hpc->hpc_rgnl);
+    hpc->hpc_rgnmax = budget / HPCACHE_RGN_SZ;
+
+    *hpcp = hpc;
+
+    return 0;
+}
+
+void
+hpcache_destroy(struct hpcache *hpc)
+{
+    struct hpcache_region *rgn, *next;
+
+    if (!hpc)
+        return;
+
+    list_for_each_entry_safe(rgn, next, &hpc->hpc_rgnl, hr_link)
+        hpcache_region_destroy(hpc, rgn);
+
+    assert(hpc->hpc_rgnc == 0);
+
+    mutex_destroy(&hpc->hpc_lock);
+    free(hpc);
+}
+
+void *
+hpcache_alloc(struct hpcache *hpc, size_t len, struct hpcache_region **rgnp)
+{
+    struct hpcache_region *rgn;
+    uint npages;
+    int pg = -1;
+
+    len = ALIGN(len, PAGE_SIZE);
+    if (len == 0 || len > HPCACHE_RGN_SZ)
+        return NULL;
+
+    npages = len / PAGE_SIZE;
+
+    mutex_lock(&hpc->hpc_lock);
+    list_for_each_entry(rgn, &hpc->hpc_rgnl, hr_link) {
+        pg = hpcache_region_find(rgn, npages);
+        if (pg >= 0)
+            break;
+    }
+
+    if (pg < 0) {
+        rgn = hpcache_region_create(hpc);
+        if (!rgn) {
+            mutex_unlock(&hpc->hpc_lock);
+            return NULL;
+        }
+
+        pg = 0;
+    }
+
+    hpcache_pages_mark(rgn, pg, npages, false);
+    rgn->hr_lenv[pg] = npages;
+    mutex_unlock(&hpc->hpc_lock);
+
+    *rgnp = rgn;
+
+    return rgn->hr_base + (size_t)pg * PAGE_SIZE;
+}
+
+void
+hpcache_free(struct hpcache *hpc, struct hpcache_region *rgn, void *mem)
+{
+    uint pg;
+
+    if (!rgn)
+        return;
+
+    assert(mem >= rgn->hr_base && mem < rgn->hr_base + HPCACHE_RGN_SZ);
+
+    pg = (mem - rgn->hr_base) / PAGE_SIZE;
+
+    mutex_lock(&hpc->hpc_lock);
+    assert(rgn->hr_lenv[pg] > 0 && !hpcache_page_isfree(rgn, pg));
+
+    hpcache_pages_mark(rgn, pg, rgn->hr_lenv[pg], true);
+    rgn->hr_lenv[pg] = 0;
+
+    if (rgn->hr_nfree == HPCACHE_RGN_PAGES && hpc->hpc_rgnc > 1)
+        hpcache_region_destroy(hpc, rgn);
+    mutex_unlock(&hpc->hpc_lock);
+}
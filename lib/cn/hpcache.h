@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#ifndef HSE_KVS_CN_HPCACHE_H
+#define HSE_KVS_CN_HPCACHE_H
+
+#include <stddef.h>
+
+#include <hse/error/merr.h>
+
+/* clang-format off */
+
+#define HPCACHE_RGN_SZ      (2ul << 20)
+
+/* clang-format on */
+
+struct hpcache;
+struct hpcache_region;
+
+/**
+ * hpcache_create() - create a cache of huge page backed memory
+ * @budget: max bytes of huge page memory the cache may hold
+ * @hpc:    (output) cache handle, NULL if @budget is less than one region
+ *
+ * The cache holds copies of kblock and hblock index data (wbtree internal
+ * nodes and bloom filters), which are otherwise reached through 4K-page
+ * mblock mappings.  Memory is carved out of 2MiB regions, backed by
+ * hugetlbfs pages if available and transparent huge pages otherwise, and
+ * is managed in pages with a free bitmap per region.
+ */
+merr_t
+hpcache_create(size_t budget, struct hpcache **hpc);
+
+/**
+ * hpcache_destroy() - destroy a cache, all allocations must have been freed
+ * @hpc: cache handle (may be NULL)
+ */
+void
+hpcache_destroy(struct hpcache *hpc);
+
+/**
+ * hpcache_alloc() - allocate page aligned memory from the cache
+ * @hpc: cache handle
+ * @len: allocation size, at most HPCACHE_RGN_SZ
+ * @rgn: (output) region from which the memory was carved
+ *
+ * Return: the allocated memory, or NULL if the budget is exhausted
+ */
+void *
+hpcache_alloc(struct hpcache *hpc, size_t len, struct hpcache_region **rgn);
+
+/**
+ * hpcache_free() - release an allocation
+ * @hpc: cache handle
+ * @rgn: region returned by hpcache_alloc()
+ * @mem: memory returned by hpcache_alloc()
+ *
+ * The allocation's pages are available for reuse as soon as they are
+ * freed, even while other allocations in the region remain live.  A
+ * region is returned to the system once all of its pages are free,
+ * unless it is the cache's last region.
+ */
+void
+hpcache_free(struct hpcache *hpc, struct hpcache_region *rgn, void *mem);
+
+#endif
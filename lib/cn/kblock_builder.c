@@ -28,6 +28,7 @@
 #include <hse/util/page.h>
 #include <hse/util/perfc.h>
 #include <hse/util/slab.h>
+#include <hse/util/token_bucket.h>
 #include <hse/util/vlb.h>
 
 #include "blk_list.h"
@@ -184,6 +185,7 @@ struct kblock_builder {
     struct perfc_set *pc;
     struct hlog *composite_hlog;
     struct cn_merge_stats *mstats;
+    struct tbkt *tbkt;
     struct blk_list finished_kblks;
     struct curr_kblock curr;
     enum hse_mclass_policy_age agegroup;
@@ -359,6 +361,9 @@ mblk_blow_chunks(
         if (stats)
             count_ops(&stats->ms_kblk_write, 1, wlen, dt);
 
+        if (self->tbkt)
+            tbkt_throttle(self->tbkt, wlen);
+
         written += wlen;
 
         perfc_inc(self->pc, PERFC_RA_CNCOMP_WREQS);
@@ -1123,6 +1128,12 @@ kbb_set_merge_stats(struct kblock_builder *bld, struct cn_merge_stats *stats)
     bld->mstats = stats;
 }
 
+void
+kbb_set_tbkt(struct kblock_builder *bld, struct tbkt *tb)
+{
+    bld->tbkt = tb;
+}
+
 bool
 kbb_is_empty(struct kblock_builder *bld)
 {
@@ -21,6 +21,7 @@ struct kblock_builder;
 struct kblock_desc;
 struct key_stats;
 struct kvs_rparams;
+struct tbkt;
 struct wbti;
 
 enum hse_mclass;
@@ -127,10 +128,14 @@ kbb_set_agegroup(struct kblock_builder *bld, enum hse_mclass_policy_age age);
 void
 kbb_set_merge_stats(struct kblock_builder *bld, struct cn_merge_stats *stats);
 
+void
+kbb_set_tbkt(struct kblock_builder *bld, struct tbkt *tb);
+
 /* MTF_MOCK */
 bool
 kbb_is_empty(struct kblock_builder *bld);
 
+/* MTF_MOCK */
 void
 kbb_curr_kblk_min_max_keys(
     struct kblock_builder *bld,
@@ -10,6 +10,7 @@
 #include <hse/ikvdb/kvs_rparams.h>
 #include <hse/ikvdb/kvset_builder.h>
 #include <hse/ikvdb/limits.h>
+#include <hse/ikvdb/rtomb.h>
 #include <hse/ikvdb/tuple.h>
 #include <hse/logging/logging.h>
 #include <hse/util/event_counter.h>
@@ -51,6 +52,8 @@ kcompact(struct cn_compaction_work *w, struct kvset_builder *bldr)
     struct cn_kv_item *curr;
     struct bin_heap *bh = NULL;
     struct element_source **sources = NULL;
+    struct rtomb_vec rtombs;
+    uint *srcmap = NULL;
 
     enum kmd_vtype vtype;
     uint vbidx, vboff, vlen, complen;
@@ -63,6 +66,7 @@ kcompact(struct cn_compaction_work *w, struct kvset_builder *bldr)
 
     bool pt_set = false;
     uint64_t pt_seq = 0;
+    uint64_t rt_seq = 0;
     uint64_t tprog = 0;
 
     uint64_t dbg_prev_seq HSE_MAYBE_UNUSED;
@@ -77,6 +81,8 @@ kcompact(struct cn_compaction_work *w, struct kvset_builder *bldr)
      */
     w->cw_vbmap.vbm_used = 0;
 
+    rtomb_vec_init(&rtombs);
+
     if (w->cw_prog_interval && w->cw_progress)
         tprog = jiffies;
 
@@ -84,27 +90,37 @@ kcompact(struct cn_compaction_work *w, struct kvset_builder *bldr)
     if (ev(err))
         return err;
 
-    sources = malloc(w->cw_kvset_cnt * sizeof(*sources));
+    sources = malloc(w->cw_kvset_cnt * (sizeof(*sources) + sizeof(*srcmap)));
     if (!sources) {
         err = merr(ENOMEM);
         goto done;
     }
 
+    srcmap = (void *)(sources + w->cw_kvset_cnt);
+
     for (uint i = 0; i < w->cw_kvset_cnt; i++) {
         struct kv_iterator *iter = w->cw_inputv[i];
 
         sources[i] = kvset_iter_es_get(iter);
+        sources[i]->es_sort = -1;
     }
 
+    err = cn_compaction_rtombs(w, bldr, &rtombs);
+    if (ev(err))
+        goto done;
+
     err = bin_heap_prepare(bh, w->cw_kvset_cnt, sources);
     if (ev(err))
         goto done;
-    /* In the event this assert fails, at least one iterator is EOF and the idea
-     * that struct element_source::es_sort will properly index the vblock map is
-     * incorrect. Kvsets won't typically exist if they have no prefix tombstones
-     * or keys.
+
+    /* The bin heap skips iterators that are EOF at the outset (e.g., a kvset
+     * with only range tombstones), in which case element_source::es_sort no
+     * longer indexes the vblock map directly.
      */
-    assert(bin_heap_width(bh) == w->cw_kvset_cnt);
+    for (uint i = 0; i < w->cw_kvset_cnt; i++) {
+        if (sources[i]->es_sort >= 0)
+            srcmap[sources[i]->es_sort] = i;
+    }
 
     w->cw_stats.ms_srcs = w->cw_kvset_cnt;
 
@@ -137,6 +153,15 @@ kcompact(struct cn_compaction_work *w, struct kvset_builder *bldr)
         dbg_nvals_this_key = 0;
         dbg_dup = false;
 
+        rt_seq = 0;
+        if (rtombs.rv_cnt > 0) {
+            char kbuf[HSE_KVS_KEY_LEN_MAX];
+            uint klen;
+
+            key_obj_copy(kbuf, sizeof(kbuf), &klen, &curr->kobj);
+            rt_seq = rtomb_vec_lookup(&rtombs, kbuf, klen, w->cw_horizon);
+        }
+
     values:
         vdata = NULL;
         w->cw_stats.ms_keys_in++;
@@ -165,6 +190,9 @@ kcompact(struct cn_compaction_work *w, struct kvset_builder *bldr)
                 if (pt_set && seq < pt_seq)
                     continue; /* skip value */
 
+                if (rt_seq > seq)
+                    continue; /* skip value hidden by an rtomb */
+
                 if (vtype == VTYPE_PTOMB) {
                     pt_set = true;
                     pt_kobj = curr->kobj;
@@ -191,8 +219,18 @@ kcompact(struct cn_compaction_work *w, struct kvset_builder *bldr)
                 switch (vtype) {
                 case VTYPE_UCVAL:
                 case VTYPE_CVAL:
+                    if (w->cw_vreloc && w->cw_vreloc[srcmap[idx]]) {
+                        /* The source vblocks are mostly garbage, copy the live value. */
+                        err = kvset_iter_val_get(
+                            iter, &curr->vctx, vtype, vbidx, vboff, &vdata, &vlen, &complen);
+                        if (!err)
+                            err = kvset_builder_add_val(
+                                bldr, &curr->kobj, vdata, vlen, seq, complen);
+                        break;
+                    }
+
                     err = kvset_builder_add_vref(
-                        bldr, seq, vbidx + w->cw_vbmap.vbm_map[idx], vboff, vlen, complen);
+                        bldr, seq, vbidx + w->cw_vbmap.vbm_map[srcmap[idx]], vboff, vlen, complen);
                     break;
                 case VTYPE_ZVAL:
                 case VTYPE_IVAL:
@@ -211,7 +249,9 @@ kcompact(struct cn_compaction_work *w, struct kvset_builder *bldr)
                 else
                     emitted_seq = seq;
 
-                if (complen) {
+                if (w->cw_vreloc && w->cw_vreloc[srcmap[idx]]) {
+                    w->cw_stats.ms_val_bytes_out += complen ? complen : vlen;
+                } else if (complen) {
                     w->cw_stats.ms_val_bytes_out += complen;
                     w->cw_vbmap.vbm_used += complen;
                 } else {
@@ -284,6 +324,7 @@ kcompact(struct cn_compaction_work *w, struct kvset_builder *bldr)
 done:
     w->cw_vbmap.vbm_waste = w->cw_vbmap.vbm_tot - w->cw_vbmap.vbm_used;
     bin_heap_destroy(bh);
+    rtomb_vec_fini(&rtombs);
     free(sources);
 
     if (seqno_errcnt)
@@ -312,31 +353,40 @@ cn_kcompact(struct cn_compaction_work *w)
         goto done;
 
     kvset_builder_set_merge_stats(bldr, &w->cw_stats);
-
-    err = kcompact(w, bldr);
-    if (ev(err))
-        goto done;
+    kvset_builder_set_tbkt(bldr, w->cw_tbkt_wr);
 
     /* During k-compaction, vblocks will not be generated. Instead, they will be
-     * inherited from the input kvsets.
+     * inherited from the input kvsets.  The exception is values relocated out
+     * of sparse source vblocks, which are written to new vblocks that follow
+     * the adopted vblocks, hence the vblocks must be adopted before merging.
+     * The vblock map (which shares the vbm_blkv allocation) remains valid
+     * until the builder is finished.
      */
     if (w->cw_vbmap.vbm_blkc > 0) {
         struct vgmap *vgmap = w->cw_vgmap[0];
 
-        assert(vgmap && w->cw_input_vgroups == vgmap->nvgroups);
+        assert(vgmap);
+        assert(w->cw_vreloc || w->cw_input_vgroups == vgmap->nvgroups);
         kvset_builder_adopt_vblocks(
             bldr, w->cw_vbmap.vbm_blkc, w->cw_vbmap.vbm_blkv, w->cw_vbmap.vbm_tot, vgmap);
         w->cw_vgmap[0] = NULL; /* reset after adopting the vgmap to the kvset builder */
 
         w->cw_vbmap.vbm_blkv = NULL;
-        w->cw_vbmap.vbm_blkc = 0;
     }
 
+    err = kcompact(w, bldr);
+    if (ev(err))
+        goto done;
+
     /* get resulting mblocks */
     err = kvset_builder_get_mblocks(bldr, w->cw_outv);
     if (ev(err))
         goto done;
 
+    if (w->cw_outv->vblks.idc > w->cw_vbmap.vbm_blkc)
+        w->cw_vreloc_vblks = w->cw_outv->vblks.idc - w->cw_vbmap.vbm_blkc;
+    w->cw_vbmap.vbm_blkc = 0;
+
 done:
     kvset_builder_destroy(bldr);
 
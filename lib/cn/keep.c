@@ -17,7 +17,8 @@ kvset_keep_vblocks(
     struct kvset_vblk_map *vbm,
     struct vgmap **vgm_out,
     struct kv_iterator **iv,
-    int niv)
+    int niv,
+    const bool *relocv)
 {
     struct vgmap *vgm = NULL;
     void *mem;
@@ -34,6 +35,9 @@ kvset_keep_vblocks(
     for (int i = 0; i < niv; ++i) {
         struct kvset *kvset = kvset_from_iter(iv[i]);
 
+        if (relocv && relocv[i])
+            continue;
+
         nv += kvset_get_num_vblocks(kvset);
         nvg += kvset_get_vgroups(kvset);
     }
@@ -80,6 +84,9 @@ kvset_keep_vblocks(
      * and waste start as zero: there is no waste in ingest, kv-compact
      * or spill.  If this node has been previously k-compacted, then
      * waste may be >= 0, and this cycle adds to the waste count.
+     *
+     * The vblocks of sources flagged in relocv are not kept, their live
+     * values are copied into new vblocks by the compaction instead.
      */
 
     nv = 0;
@@ -91,6 +98,9 @@ kvset_keep_vblocks(
 
         vbm->vbm_map[i] = nv;
 
+        if (relocv && relocv[i])
+            continue;
+
         for (uint32_t j = 0; j < cnt; ++j) {
             vbm->vbm_blkv[nv] = kvset_get_nth_vblock_id(kvset, j);
             vbm->vbm_tot += kvset_get_nth_vblock_wlen(kvset, j);
@@ -10,6 +10,7 @@
 #include <hse/ikvdb/kvs_rparams.h>
 #include <hse/ikvdb/kvset_builder.h>
 #include <hse/ikvdb/limits.h>
+#include <hse/ikvdb/rtomb.h>
 #include <hse/ikvdb/tuple.h>
 #include <hse/logging/logging.h>
 #include <hse/util/alloc.h>
@@ -112,6 +113,8 @@ cn_kvcompact(struct cn_compaction_work *w)
     bool more;
     struct cn_kv_item *curr = NULL;
     struct element_source **bh_sources;
+    struct rtomb_vec rtombs;
+    uint64_t rt_seq = 0;
 
     assert(w->cw_kvset_cnt);
     assert(w->cw_inputv);
@@ -120,6 +123,8 @@ cn_kvcompact(struct cn_compaction_work *w)
     if (!bh_sources)
         return merr(ENOMEM);
 
+    rtomb_vec_init(&rtombs);
+
     err = bin_heap_create(w->cw_kvset_cnt, kv_item_compare, &bh);
     if (err)
         goto out;
@@ -142,11 +147,16 @@ cn_kvcompact(struct cn_compaction_work *w)
         goto out;
 
     kvset_builder_set_merge_stats(bldr, &w->cw_stats);
+    kvset_builder_set_tbkt(bldr, w->cw_tbkt_wr);
 
     err = kvset_builder_set_agegroup(bldr, HSE_MPOLICY_AGE_LEAF);
     if (err)
         goto out;
 
+    err = cn_compaction_rtombs(w, bldr, &rtombs);
+    if (err)
+        goto out;
+
     new_key = true;
 
     tstart = perfc_ison(w->cw_pc, PERFC_DI_CNCOMP_VGET) ? 1 : 0;
@@ -179,6 +189,15 @@ cn_kvcompact(struct cn_compaction_work *w)
             emitted_seq = 0;
             emitted_seq_pt = 0;
 
+            rt_seq = 0;
+            if (rtombs.rv_cnt > 0) {
+                char kbuf[HSE_KVS_KEY_LEN_MAX];
+                uint klen;
+
+                key_obj_copy(kbuf, sizeof(kbuf), &klen, &curr->kobj);
+                rt_seq = rtomb_vec_lookup(&rtombs, kbuf, klen, w->cw_horizon);
+            }
+
             dbg_prev_seq = 0;
             dbg_prev_idx = 0;
             dbg_nvals_this_key = 0;
@@ -238,6 +257,9 @@ cn_kvcompact(struct cn_compaction_work *w)
             if (bg_val && pt_set && w->cw_horizon >= pt_seq && pt_seq > seq)
                 break; /* drop val if it and pt are beyond horizon */
 
+            if (rt_seq > seq)
+                break; /* drop val hidden by an rtomb beyond horizon */
+
             /* Set ptomb context irrespective of bg_val for tombstone propagation */
             if (HSE_CORE_IS_PTOMB(vdata)) {
                 pt_set = true;
@@ -354,6 +376,7 @@ cn_kvcompact(struct cn_compaction_work *w)
 out:
     kvset_builder_destroy(bldr);
     bin_heap_destroy(bh);
+    rtomb_vec_fini(&rtombs);
     free(bh_sources);
     free(buf);
 
@@ -14,7 +14,9 @@
 #include <hse/ikvdb/cn.h>
 #include <hse/ikvdb/cn_kvdb.h>
 #include <hse/ikvdb/ikvdb.h>
+#include <hse/ikvdb/kvdb_perfc.h>
 #include <hse/ikvdb/kvs_rparams.h>
+#include <hse/ikvdb/rtomb.h>
 #include <hse/ikvdb/tuple.h>
 #include <hse/logging/logging.h>
 #include <hse/util/alloc.h>
@@ -28,8 +30,11 @@
 #include <hse/util/mutex.h>
 #include <hse/util/page.h>
 #include <hse/util/perfc.h>
+#include <hse/util/rtrace.h>
 #include <hse/util/slab.h>
+#include <hse/util/token_bucket.h>
 #include <hse/util/vlb.h>
+#include <hse/util/xrand.h>
 
 #include "kvs_mblk_desc.h"
 #include "vblock_reader.h"
@@ -48,6 +53,7 @@
 #include "cn_tree.h"
 #include "cn_tree_internal.h"
 #include "hblock_reader.h"
+#include "hpcache.h"
 #include "kblock_reader.h"
 #include "kcompact.h"
 #include "kv_iterator.h"
@@ -298,8 +304,33 @@ kvset_hblk_init(
     return 0;
 }
 
+static void
+kvset_kblk_preload(struct kvs_rparams *rp, struct kvset_kblk *p)
+{
+    struct kvs_mblk_desc *kbd = &p->kb_kblk_desc;
+
+    /* Preload the wbtree nodes.
+     */
+    if (rp->cn_mcache_wbt > 0) {
+        kbr_madvise_wbt_int_nodes(kbd, &p->kb_wbt_desc, MADV_WILLNEED);
+
+        if (rp->cn_mcache_wbt > 1)
+            kbr_madvise_wbt_leaf_nodes(kbd, &p->kb_wbt_desc, MADV_WILLNEED);
+    }
+
+    /* Preload the bloom filter.
+     */
+    if (rp->cn_bloom_preload)
+        kbr_madvise_bloom(kbd, &p->kb_blm_desc, MADV_WILLNEED);
+}
+
 static merr_t
-kvset_kblk_init(struct kvs_rparams *rp, struct mpool *ds, uint64_t mbid, struct kvset_kblk *p)
+kvset_kblk_init(
+    struct kvs_rparams *rp,
+    struct mpool *ds,
+    uint64_t mbid,
+    bool preload,
+    struct kvset_kblk *p)
 {
     struct kvs_mblk_desc *kbd = &p->kb_kblk_desc;
     struct kblock_hdr_omf *hdr;
@@ -346,21 +377,247 @@ kvset_kblk_init(struct kvs_rparams *rp, struct mpool *ds, uint64_t mbid, struct
 
     p->kb_hlog = (uint8_t *)hdr + (omf_kbh_hlog_doff_pg(hdr) * PAGE_SIZE);
 
-    /* Preload the wbtree nodes.
+    /* Kvsets restored from the cndb are preloaded by kvset_preload()
+     * after cn_open() returns.
      */
-    if (rp->cn_mcache_wbt > 0) {
-        kbr_madvise_wbt_int_nodes(kbd, &p->kb_wbt_desc, MADV_WILLNEED);
+    if (preload)
+        kvset_kblk_preload(rp, p);
 
-        if (rp->cn_mcache_wbt > 1)
-            kbr_madvise_wbt_leaf_nodes(kbd, &p->kb_wbt_desc, MADV_WILLNEED);
+    return 0;
+}
+
+static_assert(
+    sizeof(((struct kvset_snap_kblk_omf *)0)->ksk_keys) ==
+        sizeof(((struct kvset_kblk *)0)->kb_ksmall),
+    "kvset snapshot key buffer must match kb_ksmall");
+
+/* Initialize a kblock from its kvset snapshot entry rather than from its
+ * header.  The caller must have checked that the entry describes @p's
+ * kblock and that its keys fit in p->kb_ksmall.
+ */
+static merr_t
+kvset_kblk_init_snap(
+    struct kvs_rparams *rp,
+    struct mpool *ds,
+    const struct kvset_snap_kblk_omf *ksk,
+    bool preload,
+    struct kvset_kblk *p)
+{
+    struct kvs_mblk_desc *kbd = &p->kb_kblk_desc;
+    struct wbt_desc *wbd = &p->kb_wbt_desc;
+    struct bloom_desc *bd = &p->kb_blm_desc;
+    struct kblk_metrics *m = &p->kb_metrics;
+    merr_t err;
+
+    err = mblk_mmap(ds, omf_ksk_mbid(ksk), kbd);
+    if (ev(err))
+        return err;
+
+    wbd->wbd_first_page = omf_ksk_wbt_doff_pg(ksk);
+    wbd->wbd_n_pages = omf_ksk_wbt_dlen_pg(ksk);
+    wbd->wbd_root = omf_ksk_wbt_root(ksk);
+    wbd->wbd_leaf = omf_ksk_wbt_leaf(ksk);
+    wbd->wbd_leaf_cnt = omf_ksk_wbt_leaf_cnt(ksk);
+    wbd->wbd_kmd_pgc = omf_ksk_wbt_kmd_pgc(ksk);
+    wbd->wbd_version = omf_ksk_wbt_version(ksk);
+    wbd->wbd_ine_base = NULL;
+
+    memset(bd, 0, sizeof(*bd));
+    bd->bd_first_page = omf_ksk_blm_doff_pg(ksk);
+    bd->bd_n_pages = omf_ksk_blm_dlen_pg(ksk);
+    bd->bd_modulus = omf_ksk_blm_modulus(ksk);
+    bd->bd_bktshift = omf_ksk_blm_bktshift(ksk);
+    bd->bd_n_hashes = omf_ksk_blm_n_hashes(ksk);
+    bd->bd_rotl = omf_ksk_blm_rotl(ksk);
+    bd->bd_bktmask = (1u << bd->bd_bktshift) - 1;
+
+    if (bd->bd_n_pages)
+        bd->bd_bitmap = (void *)kbd->map_base + bd->bd_first_page * PAGE_SIZE;
+
+    m->num_keys = omf_ksk_entries(ksk);
+    m->num_tombstones = omf_ksk_tombs(ksk);
+    m->tot_key_bytes = omf_ksk_key_bytes(ksk);
+    m->tot_val_bytes = omf_ksk_val_bytes(ksk);
+    m->tot_kvlen = omf_ksk_kvlen(ksk);
+    m->tot_vused_bytes = omf_ksk_vused_bytes(ksk);
+    m->tot_wbt_pages = wbd->wbd_n_pages;
+    m->tot_blm_pages = bd->bd_n_pages;
+
+    p->kb_klen_max = omf_ksk_max_klen(ksk);
+    p->kb_klen_min = omf_ksk_min_klen(ksk);
+
+    memcpy(p->kb_ksmall, ksk->ksk_keys, p->kb_klen_max + p->kb_klen_min);
+    p->kb_koff_max = p->kb_ksmall;
+    p->kb_koff_min = p->kb_ksmall + p->kb_klen_max;
+
+    key_disc_init(p->kb_koff_max, p->kb_klen_max, &p->kb_kdisc_max);
+    key_disc_init(p->kb_koff_min, p->kb_klen_min, &p->kb_kdisc_min);
+
+    p->kb_hlog = (uint8_t *)kbd->map_base + (omf_ksk_hlog_doff_pg(ksk) * PAGE_SIZE);
+
+    if (preload)
+        kvset_kblk_preload(rp, p);
+
+    return 0;
+}
+
+/* Copy the wbtree internal nodes and the bloom filter of a kblock into
+ * huge page backed memory, so that point lookups don't take a TLB miss
+ * per node visited.  Leaves and kmd are too large to be worth copying
+ * and remain in the mblock mapping.  Kblocks that don't fit within the
+ * remaining budget are skipped.
+ *
+ * Restored kvsets are loaded by kvset_preload() after they have become
+ * visible to readers, so the copies are published with release semantics
+ * and readers fall back to the mblock mapping until they see them.
+ */
+static void
+kvset_kblk_hpcache_load(struct hpcache *hpc, struct kvset_kblk *p)
+{
+    struct wbt_desc *wbd = &p->kb_wbt_desc;
+    struct bloom_desc *bd = &p->kb_blm_desc;
+    const void *base = p->kb_kblk_desc.map_base;
+    size_t inec = 0, blmc = 0;
+    void *mem;
+
+    if (p->kb_hpc_rgn)
+        return;
+
+    if (wbd->wbd_n_pages && wbd->wbd_root >= wbd->wbd_leaf_cnt)
+        inec = wbd->wbd_root + 1 - wbd->wbd_leaf_cnt;
+
+    if (bd->bd_bitmap)
+        blmc = bd->bd_n_pages;
+
+    if (inec + blmc == 0)
+        return;
+
+    mem = hpcache_alloc(hpc, (inec + blmc) * PAGE_SIZE, &p->kb_hpc_rgn);
+    if (!mem) {
+        perfc_inc(&kvdb_metrics_pc, PERFC_RA_KVDBMETRICS_HPCSKIP);
+        return;
     }
 
-    /* Preload the bloom filter.
+    p->kb_hpc_mem = mem;
+
+    if (inec > 0)
+        memcpy(mem, base + (wbd->wbd_first_page + wbd->wbd_leaf_cnt) * PAGE_SIZE,
+               inec * PAGE_SIZE);
+
+    if (blmc > 0)
+        memcpy(mem + inec * PAGE_SIZE, bd->bd_bitmap, blmc * PAGE_SIZE);
+
+    atomic_thread_fence(memory_order_release);
+
+    if (inec > 0)
+        wbd->wbd_ine_base = mem;
+
+    if (blmc > 0)
+        bd->bd_bitmap = mem + inec * PAGE_SIZE;
+
+    perfc_inc(&kvdb_metrics_pc, PERFC_BA_KVDBMETRICS_HPCKBLKS);
+}
+
+static bool
+kvset_kblk_snap_usable(const struct kvset_snap_kblk_omf *ksk, uint64_t mbid)
+{
+    return omf_ksk_mbid(ksk) == mbid &&
+           omf_ksk_max_klen(ksk) + omf_ksk_min_klen(ksk) <= sizeof(ksk->ksk_keys);
+}
+
+/* Return the kblock entries of the kvset snapshot in @km, or NULL if
+ * there is no snapshot or it doesn't match the kvset.
+ */
+static const struct kvset_snap_kblk_omf *
+kvset_snap_kblkv(const struct kvset_meta *km, uint32_t n_kblks)
+{
+    const struct kvset_snap_omf *snap = km->km_snap;
+
+    if (!snap)
+        return NULL;
+
+    if (km->km_snaplen != sizeof(*snap) + n_kblks * sizeof(struct kvset_snap_kblk_omf))
+        return NULL;
+
+    if (omf_ksn_magic(snap) != KVSET_SNAP_MAGIC || omf_ksn_version(snap) != KVSET_SNAP_VERSION ||
+        omf_ksn_kblk_cnt(snap) != n_kblks)
+        return NULL;
+
+    return (const void *)(snap + 1);
+}
+
+static void
+kvset_kblk_snap(const struct kvset_kblk *p, struct kvset_snap_kblk_omf *ksk)
+{
+    const struct kvs_mblk_desc *kbd = &p->kb_kblk_desc;
+    const struct wbt_desc *wbd = &p->kb_wbt_desc;
+    const struct bloom_desc *bd = &p->kb_blm_desc;
+    const struct kblk_metrics *m = &p->kb_metrics;
+
+    omf_set_ksk_mbid(ksk, kbd->mbid);
+    omf_set_ksk_key_bytes(ksk, m->tot_key_bytes);
+    omf_set_ksk_val_bytes(ksk, m->tot_val_bytes);
+    omf_set_ksk_kvlen(ksk, m->tot_kvlen);
+    omf_set_ksk_vused_bytes(ksk, m->tot_vused_bytes);
+    omf_set_ksk_entries(ksk, m->num_keys);
+    omf_set_ksk_tombs(ksk, m->num_tombstones);
+    omf_set_ksk_hlog_doff_pg(ksk, (p->kb_hlog - (const uint8_t *)kbd->map_base) / PAGE_SIZE);
+
+    omf_set_ksk_wbt_doff_pg(ksk, wbd->wbd_first_page);
+    omf_set_ksk_wbt_dlen_pg(ksk, wbd->wbd_n_pages);
+    omf_set_ksk_wbt_root(ksk, wbd->wbd_root);
+    omf_set_ksk_wbt_leaf(ksk, wbd->wbd_leaf);
+    omf_set_ksk_wbt_leaf_cnt(ksk, wbd->wbd_leaf_cnt);
+    omf_set_ksk_wbt_kmd_pgc(ksk, wbd->wbd_kmd_pgc);
+    omf_set_ksk_wbt_version(ksk, wbd->wbd_version);
+
+    omf_set_ksk_blm_doff_pg(ksk, bd->bd_first_page);
+    omf_set_ksk_blm_dlen_pg(ksk, bd->bd_n_pages);
+    omf_set_ksk_blm_modulus(ksk, bd->bd_modulus);
+    omf_set_ksk_blm_bktshift(ksk, bd->bd_bktshift);
+    omf_set_ksk_blm_n_hashes(ksk, bd->bd_n_hashes);
+    omf_set_ksk_blm_rotl(ksk, bd->bd_rotl);
+
+    /* Keys that aren't in kb_ksmall are left out, which makes the entry
+     * unusable by kvset_kblk_snap_usable().
      */
-    if (rp->cn_bloom_preload)
-        kbr_madvise_bloom(kbd, &p->kb_blm_desc, MADV_WILLNEED);
+    omf_set_ksk_max_klen(ksk, p->kb_klen_max);
+    omf_set_ksk_min_klen(ksk, p->kb_klen_min);
 
-    return 0;
+    if (p->kb_koff_max == p->kb_ksmall)
+        memcpy(ksk->ksk_keys, p->kb_ksmall, p->kb_klen_max + p->kb_klen_min);
+}
+
+/* Hand the cndb a snapshot of the kvset's kblock descriptors, to be
+ * persisted at the next cndb compaction.
+ */
+static void
+kvset_snap_save(struct kvset *ks)
+{
+    struct kvset_snap_kblk_omf *kskv;
+    struct kvset_snap_omf *snap;
+    size_t sz;
+    merr_t err;
+
+    sz = sizeof(*snap) + ks->ks_st.kst_kblks * sizeof(*kskv);
+
+    snap = calloc(1, sz);
+    if (ev(!snap))
+        return;
+
+    omf_set_ksn_magic(snap, KVSET_SNAP_MAGIC);
+    omf_set_ksn_version(snap, KVSET_SNAP_VERSION);
+    omf_set_ksn_kblk_cnt(snap, ks->ks_st.kst_kblks);
+
+    kskv = (void *)(snap + 1);
+
+    for (uint32_t i = 0; i < ks->ks_st.kst_kblks; i++)
+        kvset_kblk_snap(ks->ks_kblks + i, kskv + i);
+
+    err = cndb_kvset_snap_set(ks->ks_cndb, ks->ks_cnid, ks->ks_kvsetid, snap, sz);
+    ev(err);
+
+    free(snap);
 }
 
 static merr_t
@@ -369,6 +626,33 @@ vblock_udata_init(const struct kvs_mblk_desc *mblk, void *rock)
     return vbr_desc_read(mblk, rock);
 }
 
+/* Widen the kvset's min/max keys to include its range tombstones so that
+ * lookups, spills and cursors do not prune a kvset whose rtombs cover the
+ * target key.  The exclusive end key is used as the max key, which may
+ * overstate the range a little but is always safe.
+ */
+static void
+kvset_rtomb_bounds(struct kvset *ks, bool init)
+{
+    for (uint32_t i = 0; i < ks->ks_rtombc; i++) {
+        const struct rtomb *rt = ks->ks_rtombs + i;
+
+        if (init || keycmp(rt->rt_start, rt->rt_slen, ks->ks_minkey, ks->ks_minklen) < 0) {
+            ks->ks_minkey = rt->rt_start;
+            ks->ks_minklen = rt->rt_slen;
+            key_disc_init(rt->rt_start, rt->rt_slen, &ks->ks_kdisc_min);
+        }
+
+        if (init || keycmp(rt->rt_end, rt->rt_elen, ks->ks_maxkey, ks->ks_maxklen) > 0) {
+            ks->ks_maxkey = rt->rt_end;
+            ks->ks_maxklen = rt->rt_elen;
+            key_disc_init(rt->rt_end, rt->rt_elen, &ks->ks_kdisc_max);
+        }
+
+        init = false;
+    }
+}
+
 merr_t
 kvset_open2(
     struct cn_tree *tree,
@@ -389,6 +673,7 @@ kvset_open2(
     size_t kcachesz;
     const uint32_t n_kblks = km->km_kblk_list.idc;
     const uint32_t n_vblks = km->km_vblk_list.idc;
+    const struct kvset_snap_kblk_omf *snapv;
     uint vbsetc;
     uint32_t last_kb;
 
@@ -470,6 +755,7 @@ kvset_open2(
 
     /* initialize atomics */
     atomic_set(&ks->ks_ref, 0);
+    atomic_set(&ks->ks_heat, 0);
     atomic_set(&ks->ks_delete_error, 0);
     atomic_set(&ks->ks_mbset_callbacks, 0);
 
@@ -487,6 +773,8 @@ kvset_open2(
 
     /* kvset_stats from hblocks */
     ks->ks_st.kst_halen += ks->ks_hblk.kh_hblk_desc.alen_pages * PAGE_SIZE;
+    if (ks->ks_hblk.kh_hblk_desc.mclass == HSE_MCLASS_STAGING)
+        ks->ks_staging_alen += ks->ks_hblk.kh_hblk_desc.alen_pages * PAGE_SIZE;
     ks->ks_st.kst_hwlen += ks->ks_hblk.kh_hblk_desc.wlen_pages * PAGE_SIZE;
     ks->ks_st.kst_ptombs += ks->ks_hblk.kh_metrics.hm_nptombs;
 
@@ -494,17 +782,35 @@ kvset_open2(
     ks->ks_seqno_max = ks->ks_hblk.kh_seqno_max;
     assert(ks->ks_seqno_min <= ks->ks_seqno_max);
 
+    err = hbr_read_rtombs(&ks->ks_hblk.kh_hblk_desc, &ks->ks_rtombs, &ks->ks_rtombc);
+    if (ev(err))
+        goto err_exit;
+
     kcachesz = 0;
 
+    /* Restored kvsets with a valid snapshot need not read their kblock
+     * headers, other than for kblocks with keys too large for the snapshot.
+     */
+    snapv = rp->cn_open_snapshot ? kvset_snap_kblkv(km, n_kblks) : NULL;
+
     for (uint32_t i = 0; i < n_kblks; i++) {
         struct kvset_kblk *kblk = ks->ks_kblks + i;
 
         uint64_t mbid = km->km_kblk_list.idv[i];
 
-        err = kvset_kblk_init(rp, mp, mbid, kblk);
+        if (snapv && kvset_kblk_snap_usable(snapv + i, mbid))
+            err = kvset_kblk_init_snap(rp, mp, snapv + i, !km->km_restored, kblk);
+        else
+            err = kvset_kblk_init(rp, mp, mbid, !km->km_restored, kblk);
         if (ev(err))
             goto err_exit;
 
+        /* Restored kvsets are loaded by kvset_preload() so as not to
+         * lengthen cn_open().
+         */
+        if (!km->km_restored && cn_kvdb && cn_kvdb->cn_hpcache)
+            kvset_kblk_hpcache_load(cn_kvdb->cn_hpcache, kblk);
+
         /* Ignore these keys if they've already been cached
          * to kblk->kb_ksmall by kblk_init().
          */
@@ -514,6 +820,8 @@ kvset_open2(
         /* kvset_stats from kblocks */
         ks->ks_st.kst_kalen += kblk->kb_kblk_desc.alen_pages * PAGE_SIZE;
         ks->ks_st.kst_kwlen += kblk->kb_kblk_desc.wlen_pages * PAGE_SIZE;
+        if (kblk->kb_kblk_desc.mclass == HSE_MCLASS_STAGING)
+            ks->ks_staging_alen += kblk->kb_kblk_desc.alen_pages * PAGE_SIZE;
         ks->ks_st.kst_keys += kblk->kb_metrics.num_keys;
         ks->ks_st.kst_tombs += kblk->kb_metrics.num_tombstones;
     }
@@ -613,6 +921,8 @@ kvset_open2(
             ks->ks_kdisc_max = ks->ks_kblks[last_kb].kb_kdisc_max;
         }
 
+        kvset_rtomb_bounds(ks, false);
+
         /* Check to see if all keys in this kvset have a common prefix.
          * If so, then remember it so that we can leverage it to reduce
          * the amount of work required to find keys with common prefixes.
@@ -628,6 +938,8 @@ kvset_open2(
 
         ks->ks_kdisc_min = ks->ks_hblk.kh_pfx_min_disc;
         ks->ks_kdisc_max = ks->ks_hblk.kh_pfx_max_disc;
+
+        kvset_rtomb_bounds(ks, !kvset_has_ptree(ks));
     }
 
     {
@@ -666,8 +978,13 @@ kvset_open2(
             struct mbset *mbset = ks->ks_vbsetv[i];
 
             for (uint j = 0; j < mbset->mbs_mblkc; j++) {
+                const struct vblock_desc *vbd = mbset_get_udata(mbset, j);
+
                 vbr_desc_update_vgidx(mbset_get_udata(mbset, j), &vgroupc, vgroupv);
                 assert(vgroupc < v + 1);
+
+                if (vbd->vbd_mblkdesc->mclass == HSE_MCLASS_STAGING)
+                    ks->ks_staging_alen += vbd->vbd_mblkdesc->alen_pages * PAGE_SIZE;
             }
         }
 
@@ -701,6 +1018,9 @@ kvset_open2(
         }
     }
 
+    if (rp->cn_open_snapshot && !snapv && n_kblks > 0)
+        kvset_snap_save(ks);
+
     ks->ks_ctime = get_time_ns();
 
     *ks_out = ks;
@@ -712,6 +1032,13 @@ err_exit:
     return err;
 }
 
+merr_t
+kvset_vbset_create(struct cn_tree *tree, uint32_t idc, uint64_t *idv, struct mbset **vbset)
+{
+    return mbset_create(
+        cn_tree_get_mp(tree), idc, idv, sizeof(struct vblock_desc), vblock_udata_init, vbset);
+}
+
 merr_t
 kvset_open(struct cn_tree *tree, uint64_t kvsetid, struct kvset_meta *km, struct kvset **ks)
 {
@@ -724,8 +1051,7 @@ kvset_open(struct cn_tree *tree, uint64_t kvsetid, struct kvset_meta *km, struct
     uint len = 0;
 
     if (idc) {
-        err = mbset_create(
-            cn_tree_get_mp(tree), idc, idv, sizeof(struct vblock_desc), vblock_udata_init, &vbset);
+        err = kvset_vbset_create(tree, idc, idv, &vbset);
         if (ev(err))
             return err;
         len = 1;
@@ -838,7 +1164,14 @@ cleanup_kblocks(struct kvset *ks)
     merr_t err = 0;
 
     for (uint32_t i = 0; i < ks->ks_st.kst_kblks; i++) {
-        err = mblk_munmap(ks->ks_mp, &ks->ks_kblks[i].kb_kblk_desc);
+        struct kvset_kblk *kblk = ks->ks_kblks + i;
+
+        if (kblk->kb_hpc_rgn) {
+            hpcache_free(ks->ks_cn_kvdb->cn_hpcache, kblk->kb_hpc_rgn, kblk->kb_hpc_mem);
+            perfc_dec(&kvdb_metrics_pc, PERFC_BA_KVDBMETRICS_HPCKBLKS);
+        }
+
+        err = mblk_munmap(ks->ks_mp, &kblk->kb_kblk_desc);
         ev(err);
     }
 
@@ -909,6 +1242,7 @@ kvset_close(struct kvset *ks)
         cndb_record_kvset_del_ack(ks->ks_cndb, ks->ks_delete_txn, ks->ks_delete_cookie);
 
     free((void *)ks->ks_klarge);
+    free(ks->ks_rtombs);
 
     vgmap_free(ks->ks_vgmap);
 
@@ -1000,6 +1334,14 @@ kvset_has_ptree(const struct kvset * const ks)
     return ks->ks_pfx_len > 0 && ks->ks_hblk.kh_ptree_desc.wbd_n_pages > 0;
 }
 
+uint32_t
+kvset_get_rtombs(const struct kvset *ks, const struct rtomb **rtv)
+{
+    *rtv = ks->ks_rtombs;
+
+    return ks->ks_rtombc;
+}
+
 /**
  * kvset_kblk_start() - determine if a kvset might contain a key.
  *
@@ -1078,16 +1420,39 @@ kblk_get_value_ref(
 {
     struct kvset_kblk *kblk = ks->ks_kblks + kblk_idx;
     uint64_t hash = kt->kt_hash;
+    uint64_t rtstart;
+    bool plausible;
+    merr_t err;
 
     if (ks->ks_rp->kvs_sfxlen)
         hash = key_hash64(kt->kt_data, kt->kt_len);
 
-    if (!bloom_reader_lookup(&kblk->kb_blm_desc, hash))
+    /* This runs for every kblock probed by a get, so untraced requests
+     * test the trace flag once rather than once per span.
+     */
+    if (!rtrace_active()) {
+        if (!bloom_reader_lookup(&kblk->kb_blm_desc, hash))
+            return 0;
+
+        return wbtr_read_vref(
+            kblk->kb_kblk_desc.map_base, &kblk->kb_wbt_desc, kt, seq, result,
+            ks->ks_use_vgmap ? ks->ks_vgmap : NULL, vref);
+    }
+
+    rtstart = get_cycles();
+    plausible = bloom_reader_lookup(&kblk->kb_blm_desc, hash);
+    rtrace_span_record(RTRACE_EV_BLOOM, rtstart);
+
+    if (!plausible)
         return 0;
 
-    return wbtr_read_vref(
+    rtstart = get_cycles();
+    err = wbtr_read_vref(
         kblk->kb_kblk_desc.map_base, &kblk->kb_wbt_desc, kt, seq, result,
         ks->ks_use_vgmap ? ks->ks_vgmap : NULL, vref);
+    rtrace_span_record(RTRACE_EV_WBT, rtstart);
+
+    return err;
 }
 
 static merr_t
@@ -1196,6 +1561,16 @@ done:
         }
     }
 
+    if (ks->ks_rtombc > 0) {
+        uint64_t rt_seq;
+
+        rt_seq = rtomb_lookup(ks->ks_rtombs, ks->ks_rtombc, kt->kt_data, kt->kt_len, seq);
+        if (rt_seq > 0 && (*result == NOT_FOUND || rt_seq > vref->vr_seq)) {
+            *result = FOUND_TMB;
+            vref->vr_seq = rt_seq;
+        }
+    }
+
     return 0;
 }
 
@@ -1425,6 +1800,21 @@ kvset_wbti_free(void *wbti)
     wbti_destroy(wbti);
 }
 
+/* Kvset heat is sampled on a random one in KVSET_HEAT_SAMPLE accesses so
+ * that the lookup and cursor read paths needn't dirty a shared cache line
+ * on every access.  A random draw, unlike a per-thread access counter,
+ * doesn't alias with access patterns that cycle through a fixed set of
+ * kvsets and so never credits one kvset with another's accesses.
+ */
+#define KVSET_HEAT_SAMPLE (16u)
+
+static HSE_ALWAYS_INLINE void
+kvset_heat_sample(struct kvset *ks)
+{
+    if (HSE_UNLIKELY(xrand64_tls() % KVSET_HEAT_SAMPLE == 0))
+        atomic_add(&ks->ks_heat, KVSET_HEAT_SAMPLE);
+}
+
 merr_t
 kvset_pfx_lookup(
     struct kvset *ks,
@@ -1440,7 +1830,7 @@ kvset_pfx_lookup(
     struct kvs_vtuple_ref vref;
     struct kvset_kblk *kblk;
     merr_t err;
-    uint64_t pt_seq = 0;
+    uint64_t pt_seq = 0, vseq = 0;
     int kbidx, last;
     const void *kmd;
     unsigned char foundkey[HSE_KVS_KEY_LEN_MAX];
@@ -1448,8 +1838,21 @@ kvset_pfx_lookup(
 
     struct key_obj kobj, kt_obj, kbuf_obj;
 
+    kvset_heat_sample(ks);
+
     key2kobj(&kt_obj, kt->kt_data, kt->kt_len);
 
+    /* Range tombstones from this kvset also hide keys in older kvsets,
+     * so they're accumulated in the query context.
+     */
+    for (uint32_t i = 0; i < ks->ks_rtombc; i++) {
+        err = rtomb_vec_add(&qctx->rtombs, ks->ks_rtombs + i);
+        if (ev(err))
+            return err;
+    }
+
+    rtomb_vec_sort(&qctx->rtombs);
+
     err = kvset_ptomb_lookup(ks, kt, seq, res, &vref);
     if (ev(err))
         return err;
@@ -1493,7 +1896,6 @@ get_more:
      */
     {
         size_t off = 0;
-        uint64_t vseq;
         uint nvals;
 
         *res = NOT_FOUND;
@@ -1521,7 +1923,7 @@ get_more:
 
     key_obj_copy(foundkey, sizeof(foundkey), &foundklen, &kobj);
 
-    if (*res == FOUND_TMB) {
+    if (*res == FOUND_TMB || qctx_rtomb_hides(qctx, foundkey, foundklen, seq, vseq)) {
         err = qctx_tomb_insert(qctx, foundkey, foundklen);
         if (ev(err))
             return err;
@@ -1576,8 +1978,11 @@ kvset_lookup(
     struct kvs_buf *vbuf)
 {
     struct kvs_vtuple_ref vref;
+    uint64_t rtstart;
     merr_t err;
 
+    kvset_heat_sample(ks);
+
     err = kvset_lookup_vref(ks, kt, kdisc, seq, res, &vref);
     if (ev(err))
         return err;
@@ -1585,7 +1990,11 @@ kvset_lookup(
     if (*res != FOUND_VAL)
         return 0;
 
-    return kvset_lookup_val(ks, &vref, vbuf);
+    rtstart = rtrace_span_start();
+    err = kvset_lookup_val(ks, &vref, vbuf);
+    rtrace_span_record(RTRACE_EV_VALUE, rtstart);
+
+    return err;
 }
 
 uint64_t
@@ -1731,6 +2140,36 @@ kvset_set_work(struct kvset *ks, const void *work)
     ks->ks_work = work;
 }
 
+uint64_t
+kvset_get_heat(const struct kvset *ks)
+{
+    return atomic_read(&ks->ks_heat);
+}
+
+void
+kvset_set_heat(struct kvset *ks, uint64_t heat)
+{
+    atomic_set(&ks->ks_heat, heat);
+}
+
+uint64_t
+kvset_heat_decay(struct kvset *ks)
+{
+    uint64_t heat = atomic_read(&ks->ks_heat);
+
+    /* Samples that race with the decay are simply lost.
+     */
+    atomic_sub(&ks->ks_heat, heat / 2);
+
+    return heat - heat / 2;
+}
+
+size_t
+kvset_get_staging_alen(const struct kvset *ks)
+{
+    return ks->ks_staging_alen;
+}
+
 uint64_t
 kvset_get_hblock_id(struct kvset *ks)
 {
@@ -1980,13 +2419,17 @@ struct kvset_iterator {
     struct wbti *pti;
     struct perfc_set *pc;
     struct cn_merge_stats *stats;
+    struct tbkt *tbkt;
     uint curr_kblk;
+    uint8_t *kblk_skipv; /* kblocks hidden by an rtomb, or NULL */
     enum last_src last;
     uint32_t vra_flags;
     uint32_t vra_len;
     struct workqueue_struct *vra_wq;
     bool reverse;
     bool asyncio;
+    bool fullscan;
+    bool rd_started;
     struct iter_meta wbti_meta;
     struct iter_meta pti_meta;
 
@@ -2189,6 +2632,12 @@ done:
 
 enum read_type { READ_WBT = true, READ_PT = false };
 
+static HSE_ALWAYS_INLINE bool
+kvset_iter_kblk_skip(const struct kvset_iterator *iter, uint kbidx)
+{
+    return iter->kblk_skipv && iter->kblk_skipv[kbidx];
+}
+
 static void
 kblk_start_read(struct kvset_iterator *iter, struct kblk_reader *kr, enum read_type read_type)
 {
@@ -2200,6 +2649,12 @@ kblk_start_read(struct kvset_iterator *iter, struct kblk_reader *kr, enum read_t
     if (kr->kr_nodex == kr->kr_nodec) {
         struct wbt_desc *wbt = NULL;
 
+        if (read_type == READ_WBT) {
+            while (kr->kr_next_blk_idx < kr->kr_blk_cnt &&
+                   kvset_iter_kblk_skip(iter, kr->kr_next_blk_idx))
+                kr->kr_next_blk_idx++;
+        }
+
         if (kr->kr_next_blk_idx >= kr->kr_blk_cnt) {
             kr->kr_eof = true;
             return;
@@ -2568,6 +3023,8 @@ kvset_iter_create(
     iter->vra_len = roundup(ks->ks_vra_len, PAGE_SIZE);
     iter->handle.kvi_es = es_make(kvset_cursor_next, 0, 0);
 
+    iter->fullscan = fullscan;
+
     if (fullscan && !mblock_read) {
         iter->vra_len = roundup(ks->ks_rp->cn_compact_vra, PAGE_SIZE);
         iter->vra_flags |= VBR_FULLSCAN;
@@ -2596,8 +3053,9 @@ kvset_iter_create(
         if (ev(err))
             goto err_exit2;
 
-        if (iter->asyncio)
-            kvset_iter_mblock_read_start(iter);
+        /* Async reads are started by the first kvset_iter_next_key() so that
+         * kvset_iter_skip_covered() can still drop the first kblock.
+         */
     }
 
     kvset_get_ref(ks);
@@ -2634,6 +3092,68 @@ kvset_iter_set_stats(struct kv_iterator *handle, struct cn_merge_stats *stats)
     iter->stats = stats;
 }
 
+void
+kvset_iter_set_tbkt(struct kv_iterator *handle, struct tbkt *tb)
+{
+    struct kvset_iterator *iter = handle_to_kvset_iter(handle);
+
+    iter->tbkt = tb;
+}
+
+merr_t
+kvset_iter_skip_covered(
+    struct kv_iterator *handle,
+    const struct rtomb *rtv,
+    uint32_t rtc,
+    uint64_t horizon)
+{
+    struct kvset_iterator *iter = handle_to_kvset_iter(handle);
+    struct kvset *ks = iter->ks;
+    uint32_t i, j;
+
+    assert(!iter->rd_started && !iter->wbti);
+
+    /* Every entry in the kblock must be older than the rtomb, and the rtomb
+     * must be visible to every view, for the kblock to be dead to all readers.
+     * Kblocks carry no seqno range of their own, so use the kvset's.
+     */
+    for (j = 0; j < rtc; j++) {
+        if (rtv[j].rt_seqno > ks->ks_seqno_max && rtv[j].rt_seqno <= horizon)
+            break;
+    }
+
+    if (j == rtc)
+        return 0;
+
+    for (i = 0; i < ks->ks_st.kst_kblks; i++) {
+        const struct kvset_kblk *kb = ks->ks_kblks + i;
+
+        for (j = 0; j < rtc; j++) {
+            const struct rtomb *rt = rtv + j;
+
+            if (keycmp(rt->rt_start, rt->rt_slen, kb->kb_koff_min, kb->kb_klen_min) > 0)
+                break;
+
+            if (rt->rt_seqno <= ks->ks_seqno_max || rt->rt_seqno > horizon)
+                continue;
+
+            if (keycmp(kb->kb_koff_max, kb->kb_klen_max, rt->rt_end, rt->rt_elen) >= 0)
+                continue;
+
+            if (!iter->kblk_skipv) {
+                iter->kblk_skipv = calloc(ks->ks_st.kst_kblks, sizeof(*iter->kblk_skipv));
+                if (ev(!iter->kblk_skipv))
+                    return merr(ENOMEM);
+            }
+
+            iter->kblk_skipv[i] = 1;
+            break;
+        }
+    }
+
+    return 0;
+}
+
 merr_t
 kvset_iter_set_start(struct kv_iterator *handle, int start)
 {
@@ -2687,6 +3207,19 @@ kvset_madvise_kblks(struct kvset *ks, int advice, bool blooms, bool leaves)
     }
 }
 
+void
+kvset_preload(struct kvset *ks)
+{
+    struct hpcache *hpc = ks->ks_cn_kvdb ? ks->ks_cn_kvdb->cn_hpcache : NULL;
+
+    for (uint32_t i = 0; i < ks->ks_st.kst_kblks; i++) {
+        kvset_kblk_preload(ks->ks_rp, ks->ks_kblks + i);
+
+        if (hpc)
+            kvset_kblk_hpcache_load(hpc, ks->ks_kblks + i);
+    }
+}
+
 void
 kvset_madvise_vblks(struct kvset *ks, int advice)
 {
@@ -2963,6 +3496,12 @@ next_kblock:
         }
 
         assert(iter->curr_kblk < ks->ks_st.kst_kblks);
+
+        if (kvset_iter_kblk_skip(iter, iter->curr_kblk)) {
+            iter->curr_kblk += inc;
+            goto next_kblock;
+        }
+
         kb = ks->ks_kblks + iter->curr_kblk;
 
         /* Can use 'cn_cursor_kblk_madv' to control use of madvise
@@ -3044,6 +3583,9 @@ kvset_iter_next_key_read(
         if (ms)
             count_ops(&ms->ms_kblk_read, kr->iores.kr_ops, kr->iores.kr_bytes, 0);
 
+        if (iter->tbkt)
+            tbkt_throttle(iter->tbkt, kr->iores.kr_bytes);
+
         /* new work buffer */
         wbt_reader->wb_node = kr->iores.kr_nodev;
         wbt_reader->wb_nodec = kr->iores.kr_nodec;
@@ -3140,11 +3682,21 @@ kvset_iter_next_key(struct kv_iterator *handle, struct key_obj *kobj, struct kvs
 
     vc->dgen = kvset_get_dgen(iter->ks);
 
+    if (HSE_UNLIKELY(iter->asyncio && !iter->rd_started)) {
+        iter->rd_started = true;
+        kvset_iter_mblock_read_start(iter);
+    }
+
     if (handle->kvi_eof || (iter->pti_meta.eof && iter->wbti_meta.eof)) {
         handle->kvi_eof = true;
         return 0;
     }
 
+    /* Compaction reads (fullscan) do not make a kvset hot.
+     */
+    if (!iter->fullscan)
+        kvset_heat_sample(iter->ks);
+
     /* Move the appropriate iterators */
     if (!iter->wbti_meta.eof && (iter->last == SRC_NONE || iter->last == SRC_WBT)) {
         err =
@@ -3308,6 +3860,9 @@ kvset_iter_get_valptr_read(
         if (ms)
             count_ops(&ms->ms_vblk_read1, 1, active->len, 0);
 
+        if (iter->tbkt)
+            tbkt_throttle(iter->tbkt, active->len);
+
         /* Check if previous read satisfied our need. If not, then
          * read ahead guessed wrong and we need to start a new one
          * with the correct parameters.  This also happens when a
@@ -3335,6 +3890,9 @@ kvset_iter_get_valptr_read(
     if (ms)
         count_ops(&ms->ms_vblk_read2, 1, active->len, 0);
 
+    if (iter->tbkt)
+        tbkt_throttle(iter->tbkt, active->len);
+
 have_data:
 
     if (!vr->asyncio)
@@ -3537,6 +4095,7 @@ kvset_iter_release(struct kv_iterator *handle)
 
     kvset_iter_free_buffers(iter, &iter->kreader);
     kvset_iter_free_buffers(iter, &iter->ptreader);
+    free(iter->kblk_skipv);
 
     kvset_put_ref(iter->ks);
     kmem_cache_free(kvset_iter_cache, iter);
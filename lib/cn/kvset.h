@@ -37,6 +37,8 @@ struct cn_tree;
 struct cn_merge_stats;
 struct kvset_stats;
 struct vgmap;
+struct rtomb;
+struct tbkt;
 
 struct kvset_list_entry {
     struct list_head le_link;
@@ -63,6 +65,8 @@ enum kvset_iter_flags {
  * @km_rule:        compaction rule ID that created this kvset
  * @km_capped:      cn is capped
  * @km_restored:    kvset is being restored from the cndb
+ * @km_snap:        kblock descriptor snapshot from the cndb (or NULL)
+ * @km_snaplen:     length of @km_snap
  *
  * This structure is passed between the MDC and kvset_open().
  */
@@ -79,6 +83,8 @@ struct kvset_meta {
     uint16_t km_rule;
     bool km_capped;
     bool km_restored;
+    const void *km_snap;
+    uint32_t km_snaplen;
 };
 
 enum {
@@ -167,6 +173,18 @@ kvset_madvise_hblk(struct kvset *kvset, int advice, bool leaves);
 void
 kvset_madvise_kblks(struct kvset *kvset, int advice, bool blooms, bool leaves);
 
+/**
+ * kvset_preload() - preload kblock wbtree nodes and bloom filters
+ * @kvset:    kvset pointer
+ *
+ * Issues the cn_mcache_wbt and cn_bloom_preload readahead, and copies the
+ * kblock indexes into the hpcache, both of which kvset_open2() skips for
+ * kvsets restored from the cndb.
+ */
+/* MTF_MOCK */
+void
+kvset_preload(struct kvset *kvset);
+
 /**
  * kvset_madvise_vblks() - preload/discard vblock memory mapped pages
  * @kvset:    kvset pointer
@@ -213,6 +231,16 @@ kvset_open2(
     struct mbset ***vbset_vecs,
     struct kvset **kvset);
 
+/**
+ * kvset_vbset_create() - Create an mbset for a list of vblocks
+ * @tree:  cn tree handle
+ * @idc:   number of vblocks
+ * @idv:   vblock ids
+ * @vbset: (output) new mbset, for use with kvset_open2()
+ */
+merr_t
+kvset_vbset_create(struct cn_tree *tree, uint32_t idc, uint64_t *idv, struct mbset **vbset);
+
 /* MTF_MOCK */
 merr_t
 kvset_delete_log_record(struct kvset *ks, struct cndb_txn *txn);
@@ -260,6 +288,18 @@ kvset_ctime(const struct kvset *kvset);
 bool
 kvset_has_ptree(const struct kvset *ks) HSE_NONNULL(1);
 
+/**
+ * kvset_get_rtombs() - get the kvset's range tombstones
+ * @ks:  kvset
+ * @rtv: (output) vector of range tombstones sorted by start key, valid for
+ *       as long as the caller holds a reference on the kvset
+ *
+ * Return: number of range tombstones in @rtv
+ */
+/* MTF_MOCK */
+uint32_t
+kvset_get_rtombs(const struct kvset *ks, const struct rtomb **rtv);
+
 /**
  * kvset_kblk_start() - return index of kblock where this key may reside
  * @kvset:   kvset to search
@@ -412,6 +452,32 @@ kvset_set_nodeid(struct kvset *kvset, uint64_t nodeid);
 uint64_t
 kvset_get_dgen_lo(const struct kvset *kvset);
 
+/**
+ * kvset_get_heat() - get a kvset's heat
+ *
+ * A kvset's heat is a sampled count of the point lookups and cursor reads
+ * which touched it, periodically halved by csched via kvset_heat_decay().
+ */
+/* MTF_MOCK */
+uint64_t
+kvset_get_heat(const struct kvset *ks);
+
+/* MTF_MOCK */
+void
+kvset_set_heat(struct kvset *ks, uint64_t heat);
+
+/* MTF_MOCK */
+uint64_t
+kvset_heat_decay(struct kvset *ks);
+
+/**
+ * kvset_get_staging_alen() - get the allocated length of a kvset's mblocks
+ *                            which reside on the staging media class
+ */
+/* MTF_MOCK */
+size_t
+kvset_get_staging_alen(const struct kvset *ks);
+
 /**
  * kvset_iter_create() - Create iterator to traverse all entries in a kvset
  * @kvset:     kvset handle
@@ -462,6 +528,35 @@ kvset_iter_release(struct kv_iterator *handle);
 void
 kvset_iter_set_stats(struct kv_iterator *handle, struct cn_merge_stats *stats);
 
+/**
+ * kvset_iter_set_tbkt() - charge the iterator's mblock reads to a token bucket
+ * @handle: kv_iter from kvset_iter_create
+ * @tb:     token bucket (bytes), or NULL for unrestricted reads
+ */
+/* MTF_MOCK */
+void
+kvset_iter_set_tbkt(struct kv_iterator *handle, struct tbkt *tb);
+
+/**
+ * kvset_iter_skip_covered() - skip kblocks hidden by range tombstones
+ * @handle:  kv_iter from kvset_iter_create
+ * @rtv:     range tombstones sorted by start key
+ * @rtc:     number of range tombstones in @rtv
+ * @horizon: seqno horizon, no view older than this can be opened
+ *
+ * A kblock is skipped, and its keys and values are never read, if a single
+ * rtomb spans the kblock's min and max keys and is newer than every entry in
+ * the kvset but no newer than @horizon.  Must be called before the first key
+ * is read from the iterator.
+ */
+/* MTF_MOCK */
+merr_t
+kvset_iter_skip_covered(
+    struct kv_iterator *handle,
+    const struct rtomb *rtv,
+    uint32_t rtc,
+    uint64_t horizon);
+
 /* MTF_MOCK */
 merr_t
 kvset_iter_set_start(struct kv_iterator *kv_iter, int start);
@@ -531,6 +626,8 @@ kvset_iter_next_vref(
  * @gmap: vgroup map to populate
  * @iv:   the vector of input iterators
  * @niv:  the number of iterator
+ * @relocv: optional per-iterator flags, true if the iterator's vblocks
+ *          are not to be kept (i.e., its values will be relocated)
  *
  * This function creates a map of vblock offsets necessary
  * for correctly locating the values when used in a k-compaction.
@@ -545,7 +642,8 @@ kvset_keep_vblocks(
     struct kvset_vblk_map *out,
     struct vgmap **vgmap,
     struct kv_iterator **iv,
-    int niv);
+    int niv,
+    const bool *relocv);
 
 /* MTF_MOCK */
 void
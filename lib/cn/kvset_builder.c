@@ -6,6 +6,7 @@
 #define MTF_MOCK_IMPL_kvset_builder
 
 #include <stdint.h>
+#include <string.h>
 
 #include <hse/limits.h>
 
@@ -13,6 +14,7 @@
 #include <hse/ikvdb/key_hash.h>
 #include <hse/ikvdb/kvset_builder.h>
 #include <hse/ikvdb/limits.h>
+#include <hse/ikvdb/rtomb.h>
 #include <hse/util/alloc.h>
 #include <hse/util/bonsai_tree.h>
 #include <hse/util/event_counter.h>
@@ -28,6 +30,7 @@
 #include "spill.h"
 #include "vblock_builder.h"
 #include "vblock_reader.h"
+#include "vgmap.h"
 
 merr_t
 kvset_builder_create(
@@ -226,6 +229,9 @@ kvset_builder_add_val(
         if (ev(err))
             return err;
 
+        /* New vblocks follow any vblocks adopted from the source kvsets. */
+        vbidx += self->vblk_adopted;
+
         if (complen)
             kmd_add_cval(
                 self->kblk_kmd.kmd, &self->kblk_kmd.kmd_used, seq, vbidx, vboff, vlen, complen);
@@ -321,6 +327,21 @@ kvset_builder_add_nonval(struct kvset_builder *self, uint64_t seq, enum kmd_vtyp
     return 0;
 }
 
+merr_t
+kvset_builder_add_rtomb(struct kvset_builder *self, const struct rtomb *rt)
+{
+    merr_t err;
+
+    err = hbb_add_rtomb(self->hbb, rt);
+    if (ev(err))
+        return err;
+
+    self->seqno_max = max_t(uint64_t, self->seqno_max, rt->rt_seqno);
+    self->seqno_min = min_t(uint64_t, self->seqno_min, rt->rt_seqno);
+
+    return 0;
+}
+
 void
 kvset_builder_adopt_vblocks(
     struct kvset_builder *self,
@@ -334,6 +355,7 @@ kvset_builder_adopt_vblocks(
     self->vblk_list.idv = vblock_ids;
     self->vblk_list.idc = num_vblocks;
     self->vblk_list.n_alloc = num_vblocks;
+    self->vblk_adopted = num_vblocks;
     self->vtotal = vtotal;
 
     /* vgroup map is adopted from the compaction worker for k-compacts.
@@ -343,6 +365,83 @@ kvset_builder_adopt_vblocks(
     self->vgmap = vgmap;
 }
 
+/* Delete the vblocks written by this builder, skipping over adopted vblocks.
+ */
+static void
+kvset_builder_delete_vblocks(struct kvset_builder *self)
+{
+    struct blk_list vblks = { 0 };
+
+    if (self->vblk_list.idc > self->vblk_adopted) {
+        vblks.idv = self->vblk_list.idv + self->vblk_adopted;
+        vblks.idc = self->vblk_list.idc - self->vblk_adopted;
+
+        delete_mblocks(cn_get_mpool(self->cn), &vblks);
+        self->vblk_list.idc = self->vblk_adopted;
+    }
+}
+
+/* Append the vblocks holding values relocated out of sparse source vblocks
+ * to the list of adopted vblocks.  They form one additional vgroup.
+ */
+static merr_t
+kvset_builder_finish_reloc(struct kvset_builder *self, const struct key_obj *max_kobj)
+{
+    struct vgmap *vgmap;
+    struct blk_list vblks;
+    uint32_t nvgroups;
+    merr_t err;
+
+    INVARIANT(self->vgmap);
+
+    err = vbb_finish(self->vbb, &vblks, max_kobj);
+    if (err)
+        return err;
+
+    if (vblks.idc == 0) {
+        blk_list_free(&vblks);
+        return 0;
+    }
+
+    nvgroups = self->vgmap->nvgroups;
+
+    vgmap = vgmap_alloc(nvgroups + 1);
+    if (!vgmap) {
+        err = merr(ENOMEM);
+        goto errout;
+    }
+
+    memcpy(vgmap->vbidx_out, self->vgmap->vbidx_out, nvgroups * sizeof(*vgmap->vbidx_out));
+    memcpy(vgmap->vbidx_adj, self->vgmap->vbidx_adj, nvgroups * sizeof(*vgmap->vbidx_adj));
+    memcpy(vgmap->vbidx_src, self->vgmap->vbidx_src, nvgroups * sizeof(*vgmap->vbidx_src));
+
+    for (uint32_t i = 0; i < vblks.idc; i++) {
+        err = blk_list_append(&self->vblk_list, vblks.idv[i]);
+        if (err)
+            goto errout;
+    }
+
+    err = vgmap_vbidx_set(NULL, self->vblk_list.idc - 1, vgmap, self->vblk_list.idc - 1, nvgroups);
+    if (err)
+        goto errout;
+
+    vgmap_free(self->vgmap);
+    self->vgmap = vgmap;
+    self->vtotal += vbb_vlen_get(self->vbb);
+
+    blk_list_free(&vblks);
+
+    return 0;
+
+errout:
+    self->vblk_list.idc = self->vblk_adopted;
+    vgmap_free(vgmap);
+    delete_mblocks(cn_get_mpool(self->cn), &vblks);
+    blk_list_free(&vblks);
+
+    return err;
+}
+
 void
 kvset_builder_destroy(struct kvset_builder *bld)
 {
@@ -359,7 +458,8 @@ kvset_builder_destroy(struct kvset_builder *bld)
     delete_mblocks(mp, &bld->kblk_list);
     blk_list_free(&bld->kblk_list);
 
-    delete_mblocks(mp, &bld->vblk_list);
+    /* Adopted vblocks still belong to their source kvsets. */
+    kvset_builder_delete_vblocks(bld);
     blk_list_free(&bld->vblk_list);
 
     hbb_destroy(bld->hbb);
@@ -387,19 +487,19 @@ static merr_t
 kvset_builder_finish(struct kvset_builder *imp)
 {
     merr_t err;
-    bool adopted_vbs = (imp->vblk_list.idc > 0);
+    bool adopted_vbs = (imp->vblk_adopted > 0);
 
     INVARIANT(imp->hbb);
     INVARIANT(imp->kbb);
     INVARIANT(imp->vbb);
 
     if (!kbb_is_empty(imp->kbb)) {
-        /* If we haven't adopted any vblocks previously */
-        if (!adopted_vbs) {
-            struct key_obj min_kobj = { 0 }, max_kobj = { 0 };
+        struct key_obj min_kobj = { 0 }, max_kobj = { 0 };
 
-            kbb_curr_kblk_min_max_keys(imp->kbb, &min_kobj, &max_kobj);
+        kbb_curr_kblk_min_max_keys(imp->kbb, &min_kobj, &max_kobj);
 
+        /* If we haven't adopted any vblocks previously */
+        if (!adopted_vbs) {
             err = vbb_finish(imp->vbb, &imp->vblk_list, &max_kobj);
             if (err)
                 return err;
@@ -425,6 +525,10 @@ kvset_builder_finish(struct kvset_builder *imp)
                     return err;
                 }
             }
+        } else {
+            err = kvset_builder_finish_reloc(imp, &max_kobj);
+            if (err)
+                return err;
         }
     } else {
         /* There are no kblocks. This happens when each input key has a
@@ -439,6 +543,7 @@ kvset_builder_finish(struct kvset_builder *imp)
 
         if (adopted_vbs) {
             blk_list_free(&imp->vblk_list);
+            imp->vblk_adopted = 0;
             vgmap_free(imp->vgmap);
             imp->vgmap = NULL;
         }
@@ -446,8 +551,7 @@ kvset_builder_finish(struct kvset_builder *imp)
 
     err = kbb_finish(imp->kbb, &imp->kblk_list);
     if (err) {
-        if (!adopted_vbs)
-            delete_mblocks(cn_get_mpool(imp->cn), &imp->vblk_list);
+        kvset_builder_delete_vblocks(imp);
 
         return err;
     }
@@ -460,8 +564,7 @@ kvset_builder_finish(struct kvset_builder *imp)
         struct mpool *mp = cn_get_mpool(imp->cn);
 
         delete_mblocks(mp, &imp->kblk_list);
-        if (!adopted_vbs)
-            delete_mblocks(mp, &imp->vblk_list);
+        kvset_builder_delete_vblocks(imp);
 
         return err;
     }
@@ -494,6 +597,7 @@ kvset_builder_get_mblocks(struct kvset_builder *self, struct kvset_mblocks *mblk
     list = &self->vblk_list;
     mblks->vblks.idv = list->idv;
     mblks->vblks.idc = list->idc;
+    mblks->bl_vadopted = self->vblk_adopted;
     list->idv = 0;
     list->idc = 0;
 
@@ -536,6 +640,13 @@ kvset_builder_set_merge_stats(struct kvset_builder *self, struct cn_merge_stats
     vbb_set_merge_stats(self->vbb, stats);
 }
 
+void
+kvset_builder_set_tbkt(struct kvset_builder *self, struct tbkt *tb)
+{
+    kbb_set_tbkt(self->kbb, tb);
+    vbb_set_tbkt(self->vbb, tb);
+}
+
 #if HSE_MOCKING
 #include "kvset_builder_ut_impl.i"
 #endif /* HSE_MOCKING */
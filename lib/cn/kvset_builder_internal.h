@@ -45,6 +45,7 @@ struct kvset_builder {
 
     struct vblock_builder *vbb; // vblock builder
     struct blk_list vblk_list;  // list of vblock ids
+    uint32_t vblk_adopted;      // number of leading vblk_list entries adopted from other kvsets
 
     struct vgmap *vgmap;
 
@@ -60,6 +60,9 @@ struct kvset_kblk {
 
     struct bloom_desc kb_blm_desc; /* Bloom descriptor */
 
+    struct hpcache_region *kb_hpc_rgn; /* hugepage copy of index, or NULL */
+    void *kb_hpc_mem;                  /* base of the hugepage copy */
+
     struct kblk_metrics kb_metrics; /* kblock metrics */
 };
 
@@ -121,7 +124,12 @@ struct kvset {
     uint16_t ks_maxklen;   /* length of largest key */
     uint16_t ks_minklen;   /* length of smallest key */
 
+    struct rtomb *ks_rtombs; /* range tombstones, sorted by start key */
+    uint32_t ks_rtombc;      /* number of range tombstones */
+
     atomic_int ks_ref HSE_L1D_ALIGNED; /* reference count */
+    atomic_ulong ks_heat;              /* sampled access count (see kvset_heat_sample()) */
+    size_t ks_staging_alen;            /* bytes of mblocks on the staging media class */
     uint32_t ks_deleted;               /* DEL_NONE, DEL_KEEPV, DEL_ALL */
     atomic_int ks_delete_error;
     atomic_int ks_mbset_callbacks;
@@ -11,6 +11,7 @@
 #include <hse/ikvdb/cndb.h>
 #include <hse/ikvdb/ikvdb.h>
 #include <hse/ikvdb/kvset_builder.h>
+#include <hse/ikvdb/rtomb.h>
 #include <hse/logging/logging.h>
 #include <hse/mpool/mpool.h>
 #include <hse/util/assert.h>
@@ -594,10 +595,48 @@ vblocks_split(
  * The hblock is rewritten in the left and the right kvsets by duplicating the following
  * fields from the hblock in the source kvset:
  *   - min/max seqno, min/max prefix, ptomb tree and its related fields
+ *   - range tombstones (see rtombs_split())
  *
  * The following fields are regenerated for the left and the right kvsets:
  *   - hlog and vgroup map
  */
+/**
+ * Range tombstones are copied to whichever side(s) of the split they overlap.
+ */
+static merr_t
+rtombs_split(
+    struct kvset *ks,
+    const struct key_obj *split_kobj,
+    struct kvset_split_work work[static 2])
+{
+    char split_key[HSE_KVS_KEY_LEN_MAX];
+    uint split_klen;
+    merr_t err;
+
+    if (!ks->ks_rtombc)
+        return 0;
+
+    key_obj_copy(split_key, sizeof(split_key), &split_klen, split_kobj);
+
+    for (uint32_t i = 0; i < ks->ks_rtombc; i++) {
+        const struct rtomb *rt = ks->ks_rtombs + i;
+
+        if (rtomb_overlaps(rt, NULL, 0, split_key, split_klen)) {
+            err = hbb_add_rtomb(work[LEFT].hbb, rt);
+            if (ev(err))
+                return err;
+        }
+
+        if (rtomb_overlaps(rt, split_key, split_klen, NULL, 0)) {
+            err = hbb_add_rtomb(work[RIGHT].hbb, rt);
+            if (ev(err))
+                return err;
+        }
+    }
+
+    return 0;
+}
+
 static merr_t
 hblock_split(
     struct kvset *ks,
@@ -626,7 +665,7 @@ hblock_split(
     /* Add both the left and the right hblock to the commit list and add the source hblock
      * to the purge list.
      */
-    if (blks_left->kblks.idc > 0 || ptree) {
+    if (blks_left->kblks.idc > 0 || ptree || hbb_get_nrtombs(work[LEFT].hbb)) {
         err = hbb_finish(
             work[LEFT].hbb, &blks_left->hblk_id, work[LEFT].vgmap, &min_pfx, &max_pfx, min_seqno,
             max_seqno, blks_left->kblks.idc, blks_left->vblks.idc, num_ptombs,
@@ -635,7 +674,7 @@ hblock_split(
             err = blk_list_append(result->ks[LEFT].blks_commit, blks_left->hblk_id);
     }
 
-    if (!err && (blks_right->kblks.idc > 0 || ptree)) {
+    if (!err && (blks_right->kblks.idc > 0 || ptree || hbb_get_nrtombs(work[RIGHT].hbb))) {
         err = hbb_finish(
             work[RIGHT].hbb, &blks_right->hblk_id, work[RIGHT].vgmap, &min_pfx, &max_pfx, min_seqno,
             max_seqno, blks_right->kblks.idc, blks_right->vblks.idc, num_ptombs,
@@ -671,6 +710,10 @@ kvset_split(
     if (err)
         goto errout;
 
+    err = rtombs_split(ks, split_key, work);
+    if (err)
+        goto errout;
+
     err = hblock_split(ks, work, result);
     if (err)
         goto errout;
@@ -3,18 +3,25 @@
  * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
  */
 
+#include <hse/hse.h>
+
 #include <hse/error/merr.h>
 #include <hse/ikvdb/cn.h>
 #include <hse/ikvdb/cndb.h>
 #include <hse/ikvdb/kvset_view.h>
 #include <hse/logging/logging.h>
+#include <hse/mpool/mpool.h>
 #include <hse/util/list.h>
 #include <hse/util/rmlock.h>
+#include <hse/util/token_bucket.h>
 
+#include "blk_list.h"
+#include "cn_metrics.h"
 #include "cn_tree.h"
 #include "cn_tree_compact.h"
 #include "cn_tree_internal.h"
 #include "kvset.h"
+#include "move.h"
 #include "route.h"
 
 merr_t
@@ -186,3 +193,97 @@ cn_join(struct cn_compaction_work *w)
 
     return err;
 }
+
+/* Copy an mblock into the target media class and append it to blks.
+ */
+static merr_t
+cn_migrate_mblock(
+    struct cn_compaction_work *w,
+    uint64_t src_mbid,
+    struct blk_list *blks,
+    struct cn_merge_stats_ops *ops)
+{
+    struct mblock_props props;
+    uint64_t mbid;
+    merr_t err;
+
+    if (atomic_read(w->cw_cancel_request))
+        return merr(ESHUTDOWN);
+
+    err = mpool_mblock_props_get(w->cw_mp, src_mbid, &props);
+    if (err)
+        return err;
+
+    err = mpool_mblock_copy(w->cw_mp, src_mbid, w->cw_mclass, &mbid);
+    if (err)
+        return err;
+
+    err = blk_list_append(blks, mbid);
+    if (err) {
+        mpool_mblock_delete(w->cw_mp, mbid);
+        return err;
+    }
+
+    count_ops(ops, 1, props.mpr_write_len, 0);
+
+    if (w->cw_tbkt_rd)
+        tbkt_throttle(w->cw_tbkt_rd, props.mpr_write_len);
+    if (w->cw_tbkt_wr)
+        tbkt_throttle(w->cw_tbkt_wr, props.mpr_write_len);
+
+    return 0;
+}
+
+merr_t
+cn_migrate(struct cn_compaction_work *w)
+{
+    struct kvset_mblocks *blks = &w->cw_outv[0];
+    struct kvset *ks = w->cw_mark->le_kvset;
+    const struct kvset_stats *stats;
+    struct blk_list hblk = {};
+    uint32_t cnt;
+    merr_t err;
+
+    assert(w->cw_kvset_cnt == 1 && w->cw_outc == 1);
+
+    err = cn_migrate_mblock(w, kvset_get_hblock_id(ks), &hblk, &w->cw_stats.ms_kblk_write);
+    if (err)
+        return err;
+
+    blks->hblk_id = hblk.idv[0];
+    blk_list_free(&hblk);
+
+    cnt = kvset_get_num_kblocks(ks);
+    for (uint32_t i = 0; i < cnt; i++) {
+        err = cn_migrate_mblock(
+            w, kvset_get_nth_kblock_id(ks, i), &blks->kblks, &w->cw_stats.ms_kblk_write);
+        if (err)
+            return err;
+    }
+
+    cnt = kvset_get_num_vblocks(ks);
+    for (uint32_t i = 0; i < cnt; i++) {
+        err = cn_migrate_mblock(
+            w, kvset_get_nth_vblock_id(ks, i), &blks->vblks, &w->cw_stats.ms_vblk_write);
+        if (err)
+            return err;
+    }
+
+    /* The copies are byte-for-byte identical to the source, so the vgroup
+     * map in the hblock remains valid as does the kvset's value accounting.
+     */
+    stats = kvset_statsp(ks);
+    blks->bl_vused = stats->kst_vulen;
+    blks->bl_vtotal = stats->kst_vulen + stats->kst_vgarb;
+    blks->bl_seqno_max = kvset_get_seqno_max(ks);
+
+    w->cw_stats.ms_srcs = 1;
+    w->cw_stats.ms_keys_in = stats->kst_keys;
+    w->cw_stats.ms_keys_out = stats->kst_keys;
+
+    log_debug(
+        "cnid %lu nodeid %lu kvsetid %lu -> %s", w->cw_tree->cnid, w->cw_node->tn_nodeid,
+        kvset_get_id(ks), hse_mclass_name_get(w->cw_mclass));
+
+    return 0;
+}
@@ -8,6 +8,7 @@
 
 #include <hse/error/merr.h>
 
+struct cn_compaction_work;
 struct cn_tree;
 struct cn_tree_node;
 struct kvset_list_entry;
@@ -55,4 +56,17 @@ cn_move(
 merr_t
 cn_join(struct cn_compaction_work *w);
 
+/**
+ * cn_migrate() - copy a kvset's mblocks into the media class w->cw_mclass
+ *
+ * @w: compaction work
+ *
+ * NOTE:
+ * - The migrate operation has exactly one input kvset (w->cw_mark)
+ * - The copied mblocks are returned in w->cw_outv[0] and are committed in
+ *   place of the input kvset's mblocks by the compaction commit logic
+ */
+merr_t
+cn_migrate(struct cn_compaction_work *w);
+
 #endif /* HSE_KVS_CN_MOVE_H */
@@ -140,6 +140,12 @@ struct hblock_hdr_omf {
     uint32_t hbh_min_pfx_off;
     uint8_t hbh_min_pfx_len;
     uint8_t hbh_rsvd2[3];
+
+    /* range tombstones (version 2 and later) */
+    uint32_t hbh_rtomb_off_pg;
+    uint32_t hbh_rtomb_len_pg;
+    uint32_t hbh_num_rtombs;
+    uint32_t hbh_rsvd3;
 } HSE_PACKED;
 
 OMF_SETGET(struct hblock_hdr_omf, hbh_magic, 32)
@@ -159,6 +165,9 @@ OMF_SETGET(struct hblock_hdr_omf, hbh_max_pfx_off, 32)
 OMF_SETGET(struct hblock_hdr_omf, hbh_max_pfx_len, 8)
 OMF_SETGET(struct hblock_hdr_omf, hbh_min_pfx_off, 32)
 OMF_SETGET(struct hblock_hdr_omf, hbh_min_pfx_len, 8)
+OMF_SETGET(struct hblock_hdr_omf, hbh_rtomb_off_pg, 32)
+OMF_SETGET(struct hblock_hdr_omf, hbh_rtomb_len_pg, 32)
+OMF_SETGET(struct hblock_hdr_omf, hbh_num_rtombs, 32)
 
 static_assert(
     HSE_KVS_PFX_LEN_MAX <= UINT8_MAX,
@@ -170,6 +179,24 @@ static_assert(
 
 static_assert(HBLOCK_HDR_PAGES == 1, "Hblock header spanning more than 1 page has not been tested");
 
+/* Range tombstone records are packed back to back in the rtomb region of
+ * the hblock, sorted by start key.  Each record is followed by its start
+ * and end keys and padded to an eight byte boundary.
+ */
+struct rtomb_omf {
+    uint64_t rto_seqno;
+    uint16_t rto_slen;
+    uint16_t rto_elen;
+    uint32_t rto_rsvd;
+} HSE_PACKED;
+
+OMF_SETGET(struct rtomb_omf, rto_seqno, 64)
+OMF_SETGET(struct rtomb_omf, rto_slen, 16)
+OMF_SETGET(struct rtomb_omf, rto_elen, 16)
+
+#define RTOMB_OMF_LEN(_slen, _elen) \
+    (ALIGN(sizeof(struct rtomb_omf) + (_slen) + (_elen), sizeof(uint64_t)))
+
 /*****************************************************************
  *
  * Vgroup Map OMF
@@ -366,4 +393,83 @@ OMF_SETGET(struct vblock_footer_omf, vbf_min_klen, 16)
 OMF_SETGET(struct vblock_footer_omf, vbf_max_klen, 16)
 OMF_SETGET(struct vblock_footer_omf, vbf_rsvd, 32)
 
+/*****************************************************************
+ *
+ * Kvset snapshot OMF
+ *
+ * Stored opaquely in the cndb (CNDB_TYPE_KVSET_SNAP) so that restored
+ * kvsets can be opened without reading their kblock headers.  A kvset
+ * snapshot is a kvset_snap_omf header followed by ksn_kblk_cnt
+ * kvset_snap_kblk_omf entries, one per kblock in kvset order.
+ *
+ ****************************************************************/
+
+#define KVSET_SNAP_MAGIC ((uint32_t)('k' << 24 | 's' << 16 | 'n' << 8 | 'p'))
+
+struct kvset_snap_omf {
+    uint32_t ksn_magic;
+    uint32_t ksn_version;
+    uint32_t ksn_kblk_cnt;
+    uint32_t ksn_rsvd;
+} HSE_PACKED;
+
+OMF_SETGET(struct kvset_snap_omf, ksn_magic, 32)
+OMF_SETGET(struct kvset_snap_omf, ksn_version, 32)
+OMF_SETGET(struct kvset_snap_omf, ksn_kblk_cnt, 32)
+
+/* The largest and smallest keys are stored back to back in ksk_keys[]
+ * (largest first).  Kblocks whose keys don't fit are opened the slow way.
+ */
+struct kvset_snap_kblk_omf {
+    uint64_t ksk_mbid;
+    uint64_t ksk_key_bytes;
+    uint64_t ksk_val_bytes;
+    uint64_t ksk_kvlen;
+    uint64_t ksk_vused_bytes;
+    uint32_t ksk_entries;
+    uint32_t ksk_tombs;
+    uint32_t ksk_hlog_doff_pg;
+    uint32_t ksk_wbt_doff_pg;
+    uint32_t ksk_wbt_dlen_pg;
+    uint16_t ksk_wbt_root;
+    uint16_t ksk_wbt_leaf;
+    uint16_t ksk_wbt_leaf_cnt;
+    uint16_t ksk_wbt_kmd_pgc;
+    uint16_t ksk_wbt_version;
+    uint16_t ksk_rsvd;
+    uint32_t ksk_blm_doff_pg;
+    uint32_t ksk_blm_dlen_pg;
+    uint32_t ksk_blm_modulus;
+    uint32_t ksk_blm_bktshift;
+    uint32_t ksk_blm_n_hashes;
+    uint32_t ksk_blm_rotl;
+    uint16_t ksk_max_klen;
+    uint16_t ksk_min_klen;
+    uint8_t ksk_keys[64];
+} HSE_PACKED;
+
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_mbid, 64)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_key_bytes, 64)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_val_bytes, 64)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_kvlen, 64)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_vused_bytes, 64)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_entries, 32)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_tombs, 32)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_hlog_doff_pg, 32)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_wbt_doff_pg, 32)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_wbt_dlen_pg, 32)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_wbt_root, 16)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_wbt_leaf, 16)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_wbt_leaf_cnt, 16)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_wbt_kmd_pgc, 16)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_wbt_version, 16)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_blm_doff_pg, 32)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_blm_dlen_pg, 32)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_blm_modulus, 32)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_blm_bktshift, 32)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_blm_n_hashes, 32)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_blm_rotl, 32)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_max_klen, 16)
+OMF_SETGET(struct kvset_snap_kblk_omf, ksk_min_klen, 16)
+
 #endif
@@ -12,6 +12,7 @@
 #include <hse/ikvdb/kvs_rparams.h>
 #include <hse/ikvdb/kvset_builder.h>
 #include <hse/ikvdb/limits.h>
+#include <hse/ikvdb/rtomb.h>
 #include <hse/ikvdb/tuple.h>
 #include <hse/logging/logging.h>
 #include <hse/util/alloc.h>
@@ -100,8 +101,78 @@ struct spillctx {
     struct key_obj pt_kobj;
     uint64_t pt_seq; /* [HSE_REVISIT]: Need a list of seqnos to carry all ptombs across leaves. */
     bool pt_set;
+
+    /* Rtombs */
+    struct rtomb_vec rtombs;
+    bool prev_ekey_set;
+    uint prev_eklen;
+    uint8_t prev_ekey[HSE_KVS_KEY_LEN_MAX];
 };
 
+/* Add to the child (or merely count, if child is nil) each input rtomb that
+ * overlaps the child's key range (prev_ekey, ekey] and isn't already present
+ * in the child by virtue of an earlier spill (dgen <= node_dgen).  An rtomb
+ * that spans several children is replicated into each of them.
+ */
+static merr_t
+subspill_rtombs(
+    struct spillctx *sctx,
+    struct kvset_builder *child,
+    uint64_t node_dgen,
+    const void *ekey,
+    uint eklen,
+    uint *cntp)
+{
+    struct cn_compaction_work *w = sctx->work;
+    const void *lo = sctx->prev_ekey_set ? sctx->prev_ekey : NULL;
+    uint cnt = 0;
+
+    if (!sctx->rtombs.rv_cnt)
+        goto out;
+
+    for (uint i = 0; i < w->cw_kvset_cnt; i++) {
+        struct kvset *ks = kvset_iter_kvset_get(w->cw_inputv[i]);
+        const struct rtomb *rtv;
+        uint32_t rtc;
+
+        if (kvset_get_dgen(ks) <= node_dgen)
+            continue;
+
+        rtc = kvset_get_rtombs(ks, &rtv);
+
+        for (uint32_t j = 0; j < rtc; j++) {
+            if (w->cw_drop_tombs && rtv[j].rt_seqno <= w->cw_horizon)
+                continue;
+
+            if (!rtomb_overlaps(rtv + j, lo, sctx->prev_eklen, ekey, eklen))
+                continue;
+
+            if (child) {
+                merr_t err = kvset_builder_add_rtomb(child, rtv + j);
+
+                if (ev(err))
+                    return err;
+            }
+
+            cnt++;
+        }
+    }
+
+out:
+    if (cntp)
+        *cntp = cnt;
+
+    return 0;
+}
+
+static void
+subspill_ekey_save(struct spillctx *sctx, const void *ekey, uint eklen)
+{
+    memcpy(sctx->prev_ekey, ekey, eklen);
+    sctx->prev_eklen = eklen;
+    sctx->prev_ekey_set = true;
+}
+
 merr_t
 cn_spill_create(struct cn_compaction_work *w, struct spillctx **sctx_out)
 {
@@ -117,6 +188,12 @@ cn_spill_create(struct cn_compaction_work *w, struct spillctx **sctx_out)
 
     memset(s, 0, sizeof(*s));
     s->bh_sources = (void *)(s + 1);
+    s->work = w;
+    rtomb_vec_init(&s->rtombs);
+
+    err = cn_compaction_rtombs(w, NULL, &s->rtombs);
+    if (err)
+        goto out;
 
     err = bin_heap_create(w->cw_kvset_cnt, kv_item_compare, &s->bh);
     if (err)
@@ -132,7 +209,6 @@ cn_spill_create(struct cn_compaction_work *w, struct spillctx **sctx_out)
     if (err)
         goto out;
 
-    s->work = w;
     s->sgen = w->cw_sgen;
 
     s->more = bin_heap_peek(s->bh, (void **)&s->curr);
@@ -146,6 +222,7 @@ cn_spill_create(struct cn_compaction_work *w, struct spillctx **sctx_out)
 out:
     if (err) {
         bin_heap_destroy(s->bh);
+        rtomb_vec_fini(&s->rtombs);
         free(s);
     }
 
@@ -159,6 +236,7 @@ cn_spill_destroy(struct spillctx *sctx)
         return;
 
     bin_heap_destroy(sctx->bh);
+    rtomb_vec_fini(&sctx->rtombs);
     free(sctx);
 }
 
@@ -215,6 +293,8 @@ cn_subspill(
     uint dbg_nvals_this_key HSE_MAYBE_UNUSED;
     bool dbg_dup HSE_MAYBE_UNUSED;
     uint seqno_errcnt = 0;
+    uint64_t rt_seq = 0;
+    uint rtcnt;
     bool new_key;
     struct key_obj ekobj;
 
@@ -241,14 +321,22 @@ cn_subspill(
     ss->ss_added = false;
     ss->ss_work = w;
 
-    if (!sctx->more && !sctx->pt_set)
+    err = subspill_rtombs(sctx, NULL, node_dgen, ekey, eklen, &rtcnt);
+    if (err)
+        return err;
+
+    if (!sctx->more && !sctx->pt_set && !rtcnt) {
+        subspill_ekey_save(sctx, ekey, eklen);
         return 0;
+    }
 
-    /* Proceed only if either the curr key belongs in this leaf node OR there's a ptomb that needs
-     * to be propagated to this child.
+    /* Proceed only if either the curr key belongs in this leaf node OR there's a ptomb or
+     * rtombs that need to be propagated to this child.
      */
-    if (!sctx->pt_set && key_obj_cmp(&sctx->curr->kobj, &ekobj) > 0)
+    if (!sctx->pt_set && !rtcnt && (!sctx->more || key_obj_cmp(&sctx->curr->kobj, &ekobj) > 0)) {
+        subspill_ekey_save(sctx, ekey, eklen);
         return 0;
+    }
 
     w->cw_kvsetidv[0] = ss->ss_kvsetid = cndb_kvsetid_mint(cn_tree_get_cndb(w->cw_tree));
 
@@ -259,6 +347,7 @@ cn_subspill(
     assert(child);
 
     kvset_builder_set_merge_stats(child, &w->cw_stats);
+    kvset_builder_set_tbkt(child, w->cw_tbkt_wr);
 
     err = kvset_builder_set_agegroup(child, HSE_MPOLICY_AGE_LEAF);
     if (err) {
@@ -287,6 +376,16 @@ cn_subspill(
             sctx->pt_set = false;
     }
 
+    if (rtcnt > 0) {
+        err = subspill_rtombs(sctx, child, node_dgen, ekey, eklen, NULL);
+        if (err) {
+            kvset_builder_destroy(child);
+            return err;
+        }
+
+        ss->ss_added = true;
+    }
+
     new_key = true;
 
     tstart = perfc_ison(w->cw_pc, PERFC_DI_CNCOMP_VGET) ? 1 : 0;
@@ -310,6 +409,15 @@ cn_subspill(
 
             if (sctx->pt_set && key_obj_cmp_prefix(&sctx->pt_kobj, &sctx->curr->kobj) != 0)
                 sctx->pt_set = false; /* cached ptomb key is no longer valid */
+
+            rt_seq = 0;
+            if (sctx->rtombs.rv_cnt > 0) {
+                char kbuf[HSE_KVS_KEY_LEN_MAX];
+                uint klen;
+
+                key_obj_copy(kbuf, sizeof(kbuf), &klen, &sctx->curr->kobj);
+                rt_seq = rtomb_vec_lookup(&sctx->rtombs, kbuf, klen, w->cw_horizon);
+            }
         }
 
         while (!bg_val) {
@@ -368,6 +476,9 @@ cn_subspill(
             if (bg_val && sctx->pt_set && w->cw_horizon >= sctx->pt_seq && sctx->pt_seq > seq)
                 break; /* drop val if it and pt are beyond horizon */
 
+            if (rt_seq > seq)
+                break; /* drop val hidden by an rtomb beyond horizon */
+
             /* Set ptomb context irrespective of bg_val for tombstone propagation */
             if (HSE_CORE_IS_PTOMB(vdata)) {
                 sctx->pt_set = true;
@@ -485,6 +596,8 @@ out:
     if (sctx->pt_set && key_obj_cmp_prefix(&sctx->pt_kobj, &ekobj) != 0)
         sctx->pt_set = false;
 
+    subspill_ekey_save(sctx, ekey, eklen);
+
     kvset_builder_destroy(child);
     free(buf);
 
@@ -27,6 +27,7 @@
 #include <hse/util/page.h>
 #include <hse/util/perfc.h>
 #include <hse/util/slab.h>
+#include <hse/util/token_bucket.h>
 #include <hse/util/vlb.h>
 
 #include "blk_list.h"
@@ -90,6 +91,7 @@ struct vblock_builder {
     struct cn *cn;
     struct perfc_set *pc;
     struct cn_merge_stats *mstats;
+    struct tbkt *tbkt;
     struct blk_list vblk_list;
     enum hse_mclass_policy_age agegroup;
     uint64_t vsize;
@@ -210,6 +212,9 @@ vblock_write(struct vblock_builder *bld)
     perfc_inc(bld->pc, PERFC_RA_CNCOMP_WREQS);
     perfc_add(bld->pc, PERFC_RA_CNCOMP_WBYTES, bld->wbuf_len);
 
+    if (bld->tbkt)
+        tbkt_throttle(bld->tbkt, iov.iov_len);
+
     return 0;
 }
 
@@ -453,6 +458,12 @@ vbb_set_merge_stats(struct vblock_builder *bld, struct cn_merge_stats *stats)
     bld->mstats = stats;
 }
 
+void
+vbb_set_tbkt(struct vblock_builder *bld, struct tbkt *tb)
+{
+    bld->tbkt = tb;
+}
+
 uint64_t
 vbb_vlen_get(const struct vblock_builder *bld)
 {
@@ -16,6 +16,7 @@ struct cn;
 struct cn_merge_stats;
 struct key_obj;
 struct kvs_rparams;
+struct tbkt;
 struct vblock_builder;
 
 enum hse_mclass;
@@ -126,6 +127,10 @@ vbb_get_agegroup(const struct vblock_builder *bld);
 void
 vbb_set_merge_stats(struct vblock_builder *bld, struct cn_merge_stats *stats);
 
+void
+vbb_set_tbkt(struct vblock_builder *bld, struct tbkt *tb);
+
+/* MTF_MOCK */
 uint64_t
 vbb_vlen_get(const struct vblock_builder *bld);
 
@@ -117,6 +117,20 @@ wbti_get_page(struct wbti *self, uint32_t node_idx)
     self->node_idx = node_idx;
 }
 
+/* Internal nodes are only read by wbtr_seek_page(), so it's the only
+ * place that needs to know about the in-memory copy.
+ */
+static inline const void *
+wbtr_ine_node(const void *base, const struct wbt_desc *wbd, uint node_num)
+{
+    const void *ine_base = wbd->wbd_ine_base;
+
+    if (ine_base && node_num >= wbd->wbd_leaf_cnt)
+        return ine_base + (size_t)(node_num - wbd->wbd_leaf_cnt) * PAGE_SIZE;
+
+    return base + (size_t)(wbd->wbd_first_page + node_num) * PAGE_SIZE;
+}
+
 static int
 wbtr_seek_page(
     const void *base,
@@ -128,20 +142,15 @@ wbtr_seek_page(
     const struct wbt_node_hdr_omf *node;
     int j, cmp, node_num;
     uint cmplen;
-    size_t pg;
-
-    /* pull struct derefs out of the loop */
-    uint first_page = wbd->wbd_first_page;
 
     /* search from root */
     node_num = wbd->wbd_root;
 
-    /* prefetch root node header */
-    __builtin_prefetch(base + (first_page + wbd->wbd_root) * PAGE_SIZE);
-
     assert(0 <= node_num && node_num < wbd->wbd_n_pages);
-    pg = first_page + node_num;
-    node = base + pg * PAGE_SIZE;
+    node = wbtr_ine_node(base, wbd, node_num);
+
+    /* prefetch root node header */
+    __builtin_prefetch(node);
 
     while (omf_wbn_magic(node) == WBT_INE_NODE_MAGIC) {
         const struct wbt_ine_omf *ine;
@@ -202,8 +211,7 @@ wbtr_seek_page(
         node_num = omf_ine_left_child(ine);
 
         assert(0 <= node_num && node_num < wbd->wbd_n_pages);
-        pg = first_page + node_num;
-        node = base + pg * PAGE_SIZE;
+        node = wbtr_ine_node(base, wbd, node_num);
         __builtin_prefetch(node);
     }
 
@@ -600,22 +608,65 @@ skip_search:
     return !cmp;
 }
 
+/* Issue readahead for the next window of leaf nodes below ra_idx once a
+ * reverse iterator has consumed half of the current window.
+ */
+static void
+wbti_readahead_rev(struct wbti *self)
+{
+    const struct wbt_desc *wbd = self->wbd;
+    uint32_t lo;
+
+    if (self->node_idx > self->ra_idx + WBTI_REV_RA_PAGES / 2 || self->ra_idx <= wbd->wbd_leaf)
+        return;
+
+    lo = self->ra_idx - min_t(uint32_t, self->ra_idx - wbd->wbd_leaf, WBTI_REV_RA_PAGES);
+
+    /* Errors are harmless, the pages are simply faulted in on access.
+     */
+    madvise(
+        (void *)self->base + PAGE_SIZE * (wbd->wbd_first_page + lo),
+        PAGE_SIZE * (self->ra_idx - lo), MADV_WILLNEED);
+
+    self->ra_idx = lo;
+}
+
 bool
 wbti_seek(struct wbti *self, struct kvs_ktuple *seek)
 {
+    bool found;
+
     if (HSE_UNLIKELY(!self->wbd->wbd_n_pages))
         return false;
 
-    return self->reverse ? wbti_seek_rev(self, seek) : wbti_seek_fwd(self, seek);
+    if (!self->reverse)
+        return wbti_seek_fwd(self, seek);
+
+    found = wbti_seek_rev(self, seek);
+
+    /* The seek leaf has just been faulted in, restart reverse readahead
+     * with the leaves below it rather than from wherever it last was.
+     */
+    self->ra_idx = self->node_idx;
+    if (found)
+        wbti_readahead_rev(self);
+
+    return found;
 }
 
 static void
 wbti_node_prev(struct wbti *self)
 {
-    if (self->node_idx > 0)
+    if (self->node_idx > self->wbd->wbd_leaf) {
         wbti_get_page(self, self->node_idx - 1);
-    else
+
+        if (self->node_idx > self->wbd->wbd_leaf)
+            __builtin_prefetch(self->node - PAGE_SIZE);
+
+        wbti_readahead_rev(self);
+    } else {
         self->node_idx = NODE_EOF;
+    }
 
     self->lfe_idx = omf_wbn_num_keys(self->node) - 1;
 }
@@ -698,6 +749,7 @@ wbti_next_rev(struct wbti *self, const void **kdata, uint *klen, const void **km
 
     /* Set outputs */
     wbt_lfe_key(self->node, lfe, kdata, klen);
+    __builtin_prefetch(*kdata);
     off = wbt_lfe_kmd(self->node, lfe);
     assert(off < self->wbd->wbd_kmd_pgc * PAGE_SIZE);
     *kmd = self->kmd + off;
@@ -732,7 +784,11 @@ wbti_reset(
     self->lfe_idx = 0;
     self->reverse = reverse;
 
+    self->ra_idx = 0;
+
     if (seek) {
+        /* wbti_seek() starts reverse readahead from the seek leaf.
+         */
         if (!wbti_seek(self, seek))
             self->node_idx = NODE_EOF;
     } else {
@@ -741,6 +797,12 @@ wbti_reset(
         if (reverse) {
             self->lfe_idx = omf_wbn_num_keys(self->node);
             self->node_idx = desc->wbd_leaf + desc->wbd_leaf_cnt - 1;
+
+            /* The last leaf has just been faulted in, reverse readahead
+             * begins with the leaves below it.
+             */
+            self->ra_idx = self->node_idx;
+            wbti_readahead_rev(self);
         }
     }
 }
@@ -941,6 +1003,7 @@ wbtr_read_desc(const struct wbt_hdr_omf *wbt_hdr, struct wbt_desc *desc)
         desc->wbd_leaf = omf_wbt_leaf(wbt_hdr);
         desc->wbd_leaf_cnt = omf_wbt_leaf_cnt(wbt_hdr);
         desc->wbd_kmd_pgc = omf_wbt_kmd_pgc(wbt_hdr);
+        desc->wbd_ine_base = NULL;
         break;
 
     default:
@@ -29,6 +29,7 @@ struct vgmap;
  * @wbd_leaf: first leaf node (@wbd_leaf < @wbd_n_pages)
  * @wbd_leaf_cnt: number of leaf nodes
  * @wbd_kmd_pgc: size of key-metadata region in pages
+ * @wbd_ine_base: optional in-memory copy of the internal nodes, or NULL
  *
  * When a KBLOCK is opened for reading, the @wbt_hdr_omf struct is read from
  * media and the relevant information is stored in a @wbt_desc struct.
@@ -38,6 +39,10 @@ struct vgmap;
  *    So, if @wbt_first_page=2 and @wbt_n_pages=3, then the WBT
  *    data region occupies pages 2,3 and 4 -- which maps
  *    to bytes 2*4096 to 5*4096-1 (end of page 4).
+ *  - Internal nodes occupy node numbers [@wbd_leaf_cnt, @wbd_root].  If
+ *    @wbd_ine_base is set, searches read them from there rather than from
+ *    the mblock mapping (see kvset_kblk_hpcache_load()).  It may be set
+ *    while the kblock is in use, so read it once per node lookup.
  */
 struct wbt_desc {
     uint32_t wbd_first_page;
@@ -47,8 +52,16 @@ struct wbt_desc {
     uint16_t wbd_leaf_cnt;
     uint16_t wbd_kmd_pgc;
     uint16_t wbd_version;
+    const void *wbd_ine_base;
 };
 
+/* Number of leaf nodes a reverse iterator asks the kernel to read ahead of
+ * it.  Faults on descending addresses of a mapping get no asynchronous
+ * readahead, so without this reverse leaf traversal mostly stalls on
+ * synchronous page faults where forward traversal would not.
+ */
+#define WBTI_REV_RA_PAGES (32)
+
 struct wbti {
     struct wbt_desc *wbd; /* MUST BE FIRST */
     const void *base;
@@ -56,6 +69,7 @@ struct wbti {
     const void *kmd;
     uint32_t node_idx;
     uint32_t lfe_idx;
+    uint32_t ra_idx;
 
     bool reverse;
 };
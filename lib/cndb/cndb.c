@@ -16,6 +16,7 @@
 #include <hse/util/event_counter.h>
 #include <hse/util/map.h>
 #include <hse/util/platform.h>
+#include <hse/util/workqueue.h>
 
 #include "cn/kvset.h"
 #include "cn/kvset_internal.h"
@@ -26,10 +27,18 @@
 struct cndb_cn {
     uint64_t cnid;
     struct map *kvset_map;
+    struct map *snap_map;
     struct kvs_cparams cp;
     char name[HSE_KVS_NAME_LEN_MAX];
 };
 
+/* Opaque kvset snapshot supplied by cN via cndb_kvset_snap_set().
+ */
+struct cndb_kvset_snap {
+    uint32_t cks_len;
+    uint8_t cks_data[];
+};
+
 struct cndb {
     struct mutex mutex;
     uint16_t cndb_version;
@@ -44,6 +53,13 @@ struct cndb {
 
     bool replaying;
     bool allow_writes;
+    bool snap_dirty;
+    bool compact_pending;
+    bool compact_busy;
+
+    /* Background log compaction */
+    struct workqueue_struct *compact_wq;
+    struct work_struct compact_work;
 
     /* Mpool and mdc. */
     struct mpool *mp;
@@ -125,6 +141,9 @@ cndb_destroy(struct mpool *mp, uint64_t oid1, uint64_t oid2)
     return mpool_mdc_delete(mp, oid1, oid2);
 }
 
+static void
+cndb_compact_worker(struct work_struct *work);
+
 merr_t
 cndb_open(
     struct mpool *mp,
@@ -166,6 +185,15 @@ cndb_open(
         goto err_out;
     }
 
+    /* Without a workqueue the log is compacted inline by the caller
+     * that crosses the high water mark.
+     */
+    if (cndb->allow_writes) {
+        INIT_WORK(&cndb->compact_work, cndb_compact_worker);
+        cndb->compact_wq = alloc_workqueue("hse_cndb_compact", 0, 1, 1);
+        ev(!cndb->compact_wq);
+    }
+
     *cndb_out = cndb;
 
     return 0;
@@ -181,16 +209,29 @@ cndb_cn_destroy(uint64_t key, uintptr_t val)
 {
     struct cndb_cn *cn = (void *)val;
     struct cndb_kvset *kvset;
-    struct map_iter kvset_iter;
+    struct cndb_kvset_snap *snap;
+    struct map_iter kvset_iter, snap_iter;
 
     map_iter_init(&kvset_iter, cn->kvset_map);
     while (map_iter_next_val(&kvset_iter, &kvset))
         free(kvset);
 
     map_destroy(cn->kvset_map);
+
+    map_iter_init(&snap_iter, cn->snap_map);
+    while (map_iter_next_val(&snap_iter, &snap))
+        free(snap);
+
+    map_destroy(cn->snap_map);
     free(cn);
 }
 
+static void
+cndb_kvset_snap_free(struct cndb_cn *cn, uint64_t kvsetid)
+{
+    free(map_remove_ptr(cn->snap_map, kvsetid));
+}
+
 static merr_t
 cndb_txn_free_cb(struct cndb_txn *tx, struct cndb_kvset *kvset, bool isadd, bool isacked, void *ctx)
 {
@@ -213,6 +254,22 @@ cndb_close(struct cndb *cndb)
     if (ev(!cndb))
         return 0;
 
+    /* Wait for an in-flight background compaction to finish.
+     */
+    destroy_workqueue(cndb->compact_wq);
+    cndb->compact_wq = NULL;
+
+    /* Rewrite the log on a clean close if there are kvset snapshots
+     * that haven't been persisted, so that the next open can use them.
+     * The snapshots are only an optimization, hence errors are ignored.
+     */
+    if (cndb->snap_dirty && cndb->allow_writes) {
+        mutex_lock(&cndb->mutex);
+        err = cndb_compact(cndb);
+        mutex_unlock(&cndb->mutex);
+        ev(err);
+    }
+
     err = mpool_mdc_close(cndb->mdc);
     if (ev(err))
         return err;
@@ -262,20 +319,100 @@ cndb_kvs_info(struct cndb *cndb, void *cb_ctx, cndb_kvs_callback *cb)
     return 0;
 }
 
-static bool
-cndb_needs_compaction(struct cndb *cndb)
+static double
+cndb_usage_pct(struct cndb *cndb)
 {
     merr_t err;
     uint64_t size, allocated, used;
-    double hwm;
 
     err = mpool_mdc_usage(cndb->mdc, &size, &allocated, &used);
-    if (ev(err))
-        return false;
+    if (ev(err) || !size)
+        return 0;
 
-    hwm = (cndb->cndb_hwm * size) / 100;
+    return (used * 100.0) / size;
+}
 
-    return used > hwm;
+static bool
+cndb_needs_compaction(struct cndb *cndb)
+{
+    return cndb_usage_pct(cndb) > cndb->cndb_hwm;
+}
+
+static merr_t
+cndb_compact_write(struct cndb *cndb, struct mpool_mdc *mdc);
+
+/* The mutex is held only while the compacted image is serialized into memory
+ * from the in-memory state.  Writing and syncing the image runs without it,
+ * and records appended in the meantime go to the current log as usual and are
+ * replayed onto the image by mpool_mdc_cend_bg().
+ */
+static void
+cndb_compact_worker(struct work_struct *work)
+{
+    struct cndb *cndb = container_of(work, struct cndb, compact_work);
+    struct mpool_mdc *img;
+    bool snap_dirty;
+    merr_t err;
+
+    mutex_lock(&cndb->mutex);
+    if (!cndb_needs_compaction(cndb)) {
+        cndb->compact_pending = false;
+        mutex_unlock(&cndb->mutex);
+        return;
+    }
+
+    snap_dirty = cndb->snap_dirty;
+
+    err = mpool_mdc_cstart_bg(cndb->mdc, &img);
+    if (!err) {
+        err = cndb_compact_write(cndb, img);
+        if (err)
+            mpool_mdc_cabort(cndb->mdc);
+    }
+
+    cndb->compact_busy = !err;
+    mutex_unlock(&cndb->mutex);
+
+    if (!err)
+        err = mpool_mdc_cend_bg(cndb->mdc);
+
+    mutex_lock(&cndb->mutex);
+    if (err && snap_dirty)
+        cndb->snap_dirty = true;
+    cndb->compact_busy = false;
+    cndb->compact_pending = false;
+    mutex_unlock(&cndb->mutex);
+
+    if (err)
+        log_errx("cndb background compaction failed", err);
+}
+
+/* Called with cndb->mutex held before appending a record.  Crossing the high
+ * water mark only schedules a background compaction, so the caller appends to
+ * the current log and returns without paying for the rewrite.  The caller
+ * compacts inline only if the log has filled halfway between the high water
+ * mark and its capacity, i.e., the background compaction has fallen behind.
+ * While the background compaction is writing its image the log can't be
+ * compacted inline, and it grows into its remaining capacity instead.
+ */
+static merr_t
+cndb_compact_maybe(struct cndb *cndb)
+{
+    double pct = cndb_usage_pct(cndb);
+
+    if (pct <= cndb->cndb_hwm || cndb->compact_busy)
+        return 0;
+
+    if (cndb->compact_wq && pct <= (cndb->cndb_hwm + 100) / 2) {
+        if (!cndb->compact_pending) {
+            cndb->compact_pending = true;
+            queue_work(cndb->compact_wq, &cndb->compact_work);
+        }
+
+        return 0;
+    }
+
+    return cndb_compact(cndb);
 }
 
 static merr_t
@@ -321,14 +458,19 @@ cndb_record_kvs_add_inner(
         return merr(ENOMEM);
     }
 
+    cn->snap_map = map_create(0);
+    if (ev(!cn->snap_map)) {
+        map_destroy(cn->kvset_map);
+        free(cn);
+        return merr(ENOMEM);
+    }
+
     mutex_lock(&cndb->mutex);
 
     if (!cndb->replaying) {
-        if (cndb_needs_compaction(cndb)) {
-            err = cndb_compact(cndb);
-            if (ev(err))
-                goto out;
-        }
+        err = cndb_compact_maybe(cndb);
+        if (ev(err))
+            goto out;
     }
 
     err = map_insert_ptr(cndb->cn_map, cn->cnid, cn);
@@ -346,6 +488,8 @@ out:
 
     if (err) {
         map_remove(cndb->cn_map, cn->cnid, NULL);
+        map_destroy(cn->snap_map);
+        map_destroy(cn->kvset_map);
         free(cn);
     }
 
@@ -377,11 +521,9 @@ cndb_record_kvs_del(struct cndb *cndb, uint64_t cnid)
     }
 
     if (!cndb->replaying) {
-        if (cndb_needs_compaction(cndb)) {
-            err = cndb_compact(cndb);
-            if (ev(err))
-                goto out;
-        }
+        err = cndb_compact_maybe(cndb);
+        if (ev(err))
+            goto out;
 
         err = cndb_omf_kvs_del_write(cndb->mdc, cn->cnid);
         if (ev(err))
@@ -409,6 +551,7 @@ cndb_record_txstart_inner(
     struct cndb_txn **tx_out)
 {
     struct cndb_txn *tx = 0;
+    uint64_t gen = 0;
     merr_t err = 0;
 
     mutex_lock(&cndb->mutex);
@@ -422,11 +565,9 @@ cndb_record_txstart_inner(
     }
 
     if (!cndb->replaying) {
-        if (cndb_needs_compaction(cndb)) {
-            err = cndb_compact(cndb);
-            if (ev(err))
-                goto out;
-        }
+        err = cndb_compact_maybe(cndb);
+        if (ev(err))
+            goto out;
     }
 
     err = map_insert_ptr(cndb->tx_map, txid, tx);
@@ -434,7 +575,8 @@ cndb_record_txstart_inner(
         goto out;
 
     if (!cndb->replaying) {
-        err = cndb_omf_txstart_write(cndb->mdc, txid, seqno, ingestid, txhorizon, add_cnt, del_cnt);
+        err = cndb_omf_txstart_write(
+            cndb->mdc, txid, seqno, ingestid, txhorizon, add_cnt, del_cnt, &gen);
         if (ev(err))
             goto out;
     }
@@ -450,8 +592,13 @@ cndb_record_txstart_inner(
 out:
     mutex_unlock(&cndb->mutex);
 
+    if (!err && gen)
+        err = mpool_mdc_sync_wait(cndb->mdc, gen);
+
     if (err) {
+        mutex_lock(&cndb->mutex);
         map_remove(cndb->tx_map, cndb_txn_txid_get(tx), NULL);
+        mutex_unlock(&cndb->mutex);
         cndb_txn_destroy(tx);
     } else if (tx_out) {
         *tx_out = tx;
@@ -523,11 +670,9 @@ cndb_record_kvset_add(
     mutex_lock(&cndb->mutex);
 
     if (!cndb->replaying) {
-        if (cndb_needs_compaction(cndb)) {
-            err = cndb_compact(cndb);
-            if (ev(err))
-                goto out;
-        }
+        err = cndb_compact_maybe(cndb);
+        if (ev(err))
+            goto out;
     }
 
     err = cndb_txn_kvset_add(
@@ -554,16 +699,15 @@ cndb_record_kvset_del(
     uint64_t kvsetid,
     void **cookie)
 {
+    uint64_t gen = 0;
     merr_t err;
 
     mutex_lock(&cndb->mutex);
 
     if (!cndb->replaying) {
-        if (cndb_needs_compaction(cndb)) {
-            err = cndb_compact(cndb);
-            if (ev(err))
-                goto out;
-        }
+        err = cndb_compact_maybe(cndb);
+        if (ev(err))
+            goto out;
     }
 
     err = cndb_txn_kvset_del(tx, cnid, kvsetid, cookie);
@@ -571,11 +715,14 @@ cndb_record_kvset_del(
         goto out;
 
     if (!cndb->replaying)
-        err = cndb_omf_kvset_del_write(cndb->mdc, cndb_txn_txid_get(tx), cnid, kvsetid);
+        err = cndb_omf_kvset_del_write(cndb->mdc, cndb_txn_txid_get(tx), cnid, kvsetid, &gen);
 
 out:
     mutex_unlock(&cndb->mutex);
 
+    if (!err && gen)
+        err = mpool_mdc_sync_wait(cndb->mdc, gen);
+
     return err;
 }
 
@@ -588,6 +735,7 @@ cndb_record_kvsetv_move(
     uint32_t kvset_idc,
     const uint64_t *kvset_idv)
 {
+    uint64_t gen = 0;
     merr_t err = 0;
 
     INVARIANT(cndb && kvset_idc > 0 && kvset_idv);
@@ -615,20 +763,21 @@ cndb_record_kvsetv_move(
         }
 
         if (!err && !cndb->replaying) {
-            if (cndb_needs_compaction(cndb)) {
-                err = cndb_compact(cndb);
-                if (err)
-                    break;
-            }
+            err = cndb_compact_maybe(cndb);
+            if (err)
+                break;
 
             err = cndb_omf_kvset_move_write(
-                cndb->mdc, cnid, src_nodeid, tgt_nodeid, kvset_idc, kvset_idv);
+                cndb->mdc, cnid, src_nodeid, tgt_nodeid, kvset_idc, kvset_idv, &gen);
             if (err)
                 break;
         }
     } while (0);
     mutex_unlock(&cndb->mutex);
 
+    if (!err && gen)
+        err = mpool_mdc_sync_wait(cndb->mdc, gen);
+
     return err;
 }
 
@@ -686,6 +835,7 @@ process_finished_del_txn_cb(
         goto errout;
     }
 
+    cndb_kvset_snap_free(cn, delme->ck_kvsetid);
     free(delme);
 
 errout:
@@ -700,15 +850,14 @@ cndb_record_kvset_ack_cmn(struct cndb *cndb, struct cndb_txn *tx, uint ack_type,
     merr_t err = 0;
     struct cndb_kvset *kvset;
     uint64_t txid = cndb_txn_txid_get(tx);
+    uint64_t gen = 0;
 
     mutex_lock(&cndb->mutex);
 
     if (!cndb->replaying) {
-        if (cndb_needs_compaction(cndb)) {
-            err = cndb_compact(cndb);
-            if (ev(err))
-                goto out;
-        }
+        err = cndb_compact_maybe(cndb);
+        if (ev(err))
+            goto out;
     }
 
     err = cndb->replaying ? cndb_txn_ack_by_kvsetid(tx, (uint64_t)cookie, &kvset)
@@ -717,7 +866,8 @@ cndb_record_kvset_ack_cmn(struct cndb *cndb, struct cndb_txn *tx, uint ack_type,
         goto out;
 
     if (!cndb->replaying) {
-        err = cndb_omf_ack_write(cndb->mdc, txid, kvset->ck_cnid, ack_type, kvset->ck_kvsetid);
+        err = cndb_omf_ack_write(
+            cndb->mdc, txid, kvset->ck_cnid, ack_type, kvset->ck_kvsetid, &gen);
         if (ev(err))
             goto out;
     }
@@ -736,6 +886,9 @@ cndb_record_kvset_ack_cmn(struct cndb *cndb, struct cndb_txn *tx, uint ack_type,
 out:
     mutex_unlock(&cndb->mutex);
 
+    if (!err && gen)
+        err = mpool_mdc_sync_wait(cndb->mdc, gen);
+
     return err;
 }
 
@@ -754,22 +907,25 @@ cndb_record_kvset_del_ack(struct cndb *cndb, struct cndb_txn *tx, void *cookie)
 merr_t
 cndb_record_nak(struct cndb *cndb, struct cndb_txn *tx)
 {
+    uint64_t gen = 0;
     merr_t err = 0;
 
     mutex_lock(&cndb->mutex);
 
     if (!cndb->replaying) {
-        if (cndb_needs_compaction(cndb)) {
-            err = cndb_compact(cndb);
-            if (ev(err))
-                goto out;
-        }
+        err = cndb_compact_maybe(cndb);
+        if (ev(err))
+            goto out;
 
-        err = cndb_omf_nak_write(cndb->mdc, cndb_txn_txid_get(tx));
+        err = cndb_omf_nak_write(cndb->mdc, cndb_txn_txid_get(tx), &gen);
     }
 
 out:
     mutex_unlock(&cndb->mutex);
+
+    if (!err && gen)
+        err = mpool_mdc_sync_wait(cndb->mdc, gen);
+
     map_remove(cndb->tx_map, cndb_txn_txid_get(tx), NULL);
     cndb_txn_apply(tx, &cndb_txn_free_cb, NULL);
     cndb_txn_destroy(tx);
@@ -785,18 +941,18 @@ compact_incomplete_intents(
     bool isacked,
     void *ctx)
 {
-    struct cndb *cndb = ctx;
+    struct mpool_mdc *mdc = ctx;
     uint64_t txid = cndb_txn_txid_get(tx);
     merr_t err;
 
     if (!isadd)
-        return cndb_omf_kvset_del_write(cndb->mdc, txid, kvset->ck_cnid, kvset->ck_kvsetid);
+        return cndb_omf_kvset_del_write(mdc, txid, kvset->ck_cnid, kvset->ck_kvsetid, NULL);
 
     if (cndb_txn_can_rollforward(tx))
         return 0;
 
     err = cndb_omf_kvset_add_write(
-        cndb->mdc, txid, kvset->ck_cnid, kvset->ck_kvsetid, kvset->ck_nodeid, kvset->ck_dgen_hi,
+        mdc, txid, kvset->ck_cnid, kvset->ck_kvsetid, kvset->ck_nodeid, kvset->ck_dgen_hi,
         kvset->ck_dgen_lo, kvset->ck_vused, kvset->ck_vgarb, kvset->ck_compc, kvset->ck_rule,
         kvset->ck_hblkid, kvset->ck_kblkc, kvset->ck_kblkv, kvset->ck_vblkc, kvset->ck_vblkv);
 
@@ -811,7 +967,7 @@ compact_incomplete_acks(
     bool isacked,
     void *ctx)
 {
-    struct cndb *cndb = ctx;
+    struct mpool_mdc *mdc = ctx;
     uint64_t txid = cndb_txn_txid_get(tx);
     int type = isadd ? CNDB_ACK_TYPE_ADD : CNDB_ACK_TYPE_DEL;
 
@@ -821,11 +977,11 @@ compact_incomplete_acks(
     if (isadd && cndb_txn_can_rollforward(tx))
         return 0;
 
-    return cndb_omf_ack_write(cndb->mdc, txid, kvset->ck_cnid, type, kvset->ck_kvsetid);
+    return cndb_omf_ack_write(mdc, txid, kvset->ck_cnid, type, kvset->ck_kvsetid, NULL);
 }
 
 static merr_t
-log_full_rec(struct cndb *cndb, struct cndb_kvset *kvset)
+log_full_rec(struct cndb *cndb, struct mpool_mdc *mdc, struct cndb_kvset *kvset)
 {
     merr_t err;
     uint64_t txid = 1;
@@ -837,18 +993,19 @@ log_full_rec(struct cndb *cndb, struct cndb_kvset *kvset)
      * proceessed sequentially upon replay.
      */
     err = cndb_omf_txstart_write(
-        cndb->mdc, txid, cndb->seqno_max, cndb->ingestid_max, cndb->txhorizon_max, 1, 0);
+        mdc, txid, cndb->seqno_max, cndb->ingestid_max, cndb->txhorizon_max, 1, 0, NULL);
     if (ev(err))
         return err;
 
     err = cndb_omf_kvset_add_write(
-        cndb->mdc, txid, kvset->ck_cnid, kvset->ck_kvsetid, kvset->ck_nodeid, kvset->ck_dgen_hi,
+        mdc, txid, kvset->ck_cnid, kvset->ck_kvsetid, kvset->ck_nodeid, kvset->ck_dgen_hi,
         kvset->ck_dgen_lo, kvset->ck_vused, kvset->ck_vgarb, kvset->ck_compc, kvset->ck_rule,
         kvset->ck_hblkid, kvset->ck_kblkc, kvset->ck_kblkv, kvset->ck_vblkc, kvset->ck_vblkv);
     if (ev(err))
         return err;
 
-    err = cndb_omf_ack_write(cndb->mdc, txid, kvset->ck_cnid, CNDB_ACK_TYPE_ADD, kvset->ck_kvsetid);
+    err = cndb_omf_ack_write(
+        mdc, txid, kvset->ck_cnid, CNDB_ACK_TYPE_ADD, kvset->ck_kvsetid, NULL);
     if (ev(err))
         return err;
 
@@ -856,7 +1013,7 @@ log_full_rec(struct cndb *cndb, struct cndb_kvset *kvset)
 }
 
 static merr_t
-write_compacted_log(struct cndb *cndb)
+write_compacted_log(struct cndb *cndb, struct mpool_mdc *mdc)
 {
     struct map_iter cniter;
     struct cndb_cn *cn;
@@ -870,45 +1027,55 @@ write_compacted_log(struct cndb *cndb)
         struct map_iter kvset_iter;
         struct cndb_kvset *kvset;
 
-        err = cndb_omf_kvs_add_write(cndb->mdc, cn->cnid, &cn->cp, cn->name);
+        err = cndb_omf_kvs_add_write(mdc, cn->cnid, &cn->cp, cn->name);
         if (ev(err))
             return err;
 
         map_iter_init(&kvset_iter, cn->kvset_map);
 
         while (map_iter_next_val(&kvset_iter, &kvset)) {
-            err = log_full_rec(cndb, kvset);
+            struct cndb_kvset_snap *snap;
+
+            err = log_full_rec(cndb, mdc, kvset);
             if (ev(err))
                 return err;
+
+            snap = map_lookup_ptr(cn->snap_map, kvset->ck_kvsetid);
+            if (snap) {
+                err = cndb_omf_kvset_snap_write(
+                    mdc, cn->cnid, kvset->ck_kvsetid, snap->cks_data, snap->cks_len);
+                if (ev(err))
+                    return err;
+            }
         }
     }
 
+    cndb->snap_dirty = false;
+
     return 0;
 }
 
-merr_t
-cndb_compact(struct cndb *cndb)
+/* Writes the compacted image of the in-memory state to mdc.
+ * Called with cndb->mutex held.
+ */
+static merr_t
+cndb_compact_write(struct cndb *cndb, struct mpool_mdc *mdc)
 {
     struct map_iter txiter;
     struct cndb_txn *tx;
     uint64_t txid;
     merr_t err;
 
-    /* Start cndb compact with cstart and cndb meta records */
-    err = mpool_mdc_cstart(cndb->mdc);
-    if (ev(err))
-        return err;
-
-    err = cndb_omf_ver_write(cndb->mdc, cndb->cndb_captgt);
+    err = cndb_omf_ver_write(mdc, cndb->cndb_captgt);
     if (ev(err))
         return err;
 
-    err = cndb_omf_meta_write(cndb->mdc, cndb->seqno_max);
+    err = cndb_omf_meta_write(mdc, cndb->seqno_max);
     if (ev(err))
         return err;
 
     /* Write completed transactions */
-    err = write_compacted_log(cndb);
+    err = write_compacted_log(cndb, mdc);
     if (ev(err))
         return err;
 
@@ -926,20 +1093,37 @@ cndb_compact(struct cndb *cndb)
         }
 
         err = cndb_omf_txstart_write(
-            cndb->mdc, txid, cndb->seqno_max, cndb->ingestid_max, cndb->txhorizon_max, add_cnt,
-            del_cnt);
+            mdc, txid, cndb->seqno_max, cndb->ingestid_max, cndb->txhorizon_max, add_cnt,
+            del_cnt, NULL);
         if (ev(err))
             return err;
 
-        err = cndb_txn_apply(tx, &compact_incomplete_intents, cndb);
+        err = cndb_txn_apply(tx, &compact_incomplete_intents, mdc);
         if (ev(err))
             return err;
 
-        err = cndb_txn_apply(tx, &compact_incomplete_acks, cndb);
+        err = cndb_txn_apply(tx, &compact_incomplete_acks, mdc);
         if (ev(err))
             return err;
     }
 
+    return 0;
+}
+
+merr_t
+cndb_compact(struct cndb *cndb)
+{
+    merr_t err;
+
+    /* Start cndb compact with cstart and cndb meta records */
+    err = mpool_mdc_cstart(cndb->mdc);
+    if (ev(err))
+        return err;
+
+    err = cndb_compact_write(cndb, cndb->mdc);
+    if (ev(err))
+        return err;
+
     return mpool_mdc_cend(cndb->mdc);
 }
 
@@ -1107,6 +1291,16 @@ cndb_read_record(struct cndb *cndb, struct cndb_reader *reader)
 
         err = cndb_record_nak(cndb, txid2tx(cndb, txid));
         ev(err);
+
+    } else if (rec_type == CNDB_TYPE_KVSET_SNAP) {
+        uint64_t cnid, kvsetid;
+        const void *snap;
+        uint32_t snaplen;
+
+        cndb_omf_kvset_snap_read(reader->recbuf, &cnid, &kvsetid, &snaplen, &snap);
+
+        err = cndb_kvset_snap_set(cndb, cnid, kvsetid, snap, snaplen);
+        ev(err);
     } else {
         assert(0);
         return merr(EPROTO);
@@ -1307,7 +1501,7 @@ recover_incomplete_txn_cb(
             kvset_mblock_delete(rctx->mp, rctx->mbid_map, delme);
             err = cndb_omf_ack_write(
                 rctx->mdc, cndb_txn_txid_get(tx), delme->ck_cnid, CNDB_ACK_TYPE_DEL,
-                delme->ck_kvsetid);
+                delme->ck_kvsetid, NULL);
         }
 
         free(delme);
@@ -1373,7 +1567,7 @@ cndb_replay(struct cndb *cndb, uint64_t *seqno, uint64_t *ingestid, uint64_t *tx
 
         err = cndb_txn_apply(tx, &recover_incomplete_txn_cb, &rctx);
         if (!err && rctx.is_rollback && cndb->allow_writes)
-            err = cndb_omf_nak_write(cndb->mdc, txid);
+            err = cndb_omf_nak_write(cndb->mdc, txid, NULL);
 
         map_remove(cndb->tx_map, cndb_txn_txid_get(tx), NULL);
         cndb_txn_destroy(tx);
@@ -1423,6 +1617,7 @@ cndb_cn_instantiate(struct cndb *cndb, uint64_t cnid, void *ctx, cn_init_callbac
             .km_hblk_id = kvset->ck_hblkid,
             .km_restored = true,
         };
+        struct cndb_kvset_snap *snap;
 
         int i;
 
@@ -1435,6 +1630,14 @@ cndb_cn_instantiate(struct cndb *cndb, uint64_t cnid, void *ctx, cn_init_callbac
         for (i = 0; i < kvset->ck_vblkc && !err; i++)
             err = blk_list_append(&km.km_vblk_list, kvset->ck_vblkv[i]);
 
+        /* The snapshot remains owned by the cndb until the kvset is deleted.
+         */
+        snap = map_lookup_ptr(cn->snap_map, kvset->ck_kvsetid);
+        if (snap) {
+            km.km_snap = snap->cks_data;
+            km.km_snaplen = snap->cks_len;
+        }
+
         if (!err)
             err = cb(ctx, &km, kvset->ck_kvsetid);
 
@@ -1462,11 +1665,57 @@ cndb_kvset_delete(struct cndb *cndb, uint64_t cnid, uint64_t kvsetid)
     if (!kvset)
         return merr(EBUG);
 
+    cndb_kvset_snap_free(cn, kvsetid);
     free(kvset);
 
     return 0;
 }
 
+merr_t
+cndb_kvset_snap_set(
+    struct cndb *cndb,
+    uint64_t cnid,
+    uint64_t kvsetid,
+    const void *data,
+    uint32_t len)
+{
+    struct cndb_kvset_snap *snap;
+    struct cndb_cn *cn;
+    merr_t err = 0;
+
+    snap = malloc(sizeof(*snap) + len);
+    if (ev(!snap))
+        return merr(ENOMEM);
+
+    snap->cks_len = len;
+    memcpy(snap->cks_data, data, len);
+
+    mutex_lock(&cndb->mutex);
+
+    cn = map_lookup_ptr(cndb->cn_map, cnid);
+    if (ev(!cn)) {
+        err = merr(ENOENT);
+        goto out;
+    }
+
+    cndb_kvset_snap_free(cn, kvsetid);
+
+    err = map_insert_ptr(cn->snap_map, kvsetid, snap);
+    if (ev(err))
+        goto out;
+
+    snap = NULL;
+
+    if (!cndb->replaying)
+        cndb->snap_dirty = true;
+
+out:
+    mutex_unlock(&cndb->mutex);
+    free(snap);
+
+    return err;
+}
+
 struct kvs_cparams *
 cndb_kvs_cparams(struct cndb *cndb, uint64_t cnid)
 {
@@ -11,8 +11,22 @@
 
 /*
  * OMF Write functions
+ *
+ * Writers of the records that commit cndb transactions take an optional
+ * @gen.  If @gen is NULL the record is synced before returning, otherwise
+ * the caller must pass *@gen to mpool_mdc_sync_wait() once it has dropped
+ * the cndb lock, so that concurrent commits can share a single sync.
  */
 
+static merr_t
+cndb_omf_append(struct mpool_mdc *mdc, void *omf, size_t sz, uint64_t *gen)
+{
+    if (gen)
+        return mpool_mdc_append_async(mdc, omf, sz, gen);
+
+    return mpool_mdc_append(mdc, omf, sz, true);
+}
+
 static void
 cndb_hdr_omf_init(struct cndb_hdr_omf *omf, int type, int len)
 {
@@ -61,6 +75,8 @@ cndb_omf_kvs_add_write(
     if (cp->kvs_ext01)
         flags |= CN_CFLAG_CAPPED;
 
+    flags |= ((uint32_t)cp->merge_op << CN_CFLAG_MERGE_OP_SHIFT) & CN_CFLAG_MERGE_OP_MASK;
+
     cndb_hdr_omf_init(&omf.hdr, CNDB_TYPE_KVS_ADD, sizeof(omf));
 
     omf_set_kvs_add_pfxlen(&omf, cp->pfx_len);
@@ -91,7 +107,8 @@ cndb_omf_txstart_write(
     uint64_t ingestid,
     uint64_t txhorizon,
     uint16_t add_cnt,
-    uint16_t del_cnt)
+    uint16_t del_cnt,
+    uint64_t *gen)
 {
     struct cndb_txstart_omf omf;
 
@@ -104,7 +121,7 @@ cndb_omf_txstart_write(
     omf_set_txstart_add_cnt(&omf, add_cnt);
     omf_set_txstart_del_cnt(&omf, del_cnt);
 
-    return mpool_mdc_append(mdc, &omf, sizeof(omf), true);
+    return cndb_omf_append(mdc, &omf, sizeof(omf), gen);
 }
 
 merr_t
@@ -174,7 +191,12 @@ cndb_omf_kvset_add_write(
 }
 
 merr_t
-cndb_omf_kvset_del_write(struct mpool_mdc *mdc, uint64_t txid, uint64_t cnid, uint64_t kvsetid)
+cndb_omf_kvset_del_write(
+    struct mpool_mdc *mdc,
+    uint64_t txid,
+    uint64_t cnid,
+    uint64_t kvsetid,
+    uint64_t *gen)
 {
     struct cndb_kvset_del_omf omf;
 
@@ -184,7 +206,7 @@ cndb_omf_kvset_del_write(struct mpool_mdc *mdc, uint64_t txid, uint64_t cnid, ui
     omf_set_kvset_del_cnid(&omf, cnid);
     omf_set_kvset_del_kvsetid(&omf, kvsetid);
 
-    return mpool_mdc_append(mdc, &omf, sizeof(omf), true);
+    return cndb_omf_append(mdc, &omf, sizeof(omf), gen);
 }
 
 merr_t
@@ -194,7 +216,8 @@ cndb_omf_kvset_move_write(
     uint64_t src_nodeid,
     uint64_t tgt_nodeid,
     uint32_t kvset_idc,
-    const uint64_t *kvset_idv)
+    const uint64_t *kvset_idv,
+    uint64_t *gen)
 {
     struct cndb_kvset_move_omf *omf_move;
     struct cndb_kvsetid_omf *omf_ks_idv;
@@ -223,7 +246,7 @@ cndb_omf_kvset_move_write(
     for (uint32_t i = 0; i < kvset_idc; i++)
         omf_set_cndb_kvsetid(&omf_ks_idv[i], kvset_idv[i]);
 
-    err = mpool_mdc_append(mdc, omf_move, sz, true);
+    err = cndb_omf_append(mdc, omf_move, sz, gen);
 
     if (sz > sizeof(buf))
         free(omf_move);
@@ -237,7 +260,8 @@ cndb_omf_ack_write(
     uint64_t txid,
     uint64_t cnid,
     unsigned int type,
-    uint64_t kvsetid)
+    uint64_t kvsetid,
+    uint64_t *gen)
 {
     struct cndb_ack_omf omf;
 
@@ -248,18 +272,52 @@ cndb_omf_ack_write(
     omf_set_ack_cnid(&omf, cnid);
     omf_set_ack_kvsetid(&omf, kvsetid);
 
-    return mpool_mdc_append(mdc, &omf, sizeof(omf), true);
+    return cndb_omf_append(mdc, &omf, sizeof(omf), gen);
 }
 
 merr_t
-cndb_omf_nak_write(struct mpool_mdc *mdc, uint64_t txid)
+cndb_omf_nak_write(struct mpool_mdc *mdc, uint64_t txid, uint64_t *gen)
 {
     struct cndb_nak_omf omf;
 
     cndb_hdr_omf_init(&omf.hdr, CNDB_TYPE_NAK, sizeof(omf));
 
     omf_set_nak_txid(&omf, txid);
-    return mpool_mdc_append(mdc, &omf, sizeof(omf), true);
+    return cndb_omf_append(mdc, &omf, sizeof(omf), gen);
+}
+
+merr_t
+cndb_omf_kvset_snap_write(
+    struct mpool_mdc *mdc,
+    uint64_t cnid,
+    uint64_t kvsetid,
+    const void *snap,
+    uint32_t snaplen)
+{
+    struct cndb_kvset_snap_omf *omf;
+    size_t sz;
+    merr_t err;
+
+    sz = sizeof(*omf) + snaplen;
+
+    omf = malloc(sz);
+    if (!omf)
+        return merr(ENOMEM);
+
+    cndb_hdr_omf_init(&omf->hdr, CNDB_TYPE_KVSET_SNAP, sz);
+
+    omf_set_kvset_snap_cnid(omf, cnid);
+    omf_set_kvset_snap_kvsetid(omf, kvsetid);
+    omf_set_kvset_snap_len(omf, snaplen);
+    omf->kvset_snap_pad = 0;
+
+    memcpy(omf + 1, snap, snaplen);
+
+    err = mpool_mdc_append(mdc, omf, sz, true);
+
+    free(omf);
+
+    return err;
 }
 
 /*
@@ -290,6 +348,7 @@ cndb_omf_kvs_add_read(
 {
     cp->pfx_len = omf_kvs_add_pfxlen(omf);
     cp->kvs_ext01 = omf_kvs_add_flags(omf) & CN_CFLAG_CAPPED;
+    cp->merge_op = (omf_kvs_add_flags(omf) & CN_CFLAG_MERGE_OP_MASK) >> CN_CFLAG_MERGE_OP_SHIFT;
 
     *cnid = omf_kvs_add_cnid(omf);
     omf_kvs_add_name(omf, namebuf, namebufsz);
@@ -428,3 +487,17 @@ cndb_omf_nak_read(struct cndb_nak_omf *omf, uint64_t *txid)
 {
     *txid = omf_nak_txid(omf);
 }
+
+void
+cndb_omf_kvset_snap_read(
+    struct cndb_kvset_snap_omf *omf,
+    uint64_t *cnid,
+    uint64_t *kvsetid,
+    uint32_t *snaplen,
+    const void **snap)
+{
+    *cnid = omf_kvset_snap_cnid(omf);
+    *kvsetid = omf_kvset_snap_kvsetid(omf);
+    *snaplen = omf_kvset_snap_len(omf);
+    *snap = omf + 1;
+}
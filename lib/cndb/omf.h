@@ -37,6 +37,7 @@ struct kvs_cparams;
  * CNDB_TYPE_KVSET_DEL: Delete a kvset.
  * CNDB_TYPE_ACK:       Acknowledge a CNDB_TYPE_KVSET_ADD or a CNDB_TYPE_KVSET_DEL record.
  * CNDB_TYPE_NAK:       Abort transaction.
+ * CNDB_TYPE_KVSET_SNAP: Kblock descriptor snapshot of a kvset (optional).
  */
 enum cndb_rec_type {
     CNDB_TYPE_VERSION = 1,
@@ -49,8 +50,9 @@ enum cndb_rec_type {
     CNDB_TYPE_KVSET_MOVE = 8,
     CNDB_TYPE_ACK = 9,
     CNDB_TYPE_NAK = 10,
+    CNDB_TYPE_KVSET_SNAP = 11,
 
-    CNDB_TYPE_CNT = 10,
+    CNDB_TYPE_CNT = 11,
 };
 
 /**
@@ -294,6 +296,31 @@ struct cndb_nak_omf {
 
 OMF_SETGET(struct cndb_nak_omf, nak_txid, 64);
 
+/**
+ * struct cndb_kvset_snap_omf
+ *
+ * A KVSET_SNAP record follows the records that describe a kvset in a
+ * compacted log.  Its payload is opaque to the cndb: it is produced and
+ * consumed by the cN layer (see struct kvset_snap_omf) so that kvsets
+ * can be opened without reading their kblock headers.
+ *
+ * @kvset_snap_cnid:    KVS containing the kvset
+ * @kvset_snap_kvsetid: kvset ID
+ * @kvset_snap_len:     length of the snapshot that follows this struct
+ */
+struct cndb_kvset_snap_omf {
+    struct cndb_hdr_omf hdr;
+    uint64_t kvset_snap_cnid;
+    uint64_t kvset_snap_kvsetid;
+    uint32_t kvset_snap_len;
+    uint32_t kvset_snap_pad;
+    /* kvset_snap_len bytes of snapshot data appear here */
+} HSE_PACKED;
+
+OMF_SETGET(struct cndb_kvset_snap_omf, kvset_snap_cnid, 64);
+OMF_SETGET(struct cndb_kvset_snap_omf, kvset_snap_kvsetid, 64);
+OMF_SETGET(struct cndb_kvset_snap_omf, kvset_snap_len, 32);
+
 /*
  * OMF Write functions
  */
@@ -322,7 +349,8 @@ cndb_omf_txstart_write(
     uint64_t ingestid,
     uint64_t txhorizon,
     uint16_t add_cnt,
-    uint16_t del_cnt);
+    uint16_t del_cnt,
+    uint64_t *gen);
 
 merr_t
 cndb_omf_kvset_add_write(
@@ -344,7 +372,12 @@ cndb_omf_kvset_add_write(
     uint64_t *vblkv);
 
 merr_t
-cndb_omf_kvset_del_write(struct mpool_mdc *mdc, uint64_t txid, uint64_t cnid, uint64_t kvsetid);
+cndb_omf_kvset_del_write(
+    struct mpool_mdc *mdc,
+    uint64_t txid,
+    uint64_t cnid,
+    uint64_t kvsetid,
+    uint64_t *gen);
 
 merr_t
 cndb_omf_kvset_move_write(
@@ -353,7 +386,8 @@ cndb_omf_kvset_move_write(
     uint64_t src_nodeid,
     uint64_t tgt_nodeid,
     uint32_t kvset_idc,
-    const uint64_t *kvset_idv);
+    const uint64_t *kvset_idv,
+    uint64_t *gen);
 
 merr_t
 cndb_omf_ack_write(
@@ -361,10 +395,19 @@ cndb_omf_ack_write(
     uint64_t txid,
     uint64_t cnid,
     unsigned int type,
-    uint64_t kvsetid);
+    uint64_t kvsetid,
+    uint64_t *gen);
 
 merr_t
-cndb_omf_nak_write(struct mpool_mdc *mdc, uint64_t txid);
+cndb_omf_nak_write(struct mpool_mdc *mdc, uint64_t txid, uint64_t *gen);
+
+merr_t
+cndb_omf_kvset_snap_write(
+    struct mpool_mdc *mdc,
+    uint64_t cnid,
+    uint64_t kvsetid,
+    const void *snap,
+    uint32_t snaplen);
 
 /*
  * OMF Read functions
@@ -442,4 +485,12 @@ cndb_omf_ack_read(
 void
 cndb_omf_nak_read(struct cndb_nak_omf *omf, uint64_t *txid);
 
+void
+cndb_omf_kvset_snap_read(
+    struct cndb_kvset_snap_omf *omf,
+    uint64_t *cnid,
+    uint64_t *kvsetid,
+    uint32_t *snaplen,
+    const void **snap);
+
 #endif /* HSE_KVS_CNDB_OMF_H */
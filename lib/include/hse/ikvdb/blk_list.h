@@ -18,6 +18,7 @@ struct kvset_mblocks {
     uint64_t hblk_id;
     struct blk_list kblks;
     struct blk_list vblks;
+    uint32_t bl_vadopted; /* leading vblks adopted from k-compact inputs */
     uint64_t bl_vtotal;
     uint64_t bl_vused;
     uint64_t bl_seqno_max;
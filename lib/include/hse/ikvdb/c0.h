@@ -21,6 +21,7 @@
 
 struct c0;
 struct c0_cursor;
+struct rtomb_vec;
 struct cn;
 
 struct query_ctx;
@@ -101,6 +102,16 @@ c0_get_pfx_len(struct c0 *c0);
 merr_t
 c0_put(struct c0 *self, struct kvs_ktuple *key, const struct kvs_vtuple *value, uintptr_t seqnoref);
 
+/**
+ * c0_merge() - insert a merge operand into the struct c0
+ * @self:      Instance of struct c0 into which to insert
+ * @key:       Key for insertion
+ * @value:     Merge operand for insertion
+ * @seqnoref:  seqnoref for insertion
+ */
+merr_t
+c0_merge(struct c0 *self, struct kvs_ktuple *key, const struct kvs_vtuple *value, uintptr_t seqnoref);
+
 /**
  * c0_get() - retrieve the value associated with the given key,
  *            no newer than seqno
@@ -122,6 +133,49 @@ c0_get(
     enum key_lookup_res *res,
     struct kvs_buf *vbuf);
 
+/**
+ * c0_get_merged() - resolve the merge operands of the given key,
+ *                   no newer than seqno
+ * @self:      Instance of struct c0 from which to retrieve
+ * @key:       Key to retrieve
+ * @seqno:     Seqno to use for get
+ * @res:       Status of lookup
+ * @vbuf:      Ptr to callers buffer
+ *
+ * Called when c0_get() returns FOUND_MOPND.  See c0sk_get_merged().
+ */
+merr_t
+c0_get_merged(
+    struct c0 *self,
+    struct kvs_ktuple *key,
+    uint64_t view_seqno,
+    enum key_lookup_res *res,
+    struct kvs_buf *vbuf);
+
+/**
+ * c0_get_merged_onto() - resolve the merge operands of the given key
+ *                        onto a base value from below c0
+ * @self:      Instance of struct c0 from which to retrieve
+ * @key:       Key to retrieve
+ * @seqno:     Seqno to use for get
+ * @base:      Newest value of the key below c0 (may alias @vbuf)
+ * @base_len:  Length of @base, zero if there is none
+ * @res:       Status of lookup
+ * @vbuf:      Ptr to callers buffer
+ *
+ * See c0sk_get_merged_onto().
+ */
+/* MTF_MOCK */
+merr_t
+c0_get_merged_onto(
+    struct c0 *self,
+    struct kvs_ktuple *key,
+    uint64_t view_seqno,
+    const void *base,
+    uint32_t base_len,
+    enum key_lookup_res *res,
+    struct kvs_buf *vbuf);
+
 /**
  * c0_del() - delete any value associated with the given key
  * @self:      Instance of struct c0 from which to delete
@@ -157,6 +211,21 @@ c0_pfx_probe(
 merr_t
 c0_prefix_del(struct c0 *self, struct kvs_ktuple *key, uintptr_t seqnoref);
 
+/**
+ * c0_range_del() - delete all keys in the range [start, end)
+ * @self:     Instance of struct c0 from which to delete
+ * @start:    first key of the range, its kt_seqno is set to the tombstone's seqno
+ * @end:      end of the range (exclusive)
+ * @seqnoref: seqnoref for range delete
+ */
+/* MTF_MOCK */
+merr_t
+c0_range_del(
+    struct c0 *self,
+    struct kvs_ktuple *start,
+    const struct kvs_ktuple *end,
+    uintptr_t seqnoref);
+
 /**
  * c0_sync() - force ingest of existing c0 data and waits until ingest complete
  * @self:      Instance of struct c0 to flush
@@ -221,6 +290,15 @@ c0_cursor_read(struct c0_cursor *c0cur, struct kvs_cursor_element *elem, bool *e
 merr_t
 c0_cursor_update(struct c0_cursor *cur, uint64_t seqno, uint32_t *flags_out);
 
+/**
+ * c0_cursor_rtombs() - collect the range tombstones visible to a c0 cursor
+ * @c0cur:      Instance of struct c0_cursor
+ * @rv:         (out) sorted vector of rtombs, valid until the next update
+ */
+/* MTF_MOCK */
+merr_t
+c0_cursor_rtombs(struct c0_cursor *c0cur, struct rtomb_vec *rv);
+
 /**
  * c0_cursor_destroy() - destroy existing iterators over c0
  * @c0cur:     Instance of struct c0_cursor
@@ -11,9 +11,12 @@
 
 #include <hse/error/merr.h>
 #include <hse/ikvdb/kvs.h>
+#include <hse/ikvdb/merge_op.h>
 
 struct c0_kvset {};
 
+struct rtomb_vec;
+
 struct c0kvs_ingest_ctx;
 struct c0_kvset_iterator;
 
@@ -143,6 +146,28 @@ c0kvs_put(
     const struct kvs_vtuple *value,
     uintptr_t seqnoref);
 
+/**
+ * c0kvs_merge() - insert a merge operand into the struct c0_kvset
+ * @set:      Struct c0_kvset to insert the operand into
+ * @key:      Key
+ * @value:    Merge operand (see kvs_vtuple_minit())
+ * @seqnoref: HSE_SQNREF_SINGLE or an ordinal seqnoref (wal replay)
+ * @op:       Merge operator of the kvs
+ *
+ * If the key already has a value with the same seqno then the operand
+ * is folded into that value (in which case the result is a full value
+ * unless the existing value is itself an operand), otherwise the operand
+ * is inserted as is.
+ */
+merr_t
+c0kvs_merge(
+    struct c0_kvset *set,
+    uint16_t skidx,
+    struct kvs_ktuple *key,
+    const struct kvs_vtuple *value,
+    uintptr_t seqnoref,
+    enum merge_op op);
+
 /**
  * c0kvs_del() - delete the key/value pair matching the given key
  * @set:   Struct c0_kvset to delete the key/value from
@@ -177,6 +202,55 @@ c0kvs_prefix_del(
     struct kvs_ktuple *key,
     const uintptr_t seqno);
 
+/**
+ * c0kvs_range_del() - insert a range tombstone
+ * @set:   Struct c0_kvset to insert the range tombstone into
+ * @skidx: kvs index
+ * @start:    first key of the range (inclusive), kt_seqno is set on return
+ * @end:      end of the range (exclusive)
+ * @seqnoref: HSE_SQNREF_SINGLE, or the ordinal seqno of a replayed range delete
+ *
+ * Range tombstones are kept on a list separate from the bonsai tree and
+ * are only ever inserted into the ptomb c0kvset of a kvms.  Like ptombs,
+ * each range tombstone is assigned a new seqno so that mutations made
+ * after the range delete can be distinguished from those it deletes.
+ */
+merr_t
+c0kvs_range_del(
+    struct c0_kvset *set,
+    uint16_t skidx,
+    struct kvs_ktuple *start,
+    const struct kvs_ktuple *end,
+    uintptr_t seqnoref);
+
+/**
+ * c0kvs_rtomb_lookup() - find the newest range tombstone covering a key
+ * @set:      Struct c0_kvset to search
+ * @skidx:    kvs index
+ * @kt:       Key
+ * @view_seq: Ignore range tombstones newer than view_seq
+ *
+ * Return: seqno of the covering range tombstone, or zero if there is none
+ */
+uint64_t
+c0kvs_rtomb_lookup(
+    struct c0_kvset *set,
+    uint16_t skidx,
+    const struct kvs_ktuple *kt,
+    uint64_t view_seq);
+
+/**
+ * c0kvs_rtombs_get() - append all of a kvs' range tombstones to a vector
+ * @set:   Struct c0_kvset to search
+ * @skidx: kvs index
+ * @rv:    (in/out) vector of range tombstones
+ *
+ * The appended rtombs reference memory owned by @set, which must remain
+ * live for as long as @rv is in use.
+ */
+merr_t
+c0kvs_rtombs_get(struct c0_kvset *set, uint16_t skidx, struct rtomb_vec *rv);
+
 /**
  * c0kvs_get_rcu() - given a key, retrieve a value from a struct c0_kvset
  * @handle:     Struct c0_kvset to search
@@ -19,6 +19,7 @@
 struct c0_kvmultiset;
 struct c0sk;
 struct c0_cursor;
+struct rtomb_vec;
 struct cn;
 struct mpool;
 struct kvdb_rparams;
@@ -159,6 +160,22 @@ c0sk_put(
     const struct kvs_vtuple *value,
     uintptr_t seqnoref);
 
+/**
+ * c0sk_merge() - insert a merge operand into the struct c0sk
+ * @self:      Instance of struct c0sk into which to insert
+ * @skidx:     Structured key index
+ * @key:       Key for insertion
+ * @value:     Merge operand for insertion
+ * @seqnoref:  seqnoref for insertion (must not be a txn seqnoref)
+ */
+merr_t
+c0sk_merge(
+    struct c0sk *self,
+    uint16_t skidx,
+    struct kvs_ktuple *key,
+    const struct kvs_vtuple *value,
+    uintptr_t seqnoref);
+
 /**
  * c0sk_get() - retrieve the value associated with the given key
  * @self:      Instance of struct c0sk from which to retrieve
@@ -184,6 +201,60 @@ c0sk_get(
     enum key_lookup_res *res,
     struct kvs_buf *vbuf);
 
+/**
+ * c0sk_get_merged() - retrieve the value of a key that has merge operands
+ * @self:      Instance of struct c0sk from which to retrieve
+ * @skidx:     Structured key index
+ * @pfx_len:   Prefix length to use for this get
+ * @key:       Key to retrieve (hashed)
+ * @view_seq:  View sequence number
+ * @res:       Status of lookup
+ * @vbuf:      Ptr to callers buffer
+ *
+ * Searches c0, lc and cn for the newest non-operand value visible at
+ * @view_seq and applies the kvs' merge operator to it and all newer
+ * operands.  If any operand is found then the result is always FOUND_VAL.
+ */
+merr_t
+c0sk_get_merged(
+    struct c0sk *self,
+    uint16_t skidx,
+    uint32_t pfx_len,
+    struct kvs_ktuple *key,
+    uint64_t view_seq,
+    enum key_lookup_res *res,
+    struct kvs_buf *vbuf);
+
+/**
+ * c0sk_get_merged_onto() - apply the merge operands of a key in c0 to a
+ *                          given base value
+ * @self:      Instance of struct c0sk from which to retrieve
+ * @skidx:     Structured key index
+ * @pfx_len:   Prefix length to use for this get
+ * @key:       Key to retrieve (hashed)
+ * @view_seq:  View sequence number
+ * @base:      Newest value of the key below c0 (may alias @vbuf)
+ * @base_len:  Length of @base, zero if the key has no value below c0
+ * @res:       Status of lookup
+ * @vbuf:      Ptr to callers buffer
+ *
+ * Like c0sk_get_merged(), except that lc and cn are not searched.  If
+ * the operands in c0 reach below c0 they are applied to @base instead.
+ * Used by cursors, which already have the base value from their lc and
+ * cn sources.
+ */
+merr_t
+c0sk_get_merged_onto(
+    struct c0sk *self,
+    uint16_t skidx,
+    uint32_t pfx_len,
+    struct kvs_ktuple *key,
+    uint64_t view_seq,
+    const void *base,
+    uint32_t base_len,
+    enum key_lookup_res *res,
+    struct kvs_buf *vbuf);
+
 /**
  * c0sk_del() - delete any value associated with the given key
  * @self:       Instance of struct c0sk from which to delete
@@ -224,6 +295,24 @@ c0sk_pfx_probe(
 merr_t
 c0sk_prefix_del(struct c0sk *self, uint16_t skidx, struct kvs_ktuple *key, uintptr_t seqnoref);
 
+/**
+ * c0sk_range_del() - delete all keys in the range [start, end)
+ * @self:     Instance of struct c0sk from which to delete
+ * @skidx:    Structured key index
+ * @start:    First key of the range, kt_seqno and kt_dgen are set on return
+ * @end:      End of the range (exclusive)
+ * @seqnoref: HSE_SQNREF_SINGLE, or the ordinal seqno of a replayed range delete
+ *
+ * Range deletes are never part of a transaction.
+ */
+merr_t
+c0sk_range_del(
+    struct c0sk *self,
+    uint16_t skidx,
+    struct kvs_ktuple *start,
+    const struct kvs_ktuple *end,
+    uintptr_t seqnoref);
+
 /**
  * c0sk_rparams() - Get a ptr to c0sk kvdb rparams
  * @self:       Instance of struct c0sk
@@ -296,6 +385,14 @@ c0sk_cursor_read(struct c0_cursor *cur, struct kvs_cursor_element *elem, bool *e
 merr_t
 c0sk_cursor_update(struct c0_cursor *cur, uint64_t seqno, uint32_t *flags_out);
 
+/**
+ * c0sk_cursor_rtombs() - collect the range tombstones visible to a cursor
+ * @c0cur: The existing cursor.
+ * @rv:    (out) sorted vector of rtombs, valid until the next cursor update
+ */
+merr_t
+c0sk_cursor_rtombs(struct c0_cursor *cur, struct rtomb_vec *rv);
+
 /**
  * c0sk_cursor_destroy() - destroy existing iterators over c0
  * @c0cur:      The existing cursor.
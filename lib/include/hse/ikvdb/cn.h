@@ -20,6 +20,12 @@
 
 #define CN_CFLAG_CAPPED (1 << 0)
 
+/* The kvs merge operator (enum merge_op) is persisted in the cndb kvs_add
+ * record flags at this offset.  Older records have zero, i.e., MERGE_OP_NONE.
+ */
+#define CN_CFLAG_MERGE_OP_SHIFT (8)
+#define CN_CFLAG_MERGE_OP_MASK  (0xffu << CN_CFLAG_MERGE_OP_SHIFT)
+
 struct cn;
 struct cn_kvdb;
 struct cndb;
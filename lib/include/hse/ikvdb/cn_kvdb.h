@@ -10,6 +10,8 @@
 #include <hse/util/atomic.h>
 #include <hse/util/workqueue.h>
 
+struct hpcache;
+
 /* MTF_MOCK_DECL(cn_kvdb) */
 
 /**
@@ -18,11 +20,18 @@
 struct cn_kvdb {
     struct workqueue_struct *cn_maint_wq;
     struct workqueue_struct *cn_io_wq;
+    struct workqueue_struct *cn_open_wq;
+    struct hpcache          *cn_hpcache;
 };
 
 /* MTF_MOCK */
 merr_t
-cn_kvdb_create(uint cn_maint_threads, uint cn_io_threads, struct cn_kvdb **h);
+cn_kvdb_create(
+    uint cn_maint_threads,
+    uint cn_io_threads,
+    uint cn_open_threads,
+    size_t hpcache_sz,
+    struct cn_kvdb **h);
 
 /* MTF_MOCK */
 void
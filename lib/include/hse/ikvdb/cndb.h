@@ -160,6 +160,27 @@ cndb_cn_instantiate(struct cndb *cndb, uint64_t cnid, void *ctx, cn_init_callbac
 merr_t
 cndb_kvset_delete(struct cndb *cndb, uint64_t cnid, uint64_t kvsetid);
 
+/**
+ * cndb_kvset_snap_set() - attach an open-time snapshot to a kvset
+ * @cndb:    cndb handle
+ * @cnid:    KVS containing the kvset
+ * @kvsetid: kvset ID
+ * @data:    opaque snapshot, copied by the cndb
+ * @len:     length of @data
+ *
+ * The snapshot is written to the log by the next cndb compaction (or by
+ * cndb_close()), and is handed back to cN via kvset_meta.km_snap when the
+ * KVS is next opened.  It is discarded when the kvset is deleted.
+ */
+/* MTF_MOCK */
+merr_t
+cndb_kvset_snap_set(
+    struct cndb *cndb,
+    uint64_t cnid,
+    uint64_t kvsetid,
+    const void *data,
+    uint32_t len);
+
 /* MTF_MOCK */
 struct kvs_cparams *
 cndb_kvs_cparams(struct cndb *cndb, uint64_t cnid);
@@ -67,6 +67,9 @@ enum cn_rule {
     CN_RULE_LSPLIT,         /* left node kvset after a split */
     CN_RULE_RSPLIT,         /* right ndoe kvset after a split */
     CN_RULE_JOIN,           /* prev node is very small */
+    CN_RULE_HOT,            /* hot leaf kvset, migrate to staging */
+    CN_RULE_COLD,           /* cold leaf kvset, migrate to capacity */
+    CN_RULE_VGC,            /* leaf vblock garbage, k-compact relocating sparse values */
     CN_RULE_MAX,
 };
 
@@ -122,6 +125,12 @@ cn_rule2str(enum cn_rule rule)
         return "right";
     case CN_RULE_JOIN:
         return "join";
+    case CN_RULE_HOT:
+        return "hot";
+    case CN_RULE_COLD:
+        return "cold";
+    case CN_RULE_VGC:
+        return "vgc";
     case CN_RULE_MAX:
         return "max";
     }
@@ -90,6 +90,7 @@ struct kvs_cursor_element {
     uintptr_t kce_seqnoref;
     uint kce_complen;
     bool kce_is_ptomb;
+    bool kce_is_mopnd;
 };
 
 static inline int
@@ -24,6 +24,7 @@ struct hse_gparams {
     uint64_t gp_vlb_cache_sz;
     uint32_t gp_workqueue_tcdelay;
     uint32_t gp_workqueue_idle_ttl;
+    uint32_t gp_rtrace_ppm;
     uint8_t gp_perfc_level;
 
     struct {
@@ -29,6 +29,7 @@ struct kvdb_cparams;
 struct kvs_rparams;
 struct kvs_cparams;
 struct hse_kvdb_opspec;
+struct hse_kvdb_snapshot;
 struct hse_kvs_cursor;
 struct mpool;
 struct c0sk;
@@ -406,6 +407,19 @@ ikvdb_kvs_put(
     struct kvs_ktuple *kt,
     struct kvs_vtuple *vt);
 
+/**
+ * ikvdb_kvs_merge() - apply a merge operand to the value of the given key
+ * using the KVS' merge operator.  Outside of a transaction the operand is
+ * stored as is and resolved lazily on read and at ingest.
+ */
+merr_t
+ikvdb_kvs_merge(
+    struct hse_kvs *kvs,
+    unsigned int flags,
+    struct hse_kvdb_txn *txn,
+    struct kvs_ktuple *kt,
+    struct kvs_vtuple *vt);
+
 /**
  * ikvdb_kvs_get() - search for the given key within the KVS. HSE allocates
  * memory for the result if vbuf->b_buf is NULL.
@@ -419,6 +433,18 @@ ikvdb_kvs_get(
     enum key_lookup_res *res,
     struct kvs_buf *vbuf);
 
+/**
+ * ikvdb_kvs_snapshot_get() - search for the given key as of a snapshot
+ */
+merr_t
+ikvdb_kvs_snapshot_get(
+    struct hse_kvs *kvs,
+    unsigned int flags,
+    struct hse_kvdb_snapshot *snap,
+    struct kvs_ktuple *kt,
+    enum key_lookup_res *res,
+    struct kvs_buf *vbuf);
+
 /**
  * ikvdb_kvs_del() - remove the supplied key and associated value from the KVS
  * indexed by opspec->kop_index.
@@ -455,6 +481,19 @@ ikvdb_kvs_prefix_delete(
     struct hse_kvdb_txn *txn,
     struct kvs_ktuple *kt);
 
+/**
+ * ikvdb_kvs_range_delete() - remove all key/value pairs in [start, end)
+ *
+ * Range deletes are not supported within a transaction.
+ */
+/* MTF_MOCK */
+merr_t
+ikvdb_kvs_range_delete(
+    struct hse_kvs *kvs,
+    unsigned int flags,
+    struct kvs_ktuple *start,
+    struct kvs_ktuple *end);
+
 merr_t
 ikvdb_kvs_param_get(
     struct hse_kvs *kvs,
@@ -484,6 +523,20 @@ ikvdb_horizon(struct ikvdb *store);
 uint64_t
 ikvdb_txn_horizon(struct ikvdb *store);
 
+/**
+ * ikvdb_snapshot_create() - pin a read view of all KVSes in the kvdb
+ *
+ * The snapshot's view holds back the kvdb horizon until it is released.
+ */
+merr_t
+ikvdb_snapshot_create(struct ikvdb *kvdb, struct hse_kvdb_snapshot **snap);
+
+/**
+ * ikvdb_snapshot_release() - release a snapshot created by ikvdb_snapshot_create()
+ */
+void
+ikvdb_snapshot_release(struct ikvdb *kvdb, struct hse_kvdb_snapshot *snap);
+
 /**
  * ikvdb_txn_alloc() - allocate space for a transaction
  */
@@ -536,6 +589,19 @@ ikvdb_kvs_cursor_create(
     size_t pfx_len,
     struct hse_kvs_cursor **cursor);
 
+/**
+ * ikvdb_kvs_snapshot_cursor_create() - create a cursor whose view is that of
+ * the given snapshot. Updating the cursor moves it to the current view.
+ */
+merr_t
+ikvdb_kvs_snapshot_cursor_create(
+    struct hse_kvs *kvs,
+    unsigned int flags,
+    struct hse_kvdb_snapshot *snap,
+    const void *prefix,
+    size_t pfx_len,
+    struct hse_kvs_cursor **cursor);
+
 /**
  * ikvdb_kvs_cursor_update() - incorporate updates since cursor created
  */
@@ -656,6 +722,15 @@ ikvdb_wal_replay_put(
     struct kvs_ktuple *kt,
     struct kvs_vtuple *vt);
 
+merr_t
+ikvdb_wal_replay_merge(
+    struct ikvdb *ikvdb,
+    struct ikvdb_kvs_hdl *ikvsh,
+    uint64_t cnid,
+    uint64_t seqno,
+    struct kvs_ktuple *kt,
+    struct kvs_vtuple *vt);
+
 merr_t
 ikvdb_wal_replay_del(
     struct ikvdb *ikvdb,
@@ -672,6 +747,15 @@ ikvdb_wal_replay_prefix_del(
     uint64_t seqno,
     struct kvs_ktuple *kt);
 
+merr_t
+ikvdb_wal_replay_range_del(
+    struct ikvdb *ikvdb,
+    struct ikvdb_kvs_hdl *ikvsh,
+    uint64_t cnid,
+    uint64_t seqno,
+    struct kvs_ktuple *kt,
+    struct kvs_vtuple *vt);
+
 merr_t
 ikvdb_wal_replay_sync(struct ikvdb *handle, const unsigned int flags);
 
@@ -63,12 +63,17 @@ struct kvdb_rparams {
     uint8_t csched_hi_th_pct;
     uint8_t csched_leaf_pct;
     uint8_t csched_gc_pct;
+    uint8_t csched_vgc_pct;
     uint16_t csched_lscat_hwm;
     uint8_t csched_lscat_runlen_max;
     uint64_t csched_rspill_params;
     uint64_t csched_leaf_comp_params;
     uint64_t csched_leaf_len_params;
     uint64_t csched_node_min_ttl;
+    uint64_t csched_heat_staging_max;
+    uint64_t csched_heat_hot;
+    uint64_t csched_io_rd_mbps;
+    uint64_t csched_io_wr_mbps;
     bool csched_full_compact;
 
     uint32_t dur_bufsz_mb;
@@ -96,6 +101,9 @@ struct kvdb_rparams {
     uint32_t c0_ingest_threads;
     uint16_t cn_maint_threads;
     uint16_t cn_io_threads;
+    uint16_t cn_open_threads;
+    uint32_t cn_hpcache_mb;
+    uint32_t lc_mem_max_mb;
     double cndb_compact_hwm_pct;
 
     uint32_t keylock_tables;
@@ -9,6 +9,7 @@
 #include <hse/error/merr.h>
 #include <hse/ikvdb/kvdb_health.h>
 #include <hse/ikvdb/kvs_rparams.h>
+#include <hse/ikvdb/merge_op.h>
 #include <hse/ikvdb/query_ctx.h>
 #include <hse/ikvdb/tuple.h>
 #include <hse/util/arch.h>
@@ -22,6 +23,7 @@
 
 /*- Internal Key Value Store  -----------------------------------------------*/
 
+struct hse_kvdb_snapshot;
 struct hse_kvdb_txn;
 struct kvdb_ctxn;
 struct kvdb_kvs;
@@ -45,6 +47,7 @@ struct hse_kvs_cursor {
     struct perfc_set *kc_pkvsl_pc;
     struct kvdb_kvs *kc_kvs;
     struct kvdb_ctxn_bind *kc_bind;
+    struct hse_kvdb_snapshot *kc_snap;
     uint64_t kc_gen;
     uint64_t kc_seq;
     uint64_t kc_create_time;
@@ -59,6 +62,7 @@ struct ikvs {
     uint64_t ikv_gen HSE_ACP_ALIGNED;
     uint64_t ikv_cnid;
     uint ikv_pfx_len;
+    enum merge_op ikv_merge_op;
     struct c0 *ikv_c0;
     struct cn *ikv_cn;
     struct lc *ikv_lc;
@@ -66,6 +70,7 @@ struct ikvs {
     struct perfc_set ikv_pkvsl_pc; /* Public kvs interfaces Lat. */
     struct perfc_set ikv_cc_pc;
     struct perfc_set ikv_cd_pc;
+    struct perfc_set ikv_wait_pc; /* Wait accounting, see kvs_wait.h */
 
     struct kvs_rparams ikv_rp;
 
@@ -181,6 +186,14 @@ kvs_get(
     enum key_lookup_res *res,
     struct kvs_buf *vbuf);
 
+merr_t
+kvs_merge(
+    struct ikvs *ikvs,
+    struct hse_kvdb_txn *txn,
+    struct kvs_ktuple *kt,
+    struct kvs_vtuple *vt,
+    uint64_t seqno);
+
 merr_t
 kvs_del(struct ikvs *ikvs, struct hse_kvdb_txn *txn, struct kvs_ktuple *key, uint64_t seqno);
 
@@ -197,6 +210,13 @@ kvs_pfx_probe(
 merr_t
 kvs_prefix_del(struct ikvs *ikvs, struct hse_kvdb_txn *txn, struct kvs_ktuple *key, uint64_t seqno);
 
+merr_t
+kvs_range_del(
+    struct ikvs *ikvs,
+    struct kvs_ktuple *start,
+    struct kvs_ktuple *end,
+    uintptr_t seqnoref);
+
 void
 kvs_maint_task(struct ikvs *ikvs, uint64_t now);
 
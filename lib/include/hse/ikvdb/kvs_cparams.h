@@ -12,11 +12,13 @@
 #include <cjson/cJSON.h>
 
 #include <hse/error/merr.h>
+#include <hse/ikvdb/merge_op.h>
 #include <hse/util/compiler.h>
 
 struct kvs_cparams {
     uint32_t pfx_len;
     uint32_t kvs_ext01;
+    enum merge_op merge_op;
 };
 
 const struct param_spec *
@@ -34,6 +34,7 @@
 struct kvs_rparams {
     uint64_t kvs_cursor_ttl;
 
+    bool kvs_cursor_zcopy;
     bool transactions_enable;
     bool cn_maint_disable;
     bool cn_close_wait;
@@ -67,6 +68,7 @@ struct kvs_rparams {
     uint64_t cn_bloom_capped;
 
     uint64_t cn_kcachesz;
+    bool cn_open_snapshot;
 
     uint64_t capped_evict_ttl;
 
@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#ifndef HSE_IKVDB_KVS_WAIT_H
+#define HSE_IKVDB_KVS_WAIT_H
+
+#include <stdint.h>
+
+#include <hse/kvdb_perfc.h>
+
+#include <hse/util/compiler.h>
+#include <hse/util/perfc.h>
+
+/* Per-KVS wait accounting.
+ *
+ * The places where a mutation may block (throttle sleep, c0 full and
+ * WAL buffer allocation) are buried in layers that know nothing of the
+ * KVS on whose behalf they run.  Instead, the KVDB entry points publish
+ * the KVS's "KVSWAIT" counter set in kvs_wait_pc_tls for the duration
+ * of the call, and the blocking sites record into whichever set is
+ * current (if any).  Txn keylock acquisition never blocks, so keylock
+ * collisions are counted rather than timed.
+ */
+extern thread_local struct perfc_set *kvs_wait_pc_tls;
+
+/**
+ * kvs_wait_enter() - attribute waits on this thread to the given counter set
+ * @pcs:  KVSWAIT counter set of the KVS
+ */
+static HSE_ALWAYS_INLINE void
+kvs_wait_enter(struct perfc_set *pcs)
+{
+    kvs_wait_pc_tls = pcs;
+}
+
+/**
+ * kvs_wait_leave() - stop attributing waits on this thread
+ */
+static HSE_ALWAYS_INLINE void
+kvs_wait_leave(void)
+{
+    kvs_wait_pc_tls = NULL;
+}
+
+/**
+ * kvs_wait_start() - acquire a wait start time
+ *
+ * Return: 0 if no KVS wait counter set is current, otherwise the
+ * current time in cycles
+ */
+static HSE_ALWAYS_INLINE uint64_t
+kvs_wait_start(void)
+{
+    return perfc_lat_start(kvs_wait_pc_tls);
+}
+
+/**
+ * kvs_wait_record() - record a wait
+ * @cidx:   PERFC_LT_KVSWAIT_* counter index
+ * @start:  start time obtained from kvs_wait_start()
+ */
+static HSE_ALWAYS_INLINE void
+kvs_wait_record(enum kvdb_perfc_sidx_kvswait cidx, uint64_t start)
+{
+    perfc_lat_record(kvs_wait_pc_tls, cidx, start);
+}
+
+/**
+ * kvs_wait_inc() - count a wait-related event
+ * @cidx:   PERFC_RA_KVSWAIT_* counter index
+ */
+static HSE_ALWAYS_INLINE void
+kvs_wait_inc(enum kvdb_perfc_sidx_kvswait cidx)
+{
+    perfc_inc(kvs_wait_pc_tls, cidx);
+}
+
+#endif
@@ -19,6 +19,8 @@ struct kvset_builder;
 struct kvs_rparams;
 struct perfc_set;
 struct cn_merge_stats;
+struct rtomb;
+struct tbkt;
 struct vgmap;
 
 struct key_stats {
@@ -98,6 +100,30 @@ kvset_builder_add_vref(
 merr_t
 kvset_builder_add_nonval(struct kvset_builder *self, uint64_t seq, enum kmd_vtype vtype);
 
+/**
+ * kvset_builder_add_rtomb() - add a range tombstone to the kvset
+ * @self: kvset builder object
+ * @rt:   range tombstone
+ *
+ * Range tombstones are independent of the key entries and may be added
+ * at any time, in any order, before the builder is finished.
+ */
+/* MTF_MOCK */
+merr_t
+kvset_builder_add_rtomb(struct kvset_builder *self, const struct rtomb *rt);
+
+/**
+ * kvset_builder_adopt_vblocks() - take over vblocks from the source kvsets
+ * @self:        kvset builder object
+ * @num_vblocks: number of vblocks in @vblock_ids
+ * @vblock_ids:  vblock ids, ownership of the vector passes to @self
+ * @vtotal:      sum of the written lengths of the vblocks
+ * @vgmap:       vgroup map for the vblocks, ownership passes to @self
+ *
+ * Adopted vblocks are never deleted by the builder.  Values subsequently
+ * added with kvset_builder_add_val() are written to new vblocks which
+ * follow the adopted vblocks and form one additional vgroup.
+ */
 /* MTF_MOCK */
 void
 kvset_builder_adopt_vblocks(
@@ -123,6 +149,16 @@ kvset_builder_set_agegroup(struct kvset_builder *self, enum hse_mclass_policy_ag
 void
 kvset_builder_set_merge_stats(struct kvset_builder *self, struct cn_merge_stats *stats);
 
+/**
+ * kvset_builder_set_tbkt() - charge the builder's kblock and vblock writes
+ *                            to a token bucket
+ * @self: kvset builder
+ * @tb:   token bucket (bytes), or NULL for unrestricted writes
+ */
+/* MTF_MOCK */
+void
+kvset_builder_set_tbkt(struct kvset_builder *self, struct tbkt *tb);
+
 #if HSE_MOCKING
 #include "kvset_builder_ut.h"
 #endif /* HSE_MOCKING */
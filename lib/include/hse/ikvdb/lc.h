@@ -6,6 +6,8 @@
 #ifndef HSE_CORE_LC_H
 #define HSE_CORE_LC_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include <lc/bonsai_iter.h>
@@ -33,9 +35,16 @@ struct kvs_cursor_element;
 struct kvdb_health;
 enum key_lookup_res;
 
+/**
+ * lc_create() - Create an LC object
+ *
+ * @handle:  (output) Handle to the LC object
+ * @mem_max: Bytes of keys and values beyond which LC is trimmed eagerly (0 = unbounded)
+ * @health:  KVDB health
+ */
 /* MTF_MOCK */
 merr_t
-lc_create(struct lc **handle, struct kvdb_health *health);
+lc_create(struct lc **handle, size_t mem_max, struct kvdb_health *health);
 
 /* MTF_MOCK */
 void
@@ -93,6 +102,24 @@ lc_pfx_probe(
 void
 lc_ingest_seqno_set(struct lc *handle, uint64_t seq);
 
+/**
+ * lc_mem_exceeded() - Check whether LC holds more than its memory bound
+ *
+ * @handle: Handle to the LC object
+ */
+/* MTF_MOCK */
+bool
+lc_mem_exceeded(struct lc *handle);
+
+/**
+ * lc_mem_used() - Get the bytes held by keys and values in LC
+ *
+ * @handle: Handle to the LC object
+ */
+/* MTF_MOCK */
+size_t
+lc_mem_used(struct lc *handle);
+
 /**
  * lc_ingest_seqno_get() - Get the min_seqno that may be ingested to cn
  *
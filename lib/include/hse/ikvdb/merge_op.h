@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#ifndef HSE_MERGE_OP_H
+#define HSE_MERGE_OP_H
+
+#include <stdint.h>
+
+#include <hse/error/merr.h>
+
+#define MERGE_OP_PARAM_NONE    "none"
+#define MERGE_OP_PARAM_ADD_U64 "add_u64"
+#define MERGE_OP_PARAM_APPEND  "append"
+
+/**
+ * enum merge_op - per-kvs merge operator applied to hse_kvs_merge() operands
+ * @MERGE_OP_NONE:    merges are rejected; stray operands behave like puts
+ * @MERGE_OP_ADD_U64: native endian 64-bit unsigned add (8-byte operands)
+ * @MERGE_OP_APPEND:  append the operand to the existing value
+ *
+ * For MERGE_OP_ADD_U64 a missing base value, a tombstone, or a base value
+ * whose length is not eight bytes is treated as zero.
+ */
+enum merge_op {
+    MERGE_OP_NONE,
+    MERGE_OP_ADD_U64,
+    MERGE_OP_APPEND,
+};
+
+#define MERGE_OP_MIN   MERGE_OP_NONE
+#define MERGE_OP_MAX   MERGE_OP_APPEND
+#define MERGE_OP_COUNT (MERGE_OP_MAX + 1)
+
+/**
+ * merge_op_validate() - check that an operand is acceptable to a merge operator
+ * @op:   merge operator
+ * @opnd: operand
+ * @len:  operand length
+ */
+merr_t
+merge_op_validate(enum merge_op op, const void *opnd, uint32_t len);
+
+/**
+ * merge_op_apply() - fold an operand into an accumulated value
+ * @op:      merge operator
+ * @acc:     (in/out) accumulated value, updated in place
+ * @acc_sz:  capacity of @acc in bytes
+ * @acc_len: (in/out) length of the accumulated value, zero if there is none
+ * @opnd:    operand to apply
+ * @len:     operand length
+ *
+ * Operands are associative, so merge_op_apply() may also be used to combine
+ * two operands into a single operand (with @acc holding the older operand).
+ * The result is silently truncated to @acc_sz bytes.
+ */
+void
+merge_op_apply(
+    enum merge_op op,
+    void *acc,
+    uint32_t acc_sz,
+    uint32_t *acc_len,
+    const void *opnd,
+    uint32_t len);
+
+/**
+ * merge_op_result_len() - return the worst-case length of a merge result
+ * @op:      merge operator
+ * @acc_len: length of the accumulated value
+ * @len:     operand length
+ */
+uint32_t
+merge_op_result_len(enum merge_op op, uint32_t acc_len, uint32_t len);
+
+#endif
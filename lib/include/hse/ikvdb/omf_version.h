@@ -11,13 +11,19 @@ enum {
     GLOBAL_OMF_VERSION2 = 2,
     GLOBAL_OMF_VERSION3 = 3,
     GLOBAL_OMF_VERSION4 = 4,
+    GLOBAL_OMF_VERSION5 = 5,
+    GLOBAL_OMF_VERSION6 = 6,
 };
 
 enum {
     CNDB_VERSION1 = 1,
+    CNDB_VERSION2 = 2,
 };
 
-enum { HBLOCK_HDR_VERSION1 = 1 };
+enum {
+    HBLOCK_HDR_VERSION1 = 1,
+    HBLOCK_HDR_VERSION2 = 2,
+};
 
 enum { VGROUP_MAP_VERSION1 = 1 };
 
@@ -33,6 +39,10 @@ enum {
     BLOOM_OMF_VERSION5 = 5,
 };
 
+enum {
+    KVSET_SNAP_VERSION1 = 1,
+};
+
 enum {
     WBT_TREE_VERSION6 = 6,
 };
@@ -62,18 +72,19 @@ enum {
     KVDB_META_VERSION2 = 2,
 };
 
-#define GLOBAL_OMF_VERSION GLOBAL_OMF_VERSION4
+#define GLOBAL_OMF_VERSION GLOBAL_OMF_VERSION6
 
 /* In the event one of the following versions in incremented, increment the
  * global OMF version.
  */
 
-#define CNDB_VERSION           CNDB_VERSION1
-#define HBLOCK_HDR_VERSION     HBLOCK_HDR_VERSION1
+#define CNDB_VERSION           CNDB_VERSION2
+#define HBLOCK_HDR_VERSION     HBLOCK_HDR_VERSION2
 #define VGROUP_MAP_VERSION     VGROUP_MAP_VERSION1
 #define KBLOCK_HDR_VERSION     KBLOCK_HDR_VERSION6
 #define VBLOCK_FOOTER_VERSION  VBLOCK_FOOTER_VERSION1
 #define BLOOM_OMF_VERSION      BLOOM_OMF_VERSION5
+#define KVSET_SNAP_VERSION     KVSET_SNAP_VERSION1
 #define WBT_TREE_VERSION       WBT_TREE_VERSION6
 #define CN_TSTATE_VERSION      CN_TSTATE_VERSION2
 #define MBLOCK_METAHDR_VERSION MBLOCK_METAHDR_VERSION2
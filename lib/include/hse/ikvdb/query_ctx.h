@@ -9,17 +9,20 @@
 #include <stdbool.h>
 
 #include <hse/error/merr.h>
+#include <hse/ikvdb/rtomb.h>
 
 /**
  * struct query_ctx - context for special queries (pfx probe)
  * @tomb_map: map for tombstones
  * @pos:      current position in the memory region backing tomb elems
  * @seen:     number of unique keys seen
+ * @rtombs:   range tombstones from the layers searched so far
  */
 struct query_ctx {
     int pos;
     int seen;
     struct map *tomb_map;
+    struct rtomb_vec rtombs;
 };
 
 merr_t
@@ -28,4 +31,27 @@ qctx_tomb_insert(struct query_ctx *qctx, const void *key, size_t klen);
 bool
 qctx_tomb_seen(struct query_ctx *qctx, const void *key, size_t klen);
 
+/**
+ * qctx_rtomb_hides() - check whether a range tombstone hides a key
+ * @qctx:     query context
+ * @key:      key
+ * @klen:     key length
+ * @view_seq: view seqno of the query
+ * @val_seq:  seqno of the key's newest visible value
+ *
+ * Layers are searched newest to oldest and each adds its rtombs to the
+ * query context before it is searched, so a key is checked against every
+ * rtomb that might hide it.
+ */
+static inline bool
+qctx_rtomb_hides(
+    const struct query_ctx *qctx,
+    const void *key,
+    size_t klen,
+    uint64_t view_seq,
+    uint64_t val_seq)
+{
+    return rtomb_vec_lookup(&qctx->rtombs, key, klen, view_seq) > val_seq;
+}
+
 #endif /* HSE_KVS_QCTX_H */
@@ -0,0 +1,124 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#ifndef HSE_IKVDB_RTOMB_H
+#define HSE_IKVDB_RTOMB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <hse/error/merr.h>
+#include <hse/util/keycmp.h>
+
+/**
+ * struct rtomb - range tombstone
+ * @rt_start: first key deleted by the tombstone (inclusive)
+ * @rt_end:   end of the deleted range (exclusive)
+ * @rt_seqno: tombstone seqno, hides all versions with a lower seqno
+ * @rt_slen:  length of @rt_start
+ * @rt_elen:  length of @rt_end
+ *
+ * An rtomb never owns the memory backing its keys, which belongs to
+ * either a c0 kvms or a kvset's hblock.
+ */
+struct rtomb {
+    const void *rt_start;
+    const void *rt_end;
+    uint64_t rt_seqno;
+    uint16_t rt_slen;
+    uint16_t rt_elen;
+};
+
+/**
+ * struct rtomb_vec - growable vector of range tombstones
+ * @rv_rtv:    vector of rtombs
+ * @rv_cnt:    number of rtombs in @rv_rtv
+ * @rv_max:    capacity of @rv_rtv
+ * @rv_sorted: true if @rv_rtv is sorted by start key
+ */
+struct rtomb_vec {
+    struct rtomb *rv_rtv;
+    uint32_t rv_cnt;
+    uint32_t rv_max;
+    bool rv_sorted;
+};
+
+static inline bool
+rtomb_covers(const struct rtomb *rt, const void *key, uint32_t klen)
+{
+    return keycmp(rt->rt_start, rt->rt_slen, key, klen) <= 0 &&
+           keycmp(key, klen, rt->rt_end, rt->rt_elen) < 0;
+}
+
+/**
+ * rtomb_overlaps() - check whether a range tombstone intersects [lo, hi]
+ * @rt: range tombstone
+ * @lo: inclusive lower bound, or NULL if unbounded
+ * @hi: inclusive upper bound, or NULL if unbounded
+ */
+static inline bool
+rtomb_overlaps(
+    const struct rtomb *rt,
+    const void *lo,
+    uint32_t lolen,
+    const void *hi,
+    uint32_t hilen)
+{
+    if (lo && keycmp(rt->rt_end, rt->rt_elen, lo, lolen) <= 0)
+        return false;
+
+    return !hi || keycmp(rt->rt_start, rt->rt_slen, hi, hilen) <= 0;
+}
+
+/**
+ * rtomb_lookup() - find the newest visible range tombstone covering a key
+ * @rtv:      vector of rtombs sorted by start key
+ * @cnt:      number of rtombs in @rtv
+ * @key:      key
+ * @klen:     key length
+ * @view_seq: ignore rtombs with a seqno greater than @view_seq
+ *
+ * Return: seqno of the newest covering rtomb, or zero if there is none
+ */
+uint64_t
+rtomb_lookup(
+    const struct rtomb *rtv,
+    uint32_t cnt,
+    const void *key,
+    uint32_t klen,
+    uint64_t view_seq);
+
+void
+rtomb_vec_init(struct rtomb_vec *rv);
+
+void
+rtomb_vec_fini(struct rtomb_vec *rv);
+
+static inline void
+rtomb_vec_reset(struct rtomb_vec *rv)
+{
+    rv->rv_cnt = 0;
+    rv->rv_sorted = true;
+}
+
+merr_t
+rtomb_vec_add(struct rtomb_vec *rv, const struct rtomb *rt);
+
+/**
+ * rtomb_vec_sort() - sort by start key, required before rtomb_vec_lookup()
+ */
+void
+rtomb_vec_sort(struct rtomb_vec *rv);
+
+static inline uint64_t
+rtomb_vec_lookup(const struct rtomb_vec *rv, const void *key, uint32_t klen, uint64_t view_seq)
+{
+    if (!rv->rv_cnt)
+        return 0;
+
+    return rtomb_lookup(rv->rv_rtv, rv->rv_cnt, key, klen, view_seq);
+}
+
+#endif
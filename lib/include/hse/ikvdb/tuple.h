@@ -26,12 +26,19 @@
 #define HSE_CORE_IS_TOMB(ptr)   (((uintptr_t)(ptr) & ~0x1UL) == ~0x1UL)
 #define HSE_CORE_IS_PTOMB(ptr)  (((uintptr_t)(ptr) & ~0x0UL) == ~0x0UL)
 
+/* Merge operands (see hse_kvs_merge()) are flagged in the most significant
+ * bit of a value's opaque xlen.  Operands live only in c0, they are resolved
+ * into full values on read and when c0 is ingested into cN.
+ */
+#define HSE_CORE_XLEN_MOPND     (1UL << 63)
+
 enum key_lookup_res {
     NOT_FOUND = 1,
     FOUND_VAL = 2,
     FOUND_TMB = 3,
     FOUND_PTMB = 4,
     FOUND_MULTIPLE = 5,
+    FOUND_MOPND = 6,
 };
 
 /* clang-format on */
@@ -153,7 +160,7 @@ kvs_vtuple_cinit(struct kvs_vtuple *vt, void *val, uint vlen, uint clen)
 static HSE_ALWAYS_INLINE uint32_t
 kvs_vtuple_vlen(const struct kvs_vtuple *vt)
 {
-    const uint32_t clen = vt->vt_xlen >> 32;
+    const uint32_t clen = (vt->vt_xlen & ~HSE_CORE_XLEN_MOPND) >> 32;
     const uint32_t vlen = vt->vt_xlen & 0xfffffffful;
 
     return clen ? clen : vlen;
@@ -162,7 +169,26 @@ kvs_vtuple_vlen(const struct kvs_vtuple *vt)
 static HSE_ALWAYS_INLINE uint32_t
 kvs_vtuple_clen(const struct kvs_vtuple *vt)
 {
-    return vt->vt_xlen >> 32;
+    return (vt->vt_xlen & ~HSE_CORE_XLEN_MOPND) >> 32;
+}
+
+/**
+ * kvs_vtuple_minit() - initialize a merge operand value tuple
+ * @vt:   the vtuple to initialize
+ * @val:  pointer to the uncompressed operand
+ * @vlen: the operand length
+ */
+static inline void
+kvs_vtuple_minit(struct kvs_vtuple *vt, void *val, uint vlen)
+{
+    vt->vt_data = val;
+    vt->vt_xlen = HSE_CORE_XLEN_MOPND | vlen;
+}
+
+static HSE_ALWAYS_INLINE bool
+kvs_vtuple_is_mopnd(const struct kvs_vtuple *vt)
+{
+    return vt->vt_xlen & HSE_CORE_XLEN_MOPND;
 }
 
 static inline void
@@ -97,6 +97,15 @@ wal_del_pfx(
     uint64_t txid,
     struct wal_record *recout);
 
+/* MTF_MOCK */
+merr_t
+wal_del_range(
+    struct wal *wal,
+    struct ikvs *kvs,
+    struct kvs_ktuple *start,
+    struct kvs_ktuple *end,
+    struct wal_record *recout);
+
 /* MTF_MOCK */
 merr_t
 wal_txn_begin(struct wal *wal, uint64_t txid, int64_t *cookie);
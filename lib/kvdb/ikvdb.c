@@ -44,8 +44,10 @@
 #include <hse/ikvdb/kvs.h>
 #include <hse/ikvdb/kvs_cparams.h>
 #include <hse/ikvdb/kvs_rparams.h>
+#include <hse/ikvdb/kvs_wait.h>
 #include <hse/ikvdb/lc.h>
 #include <hse/ikvdb/limits.h>
+#include <hse/ikvdb/merge_op.h>
 #include <hse/ikvdb/mclass_policy.h>
 #include <hse/ikvdb/omf_version.h>
 #include <hse/ikvdb/rparam_debug_flags.h>
@@ -60,9 +62,12 @@
 #include <hse/util/bkv_collection.h>
 #include <hse/util/compression_lz4.h>
 #include <hse/util/event_counter.h>
+#include <hse/util/list.h>
 #include <hse/util/log2.h>
 #include <hse/util/page.h>
+#include <hse/util/rtrace.h>
 #include <hse/util/seqno.h>
+#include <hse/util/spinlock.h>
 #include <hse/util/vlb.h>
 #include <hse/util/xrand.h>
 
@@ -145,6 +150,8 @@ static atomic_uint ikvdb_txn_idx;
  * @ikdb_rp:            KVDB run time params
  * @ikdb_lock:          protects ikdb_kvs_vec/ikdb_kvs_cnt writes
  * @ikdb_kvs_cnt:       number of KVSes in ikdb_kvs_vec
+ * @ikdb_snap_lock:     protects ikdb_snap_list
+ * @ikdb_snap_list:     snapshots not yet freed, released at close if leaked
  * @ikdb_kvs_vec:       vector of KVDB KVSes
  * @ikdb_home:          KVDB home
  *
@@ -203,6 +210,9 @@ struct ikvdb_impl {
     uint32_t         ikdb_kvs_cnt;
     struct kvdb_kvs *ikdb_kvs_vec[HSE_KVS_COUNT_MAX];
 
+    spinlock_t       ikdb_snap_lock;
+    struct list_head ikdb_snap_list;
+
     unsigned int     ikdb_omf_version;
     struct pidfh    *ikdb_pidfh;
     struct cJSON    *ikdb_config;
@@ -210,6 +220,27 @@ struct ikvdb_impl {
     const char       ikdb_home[]; /* flexible array */
 };
 
+/**
+ * struct hse_kvdb_snapshot - a read view that is independent of transactions
+ * @snap_seqno:   view seqno
+ * @snap_refs:    one ref for the caller plus one per snapshot cursor
+ * @snap_viewset: viewset in which the snapshot is registered
+ * @snap_cookie:  cursor viewset registration, which holds back the kvdb horizon
+ * @snap_kvdb:    kvdb that created the snapshot
+ * @snap_link:    link on the kvdb's ikdb_snap_list
+ *
+ * The snapshot stays in the viewset until the caller has released it and
+ * every cursor created from it has been destroyed or moved to a new view.
+ */
+struct hse_kvdb_snapshot {
+    uint64_t           snap_seqno;
+    atomic_int         snap_refs;
+    struct viewset    *snap_viewset;
+    void              *snap_cookie;
+    struct ikvdb_impl *snap_kvdb;
+    struct list_head   snap_link;
+};
+
 /* clang-format on */
 
 struct ikvdb *
@@ -867,6 +898,23 @@ ikvdb_txn_fini(struct ikvdb_impl *self)
     }
 }
 
+/* Frees the snapshots the application didn't release before closing the kvdb.
+ */
+static void
+ikvdb_snapshot_fini(struct ikvdb_impl *self)
+{
+    struct hse_kvdb_snapshot *snap, *next;
+    uint64_t minview;
+    uint32_t minchg;
+
+    list_for_each_entry_safe(snap, next, &self->ikdb_snap_list, snap_link) {
+        list_del(&snap->snap_link);
+        viewset_remove(snap->snap_viewset, snap->snap_cookie, &minchg, &minview);
+        perfc_dec(&kvdb_metrics_pc, PERFC_BA_KVDBMETRICS_SNAPCNT);
+        free(snap);
+    }
+}
+
 merr_t
 ikvdb_diag_cndb(struct ikvdb *handle, struct cndb **cndb)
 {
@@ -930,6 +978,9 @@ ikvdb_alloc(const char *kvdb_home, const struct kvdb_rparams *params, struct ikv
     self->ikdb_allow_writes = kvdb_mode_allows_user_writes(params->mode);
     strcpy((char *)self->ikdb_home, kvdb_home);
 
+    spin_lock_init(&self->ikdb_snap_lock);
+    INIT_LIST_HEAD(&self->ikdb_snap_list);
+
     *impl = self;
 
     return 0;
@@ -1423,13 +1474,18 @@ ikvdb_open(const char *kvdb_home, struct kvdb_rparams *params, struct ikvdb **ha
     }
 
     err = cn_kvdb_create(
-        self->ikdb_rp.cn_maint_threads, self->ikdb_rp.cn_io_threads, &self->ikdb_cn_kvdb);
+        self->ikdb_rp.cn_maint_threads,
+        self->ikdb_rp.cn_io_threads,
+        self->ikdb_rp.cn_open_threads,
+        (size_t)self->ikdb_rp.cn_hpcache_mb << 20,
+        &self->ikdb_cn_kvdb);
     if (err) {
         log_errx("cannot open %s", err, kvdb_home);
         goto out;
     }
 
-    err = lc_create(&self->ikdb_lc, &self->ikdb_health);
+    err = lc_create(
+        &self->ikdb_lc, (size_t)self->ikdb_rp.lc_mem_max_mb << 20, &self->ikdb_health);
     if (ev(err)) {
         log_errx("failed to create lc", err);
         goto out;
@@ -2223,6 +2279,8 @@ ikvdb_close(struct ikvdb *handle)
     kvdb_pfxlock_destroy(self->ikdb_pfxlock);
     kvdb_keylock_destroy(self->ikdb_keylock);
 
+    ikvdb_snapshot_fini(self);
+
     viewset_destroy(self->ikdb_cur_viewset);
     viewset_destroy(self->ikdb_txn_viewset);
 
@@ -2341,13 +2399,78 @@ ikvdb_kvs_put(
 
     seqnoref = txn ? 0 : HSE_SQNREF_SINGLE;
 
+    kvs_wait_enter(&kk->kk_ikvs->ikv_wait_pc);
+
     err = kvs_put(kk->kk_ikvs, txn, kt, vt, seqnoref);
 
     if (vbuf && vbuf != tls_vbuf)
         vlb_free(vbuf, (vbufsz > VLB_ALLOCSZ_MAX) ? vbufsz : clen);
 
-    if (!(flags & HSE_KVS_PUT_PRIO || parent->ikdb_rp.throttle_disable))
+    if (!(flags & HSE_KVS_PUT_PRIO || parent->ikdb_rp.throttle_disable)) {
+        uint64_t rtstart = rtrace_span_start();
+
         throttle(parent->ikdb_sensor, &hse_throttle_tls, kt->kt_len + (clen ? clen : vlen));
+        rtrace_span_record(RTRACE_EV_THROTTLE, rtstart);
+    }
+
+    kvs_wait_leave();
+
+    return err;
+}
+
+merr_t
+ikvdb_kvs_merge(
+    struct hse_kvs *handle,
+    const unsigned int flags,
+    struct hse_kvdb_txn * const txn,
+    struct kvs_ktuple *kt,
+    struct kvs_vtuple *vt)
+{
+    merr_t err;
+    uint vlen;
+    uint64_t seqnoref;
+    struct kvdb_kvs *kk;
+    struct kvs_ktuple ktbuf;
+    struct kvs_vtuple vtbuf;
+    struct ikvdb_impl *parent;
+
+    INVARIANT(handle && kt && vt);
+
+    kk = (struct kvdb_kvs *)handle;
+
+    if (HSE_UNLIKELY(!is_write_allowed(kk->kk_ikvs, txn)))
+        return merr(EINVAL);
+
+    parent = kk->kk_parent;
+    if (HSE_UNLIKELY(!parent->ikdb_allow_writes))
+        return merr(EROFS);
+
+    err = kvdb_health_check(&parent->ikdb_health, KVDB_HEALTH_FLAG_ALL);
+    if (err)
+        return err;
+
+    vlen = kvs_vtuple_vlen(vt);
+
+    err = merge_op_validate(kk->kk_ikvs->ikv_merge_op, vt->vt_data, vlen);
+    if (ev(err))
+        return err;
+
+    ktbuf = *kt;
+    kt = &ktbuf;
+
+    /* Operands are never compressed. */
+    kvs_vtuple_minit(&vtbuf, vt->vt_data, vlen);
+
+    seqnoref = txn ? 0 : HSE_SQNREF_SINGLE;
+
+    kvs_wait_enter(&kk->kk_ikvs->ikv_wait_pc);
+
+    err = kvs_merge(kk->kk_ikvs, txn, kt, &vtbuf, seqnoref);
+
+    if (!(flags & HSE_KVS_PUT_PRIO || parent->ikdb_rp.throttle_disable))
+        throttle(parent->ikdb_sensor, &hse_throttle_tls, kt->kt_len + vlen);
+
+    kvs_wait_leave();
 
     return err;
 }
@@ -2425,6 +2548,102 @@ ikvdb_kvs_get(
     return kvs_get(kk->kk_ikvs, txn, kt, view_seqno, res, vbuf);
 }
 
+static void
+ikvdb_snapshot_get(struct hse_kvdb_snapshot *snap)
+{
+    atomic_inc(&snap->snap_refs);
+}
+
+static void
+ikvdb_snapshot_put(struct hse_kvdb_snapshot *snap)
+{
+    uint64_t minview;
+    uint32_t minchg;
+
+    if (atomic_dec_return(&snap->snap_refs) > 0)
+        return;
+
+    spin_lock(&snap->snap_kvdb->ikdb_snap_lock);
+    list_del(&snap->snap_link);
+    spin_unlock(&snap->snap_kvdb->ikdb_snap_lock);
+
+    viewset_remove(snap->snap_viewset, snap->snap_cookie, &minchg, &minview);
+    perfc_dec(&kvdb_metrics_pc, PERFC_BA_KVDBMETRICS_SNAPCNT);
+
+    free(snap);
+}
+
+merr_t
+ikvdb_snapshot_create(struct ikvdb *handle, struct hse_kvdb_snapshot **snapp)
+{
+    struct ikvdb_impl *self = ikvdb_h2r(handle);
+    struct hse_kvdb_snapshot *snap;
+    uint64_t tseqno;
+    merr_t err;
+
+    snap = malloc(sizeof(*snap));
+    if (ev(!snap))
+        return merr(ENOMEM);
+
+    atomic_set(&snap->snap_refs, 1);
+    snap->snap_viewset = self->ikdb_cur_viewset;
+    snap->snap_kvdb = self;
+
+    /* Snapshots share the cursor viewset so that ikvdb_horizon(), and
+     * hence compaction and lc garbage collection, account for them.
+     */
+    err = viewset_insert(snap->snap_viewset, &snap->snap_seqno, &tseqno, &snap->snap_cookie);
+    if (ev(err)) {
+        free(snap);
+        return err;
+    }
+
+    /* As with cursors, wait for ongoing commits to finish so that the
+     * snapshot never sees a partial txn.
+     */
+    kvdb_ctxn_set_wait_commits(self->ikdb_ctxn_set, tseqno);
+
+    spin_lock(&self->ikdb_snap_lock);
+    list_add_tail(&snap->snap_link, &self->ikdb_snap_list);
+    spin_unlock(&self->ikdb_snap_lock);
+
+    perfc_inc(&kvdb_metrics_pc, PERFC_BA_KVDBMETRICS_SNAPCNT);
+
+    *snapp = snap;
+
+    return 0;
+}
+
+void
+ikvdb_snapshot_release(struct ikvdb *handle, struct hse_kvdb_snapshot *snap)
+{
+    if (!snap)
+        return;
+
+    /* Cursors created from the snapshot hold their own refs, which keep
+     * its view in the viewset until they are destroyed.
+     */
+    ikvdb_snapshot_put(snap);
+}
+
+merr_t
+ikvdb_kvs_snapshot_get(
+    struct hse_kvs *handle,
+    const unsigned int flags,
+    struct hse_kvdb_snapshot *snap,
+    struct kvs_ktuple *kt,
+    enum key_lookup_res *res,
+    struct kvs_buf *vbuf)
+{
+    struct kvdb_kvs *kk = (struct kvdb_kvs *)handle;
+
+    if (ev(!handle || !snap))
+        return merr(EINVAL);
+
+    /* The snapshot waited for ongoing commits when its view was established. */
+    return kvs_get(kk->kk_ikvs, NULL, kt, snap->snap_seqno, res, vbuf);
+}
+
 merr_t
 ikvdb_kvs_del(
     struct hse_kvs *handle,
@@ -2453,7 +2672,11 @@ ikvdb_kvs_del(
 
     seqnoref = txn ? 0 : HSE_SQNREF_SINGLE;
 
-    return kvs_del(kk->kk_ikvs, txn, kt, seqnoref);
+    kvs_wait_enter(&kk->kk_ikvs->ikv_wait_pc);
+    err = kvs_del(kk->kk_ikvs, txn, kt, seqnoref);
+    kvs_wait_leave();
+
+    return err;
 }
 
 merr_t
@@ -2494,7 +2717,46 @@ ikvdb_kvs_prefix_delete(
      * Insert prefix tombstone with a higher seqno. Use a higher sequence
      * number to allow newer mutations (after prefix) to be distinguished.
      */
-    return kvs_prefix_del(kk->kk_ikvs, txn, kt, seqnoref);
+    kvs_wait_enter(&kk->kk_ikvs->ikv_wait_pc);
+    err = kvs_prefix_del(kk->kk_ikvs, txn, kt, seqnoref);
+    kvs_wait_leave();
+
+    return err;
+}
+
+merr_t
+ikvdb_kvs_range_delete(
+    struct hse_kvs *handle,
+    const unsigned int flags,
+    struct kvs_ktuple *start,
+    struct kvs_ktuple *end)
+{
+    struct kvdb_kvs *kk = (struct kvdb_kvs *)handle;
+    struct ikvdb_impl *parent;
+    merr_t err;
+
+    INVARIANT(handle);
+    INVARIANT(start->kt_data && end->kt_data);
+
+    if (ev(!is_write_allowed(kk->kk_ikvs, NULL)))
+        return merr(EINVAL);
+
+    parent = kk->kk_parent;
+    if (!parent->ikdb_allow_writes)
+        return merr(EROFS);
+
+    err = kvdb_health_check(&parent->ikdb_health, KVDB_HEALTH_FLAG_ALL);
+    if (ev(err))
+        return err;
+
+    /* Like a prefix tombstone, a range tombstone gets a seqno of its own
+     * so that mutations made after the range delete are not hidden by it.
+     */
+    kvs_wait_enter(&kk->kk_ikvs->ikv_wait_pc);
+    err = kvs_range_del(kk->kk_ikvs, start, end, HSE_SQNREF_SINGLE);
+    kvs_wait_leave();
+
+    return err;
 }
 
 /*-  IKVDB Cursors --------------------------------------------------*/
@@ -2585,11 +2847,12 @@ cursor_unbind_txn(struct hse_kvs_cursor *cur)
     return 0;
 }
 
-merr_t
-ikvdb_kvs_cursor_create(
+static merr_t
+kvs_cursor_create_common(
     struct hse_kvs *handle,
     const unsigned int flags,
     struct hse_kvdb_txn * const txn,
+    struct hse_kvdb_snapshot * const snap,
     const void *prefix,
     size_t pfx_len,
     struct hse_kvs_cursor **cursorp)
@@ -2620,6 +2883,8 @@ ikvdb_kvs_cursor_create(
         err = kvdb_ctxn_get_view_seqno(ctxn, &vseq);
         if (ev(err))
             return err;
+    } else if (snap) {
+        vseq = snap->snap_seqno;
     }
 
     /* The initialization sequence is driven by the way the sequence
@@ -2639,7 +2904,7 @@ ikvdb_kvs_cursor_create(
 
     cur->kc_pkvsl_pc = pkvsl_pc;
 
-    /* if we have a transaction at all, use its view seqno... */
+    /* if we have a transaction or snapshot, use its view seqno... */
     cur->kc_seq = vseq;
     cur->kc_flags = flags;
 
@@ -2647,6 +2912,13 @@ ikvdb_kvs_cursor_create(
     cur->kc_gen = 0;
     cur->kc_bind = ctxn ? kvdb_ctxn_cursor_bind(ctxn) : NULL;
 
+    /* A snapshot cursor is not in the cursor viewset, so it relies on the
+     * snapshot's registration to hold back the horizon.
+     */
+    cur->kc_snap = snap;
+    if (snap)
+        ikvdb_snapshot_get(snap);
+
     /* Temporarily lock a view until this cursor gets refs on cn kvsets. */
     err = cursor_view_acquire(cur, &tseqno);
     if (ev(err))
@@ -2662,9 +2934,9 @@ ikvdb_kvs_cursor_create(
 
     /* After acquiring a view, non-txn cursors must wait for ongoing commits
      * to finish to ensure they never see partial txns.  This is not necessary
-     * for txn cursors because their view is inherited from the txn.
+     * for txn and snapshot cursors because their view is inherited.
      */
-    if (!txn)
+    if (!txn && !snap)
         kvdb_ctxn_set_wait_commits(ikvdb->ikdb_ctxn_set, tseqno);
 
     perfc_inc(&kvdb_metrics_pc, PERFC_BA_KVDBMETRICS_CURCNT);
@@ -2681,6 +2953,33 @@ out:
     return err;
 }
 
+merr_t
+ikvdb_kvs_cursor_create(
+    struct hse_kvs *handle,
+    const unsigned int flags,
+    struct hse_kvdb_txn * const txn,
+    const void *prefix,
+    size_t pfx_len,
+    struct hse_kvs_cursor **cursorp)
+{
+    return kvs_cursor_create_common(handle, flags, txn, NULL, prefix, pfx_len, cursorp);
+}
+
+merr_t
+ikvdb_kvs_snapshot_cursor_create(
+    struct hse_kvs *handle,
+    const unsigned int flags,
+    struct hse_kvdb_snapshot *snap,
+    const void *prefix,
+    size_t pfx_len,
+    struct hse_kvs_cursor **cursorp)
+{
+    if (ev(!snap))
+        return merr(EINVAL);
+
+    return kvs_cursor_create_common(handle, flags, NULL, snap, prefix, pfx_len, cursorp);
+}
+
 merr_t
 ikvdb_kvs_cursor_update_view(struct hse_kvs_cursor *cur, unsigned int flags)
 {
@@ -2718,6 +3017,14 @@ ikvdb_kvs_cursor_update_view(struct hse_kvs_cursor *cur, unsigned int flags)
      */
     kvdb_ctxn_set_wait_commits(cur->kc_kvs->kk_parent->ikdb_ctxn_set, tseqno);
 
+    /* A snapshot cursor has moved to the current view and no longer
+     * needs the snapshot's.
+     */
+    if (cur->kc_snap) {
+        ikvdb_snapshot_put(cur->kc_snap);
+        cur->kc_snap = NULL;
+    }
+
     cur->kc_flags = flags;
 
     perfc_lat_record(cur->kc_pkvsl_pc, PERFC_LT_PKVSL_KVS_CURSOR_UPDATE, tstart);
@@ -2879,6 +3186,7 @@ ikvdb_kvs_cursor_read_copy(
 merr_t
 ikvdb_kvs_cursor_destroy(struct hse_kvs_cursor *cur)
 {
+    struct hse_kvdb_snapshot *snap;
     struct perfc_set *pkvsl_pc;
     uint64_t tstart, ctime;
 
@@ -2893,8 +3201,16 @@ ikvdb_kvs_cursor_destroy(struct hse_kvs_cursor *cur)
 
     perfc_dec(&kvdb_metrics_pc, PERFC_BA_KVDBMETRICS_CURCNT);
 
+    snap = cur->kc_snap;
+    cur->kc_snap = NULL;
+
     kvs_cursor_free(cur);
 
+    /* Drop the snapshot ref only once the cursor can no longer read.
+     */
+    if (snap)
+        ikvdb_snapshot_put(snap);
+
     perfc_lat_record(pkvsl_pc, PERFC_LT_PKVSL_KVS_CURSOR_DESTROY, tstart);
     perfc_lat_record(pkvsl_pc, PERFC_LT_PKVSL_KVS_CURSOR_FULL, ctime);
 
@@ -3215,6 +3531,34 @@ ikvdb_wal_replay_put(
     return err;
 }
 
+merr_t
+ikvdb_wal_replay_merge(
+    struct ikvdb *ikvdb,
+    struct ikvdb_kvs_hdl *ikvsh,
+    uint64_t cnid,
+    uint64_t seqno,
+    struct kvs_ktuple *kt,
+    struct kvs_vtuple *vt)
+{
+    struct kvdb_kvs *kk;
+    merr_t err;
+
+    assert(ikvdb && ikvsh);
+
+    kk = ikvdb_wal_replay_kvs_get(ikvsh, cnid);
+    if (ev(!kk))
+        return 0; /* Possible that the kvs is dropped just prior to crash */
+
+    if (ev(!kvs_vtuple_is_mopnd(vt)))
+        return merr(EPROTO);
+
+    err = kvs_merge(kk->kk_ikvs, NULL, kt, vt, HSE_ORDNL_TO_SQNREF(seqno));
+    if (!err)
+        ikvdb_wal_replay_seqno_set(ikvdb, seqno);
+
+    return err;
+}
+
 merr_t
 ikvdb_wal_replay_del(
     struct ikvdb *ikvdb,
@@ -3263,6 +3607,37 @@ ikvdb_wal_replay_prefix_del(
     return err;
 }
 
+merr_t
+ikvdb_wal_replay_range_del(
+    struct ikvdb *ikvdb,
+    struct ikvdb_kvs_hdl *ikvsh,
+    uint64_t cnid,
+    uint64_t seqno,
+    struct kvs_ktuple *kt,
+    struct kvs_vtuple *vt)
+{
+    struct kvs_ktuple end;
+    struct kvdb_kvs *kk;
+    merr_t err;
+
+    assert(ikvdb && ikvsh);
+
+    kk = ikvdb_wal_replay_kvs_get(ikvsh, cnid);
+    if (ev(!kk))
+        return 0; /* Possible that the kvs is dropped just prior to crash */
+
+    /* The end of the range is logged in the value slot of the record.
+     */
+    kvs_ktuple_init_nohash(&end, vt->vt_data, kvs_vtuple_vlen(vt));
+    end.kt_flags = kt->kt_flags;
+
+    err = kvs_range_del(kk->kk_ikvs, kt, &end, HSE_ORDNL_TO_SQNREF(seqno));
+    if (!err)
+        ikvdb_wal_replay_seqno_set(ikvdb, seqno);
+
+    return err;
+}
+
 merr_t
 ikvdb_wal_replay_sync(struct ikvdb *handle, const unsigned int flags)
 {
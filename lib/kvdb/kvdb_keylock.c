@@ -10,6 +10,7 @@
 #include <hse/kvdb_perfc.h>
 
 #include <hse/ikvdb/kvdb_ctxn.h>
+#include <hse/ikvdb/kvs_wait.h>
 #include <hse/ikvdb/limits.h>
 #include <hse/util/alloc.h>
 #include <hse/util/assert.h>
@@ -558,9 +559,11 @@ kvdb_keylock_lock(
     entry = slab->cls_entryv + slab->cls_entryc++;
 
     /* Attempt to acquire the lock since it wasn't found in the
-     * transaction's container of write locks.
+     * transaction's container of write locks.  keylock_lock() never
+     * blocks, a collision fails the put and is only counted.
      */
     err = keylock_lock(keylock, hash, desc, start_seq, &inherited);
+
     if (!err) {
         locks->ctxn_locks_cnt++;
         entry->lte_next = locks->ctxn_locks_entries;
@@ -578,6 +581,7 @@ kvdb_keylock_lock(
 
     } else {
         perfc_inc(&klock->kl_perfc_set, PERFC_RA_CTXNOP_LOCKFAIL);
+        kvs_wait_inc(PERFC_RA_KVSWAIT_COLLIDE);
 
         slab->cls_entryc--;
     }
@@ -13,6 +13,8 @@
 #include <hse/experimental.h>
 #include <hse/flags.h>
 #include <hse/hse.h>
+#include <hse/kvdb_perfc.h>
+#include <hse/limits.h>
 
 #include <hse/error/merr.h>
 #include <hse/ikvdb/cn.h>
@@ -34,6 +36,9 @@
 #include <hse/rest/status.h>
 #include <hse/util/event_counter.h>
 #include <hse/util/fmt.h>
+#include <hse/util/minmax.h>
+#include <hse/util/perfc.h>
+#include <hse/util/platform.h>
 #include <hse/util/printbuf.h>
 
 #include "kvdb_kvs.h"
@@ -46,6 +51,7 @@
 #define ENDPOINT_FMT_KVDB_MCLASS   "/kvdbs/%s/mclass/%s"
 #define ENDPOINT_FMT_KVDB_PARAMS   "/kvdbs/%s/params"
 #define ENDPOINT_FMT_KVDB_PERFC    "/kvdbs/%s/perfc"
+#define ENDPOINT_FMT_KVDB_WAITERS  "/kvdbs/%s/waiters"
 #define ENDPOINT_FMT_KVS_PARAMS    "/kvdbs/%s/kvs/%s/params"
 #define ENDPOINT_FMT_KVS_PERFC     "/kvdbs/%s/kvs/%s/perfc"
 
@@ -396,6 +402,7 @@ rest_kvdb_get_perfc(
     merr_t err;
     cJSON *root;
     bool pretty;
+    bool reset;
     bool filtered;
     const char *alias;
     const char *filter;
@@ -418,6 +425,12 @@ rest_kvdb_get_perfc(
             resp, REST_STATUS_BAD_REQUEST, "The 'pretty' query parameter must be a boolean",
             merr(EINVAL));
 
+    err = rest_params_get(req->rr_params, "reset", &reset, false);
+    if (ev(err))
+        return rest_response_perror(
+            resp, REST_STATUS_BAD_REQUEST, "The 'reset' query parameter must be a boolean",
+            merr(EINVAL));
+
     snprintf(
         dt_path, sizeof(dt_path), PERFC_DT_PATH "/kvdbs/%s%s%s", alias, filtered ? "/" : "",
         filtered ? filter : "");
@@ -449,6 +462,11 @@ rest_kvdb_get_perfc(
     fputs(data, resp->rr_stream);
     cJSON_free(data);
 
+    /* Start a new percentile interval for the counters just emitted.
+     */
+    if (reset)
+        perfc_interval_reset(dt_path);
+
     rest_headers_set(resp->rr_headers, REST_HEADER_CONTENT_TYPE, REST_APPLICATION_JSON);
     status = REST_STATUS_OK;
 
@@ -458,6 +476,215 @@ out:
     return status;
 }
 
+/**
+ * struct kvs_waiter - time spent waiting by a KVS for a single reason
+ * @kw_kvs:    KVS name
+ * @kw_reason: wait reason (KVSWAIT counter header)
+ * @kw_hits:   number of waits
+ * @kw_sum:    total time spent waiting (nsecs)
+ * @kw_delta:  time over which the waits were counted (nsecs)
+ */
+struct kvs_waiter {
+    char kw_kvs[HSE_KVS_NAME_LEN_MAX];
+    const char *kw_reason;
+    uint64_t kw_hits;
+    uint64_t kw_sum;
+    uint64_t kw_delta;
+};
+
+struct kvs_waiters {
+    size_t kws_pfxlen;
+    size_t kws_cnt;
+    uint64_t kws_now;
+    struct kvs_waiter kws_waiterv[HSE_KVS_COUNT_MAX * PERFC_EN_KVSWAIT];
+};
+
+static merr_t
+kvs_waiters_cb(void *data, void *ctx)
+{
+    struct perfc_seti *seti = data;
+    struct kvs_waiters *kws = ctx;
+    const char *name;
+    size_t namelen;
+
+    if (!seti || strcmp(seti->pcs_famname, "KVSWAIT"))
+        return 0;
+
+    /* Counter set path is <prefix><kvs>/KVSWAIT/wait */
+    name = seti->pcs_path + kws->kws_pfxlen;
+    namelen = strcspn(name, "/");
+
+    for (uint32_t cidx = 0; cidx < seti->pcs_ctrc; cidx++) {
+        struct kvs_waiter *kw = kws->kws_waiterv + kws->kws_cnt;
+        uint64_t reset;
+
+        if (seti->pcs_ctrv[cidx].hdr.pch_type != PERFC_TYPE_LT)
+            continue;
+
+        if (ev(kws->kws_cnt >= NELEM(kws->kws_waiterv)))
+            break;
+
+        reset = perfc_dis_read(seti, cidx, true, &kw->kw_hits, &kw->kw_sum);
+        if (kw->kw_hits == 0)
+            continue;
+
+        strlcpy(kw->kw_kvs, name, min_t(size_t, namelen + 1, sizeof(kw->kw_kvs)));
+        kw->kw_reason = seti->pcs_ctrnamev[cidx].pcn_hdr;
+        kw->kw_delta = kws->kws_now - reset;
+        kws->kws_cnt++;
+    }
+
+    return 0;
+}
+
+static int
+kvs_waiter_cmp(const void *lhs, const void *rhs)
+{
+    const struct kvs_waiter *a = lhs, *b = rhs;
+
+    return (a->kw_sum < b->kw_sum) - (a->kw_sum > b->kw_sum);
+}
+
+/* Report the KVSes that spent the most time blocked since the last reset,
+ * one entry per KVS and wait reason, along with the total time spent
+ * blocked for each reason across all KVSes.
+ */
+static enum rest_status
+rest_kvdb_get_waiters(
+    const struct rest_request * const req,
+    struct rest_response * const resp,
+    void * const ctx)
+{
+    char *data;
+    merr_t err;
+    size_t limit;
+    bool pretty;
+    bool reset;
+    cJSON *root, *totals, *waiters;
+    struct ikvdb *kvdb;
+    struct kvs_waiters *kws;
+    enum rest_status status;
+    char dt_path[DT_PATH_MAX];
+
+    INVARIANT(req);
+    INVARIANT(resp);
+    INVARIANT(ctx);
+
+    kvdb = ctx;
+
+    err = rest_params_get(req->rr_params, "pretty", &pretty, false);
+    if (ev(err))
+        return rest_response_perror(
+            resp, REST_STATUS_BAD_REQUEST, "The 'pretty' query parameter must be a boolean",
+            merr(EINVAL));
+
+    err = rest_params_get(req->rr_params, "reset", &reset, false);
+    if (ev(err))
+        return rest_response_perror(
+            resp, REST_STATUS_BAD_REQUEST, "The 'reset' query parameter must be a boolean",
+            merr(EINVAL));
+
+    err = rest_params_get(req->rr_params, "limit", &limit, 10);
+    if (ev(err))
+        return rest_response_perror(
+            resp, REST_STATUS_BAD_REQUEST,
+            "The 'limit' query parameter must be a non-negative integer", merr(EINVAL));
+
+    kws = malloc(sizeof(*kws));
+    if (ev(!kws))
+        return rest_response_perror(
+            resp, REST_STATUS_SERVICE_UNAVAILABLE, "Out of memory", merr(ENOMEM));
+
+    kws->kws_pfxlen = snprintf(
+        dt_path, sizeof(dt_path), PERFC_DT_PATH "/kvdbs/%s/kvs/", ikvdb_alias(kvdb));
+    kws->kws_cnt = 0;
+    kws->kws_now = get_time_ns();
+
+    err = dt_iterate(dt_path, kvs_waiters_cb, kws);
+    if (ev(err)) {
+        free(kws);
+        return rest_response_perror(
+            resp, REST_STATUS_INTERNAL_SERVER_ERROR, "Unhandled error", err);
+    }
+
+    qsort(kws->kws_waiterv, kws->kws_cnt, sizeof(kws->kws_waiterv[0]), kvs_waiter_cmp);
+
+    root = cJSON_CreateObject();
+    if (ev(!root)) {
+        free(kws);
+        return rest_response_perror(
+            resp, REST_STATUS_SERVICE_UNAVAILABLE, "Out of memory", merr(ENOMEM));
+    }
+
+    totals = cJSON_AddObjectToObject(root, "totals");
+    waiters = cJSON_AddArrayToObject(root, "waiters");
+    if (ev(!totals || !waiters)) {
+        status = rest_response_perror(
+            resp, REST_STATUS_SERVICE_UNAVAILABLE, "Out of memory", merr(ENOMEM));
+        goto out;
+    }
+
+    for (size_t i = 0; i < kws->kws_cnt; i++) {
+        const struct kvs_waiter *kw = kws->kws_waiterv + i;
+        cJSON *total, *waiter;
+        bool bad = false;
+
+        total = cJSON_GetObjectItemCaseSensitive(totals, kw->kw_reason);
+        if (total) {
+            cJSON_SetNumberValue(total, total->valuedouble + kw->kw_sum);
+        } else {
+            bad |= !cJSON_AddNumberToObject(totals, kw->kw_reason, kw->kw_sum);
+        }
+
+        if (i < limit) {
+            waiter = cJSON_CreateObject();
+            if (waiter) {
+                bad |= !cJSON_AddStringToObject(waiter, "kvs", kw->kw_kvs);
+                bad |= !cJSON_AddStringToObject(waiter, "reason", kw->kw_reason);
+                bad |= !cJSON_AddNumberToObject(waiter, "hits", kw->kw_hits);
+                bad |= !cJSON_AddNumberToObject(waiter, "total_ns", kw->kw_sum);
+                bad |= !cJSON_AddNumberToObject(waiter, "average_ns", kw->kw_sum / kw->kw_hits);
+                bad |= !cJSON_AddNumberToObject(waiter, "delta_ns", kw->kw_delta);
+            }
+
+            if (!waiter || bad || !cJSON_AddItemToArray(waiters, waiter)) {
+                cJSON_Delete(waiter);
+                bad = true;
+            }
+        }
+
+        if (ev(bad)) {
+            status = rest_response_perror(
+                resp, REST_STATUS_SERVICE_UNAVAILABLE, "Out of memory", merr(ENOMEM));
+            goto out;
+        }
+    }
+
+    data = (pretty ? cJSON_Print : cJSON_PrintUnformatted)(root);
+    if (ev(!data)) {
+        status = rest_response_perror(
+            resp, REST_STATUS_SERVICE_UNAVAILABLE, "Out of memory", merr(ENOMEM));
+        goto out;
+    }
+
+    fputs(data, resp->rr_stream);
+    cJSON_free(data);
+
+    /* Start a new interval for all of the KVDB's KVS counters.
+     */
+    if (reset)
+        perfc_interval_reset(dt_path);
+
+    rest_headers_set(resp->rr_headers, REST_HEADER_CONTENT_TYPE, REST_APPLICATION_JSON);
+    status = REST_STATUS_OK;
+
+out:
+    cJSON_Delete(root);
+    free(kws);
+
+    return status;
+}
+
 static enum rest_status
 rest_kvs_params_get(
     const struct rest_request * const req,
@@ -629,6 +856,7 @@ rest_kvs_get_perfc(
     merr_t err;
     cJSON *root;
     bool pretty;
+    bool reset;
     bool filtered;
     const char *alias;
     const char *filter;
@@ -653,6 +881,12 @@ rest_kvs_get_perfc(
             resp, REST_STATUS_BAD_REQUEST, "The 'pretty' query parameter must be a boolean",
             merr(EINVAL));
 
+    err = rest_params_get(req->rr_params, "reset", &reset, false);
+    if (ev(err))
+        return rest_response_perror(
+            resp, REST_STATUS_BAD_REQUEST, "The 'reset' query parameter must be a boolean",
+            merr(EINVAL));
+
     snprintf(
         dt_path, sizeof(dt_path), PERFC_DT_PATH "/kvdbs/%s/kvs/%s%s%s", alias,
         kvs->kk_ikvs->ikv_kvs_name, filtered ? "/" : "", filtered ? filter : "");
@@ -684,6 +918,11 @@ rest_kvs_get_perfc(
     fputs(data, resp->rr_stream);
     cJSON_free(data);
 
+    /* Start a new percentile interval for the counters just emitted.
+     */
+    if (reset)
+        perfc_interval_reset(dt_path);
+
     rest_headers_set(resp->rr_headers, REST_HEADER_CONTENT_TYPE, REST_APPLICATION_JSON);
     status = REST_STATUS_OK;
 
@@ -914,6 +1153,9 @@ kvdb_rest_add_endpoints(struct ikvdb * const kvdb)
         {
             [REST_METHOD_GET] = rest_kvdb_get_perfc,
         },
+        {
+            [REST_METHOD_GET] = rest_kvdb_get_waiters,
+        },
     };
 
     merr_t err = 0;
@@ -975,6 +1217,13 @@ kvdb_rest_add_endpoints(struct ikvdb * const kvdb)
         return err;
     }
 
+    err = rest_server_add_endpoint(
+        REST_ENDPOINT_EXACT, handlers[7], kvdb, ENDPOINT_FMT_KVDB_WAITERS, alias);
+    if (err) {
+        log_errx("Failed to add REST endpoint (" ENDPOINT_FMT_KVDB_WAITERS ")", err, alias);
+        return err;
+    }
+
     return 0;
 }
 
@@ -995,6 +1244,7 @@ kvdb_rest_remove_endpoints(struct ikvdb * const kvdb)
         rest_server_remove_endpoint(ENDPOINT_FMT_KVDB_MCLASS, alias, hse_mclass_name_get(i));
     rest_server_remove_endpoint(ENDPOINT_FMT_KVDB_PARAMS, alias);
     rest_server_remove_endpoint(ENDPOINT_FMT_KVDB_PERFC, alias);
+    rest_server_remove_endpoint(ENDPOINT_FMT_KVDB_WAITERS, alias);
 }
 
 merr_t
@@ -930,6 +930,27 @@ static const struct param_spec pspecs[] = {
             },
         },
     },
+    {
+        .ps_name = "csched_vgc_pct",
+        .ps_description = "vblock garbage pct at which a garbage k-compaction relocates a kvset's values (0 disables)",
+        .ps_flags = PARAM_EXPERIMENTAL | PARAM_WRITABLE,
+        .ps_type = PARAM_TYPE_U8,
+        .ps_offset = offsetof(struct kvdb_rparams, csched_vgc_pct),
+        .ps_size = PARAM_SZ(struct kvdb_rparams, csched_vgc_pct),
+        .ps_convert = param_default_converter,
+        .ps_validate = param_default_validator,
+        .ps_stringify = param_default_stringify,
+        .ps_jsonify = param_default_jsonify,
+        .ps_default_value = {
+            .as_uscalar = 50,
+        },
+        .ps_bounds = {
+            .as_uscalar = {
+                .ps_min = 0,
+                .ps_max = 100,
+            },
+        },
+    },
     {
         .ps_name = "csched_max_vgroups",
         .ps_description = "leaf-scatter-remediation trigger threshold",
@@ -1077,6 +1098,90 @@ static const struct param_spec pspecs[] = {
             },
         },
     },
+    {
+        .ps_name = "csched_heat_staging_max",
+        .ps_description = "staging media class budget for heat-based kvset migration (MiB, 0 disables)",
+        .ps_flags = PARAM_EXPERIMENTAL | PARAM_WRITABLE,
+        .ps_type = PARAM_TYPE_U64,
+        .ps_offset = offsetof(struct kvdb_rparams, csched_heat_staging_max),
+        .ps_size = PARAM_SZ(struct kvdb_rparams, csched_heat_staging_max),
+        .ps_convert = param_default_converter,
+        .ps_validate = param_default_validator,
+        .ps_stringify = param_default_stringify,
+        .ps_jsonify = param_default_jsonify,
+        .ps_default_value = {
+            .as_uscalar = 0,
+        },
+        .ps_bounds = {
+            .as_uscalar = {
+                .ps_min = 0,
+                .ps_max = UINT64_MAX,
+            },
+        },
+    },
+    {
+        .ps_name = "csched_heat_hot",
+        .ps_description = "heat at which a leaf kvset is migrated to the staging media class",
+        .ps_flags = PARAM_EXPERIMENTAL | PARAM_WRITABLE,
+        .ps_type = PARAM_TYPE_U64,
+        .ps_offset = offsetof(struct kvdb_rparams, csched_heat_hot),
+        .ps_size = PARAM_SZ(struct kvdb_rparams, csched_heat_hot),
+        .ps_convert = param_default_converter,
+        .ps_validate = param_default_validator,
+        .ps_stringify = param_default_stringify,
+        .ps_jsonify = param_default_jsonify,
+        .ps_default_value = {
+            .as_uscalar = 4096,
+        },
+        .ps_bounds = {
+            .as_uscalar = {
+                .ps_min = 16,
+                .ps_max = UINT64_MAX,
+            },
+        },
+    },
+    {
+        .ps_name = "csched_io_rd_mbps",
+        .ps_description = "compaction read budget in MiB/s while there are foreground reads (0: unlimited)",
+        .ps_flags = PARAM_EXPERIMENTAL | PARAM_WRITABLE,
+        .ps_type = PARAM_TYPE_U64,
+        .ps_offset = offsetof(struct kvdb_rparams, csched_io_rd_mbps),
+        .ps_size = PARAM_SZ(struct kvdb_rparams, csched_io_rd_mbps),
+        .ps_convert = param_default_converter,
+        .ps_validate = param_default_validator,
+        .ps_stringify = param_default_stringify,
+        .ps_jsonify = param_default_jsonify,
+        .ps_default_value = {
+            .as_uscalar = 0,
+        },
+        .ps_bounds = {
+            .as_uscalar = {
+                .ps_min = 0,
+                .ps_max = 1ul << 30,
+            },
+        },
+    },
+    {
+        .ps_name = "csched_io_wr_mbps",
+        .ps_description = "compaction write budget in MiB/s while there are foreground reads (0: unlimited)",
+        .ps_flags = PARAM_EXPERIMENTAL | PARAM_WRITABLE,
+        .ps_type = PARAM_TYPE_U64,
+        .ps_offset = offsetof(struct kvdb_rparams, csched_io_wr_mbps),
+        .ps_size = PARAM_SZ(struct kvdb_rparams, csched_io_wr_mbps),
+        .ps_convert = param_default_converter,
+        .ps_validate = param_default_validator,
+        .ps_stringify = param_default_stringify,
+        .ps_jsonify = param_default_jsonify,
+        .ps_default_value = {
+            .as_uscalar = 0,
+        },
+        .ps_bounds = {
+            .as_uscalar = {
+                .ps_min = 0,
+                .ps_max = 1ul << 30,
+            },
+        },
+    },
     {
         .ps_name = "durability.enabled",
         .ps_description = "Enable durability in the event of a crash",
@@ -1494,6 +1599,70 @@ static const struct param_spec pspecs[] = {
             },
         },
     },
+    {
+        .ps_name = "cn_open_threads",
+        .ps_description = "max number of threads opening kvsets at kvs open",
+        .ps_flags = PARAM_EXPERIMENTAL,
+        .ps_type = PARAM_TYPE_U16,
+        .ps_offset = offsetof(struct kvdb_rparams, cn_open_threads),
+        .ps_size = PARAM_SZ(struct kvdb_rparams, cn_open_threads),
+        .ps_convert = param_default_converter,
+        .ps_validate = param_default_validator,
+        .ps_stringify = param_default_stringify,
+        .ps_jsonify = param_default_jsonify,
+        .ps_default_value = {
+            .as_uscalar = 8,
+        },
+        .ps_bounds = {
+            .as_uscalar = {
+                .ps_min = 1,
+                .ps_max = 256,
+            },
+        },
+    },
+    {
+        .ps_name = "cn_hpcache_mb",
+        .ps_description = "MiB of huge pages for caching kblock indexes (0: disable)",
+        .ps_flags = PARAM_EXPERIMENTAL,
+        .ps_type = PARAM_TYPE_U32,
+        .ps_offset = offsetof(struct kvdb_rparams, cn_hpcache_mb),
+        .ps_size = PARAM_SZ(struct kvdb_rparams, cn_hpcache_mb),
+        .ps_convert = param_default_converter,
+        .ps_validate = param_default_validator,
+        .ps_stringify = param_default_stringify,
+        .ps_jsonify = param_default_jsonify,
+        .ps_default_value = {
+            .as_uscalar = 0,
+        },
+        .ps_bounds = {
+            .as_uscalar = {
+                .ps_min = 0,
+                .ps_max = 1u << 20,
+            },
+        },
+    },
+    {
+        .ps_name = "lc_mem_max_mb",
+        .ps_description = "MiB held in LC beyond which it is trimmed and spilled to cN eagerly "
+                          "(0: unbounded)",
+        .ps_flags = PARAM_EXPERIMENTAL,
+        .ps_type = PARAM_TYPE_U32,
+        .ps_offset = offsetof(struct kvdb_rparams, lc_mem_max_mb),
+        .ps_size = PARAM_SZ(struct kvdb_rparams, lc_mem_max_mb),
+        .ps_convert = param_default_converter,
+        .ps_validate = param_default_validator,
+        .ps_stringify = param_default_stringify,
+        .ps_jsonify = param_default_jsonify,
+        .ps_default_value = {
+            .as_uscalar = 1024,
+        },
+        .ps_bounds = {
+            .as_uscalar = {
+                .ps_min = 0,
+                .ps_max = 1u << 20,
+            },
+        },
+    },
     {
         .ps_name = "keylock_tables",
         .ps_description = "number of keylock tables",
@@ -11,6 +11,7 @@
 
 #include <hse/ikvdb/ikvdb.h>
 #include <hse/ikvdb/kvdb_rparams.h>
+#include <hse/ikvdb/kvs_wait.h>
 #include <hse/ikvdb/rparam_debug_flags.h>
 #include <hse/ikvdb/throttle.h>
 #include <hse/ikvdb/throttle_perfc.h>
@@ -718,6 +719,7 @@ throttle(struct throttle_sensor *self, struct throttle_tls *tls, uint64_t bytes)
 
         if (delay > tls->slack * 16) {
             struct timespec req;
+            uint64_t wstart;
 
             tls->resid = 0;
             delay -= tls->slack;
@@ -725,7 +727,9 @@ throttle(struct throttle_sensor *self, struct throttle_tls *tls, uint64_t bytes)
             req.tv_sec = delay / NSEC_PER_SEC;
             req.tv_nsec = delay % NSEC_PER_SEC;
 
+            wstart = kvs_wait_start();
             nanosleep(&req, NULL);
+            kvs_wait_record(PERFC_LT_KVSWAIT_THROTTLE, wstart);
         }
     }
 }
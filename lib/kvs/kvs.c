@@ -8,6 +8,8 @@
  */
 
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <hse/kvdb_perfc.h>
 
@@ -18,8 +20,10 @@
 #include <hse/ikvdb/kvdb_ctxn.h>
 #include <hse/ikvdb/kvdb_health.h>
 #include <hse/ikvdb/kvs.h>
+#include <hse/ikvdb/kvs_wait.h>
 #include <hse/ikvdb/lc.h>
 #include <hse/ikvdb/limits.h>
+#include <hse/ikvdb/merge_op.h>
 #include <hse/ikvdb/tuple.h>
 #include <hse/ikvdb/wal.h>
 #include <hse/logging/logging.h>
@@ -31,6 +35,7 @@
 #include <hse/util/map.h>
 #include <hse/util/perfc.h>
 #include <hse/util/platform.h>
+#include <hse/util/rtrace.h>
 #include <hse/util/slab.h>
 
 /* clang-format off */
@@ -56,6 +61,15 @@ struct perfc_name kvs_pkvsl_perfc_op[] _dt_section = {
     NE(PERFC_LT_PKVSL_KVS_DEL,            5, "kvs_delete latency",         "kvs_del_lat", 7),
     NE(PERFC_LT_PKVSL_KVS_PFX_PROBE,      5, "kvs_prefix_probe latency",   "kvs_pfx_probe_lat", 7),
     NE(PERFC_LT_PKVSL_KVS_PFX_DEL,        5, "kvs_prefix_delete latency",  "kvs_pfx_del_lat", 7),
+    NE(PERFC_LT_PKVSL_KVS_MERGE,          5, "kvs_merge latency",          "kvs_merge_lat", 7),
+    NE(PERFC_LT_PKVSL_KVS_RANGE_DEL,      5, "kvs_range_delete latency",   "kvs_range_del_lat", 7),
+};
+
+struct perfc_name kvs_wait_perfc_op[] _dt_section = {
+    NE(PERFC_LT_KVSWAIT_THROTTLE,         2, "throttle sleep time",        "throttle"),
+    NE(PERFC_LT_KVSWAIT_C0FULL,           2, "c0 full ingest wait time",   "c0_full"),
+    NE(PERFC_LT_KVSWAIT_WALBUF,           2, "wal buffer alloc wait time", "wal_buf"),
+    NE(PERFC_RA_KVSWAIT_COLLIDE,          2, "txn keylock collisions",     "keylock_collide"),
 };
 
 /* clang-format on */
@@ -65,6 +79,10 @@ NE_CHECK(
     PERFC_EN_PKVSL,
     "public kvs interface latencies perfc ops table/enum mismatch");
 
+NE_CHECK(kvs_wait_perfc_op, PERFC_EN_KVSWAIT, "kvs wait perfc ops table/enum mismatch");
+
+thread_local struct perfc_set *kvs_wait_pc_tls;
+
 struct mpool;
 
 /*-  Key Value Store  -------------------------------------------------------*/
@@ -89,6 +107,9 @@ kvs_perfc_alloc(const char *kvdb_alias, const char *kvs_name, struct ikvs *kvs)
 
     /* Measure Public KVS interface Latencies */
     perfc_alloc(kvs_pkvsl_perfc_op, group, "set", kvs->ikv_rp.perfc_level, &kvs->ikv_pkvsl_pc);
+
+    /* Per-reason wait accounting, enabled at the default perfc level */
+    perfc_alloc(kvs_wait_perfc_op, group, "wait", kvs->ikv_rp.perfc_level, &kvs->ikv_wait_pc);
 }
 
 /**
@@ -107,6 +128,7 @@ kvs_perfc_free(struct ikvs *kvs)
 {
     kvs_cursor_perfc_free(&kvs->ikv_cc_pc, &kvs->ikv_cd_pc);
     perfc_free(&kvs->ikv_pkvsl_pc);
+    perfc_free(&kvs->ikv_wait_pc);
 }
 
 /*
@@ -179,6 +201,7 @@ kvs_open(
         goto err_exit;
 
     ikvs->ikv_pfx_len = c0_get_pfx_len(ikvs->ikv_c0);
+    ikvs->ikv_merge_op = cn_get_cparams(ikvs->ikv_cn)->merge_op;
 
     kvs_perfc_alloc(ikvdb_alias(kvdb), kvs_name, ikvs);
 
@@ -330,7 +353,7 @@ kvs_get(
     struct lc *lc = kvs->ikv_lc;
     struct cn *cn = kvs->ikv_cn;
     uintptr_t seqnoref = 0;
-    uint64_t tstart;
+    uint64_t tstart, rtstart;
     merr_t err;
 
     tstart = perfc_lat_start(pkvsl_pc);
@@ -347,22 +370,139 @@ kvs_get(
             return err;
     }
 
+    rtstart = rtrace_span_start();
     err = c0_get(c0, kt, seqno, seqnoref, res, vbuf);
+    rtrace_span_record(RTRACE_EV_C0, rtstart);
 
-    if (!err && *res == NOT_FOUND)
+    if (!err && *res == NOT_FOUND) {
+        rtstart = rtrace_span_start();
         err = lc_get(lc, c0_index(c0), kvs->ikv_pfx_len, kt, seqno, seqnoref, res, vbuf);
+        rtrace_span_record(RTRACE_EV_LC, rtstart);
+    }
 
     if (ctxn)
         kvdb_ctxn_unlock(ctxn);
 
-    if (!err && *res == NOT_FOUND)
+    if (!err && *res == NOT_FOUND) {
+        rtstart = rtrace_span_start();
         err = cn_get(cn, kt, seqno, res, vbuf);
+        rtrace_span_record(RTRACE_EV_CN, rtstart);
+    }
+
+    /* Merge operands live only in c0 and are never private to a txn.
+     */
+    if (!err && *res == FOUND_MOPND)
+        err = c0_get_merged(c0, kt, seqno, res, vbuf);
 
     perfc_lat_record(pkvsl_pc, PERFC_LT_PKVSL_KVS_GET, tstart);
 
     return err;
 }
 
+/* Transactions already hold the key's write lock, so a merge within a txn
+ * is resolved eagerly into a put of the merged value.  This keeps operands
+ * out of txn-private data (and hence out of lc).
+ *
+ * Most merged values are small, so the value is fetched into a stack buffer
+ * and only values that outgrow it are refetched into an exactly sized heap
+ * buffer (the txn's view of the key cannot change in between).
+ */
+static merr_t
+kvs_merge_txn(
+    struct ikvs *kvs,
+    struct hse_kvdb_txn * const txn,
+    struct kvs_ktuple *kt,
+    struct kvs_vtuple *vt)
+{
+    enum key_lookup_res res;
+    struct kvs_vtuple mvt;
+    struct kvs_buf vbuf;
+    char sbuf[1024];
+    uint32_t len, sz;
+    void *buf = sbuf;
+    merr_t err;
+
+    kvs_buf_init(&vbuf, sbuf, sizeof(sbuf));
+
+    err = kvs_get(kvs, txn, kt, 0, &res, &vbuf);
+    if (err)
+        return err;
+
+    len = (res == FOUND_VAL) ? vbuf.b_len : 0;
+    sz = merge_op_result_len(kvs->ikv_merge_op, len, kvs_vtuple_vlen(vt));
+    sz = max_t(uint32_t, sz, len);
+
+    if (sz > sizeof(sbuf)) {
+        buf = malloc(sz);
+        if (ev(!buf))
+            return merr(ENOMEM);
+
+        if (len > sizeof(sbuf)) {
+            kvs_buf_init(&vbuf, buf, sz);
+
+            err = kvs_get(kvs, txn, kt, 0, &res, &vbuf);
+            if (ev(err))
+                goto out;
+
+            len = (res == FOUND_VAL) ? min_t(uint32_t, vbuf.b_len, sz) : 0;
+        } else {
+            memcpy(buf, sbuf, len);
+        }
+    }
+
+    merge_op_apply(kvs->ikv_merge_op, buf, sz, &len, vt->vt_data, kvs_vtuple_vlen(vt));
+
+    kvs_vtuple_init(&mvt, buf, len);
+
+    err = kvs_put(kvs, txn, kt, &mvt, 0);
+
+out:
+    if (buf != sbuf)
+        free(buf);
+
+    return err;
+}
+
+merr_t
+kvs_merge(
+    struct ikvs *kvs,
+    struct hse_kvdb_txn * const txn,
+    struct kvs_ktuple *kt,
+    struct kvs_vtuple *vt,
+    uintptr_t seqnoref)
+{
+    struct perfc_set *pkvsl_pc = kvs_perfc_pkvsl(kvs);
+    struct wal_record rec;
+    uint64_t tstart;
+    merr_t err;
+
+    assert(kvs_vtuple_is_mopnd(vt));
+
+    tstart = perfc_lat_start(pkvsl_pc);
+
+    if (txn) {
+        err = kvs_merge_txn(kvs, txn, kt, vt);
+        goto out;
+    }
+
+    assert(kt->kt_len >= kvs->ikv_rp.kvs_sfxlen);
+    kt->kt_hash = key_hash64(kt->kt_data, kt->kt_len - kvs->ikv_rp.kvs_sfxlen);
+    rec.cookie = -1;
+
+    err = wal_put(kvs->ikv_wal, kvs, kt, vt, 0, &rec);
+
+    if (HSE_LIKELY(!err)) {
+        err = c0_merge(kvs->ikv_c0, kt, vt, seqnoref);
+
+        wal_op_finish(kvs->ikv_wal, &rec, kt->kt_seqno, kt->kt_dgen, merr_errno(err));
+    }
+
+out:
+    perfc_lat_record(pkvsl_pc, PERFC_LT_PKVSL_KVS_MERGE, tstart);
+
+    return err;
+}
+
 merr_t
 kvs_del(
     struct ikvs *kvs,
@@ -463,6 +603,67 @@ kvs_prefix_del(
     return ev(err);
 }
 
+merr_t
+kvs_range_del(
+    struct ikvs *kvs,
+    struct kvs_ktuple *start,
+    struct kvs_ktuple *end,
+    uintptr_t seqnoref)
+{
+    struct perfc_set *pkvsl_pc = kvs_perfc_pkvsl(kvs);
+    struct wal_record rec;
+    uint64_t tstart;
+    merr_t err;
+
+    tstart = perfc_lat_start(pkvsl_pc);
+
+    rec.cookie = -1;
+
+    err = wal_del_range(kvs->ikv_wal, kvs, start, end, &rec);
+    if (!err) {
+        err = c0_range_del(kvs->ikv_c0, start, end, seqnoref);
+
+        wal_op_finish(kvs->ikv_wal, &rec, start->kt_seqno, start->kt_dgen, merr_errno(err));
+    }
+
+    perfc_lat_record(pkvsl_pc, PERFC_LT_PKVSL_KVS_RANGE_DEL, tstart);
+
+    return ev(err);
+}
+
+/* The value found by a prefix probe may be a merge operand, in which
+ * case it must be resolved via a point lookup of the key that was found.
+ * Operands live only in c0, so c0 alone tells us whether that's needed.
+ */
+static merr_t
+kvs_pfx_probe_merged(
+    struct ikvs *kvs,
+    uint64_t seqno,
+    uintptr_t seqnoref,
+    struct kvs_buf *kbuf,
+    struct kvs_buf *vbuf)
+{
+    enum key_lookup_res res;
+    struct kvs_ktuple kt;
+    struct kvs_buf tbuf;
+    merr_t err;
+
+    /* Cannot resolve the operand if the caller's key buffer was too small. */
+    if (kbuf->b_len > kbuf->b_buf_sz || kbuf->b_len < kvs->ikv_rp.kvs_sfxlen)
+        return 0;
+
+    kvs_ktuple_init_nohash(&kt, kbuf->b_buf, kbuf->b_len);
+    kt.kt_hash = key_hash64(kt.kt_data, kt.kt_len - kvs->ikv_rp.kvs_sfxlen);
+
+    kvs_buf_init(&tbuf, NULL, 0);
+
+    err = c0_get(kvs->ikv_c0, &kt, seqno, seqnoref, &res, &tbuf);
+    if (err || res != FOUND_MOPND)
+        return err;
+
+    return c0_get_merged(kvs->ikv_c0, &kt, seqno, &res, vbuf);
+}
+
 merr_t
 kvs_pfx_probe(
     struct ikvs *kvs,
@@ -510,12 +711,16 @@ kvs_pfx_probe(
         goto exit;
 
 exit:
+    if (!err && qctx.seen > 0 && kvs->ikv_merge_op != MERGE_OP_NONE)
+        err = kvs_pfx_probe_merged(kvs, seqno, seqnoref, kbuf, vbuf);
+
     if (ctxn)
         kvdb_ctxn_unlock(ctxn);
 
     /* If any tombstone was encountered, a tomb_map is created. Free the tomb_map.
      */
     map_destroy(qctx.tomb_map);
+    rtomb_vec_fini(&qctx.rtombs);
 
     if (ev(err))
         return err;
@@ -3,15 +3,98 @@
  * SPDX-FileCopyrightText: Copyright 2015 Micron Technology, Inc.
  */
 
+#include <errno.h>
 #include <limits.h>
 #include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <hse/limits.h>
 
 #include <hse/config/params.h>
 #include <hse/ikvdb/kvs_cparams.h>
 #include <hse/ikvdb/limits.h>
+#include <hse/ikvdb/merge_op.h>
+#include <hse/logging/logging.h>
+#include <hse/util/assert.h>
 #include <hse/util/base.h>
+#include <hse/util/compiler.h>
+
+static bool HSE_NONNULL(1, 2, 3)
+merge_op_converter(const struct param_spec * const ps, const cJSON * const node, void * const data)
+{
+    const char *value;
+
+    INVARIANT(ps);
+    INVARIANT(node);
+    INVARIANT(data);
+
+    if (!cJSON_IsString(node))
+        return false;
+
+    value = cJSON_GetStringValue(node);
+    if (strcmp(value, MERGE_OP_PARAM_NONE) == 0) {
+        *(enum merge_op *)data = MERGE_OP_NONE;
+    } else if (strcmp(value, MERGE_OP_PARAM_ADD_U64) == 0) {
+        *(enum merge_op *)data = MERGE_OP_ADD_U64;
+    } else if (strcmp(value, MERGE_OP_PARAM_APPEND) == 0) {
+        *(enum merge_op *)data = MERGE_OP_APPEND;
+    } else {
+        log_err("Unknown merge operator: %s", value);
+        return false;
+    }
+
+    return true;
+}
+
+static const char *
+merge_op_name(enum merge_op op)
+{
+    switch (op) {
+    case MERGE_OP_NONE:
+        return MERGE_OP_PARAM_NONE;
+    case MERGE_OP_ADD_U64:
+        return MERGE_OP_PARAM_ADD_U64;
+    case MERGE_OP_APPEND:
+        return MERGE_OP_PARAM_APPEND;
+    }
+
+    abort();
+}
+
+static merr_t
+merge_op_stringify(
+    const struct param_spec * const ps,
+    const void * const value,
+    char * const buf,
+    const size_t buf_sz,
+    size_t * const needed_sz)
+{
+    int n;
+
+    INVARIANT(ps);
+    INVARIANT(value);
+    INVARIANT(buf);
+
+    n = snprintf(buf, buf_sz, "\"%s\"", merge_op_name(*(enum merge_op *)value));
+    if (n < 0)
+        return merr(EBADMSG);
+
+    if (needed_sz)
+        *needed_sz = n;
+
+    return 0;
+}
+
+static cJSON *
+merge_op_jsonify(const struct param_spec * const ps, const void * const value)
+{
+    INVARIANT(ps);
+    INVARIANT(value);
+
+    return cJSON_CreateString(merge_op_name(*(enum merge_op *)value));
+}
 
 static const struct param_spec pspecs[] = {
     {
@@ -56,6 +139,27 @@ static const struct param_spec pspecs[] = {
             },
         },
     },
+    {
+        .ps_name = "value.merge.operator",
+        .ps_description = "Merge operator for hse_kvs_merge() operands (none, add_u64, append)",
+        .ps_flags = PARAM_EXPERIMENTAL,
+        .ps_type = PARAM_TYPE_ENUM,
+        .ps_offset = offsetof(struct kvs_cparams, merge_op),
+        .ps_size = PARAM_SZ(struct kvs_cparams, merge_op),
+        .ps_convert = merge_op_converter,
+        .ps_validate = param_default_validator,
+        .ps_stringify = merge_op_stringify,
+        .ps_jsonify = merge_op_jsonify,
+        .ps_default_value = {
+            .as_enum = MERGE_OP_NONE,
+        },
+        .ps_bounds = {
+            .as_enum = {
+                .ps_min = MERGE_OP_MIN,
+                .ps_max = MERGE_OP_MAX,
+            },
+        },
+    },
 };
 
 const struct param_spec *
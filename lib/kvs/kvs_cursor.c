@@ -17,6 +17,7 @@
 #include <hse/ikvdb/kvs.h>
 #include <hse/ikvdb/lc.h>
 #include <hse/ikvdb/limits.h>
+#include <hse/ikvdb/rtomb.h>
 #include <hse/ikvdb/tuple.h>
 #include <hse/logging/logging.h>
 #include <hse/util/compression_lz4.h>
@@ -25,6 +26,7 @@
 #include <hse/util/keycmp.h>
 #include <hse/util/page.h>
 #include <hse/util/platform.h>
+#include <hse/util/rtrace.h>
 #include <hse/util/slab.h>
 #include <hse/util/vlb.h>
 
@@ -77,6 +79,12 @@ NE_CHECK(kvs_cd_perfc_op, PERFC_EN_CD, "cursor dist perfc ops table/enum mismatc
  * Cached cursors may be retired completely after aging sufficiently.
  * Retiring a cursor is simply destroying the underlying object.
  *
+ * Cached cursors are matched by kvs, direction and prefix length, but
+ * not by the prefix itself.  The c0, lc and cn cursors all reference
+ * the prefix stored in the kvs cursor, so a cached cursor is re-pointed
+ * to a new prefix of the same length by copying the prefix and going
+ * through the usual update path, which avoids a full cursor create.
+ *
  * The kvs_close path must release all cached cursors, but must
  * strip out the underlaying structures of active cursors, marking
  * the cursor with ESTALE.  This allows applications that have read
@@ -87,7 +95,7 @@ NE_CHECK(kvs_cd_perfc_op, PERFC_EN_CD, "cursor dist perfc ops table/enum mismatc
 /**
  * struct curcache_item - embedded in a cursor for cache management
  * @ci_ttl:   time (ns) beyond which cursor should be destroyed
- * @ci_key:   key that uniquely identifies the kvs and cursor type
+ * @ci_key:   key that identifies the kvs, direction and prefix length
  * @ci_next:  curcache_entry list linkage
  */
 struct curcache_item {
@@ -163,7 +171,9 @@ struct kvs_cursor_impl {
     void *             kci_limit;
 
     struct kvs_cursor_element  kci_elem_last;
+    struct kvset *             kci_zc_pin;
     struct kvs_cursor_element  kci_ptomb;
+    struct rtomb_vec           kci_rtombs;
     struct key_obj             kci_last_kobj;
     struct key_obj *           kci_last;
     uint8_t *                       kci_last_kbuf;
@@ -174,6 +184,7 @@ struct kvs_cursor_impl {
     uint32_t kci_need_seek : 1;
     uint32_t kci_reverse : 1;
     uint32_t kci_ptomb_set : 1;
+    uint32_t kci_zcopy : 1;
 
     uint32_t kci_pfxlen;
     merr_t kci_err; /* bad cursor, must destroy */
@@ -270,18 +281,15 @@ ikvs_curcache_idx2bktoff(uint idx)
     return offset;
 }
 
+/* Buckets are selected by the calling thread's current cpu so that
+ * threads which save and restore cursors concurrently rarely contend
+ * on the same bucket lock (a cursor may be restored on a different cpu
+ * than that on which it was saved).
+ */
 static HSE_ALWAYS_INLINE struct curcache_bucket *
-ikvs_curcache_td2bkt(void)
+ikvs_curcache_cpu2bkt(void)
 {
-    static thread_local size_t tls_offset;
-
-    if (HSE_UNLIKELY(!tls_offset)) {
-        static atomic_uint g_cc_idx;
-
-        tls_offset = ikvs_curcache_idx2bktoff(atomic_inc_return(&g_cc_idx));
-    }
-
-    return ikvs_curcachev + tls_offset;
+    return ikvs_curcachev + ikvs_curcache_idx2bktoff(hse_getcpu(NULL));
 }
 
 /**
@@ -390,26 +398,25 @@ ikvs_curcache_timer_cb(ulong arg)
 }
 
 /* ikvs_curcache_key() constructs a key for the cursor cache comparator
- * such that we can compare the kvs and distinguishing cursor attributes
- * in just one comparison.  This reduces the number of cursor objects
- * we have to touch while walking the tree.
+ * such that we can compare the kvs and all distinguishing cursor attributes
+ * in just one comparison.  This avoids touching the cursor objects at all
+ * while walking the tree.
  */
 static HSE_ALWAYS_INLINE uint64_t
-ikvs_curcache_key(const uint64_t gen, const bool reverse)
+ikvs_curcache_key(const uint64_t gen, const size_t pfxlen, const bool reverse)
 {
-    return (gen << 63) | reverse;
+    static_assert(HSE_KVS_KEY_LEN_MAX < (1u << 16), "pfxlen too large for curcache key");
+
+    return (gen << 17) | (pfxlen << 1) | reverse;
 }
 
 static HSE_ALWAYS_INLINE int
-ikvs_curcache_cmp(struct curcache_entry *entry, uint64_t key, const void *prefix, size_t pfxlen)
+ikvs_curcache_cmp(struct curcache_entry *entry, uint64_t key)
 {
     if (key != entry->ce_oldkey)
         return (key < entry->ce_oldkey) ? -1 : 1;
 
-    if (!prefix)
-        return 0;
-
-    return keycmp(prefix, pfxlen, entry->ce_list->kci_prefix, entry->ce_list->kci_pfxlen);
+    return 0;
 }
 
 static struct kvs_cursor_impl *
@@ -418,13 +425,9 @@ ikvs_curcache_insert(struct curcache_bucket *bkt, struct kvs_cursor_impl *cur)
     struct curcache_entry *entry;
     struct rb_node **link, *parent;
     uint64_t key;
-    size_t pfxlen;
-    void *prefix;
     int rc;
 
     key = cur->kci_item.ci_key;
-    prefix = cur->kci_prefix;
-    pfxlen = cur->kci_pfxlen;
 
     mutex_lock(&bkt->cb_lock);
     link = &bkt->cb_root.rb_node;
@@ -435,7 +438,7 @@ ikvs_curcache_insert(struct curcache_bucket *bkt, struct kvs_cursor_impl *cur)
         parent = *link;
         entry = rb_entry(parent, typeof(*entry), ce_rbnode);
 
-        rc = ikvs_curcache_cmp(entry, key, prefix, pfxlen);
+        rc = ikvs_curcache_cmp(entry, key);
 
         if (rc == 0)
             break;
@@ -506,7 +509,7 @@ ikvs_curcache_insert(struct curcache_bucket *bkt, struct kvs_cursor_impl *cur)
 }
 
 static struct kvs_cursor_impl *
-ikvs_curcache_remove(struct curcache_bucket *bkt, uint64_t key, const void *prefix, size_t pfx_len)
+ikvs_curcache_remove(struct curcache_bucket *bkt, uint64_t key)
 {
     struct kvs_cursor_impl *old;
     struct curcache_entry *entry;
@@ -521,7 +524,7 @@ ikvs_curcache_remove(struct curcache_bucket *bkt, uint64_t key, const void *pref
     while (node) {
         entry = rb_entry(node, typeof(*entry), ce_rbnode);
 
-        rc = ikvs_curcache_cmp(entry, key, prefix, pfx_len);
+        rc = ikvs_curcache_cmp(entry, key);
         if (rc < 0)
             node = node->rb_left;
         else if (rc > 0)
@@ -588,14 +591,27 @@ ikvs_cursor_restore(struct ikvs *kvs, const void *prefix, size_t pfx_len, bool r
 
     tstart = perfc_lat_startl(&kvs->ikv_cd_pc, PERFC_LT_CD_RESTORE);
 
-    key = ikvs_curcache_key(kvs->ikv_gen, reverse);
+    key = ikvs_curcache_key(kvs->ikv_gen, pfx_len, reverse);
 
-    cur = ikvs_curcache_remove(ikvs_curcache_td2bkt(), key, prefix, pfx_len);
+    cur = ikvs_curcache_remove(ikvs_curcache_cpu2bkt(), key);
     if (!cur) {
         PERFC_INC_RU(&kvs->ikv_cc_pc, PERFC_RA_CC_MISS);
         return NULL;
     }
 
+    /* Re-point the cursor to the new prefix.  The pad bytes of a reverse
+     * cursor's prefix buffer are already 0xff since the length is unchanged.
+     */
+    assert(cur->kci_pfxlen == pfx_len);
+    if (pfx_len > 0 && memcmp(cur->kci_prefix, prefix, pfx_len)) {
+        memcpy(cur->kci_prefix, prefix, pfx_len);
+
+        /* The cn cursor's root kvsets were pruned by the old prefix.
+         */
+        if (cur->kci_cncur)
+            cn_cursor_invalidate(cur->kci_cncur);
+    }
+
     perfc_lat_record(&kvs->ikv_cd_pc, PERFC_LT_CD_RESTORE, tstart);
     PERFC_INC_RU(&kvs->ikv_cc_pc, PERFC_RA_CC_HIT);
 
@@ -633,7 +649,7 @@ ikvs_cursor_save(struct kvs_cursor_impl *cur)
     tstart = perfc_lat_startl(&kvs->ikv_cd_pc, PERFC_LT_CD_SAVE);
 
     if (cur->kci_item.ci_ttl > jclock_ns)
-        cur = ikvs_curcache_insert(ikvs_curcache_td2bkt(), cur);
+        cur = ikvs_curcache_insert(ikvs_curcache_cpu2bkt(), cur);
 
     if (cur) {
         perfc_inc(&kvs->ikv_cc_pc, PERFC_RA_CC_SAVEFAIL);
@@ -668,7 +684,7 @@ kvs_cursor_alloc(struct ikvs *kvs, const void *prefix, size_t pfx_len, bool reve
 
     memset(cur, 0, sizeof(*cur));
 
-    cur->kci_item.ci_key = ikvs_curcache_key(kvs->ikv_gen, reverse);
+    cur->kci_item.ci_key = ikvs_curcache_key(kvs->ikv_gen, pfx_len, reverse);
     cur->kci_cc_pc = PERFC_ISON(&kvs->ikv_cc_pc) ? &kvs->ikv_cc_pc : NULL;
     cur->kci_cd_pc = PERFC_ISON(&kvs->ikv_cd_pc) ? &kvs->ikv_cd_pc : NULL;
     cur->kci_kvs = kvs;
@@ -686,6 +702,7 @@ kvs_cursor_alloc(struct ikvs *kvs, const void *prefix, size_t pfx_len, bool reve
     cur->kci_handle.kc_filter.kcf_maxkey = 0;
 
     cur->kci_reverse = reverse;
+    cur->kci_zcopy = kvs->ikv_rp.kvs_cursor_zcopy;
     ikvs_cursor_reset(cur);
 
     /* Pad with 0xff to make reverse cursor seek-to-pfx simple */
@@ -695,9 +712,26 @@ kvs_cursor_alloc(struct ikvs *kvs, const void *prefix, size_t pfx_len, bool reve
     return &cur->kci_handle;
 }
 
+/* In zero-copy mode the kvset backing the last element read from cn is
+ * pinned until the next read, seek, update or free of the cursor, so that
+ * the value pointer handed out by kvs_cursor_val_copy() remains valid even
+ * though the cn cursor has already advanced past that element.
+ */
+static void
+ikvs_cursor_zc_pin(struct kvs_cursor_impl *cur, const struct kvs_cursor_element *item)
+{
+    cn_cursor_elem_unpin(cur->kci_zc_pin);
+    cur->kci_zc_pin = NULL;
+
+    if (item && item->kce_source == KCE_SOURCE_CN)
+        cur->kci_zc_pin = cn_cursor_elem_pin(cur->kci_cncur);
+}
+
 void
 kvs_cursor_free(struct hse_kvs_cursor *cursor)
 {
+    ikvs_cursor_zc_pin(cursor_h2r(cursor), NULL);
+
     if (cursor->kc_err)
         kvs_cursor_destroy(cursor);
     else
@@ -786,6 +820,13 @@ kvs_cursor_init(struct hse_kvs_cursor *cursor, struct kvdb_ctxn *ctxn)
 
     assert(cur->kci_c0cur);
 
+    /* Range tombstones in cn are applied by the cn cursor, so only those
+     * from c0 need to be applied across all sources.
+     */
+    err = c0_cursor_rtombs(cur->kci_c0cur, &cur->kci_rtombs);
+    if (ev(err))
+        goto error;
+
     if (!cur->kci_lccur) {
         uint16_t skidx = c0_index(c0);
         int32_t tree_pfxlen = c0_get_pfx_len(c0);
@@ -865,6 +906,8 @@ kvs_cursor_destroy(struct hse_kvs_cursor *handle)
 {
     struct kvs_cursor_impl *cursor = (void *)handle;
 
+    ikvs_cursor_zc_pin(cursor, NULL);
+
     if (handle->kc_bind)
         kvdb_ctxn_cursor_unbind(handle->kc_bind);
     if (cursor->kci_c0cur)
@@ -877,6 +920,7 @@ kvs_cursor_destroy(struct hse_kvs_cursor *handle)
     if (cursor->kci_bh)
         bin_heap_destroy(cursor->kci_bh);
 
+    rtomb_vec_fini(&cursor->kci_rtombs);
     vlb_free(cursor, kvs_cursor_impl_alloc_sz);
 }
 
@@ -907,6 +951,8 @@ kvs_cursor_update(struct hse_kvs_cursor *handle, struct kvdb_ctxn *ctxn, uint64_
     if (bind)
         handle->kc_gen = atomic_read(&bind->b_gen);
 
+    ikvs_cursor_zc_pin(cursor, NULL);
+
     /* Copy out last key that was read */
     if (cursor->kci_last) {
         key_obj_copy(
@@ -928,6 +974,10 @@ kvs_cursor_update(struct hse_kvs_cursor *handle, struct kvdb_ctxn *ctxn, uint64_
     if (flags & CURSOR_FLAG_SEQNO_CHANGE)
         perfc_inc(cursor->kci_cc_pc, PERFC_BA_CC_UPDATED_C0);
 
+    cursor->kci_err = c0_cursor_rtombs(cursor->kci_c0cur, &cursor->kci_rtombs);
+    if (ev(cursor->kci_err))
+        return cursor->kci_err;
+
     /* Update lc cursor */
     cursor->kci_err =
         lc_cursor_update(cursor->kci_lccur, cursor->kci_last_kbuf, cursor->kci_last_klen, seqno);
@@ -1000,16 +1050,101 @@ ikvs_cursor_should_drop(struct kvs_cursor_element *item, struct kvs_cursor_eleme
     return true;
 }
 
+static bool
+ikvs_cursor_rtomb_hides(struct kvs_cursor_impl *cursor, struct kvs_cursor_element *item)
+{
+    char kbuf[HSE_KVS_KEY_LEN_MAX];
+    uint64_t seqno;
+    uint klen;
+
+    if (!cursor->kci_rtombs.rv_cnt)
+        return false;
+
+    /* Range deletes are not transactional, so they never hide txn data.
+     */
+    if (seqnoref_to_seqno(item->kce_seqnoref, &seqno) != HSE_SQNREF_STATE_DEFINED)
+        return false;
+
+    key_obj_copy(kbuf, sizeof(kbuf), &klen, &item->kce_kobj);
+
+    return rtomb_vec_lookup(&cursor->kci_rtombs, kbuf, klen, cursor->kci_handle.kc_seq) > seqno;
+}
+
+/* Resolve the merge operand at the cursor's current position by applying
+ * the key's operands in c0 to @base, the next older element of the key
+ * from the cursor's lc or cn source (NULL if there is none).  The result
+ * is left in the cursor's value buffer for kvs_cursor_val_copy().
+ */
+static merr_t
+ikvs_cursor_mopnd_resolve(struct kvs_cursor_impl *cursor, struct kvs_cursor_element *base)
+{
+    struct ikvs *kvs = cursor->kci_kvs;
+    uint8_t *data = cursor->kci_buf + HSE_KVS_KEY_LEN_MAX;
+    uint8_t kbuf[HSE_KVS_KEY_LEN_MAX];
+    enum key_lookup_res res;
+    const void *bdata = NULL;
+    struct kvs_ktuple kt;
+    struct kvs_buf vbuf;
+    uint32_t blen = 0;
+    uint klen;
+    merr_t err;
+
+    if (base && HSE_CORE_IS_TOMB(base->kce_vt.vt_data))
+        base = NULL;
+
+    if (base && cursor->kci_ptomb_set && ikvs_cursor_should_drop(base, &cursor->kci_ptomb))
+        base = NULL;
+
+    if (base && ikvs_cursor_rtomb_hides(cursor, base))
+        base = NULL;
+
+    if (base && base->kce_complen) {
+        uint outlen;
+
+        err = compress_lz4_ops.cop_decompress(
+            base->kce_vt.vt_data, base->kce_complen, data, HSE_KVS_VALUE_LEN_MAX, &outlen);
+        if (ev(err))
+            return err;
+
+        bdata = data;
+        blen = outlen;
+    } else if (base) {
+        bdata = base->kce_vt.vt_data;
+        blen = kvs_vtuple_vlen(&base->kce_vt);
+    }
+
+    key_obj_copy(kbuf, sizeof(kbuf), &klen, cursor->kci_last);
+    kvs_ktuple_init_nohash(&kt, kbuf, klen);
+    kt.kt_hash = key_hash64(kbuf, klen - kvs->ikv_rp.kvs_sfxlen);
+
+    kvs_buf_init(&vbuf, data, HSE_KVS_VALUE_LEN_MAX);
+
+    err = c0_get_merged_onto(
+        kvs->ikv_c0, &kt, cursor->kci_handle.kc_seq, bdata, blen, &res, &vbuf);
+    if (ev(err))
+        return err;
+
+    assert(res == FOUND_VAL);
+
+    kvs_vtuple_init(&cursor->kci_elem_last.kce_vt, data, vbuf.b_len);
+    cursor->kci_elem_last.kce_complen = 0;
+
+    return 0;
+}
+
 merr_t
 ikvs_cursor_replenish(struct kvs_cursor_impl *cursor)
 {
     bool is_ptomb, is_tomb;
     merr_t err = 0;
     struct kvs_cursor_element *item, *popme;
+    uint64_t rtstart;
 
     if (cursor->kci_eof)
         return 0;
 
+    rtstart = rtrace_span_start();
+
     do {
         cursor->kci_eof = !bin_heap_peek(cursor->kci_bh, (void **)&item);
 
@@ -1025,6 +1160,9 @@ ikvs_cursor_replenish(struct kvs_cursor_impl *cursor)
         is_ptomb = HSE_CORE_IS_PTOMB(item->kce_vt.vt_data);
 
         /* discard current kv-tuple */
+        if (cursor->kci_zcopy)
+            ikvs_cursor_zc_pin(cursor, item);
+
         bin_heap_pop(cursor->kci_bh, (void **)&popme);
 
         if (cursor->kci_ptomb_set) {
@@ -1041,21 +1179,44 @@ ikvs_cursor_replenish(struct kvs_cursor_impl *cursor)
             }
         }
 
+        if (!is_tomb && ikvs_cursor_rtomb_hides(cursor, &cursor->kci_elem_last))
+            is_tomb = true;
+
         if (is_ptomb) {
             cursor->kci_ptomb = cursor->kci_elem_last;
             cursor->kci_ptomb_set = 1;
         } else {
-            /* drop dups */
+            bool is_mopnd = cursor->kci_elem_last.kce_is_mopnd && !is_tomb;
+
+            /* drop dups, the newest of which is the base value of a
+             * merge operand
+             */
             while (bin_heap_peek(cursor->kci_bh, (void **)&item)) {
                 if (key_obj_cmp(&item->kce_kobj, cursor->kci_last))
                     break; /* not a dup */
 
+                if (is_mopnd) {
+                    err = ikvs_cursor_mopnd_resolve(cursor, item);
+                    if (ev(err))
+                        goto out;
+
+                    is_mopnd = false;
+                }
+
                 bin_heap_pop(cursor->kci_bh, (void **)&popme);
             }
+
+            if (is_mopnd) {
+                err = ikvs_cursor_mopnd_resolve(cursor, NULL);
+                if (ev(err))
+                    goto out;
+            }
         }
     } while (is_ptomb || is_tomb);
 
 out:
+    rtrace_span_record(RTRACE_EV_CURSOR_MERGE, rtstart);
+
     return err;
 }
 
@@ -1068,6 +1229,7 @@ ikvs_cursor_seek(struct kvs_cursor_impl *cursor, const void *key, size_t klen)
     int cnt;
 
     cursor->kci_eof = 0;
+    ikvs_cursor_zc_pin(cursor, NULL);
 
     err = c0_cursor_seek(cursor->kci_c0cur, key, klen, filt);
     if (ev(err))
@@ -1128,6 +1290,31 @@ kvs_cursor_key_copy(
         *key_out = key;
 }
 
+/* The value of a merge operand was resolved by ikvs_cursor_replenish()
+ * into the cursor's value buffer.
+ */
+static merr_t
+kvs_cursor_val_merged(
+    struct kvs_cursor_impl *cur,
+    void *buf,
+    size_t bufsz,
+    const void **val_out,
+    size_t *vlen_out)
+{
+    struct kvs_vtuple *vt = &cur->kci_elem_last.kce_vt;
+
+    if (buf)
+        memcpy(buf, vt->vt_data, min_t(uint64_t, kvs_vtuple_vlen(vt), bufsz));
+
+    if (val_out)
+        *val_out = buf ? buf : vt->vt_data;
+
+    if (vlen_out)
+        *vlen_out = kvs_vtuple_vlen(vt);
+
+    return 0;
+}
+
 merr_t
 kvs_cursor_val_copy(
     struct hse_kvs_cursor *cursor,
@@ -1146,6 +1333,9 @@ kvs_cursor_val_copy(
 
     cur = cursor_h2r(cursor);
 
+    if (cur->kci_elem_last.kce_is_mopnd)
+        return kvs_cursor_val_merged(cur, buf, bufsz, val_out, vlen_out);
+
     vt = &cur->kci_elem_last.kce_vt;
     clen = cur->kci_elem_last.kce_complen;
 
@@ -1153,6 +1343,14 @@ kvs_cursor_val_copy(
         goto out;
 
     if (!buf) {
+        /* Uncompressed cn values are returned in place, c0/lc values and
+         * compressed values are still copied out.
+         */
+        if (cur->kci_zc_pin && !clen && cur->kci_elem_last.kce_source == KCE_SOURCE_CN) {
+            *val_out = vt->vt_data;
+            goto out;
+        }
+
         buf = cur->kci_buf + HSE_KVS_KEY_LEN_MAX;
         bufsz = HSE_KVS_VALUE_LEN_MAX;
     }
@@ -1192,9 +1390,12 @@ kvs_cursor_read(struct hse_kvs_cursor *handle, unsigned int flags, bool *eofp)
     if (cursor->kci_need_seek) {
         struct kvs_ktuple key = { 0 };
         bool toss = cursor->kci_need_toss;
+        uint64_t rtstart;
 
+        rtstart = rtrace_span_start();
         cursor->kci_err = kvs_cursor_seek(
             &cursor->kci_handle, cursor->kci_last_kbuf, cursor->kci_last_klen, 0, 0, &key);
+        rtrace_span_record(RTRACE_EV_CURSOR_SEEK, rtstart);
 
         if (ev(cursor->kci_err))
             return cursor->kci_err;
@@ -137,6 +137,21 @@ static const struct param_spec pspecs[] = {
             },
         },
     },
+    {
+        .ps_name = "kvs_cursor_zcopy",
+        .ps_description = "return uncompressed cn values from cursors without copying",
+        .ps_flags = PARAM_EXPERIMENTAL,
+        .ps_type = PARAM_TYPE_BOOL,
+        .ps_offset = offsetof(struct kvs_rparams, kvs_cursor_zcopy),
+        .ps_size = PARAM_SZ(struct kvs_rparams, kvs_cursor_zcopy),
+        .ps_convert = param_default_converter,
+        .ps_validate = param_default_validator,
+        .ps_stringify = param_default_stringify,
+        .ps_jsonify = param_default_jsonify,
+        .ps_default_value = {
+            .as_uscalar = false,
+        },
+    },
     {
         .ps_name = "kvs_sfx_len",
         .ps_description = "Suffix length (used by prefix probe)",
@@ -648,6 +663,21 @@ static const struct param_spec pspecs[] = {
             },
         },
     },
+    {
+        .ps_name = "cn_open_snapshot",
+        .ps_description = "persist kblock descriptors in the cndb to speed up kvs open",
+        .ps_flags = PARAM_EXPERIMENTAL,
+        .ps_type = PARAM_TYPE_BOOL,
+        .ps_offset = offsetof(struct kvs_rparams, cn_open_snapshot),
+        .ps_size = PARAM_SZ(struct kvs_rparams, cn_open_snapshot),
+        .ps_convert = param_default_converter,
+        .ps_validate = param_default_validator,
+        .ps_stringify = param_default_stringify,
+        .ps_jsonify = param_default_jsonify,
+        .ps_default_value = {
+            .as_uscalar = false,
+        },
+    },
     {
         .ps_name = "capped_evict_ttl",
         .ps_description = "",
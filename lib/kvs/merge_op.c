@@ -0,0 +1,103 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <hse/limits.h>
+
+#include <hse/ikvdb/merge_op.h>
+#include <hse/util/assert.h>
+#include <hse/util/event_counter.h>
+#include <hse/util/minmax.h>
+
+merr_t
+merge_op_validate(enum merge_op op, const void *opnd, uint32_t len)
+{
+    switch (op) {
+    case MERGE_OP_NONE:
+        return merr(ENOTSUP);
+
+    case MERGE_OP_ADD_U64:
+        if (ev(!opnd || len != sizeof(uint64_t)))
+            return merr(EINVAL);
+        break;
+
+    case MERGE_OP_APPEND:
+        if (ev(len > 0 && !opnd))
+            return merr(EINVAL);
+        break;
+    }
+
+    return 0;
+}
+
+uint32_t
+merge_op_result_len(enum merge_op op, uint32_t acc_len, uint32_t len)
+{
+    uint64_t sum;
+
+    switch (op) {
+    case MERGE_OP_NONE:
+        return len;
+
+    case MERGE_OP_ADD_U64:
+        return sizeof(uint64_t);
+
+    case MERGE_OP_APPEND:
+        break;
+    }
+
+    sum = (uint64_t)acc_len + len;
+
+    return min_t(uint64_t, sum, HSE_KVS_VALUE_LEN_MAX);
+}
+
+void
+merge_op_apply(
+    enum merge_op op,
+    void *acc,
+    uint32_t acc_sz,
+    uint32_t *acc_len,
+    const void *opnd,
+    uint32_t len)
+{
+    uint64_t sum, addend;
+
+    INVARIANT(acc_len);
+    INVARIANT(*acc_len <= acc_sz);
+
+    switch (op) {
+    case MERGE_OP_NONE:
+        /* Operands written before the operator was disabled behave as puts.
+         */
+        len = min_t(uint32_t, len, acc_sz);
+        memcpy(acc, opnd, len);
+        *acc_len = len;
+        break;
+
+    case MERGE_OP_ADD_U64:
+        assert(acc_sz >= sizeof(sum));
+
+        sum = 0;
+        if (*acc_len == sizeof(sum))
+            memcpy(&sum, acc, sizeof(sum));
+
+        addend = 0;
+        if (len == sizeof(addend))
+            memcpy(&addend, opnd, sizeof(addend));
+
+        sum += addend;
+        memcpy(acc, &sum, sizeof(sum));
+        *acc_len = sizeof(sum);
+        break;
+
+    case MERGE_OP_APPEND:
+        len = min_t(uint32_t, len, acc_sz - *acc_len);
+        memcpy((char *)acc + *acc_len, opnd, len);
+        *acc_len += len;
+        break;
+    }
+}
@@ -0,0 +1,102 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <stdlib.h>
+
+#include <hse/ikvdb/rtomb.h>
+#include <hse/util/assert.h>
+#include <hse/util/event_counter.h>
+
+uint64_t
+rtomb_lookup(
+    const struct rtomb *rtv,
+    uint32_t cnt,
+    const void *key,
+    uint32_t klen,
+    uint64_t view_seq)
+{
+    uint64_t seq = 0;
+
+    /* Range tombstones are expected to be few and coarse, so a linear
+     * scan that stops at the first start key beyond the target suffices.
+     */
+    for (uint32_t i = 0; i < cnt; i++) {
+        const struct rtomb *rt = rtv + i;
+
+        if (keycmp(rt->rt_start, rt->rt_slen, key, klen) > 0)
+            break;
+
+        if (rt->rt_seqno <= view_seq && rt->rt_seqno > seq &&
+            keycmp(key, klen, rt->rt_end, rt->rt_elen) < 0)
+            seq = rt->rt_seqno;
+    }
+
+    return seq;
+}
+
+void
+rtomb_vec_init(struct rtomb_vec *rv)
+{
+    rv->rv_rtv = NULL;
+    rv->rv_cnt = 0;
+    rv->rv_max = 0;
+    rv->rv_sorted = true;
+}
+
+void
+rtomb_vec_fini(struct rtomb_vec *rv)
+{
+    free(rv->rv_rtv);
+    rtomb_vec_init(rv);
+}
+
+merr_t
+rtomb_vec_add(struct rtomb_vec *rv, const struct rtomb *rt)
+{
+    if (rv->rv_cnt == rv->rv_max) {
+        uint32_t max = rv->rv_max ? rv->rv_max * 2 : 16;
+        struct rtomb *rtv;
+
+        rtv = realloc(rv->rv_rtv, max * sizeof(*rtv));
+        if (ev(!rtv))
+            return merr(ENOMEM);
+
+        rv->rv_rtv = rtv;
+        rv->rv_max = max;
+    }
+
+    if (rv->rv_cnt > 0) {
+        const struct rtomb *last = rv->rv_rtv + rv->rv_cnt - 1;
+
+        if (keycmp(last->rt_start, last->rt_slen, rt->rt_start, rt->rt_slen) > 0)
+            rv->rv_sorted = false;
+    }
+
+    rv->rv_rtv[rv->rv_cnt++] = *rt;
+
+    return 0;
+}
+
+static int
+rtomb_cmp(const void *lhs, const void *rhs)
+{
+    const struct rtomb *a = lhs, *b = rhs;
+    int rc;
+
+    rc = keycmp(a->rt_start, a->rt_slen, b->rt_start, b->rt_slen);
+    if (rc)
+        return rc;
+
+    return (a->rt_seqno < b->rt_seqno) - (a->rt_seqno > b->rt_seqno);
+}
+
+void
+rtomb_vec_sort(struct rtomb_vec *rv)
+{
+    if (!rv->rv_sorted) {
+        qsort(rv->rv_rtv, rv->rv_cnt, sizeof(*rv->rv_rtv), rtomb_cmp);
+        rv->rv_sorted = true;
+    }
+}
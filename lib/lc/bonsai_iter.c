@@ -166,6 +166,7 @@ bonsai_iter_next(struct element_source *es, void **element)
     elem->kce_seqnoref = val->bv_seqnoref;
     elem->kce_complen = bonsai_val_clen(val);
     elem->kce_is_ptomb = iter->bi_is_ptomb;
+    elem->kce_is_mopnd = false; /* lc never holds merge operands */
 
     *element = &iter->bi_elem;
 
@@ -25,6 +25,15 @@
  *
  * All queries - point gets, prefix probe and cursors - will have to look at LC as well.
  *
+ * Memory Bound
+ * ------------
+ * LC accounts the memory held by its keys and values.  Once an ingest publishes its seqno and
+ * LC is above its bound (lc_mem_max_mb), the garbage collector is run right away rather than
+ * at its next interval, to drop entries that have already reached cn.  Committed entries that
+ * wait in LC only because their txn also has entries in a newer KVMS are spilled to cn by the
+ * ingest worker, which queues that KVMS for ingest early (see c0sk_ingest_worker()).  Entries
+ * of txns that are still active can't go to cn and are never dropped.
+ *
  * Definitions
  * -----------
  * LC horizon: The oldest seqno that is safe to be deleted.
@@ -136,6 +145,9 @@ struct lc_gc {
  * @lc_gc:            lc's garbage collector
  * @lc_ib_rmlock:     reader/writer lock for the ingest batch list
  * @lc_ib_head:       ingest batch list
+ * @lc_kvs_keyc:      number of keys held per kvs (skidx), across all bonsai trees
+ * @lc_mem_bytes:     bytes held by keys and values in the bonsai trees
+ * @lc_mem_max:       bound on lc_mem_bytes beyond which LC is trimmed eagerly (0 = unbounded)
  */
 struct lc_impl {
     struct lc lc_handle;
@@ -154,11 +166,18 @@ struct lc_impl {
     struct rmlock lc_ib_rmlock;
     struct ingest_batch *lc_ib_head;
     atomic_int lc_ib_len;
+
+    atomic_int lc_kvs_keyc[HSE_KVS_COUNT_MAX];
+    atomic_ulong lc_mem_bytes;
+    size_t lc_mem_max;
 };
 
 #define lc_h2r(HANDLE) container_of(HANDLE, struct lc_impl, lc_handle)
 #define lc_r2h(REAL)   (&(REAL)->lc_handle)
 
+static void
+lc_gc_worker_kick(struct lc_impl *self);
+
 void
 lc_ingest_seqno_set(struct lc *handle, uint64_t seq)
 {
@@ -184,6 +203,29 @@ lc_ingest_seqno_set(struct lc *handle, uint64_t seq)
     rmlock_wunlock(&self->lc_ib_rmlock);
 
     atomic_inc(&self->lc_ib_len);
+
+    /* The new horizon may let GC drop what this ingest moved to cn. */
+    if (lc_mem_exceeded(handle))
+        lc_gc_worker_kick(self);
+}
+
+bool
+lc_mem_exceeded(struct lc *handle)
+{
+    struct lc_impl *self;
+
+    if (!handle)
+        return false;
+
+    self = lc_h2r(handle);
+
+    return self->lc_mem_max && atomic_read(&self->lc_mem_bytes) > self->lc_mem_max;
+}
+
+size_t
+lc_mem_used(struct lc *handle)
+{
+    return handle ? atomic_read(&lc_h2r(handle)->lc_mem_bytes) : 0;
 }
 
 static uint64_t
@@ -251,6 +293,18 @@ lc_horizon_deregister(void *cookie)
     atomic_dec(&ib->ib_refcnt);
 }
 
+static HSE_ALWAYS_INLINE size_t
+lc_val_footprint(const struct bonsai_val *val)
+{
+    return sizeof(*val) + bonsai_val_vlen(val);
+}
+
+static HSE_ALWAYS_INLINE size_t
+lc_kv_footprint(const struct bonsai_kv *kv)
+{
+    return sizeof(*kv) + key_imm_klen(&kv->bkv_key_imm);
+}
+
 /* [HSE_REVISIT] This is almost identical to c0kvs_ior_cb(). Consider unifying the two.
  */
 static void
@@ -262,6 +316,7 @@ lc_ior_cb(
     struct bonsai_val **old_val,
     uint height)
 {
+    struct lc_impl *self = cli_rock;
     struct bonsai_val *old;
     struct bonsai_val **prevp;
     enum hse_seqno_state state HSE_MAYBE_UNUSED;
@@ -276,7 +331,11 @@ lc_ior_cb(
 
         assert(new_val == NULL);
 
+        atomic_inc(&self->lc_kvs_keyc[key_immediate_index(&kv->bkv_key_imm)]);
+
         val = rcu_dereference(kv->bkv_values);
+        atomic_add(&self->lc_mem_bytes, lc_kv_footprint(kv) + lc_val_footprint(val));
+
         if (HSE_CORE_IS_PTOMB(val->bv_value))
             kv->bkv_flags |= BKV_FLAG_PTOMB;
 
@@ -330,10 +389,13 @@ lc_ior_cb(
         old = rcu_dereference(old->bv_next);
     }
 
+    atomic_add(&self->lc_mem_bytes, lc_val_footprint(new_val));
+
     if (IS_IOR_REP(*code)) {
         /* in this case we'll just replace the old list element */
         new_val->bv_next = rcu_dereference(old->bv_next);
         *old_val = old;
+        atomic_sub(&self->lc_mem_bytes, lc_val_footprint(old));
     } else if (HSE_SQNREF_ORDNL_P(seqnoref)) {
         /* slot the new element just in front of the next older one */
         new_val->bv_next = old;
@@ -361,7 +423,7 @@ static void
 lc_gc_worker_start(struct lc_impl *self);
 
 merr_t
-lc_create(struct lc **handle, struct kvdb_health *health)
+lc_create(struct lc **handle, size_t mem_max, struct kvdb_health *health)
 {
     struct lc_impl *self;
     struct lc_gc *gc;
@@ -378,7 +440,7 @@ lc_create(struct lc **handle, struct kvdb_health *health)
     assert(self->lc_nsrc <= LC_SOURCE_CNT_MAX);
 
     for (i = 0; i < self->lc_nsrc; i++) {
-        err = bn_create(NULL, lc_ior_cb, NULL, &self->lc_broot[i]);
+        err = bn_create(NULL, lc_ior_cb, self, &self->lc_broot[i]);
         if (ev(err))
             goto err_exit;
     }
@@ -399,6 +461,7 @@ lc_create(struct lc **handle, struct kvdb_health *health)
     }
 
     self->lc_health = health;
+    self->lc_mem_max = mem_max;
 
     atomic_set(&self->lc_closing, 0);
     rmlock_init(&self->lc_ib_rmlock);
@@ -552,6 +615,18 @@ lc_builder_finish(struct lc_builder *lcb)
     return err;
 }
 
+/* Only kvses that take part in transactions which span ingests, or whose
+ * entries fall outside an ingest's view, ever have keys in LC.  Queries on
+ * all other kvses skip the bonsai tree searches entirely.
+ */
+static HSE_ALWAYS_INLINE bool
+lc_kvs_empty(struct lc_impl *self, uint16_t skidx)
+{
+    assert(skidx < NELEM(self->lc_kvs_keyc));
+
+    return !atomic_read(&self->lc_kvs_keyc[skidx]);
+}
+
 static void
 lc_get_pfx(
     struct lc_impl *self,
@@ -690,6 +765,11 @@ lc_get(
 
     self = lc_h2r(handle);
 
+    if (lc_kvs_empty(self, skidx)) {
+        *res = NOT_FOUND;
+        return 0;
+    }
+
     bn_skey_init(kt->kt_data, kt->kt_len, 0, skidx, &skey);
     val_seq = pt_seq = 0;
 
@@ -756,6 +836,9 @@ lc_pfx_probe(
 
     *res = NOT_FOUND;
 
+    if (lc_kvs_empty(self, skidx))
+        return 0;
+
     rcu_read_lock();
     if (pfxlen && pfxlen <= kt->kt_len) {
         struct bonsai_skey pfx_skey;
@@ -1183,6 +1266,7 @@ lc_gc_worker(struct work_struct *work)
     struct lc_impl *lc = container_of(gc, struct lc_impl, lc_gc);
     int i;
     uint64_t horizon_incl;
+    size_t freed = 0;
 
     if (HSE_UNLIKELY(atomic_read(&lc->lc_closing)))
         goto exit;
@@ -1255,6 +1339,7 @@ lc_gc_worker(struct work_struct *work)
                 /* Mark value for deletion */
                 deleted = true;
                 bkv->bkv_valcnt--;
+                freed += lc_val_footprint(val);
                 bn_val_rcufree(bkv, val);
             }
 
@@ -1272,6 +1357,9 @@ lc_gc_worker(struct work_struct *work)
                     log_errx("failed to delete bonsai node", lc->lc_err);
                     goto health_err;
                 }
+
+                atomic_dec(&lc->lc_kvs_keyc[skidx]);
+                freed += lc_kv_footprint(bkv);
             }
         }
     }
@@ -1280,6 +1368,8 @@ health_err:
     rcu_read_unlock();
     lc_wunlock(lc);
 
+    atomic_sub(&lc->lc_mem_bytes, freed);
+
     synchronize_rcu();
     c0snr_droprefv(gc->lgc_c0snr_cnt, gc->lgc_c0snr_refv);
 
@@ -1299,6 +1389,21 @@ lc_gc_worker_start(struct lc_impl *self)
     queue_delayed_work(self->lc_gc_wq, &gc->lgc_dwork, msecs_to_jiffies(self->lc_gc_delay_ms));
 }
 
+/* Run GC now instead of at its next interval.  If GC is running it requeues
+ * itself and picks up the new horizon on its next pass.
+ */
+static void
+lc_gc_worker_kick(struct lc_impl *self)
+{
+    struct lc_gc *gc = &self->lc_gc;
+
+    if (atomic_read(&self->lc_closing))
+        return;
+
+    if (cancel_delayed_work(&gc->lgc_dwork))
+        queue_delayed_work(self->lc_gc_wq, &gc->lgc_dwork, 0);
+}
+
 /* Init/Fini */
 merr_t
 lc_init(void)
@@ -294,6 +294,35 @@ mpool_mdc_read(struct mpool_mdc *mdc, void *data, size_t len, size_t *rdlen);
 /* MTF_MOCK */
 merr_t
 mpool_mdc_append(struct mpool_mdc *mdc, void *data, size_t len, bool sync);
+
+/**
+ * mpool_mdc_append_async() - append record to MDC without syncing it
+ *
+ * @mdc:  MDC handle
+ * @data: data to write
+ * @len:  length of data
+ * @gen:  ticket identifying the record for mpool_mdc_sync_wait() (output)
+ *
+ * Lets callers append under their own locks and wait for durability after
+ * dropping them, so that concurrent committers share a single sync.
+ */
+/* MTF_MOCK */
+merr_t
+mpool_mdc_append_async(struct mpool_mdc *mdc, void *data, size_t len, uint64_t *gen);
+
+/**
+ * mpool_mdc_sync_wait() - Wait until a record appended to MDC is durable
+ *
+ * @mdc: MDC handle
+ * @gen: ticket returned by mpool_mdc_append_async()
+ *
+ * Syncs all records appended so far, unless a concurrent caller already
+ * synced the record identified by @gen.
+ */
+/* MTF_MOCK */
+merr_t
+mpool_mdc_sync_wait(struct mpool_mdc *mdc, uint64_t gen);
+
 /**
  * mpool_mdc_cstart() - Initiate MDC compaction
  *
@@ -312,6 +341,42 @@ mpool_mdc_cstart(struct mpool_mdc *mdc);
 merr_t
 mpool_mdc_cend(struct mpool_mdc *mdc);
 
+/**
+ * mpool_mdc_cstart_bg() - Initiate MDC compaction concurrent with appends
+ *
+ * @mdc: MDC handle
+ * @img: handle to which the compacted image is appended (output)
+ *
+ * Records appended to @img are held in memory.  The active log stays active
+ * until mpool_mdc_cend_bg(), and records appended to @mdc in the meantime
+ * are retained and appended after the image.
+ */
+/* MTF_MOCK */
+merr_t
+mpool_mdc_cstart_bg(struct mpool_mdc *mdc, struct mpool_mdc **img);
+
+/**
+ * mpool_mdc_cend_bg() - End MDC compaction started by mpool_mdc_cstart_bg()
+ *
+ * @mdc: MDC handle
+ *
+ * Writes and syncs the image without blocking appenders, then appends the
+ * retained records and makes the compacted log active.  On failure the
+ * active log is left unchanged.  The image handle is freed in either case.
+ */
+/* MTF_MOCK */
+merr_t
+mpool_mdc_cend_bg(struct mpool_mdc *mdc);
+
+/**
+ * mpool_mdc_cabort() - Abandon MDC compaction started by mpool_mdc_cstart_bg()
+ *
+ * @mdc: MDC handle
+ */
+/* MTF_MOCK */
+void
+mpool_mdc_cabort(struct mpool_mdc *mdc);
+
 /**
  * mpool_mdc_sync() - Sync the specified MDC
  *
@@ -452,6 +517,24 @@ mpool_mblock_read(struct mpool *mp, uint64_t mbid, const struct iovec *iov, int
 merr_t
 mpool_mblock_clone(struct mpool *mp, uint64_t mbid, off_t off, size_t len, uint64_t *mbid_out);
 
+/**
+ * mpool_mblock_copy() - copy the specified mblock into a media class
+ *
+ * @mp:       mpool
+ * @mbid:     mblock object ID to copy from
+ * @mclass:   media class of the target mblock
+ * @mbid_out: target mblock id (output)
+ *
+ * The target mblock is uncommitted and has the same write length as the source.
+ * The copy is made with copy_file_range() (and hence may share extents with the
+ * source) if the media classes reside on the same file system.
+ *
+ * Return: %0 on success, <%0 on error
+ */
+/* MTF_MOCK */
+merr_t
+mpool_mblock_copy(struct mpool *mp, uint64_t mbid, enum hse_mclass mclass, uint64_t *mbid_out);
+
 /**
  * mpool_mblock_punch() - Punch a hole into the specified region of a committed mblock
  *
@@ -21,6 +21,9 @@
 #error "Neither __IOV_MAX nor IOV_MAX is defined"
 #endif
 
+#include <stdlib.h>
+#include <unistd.h>
+
 #include <sys/mman.h>
 
 #include <hse/util/assert.h>
@@ -29,6 +32,7 @@
 #include <hse/util/page.h>
 
 #include "io.h"
+#include "mpool_sys.h"
 
 static size_t
 iolen(const struct iovec *iov, int cnt)
@@ -167,16 +171,65 @@ io_sync_msync(void *addr, size_t len, int flags)
     return (rc == -1) ? merr(errno) : 0;
 }
 
+/* Bounce-buffer copy for when copy_file_range() cannot be used, e.g., between
+ * media classes that reside on different file systems.
+ */
+static merr_t
+io_sync_copy(int src_fd, off_t src_off, int tgt_fd, off_t tgt_off, size_t len)
+{
+    const size_t bufsz = 1024 * 1024;
+    merr_t err = 0;
+    void *buf;
+
+    buf = aligned_alloc(PAGE_SIZE, bufsz);
+    if (ev(!buf))
+        return merr(ENOMEM);
+
+    while (len > 0) {
+        size_t chunk = min_t(size_t, len, bufsz);
+        ssize_t cc;
+
+        cc = pread(src_fd, buf, chunk, src_off);
+        if (cc != chunk) {
+            err = merr(cc == -1 ? errno : EIO);
+            break;
+        }
+
+        cc = pwrite(tgt_fd, buf, chunk, tgt_off);
+        if (cc != chunk) {
+            err = merr(cc == -1 ? errno : EIO);
+            break;
+        }
+
+        src_off += chunk;
+        tgt_off += chunk;
+        len -= chunk;
+    }
+
+    free(buf);
+
+    return err;
+}
+
 merr_t
 io_sync_clone(int src_fd, off_t src_off, int tgt_fd, off_t tgt_off, size_t len, int flags)
 {
     size_t left = len, cc;
     off_t cur_soff = src_off, cur_toff = tgt_off;
+    merr_t err;
 
     do {
-        cc = copy_file_range(src_fd, &cur_soff, tgt_fd, &cur_toff, len, 0);
-        if (cc == -1)
-            return merr(errno);
+        err = mpool_sys_copy_file_range(src_fd, &cur_soff, tgt_fd, &cur_toff, left, &cc);
+        if (err) {
+            const int errnum = merr_errno(err);
+
+            /* Older kernels refuse cross file system copies.
+             */
+            if (left == len && (errnum == EXDEV || errnum == EOPNOTSUPP || errnum == EINVAL))
+                return io_sync_copy(src_fd, src_off, tgt_fd, tgt_off, len);
+
+            return err;
+        }
 
         left -= cc;
 
@@ -5,6 +5,7 @@
 
 #include <hse/logging/logging.h>
 #include <hse/util/event_counter.h>
+#include <hse/util/rtrace.h>
 
 #include "mblock_file.h"
 #include "mblock_fset.h"
@@ -126,6 +127,8 @@ mpool_mblock_read(struct mpool *mp, uint64_t mbid, const struct iovec *iov, int
 {
     struct media_class *mc;
     enum hse_mclass mclass;
+    uint64_t rtstart;
+    merr_t err;
 
     if (!mp || !iov)
         return merr(EINVAL);
@@ -135,7 +138,11 @@ mpool_mblock_read(struct mpool *mp, uint64_t mbid, const struct iovec *iov, int
     if (!mc)
         return merr(ENOENT);
 
-    return mblock_fset_read(mclass_fset(mc), mbid, iov, iovc, off);
+    rtstart = rtrace_span_start();
+    err = mblock_fset_read(mclass_fset(mc), mbid, iov, iovc, off);
+    rtrace_span_record(RTRACE_EV_MBREAD, rtstart);
+
+    return err;
 }
 
 merr_t
@@ -168,6 +175,22 @@ mpool_mblock_clone(struct mpool *mp, uint64_t mbid, off_t off, size_t len, uint6
     return mblock_fset_clone(mclass_fset(mc), mbid, off, len, mbid_out);
 }
 
+merr_t
+mpool_mblock_copy(struct mpool *mp, uint64_t mbid, enum hse_mclass mclass, uint64_t *mbid_out)
+{
+    struct media_class *src, *tgt;
+
+    if (!mp || !mbid_out || mclass >= HSE_MCLASS_COUNT)
+        return merr(EINVAL);
+
+    src = mpool_mclass_handle(mp, mcid_to_mclass(mclassid(mbid)));
+    tgt = mpool_mclass_handle(mp, mclass);
+    if (!src || !tgt)
+        return merr(ENOENT);
+
+    return mblock_fset_copy(mclass_fset(src), mclass_fset(tgt), mbid, mbid_out);
+}
+
 merr_t
 mpool_mblock_mmap(struct mpool *mp, uint64_t mbid, const void **addr_out)
 {
@@ -6,6 +6,7 @@
 #include <ftw.h>
 
 #include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <hse/logging/logging.h>
 #include <hse/util/assert.h>
@@ -20,6 +21,7 @@
 #include "io.h"
 #include "mblock_file.h"
 #include "mclass.h"
+#include "mpool_sys.h"
 #include "omf.h"
 
 /* clang-format off */
@@ -27,18 +29,35 @@
 #define MBLOCK_FILE_META_HDRLEN    (4096)
 #define MBLOCK_FILE_UNIQ_DELTA     (1024)
 #define MBLOCK_MMAP_CHUNK_MAX      (1024)
+#define MBLOCK_WLEN_STRIPES_MAX    (128)
 
 /**
  * struct mblock_rgnmap -
  *
- * @rm_lock: lock protecting the region map
- * @rm_root: root of the region map rbtree
+ * @rm_lock:   lock protecting the region map
+ * @rm_root:   root of the region map rbtree
+ * @rm_keymax: largest valid key
+ * @rm_bmap:   bitmap of allocated keys, indexed by (key - 1)
+ *
+ * The rbtree tracks free regions for allocation, while the bitmap mirrors
+ * it to give mblock_rgn_find() a lock-free lookup.  The bitmap is modified
+ * only under rm_lock.
  */
 struct mblock_rgnmap {
     struct mutex   rm_lock HSE_ACP_ALIGNED;
     struct rb_root rm_root;
 
     struct kmem_cache *rm_cache HSE_L1D_ALIGNED;
+    uint32_t           rm_keymax;
+    atomic_ulong      *rm_bmap;
+};
+
+/**
+ * struct mblock_wlen_stripe - one cache line of the striped write length
+ * @ws_wlen: bytes written (or deleted, if negative) via this stripe
+ */
+struct mblock_wlen_stripe {
+    atomic_long ws_wlen HSE_L1D_ALIGNED;
 };
 
 /**
@@ -65,6 +84,7 @@ struct mblock_mmap {
  * @mcid:     media class id of this mblock file
  * @fileid:   mblock file identifier
  * @fd:       file descriptor
+ * @raw:      data file is a raw block device
  *
  * @wlenv:    vector of write lengths, one slot for each mblock
  *
@@ -78,7 +98,8 @@ struct mblock_mmap {
  * @mmapc:     number of mapped chunks
  * @mmapv:     vector of mapped chunks
  *
- * @wlen:      total write length for this file
+ * @wlenv_pc:  total write length for this file, striped by cpu
+ * @wlenc_pc:  number of stripes in wlenv_pc, one per cpu up to a max
  * @mbcnt:     count of allocated mblocks
  */
 struct mblock_file {
@@ -93,6 +114,7 @@ struct mblock_file {
     enum mclass_id mcid;
     int            fileid;
     int            fd;
+    bool           raw;
 
     atomic_uint_least32_t *wlenv;
 
@@ -107,8 +129,9 @@ struct mblock_file {
     int                 mmapc;
     struct mblock_mmap *mmapv;
 
-    atomic_long wlen HSE_L1D_ALIGNED;
-    atomic_int  mbcnt;
+    struct mblock_wlen_stripe *wlenv_pc HSE_L1D_ALIGNED;
+    uint                       wlenc_pc;
+    atomic_int                 mbcnt HSE_L1D_ALIGNED;
 };
 
 /* clang-format on */
@@ -123,10 +146,50 @@ mblock_mmap_cshift(size_t mblocksz);
 static merr_t
 mblock_file_insert(struct mblock_file *mbfp, uint64_t mbid);
 
+/* The file write length is striped by cpu to keep concurrent writers
+ * from contending on a single cache line.  There is a stripe per cpu (up
+ * to MBLOCK_WLEN_STRIPES_MAX), as writes to a file come from any cpu.
+ */
+static HSE_ALWAYS_INLINE void
+mblock_file_wlen_add(struct mblock_file *mbfp, long len)
+{
+    atomic_add(&mbfp->wlenv_pc[hse_getcpu(NULL) % mbfp->wlenc_pc].ws_wlen, len);
+}
+
+static long
+mblock_file_wlen_sum(const struct mblock_file *mbfp)
+{
+    long sum = 0;
+
+    for (uint i = 0; i < mbfp->wlenc_pc; i++)
+        sum += atomic_read(&mbfp->wlenv_pc[i].ws_wlen);
+
+    return sum;
+}
+
 /**
  * Region map interfaces.
  */
 
+static HSE_ALWAYS_INLINE size_t
+mblock_rgn_bmapc(uint32_t keymax)
+{
+    return (keymax + 63) / 64;
+}
+
+static HSE_ALWAYS_INLINE void
+mblock_rgn_bmap_update(struct mblock_rgnmap *rgnmap, uint32_t key, bool allocated)
+{
+    atomic_ulong *word = rgnmap->rm_bmap + (key - 1) / 64;
+    const ulong mask = 1UL << ((key - 1) % 64);
+
+    /* Writers are serialized by rm_lock, so no atomic rmw is required. */
+    if (allocated)
+        atomic_set(word, atomic_read(word) | mask);
+    else
+        atomic_set(word, atomic_read(word) & ~mask);
+}
+
 static merr_t
 mblock_rgnmap_init(struct mblock_file *mbfp, struct kmem_cache *rmcache)
 {
@@ -145,6 +208,7 @@ mblock_rgnmap_init(struct mblock_file *mbfp, struct kmem_cache *rmcache)
     rgn->rgn_start = 1;
     rmax = mbfp->fszmax >> ilog2(mbfp->mblocksz);
     rgn->rgn_end = rmax + 1;
+    rgnmap->rm_keymax = rmax;
 
     mutex_lock(&rgnmap->rm_lock);
     rb_link_node(&rgn->rgn_node, NULL, &rgnmap->rm_root.rb_node);
@@ -175,6 +239,7 @@ mblock_rgn_alloc(struct mblock_rgnmap *rgnmap)
         rgn = rb_entry(node, struct mblock_rgn, rgn_node);
 
         key = rgn->rgn_start++;
+        mblock_rgn_bmap_update(rgnmap, key, true);
 
         if (rgn->rgn_start < rgn->rgn_end)
             rgn = NULL;
@@ -218,6 +283,8 @@ mblock_rgn_insert(struct mblock_rgnmap *rgnmap, uint32_t key)
         goto exit;
     }
 
+    mblock_rgn_bmap_update(rgnmap, key, true);
+
     if (key == this->rgn_start) {
         this->rgn_start++;
         if (this->rgn_start == this->rgn_end) {
@@ -350,6 +417,9 @@ mblock_rgn_free(struct mblock_rgnmap *rgnmap, uint32_t key)
             rb_insert_color(&rgn->rgn_node, root);
         }
     }
+
+    if (!err)
+        mblock_rgn_bmap_update(rgnmap, key, false);
     mutex_unlock(&rgnmap->rm_lock);
 
     if (that)
@@ -361,28 +431,16 @@ mblock_rgn_free(struct mblock_rgnmap *rgnmap, uint32_t key)
 static merr_t
 mblock_rgn_find(struct mblock_rgnmap *rgnmap, uint32_t key)
 {
-    struct mblock_rgn *this;
-    struct rb_node *cur;
+    ulong word;
 
     assert(rgnmap && key > 0);
 
-    mutex_lock(&rgnmap->rm_lock);
-    cur = rgnmap->rm_root.rb_node;
-
-    while (cur) {
-        this = rb_entry(cur, struct mblock_rgn, rgn_node);
-
-        if (key < this->rgn_start)
-            cur = cur->rb_left;
-        else if (key >= this->rgn_end)
-            cur = cur->rb_right;
-        else
-            break;
-    }
+    if (key > rgnmap->rm_keymax)
+        return merr(ENOENT);
 
-    mutex_unlock(&rgnmap->rm_lock);
+    word = atomic_read(rgnmap->rm_bmap + (key - 1) / 64);
 
-    return cur ? merr(ENOENT) : 0;
+    return (word & (1UL << ((key - 1) % 64))) ? 0 : merr(ENOENT);
 }
 
 /**
@@ -495,7 +553,7 @@ mblock_file_meta_load(struct mblock_file *mbfp, uint32_t version, bool gclose, b
 
             atomic_set(mbfp->wlenv + block_id(mbinfo.mb_oid), mbinfo.mb_wlen);
             atomic_inc(&mbfp->mbcnt);
-            atomic_add(&mbfp->wlen, mbinfo.mb_wlen & MBLOCK_WLEN_MASK);
+            mblock_file_wlen_add(mbfp, mbinfo.mb_wlen & MBLOCK_WLEN_MASK);
 
             if (HSE_UNLIKELY(fh.uniq == 0))
                 mbfp->uniq = max_t(uint32_t, mbfp->uniq, uniquifier(mbinfo.mb_oid) + 1);
@@ -629,6 +687,38 @@ mblock_wlen_add(struct mblock_file *mbfp, uint64_t mbid, uint32_t len)
     mblock_wlen_set(mbfp, mbid, wlen + len, prealloc, false);
 }
 
+static merr_t
+mblock_file_blkdev_check(int fd, size_t fszmax)
+{
+    uint64_t devsz;
+    merr_t err;
+
+    err = mpool_sys_blkdev_size(fd, &devsz);
+    if (err)
+        return err;
+
+    return devsz < fszmax ? merr(ENOSPC) : 0;
+}
+
+/* Release the space backing a range of the data file.  On a raw device
+ * this is merely a hint, so devices that do not support discard are fine.
+ */
+static merr_t
+mblock_file_discard(struct mblock_file *mbfp, off_t off, size_t len)
+{
+    int rc;
+
+    if (mbfp->raw) {
+        merr_t err = mpool_sys_blkdev_discard(mbfp->fd, off, len);
+
+        return merr_errno(err) == EOPNOTSUPP ? 0 : err;
+    }
+
+    rc = fallocate(mbfp->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, off, len);
+
+    return rc == -1 ? merr(errno) : 0;
+}
+
 merr_t
 mblock_file_open(
     struct mblock_fset *mbfsp,
@@ -641,10 +731,12 @@ mblock_file_open(
     struct mblock_file *mbfp;
     enum mclass_id mcid;
     int fd, rc, dirfd, mmapc, wlenc, fileid;
+    uint stripec;
+    size_t sz, bmapsz, mblocksz, fszmax;
     merr_t err = 0;
-    char name[32];
+    char name[32], devname[32];
     bool create = (flags & O_CREAT), rdonly = ((flags & O_ACCMODE) == O_RDONLY);
-    size_t sz, mblocksz, fszmax;
+    bool raw;
 
     if (!mbfsp || !mc || !handle || !params)
         return merr(EINVAL);
@@ -658,22 +750,38 @@ mblock_file_open(
     mcid = mclass_id(mc);
     dirfd = mclass_dirfd(mc);
     snprintf(name, sizeof(name), "%s-%s-%d-%d", MBLOCK_FILE_PFX, "data", mcid, fileid);
+    snprintf(devname, sizeof(devname), "%s-%d-%d", MBLOCK_BLKDEV_PFX, mcid, fileid);
+
+    raw = (faccessat(dirfd, devname, F_OK, 0) == 0);
 
     rc = faccessat(dirfd, name, F_OK, 0);
-    if (rc == -1 && errno == ENOENT && !create)
-        return merr(ENOENT);
-    if (rc == 0 && create)
-        return merr(EEXIST);
+    if (raw) {
+        if (rc == 0) {
+            log_err("Both %s and %s exist for mclass %d", name, devname, mcid);
+            return merr(EEXIST);
+        }
+    } else {
+        if (rc == -1 && errno == ENOENT && !create)
+            return merr(ENOENT);
+        if (rc == 0 && create)
+            return merr(EEXIST);
+    }
 
     mmapc = fszmax >> mblock_mmap_cshift(mblocksz);
     wlenc = fszmax >> ilog2(mblocksz);
+    stripec = clamp_t(uint, get_nprocs_conf(), 1, MBLOCK_WLEN_STRIPES_MAX);
+    bmapsz = mblock_rgn_bmapc(wlenc) * sizeof(*mbfp->rgnmap.rm_bmap);
+    bmapsz = roundup(bmapsz, __alignof__(*mbfp->mmapv));
 
     sz = sizeof(*mbfp);
+    sz += stripec * sizeof(*mbfp->wlenv_pc);
+    sz += bmapsz;
     sz += roundup(wlenc * sizeof(*mbfp->wlenv), __alignof__(*mbfp->mmapv));
     sz += mmapc * sizeof(*mbfp->mmapv);
     sz = roundup(sz, __alignof__(*mbfp));
 
     assert(__alignof__(*mbfp) >= __alignof__(*mbfp->mmapv));
+    assert(__alignof__(*mbfp) >= __alignof__(*mbfp->wlenv_pc));
 
     mbfp = aligned_alloc(__alignof__(*mbfp), sz);
     if (!mbfp)
@@ -681,6 +789,7 @@ mblock_file_open(
 
     memset(mbfp, 0, sz);
     mbfp->fd = -1;
+    mbfp->raw = raw;
     mbfp->mbfsp = mbfsp;
     mbfp->meta_addr = params->meta_addr;
     mbfp->fileid = fileid;
@@ -690,14 +799,17 @@ mblock_file_open(
     mbfp->metaio = *params->metaio;
 
     mbfp->fszmax = fszmax;
+    mbfp->wlenv_pc = (void *)(mbfp + 1);
+    mbfp->wlenc_pc = stripec;
+    mbfp->rgnmap.rm_bmap = (void *)(mbfp->wlenv_pc + stripec);
+    mbfp->wlenv = (void *)((char *)mbfp->rgnmap.rm_bmap + bmapsz);
+
     err = mblock_rgnmap_init(mbfp, params->rmcache);
     if (err) {
         free(mbfp);
         return err;
     }
 
-    mbfp->wlenv = (void *)(mbfp + 1);
-
     if (create) {
         struct mblock_filehdr fh = {};
 
@@ -712,15 +824,24 @@ mblock_file_open(
     if (err)
         goto err_exit;
 
-    fd = openat(dirfd, name, flags | O_SYNC, S_IRUSR | S_IWUSR);
+    if (raw)
+        fd = openat(dirfd, devname, (flags & ~(O_CREAT | O_EXCL)) | O_SYNC);
+    else
+        fd = openat(dirfd, name, flags | O_SYNC, S_IRUSR | S_IWUSR);
     if (fd < 0) {
         err = merr(errno);
         goto err_exit;
     }
     mbfp->fd = fd;
 
-    /* ftruncate to the maximum size to make it a sparse file */
-    if (!rdonly) {
+    if (raw) {
+        err = mblock_file_blkdev_check(fd, mbfp->fszmax);
+        if (err) {
+            log_errx("Invalid block device %s for mclass %d", err, devname, mcid);
+            goto err_exit;
+        }
+    } else if (!rdonly) {
+        /* ftruncate to the maximum size to make it a sparse file */
         rc = ftruncate(fd, mbfp->fszmax);
         if (rc == -1) {
             err = merr(errno);
@@ -742,7 +863,7 @@ mblock_file_open(
 err_exit:
     mblock_file_close(mbfp);
 
-    if (create)
+    if (create && !raw)
         unlinkat(dirfd, name, 0);
 
     return err;
@@ -849,18 +970,16 @@ mblock_file_alloc(struct mblock_file *mbfp, uint32_t flags, int mbidc, uint64_t
     if (prealloc) {
         int rc;
 
-        rc = posix_fallocate(mbfp->fd, block_off(mbid, mbfp->mblocksz), mbfp->mblocksz);
+        /* Every block of a raw device is always allocated. */
+        rc = mbfp->raw ? 0 :
+            posix_fallocate(mbfp->fd, block_off(mbid, mbfp->mblocksz), mbfp->mblocksz);
         if (ev(rc != 0)) /* advisory */
             prealloc = false;
     } else if (punch_hole) {
-        int rc;
-
-        rc = fallocate(
-            mbfp->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, block_off(mbid, mbfp->mblocksz),
-            mbfp->mblocksz);
-        if (rc == -1) {
+        err = mblock_file_discard(mbfp, block_off(mbid, mbfp->mblocksz), mbfp->mblocksz);
+        if (err) {
             mblock_rgn_free(&mbfp->rgnmap, block);
-            return merr(errno);
+            return err;
         }
     }
 
@@ -914,6 +1033,12 @@ mblock_alen_get(struct mblock_file *mbfp, uint64_t mbid, uint32_t *alen)
     start = block_off(mbid, mblocksz);
     end = start + mblocksz - 1;
 
+    /* Discarded ranges of a raw device are never returned to a free pool. */
+    if (mbfp->raw) {
+        *alen = mblocksz;
+        return 0;
+    }
+
     cur = lseek(mbfp->fd, start, SEEK_SET);
 
     *alen = mblocksz;
@@ -948,6 +1073,10 @@ mblock_file_find(struct mblock_file *mbfp, uint64_t *mbidv, int mbidc, struct mb
 
     block = block_id(*mbidv);
 
+    /* A block past the end of the file has neither a wlen slot nor meta. */
+    if (block >= mbfp->rgnmap.rm_keymax)
+        return merr(ENOENT);
+
     mutex_lock(&mbfp->meta_lock);
     err = mblock_rgn_find(&mbfp->rgnmap, block + 1);
     if (err && merr_errno(err) != ENOENT) {
@@ -965,7 +1094,7 @@ mblock_file_find(struct mblock_file *mbfp, uint64_t *mbidv, int mbidc, struct mb
 
         if (mblock_is_punched(mbfp, *mbidv)) {
             err2 = mblock_alen_get(mbfp, *mbidv, &alen);
-            if (!err2 && mblock_is_prealloced(mbfp, *mbidv))
+            if (!err2 && !mbfp->raw && mblock_is_prealloced(mbfp, *mbidv))
                 alen += (mbfp->mblocksz - props->mpr_write_len);
         } else if (mblock_is_prealloced(mbfp, *mbidv)) {
             alen = mbfp->mblocksz;
@@ -1009,7 +1138,6 @@ mblock_file_delete(struct mblock_file *mbfp, uint64_t *mbidv, int mbidc)
     uint32_t block;
     size_t mblocksz;
     merr_t err;
-    int rc;
 
     INVARIANT(mbfp && mbidv && mbidc == 1);
 
@@ -1023,12 +1151,10 @@ mblock_file_delete(struct mblock_file *mbfp, uint64_t *mbidv, int mbidc)
         return err;
 
     mblocksz = mbfp->mblocksz;
-    rc = fallocate(
-        mbfp->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, block_off(*mbidv, mblocksz),
-        mblocksz);
-    ev(rc);
+    err = mblock_file_discard(mbfp, block_off(*mbidv, mblocksz), mblocksz);
+    ev(err);
 
-    atomic_sub(&mbfp->wlen, mblock_wlen_get(mbfp, *mbidv));
+    mblock_file_wlen_add(mbfp, -(long)mblock_wlen_get(mbfp, *mbidv));
 
     /* Clear prelloc and punch bits at delete
      */
@@ -1092,15 +1218,8 @@ mblock_punch(struct mblock_file *mbfp, uint64_t mbid, off_t off, size_t len)
     err = mbfp->metaio.msync(addr, omf_mblock_oid_len(MBLOCK_METAHDR_VERSION), MS_SYNC);
     mutex_unlock(&mbfp->meta_lock);
 
-    if (!err) {
-        int rc;
-
-        rc = fallocate(
-            mbfp->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
-            off + block_off(mbid, mbfp->mblocksz), len);
-
-        err = rc < 0 ? merr(errno) : 0;
-    }
+    if (!err)
+        err = mblock_file_discard(mbfp, off + block_off(mbid, mbfp->mblocksz), len);
 
     return err;
 }
@@ -1214,7 +1333,7 @@ mblock_write(struct mblock_file *mbfp, uint64_t mbid, const struct iovec *iov, i
 
     if (!err) {
         mblock_wlen_add(mbfp, mbid, len);
-        atomic_add(&mbfp->wlen, len);
+        mblock_file_wlen_add(mbfp, len);
     }
 
     return err;
@@ -1395,12 +1514,19 @@ mblock_file_info_get(const struct mblock_file *mbfp, struct mblock_file_info *in
     INVARIANT(mbfp);
     INVARIANT(info);
 
+    info->used = mblock_file_wlen_sum(mbfp);
+
+    /* st_blocks is meaningless for a device, whose blocks are all in use. */
+    if (mbfp->raw) {
+        info->allocated = (uint64_t)atomic_read(&mbfp->mbcnt) * mbfp->mblocksz;
+        return 0;
+    }
+
     rc = fstat(mbfp->fd, &sbuf);
     if (rc == -1)
         return merr(errno);
 
     info->allocated = S_BLKSIZE * sbuf.st_blocks;
-    info->used = atomic_read(&mbfp->wlen);
 
     return 0;
 }
@@ -24,6 +24,16 @@
 
 #define MBLOCK_FILE_PFX        "mblock"
 
+/*
+ * An mblock data file may be backed by a raw block device (or partition)
+ * instead of a regular file by placing a device node or symlink named
+ * "blkdev-<mcid>-<fileid>" in the media class directory before the mpool
+ * is created.  The device must be at least as large as the max file size.
+ * Metadata remains in the media class directory, and the device is used
+ * with the same layout and mblock ids as a regular data file.
+ */
+#define MBLOCK_BLKDEV_PFX      "blkdev"
+
 /**
  * Mblock ID in-memory layout
  *
@@ -821,9 +821,10 @@ mblock_fset_filecnt_get(const struct mblock_fset * const mbfsp)
     return mbfsp ? mbfsp->mhdr.fcnt : 0;
 }
 
-merr_t
-mblock_fset_clone(
-    struct mblock_fset *mbfsp,
+static merr_t
+mblock_fset_clone_impl(
+    struct mblock_fset *src_fsp,
+    struct mblock_fset *tgt_fsp,
     uint64_t src_mbid,
     off_t off,
     size_t len,
@@ -836,12 +837,12 @@ mblock_fset_clone(
     size_t wlen;
     merr_t err;
 
-    INVARIANT(mbfsp && mbid_out);
+    INVARIANT(src_fsp && tgt_fsp && mbid_out);
 
     if (!PAGE_ALIGNED(off) || !PAGE_ALIGNED(len))
         return merr(EINVAL);
 
-    src_mbfp = mbfsp->filev[file_index(src_mbid)];
+    src_mbfp = src_fsp->filev[file_index(src_mbid)];
     err = mblock_info_get(src_mbfp, src_mbid, &src_mbinfo);
     if (err)
         return err;
@@ -856,11 +857,11 @@ mblock_fset_clone(
         assert(PAGE_ALIGNED(len));
     }
 
-    err = mblock_fset_alloc(mbfsp, MPOOL_MBLOCK_PUNCH_HOLE, 1, &tgt_mbid);
+    err = mblock_fset_alloc(tgt_fsp, MPOOL_MBLOCK_PUNCH_HOLE, 1, &tgt_mbid);
     if (err)
         return err;
 
-    tgt_mbfp = mbfsp->filev[file_index(tgt_mbid)];
+    tgt_mbfp = tgt_fsp->filev[file_index(tgt_mbid)];
     err = mblock_info_get(tgt_mbfp, tgt_mbid, &tgt_mbinfo);
     if (err)
         goto errout;
@@ -869,7 +870,7 @@ mblock_fset_clone(
     src_off += src_mbinfo.off;
     tgt_off += tgt_mbinfo.off;
 
-    err = mbfsp->io.clone(src_mbinfo.fd, src_off, tgt_mbinfo.fd, tgt_off, len, 0);
+    err = tgt_fsp->io.clone(src_mbinfo.fd, src_off, tgt_mbinfo.fd, tgt_off, len, 0);
     if (err)
         goto errout;
 
@@ -880,7 +881,28 @@ mblock_fset_clone(
     return 0;
 
 errout:
-    mblock_fset_delete(mbfsp, &tgt_mbid, 1);
+    mblock_fset_delete(tgt_fsp, &tgt_mbid, 1);
 
     return err;
 }
+
+merr_t
+mblock_fset_clone(
+    struct mblock_fset *mbfsp,
+    uint64_t src_mbid,
+    off_t off,
+    size_t len,
+    uint64_t *mbid_out)
+{
+    return mblock_fset_clone_impl(mbfsp, mbfsp, src_mbid, off, len, mbid_out);
+}
+
+merr_t
+mblock_fset_copy(
+    struct mblock_fset *src_fsp,
+    struct mblock_fset *tgt_fsp,
+    uint64_t src_mbid,
+    uint64_t *mbid_out)
+{
+    return mblock_fset_clone_impl(src_fsp, tgt_fsp, src_mbid, 0, 0, mbid_out);
+}
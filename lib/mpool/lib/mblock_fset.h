@@ -206,6 +206,21 @@ mblock_fset_clone(
     size_t len,
     uint64_t *mbid_out);
 
+/**
+ * mblock_fset_copy() - copy an entire mblock into another mblock fileset
+ *
+ * @src_fsp:  source mblock fileset handle
+ * @tgt_fsp:  target mblock fileset handle
+ * @src_mbid: source mblock id
+ * @mbid_out: target mblock id (output)
+ */
+merr_t
+mblock_fset_copy(
+    struct mblock_fset *src_fsp,
+    struct mblock_fset *tgt_fsp,
+    uint64_t src_mbid,
+    uint64_t *mbid_out);
+
 /**
  * mblock_fset_punch() - punch an mblock
  *
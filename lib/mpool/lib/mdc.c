@@ -4,13 +4,18 @@
  */
 
 #include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define MTF_MOCK_IMPL_mpool
 
 #include <hse/error/merr.h>
 #include <hse/logging/logging.h>
 #include <hse/mpool/mpool.h>
+#include <hse/util/condvar.h>
 #include <hse/util/event_counter.h>
+#include <hse/util/minmax.h>
+#include <hse/util/page.h>
 
 #include "mclass.h"
 #include "mdc.h"
@@ -20,18 +25,122 @@
 /**
  * struct mpool_mdc - MDC handle
  *
- * lock: lock serializing MDC ops
- * mfp1: mdc file pointer 1
- * mfp2: mdc file pointer 2
- * mfpa: active mdc file handle (either mfp1 or mfp2)
+ * lock:    lock serializing MDC ops
+ * mfp1:    mdc file pointer 1
+ * mfp2:    mdc file pointer 2
+ * mfpa:    active mdc file handle (either mfp1 or mfp2)
+ * appendc: number of records appended since open
+ * syncc:   number of leading records known to be durable
+ * swapc:   number of times the active log has changed since open
+ * syncing: a thread is syncing the active log without holding lock
+ * synccv:  where mpool_mdc_sync_wait() callers wait for that sync
+ * cimg:    handle collecting the image of a background compaction
+ * crecs:   records retained in memory (the image for cimg, the records
+ *          appended during a background compaction otherwise)
+ * cerr:    error that must fail the background compaction in progress
  */
 struct mpool_mdc {
     struct mutex lock;
     struct mdc_file *mfp1;
     struct mdc_file *mfp2;
     struct mdc_file *mfpa;
+    bool compacting;
+    uint64_t appendc;
+    uint64_t syncc;
+    uint64_t swapc;
+    bool syncing;
+    struct cv synccv;
+    struct mpool_mdc *cimg;
+    struct mdc_recbuf *crecs;
+    merr_t cerr;
 };
 
+/**
+ * struct mdc_recbuf - records retained in memory by a background compaction
+ *
+ * Each record is stored as a size_t length followed by its data, padded to
+ * a multiple of sizeof(size_t).
+ */
+struct mdc_recbuf {
+    char *buf;
+    size_t len;
+    size_t size;
+};
+
+static merr_t
+mdc_recbuf_add(struct mdc_recbuf *rb, const void *data, size_t len)
+{
+    size_t need = sizeof(len) + ALIGN(len, sizeof(len));
+
+    if (rb->len + need > rb->size) {
+        size_t sz = max_t(size_t, rb->size * 2, rb->len + need);
+        char *buf;
+
+        sz = max_t(size_t, sz, 64 * 1024);
+
+        buf = realloc(rb->buf, sz);
+        if (!buf)
+            return merr(ENOMEM);
+
+        rb->buf = buf;
+        rb->size = sz;
+    }
+
+    memcpy(rb->buf + rb->len, &len, sizeof(len));
+    memcpy(rb->buf + rb->len + sizeof(len), data, len);
+    rb->len += need;
+
+    return 0;
+}
+
+static merr_t
+mdc_recbuf_write(struct mdc_recbuf *rb, struct mdc_file *mfp)
+{
+    size_t off = 0;
+
+    while (off < rb->len) {
+        size_t len;
+        merr_t err;
+
+        memcpy(&len, rb->buf + off, sizeof(len));
+
+        err = mdc_file_append(mfp, rb->buf + off + sizeof(len), len, false);
+        if (err)
+            return err;
+
+        off += sizeof(len) + ALIGN(len, sizeof(len));
+    }
+
+    return 0;
+}
+
+static void
+mdc_recbuf_free(struct mdc_recbuf *rb)
+{
+    if (rb) {
+        free(rb->buf);
+        free(rb);
+    }
+}
+
+/* Releases the state of a background compaction, called with mdc->lock held.
+ */
+static void
+mdc_cstate_free(struct mpool_mdc *mdc)
+{
+    if (mdc->cimg) {
+        mdc_recbuf_free(mdc->cimg->crecs);
+        mutex_destroy(&mdc->cimg->lock);
+        free(mdc->cimg);
+    }
+
+    mdc_recbuf_free(mdc->crecs);
+
+    mdc->cimg = NULL;
+    mdc->crecs = NULL;
+    mdc->cerr = 0;
+}
+
 merr_t
 mpool_mdc_alloc(
     struct mpool *mp,
@@ -244,6 +353,7 @@ mpool_mdc_open(
         mdc->mfp1 = mfp[0];
         mdc->mfp2 = mfp[1];
         mutex_init(&mdc->lock);
+        cv_init(&mdc->synccv);
 
         *handle = mdc;
     } else {
@@ -267,6 +377,8 @@ mpool_mdc_close(struct mpool_mdc *mdc)
 
     mutex_lock(&mdc->lock);
 
+    mdc_cstate_free(mdc);
+
     err = mdc_file_close(mdc->mfp1);
     if (err)
         rval = err;
@@ -277,6 +389,7 @@ mpool_mdc_close(struct mpool_mdc *mdc)
 
     mutex_unlock(&mdc->lock);
 
+    cv_destroy(&mdc->synccv);
     free(mdc);
 
     return rval;
@@ -293,14 +406,30 @@ mpool_mdc_cstart(struct mpool_mdc *mdc)
 
     mutex_lock(&mdc->lock);
 
+    if (mdc->cimg) {
+        mutex_unlock(&mdc->lock);
+        return merr(EBUSY);
+    }
+
     if (mdc->mfpa == mdc->mfp1)
         tgth = mdc->mfp2;
     else
         tgth = mdc->mfp1;
 
-    err = mdc_file_sync(tgth);
-    if (!err)
-        mdc->mfpa = tgth;
+    /* Records appended by mpool_mdc_append_async() whose waiters haven't
+     * yet synced them must be made durable before the log switches.
+     */
+    err = mdc_file_sync(mdc->mfpa);
+    if (!err) {
+        mdc->syncc = mdc->appendc;
+
+        err = mdc_file_sync(tgth);
+        if (!err) {
+            mdc->mfpa = tgth;
+            mdc->swapc++;
+            mdc->compacting = true;
+        }
+    }
 
     mutex_unlock(&mdc->lock);
 
@@ -330,8 +459,12 @@ mpool_mdc_cend(struct mpool_mdc *mdc)
         srch = mdc->mfp1;
     }
 
+    mdc->compacting = false;
+
     err = mdc_file_sync(tgth);
     if (!err) {
+        mdc->syncc = mdc->appendc;
+
         err = mdc_file_gen(tgth, &gentgt);
         if (!err)
             err = mdc_file_erase(srch, gentgt + 1);
@@ -345,6 +478,143 @@ mpool_mdc_cend(struct mpool_mdc *mdc)
     return err;
 }
 
+merr_t
+mpool_mdc_cstart_bg(struct mpool_mdc *mdc, struct mpool_mdc **img)
+{
+    struct mpool_mdc *cimg;
+    merr_t err = 0;
+
+    if (!mdc || !img)
+        return merr(EINVAL);
+
+    cimg = calloc(1, sizeof(*cimg));
+    if (!cimg)
+        return merr(ENOMEM);
+
+    mutex_init(&cimg->lock);
+    cimg->compacting = true;
+
+    cimg->crecs = calloc(1, sizeof(*cimg->crecs));
+    if (!cimg->crecs) {
+        err = merr(ENOMEM);
+        goto errout;
+    }
+
+    mutex_lock(&mdc->lock);
+    if (mdc->cimg || mdc->compacting) {
+        err = merr(EBUSY);
+    } else {
+        mdc->crecs = calloc(1, sizeof(*mdc->crecs));
+        if (mdc->crecs)
+            mdc->cimg = cimg;
+        else
+            err = merr(ENOMEM);
+    }
+    mutex_unlock(&mdc->lock);
+
+    if (!err) {
+        *img = cimg;
+        return 0;
+    }
+
+errout:
+    mdc_recbuf_free(cimg->crecs);
+    mutex_destroy(&cimg->lock);
+    free(cimg);
+
+    return err;
+}
+
+void
+mpool_mdc_cabort(struct mpool_mdc *mdc)
+{
+    if (!mdc)
+        return;
+
+    mutex_lock(&mdc->lock);
+    mdc_cstate_free(mdc);
+    mutex_unlock(&mdc->lock);
+}
+
+merr_t
+mpool_mdc_cend_bg(struct mpool_mdc *mdc)
+{
+    struct mdc_file *srch, *tgth;
+    uint64_t gensrc = 0, gentgt = 0;
+    merr_t err;
+
+    if (!mdc)
+        return merr(EINVAL);
+
+    mutex_lock(&mdc->lock);
+    if (!mdc->cimg) {
+        mutex_unlock(&mdc->lock);
+        return merr(EINVAL);
+    }
+
+    /* A sync that began before the last log switch may still be using the
+     * target log's mapping, which the image write below can move.
+     */
+    while (mdc->syncing)
+        cv_wait(&mdc->synccv, &mdc->lock, "mdcsync");
+
+    srch = mdc->mfpa;
+    tgth = (srch == mdc->mfp1) ? mdc->mfp2 : mdc->mfp1;
+    mutex_unlock(&mdc->lock);
+
+    /* The inactive log isn't touched by appenders, so the image is written
+     * and synced without holding the lock.  This is the bulk of the I/O.
+     */
+    err = mdc_recbuf_write(mdc->cimg->crecs, tgth);
+    if (!err)
+        err = mdc_file_sync(tgth);
+
+    mutex_lock(&mdc->lock);
+
+    /* Records appended to the active log since mpool_mdc_cstart_bg() are
+     * replayed on top of the image, then the target log is made active.
+     * Until the source log is erased it still has the smaller generation,
+     * so a crash before then recovers from the source log.
+     */
+    if (!err)
+        err = mdc->cerr;
+    if (!err)
+        err = mdc_recbuf_write(mdc->crecs, tgth);
+    if (!err)
+        err = mdc_file_sync(tgth);
+    if (!err)
+        err = mdc_file_gen(tgth, &gentgt);
+
+    if (err) {
+        /* Leave the source log active and reset the target log so that
+         * the next compaction starts from an empty log.
+         */
+        if (!mdc_file_gen(srch, &gensrc))
+            mdc_file_erase(tgth, gensrc + 1);
+
+        mdc_cstate_free(mdc);
+        mutex_unlock(&mdc->lock);
+
+        log_errx("mdc %p background compaction failed", err, mdc);
+
+        return err;
+    }
+
+    mdc->mfpa = tgth;
+    mdc->swapc++;
+    mdc->syncc = mdc->appendc;
+    mdc_cstate_free(mdc);
+
+    err = mdc_file_erase(srch, gentgt + 1);
+
+    mutex_unlock(&mdc->lock);
+
+    if (err)
+        mpool_mdc_close(mdc);
+
+    return err;
+}
+
 merr_t
 mpool_mdc_sync(struct mpool_mdc *mdc)
 {
@@ -354,11 +624,71 @@ mpool_mdc_sync(struct mpool_mdc *mdc)
 
     mutex_lock(&mdc->lock);
     err = mdc_file_sync(mdc->mfpa);
+    if (!err)
+        mdc->syncc = mdc->appendc;
     mutex_unlock(&mdc->lock);
 
     return err;
 }
 
+merr_t
+mpool_mdc_sync_wait(struct mpool_mdc *mdc, uint64_t gen)
+{
+    merr_t err = 0;
+
+    if (!mdc)
+        return merr(EINVAL);
+
+    /* Group commit: The first waiter whose record isn't yet durable syncs
+     * every record appended so far, without holding the lock so that
+     * appenders aren't stalled behind the fdatasync.  Waiters arriving
+     * meanwhile wait for that sync and then recheck, syncing again only
+     * if their record was appended after it started.  During a compaction
+     * the target log isn't synced until mpool_mdc_cend(), as for
+     * mpool_mdc_append().
+     */
+    mutex_lock(&mdc->lock);
+    while (gen > mdc->syncc && !mdc->compacting) {
+        struct mdc_file_syncpt sp;
+        struct mdc_file *mfp;
+        uint64_t appendc, swapc;
+
+        if (mdc->syncing) {
+            cv_wait(&mdc->synccv, &mdc->lock, "mdcsync");
+            continue;
+        }
+
+        mfp = mdc->mfpa;
+        appendc = mdc->appendc;
+        swapc = mdc->swapc;
+        mdc_file_datasync_begin(mfp, &sp);
+        mdc->syncing = true;
+        mutex_unlock(&mdc->lock);
+
+        err = mdc_file_datasync(mfp, &sp);
+
+        mutex_lock(&mdc->lock);
+        mdc_file_datasync_end(mfp, &sp, err);
+        mdc->syncing = false;
+        cv_broadcast(&mdc->synccv);
+
+        if (err)
+            break;
+
+        /* If the active log changed during the sync then the switch
+         * already synced (and published) every record appended to it.
+         */
+        if (swapc == mdc->swapc && appendc > mdc->syncc)
+            mdc->syncc = appendc;
+    }
+    mutex_unlock(&mdc->lock);
+
+    if (err)
+        log_errx("mdc %p sync failed, mdc file %p", err, mdc, mdc->mfpa);
+
+    return err;
+}
+
 merr_t
 mpool_mdc_rewind(struct mpool_mdc *mdc)
 {
@@ -392,6 +722,37 @@ mpool_mdc_read(struct mpool_mdc *mdc, void *data, size_t len, size_t *rdlen)
     return err;
 }
 
+/* Appends a record to the active log and, during a background compaction,
+ * retains a copy of it.  An image handle from mpool_mdc_cstart_bg() has no
+ * log and only retains the record.  Called with mdc->lock held.
+ */
+static merr_t
+mdc_append_locked(struct mpool_mdc *mdc, void *data, size_t len, bool sync)
+{
+    merr_t err;
+
+    if (!mdc->mfpa)
+        return mdc_recbuf_add(mdc->crecs, data, len);
+
+    /* An unlocked sync uses the log's mapping, don't move it meanwhile.
+     */
+    while (mdc->syncing && mdc_file_append_extends(mdc->mfpa, len))
+        cv_wait(&mdc->synccv, &mdc->lock, "mdcsync");
+
+    err = mdc_file_append(mdc->mfpa, data, len, sync);
+    if (err || !mdc->crecs)
+        return err;
+
+    /* The record is in the active log, so failing to retain it fails the
+     * background compaction rather than the append.
+     */
+    err = mdc_recbuf_add(mdc->crecs, data, len);
+    if (err && !mdc->cerr)
+        mdc->cerr = err;
+
+    return 0;
+}
+
 merr_t
 mpool_mdc_append(struct mpool_mdc *mdc, void *data, size_t len, bool sync)
 {
@@ -400,8 +761,18 @@ mpool_mdc_append(struct mpool_mdc *mdc, void *data, size_t len, bool sync)
     if (!mdc || !data)
         return merr(EINVAL);
 
+    /* The target log of a compaction doesn't become the active log until
+     * mpool_mdc_cend() syncs it, so per-record syncs in between are wasted.
+     */
     mutex_lock(&mdc->lock);
-    err = mdc_file_append(mdc->mfpa, data, len, sync);
+    if (mdc->compacting)
+        sync = false;
+    err = mdc_append_locked(mdc, data, len, sync);
+    if (!err) {
+        mdc->appendc++;
+        if (sync)
+            mdc->syncc = mdc->appendc;
+    }
     mutex_unlock(&mdc->lock);
     if (err)
         log_errx(
@@ -410,6 +781,25 @@ mpool_mdc_append(struct mpool_mdc *mdc, void *data, size_t len, bool sync)
     return err;
 }
 
+merr_t
+mpool_mdc_append_async(struct mpool_mdc *mdc, void *data, size_t len, uint64_t *gen)
+{
+    merr_t err;
+
+    if (!mdc || !data || !gen)
+        return merr(EINVAL);
+
+    mutex_lock(&mdc->lock);
+    err = mdc_append_locked(mdc, data, len, false);
+    if (!err)
+        *gen = ++mdc->appendc;
+    mutex_unlock(&mdc->lock);
+    if (err)
+        log_errx("mdc %p append failed, mdc file %p, len %lu", err, mdc, mdc->mfpa, len);
+
+    return err;
+}
+
 merr_t
 mpool_mdc_usage(struct mpool_mdc *mdc, uint64_t *size, uint64_t *allocated, uint64_t *used)
 {
@@ -558,6 +558,54 @@ mdc_file_sync(struct mdc_file *mfp)
     return 0;
 }
 
+void
+mdc_file_datasync_begin(struct mdc_file *mfp, struct mdc_file_syncpt *sp)
+{
+    sp->gen = mfp->lh.gen;
+    sp->off = mfp->syncoff;
+    sp->end = mfp->woff;
+    sp->dsync = mfp->need_dsync;
+}
+
+merr_t
+mdc_file_datasync(struct mdc_file *mfp, const struct mdc_file_syncpt *sp)
+{
+    char *addr;
+    int rc;
+
+    if (!mfp || !sp)
+        return merr(EINVAL);
+
+    if (sp->dsync) {
+        rc = fdatasync(mfp->fd);
+
+        return (rc == -1) ? merr(errno) : 0;
+    }
+
+    if (sp->end <= sp->off)
+        return 0;
+
+    addr = (char *)((uintptr_t)(mfp->addr + sp->off) & PAGE_MASK);
+
+    return mfp->io.msync(addr, (mfp->addr + sp->end) - addr, MS_SYNC);
+}
+
+void
+mdc_file_datasync_end(struct mdc_file *mfp, const struct mdc_file_syncpt *sp, merr_t err)
+{
+    if (err || sp->gen != mfp->lh.gen)
+        return;
+
+    /* need_dsync stays set if records were written through the fd after
+     * the sync point, a locked mdc_file_sync() must not skip those.
+     */
+    if (sp->dsync && mfp->woff == sp->end)
+        mfp->need_dsync = false;
+
+    if (sp->end > mfp->syncoff)
+        mfp->syncoff = sp->end;
+}
+
 merr_t
 mdc_file_rewind(struct mdc_file *mfp)
 {
@@ -731,6 +779,22 @@ mdc_file_append_mem(struct mdc_file *mfp, void *data, size_t len)
     return 0;
 }
 
+bool
+mdc_file_append_extends(struct mdc_file *mfp, size_t len)
+{
+    size_t tlen, sz;
+
+    tlen = omf_mdc_rechdr_len(mfp->lh.vers) + ALIGN(len, sizeof(uint64_t));
+    if (mfp->woff + tlen <= ((9 * mfp->size) / 10))
+        return false;
+
+    sz = 2 * mfp->size;
+    if (sz < mfp->size + tlen)
+        sz = 2 * (mfp->size + tlen);
+
+    return sz <= mfp->maxsz;
+}
+
 merr_t
 mdc_file_append(struct mdc_file *mfp, void *data, size_t len, bool sync)
 {
@@ -6,8 +6,10 @@
 #ifndef MPOOL_MDC_FILE_H
 #define MPOOL_MDC_FILE_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <sys/types.h>
 
 #include <hse/error/merr.h>
 #include <hse/ikvdb/omf_version.h>
@@ -38,6 +40,21 @@ struct mdc_loghdr {
     uint32_t crc;
 };
 
+/**
+ * struct mdc_file_syncpt - state of an MDC file captured for an unlocked sync
+ *
+ * @gen:   log generation, a sync that spans an erase doesn't update the log
+ * @off:   offset of the first record not yet known to be durable
+ * @end:   write offset when the sync started
+ * @dsync: records were written through the fd rather than the mapping
+ */
+struct mdc_file_syncpt {
+    uint64_t gen;
+    off_t off;
+    off_t end;
+    bool dsync;
+};
+
 /**
  * struct mdc_rechdr - MDC record header
  *
@@ -197,6 +214,41 @@ mdc_file_exists(int dirfd, const char *name1, const char *name2, bool *exist);
 merr_t
 mdc_file_sync(struct mdc_file *mfp);
 
+/**
+ * mdc_file_datasync_begin() - capture the records an unlocked sync covers
+ *
+ * @mfp: mdc file handle
+ * @sp:  sync point (output)
+ *
+ * Called with appends to @mfp excluded.
+ */
+void
+mdc_file_datasync_begin(struct mdc_file *mfp, struct mdc_file_syncpt *sp);
+
+/**
+ * mdc_file_datasync() - sync the records captured in a sync point
+ *
+ * @mfp: mdc file handle
+ * @sp:  sync point from mdc_file_datasync_begin()
+ *
+ * Unlike mdc_file_sync() this may run concurrently with appends to @mfp,
+ * provided none of them remaps the file (see mdc_file_append_extends()).
+ */
+merr_t
+mdc_file_datasync(struct mdc_file *mfp, const struct mdc_file_syncpt *sp);
+
+/**
+ * mdc_file_datasync_end() - publish the result of an unlocked sync
+ *
+ * @mfp: mdc file handle
+ * @sp:  sync point from mdc_file_datasync_begin()
+ * @err: result of mdc_file_datasync()
+ *
+ * Called with appends to @mfp excluded.
+ */
+void
+mdc_file_datasync_end(struct mdc_file *mfp, const struct mdc_file_syncpt *sp, merr_t err);
+
 /**
  * mdc_file_rewind() - rewind an MDC file
  *
@@ -240,4 +292,13 @@ mdc_file_read(struct mdc_file *mfp, void *data, size_t len, bool verify, size_t
 merr_t
 mdc_file_append(struct mdc_file *mfp, void *data, size_t len, bool sync);
 
+/**
+ * mdc_file_append_extends() - check whether an append would remap an MDC file
+ *
+ * @mfp: mdc file handle
+ * @len: record length
+ */
+bool
+mdc_file_append_extends(struct mdc_file *mfp, size_t len);
+
 #endif /* MPOOL_MDC_FILE_H */
@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2021 Micron Technology, Inc.
+ */
+
+#define MTF_MOCK_IMPL_mpool_sys
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+
+#include "mpool_sys.h"
+
+merr_t
+mpool_sys_copy_file_range(
+    int src_fd,
+    off_t *src_off,
+    int tgt_fd,
+    off_t *tgt_off,
+    size_t len,
+    size_t *copied)
+{
+    ssize_t cc;
+
+    cc = copy_file_range(src_fd, src_off, tgt_fd, tgt_off, len, 0);
+    if (cc == -1)
+        return merr(errno);
+
+    *copied = cc;
+
+    return 0;
+}
+
+merr_t
+mpool_sys_blkdev_size(int fd, uint64_t *size)
+{
+    struct stat sbuf;
+
+    if (fstat(fd, &sbuf) == -1)
+        return merr(errno);
+
+    if (!S_ISBLK(sbuf.st_mode))
+        return merr(ENOTBLK);
+
+    if (ioctl(fd, BLKGETSIZE64, size) == -1)
+        return merr(errno);
+
+    return 0;
+}
+
+merr_t
+mpool_sys_blkdev_discard(int fd, off_t off, size_t len)
+{
+    uint64_t range[] = { off, len };
+
+    if (ioctl(fd, BLKDISCARD, range) == -1)
+        return merr(errno);
+
+    return 0;
+}
+
+#if HSE_MOCKING
+#include "mpool_sys_ut_impl.i"
+#endif /* HSE_MOCKING */
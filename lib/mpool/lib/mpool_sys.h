@@ -0,0 +1,70 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2021 Micron Technology, Inc.
+ */
+
+#ifndef MPOOL_SYS_H
+#define MPOOL_SYS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/types.h>
+
+#include <hse/error/merr.h>
+
+/* MTF_MOCK_DECL(mpool_sys) */
+
+/* Thin wrappers around the system calls whose failure modes depend on the
+ * file system or device backing a media class, so that unit tests can
+ * exercise the paths taken on each.
+ */
+
+/**
+ * mpool_sys_copy_file_range() - copy_file_range(2)
+ *
+ * @src_fd:  source fd
+ * @src_off: source offset, advanced by the number of bytes copied
+ * @tgt_fd:  target fd
+ * @tgt_off: target offset, advanced by the number of bytes copied
+ * @len:     number of bytes to copy
+ * @copied:  number of bytes copied (output)
+ */
+/* MTF_MOCK */
+merr_t
+mpool_sys_copy_file_range(
+    int src_fd,
+    off_t *src_off,
+    int tgt_fd,
+    off_t *tgt_off,
+    size_t len,
+    size_t *copied);
+
+/**
+ * mpool_sys_blkdev_size() - size of a block device, via BLKGETSIZE64
+ *
+ * @fd:   open fd
+ * @size: device size in bytes (output)
+ *
+ * Return: ENOTBLK if fd does not refer to a block device
+ */
+/* MTF_MOCK */
+merr_t
+mpool_sys_blkdev_size(int fd, uint64_t *size);
+
+/**
+ * mpool_sys_blkdev_discard() - discard a range of a block device, via BLKDISCARD
+ *
+ * @fd:  open fd of a block device
+ * @off: byte offset of the range
+ * @len: length of the range in bytes
+ */
+/* MTF_MOCK */
+merr_t
+mpool_sys_blkdev_discard(int fd, off_t off, size_t len);
+
+#if HSE_MOCKING
+#include "mpool_sys_ut.h"
+#endif /* HSE_MOCKING */
+
+#endif /* MPOOL_SYS_H */
@@ -136,7 +136,20 @@ bonsai_val_ulen(const struct bonsai_val *bv)
 static HSE_ALWAYS_INLINE uint
 bonsai_val_clen(const struct bonsai_val *bv)
 {
-    return bv->bv_xlen >> 32;
+    return (bv->bv_xlen >> 32) & 0x7ffffffful;
+}
+
+/**
+ * bonsai_val_is_mopnd() - return true if the value is a merge operand
+ * @bv: ptr to a bonsai val
+ *
+ * Merge operands are flagged by the most significant bit of @bv_xlen
+ * (see HSE_CORE_XLEN_MOPND).
+ */
+static HSE_ALWAYS_INLINE bool
+bonsai_val_is_mopnd(const struct bonsai_val *bv)
+{
+    return bv->bv_xlen >> 63;
 }
 
 /**
@@ -178,7 +191,7 @@ struct bonsai_sval {
 static HSE_ALWAYS_INLINE uint
 bonsai_sval_vlen(const struct bonsai_sval *bsv)
 {
-    uint clen = bsv->bsv_xlen >> 32;
+    uint clen = (bsv->bsv_xlen >> 32) & 0x7ffffffful;
     uint vlen = bsv->bsv_xlen & 0xfffffffful;
 
     return clen ?: vlen;
@@ -99,6 +99,22 @@ dt_add(struct dt_element *dte);
 merr_t
 dt_access(const char *path, dt_access_t access, void *ctx);
 
+/** @brief Access each data tree element under the given path.
+ *
+ * @param path Element path prefix.
+ * @param access Access function to call for each element.
+ * @param ctx Function call context.
+ *
+ * Iteration stops at the first element for which @p access returns an error.
+ *
+ * @returns Error status.
+ * @return 0 - Success.
+ * @return EINVAL - Bad arguments.
+ * @return ENAMETOOLONG - Path is too long.
+ */
+merr_t
+dt_iterate(const char *path, dt_access_t access, void *ctx);
+
 /** @brief Count children of the specified data tree element.
  *
  * @param path Element path.
@@ -12,6 +12,7 @@
 #include <hse/util/assert.h>
 #include <hse/util/atomic.h>
 #include <hse/util/data_tree.h>
+#include <hse/util/log2.h>
 #include <hse/util/platform.h>
 #include <hse/util/timer.h>
 
@@ -30,6 +31,10 @@
  * PERFC_IVL_MAX            max bounds in a distribution counter
  * PERFC_GRP_MAX            max cpu groups in a distribution counter
  * PERFC_PCT_SCALE          power-of-two scaling factor for pdi_pct
+ * PERFC_HDR_SUBBITS        log2 of the number of linear sub-buckets per power of two
+ * PERFC_HDR_EXPMAX         largest power of two tracked by a log-linear histogram
+ * PERFC_HDR_BKTS           number of buckets in a log-linear histogram
+ * PERFC_HDR_GRP_MAX        max cpu groups in a log-linear histogram
  */
 #define PERFC_VALPERCNT     (128)
 #define PERFC_VALPERCPU     (HSE_ACP_LINESIZE / sizeof(struct perfc_val))
@@ -39,6 +44,11 @@
     ((PERFC_VALPERCNT * HSE_ACP_LINESIZE) / ((PERFC_IVL_MAX + 1) * sizeof(struct perfc_bkt)))
 
 #define PERFC_PCT_SCALE     (1u << 20)
+#define PERFC_HDR_SUBBITS   (3)
+#define PERFC_HDR_SUBCNT    (1u << PERFC_HDR_SUBBITS)
+#define PERFC_HDR_EXPMAX    (47)
+#define PERFC_HDR_BKTS      (PERFC_HDR_SUBCNT * (PERFC_HDR_EXPMAX - PERFC_HDR_SUBBITS + 2))
+#define PERFC_HDR_GRP_MAX   (8)
 #define PERFC_CTRS_MAX      (64)
 
 #define PERFC_DT_PATH       "/data/perfc"
@@ -521,10 +531,23 @@ struct perfc_rate {
 
 /**
  * struct perfc_dis - distribution/latency counter
- * @pdi_hdr:    base counter object
- * @pdi_min:    overall minimum value in distribution
- * @pdi_max:    overall maximum value in distribution
- * @pdi_ivl:    distribution bucket bounds
+ * @pdi_hdr:      base counter object
+ * @pdi_min:      overall minimum value in distribution
+ * @pdi_max:      overall maximum value in distribution
+ * @pdi_ivl:      distribution bucket bounds
+ * @pdi_hdrv:     per-cpu group log-linear histogram buckets, or NULL
+ * @pdi_hdrbase:  histogram bucket totals as of the last interval reset
+ * @pdi_hdrreset: time of the last interval reset (nsecs)
+ * @pdi_hitbase:  total number of samples as of the last interval reset
+ * @pdi_sumbase:  sum of all samples as of the last interval reset
+ *
+ * Each sample is recorded both into the bucket given by @pdi_ivl and
+ * into a log-linear histogram from which percentiles are computed.
+ * The log-linear histogram has PERFC_HDR_SUBCNT linear sub-buckets per
+ * power of two, which bounds the error of a reported percentile to
+ * one part in PERFC_HDR_SUBCNT.  Only counters enabled when the set
+ * is allocated have a histogram.  @pdi_hdrbase, @pdi_hitbase and
+ * @pdi_sumbase are updated only under the data tree lock.
  *
  * perfc_dis "is-a" perfc_ctr_hdr.
  */
@@ -534,6 +557,11 @@ struct perfc_dis {
     uint64_t pdi_min;
     uint64_t pdi_max;
     const struct perfc_ivl *pdi_ivl;
+    atomic_ulong *pdi_hdrv;
+    uint64_t *pdi_hdrbase;
+    uint64_t pdi_hdrreset;
+    uint64_t pdi_hitbase;
+    uint64_t pdi_sumbase;
 };
 
 /**
@@ -614,6 +642,61 @@ perfc_lat_record_impl(struct perfc_dis *dis, uint64_t sample);
 void
 perfc_dis_record_impl(struct perfc_dis *dis, uint64_t sample);
 
+/**
+ * perfc_hdr_bkt() - map a sample to its log-linear histogram bucket
+ * @sample:   sample value
+ *
+ * Samples smaller than PERFC_HDR_SUBCNT each have their own bucket,
+ * larger samples share a bucket with all values having the same
+ * PERFC_HDR_SUBBITS most significant bits.
+ */
+static HSE_ALWAYS_INLINE uint
+perfc_hdr_bkt(uint64_t sample)
+{
+    uint e;
+
+    if (sample < PERFC_HDR_SUBCNT)
+        return sample;
+
+    e = ilog2(sample);
+    if (e > PERFC_HDR_EXPMAX)
+        return PERFC_HDR_BKTS - 1;
+
+    return (e - PERFC_HDR_SUBBITS + 1) * PERFC_HDR_SUBCNT +
+           ((sample >> (e - PERFC_HDR_SUBBITS)) & (PERFC_HDR_SUBCNT - 1));
+}
+
+/**
+ * perfc_hdr_value() - return the highest value mapped to a histogram bucket
+ * @bkt:   bucket index
+ */
+uint64_t
+perfc_hdr_value(uint bkt);
+
+/**
+ * perfc_hdr_percentile() - compute a percentile from histogram bucket totals
+ * @bktv:   vector of PERFC_HDR_BKTS bucket totals
+ * @hits:   sum of all elements in %bktv
+ * @pct:    percentile in the range (0, 100]
+ *
+ * Return: the highest value equivalent to the sample at the given percentile,
+ * or zero if %hits is zero
+ */
+uint64_t
+perfc_hdr_percentile(const uint64_t *bktv, uint64_t hits, double pct);
+
+/**
+ * perfc_interval_reset() - start a new percentile interval
+ * @path:   data tree path prefix of the counter sets to reset
+ *
+ * Percentiles reported over the interval of each dis/lat counter whose
+ * set lives under %path are subsequently computed from only the samples
+ * recorded after this call.
+ */
+/* MTF_MOCK */
+merr_t
+perfc_interval_reset(const char *path);
+
 /**
  * perfc_read() - return sum totals of all operations made to a counter
  * @pcs:    perfc counter set handle
@@ -628,6 +711,27 @@ perfc_dis_record_impl(struct perfc_dis *dis, uint64_t sample);
 void
 perfc_read(struct perfc_set *pcs, const uint32_t cidx, uint64_t *vadd, uint64_t *vsub);
 
+/**
+ * perfc_dis_read() - return the number and sum of samples of a dis/lat counter
+ * @seti:     counter set instance
+ * @cidx:     counter index
+ * @interval: count only the samples recorded since the last interval reset
+ * @hits:     (output) number of samples
+ * @sum:      (output) sum of the samples
+ *
+ * Intended for callers that visit counter sets via dt_iterate(), which
+ * must hold the data tree lock for %interval to be meaningful.
+ *
+ * Return: time of the last interval reset (nsecs)
+ */
+uint64_t
+perfc_dis_read(
+    const struct perfc_seti *seti,
+    uint32_t cidx,
+    bool interval,
+    uint64_t *hits,
+    uint64_t *sum);
+
 /* [HSE_REVISIT] Add unit tests for all these predicates...
  */
 /* GCOV_EXCL_START */
@@ -0,0 +1,170 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#ifndef HSE_UTIL_RTRACE_H
+#define HSE_UTIL_RTRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <hse/util/arch.h>
+#include <hse/util/compiler.h>
+
+/* clang-format off */
+
+/* RTRACE_SPAN_MAX      max spans recorded per traced request
+ * RTRACE_RING_MAX      number of completed traces retained (power of two)
+ */
+#define RTRACE_SPAN_MAX     (32)
+#define RTRACE_RING_MAX     (1024)
+
+/* If you perturb rtrace_op or rtrace_ev then be certain to update
+ * rtrace_op2name[] and rtrace_ev2name[] to match.
+ */
+enum rtrace_op {
+    RTRACE_OP_GET,
+    RTRACE_OP_PUT,
+    RTRACE_OP_CURSOR_READ,
+    RTRACE_OP_MAX,
+};
+
+enum rtrace_ev {
+    RTRACE_EV_C0,
+    RTRACE_EV_LC,
+    RTRACE_EV_CN,
+    RTRACE_EV_BLOOM,
+    RTRACE_EV_WBT,
+    RTRACE_EV_VALUE,
+    RTRACE_EV_MBREAD,
+    RTRACE_EV_THROTTLE,
+    RTRACE_EV_CURSOR_SEEK,
+    RTRACE_EV_CURSOR_MERGE,
+    RTRACE_EV_MAX,
+};
+
+/* clang-format on */
+
+/**
+ * struct rtrace_span - one timed phase of a traced request
+ * @rs_off: start of the phase relative to the start of the request (cycles)
+ * @rs_dur: duration of the phase (cycles)
+ * @rs_ev:  phase type (enum rtrace_ev)
+ */
+struct rtrace_span {
+    uint64_t rs_off;
+    uint64_t rs_dur;
+    uint32_t rs_ev;
+};
+
+/**
+ * struct rtrace_rec - a traced request
+ * @rr_start: wall clock start time of the request (nsecs)
+ * @rr_cyc:   start time of the request (cycles)
+ * @rr_dur:   duration of the request (cycles)
+ * @rr_tid:   ID of the thread that issued the request
+ * @rr_op:    request type (enum rtrace_op)
+ * @rr_spanc: number of spans in @rr_spanv[]
+ * @rr_spanv: phases of the request, in order of completion
+ */
+struct rtrace_rec {
+    uint64_t rr_start;
+    uint64_t rr_cyc;
+    uint64_t rr_dur;
+    int32_t rr_tid;
+    uint16_t rr_op;
+    uint16_t rr_spanc;
+    struct rtrace_span rr_spanv[RTRACE_SPAN_MAX];
+};
+
+/**
+ * struct rtrace_tls - per-thread trace context
+ * @rt_active: the current request on this thread is being traced
+ * @rt_nest:   depth of nested rtrace_begin() calls
+ * @rt_rec:    trace record under construction
+ */
+struct rtrace_tls {
+    bool rt_active;
+    uint rt_nest;
+    struct rtrace_rec rt_rec;
+};
+
+extern thread_local struct rtrace_tls rtrace_tls;
+
+/**
+ * rtrace_begin() - start a request, which may be selected for tracing
+ * @op:  request type
+ *
+ * Requests are selected for tracing at the rate given by the
+ * "rtrace.sample_ppm" global parameter (parts per million).
+ * Nested requests are traced as part of the outermost request.
+ */
+void
+rtrace_begin(enum rtrace_op op);
+
+/**
+ * rtrace_end() - finish a request and publish its trace, if any
+ */
+void
+rtrace_end(void);
+
+/**
+ * rtrace_active() - test whether the current request is being traced
+ */
+static HSE_ALWAYS_INLINE bool
+rtrace_active(void)
+{
+    return HSE_UNLIKELY(rtrace_tls.rt_active);
+}
+
+/**
+ * rtrace_span_start() - acquire a span start time
+ *
+ * Each call tests a thread-local flag even when tracing is disabled, so
+ * hot paths that record several spans should test rtrace_active() once
+ * and skip the spans altogether when it's false.
+ *
+ * Return: 0 if the current request is not being traced, otherwise
+ * the current time in cycles
+ */
+static HSE_ALWAYS_INLINE uint64_t
+rtrace_span_start(void)
+{
+    return rtrace_active() ? get_cycles() : 0;
+}
+
+void
+rtrace_span_record_impl(enum rtrace_ev ev, uint64_t start);
+
+/**
+ * rtrace_span_record() - record a span of the current request
+ * @ev:     phase type
+ * @start:  start time obtained from rtrace_span_start()
+ */
+static HSE_ALWAYS_INLINE void
+rtrace_span_record(enum rtrace_ev ev, uint64_t start)
+{
+    if (HSE_UNLIKELY(start))
+        rtrace_span_record_impl(ev, start);
+}
+
+/**
+ * rtrace_read() - copy out the most recently published traces
+ * @recv:  vector in which to store the traces
+ * @recc:  number of elements in %recv
+ *
+ * Traces that are being overwritten while they are read are skipped.
+ *
+ * Return: number of traces stored in %recv, oldest first
+ */
+uint
+rtrace_read(struct rtrace_rec *recv, uint recc);
+
+/**
+ * rtrace_reset() - discard all published traces
+ */
+void
+rtrace_reset(void);
+
+#endif
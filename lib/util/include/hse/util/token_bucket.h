@@ -61,6 +61,30 @@ tbkt_rate_get(struct tbkt *self);
 void
 tbkt_adjust(struct tbkt *self, uint64_t burst, uint64_t rate);
 
+/**
+ * tbkt_reinit() - reset an initialized bucket as tbkt_init() would
+ *
+ * Unlike tbkt_adjust(), which carries the balance over, the bucket starts
+ * out full with a fresh refill time.  Unlike tbkt_init(), it is safe to
+ * call while other threads are drawing on the bucket.
+ */
+/* MTF_MOCK */
+void
+tbkt_reinit(struct tbkt *self, uint64_t burst, uint64_t rate);
+
+/**
+ * tbkt_throttle() - withdraw tokens and sleep off any resulting debt
+ */
+static inline void
+tbkt_throttle(struct tbkt *self, uint64_t tokens)
+{
+    uint64_t now, delay;
+
+    delay = tbkt_request(self, tokens, &now);
+    if (delay > 0)
+        tbkt_delay(delay);
+}
+
 #if HSE_MOCKING
 #include "token_bucket_ut.h"
 #endif /* HSE_MOCKING */
@@ -13,12 +13,14 @@
  *   https://github.com/torvalds/linux/blob/master/Documentation/workqueue.txt
  */
 
+#include <hse/util/atomic.h>
 #include <hse/util/condvar.h>
 #include <hse/util/list.h>
 #include <hse/util/timer.h>
 
 #define WQ_MAX_ACTIVE (128)
 #define WQ_DFL_ACTIVE (WQ_MAX_ACTIVE / 8)
+#define WQ_SHARDS_MAX (16)
 
 struct work_struct;
 struct workqueue_struct;
@@ -28,6 +30,7 @@ typedef void (*work_func_t)(struct work_struct *work);
 struct work_struct {
     struct list_head entry; /* linked list of pending work */
     work_func_t func;       /* function to be executed */
+    atomic_int pending;     /* queued or delayed, not yet dispatched */
 };
 
 struct delayed_work {
@@ -36,10 +39,11 @@ struct delayed_work {
     struct workqueue_struct *wq;
 };
 
-#define INIT_WORK(_work, _func)          \
-    do {                                 \
-        (_work)->func = (_func);         \
-        INIT_LIST_HEAD(&(_work)->entry); \
+#define INIT_WORK(_work, _func)           \
+    do {                                  \
+        (_work)->func = (_func);          \
+        INIT_LIST_HEAD(&(_work)->entry);  \
+        atomic_set(&(_work)->pending, 0); \
     } while (0)
 
 #define INIT_DELAYED_WORK(_dwork, _func)                                \
@@ -361,6 +361,41 @@ out:
     return err;
 }
 
+merr_t
+dt_iterate(const char * const path, dt_access_t access, void * const ctx)
+{
+    merr_t err = 0;
+    size_t path_len;
+    struct dt_element *dte;
+
+    if (!path || !access)
+        return merr(EINVAL);
+
+    path_len = strlen(path);
+    if (path_len >= DT_PATH_MAX)
+        return merr(ENAMETOOLONG);
+
+    dt_lock();
+
+    dte = dt_find(path, path_len, false);
+    while (dte) {
+        struct rb_node *node;
+
+        err = access(dte->dte_data, ctx);
+        if (err)
+            break;
+
+        node = rb_next(&dte->dte_node);
+        dte = container_of(node, struct dt_element, dte_node);
+        if (dte && strncmp(path, dte->dte_path, path_len))
+            break;
+    }
+
+    dt_unlock();
+
+    return err;
+}
+
 unsigned int
 dt_count(const char * const path)
 {
@@ -81,6 +81,122 @@ perfc_ra_emit(struct perfc_rate * const rate, cJSON * const ctr)
     return !bad;
 }
 
+static const double perfc_hdr_pctv[] = { 50, 90, 99, 99.9, 99.99 };
+static const char * const perfc_hdr_pctnamev[] = { "p50", "p90", "p99", "p99.9", "p99.99" };
+
+uint64_t
+perfc_hdr_value(uint bkt)
+{
+    uint e, sub;
+
+    if (bkt < PERFC_HDR_SUBCNT)
+        return bkt;
+
+    e = bkt / PERFC_HDR_SUBCNT + PERFC_HDR_SUBBITS - 1;
+    sub = bkt % PERFC_HDR_SUBCNT;
+
+    return ((uint64_t)(PERFC_HDR_SUBCNT + sub + 1) << (e - PERFC_HDR_SUBBITS)) - 1;
+}
+
+uint64_t
+perfc_hdr_percentile(const uint64_t *bktv, uint64_t hits, double pct)
+{
+    uint64_t target, sum = 0;
+    double exact;
+
+    if (hits == 0)
+        return 0;
+
+    /* Find the bucket containing the ceil(pct * hits / 100)'th sample.
+     */
+    exact = pct * hits / 100;
+    target = exact;
+    if (target < exact)
+        ++target;
+    target = clamp_t(uint64_t, target, 1, hits);
+
+    for (uint i = 0; i < PERFC_HDR_BKTS; ++i) {
+        sum += bktv[i];
+        if (sum >= target)
+            return perfc_hdr_value(i);
+    }
+
+    return perfc_hdr_value(PERFC_HDR_BKTS - 1);
+}
+
+/* Sum the per-cpu group histograms into bktv[] and return the total.
+ */
+static uint64_t
+perfc_hdr_read(const struct perfc_dis *dis, uint64_t *bktv)
+{
+    uint64_t hits = 0;
+
+    for (uint i = 0; i < PERFC_HDR_BKTS; ++i) {
+        const atomic_ulong *bkt = dis->pdi_hdrv + i;
+
+        bktv[i] = 0;
+        for (uint j = 0; j < PERFC_HDR_GRP_MAX; ++j) {
+            bktv[i] += atomic_read(bkt);
+            bkt += PERFC_HDR_BKTS;
+        }
+
+        hits += bktv[i];
+    }
+
+    return hits;
+}
+
+static bool
+perfc_hdr_emit_pct(const uint64_t *bktv, uint64_t hits, cJSON * const obj)
+{
+    cJSON *pct;
+    bool bad;
+
+    bad = !cJSON_AddNumberToObject(obj, "hits", hits);
+
+    pct = cJSON_AddObjectToObject(obj, "percentiles");
+    if (ev(!pct))
+        return false;
+
+    for (size_t i = 0; i < NELEM(perfc_hdr_pctv); ++i) {
+        uint64_t val = perfc_hdr_percentile(bktv, hits, perfc_hdr_pctv[i]);
+
+        bad |= !cJSON_AddNumberToObject(pct, perfc_hdr_pctnamev[i], val);
+    }
+
+    return !bad;
+}
+
+/* Emit percentiles over all samples ever recorded, and over only
+ * those recorded since the last call to perfc_interval_reset().
+ */
+static bool
+perfc_hdr_emit(const struct perfc_dis * const dis, cJSON * const ctr)
+{
+    uint64_t bktv[PERFC_HDR_BKTS];
+    uint64_t hits, ihits = 0;
+    cJSON *ivl;
+    bool bad;
+
+    hits = perfc_hdr_read(dis, bktv);
+
+    bad = !perfc_hdr_emit_pct(bktv, hits, ctr);
+
+    for (uint i = 0; i < PERFC_HDR_BKTS; ++i) {
+        bktv[i] -= min_t(uint64_t, bktv[i], dis->pdi_hdrbase[i]);
+        ihits += bktv[i];
+    }
+
+    ivl = cJSON_AddObjectToObject(ctr, "interval");
+    if (ev(!ivl))
+        return false;
+
+    bad |= !cJSON_AddNumberToObject(ivl, "delta_ns", get_time_ns() - dis->pdi_hdrreset);
+    bad |= !perfc_hdr_emit_pct(bktv, ihits, ivl);
+
+    return !bad;
+}
+
 static bool
 perfc_di_emit(struct perfc_dis * const dis, cJSON * const ctr)
 {
@@ -146,6 +262,12 @@ perfc_di_emit(struct perfc_dis * const dis, cJSON * const ctr)
     bad |=
         !cJSON_AddNumberToObject(ctr, "percentage", dis->pdi_pct * 100 / (1.0 * PERFC_PCT_SCALE));
 
+    if (!bad && dis->pdi_hdrv) {
+        cJSON *hdr = cJSON_AddObjectToObject(ctr, "log_linear");
+
+        bad = !hdr || !perfc_hdr_emit(dis, hdr);
+    }
+
 out:
     if (bad)
         cJSON_Delete(ctr);
@@ -171,6 +293,62 @@ perfc_read_hdr(struct perfc_ctr_hdr *hdr, uint64_t *vadd, uint64_t *vsub)
     }
 }
 
+/* Sum the per-cpu group buckets of a dis/lat counter.
+ */
+static void
+perfc_dis_totals(const struct perfc_dis *dis, uint64_t *hits, uint64_t *sum)
+{
+    const struct perfc_bkt *bkt = dis->pdi_hdr.pch_bktv;
+
+    *hits = *sum = 0;
+
+    for (uint j = 0; j < PERFC_GRP_MAX; ++j) {
+        for (uint i = 0; i < dis->pdi_ivl->ivl_cnt + 1; ++i) {
+            *sum += atomic_read(&bkt[i].pcb_vadd);
+            *hits += atomic_read(&bkt[i].pcb_hits);
+        }
+
+        bkt += PERFC_IVL_MAX + 1;
+    }
+}
+
+static merr_t
+perfc_interval_reset_cb(void *data, void *ctx)
+{
+    struct perfc_seti *seti = data;
+    uint64_t now = *(uint64_t *)ctx;
+
+    /* The /data/perfc root element has no counter set.
+     */
+    if (!seti)
+        return 0;
+
+    for (uint32_t cidx = 0; cidx < seti->pcs_ctrc; cidx++) {
+        struct perfc_dis *dis = &seti->pcs_ctrv[cidx].dis;
+        enum perfc_type type = dis->pdi_hdr.pch_type;
+
+        if (type == PERFC_TYPE_DI || type == PERFC_TYPE_LT) {
+            if (dis->pdi_hdrv)
+                perfc_hdr_read(dis, dis->pdi_hdrbase);
+            perfc_dis_totals(dis, &dis->pdi_hitbase, &dis->pdi_sumbase);
+            dis->pdi_hdrreset = now;
+        }
+    }
+
+    return 0;
+}
+
+merr_t
+perfc_interval_reset(const char *path)
+{
+    uint64_t now = get_time_ns();
+
+    if (ev(!path || strncmp(path, PERFC_DT_PATH, strlen(PERFC_DT_PATH))))
+        return merr(EINVAL);
+
+    return dt_iterate(path, perfc_interval_reset_cb, &now);
+}
+
 void
 perfc_read(struct perfc_set *pcs, const uint32_t cidx, uint64_t *vadd, uint64_t *vsub)
 {
@@ -181,6 +359,32 @@ perfc_read(struct perfc_set *pcs, const uint32_t cidx, uint64_t *vadd, uint64_t
         perfc_read_hdr(&pcsi->pcs_ctrv[cidx].hdr, vadd, vsub);
 }
 
+uint64_t
+perfc_dis_read(
+    const struct perfc_seti *seti,
+    uint32_t cidx,
+    bool interval,
+    uint64_t *hits,
+    uint64_t *sum)
+{
+    const struct perfc_dis *dis;
+
+    INVARIANT(seti);
+    INVARIANT(cidx < seti->pcs_ctrc);
+
+    dis = &seti->pcs_ctrv[cidx].dis;
+    assert(dis->pdi_hdr.pch_type == PERFC_TYPE_DI || dis->pdi_hdr.pch_type == PERFC_TYPE_LT);
+
+    perfc_dis_totals(dis, hits, sum);
+
+    if (interval) {
+        *hits -= min_t(uint64_t, *hits, dis->pdi_hitbase);
+        *sum -= min_t(uint64_t, *sum, dis->pdi_sumbase);
+    }
+
+    return dis->pdi_hdrreset;
+}
+
 static size_t
 perfc_emit_handler_ctrset(struct dt_element * const dte, cJSON * const root)
 {
@@ -503,8 +707,9 @@ perfc_alloc_impl(
     struct perfc_seti *seti = NULL;
     struct dt_element *dte = NULL;
     char path[DT_PATH_MAX];
-    void *valdata, *valcur;
-    size_t valdatasz, sz;
+    void *valdata, *valcur, *hdrdata;
+    size_t valdatasz, hdrsz, sz;
+    uint32_t hdrc;
     size_t familylen;
     merr_t err = 0;
     uint32_t n, i;
@@ -601,16 +806,26 @@ perfc_alloc_impl(
     sz = sizeof(*seti) + sizeof(seti->pcs_ctrv[0]) * ctrc;
     sz = roundup(sz, HSE_ACP_LINESIZE);
 
-    for (n = i = 0; i < ctrc; ++i) {
+    /* Only the enabled dis/lat counters get a log-linear histogram, as a
+     * counter's enablement is fixed for the life of the set and each
+     * histogram is much larger than the counter's own buckets.
+     */
+    for (n = hdrc = i = 0; i < ctrc; ++i) {
         enum perfc_type type = typev[i];
 
         if (!(type == PERFC_TYPE_DI || type == PERFC_TYPE_LT))
             ++n;
+        else if (prio >= ctrv[i].pcn_prio)
+            ++hdrc;
     }
 
+    hdrsz = sizeof(uint64_t) * PERFC_HDR_BKTS * (PERFC_HDR_GRP_MAX + 1);
+    hdrsz = ALIGN(hdrsz, HSE_ACP_LINESIZE);
+
     n = ctrc - n + (roundup(n, 4) / 4) + 1;
 
     valdatasz = sizeof(struct perfc_val) * PERFC_VALPERCNT * PERFC_VALPERCPU * n + 1;
+    valdatasz = ALIGN(valdatasz, HSE_ACP_LINESIZE) + hdrsz * hdrc;
 
     seti = aligned_alloc(HSE_ACP_LINESIZE, ALIGN(sz + valdatasz, HSE_ACP_LINESIZE));
     if (!seti) {
@@ -627,6 +842,7 @@ perfc_alloc_impl(
     seti->pcs_ctrc = ctrc;
 
     valdata = (char *)seti + sz;
+    hdrdata = valdata + valdatasz - hdrsz * hdrc;
     valcur = NULL;
     n = 0;
 
@@ -662,6 +878,14 @@ perfc_alloc_impl(
             dis->pdi_pct = entry->pcn_samplepct * PERFC_PCT_SCALE / 100;
             dis->pdi_ivl = ivl;
 
+            if (setp->ps_bitmap & (1ULL << i)) {
+                dis->pdi_hdrv = hdrdata;
+                dis->pdi_hdrbase = hdrdata + sizeof(uint64_t) * PERFC_HDR_BKTS * PERFC_HDR_GRP_MAX;
+                hdrdata += hdrsz;
+            }
+
+            dis->pdi_hdrreset = get_time_ns();
+
             pch->pch_bktv = valdata;
             valdata += sizeof(struct perfc_val) * PERFC_VALPERCNT * PERFC_VALPERCPU;
         } else {
@@ -733,15 +957,24 @@ static HSE_ALWAYS_INLINE void
 perfc_latdis_record(struct perfc_dis *dis, uint64_t sample)
 {
     struct perfc_bkt *bkt;
+    atomic_ulong *hdr;
     uint32_t i;
+    uint cpu;
 
     if (sample > dis->pdi_max)
         dis->pdi_max = sample;
     else if ((sample < dis->pdi_min) || (dis->pdi_min == 0))
         dis->pdi_min = sample;
 
+    cpu = hse_getcpu(NULL);
+
+    if (dis->pdi_hdrv) {
+        hdr = dis->pdi_hdrv + (cpu % PERFC_HDR_GRP_MAX) * PERFC_HDR_BKTS;
+        atomic_inc(hdr + perfc_hdr_bkt(sample));
+    }
+
     bkt = dis->pdi_hdr.pch_bktv;
-    bkt += (hse_getcpu(NULL) % PERFC_GRP_MAX) * (PERFC_IVL_MAX + 1);
+    bkt += (cpu % PERFC_GRP_MAX) * (PERFC_IVL_MAX + 1);
 
     /* Index into ivl_map[] with ilog2(sample) to skip buckets whose bounds
      * are smaller than sample.  Note that we constrain sample to produce an
@@ -0,0 +1,325 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include <unistd.h>
+
+#include <cjson/cJSON.h>
+
+#include <hse/ikvdb/hse_gparams.h>
+#include <hse/rest/headers.h>
+#include <hse/rest/params.h>
+#include <hse/rest/request.h>
+#include <hse/rest/response.h>
+#include <hse/rest/status.h>
+#include <hse/util/assert.h>
+#include <hse/util/atomic.h>
+#include <hse/util/event_counter.h>
+#include <hse/util/minmax.h>
+#include <hse/util/platform.h>
+#include <hse/util/rtrace.h>
+#include <hse/util/xrand.h>
+
+static_assert(
+    (RTRACE_RING_MAX & (RTRACE_RING_MAX - 1)) == 0, "RTRACE_RING_MAX must be a power of two");
+
+static const char * const rtrace_op2name[] = {
+    "get",
+    "put",
+    "cursor_read",
+};
+
+static const char * const rtrace_ev2name[] = {
+    "c0", "lc", "cn", "bloom", "wbt", "value", "mblock_read", "throttle",
+    "cursor_seek", "cursor_merge",
+};
+
+static_assert(NELEM(rtrace_op2name) == RTRACE_OP_MAX, "rtrace_op2name[] mismatch");
+static_assert(NELEM(rtrace_ev2name) == RTRACE_EV_MAX, "rtrace_ev2name[] mismatch");
+
+/**
+ * struct rtrace_slot - ring buffer slot
+ * @rs_seq: odd while the slot is being written, otherwise twice the
+ *          ring index of the trace in @rs_rec (zero if never written)
+ * @rs_rec: published trace
+ *
+ * Writers claim a slot by swinging @rs_seq from even to odd, and
+ * readers copy @rs_rec out and then discard the copy if @rs_seq
+ * changed in the meantime.
+ */
+struct rtrace_slot {
+    atomic_ulong rs_seq;
+    struct rtrace_rec rs_rec;
+} HSE_L1D_ALIGNED;
+
+static struct {
+    atomic_ulong rg_head HSE_L1D_ALIGNED;
+    atomic_ulong rg_base;
+    struct rtrace_slot rg_slotv[RTRACE_RING_MAX];
+} rtrace_ring;
+
+thread_local struct rtrace_tls rtrace_tls;
+
+static thread_local pid_t rtrace_tid_tls;
+
+void
+rtrace_begin(enum rtrace_op op)
+{
+    struct rtrace_tls *tls = &rtrace_tls;
+    struct rtrace_rec *rec = &tls->rt_rec;
+    uint32_t ppm = hse_gparams.gp_rtrace_ppm;
+
+    if (tls->rt_nest++ > 0)
+        return;
+
+    if (HSE_LIKELY(ppm == 0) || xrand64_tls() % 1000000 >= ppm)
+        return;
+
+    if (HSE_UNLIKELY(!rtrace_tid_tls))
+        rtrace_tid_tls = syscall(SYS_gettid);
+
+    rec->rr_start = get_time_ns();
+    rec->rr_cyc = get_cycles();
+    rec->rr_tid = rtrace_tid_tls;
+    rec->rr_op = op;
+    rec->rr_spanc = 0;
+
+    tls->rt_active = true;
+}
+
+void
+rtrace_span_record_impl(enum rtrace_ev ev, uint64_t start)
+{
+    struct rtrace_rec *rec = &rtrace_tls.rt_rec;
+    struct rtrace_span *span;
+
+    if (!rtrace_tls.rt_active || rec->rr_spanc >= RTRACE_SPAN_MAX)
+        return;
+
+    span = rec->rr_spanv + rec->rr_spanc++;
+    span->rs_off = start - rec->rr_cyc;
+    span->rs_dur = get_cycles() - start;
+    span->rs_ev = ev;
+}
+
+static void
+rtrace_publish(const struct rtrace_rec *rec)
+{
+    struct rtrace_slot *slot;
+    ulong idx, seq;
+
+    idx = atomic_inc_return(&rtrace_ring.rg_head);
+    slot = rtrace_ring.rg_slotv + (idx % RTRACE_RING_MAX);
+
+    /* If another writer lapped the ring and is still writing this
+     * slot then simply drop the trace.
+     */
+    seq = atomic_read(&slot->rs_seq);
+    if ((seq & 1) || !atomic_cas(&slot->rs_seq, seq, seq + 1))
+        return;
+
+    memcpy(&slot->rs_rec, rec, sizeof(*rec) - sizeof(rec->rr_spanv) +
+           sizeof(rec->rr_spanv[0]) * rec->rr_spanc);
+
+    atomic_set_rel(&slot->rs_seq, idx * 2);
+}
+
+void
+rtrace_end(void)
+{
+    struct rtrace_tls *tls = &rtrace_tls;
+
+    assert(tls->rt_nest > 0);
+
+    if (--tls->rt_nest > 0 || !tls->rt_active)
+        return;
+
+    tls->rt_active = false;
+    tls->rt_rec.rr_dur = get_cycles() - tls->rt_rec.rr_cyc;
+
+    rtrace_publish(&tls->rt_rec);
+}
+
+uint
+rtrace_read(struct rtrace_rec *recv, uint recc)
+{
+    ulong head, idx;
+    uint n = 0;
+
+    head = atomic_read(&rtrace_ring.rg_head);
+
+    idx = head > recc ? head - recc + 1 : 1;
+    if (head > RTRACE_RING_MAX)
+        idx = max_t(ulong, idx, head - RTRACE_RING_MAX + 1);
+    idx = max_t(ulong, idx, atomic_read(&rtrace_ring.rg_base) + 1);
+
+    for (; idx <= head; ++idx) {
+        struct rtrace_slot *slot = rtrace_ring.rg_slotv + (idx % RTRACE_RING_MAX);
+        struct rtrace_rec *rec = recv + n;
+        ulong seq;
+
+        seq = atomic_read_acq(&slot->rs_seq);
+        if (seq != idx * 2)
+            continue;
+
+        memcpy(rec, &slot->rs_rec, sizeof(*rec));
+        atomic_thread_fence(memory_order_acquire);
+
+        if (atomic_read(&slot->rs_seq) != seq)
+            continue;
+
+        rec->rr_spanc = min_t(uint, rec->rr_spanc, RTRACE_SPAN_MAX);
+        ++n;
+    }
+
+    return n;
+}
+
+void
+rtrace_reset(void)
+{
+    atomic_set(&rtrace_ring.rg_base, atomic_read(&rtrace_ring.rg_head));
+}
+
+static cJSON *
+rtrace_event_create(const char *name, int tid, double ts, double dur)
+{
+    cJSON *ev;
+    bool bad;
+
+    ev = cJSON_CreateObject();
+    if (ev(!ev))
+        return NULL;
+
+    bad = !cJSON_AddStringToObject(ev, "name", name);
+    bad |= !cJSON_AddStringToObject(ev, "cat", "hse");
+    bad |= !cJSON_AddStringToObject(ev, "ph", "X");
+    bad |= !cJSON_AddNumberToObject(ev, "ts", ts);
+    bad |= !cJSON_AddNumberToObject(ev, "dur", dur);
+    bad |= !cJSON_AddNumberToObject(ev, "pid", getpid());
+    bad |= !cJSON_AddNumberToObject(ev, "tid", tid);
+
+    if (ev(bad)) {
+        cJSON_Delete(ev);
+        return NULL;
+    }
+
+    return ev;
+}
+
+/* Emit traces in the Chrome trace event format (complete events with
+ * microsecond timestamps), which can be loaded directly into
+ * chrome://tracing or Perfetto.
+ */
+static merr_t
+rtrace_emit(const struct rtrace_rec *recv, uint recc, cJSON *events)
+{
+    for (uint i = 0; i < recc; ++i) {
+        const struct rtrace_rec *rec = recv + i;
+        double ts = rec->rr_start / 1000.0;
+        cJSON *ev;
+
+        ev = rtrace_event_create(
+            rtrace_op2name[rec->rr_op % RTRACE_OP_MAX], rec->rr_tid, ts,
+            cycles_to_nsecs(rec->rr_dur) / 1000.0);
+        if (!ev || !cJSON_AddItemToArray(events, ev)) {
+            cJSON_Delete(ev);
+            return merr(ENOMEM);
+        }
+
+        for (uint j = 0; j < rec->rr_spanc; ++j) {
+            const struct rtrace_span *span = rec->rr_spanv + j;
+
+            ev = rtrace_event_create(
+                rtrace_ev2name[span->rs_ev % RTRACE_EV_MAX], rec->rr_tid,
+                ts + cycles_to_nsecs(span->rs_off) / 1000.0,
+                cycles_to_nsecs(span->rs_dur) / 1000.0);
+            if (!ev || !cJSON_AddItemToArray(events, ev)) {
+                cJSON_Delete(ev);
+                return merr(ENOMEM);
+            }
+        }
+    }
+
+    return 0;
+}
+
+enum rest_status
+rest_get_rtrace(
+    const struct rest_request * const req,
+    struct rest_response * const resp,
+    void * const arg)
+{
+    struct rtrace_rec *recv;
+    cJSON *root, *events;
+    bool pretty, reset;
+    enum rest_status status = REST_STATUS_OK;
+    merr_t err;
+    char *data;
+    uint recc;
+
+    err = rest_params_get(req->rr_params, "pretty", &pretty, false);
+    if (ev(err))
+        return rest_response_perror(
+            resp, REST_STATUS_BAD_REQUEST, "The 'pretty' query parameter must be a boolean",
+            merr(EINVAL));
+
+    err = rest_params_get(req->rr_params, "reset", &reset, false);
+    if (ev(err))
+        return rest_response_perror(
+            resp, REST_STATUS_BAD_REQUEST, "The 'reset' query parameter must be a boolean",
+            merr(EINVAL));
+
+    recv = malloc(sizeof(*recv) * RTRACE_RING_MAX);
+    if (ev(!recv))
+        return rest_response_perror(
+            resp, REST_STATUS_SERVICE_UNAVAILABLE, "Out of memory", merr(ENOMEM));
+
+    recc = rtrace_read(recv, RTRACE_RING_MAX);
+    if (reset)
+        rtrace_reset();
+
+    root = cJSON_CreateObject();
+    if (ev(!root)) {
+        free(recv);
+        return rest_response_perror(
+            resp, REST_STATUS_SERVICE_UNAVAILABLE, "Out of memory", merr(ENOMEM));
+    }
+
+    events = cJSON_AddArrayToObject(root, "traceEvents");
+    if (ev(!events) || ev(!cJSON_AddStringToObject(root, "displayTimeUnit", "ns"))) {
+        status = rest_response_perror(
+            resp, REST_STATUS_SERVICE_UNAVAILABLE, "Out of memory", merr(ENOMEM));
+        goto out;
+    }
+
+    err = rtrace_emit(recv, recc, events);
+    if (ev(err)) {
+        status = rest_response_perror(
+            resp, REST_STATUS_SERVICE_UNAVAILABLE, "Out of memory", err);
+        goto out;
+    }
+
+    data = (pretty ? cJSON_Print : cJSON_PrintUnformatted)(root);
+    if (ev(!data)) {
+        status = rest_response_perror(
+            resp, REST_STATUS_SERVICE_UNAVAILABLE, "Out of memory", merr(ENOMEM));
+        goto out;
+    }
+
+    fputs(data, resp->rr_stream);
+    cJSON_free(data);
+
+    rest_headers_set(resp->rr_headers, REST_HEADER_CONTENT_TYPE, REST_APPLICATION_JSON);
+
+out:
+    cJSON_Delete(root);
+    free(recv);
+
+    return status;
+}
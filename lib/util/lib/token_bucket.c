@@ -158,6 +158,15 @@ tbkt_init(struct tbkt *self, uint64_t burst, uint64_t rate)
     tbkti_init(self, burst, rate);
 }
 
+void
+tbkt_reinit(struct tbkt *self, uint64_t burst, uint64_t rate)
+{
+    spin_lock(&self->tb_lock);
+    tbkti_init(self, burst, rate);
+    self->tb_delay = 0;
+    spin_unlock(&self->tb_lock);
+}
+
 uint64_t
 tbkt_burst_get(struct tbkt *self)
 {
@@ -28,47 +28,73 @@
 #include <hse/util/list.h>
 #include <hse/util/minmax.h>
 #include <hse/util/mutex.h>
+#include <hse/util/page.h>
 #include <hse/util/platform.h>
 #include <hse/util/workqueue.h>
 
 #define WP_LATV_IDX(_wqp) ((_wqp)->wp_calls % NELEM((_wqp)->wp_latv))
 
+/* Every WQ_STEAL_PERIOD dispatches a worker looks at a remote shard
+ * before its home shard (see workqueue_dequeue()).
+ */
+#define WQ_STEAL_PERIOD (16)
+
+/* A worker's current work item is identified by the index of its shard
+ * and its dequeue sequence number within that shard (see wq_flushed()).
+ */
+#define WP_CUR_SHIFT        (56)
+#define WP_CUR(_sidx, _seq) (((ulong)(_sidx) << WP_CUR_SHIFT) | (_seq))
+#define WP_CUR_SIDX(_cur)   ((_cur) >> WP_CUR_SHIFT)
+#define WP_CUR_SEQ(_cur)    ((_cur) & ((1ul << WP_CUR_SHIFT) - 1))
+
 /**
  * struct wq_priv - worker thread private data
  * @wp_wq:     Workqueue
  * @wp_tid:    Thread ID of owner thread
- * @wp_barid:  ID of most recently processed barrier
  * @wp_tstart: Thread start time (nsecs)
  * @wp_cstart: Start time of most recent callback (cycles)
  * @wp_calls:  Total number of callbacks dispatched
  * @wp_wmesgp: Address of thread-local wait message ptr
+ * @wp_cur:    Shard and sequence number of running work, zero if none
  * @wp_latv:   Vector of most recent callback latencies
  */
 struct wq_priv {
     struct list_head wp_link HSE_ACP_ALIGNED;
     void *wp_wq;
     pid_t wp_tid;
-    uint wp_barid;
     ulong wp_tstart;
     ulong wp_cstart;
     ulong wp_calls;
     const char * volatile *wp_wmesgp;
+    atomic_ulong wp_cur;
     ulong wp_latv[8] HSE_L1X_ALIGNED;
 };
 
 /**
- * struct wq_barrier - Barrier work item for flush_workqueue()
+ * struct wq_shard - one of a workqueue's pending work lists
+ * @sh_lock:    lock to protect shard data
+ * @sh_pending: list of work to be dispatched ASAP
+ * @sh_enqc:    number of work items ever appended to @sh_pending
+ * @sh_deqc:    number of work items ever removed from @sh_pending
+ * @sh_cnt:     number of work items in @sh_pending, for lockless peeking
+ * @sh_node:    NUMA node of the most recent submitter
+ *
+ * Submitters append to the shard of the cpu on which they're running,
+ * and worker threads dispatch from the shard of the cpu on which they
+ * are running, stealing from the other shards when it's empty.
  */
-struct wq_barrier {
-    struct work_struct wqb_work;
-    uint wqb_visitors;
-    uint wqb_barid;
+struct wq_shard {
+    struct mutex sh_lock HSE_L1D_ALIGNED;
+    struct list_head sh_pending;
+    ulong sh_enqc;
+    ulong sh_deqc;
+    atomic_int sh_cnt;
+    atomic_uint sh_node;
 };
 
 /**
  * struct workqueue_struct - per-workqueue private data
  * @wq_lock:        lock to protect workqueue data
- * @wq_pending:     list of work to be dispatched ASAP
  * @wq_running:     workqueue is able to dispatch requests
  * @wq_growing:     workqueue is spawning worker threads
  * @wq_refcnt:      references held by long-lived threads and delayed work
@@ -78,15 +104,23 @@ struct wq_barrier {
  * @wq_tdmin:       minimum number of worker threads
  * @wq_barid:       barrier ID generator
  * @wq_tcdelay:     delay in milliseconds between thread-create operations
+ * @wq_idlec:       number of worker threads idle or about to idle
+ * @wq_flushc:      number of threads waiting in flush_workqueue()
+ * @wq_growable:    hint that queue_work() should try to grow the workqueue
  * @wq_idle:        condvar where idle worker threads wait
  * @wq_barrier:     condvar where all threads wait for barrier completion
  * @wq_delayed:     list of work to be dispatched in the future
  * @wq_grow:        timer for grow callback
  * @wq_name:        workqueue name
+ * @wq_shardc:      number of shards in @wq_shardv
+ * @wq_shardv:      vector of pending work lists
+ *
+ * Dispatching work requires only the lock of the shard from which the
+ * work is taken.  @wq_lock is acquired by submitters only to wake an
+ * idle worker or to spawn a new one.
  */
 struct workqueue_struct {
     struct mutex wq_lock HSE_ACP_ALIGNED;
-    struct list_head wq_pending;
     bool wq_running;
     bool wq_growing;
     int wq_refcnt;
@@ -96,11 +130,16 @@ struct workqueue_struct {
     int wq_tdmin;
     uint wq_barid;
     uint wq_tcdelay;
+    atomic_int wq_idlec;
+    atomic_int wq_flushc;
+    atomic_int wq_growable;
     struct cv wq_idle;
     struct cv wq_barrier;
     struct list_head wq_delayed;
     struct timer_list wq_grow;
     char wq_name[16];
+    uint wq_shardc;
+    struct wq_shard wq_shardv[];
 };
 
 struct workqueue_globals {
@@ -119,10 +158,38 @@ dump_workqueue_locked(struct workqueue_struct *wq);
 static void *
 worker_thread(void *arg);
 
-static HSE_ALWAYS_INLINE struct work_struct *
-workqueue_first(struct workqueue_struct *wq)
+static HSE_ALWAYS_INLINE bool
+work_pending(struct work_struct *work)
+{
+    return atomic_read(&work->pending);
+}
+
+static bool
+workqueue_has_work(struct workqueue_struct *wq)
+{
+    for (uint i = 0; i < wq->wq_shardc; ++i) {
+        if (atomic_read(&wq->wq_shardv[i].sh_cnt) > 0)
+            return true;
+    }
+
+    return false;
+}
+
+static int
+workqueue_pending(struct workqueue_struct *wq)
+{
+    int n = 0;
+
+    for (uint i = 0; i < wq->wq_shardc; ++i)
+        n += atomic_read(&wq->wq_shardv[i].sh_cnt);
+
+    return n;
+}
+
+static void
+workqueue_growable_update(struct workqueue_struct *wq)
 {
-    return list_first_entry_or_null(&wq->wq_pending, struct work_struct, entry);
+    atomic_set(&wq->wq_growable, !wq->wq_growing && wq->wq_tdcnt < wq->wq_tdmax);
 }
 
 static void
@@ -136,15 +203,12 @@ grow_workqueue_cb(ulong arg)
 
     mutex_lock(&wq->wq_lock);
     if (rc) {
-        struct work_struct *first = workqueue_first(wq);
-
-        /* If there is a flush in progress then we must awaken all
-         * visitors so that each can re-evaluate the barrier state.
+        /* If there is a flush or destroy in progress then we must awaken
+         * all waiters so that each can re-evaluate the barrier state.
          */
-        if (first && !first->func)
-            cv_broadcast(&wq->wq_barrier);
+        cv_broadcast(&wq->wq_barrier);
 
-        /* Drop references acquired by queue_work_locked()
+        /* Drop references acquired by workqueue_grow_locked()
          * or a follow-on grow attempt (below).
          */
         --wq->wq_refcnt;
@@ -156,7 +220,7 @@ grow_workqueue_cb(ulong arg)
     /* Keep growing if there's pending work and room to grow (might create
      * more threads than are strictly needed depending upon scheduling).
      */
-    wq->wq_growing = workqueue_first(wq) && (wq->wq_tdcnt < wq->wq_tdmax);
+    wq->wq_growing = workqueue_has_work(wq) && (wq->wq_tdcnt < wq->wq_tdmax);
     if (wq->wq_growing) {
         wq->wq_grow.expires = jiffies + wq->wq_tcdelay;
         add_timer(&wq->wq_grow);
@@ -164,6 +228,8 @@ grow_workqueue_cb(ulong arg)
         wq->wq_tdcnt++;
     }
 
+    workqueue_growable_update(wq);
+
     /* Drop our "growing callback" reference.
      */
     --wq->wq_refcnt;
@@ -181,6 +247,8 @@ valloc_workqueue(
     int rc, i;
     pthread_t tid;
     struct workqueue_struct *wq;
+    uint shardc;
+    size_t sz;
 
     mutex_lock(&hse_wg.wg_lock);
     if (!hse_wg.wg_inited) {
@@ -193,20 +261,35 @@ valloc_workqueue(
     max_active = clamp_t(int, max_active, 1, WQ_MAX_ACTIVE);
     min_active = clamp_t(int, min_active, 0, max_active);
 
-    wq = aligned_alloc(__alignof__(*wq), sizeof(*wq));
+    /* Single-threaded workqueues get one shard so that work is
+     * dispatched in the order in which it was submitted.
+     */
+    shardc = min_t(uint, max_active, WQ_SHARDS_MAX);
+
+    sz = sizeof(*wq) + shardc * sizeof(wq->wq_shardv[0]);
+    sz = ALIGN(sz, __alignof__(*wq));
+
+    wq = aligned_alloc(__alignof__(*wq), sz);
     if (ev(!wq))
         return NULL;
 
-    memset(wq, 0, sizeof(*wq));
+    memset(wq, 0, sz);
     vsnprintf(wq->wq_name, sizeof(wq->wq_name), fmt, ap);
 
     mutex_init_adaptive(&wq->wq_lock);
     cv_init(&wq->wq_idle);
     cv_init(&wq->wq_barrier);
 
-    INIT_LIST_HEAD(&wq->wq_pending);
     INIT_LIST_HEAD(&wq->wq_delayed);
 
+    wq->wq_shardc = shardc;
+    for (i = 0; i < shardc; ++i) {
+        struct wq_shard *sh = wq->wq_shardv + i;
+
+        mutex_init_adaptive(&sh->sh_lock);
+        INIT_LIST_HEAD(&sh->sh_pending);
+    }
+
     setup_timer(&wq->wq_grow, grow_workqueue_cb, wq);
     wq->wq_tcdelay = msecs_to_jiffies(1000);
 
@@ -238,6 +321,7 @@ valloc_workqueue(
 
     wq->wq_tdmin = min_active;
     wq->wq_tdmax = max_active;
+    workqueue_growable_update(wq);
     mutex_unlock(&wq->wq_lock);
 
     return wq;
@@ -285,7 +369,7 @@ destroy_workqueue(struct workqueue_struct *wq)
             dump_workqueue_locked(wq);
     }
 
-    assert(list_empty(&wq->wq_pending));
+    assert(!workqueue_has_work(wq));
     assert(list_empty(&wq->wq_delayed));
     assert(wq->wq_tdcnt == 0);
     assert(!wq->wq_growing);
@@ -306,6 +390,9 @@ destroy_workqueue(struct workqueue_struct *wq)
             usleep(333);
     } while (priv);
 
+    for (uint i = 0; i < wq->wq_shardc; ++i)
+        mutex_destroy(&wq->wq_shardv[i].sh_lock);
+
     cv_destroy(&wq->wq_barrier);
     cv_destroy(&wq->wq_idle);
     mutex_destroy(&wq->wq_lock);
@@ -313,74 +400,201 @@ destroy_workqueue(struct workqueue_struct *wq)
     free(wq);
 }
 
-static HSE_ALWAYS_INLINE bool
-work_pending(const struct work_struct *work)
+/* Try to spawn a new worker thread if there does not appear to be enough
+ * workers to handle the load.  Acquire a ref for the grow callback and a
+ * birth ref for the new thread.
+ */
+static void
+workqueue_grow_locked(struct workqueue_struct *wq)
+{
+    if (wq->wq_tdcnt < wq->wq_tdmax && atomic_read(&wq->wq_idlec) == 0) {
+        if (!wq->wq_growing) {
+            wq->wq_grow.expires = jiffies + 1;
+            add_timer(&wq->wq_grow);
+            wq->wq_growing = true;
+            wq->wq_refcnt += 2;
+            wq->wq_tdcnt++;
+        }
+    }
+
+    workqueue_growable_update(wq);
+}
+
+/* Append work to the shard of the calling thread's cpu.  The caller must
+ * have set work->pending.
+ */
+static void
+workqueue_enqueue(struct workqueue_struct *wq, struct work_struct *work)
+{
+    struct wq_shard *sh;
+    uint cpu, node;
+
+    cpu = hse_getcpu(&node);
+    sh = wq->wq_shardv + (cpu % wq->wq_shardc);
+
+    mutex_lock(&sh->sh_lock);
+    list_add_tail(&work->entry, &sh->sh_pending);
+    sh->sh_enqc++;
+    atomic_inc(&sh->sh_cnt);
+    atomic_set(&sh->sh_node, node);
+    mutex_unlock(&sh->sh_lock);
+
+    /* Pairs with the fence in worker_thread() such that either an idling
+     * worker sees the work we just appended or we see the idling worker.
+     */
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (atomic_read(&wq->wq_idlec) > 0) {
+        mutex_lock(&wq->wq_lock);
+        cv_signal(&wq->wq_idle);
+        mutex_unlock(&wq->wq_lock);
+    } else if (atomic_read(&wq->wq_growable)) {
+        mutex_lock(&wq->wq_lock);
+        workqueue_grow_locked(wq);
+        mutex_unlock(&wq->wq_lock);
+    }
+}
+
+static struct work_struct *
+workqueue_shard_pop(struct workqueue_struct *wq, uint sidx, struct wq_priv *priv)
 {
-    return !list_empty(&work->entry);
+    struct wq_shard *sh = wq->wq_shardv + sidx;
+    struct work_struct *work;
+
+    mutex_lock(&sh->sh_lock);
+    work = list_first_entry_or_null(&sh->sh_pending, struct work_struct, entry);
+    if (work) {
+        list_del_init(&work->entry);
+        atomic_dec(&sh->sh_cnt);
+        atomic_set_rel(&priv->wp_cur, WP_CUR(sidx, ++sh->sh_deqc));
+    }
+    mutex_unlock(&sh->sh_lock);
+
+    return work;
 }
 
+/* Take work from the shard of the calling thread's cpu if possible,
+ * otherwise steal from a shard last appended to from the same NUMA
+ * node, and failing that from any shard.
+ *
+ * A home shard that never empties (e.g., work that requeues itself)
+ * would starve the other shards, so every WQ_STEAL_PERIOD dispatches
+ * the scan instead starts at the next remote shard in round-robin
+ * order.  Work on any shard is therefore dispatched within at most
+ * WQ_STEAL_PERIOD * (wq_shardc - 1) dispatches of any one worker.
+ */
+static struct work_struct *
+workqueue_dequeue(struct workqueue_struct *wq, struct wq_priv *priv)
+{
+    struct work_struct *work;
+    uint cpu, node, start;
+
+    cpu = hse_getcpu(&node);
+    start = cpu % wq->wq_shardc;
+
+    if (wq->wq_shardc > 1 && priv->wp_calls % WQ_STEAL_PERIOD == WQ_STEAL_PERIOD - 1) {
+        ulong rr = priv->wp_calls / WQ_STEAL_PERIOD;
+
+        start = (start + 1 + rr % (wq->wq_shardc - 1)) % wq->wq_shardc;
+    }
+
+    for (uint pass = 0; pass < 2; ++pass) {
+        for (uint i = 0; i < wq->wq_shardc; ++i) {
+            uint sidx = (start + i) % wq->wq_shardc;
+            struct wq_shard *sh = wq->wq_shardv + sidx;
+
+            if (atomic_read(&sh->sh_cnt) == 0)
+                continue;
+
+            if (pass == 0 && i > 0 && atomic_read(&sh->sh_node) != node)
+                continue;
+
+            work = workqueue_shard_pop(wq, sidx, priv);
+            if (work)
+                return work;
+        }
+    }
+
+    return NULL;
+}
+
+/* Return true if all the work counted by @enqv has been dispatched
+ * and no worker is still running any of it.
+ */
 static bool
-queue_work_locked(struct workqueue_struct *wq, struct work_struct *work)
+wq_flushed(struct workqueue_struct *wq, const ulong *enqv)
 {
-    bool enqueued;
+    struct wq_priv *priv;
+    bool flushed = true;
 
-    enqueued = !work_pending(work);
-    if (enqueued) {
-        list_add_tail(&work->entry, &wq->wq_pending);
+    for (uint i = 0; i < wq->wq_shardc; ++i) {
+        struct wq_shard *sh = wq->wq_shardv + i;
 
-        /* Try to spawn a new worker thread if there does not appear
-         * to be enough workers to handle the load.  Acquire a ref
-         * for the grow callback and a birth ref for the new thread.
-         */
-        if (wq->wq_tdcnt < wq->wq_tdmax && wq->wq_idle.cv_waiters == 0) {
-            if (!wq->wq_growing) {
-                wq->wq_grow.expires = jiffies + 1;
-                add_timer(&wq->wq_grow);
-                wq->wq_growing = true;
-                wq->wq_refcnt += 2;
-                wq->wq_tdcnt++;
-            }
+        mutex_lock(&sh->sh_lock);
+        flushed = sh->sh_deqc >= enqv[i];
+        mutex_unlock(&sh->sh_lock);
+
+        if (!flushed)
+            return false;
+    }
+
+    mutex_lock(&hse_wg.wg_lock);
+    list_for_each_entry(priv, &hse_wg.wg_tlist, wp_link) {
+        ulong cur;
+
+        if (priv->wp_wq != wq)
+            continue;
+
+        cur = atomic_read_acq(&priv->wp_cur);
+        if (cur && WP_CUR_SEQ(cur) <= enqv[WP_CUR_SIDX(cur)]) {
+            flushed = false;
+            break;
         }
     }
+    mutex_unlock(&hse_wg.wg_lock);
 
-    return enqueued;
+    return flushed;
 }
 
 /**
- * flush_workqueue() - enqueue a barrier and wait for it to complete
+ * flush_workqueue() - wait for all previously queued work to complete
  * @wq:     ptr to workqueue
  *
- * Append a barrier work item to the pending list to prevent work
- * appended after the barrier from being dispatched until all work
- * ahead of the barrier has completed.
+ * Snapshot the number of work items appended to each shard and wait
+ * until each shard has dispatched at least that many items and none
+ * of them is still running.  Work appended after the snapshot is
+ * dispatched as usual while we wait.
  */
 void
 flush_workqueue(struct workqueue_struct *wq)
 {
-    struct wq_barrier barrier;
-    bool enqueued;
+    ulong enqv[WQ_SHARDS_MAX];
 
     if (ev(!wq))
         return;
 
-    INIT_WORK(&barrier.wqb_work, NULL);
+    for (uint i = 0; i < wq->wq_shardc; ++i) {
+        struct wq_shard *sh = wq->wq_shardv + i;
+
+        mutex_lock(&sh->sh_lock);
+        enqv[i] = sh->sh_enqc;
+        mutex_unlock(&sh->sh_lock);
+    }
 
     mutex_lock(&wq->wq_lock);
     ++wq->wq_refcnt;
+    ++wq->wq_barid;
 
-    enqueued = queue_work_locked(wq, &barrier.wqb_work);
-    if (enqueued) {
-        barrier.wqb_barid = ++wq->wq_barid;
-        barrier.wqb_visitors = 0;
-
-        cv_broadcast(&wq->wq_idle);
+    /* Pairs with the fence in worker_thread() such that either we see
+     * the worker's completion or the worker sees us waiting.
+     */
+    atomic_inc(&wq->wq_flushc);
+    atomic_thread_fence(memory_order_seq_cst);
 
-        /* Wait for all workers to visit the barrier.
-         */
-        while (barrier.wqb_visitors < UINT_MAX)
-            cv_wait(&wq->wq_barrier, &wq->wq_lock, "barflush");
-    }
+    while (!wq_flushed(wq, enqv))
+        cv_wait(&wq->wq_barrier, &wq->wq_lock, "barflush");
 
+    atomic_dec(&wq->wq_flushc);
     --wq->wq_refcnt;
     mutex_unlock(&wq->wq_lock);
 }
@@ -392,10 +606,10 @@ flush_workqueue(struct workqueue_struct *wq)
  * This is the workqueue pending list processing loop.  All worker threads
  * stay in this function repeatedly dispatching work until the workqueue
  * is shut down.  At shutdown time, no threads are allowed to exit until
- * the pending list is empty.
+ * all the shards are empty.
  *
  * Note that this is the only function in which work items are removed
- * from the pending list.
+ * from the shards.
  */
 static void *
 worker_thread(void *arg)
@@ -414,7 +628,6 @@ worker_thread(void *arg)
     memset(priv, 0, sizeof(*priv));
     priv->wp_wq = wq;
     priv->wp_tid = syscall(SYS_gettid);
-    priv->wp_barid = 0;
     priv->wp_tstart = get_time_ns();
     priv->wp_cstart = get_cycles();
     priv->wp_calls = 0;
@@ -424,31 +637,17 @@ worker_thread(void *arg)
     list_add_tail(&priv->wp_link, &hse_wg.wg_tlist);
     mutex_unlock(&hse_wg.wg_lock);
 
-    mutex_lock(&wq->wq_lock);
     timedout = 0;
 
     while (1) {
-        struct wq_barrier *barrier;
         struct work_struct *work;
+        bool extra;
 
-        work = workqueue_first(wq);
-        if (!work) {
-            bool extra = wq->wq_tdcnt > wq->wq_tdmin;
-
-            if (!wq->wq_running || (timedout && extra))
-                break;
-
-            /* Sleep a short time if there are extra workers.  If we time out
-             * and still have extra workers after draining the pending queue
-             * then exit (above).  Otherwise, sleep here until signaled.
+        work = workqueue_dequeue(wq, priv);
+        if (work) {
+            /* The work may be requeued (or freed) by its callback.
              */
-            timedout = cv_timedwait(&wq->wq_idle, &wq->wq_lock, extra ? 60000 : -1, "idle");
-            continue;
-        }
-
-        if (work->func) {
-            list_del_init(&work->entry);
-            mutex_unlock(&wq->wq_lock);
+            atomic_set_rel(&work->pending, 0);
 
             priv->wp_cstart = get_cycles();
             priv->wp_calls++;
@@ -458,33 +657,47 @@ worker_thread(void *arg)
             priv->wp_latv[WP_LATV_IDX(priv)] = (get_cycles() - priv->wp_cstart);
             priv->wp_cstart += priv->wp_latv[WP_LATV_IDX(priv)];
 
-            mutex_lock(&wq->wq_lock);
+            atomic_set(&priv->wp_cur, 0);
+            atomic_thread_fence(memory_order_seq_cst);
+
+            if (atomic_read(&wq->wq_flushc) > 0) {
+                mutex_lock(&wq->wq_lock);
+                cv_broadcast(&wq->wq_barrier);
+                mutex_unlock(&wq->wq_lock);
+            }
+
+            timedout = 0;
             continue;
         }
 
-        barrier = container_of(work, struct wq_barrier, wqb_work);
+        mutex_lock(&wq->wq_lock);
+        atomic_inc(&wq->wq_idlec);
 
-        /* Increment the barrier visitor count once for each
-         * thread's first visit to the barrier.
+        /* Pairs with the fence in workqueue_enqueue().
          */
-        if (priv->wp_barid != barrier->wqb_barid) {
-            priv->wp_barid = barrier->wqb_barid;
-            ++barrier->wqb_visitors;
-        }
+        atomic_thread_fence(memory_order_seq_cst);
 
-        /* Wait until all worker threads have visited this barrier.
-         */
-        if (barrier->wqb_visitors < wq->wq_tdcnt) {
-            cv_wait(&wq->wq_barrier, &wq->wq_lock, "barwait");
+        if (workqueue_has_work(wq)) {
+            atomic_dec(&wq->wq_idlec);
+            mutex_unlock(&wq->wq_lock);
             continue;
         }
 
-        /* All threads have visited this barrier, so remove
-         * it and proceed with the next pending work item.
+        extra = wq->wq_tdcnt > wq->wq_tdmin;
+
+        if (!wq->wq_running || (timedout && extra)) {
+            atomic_dec(&wq->wq_idlec);
+            break;
+        }
+
+        /* Sleep a short time if there are extra workers.  If we time out
+         * and still have extra workers after draining the shards then
+         * exit (above).  Otherwise, sleep here until signaled.
          */
-        barrier->wqb_visitors = UINT_MAX;
-        list_del_init(&work->entry);
-        cv_broadcast(&wq->wq_barrier);
+        timedout = cv_timedwait(&wq->wq_idle, &wq->wq_lock, extra ? 60000 : -1, "idle");
+
+        atomic_dec(&wq->wq_idlec);
+        mutex_unlock(&wq->wq_lock);
     }
 
     /* Wake up all threads waiting on wq_barrier so that they
@@ -493,6 +706,7 @@ worker_thread(void *arg)
     cv_broadcast(&wq->wq_barrier);
     --wq->wq_refcnt;
     --wq->wq_tdcnt;
+    workqueue_growable_update(wq);
     mutex_unlock(&wq->wq_lock);
 
     mutex_lock(&hse_wg.wg_lock);
@@ -509,17 +723,14 @@ worker_thread(void *arg)
 bool
 queue_work(struct workqueue_struct *wq, struct work_struct *work)
 {
-    bool enqueued;
-
     assert(work->func);
 
-    mutex_lock(&wq->wq_lock);
-    enqueued = queue_work_locked(wq, work);
-    if (enqueued)
-        cv_signal(&wq->wq_idle);
-    mutex_unlock(&wq->wq_lock);
+    if (!atomic_cas(&work->pending, 0, 1))
+        return false;
+
+    workqueue_enqueue(wq, work);
 
-    return enqueued;
+    return true;
 }
 
 /* delayed_work_timer_fn() - delayed work timer callback
@@ -533,60 +744,55 @@ delayed_work_timer_fn(unsigned long data)
 {
     struct workqueue_struct *wq;
     struct delayed_work *dwork;
-    bool enqueued;
-    bool pending;
 
     dwork = (struct delayed_work *)data;
     wq = dwork->wq;
 
-    mutex_lock(&wq->wq_lock);
-    pending = work_pending(&dwork->work);
-    if (pending) {
-        list_del_init(&dwork->work.entry);
+    assert(work_pending(&dwork->work));
 
-        enqueued = queue_work_locked(dwork->wq, &dwork->work);
-        if (enqueued)
-            cv_signal(&wq->wq_idle);
+    mutex_lock(&wq->wq_lock);
+    list_del_init(&dwork->work.entry);
+    mutex_unlock(&wq->wq_lock);
 
-        assert(enqueued);
-        --wq->wq_refcnt;
-        --wq->wq_dlycnt;
-    }
+    /* The work remains pending as it moves from the delayed list
+     * to a shard, and our reference keeps the workqueue alive.
+     */
+    workqueue_enqueue(wq, &dwork->work);
 
-    assert(pending);
+    mutex_lock(&wq->wq_lock);
+    --wq->wq_refcnt;
+    --wq->wq_dlycnt;
     mutex_unlock(&wq->wq_lock);
 }
 
 bool
 queue_delayed_work(struct workqueue_struct *wq, struct delayed_work *dwork, unsigned long delay)
 {
-    bool pending;
     uint64_t expires;
 
     assert(dwork->timer.function == delayed_work_timer_fn);
     assert(dwork->timer.data == (ulong)dwork);
     assert(dwork->work.func);
 
+    if (!atomic_cas(&dwork->work.pending, 0, 1))
+        return false;
+
     expires = nsecs_to_jiffies(get_time_ns()) + delay;
 
     mutex_lock(&wq->wq_lock);
-    pending = work_pending(&dwork->work);
-    if (!pending) {
-        list_add_tail(&dwork->work.entry, &wq->wq_delayed);
-        dwork->timer.expires = expires;
-        dwork->wq = wq;
-        ++wq->wq_refcnt;
-        ++wq->wq_dlycnt;
-    }
+    list_add_tail(&dwork->work.entry, &wq->wq_delayed);
+    dwork->timer.expires = expires;
+    dwork->wq = wq;
+    ++wq->wq_refcnt;
+    ++wq->wq_dlycnt;
     mutex_unlock(&wq->wq_lock);
 
     /* For simplicity, we deviate from the Linux implementation here
      * in that we always schedule a timer, even if delay is zero.
      */
-    if (!pending)
-        add_timer(&dwork->timer);
+    add_timer(&dwork->timer);
 
-    return !pending;
+    return true;
 }
 
 bool
@@ -601,6 +807,7 @@ cancel_delayed_work(struct delayed_work *dwork)
         pending = del_timer(&dwork->timer);
         if (pending) {
             list_del_init(&dwork->work.entry);
+            atomic_set(&dwork->work.pending, 0);
             --wq->wq_refcnt;
             --wq->wq_dlycnt;
         }
@@ -766,6 +973,7 @@ rest_get_workqueues(
         bad |=
             !cJSON_AddNumberToObject(elem, "working", wq->wq_refcnt - wq->wq_dlycnt - wq->wq_tdcnt);
         bad |= !cJSON_AddNumberToObject(elem, "delayed", wq->wq_dlycnt);
+        bad |= !cJSON_AddNumberToObject(elem, "pending", workqueue_pending(wq));
         bad |= !cJSON_AddNumberToObject(elem, "barrier_id", wq->wq_barid);
         bad |= !cJSON_AddNumberToObject(elem, "calls", priv->wp_calls);
         bad |= !cJSON_AddNumberToObject(elem, "latency_ns", latency);
@@ -819,29 +1027,25 @@ dump_workqueue_locked(struct workqueue_struct *wq)
 {
     struct delayed_work *d;
     struct work_struct *w;
-    int i, n;
+    int i;
 
     log_warn(
         "%s %p: pid %d, refcnt %d, dlycnt %d tdcnt %d, tdmin %d, tdmax %d, growing %d", wq->wq_name,
         wq, getpid(), wq->wq_refcnt, wq->wq_dlycnt, wq->wq_tdcnt, wq->wq_tdmin, wq->wq_tdmax,
         wq->wq_growing);
 
-    i = 0;
-    list_for_each_entry(w, &wq->wq_pending, entry) {
-        struct wq_barrier *b;
-        char buf[128];
-
-        n = snprintf(buf, sizeof(buf), "  work %3d %p", i++, w);
-
-        if (!w->func) {
-            b = container_of(w, struct wq_barrier, wqb_work);
+    for (uint s = 0; s < wq->wq_shardc; ++s) {
+        struct wq_shard *sh = wq->wq_shardv + s;
 
-            snprintf(
-                buf + n, sizeof(buf) - n, ", barid %4u, visitors %4d", b->wqb_barid,
-                b->wqb_visitors);
-        }
+        mutex_lock(&sh->sh_lock);
+        log_warn(
+            "%s %p: shard %2u, node %u, enqc %lu, deqc %lu", wq->wq_name, wq, s,
+            atomic_read(&sh->sh_node), sh->sh_enqc, sh->sh_deqc);
 
-        log_warn("%s %p: %s", wq->wq_name, wq, buf);
+        i = 0;
+        list_for_each_entry(w, &sh->sh_pending, entry)
+            log_warn("%s %p:   work %3d %p", wq->wq_name, wq, i++, w);
+        mutex_unlock(&sh->sh_lock);
     }
 
     i = 0;
@@ -415,7 +415,13 @@ wal_put(
     rtype = (txid > 0) ? WAL_RT_TX : WAL_RT_NONTX;
     wal_rechdr_pack(rtype, rid, len, 0, rec);
 
-    wal_rec_pack(WAL_OP_PUT, kvs->ikv_cnid, txid, klen, vt->vt_xlen, rec);
+    /* Merge operands are logged with their own op so that a binary which
+     * does not know about them fails replay rather than replaying them as
+     * full values.
+     */
+    wal_rec_pack(
+        kvs_vtuple_is_mopnd(vt) ? WAL_OP_MERGE : WAL_OP_PUT, kvs->ikv_cnid, txid, klen,
+        vt->vt_xlen, rec);
 
     kvdata = (char *)rec + rlen;
     memcpy(kvdata, kt->kt_data, klen);
@@ -502,6 +508,59 @@ wal_del_pfx(
     return wal_del_impl(wal, kvs, kt, txid, recout, true);
 }
 
+merr_t
+wal_del_range(
+    struct wal *wal,
+    struct ikvs *kvs,
+    struct kvs_ktuple *start,
+    struct kvs_ktuple *end,
+    struct wal_record *recout)
+{
+    const size_t kalign = sizeof(uint64_t);
+    struct wal_rec_omf *rec;
+    uint64_t rid;
+    size_t slen, elen, rlen, len;
+    char *kdata;
+    merr_t err;
+
+    if (!wal)
+        return 0;
+
+    /* The end key is logged in the value slot of the record.
+     */
+    slen = start->kt_len;
+    elen = end->kt_len;
+    rlen = wal_reclen(wal->version);
+    len = rlen + ALIGN(slen, kalign) + ALIGN(elen, kalign);
+
+    rec = wal_bufset_alloc(wal->wbs, len, &recout->offset, &recout->wbidx, &recout->cookie);
+    if (!rec) {
+        err = merr(ENOMEM); /* unrecoverable error */
+        kvdb_health_error(wal->health, err);
+        return err;
+    }
+
+    recout->recbuf = rec;
+    recout->len = len;
+
+    rid = atomic_inc_return(&wal->wal_rid);
+    wal_rechdr_pack(WAL_RT_NONTX, rid, len, 0, rec);
+
+    wal_rec_pack(WAL_OP_RDEL, kvs->ikv_cnid, 0, slen, elen, rec);
+
+    kdata = (char *)rec + rlen;
+    memcpy(kdata, start->kt_data, slen);
+    start->kt_data = kdata;
+    start->kt_flags = wal->buf_flags;
+
+    kdata = PTR_ALIGN(kdata + slen, kalign);
+    memcpy(kdata, end->kt_data, elen);
+    end->kt_data = kdata;
+    end->kt_flags = wal->buf_flags;
+
+    return 0;
+}
+
 static merr_t
 wal_txn(
     struct wal *wal,
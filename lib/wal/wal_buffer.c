@@ -3,6 +3,7 @@
  * SPDX-FileCopyrightText: Copyright 2021 Micron Technology, Inc.
  */
 
+#include <hse/ikvdb/kvs_wait.h>
 #include <hse/logging/logging.h>
 #include <hse/util/event_counter.h>
 #include <hse/util/page.h>
@@ -378,6 +379,7 @@ wal_bufset_alloc(
     const size_t hwm = wbs->wbs_buf_sz - (8u << MB_SHIFT);
     struct wal_buffer *wb;
     uint64_t offset, doff;
+    uint64_t wstart = 0;
     int slot;
 
     slot = *cookie;
@@ -399,8 +401,10 @@ wal_bufset_alloc(
 
         if (tail >= offset || offset - tail < hwm) {
             doff = atomic_read(&wb->wb_doff);
-            if (offset < doff)
+            if (offset < doff) {
+                kvs_wait_record(PERFC_LT_KVSWAIT_WALBUF, wstart);
                 return NULL;
+            }
 
             if (offset - doff < hwm)
                 break;
@@ -418,9 +422,14 @@ wal_bufset_alloc(
          * we cannot allow.  This should only happen if the ingest pipeline
          * configuration or throttle sensors are out of whack...
          */
+        if (!wstart)
+            wstart = kvs_wait_start();
+
         usleep((xrand64_tls() % 256) + 128);
     }
 
+    kvs_wait_record(PERFC_LT_KVSWAIT_WALBUF, wstart);
+
     *offout = offset;
     *wbidx = slot;
 
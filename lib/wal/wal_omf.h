@@ -40,6 +40,8 @@ enum wal_op {
     WAL_OP_PUT = 500,
     WAL_OP_DEL = 501,
     WAL_OP_PDEL = 502,
+    WAL_OP_MERGE = 503,
+    WAL_OP_RDEL = 504,
 };
 
 enum wal_flags {
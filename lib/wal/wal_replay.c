@@ -540,6 +540,10 @@ wal_replay_gen_impl(struct wal_replay *rep, struct wal_replay_gen *rgen, bool fl
             err = ikvdb_wal_replay_put(ikvdb, ikvsh, rec->cnid, rec->seqno, kt, vt);
             break;
 
+        case WAL_OP_MERGE:
+            err = ikvdb_wal_replay_merge(ikvdb, ikvsh, rec->cnid, rec->seqno, kt, vt);
+            break;
+
         case WAL_OP_DEL:
             err = ikvdb_wal_replay_del(ikvdb, ikvsh, rec->cnid, rec->seqno, kt);
             break;
@@ -548,6 +552,10 @@ wal_replay_gen_impl(struct wal_replay *rep, struct wal_replay_gen *rgen, bool fl
             err = ikvdb_wal_replay_prefix_del(ikvdb, ikvsh, rec->cnid, rec->seqno, kt);
             break;
 
+        case WAL_OP_RDEL:
+            err = ikvdb_wal_replay_range_del(ikvdb, ikvsh, rec->cnid, rec->seqno, kt, vt);
+            break;
+
         default:
             err = merr(EINVAL);
             break;
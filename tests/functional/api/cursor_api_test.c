@@ -3,6 +3,7 @@
  * SPDX-FileCopyrightText: Copyright 2021 Micron Technology, Inc.
  */
 
+#include <hse/experimental.h>
 #include <hse/hse.h>
 
 #include <hse/util/base.h>
@@ -69,6 +70,17 @@ transactional_kvs_setup(struct mtf_test_info *lcl_ti)
     return hse_err_to_errno(err);
 }
 
+int
+merge_kvs_setup(struct mtf_test_info *lcl_ti)
+{
+    hse_err_t err;
+    const char *cparamv[] = { "value.merge.operator=add_u64" };
+
+    err = fxt_kvs_setup(kvdb_handle, kvs_name, 0, NULL, NELEM(cparamv), cparamv, &kvs_handle);
+
+    return hse_err_to_errno(err);
+}
+
 int
 kvs_setup_with_data(struct mtf_test_info *lcl_ti)
 {
@@ -1246,4 +1258,118 @@ MTF_DEFINE_UTEST_PREPOST(
     hse_kvdb_txn_free(kvdb_handle, txn);
 }
 
+/* A cached cursor restored for a different prefix of the same length must
+ * not reuse cn state that was pruned by the previous prefix.
+ */
+MTF_DEFINE_UTEST_PREPOST(cursor_api_test, restore_new_prefix, kvs_setup, kvs_teardown)
+{
+    const char *pfxv[] = { "pfxA", "pfxB" };
+    struct hse_kvs_cursor *cursor;
+    char key_buf[8];
+    hse_err_t err;
+
+    /* One root kvset per prefix, and nothing left in c0 or LC.
+     */
+    for (int p = 0; p < NELEM(pfxv); p++) {
+        for (int i = 0; i < NUM_ENTRIES; i++) {
+            int key_len = snprintf(key_buf, sizeof(key_buf), "%s%d", pfxv[p], i);
+
+            err = hse_kvs_put(kvs_handle, 0, NULL, key_buf, key_len, "value", 5);
+            ASSERT_EQ(0, hse_err_to_errno(err));
+        }
+
+        err = hse_kvdb_sync(kvdb_handle, 0);
+        ASSERT_EQ(0, hse_err_to_errno(err));
+    }
+
+    for (int p = 0; p < NELEM(pfxv); p++) {
+        const void *key, *val;
+        size_t key_len, val_len;
+        bool eof = false;
+        int cnt = 0;
+
+        err = hse_kvs_cursor_create(kvs_handle, 0, NULL, pfxv[p], strlen(pfxv[p]), &cursor);
+        ASSERT_EQ(0, hse_err_to_errno(err));
+
+        while (true) {
+            err = hse_kvs_cursor_read(cursor, 0, &key, &key_len, &val, &val_len, &eof);
+            ASSERT_EQ(0, hse_err_to_errno(err));
+            if (eof)
+                break;
+
+            ASSERT_EQ(0, memcmp(key, pfxv[p], strlen(pfxv[p])));
+            cnt++;
+        }
+
+        ASSERT_EQ(NUM_ENTRIES, cnt);
+
+        /* Return the cursor to the cache for the next prefix to restore.
+         */
+        err = hse_kvs_cursor_destroy(cursor);
+        ASSERT_EQ(0, hse_err_to_errno(err));
+    }
+}
+
+MTF_DEFINE_UTEST_PREPOST(cursor_api_test, read_merged, merge_kvs_setup, kvs_teardown)
+{
+    struct hse_kvs_cursor *cursor;
+    const void *key, *val;
+    size_t key_len, val_len;
+    uint64_t base = 5, opnd, sum;
+    bool eof = false;
+    hse_err_t err;
+
+    err = hse_kvs_put(kvs_handle, 0, NULL, "ctr", 3, &base, sizeof(base));
+    ASSERT_EQ(0, hse_err_to_errno(err));
+
+    /* Pass 0 folds operands over a base value in c0, pass 1 folds them
+     * over a base that has been ingested into cN.
+     */
+    for (int pass = 0; pass < 2; pass++) {
+        sum = base;
+
+        for (opnd = 1; opnd <= 3; opnd++) {
+            err = hse_kvs_merge(kvs_handle, 0, NULL, "ctr", 3, &opnd, sizeof(opnd));
+            ASSERT_EQ(0, hse_err_to_errno(err));
+            sum += opnd;
+        }
+
+        err = hse_kvs_cursor_create(kvs_handle, 0, NULL, NULL, 0, &cursor);
+        ASSERT_EQ(0, hse_err_to_errno(err));
+
+        err = hse_kvs_cursor_read(cursor, 0, &key, &key_len, &val, &val_len, &eof);
+        ASSERT_EQ(0, hse_err_to_errno(err));
+        ASSERT_FALSE(eof);
+        ASSERT_EQ(3, key_len);
+        ASSERT_EQ(0, memcmp(key, "ctr", 3));
+        ASSERT_EQ(sizeof(sum), val_len);
+        ASSERT_EQ(0, memcmp(val, &sum, sizeof(sum)));
+
+        err = hse_kvs_cursor_read(cursor, 0, &key, &key_len, &val, &val_len, &eof);
+        ASSERT_EQ(0, hse_err_to_errno(err));
+        ASSERT_TRUE(eof);
+
+        err = hse_kvs_cursor_destroy(cursor);
+        ASSERT_EQ(0, hse_err_to_errno(err));
+
+        err = hse_kvdb_sync(kvdb_handle, 0);
+        ASSERT_EQ(0, hse_err_to_errno(err));
+
+        /* After ingest the folded value is a plain value in cN. */
+        err = hse_kvs_cursor_create(kvs_handle, 0, NULL, NULL, 0, &cursor);
+        ASSERT_EQ(0, hse_err_to_errno(err));
+
+        err = hse_kvs_cursor_read(cursor, 0, &key, &key_len, &val, &val_len, &eof);
+        ASSERT_EQ(0, hse_err_to_errno(err));
+        ASSERT_FALSE(eof);
+        ASSERT_EQ(sizeof(sum), val_len);
+        ASSERT_EQ(0, memcmp(val, &sum, sizeof(sum)));
+
+        err = hse_kvs_cursor_destroy(cursor);
+        ASSERT_EQ(0, hse_err_to_errno(err));
+
+        base = sum;
+    }
+}
+
 MTF_END_UTEST_COLLECTION(cursor_api_test)
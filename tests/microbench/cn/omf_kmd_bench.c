@@ -0,0 +1,142 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <stdlib.h>
+
+#include <hse/error/merr.h>
+#include <hse/ikvdb/omf_kmd.h>
+
+#include "microbench.h"
+
+/* Each op encodes or decodes the key metadata of one value, whose
+ * fields are drawn from the ranges seen in a typical kblock.
+ */
+#define KMD_ENTRYC (1024 * 1024)
+
+struct kmd_entry {
+    uint64_t seq;
+    uint32_t vbidx;
+    uint32_t vboff;
+    uint32_t vlen;
+};
+
+struct kmd_ctx {
+    struct kmd_entry *entryv;
+    uint8_t *kmd;
+};
+
+static merr_t
+kmd_setup(void **arg)
+{
+    struct kmd_ctx *ctx;
+    uint64_t *randv;
+    size_t off = 0;
+
+    ctx = calloc(1, sizeof(*ctx));
+    if (!ctx)
+        return merr(ENOMEM);
+
+    ctx->entryv = malloc(KMD_ENTRYC * sizeof(*ctx->entryv));
+    ctx->kmd = malloc(kmd_storage_max(KMD_ENTRYC));
+    randv = mb_keys_create(KMD_ENTRYC, sizeof(*randv), MB_SEED);
+
+    if (!ctx->entryv || !ctx->kmd || !randv) {
+        free(randv);
+        free(ctx->kmd);
+        free(ctx->entryv);
+        free(ctx);
+        return merr(ENOMEM);
+    }
+
+    for (uint64_t i = 0; i < KMD_ENTRYC; i++) {
+        struct kmd_entry *entry = ctx->entryv + i;
+
+        entry->seq = (1ul << 30) + (randv[i] >> 40);
+        entry->vbidx = randv[i] % 512;
+        entry->vboff = (randv[i] >> 9) % (32u << 20);
+        entry->vlen = 16 + (randv[i] >> 34) % 4096;
+    }
+
+    free(randv);
+
+    /* Pre-encode the entries for the decode benchmark.
+     */
+    kmd_set_count(ctx->kmd, &off, KMD_ENTRYC);
+    for (uint64_t i = 0; i < KMD_ENTRYC; i++) {
+        const struct kmd_entry *entry = ctx->entryv + i;
+
+        kmd_add_val(ctx->kmd, &off, entry->seq, entry->vbidx, entry->vboff, entry->vlen);
+    }
+
+    *arg = ctx;
+
+    return 0;
+}
+
+static void
+kmd_encode_run(void *arg, uint64_t iters)
+{
+    struct kmd_ctx *ctx = arg;
+    size_t off = 0;
+
+    kmd_set_count(ctx->kmd, &off, KMD_ENTRYC);
+
+    for (uint64_t i = 0; i < iters; i++) {
+        const struct kmd_entry *entry = ctx->entryv + (i % KMD_ENTRYC);
+
+        if (i > 0 && i % KMD_ENTRYC == 0) {
+            off = 0;
+            kmd_set_count(ctx->kmd, &off, KMD_ENTRYC);
+        }
+
+        kmd_add_val(ctx->kmd, &off, entry->seq, entry->vbidx, entry->vboff, entry->vlen);
+    }
+
+    mb_sink(off);
+}
+
+static void
+kmd_decode_run(void *arg, uint64_t iters)
+{
+    struct kmd_ctx *ctx = arg;
+    uint64_t sum = 0, count = 0;
+    size_t off = 0;
+
+    for (uint64_t i = 0; i < iters; i++) {
+        enum kmd_vtype vtype;
+        uint vbidx, vboff, vlen;
+        uint64_t seq;
+
+        if (count == 0) {
+            off = 0;
+            count = kmd_count(ctx->kmd, &off);
+        }
+
+        kmd_type_seq(ctx->kmd, &off, &vtype, &seq);
+        kmd_val(ctx->kmd, &off, &vbidx, &vboff, &vlen);
+
+        sum += seq + vbidx + vboff + vlen;
+        count--;
+    }
+
+    mb_sink(sum);
+}
+
+static void
+kmd_teardown(void *arg)
+{
+    struct kmd_ctx *ctx = arg;
+
+    free(ctx->kmd);
+    free(ctx->entryv);
+    free(ctx);
+}
+
+static const struct mb_bench kmd_benchv[] = {
+    { "encode", KMD_ENTRYC, kmd_setup, NULL, kmd_encode_run, kmd_teardown },
+    { "decode", KMD_ENTRYC, kmd_setup, NULL, kmd_decode_run, kmd_teardown },
+};
+
+MB_SUITE(omf_kmd, kmd_benchv);
@@ -0,0 +1,201 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include <hse/error/merr.h>
+#include <hse/ikvdb/omf_kmd.h>
+#include <hse/ikvdb/tuple.h>
+#include <hse/util/key_util.h>
+#include <hse/util/keycmp.h>
+#include <hse/util/page.h>
+
+#include "cn/omf.h"
+#include "cn/wbt_builder.h"
+#include "cn/wbt_internal.h"
+#include "cn/wbt_reader.h"
+
+#include "microbench.h"
+
+/* Point lookups in a wbtree the size of a large kblock's.  Keys are
+ * looked up in random order, so the cost is dominated by the cache
+ * misses incurred while descending from the root to a leaf.
+ */
+#define WBT_KEYC    (256 * 1024)
+#define WBT_KLEN    (16)
+#define WBT_MAX_PGC (8192)
+
+struct wbt_ctx {
+    uint8_t *keys;
+    uint8_t *missv;
+    void *tree;
+    struct wbt_desc wbd;
+};
+
+static int
+wbt_key_cmp(const void *lhs, const void *rhs)
+{
+    return keycmp(lhs, WBT_KLEN, rhs, WBT_KLEN);
+}
+
+static merr_t
+wbt_build(struct wbt_ctx *ctx)
+{
+    struct wbt_hdr_omf hdr;
+    struct iovec *iov;
+    struct wbb *wbb;
+    uint wbt_pgc = 0, iov_cnt = 0;
+    uint8_t *sorted, kmd[64];
+    size_t wlen = 0;
+    merr_t err;
+
+    /* Keys must be added in order, but are looked up in random order.
+     */
+    sorted = malloc(WBT_KEYC * WBT_KLEN);
+    iov = calloc(WBT_MAX_PGC, sizeof(*iov));
+    if (!sorted || !iov) {
+        free(iov);
+        free(sorted);
+        return merr(ENOMEM);
+    }
+
+    memcpy(sorted, ctx->keys, WBT_KEYC * WBT_KLEN);
+    qsort(sorted, WBT_KEYC, WBT_KLEN, wbt_key_cmp);
+
+    err = wbb_create(&wbb, WBT_MAX_PGC, &wbt_pgc);
+    if (err)
+        goto out;
+
+    for (uint64_t i = 0; i < WBT_KEYC && !err; i++) {
+        struct key_obj ko;
+        size_t kmd_used = 0;
+        bool added = false;
+
+        key2kobj(&ko, sorted + i * WBT_KLEN, WBT_KLEN);
+        kmd_add_zval(kmd, &kmd_used, 1);
+
+        err = wbb_add_entry(wbb, &ko, 1, 0, kmd, kmd_used, WBT_MAX_PGC, &wbt_pgc, &added);
+        if (!err && !added)
+            err = merr(EFBIG);
+    }
+
+    if (!err)
+        err = wbb_freeze(wbb, &hdr, WBT_MAX_PGC, &wbt_pgc, iov, WBT_MAX_PGC, &iov_cnt);
+
+    for (uint i = 0; i < iov_cnt; i++)
+        wlen += iov[i].iov_len;
+
+    ctx->tree = err ? NULL : aligned_alloc(PAGE_SIZE, ALIGN(wlen, PAGE_SIZE));
+    if (!err && !ctx->tree)
+        err = merr(ENOMEM);
+
+    if (!err) {
+        uint8_t *t = ctx->tree;
+
+        for (uint i = 0; i < iov_cnt; i++) {
+            memcpy(t, iov[i].iov_base, iov[i].iov_len);
+            t += iov[i].iov_len;
+        }
+
+        ctx->wbd = (struct wbt_desc){
+            .wbd_first_page = 0,
+            .wbd_n_pages = wbt_pgc,
+            .wbd_version = WBT_TREE_VERSION,
+            .wbd_root = omf_wbt_root(&hdr),
+            .wbd_leaf = omf_wbt_leaf(&hdr),
+            .wbd_leaf_cnt = omf_wbt_leaf_cnt(&hdr),
+            .wbd_kmd_pgc = omf_wbt_kmd_pgc(&hdr),
+        };
+    }
+
+    wbb_destroy(wbb);
+
+out:
+    free(iov);
+    free(sorted);
+
+    return err;
+}
+
+static void
+wbt_teardown(void *arg)
+{
+    struct wbt_ctx *ctx = arg;
+
+    free(ctx->tree);
+    free(ctx->missv);
+    free(ctx->keys);
+    free(ctx);
+}
+
+static merr_t
+wbt_setup(void **arg)
+{
+    struct wbt_ctx *ctx;
+    merr_t err;
+
+    ctx = calloc(1, sizeof(*ctx));
+    if (!ctx)
+        return merr(ENOMEM);
+
+    ctx->keys = mb_keys_create(WBT_KEYC, WBT_KLEN, MB_SEED);
+    ctx->missv = mb_keys_create(WBT_KEYC, WBT_KLEN, ~MB_SEED);
+
+    err = (ctx->keys && ctx->missv) ? wbt_build(ctx) : merr(ENOMEM);
+    if (err) {
+        wbt_teardown(ctx);
+        return err;
+    }
+
+    *arg = ctx;
+
+    return 0;
+}
+
+static void
+wbt_lookupv(struct wbt_ctx *ctx, const uint8_t *keys, uint64_t iters)
+{
+    uint64_t found = 0;
+
+    for (uint64_t i = 0; i < iters; i++) {
+        enum key_lookup_res res = NOT_FOUND;
+        struct kvs_vtuple_ref vref;
+        struct kvs_ktuple kt;
+
+        kvs_ktuple_init_nohash(&kt, keys + (i % WBT_KEYC) * WBT_KLEN, WBT_KLEN);
+
+        if (wbtr_read_vref(ctx->tree, &ctx->wbd, &kt, 1, &res, NULL, &vref))
+            abort();
+
+        found += (res == FOUND_VAL);
+    }
+
+    mb_sink(found);
+}
+
+static void
+wbt_hit_run(void *arg, uint64_t iters)
+{
+    struct wbt_ctx *ctx = arg;
+
+    wbt_lookupv(ctx, ctx->keys, iters);
+}
+
+static void
+wbt_miss_run(void *arg, uint64_t iters)
+{
+    struct wbt_ctx *ctx = arg;
+
+    wbt_lookupv(ctx, ctx->missv, iters);
+}
+
+static const struct mb_bench wbt_benchv[] = {
+    { "lookup_hit", WBT_KEYC, wbt_setup, NULL, wbt_hit_run, wbt_teardown },
+    { "lookup_miss", WBT_KEYC, wbt_setup, NULL, wbt_miss_run, wbt_teardown },
+};
+
+MB_SUITE(wbt_reader, wbt_benchv);
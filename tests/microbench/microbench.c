@@ -0,0 +1,618 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+/* Microbenchmarks of hot-path primitives.
+ *
+ * Each benchmark performs a fixed number of ops on a fixed dataset per
+ * repetition, and is reported as the median ns/op over all repetitions
+ * along with hardware cache misses and instructions per op (where the
+ * kernel allows perf_event_open()).  Results can be written as JSON and
+ * compared with those of a previous build, in which case the exit
+ * status is non-zero if any benchmark slowed down by more than the
+ * given threshold.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <cjson/cJSON.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+#include <hse/hse.h>
+#include <hse/version.h>
+
+#include <hse/util/platform.h>
+#include <hse/util/xrand.h>
+
+#include "microbench.h"
+
+/* Bump MB_REPORT_VERSION whenever the meaning of an existing field
+ * changes, so that reports are not compared blindly.
+ */
+#define MB_REPORT_VERSION (1)
+#define MB_REPS_MAX       (101)
+
+static const struct mb_suite * const suitev[] = {
+    &bin_heap_suite,
+    &bloom_filter_suite,
+    &bonsai_tree_suite,
+    &cursor_heap_suite,
+    &keycmp_suite,
+    &keylock_suite,
+    &omf_kmd_suite,
+    &slab_suite,
+    &wal_buffer_suite,
+    &wbt_reader_suite,
+};
+
+enum mb_ctr {
+    MB_CTR_CACHE_MISSES,
+    MB_CTR_INSTRUCTIONS,
+    MB_CTR_MAX,
+};
+
+/**
+ * struct mb_result - results of one benchmark
+ * @mr_name:   "suite.bench"
+ * @mr_iters:  ops per repetition
+ * @mr_ns:     median ns/op
+ * @mr_ns_min: fastest ns/op
+ * @mr_ctrv:   median counts/op of each counter, negative if unavailable
+ */
+struct mb_result {
+    char mr_name[64];
+    uint64_t mr_iters;
+    double mr_ns;
+    double mr_ns_min;
+    double mr_ctrv[MB_CTR_MAX];
+};
+
+static int perf_fdv[MB_CTR_MAX] = { -1, -1 };
+
+static volatile uint64_t mb_sinkv;
+
+static const char *progname;
+
+void
+mb_sink(uint64_t val)
+{
+    mb_sinkv += val;
+}
+
+void *
+mb_keys_create(uint64_t keyc, unsigned int klen, uint64_t seed)
+{
+    size_t sz = keyc * klen;
+    struct xrand xr;
+    uint8_t *keys;
+
+    keys = malloc(sz + sizeof(uint64_t));
+    if (!keys)
+        return NULL;
+
+    xrand_init(&xr, seed);
+
+    for (size_t i = 0; i < sz; i += sizeof(uint64_t)) {
+        uint64_t r = xrand64(&xr);
+
+        memcpy(keys + i, &r, sizeof(r));
+    }
+
+    return keys;
+}
+
+static void
+perf_open(void)
+{
+    static const uint64_t configv[MB_CTR_MAX] = {
+        [MB_CTR_CACHE_MISSES] = PERF_COUNT_HW_CACHE_MISSES,
+        [MB_CTR_INSTRUCTIONS] = PERF_COUNT_HW_INSTRUCTIONS,
+    };
+
+    for (int i = 0; i < MB_CTR_MAX; i++) {
+        struct perf_event_attr attr = {
+            .type = PERF_TYPE_HARDWARE,
+            .size = sizeof(attr),
+            .config = configv[i],
+            .disabled = (i == 0),
+            .exclude_kernel = 1,
+            .exclude_hv = 1,
+            .read_format = PERF_FORMAT_GROUP,
+        };
+
+        perf_fdv[i] = syscall(SYS_perf_event_open, &attr, 0, -1, i ? perf_fdv[0] : -1, 0);
+        if (perf_fdv[i] == -1) {
+            fprintf(
+                stderr, "%s: perf_event_open: %s, hardware counters unavailable\n", progname,
+                strerror(errno));
+
+            while (i-- > 0) {
+                close(perf_fdv[i]);
+                perf_fdv[i] = -1;
+            }
+
+            return;
+        }
+    }
+}
+
+static void
+perf_close(void)
+{
+    for (int i = 0; i < MB_CTR_MAX; i++) {
+        if (perf_fdv[i] != -1)
+            close(perf_fdv[i]);
+    }
+}
+
+static void
+perf_start(void)
+{
+    if (perf_fdv[0] == -1)
+        return;
+
+    ioctl(perf_fdv[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(perf_fdv[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+static bool
+perf_stop(uint64_t *ctrv)
+{
+    struct {
+        uint64_t nr;
+        uint64_t valv[MB_CTR_MAX];
+    } buf;
+
+    if (perf_fdv[0] == -1)
+        return false;
+
+    ioctl(perf_fdv[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    if (read(perf_fdv[0], &buf, sizeof(buf)) != sizeof(buf) || buf.nr != MB_CTR_MAX)
+        return false;
+
+    memcpy(ctrv, buf.valv, sizeof(buf.valv));
+
+    return true;
+}
+
+static int
+dblcmp(const void *lhs, const void *rhs)
+{
+    const double l = *(const double *)lhs;
+    const double r = *(const double *)rhs;
+
+    return (l > r) - (l < r);
+}
+
+static double
+median(double *valv, unsigned int valc)
+{
+    qsort(valv, valc, sizeof(*valv), dblcmp);
+
+    return (valc % 2) ? valv[valc / 2] : (valv[valc / 2 - 1] + valv[valc / 2]) / 2;
+}
+
+static merr_t
+mb_run(const struct mb_suite *ms, const struct mb_bench *mb, unsigned int reps,
+       struct mb_result *res)
+{
+    double nsv[MB_REPS_MAX], ctrv[MB_CTR_MAX][MB_REPS_MAX];
+    bool have_ctrs = true;
+    void *ctx = NULL;
+    merr_t err;
+
+    snprintf(res->mr_name, sizeof(res->mr_name), "%s.%s", ms->ms_name, mb->mb_name);
+    res->mr_iters = mb->mb_iters;
+
+    if (mb->mb_setup) {
+        err = mb->mb_setup(&ctx);
+        if (err)
+            return err;
+    }
+
+    /* Warm up caches, allocators and branch predictors.
+     */
+    if (mb->mb_reset)
+        mb->mb_reset(ctx);
+    mb->mb_run(ctx, mb->mb_iters);
+
+    for (unsigned int r = 0; r < reps; r++) {
+        uint64_t start, cntv[MB_CTR_MAX];
+
+        if (mb->mb_reset)
+            mb->mb_reset(ctx);
+
+        perf_start();
+        start = get_time_ns();
+
+        mb->mb_run(ctx, mb->mb_iters);
+
+        nsv[r] = (double)(get_time_ns() - start) / mb->mb_iters;
+        have_ctrs = perf_stop(cntv) && have_ctrs;
+
+        for (int i = 0; i < MB_CTR_MAX; i++)
+            ctrv[i][r] = have_ctrs ? (double)cntv[i] / mb->mb_iters : -1;
+    }
+
+    if (mb->mb_teardown)
+        mb->mb_teardown(ctx);
+
+    res->mr_ns = median(nsv, reps);
+    res->mr_ns_min = nsv[0];
+
+    for (int i = 0; i < MB_CTR_MAX; i++)
+        res->mr_ctrv[i] = have_ctrs ? median(ctrv[i], reps) : -1;
+
+    return 0;
+}
+
+static void
+mb_print(FILE *fp, const struct mb_result *res)
+{
+    fprintf(fp, "%-32s %10lu %10.1f %10.1f", res->mr_name, res->mr_iters, res->mr_ns,
+            res->mr_ns_min);
+
+    for (int i = 0; i < MB_CTR_MAX; i++) {
+        if (res->mr_ctrv[i] < 0)
+            fprintf(fp, " %12s", "-");
+        else
+            fprintf(fp, " %12.2f", res->mr_ctrv[i]);
+    }
+
+    fputc('\n', fp);
+}
+
+static int
+report_write(const char *path, const struct mb_result *resv, unsigned int resc, unsigned int reps)
+{
+    cJSON *root, *benchv;
+    char *data;
+    FILE *fp;
+    bool bad;
+    int rc = 0;
+
+    root = cJSON_CreateObject();
+    if (!root)
+        return ENOMEM;
+
+    bad = !cJSON_AddNumberToObject(root, "version", MB_REPORT_VERSION);
+    bad |= !cJSON_AddStringToObject(root, "hse_version", HSE_VERSION_STRING);
+    bad |= !cJSON_AddNumberToObject(root, "reps", reps);
+
+    benchv = cJSON_AddArrayToObject(root, "benchmarks");
+    bad |= !benchv;
+
+    for (unsigned int i = 0; i < resc && !bad; i++) {
+        const struct mb_result *res = resv + i;
+        cJSON *obj;
+
+        obj = cJSON_CreateObject();
+        if (!obj || !cJSON_AddItemToArray(benchv, obj)) {
+            cJSON_Delete(obj);
+            bad = true;
+            break;
+        }
+
+        bad |= !cJSON_AddStringToObject(obj, "name", res->mr_name);
+        bad |= !cJSON_AddNumberToObject(obj, "iters", res->mr_iters);
+        bad |= !cJSON_AddNumberToObject(obj, "ns_per_op", res->mr_ns);
+        bad |= !cJSON_AddNumberToObject(obj, "ns_per_op_min", res->mr_ns_min);
+
+        if (res->mr_ctrv[MB_CTR_CACHE_MISSES] >= 0) {
+            bad |= !cJSON_AddNumberToObject(
+                obj, "cache_misses_per_op", res->mr_ctrv[MB_CTR_CACHE_MISSES]);
+            bad |= !cJSON_AddNumberToObject(
+                obj, "instructions_per_op", res->mr_ctrv[MB_CTR_INSTRUCTIONS]);
+        }
+    }
+
+    data = bad ? NULL : cJSON_Print(root);
+    cJSON_Delete(root);
+    if (!data)
+        return ENOMEM;
+
+    fp = strcmp(path, "-") ? fopen(path, "w") : stdout;
+    if (!fp) {
+        rc = errno;
+        goto out;
+    }
+
+    if (fprintf(fp, "%s\n", data) < 0)
+        rc = EIO;
+
+    if (fp != stdout && fclose(fp) && !rc)
+        rc = errno;
+
+out:
+    cJSON_free(data);
+
+    return rc;
+}
+
+static cJSON *
+report_read(const char *path)
+{
+    cJSON *root = NULL;
+    char *data;
+    long len;
+    FILE *fp;
+
+    fp = fopen(path, "r");
+    if (!fp)
+        return NULL;
+
+    if (fseek(fp, 0, SEEK_END) || (len = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET)) {
+        fclose(fp);
+        return NULL;
+    }
+
+    data = malloc(len + 1);
+    if (data && fread(data, 1, len, fp) == len) {
+        data[len] = '\0';
+        root = cJSON_Parse(data);
+    }
+
+    free(data);
+    fclose(fp);
+
+    return root;
+}
+
+static const cJSON *
+report_find(const cJSON *root, const char *name)
+{
+    const cJSON *benchv = cJSON_GetObjectItemCaseSensitive(root, "benchmarks");
+    const cJSON *obj;
+
+    cJSON_ArrayForEach(obj, benchv)
+    {
+        if (!strcmp(cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(obj, "name")) ?: "",
+                    name))
+            return obj;
+    }
+
+    return NULL;
+}
+
+static double
+report_number(const cJSON *obj, const char *name)
+{
+    const cJSON *item = cJSON_GetObjectItemCaseSensitive(obj, name);
+
+    return cJSON_IsNumber(item) ? item->valuedouble : -1;
+}
+
+/* Returns the number of benchmarks whose median ns/op regressed by more
+ * than threshold percent, or -1 if the baseline cannot be read.
+ */
+static int
+report_compare(const char *path, const struct mb_result *resv, unsigned int resc,
+               double threshold)
+{
+    const cJSON *ver;
+    cJSON *root;
+    int regressions = 0;
+
+    root = report_read(path);
+    if (!root) {
+        fprintf(stderr, "%s: cannot read baseline %s\n", progname, path);
+        return -1;
+    }
+
+    ver = cJSON_GetObjectItemCaseSensitive(root, "version");
+    if (!cJSON_IsNumber(ver) || ver->valueint != MB_REPORT_VERSION) {
+        fprintf(stderr, "%s: baseline %s has an incompatible version\n", progname, path);
+        cJSON_Delete(root);
+        return -1;
+    }
+
+    printf(
+        "\nComparison with %s (hse %s), threshold %.1f%%\n%-32s %10s %10s %8s %12s %12s\n", path,
+        cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(root, "hse_version")) ?: "?",
+        threshold, "benchmark", "base ns", "ns", "delta%", "base misses", "misses");
+
+    for (unsigned int i = 0; i < resc; i++) {
+        const struct mb_result *res = resv + i;
+        const cJSON *obj = report_find(root, res->mr_name);
+        double base, delta, misses;
+        bool regressed;
+
+        if (!obj) {
+            printf("%-32s not in baseline\n", res->mr_name);
+            continue;
+        }
+
+        base = report_number(obj, "ns_per_op");
+        if (base <= 0)
+            continue;
+
+        delta = (res->mr_ns - base) * 100.0 / base;
+        regressed = delta > threshold;
+        regressions += regressed;
+
+        misses = report_number(obj, "cache_misses_per_op");
+
+        printf("%-32s %10.1f %10.1f %+8.1f", res->mr_name, base, res->mr_ns, delta);
+        if (misses >= 0 && res->mr_ctrv[MB_CTR_CACHE_MISSES] >= 0)
+            printf(" %12.2f %12.2f", misses, res->mr_ctrv[MB_CTR_CACHE_MISSES]);
+        else
+            printf(" %12s %12s", "-", "-");
+        printf("%s\n", regressed ? "  REGRESSED" : "");
+    }
+
+    cJSON_Delete(root);
+
+    return regressions;
+}
+
+static bool
+mb_selected(const char *name, int filterc, char **filterv)
+{
+    if (filterc == 0)
+        return true;
+
+    for (int i = 0; i < filterc; i++) {
+        if (!strncmp(name, filterv[i], strlen(filterv[i])))
+            return true;
+    }
+
+    return false;
+}
+
+static void
+usage(void)
+{
+    printf(
+        "usage: %s [options] [suite[.bench] ...]\n"
+        "-b file  Compare with the JSON report of a previous run\n"
+        "-h       Print this help menu\n"
+        "-l       List benchmarks\n"
+        "-o file  Write a JSON report to file, '-' for stdout\n"
+        "-r reps  Number of timed repetitions (default: 5, max: %d)\n"
+        "-t pct   Regression threshold in percent for -b (default: 10)\n"
+        "\n"
+        "The exit status is 1 if any benchmark regressed relative to the baseline.\n",
+        progname, MB_REPS_MAX);
+}
+
+int
+main(int argc, char **argv)
+{
+    const char *paramv[] = { "logging.enabled=false", "rest.enabled=false" };
+    const char *json = NULL, *baseline = NULL;
+    struct mb_result *resv;
+    unsigned int resc = 0, reps = 5, benchc = 0;
+    double threshold = 10;
+    bool list = false;
+    hse_err_t herr;
+    int c, rc;
+
+    progname = strrchr(argv[0], '/');
+    progname = progname ? progname + 1 : argv[0];
+
+    while ((c = getopt(argc, argv, ":b:hlo:r:t:")) != -1) {
+        char *end = NULL;
+
+        switch (c) {
+        case 'b':
+            baseline = optarg;
+            break;
+        case 'h':
+            usage();
+            exit(0);
+        case 'l':
+            list = true;
+            break;
+        case 'o':
+            json = optarg;
+            break;
+        case 'r':
+            reps = strtoul(optarg, &end, 0);
+            if (*end || reps < 1 || reps > MB_REPS_MAX) {
+                fprintf(stderr, "%s: invalid repetitions '%s'\n", progname, optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case 't':
+            threshold = strtod(optarg, &end);
+            if (*end || threshold < 0) {
+                fprintf(stderr, "%s: invalid threshold '%s'\n", progname, optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case '?':
+            fprintf(stderr, "%s: invalid option -%c, use -h for help\n", progname, optopt);
+            exit(EX_USAGE);
+        case ':':
+            fprintf(stderr, "%s: option -%c requires a parameter\n", progname, optopt);
+            exit(EX_USAGE);
+        }
+    }
+
+    for (size_t i = 0; i < NELEM(suitev); i++) {
+        for (unsigned int j = 0; j < suitev[i]->ms_benchc; j++) {
+            if (list)
+                printf("%s.%s\n", suitev[i]->ms_name, suitev[i]->ms_benchv[j].mb_name);
+            benchc++;
+        }
+    }
+
+    if (list)
+        return 0;
+
+    resv = calloc(benchc, sizeof(*resv));
+    if (!resv)
+        return EX_OSERR;
+
+    herr = hse_init(NULL, NELEM(paramv), paramv);
+    if (herr) {
+        fprintf(stderr, "%s: hse_init: %s\n", progname, strerror(hse_err_to_errno(herr)));
+        free(resv);
+        return EX_OSERR;
+    }
+
+    perf_open();
+
+    printf("%-32s %10s %10s %10s %12s %12s\n", "benchmark", "iters", "ns/op", "min ns/op",
+           "misses/op", "instrs/op");
+
+    rc = 0;
+    for (size_t i = 0; i < NELEM(suitev) && !rc; i++) {
+        const struct mb_suite *ms = suitev[i];
+
+        for (unsigned int j = 0; j < ms->ms_benchc; j++) {
+            const struct mb_bench *mb = ms->ms_benchv + j;
+            struct mb_result *res = resv + resc;
+            char name[64];
+            merr_t err;
+
+            snprintf(name, sizeof(name), "%s.%s", ms->ms_name, mb->mb_name);
+            if (!mb_selected(name, argc - optind, argv + optind))
+                continue;
+
+            err = mb_run(ms, mb, reps, res);
+            if (err) {
+                fprintf(stderr, "%s: %s setup failed: %s\n", progname, name,
+                        strerror(merr_errno(err)));
+                rc = EX_SOFTWARE;
+                break;
+            }
+
+            mb_print(stdout, res);
+            fflush(stdout);
+            resc++;
+        }
+    }
+
+    perf_close();
+    hse_fini();
+
+    if (!rc && json && report_write(json, resv, resc, reps)) {
+        fprintf(stderr, "%s: cannot write report %s\n", progname, json);
+        rc = EX_CANTCREAT;
+    }
+
+    if (!rc && baseline) {
+        int n = report_compare(baseline, resv, resc, threshold);
+
+        if (n < 0)
+            rc = EX_NOINPUT;
+        else if (n > 0)
+            rc = 1;
+    }
+
+    free(resv);
+
+    return rc;
+}
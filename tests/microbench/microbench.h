@@ -0,0 +1,88 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#ifndef HSE_MICROBENCH_H
+#define HSE_MICROBENCH_H
+
+#include <stdint.h>
+
+#include <hse/error/merr.h>
+#include <hse/util/base.h>
+
+/* MB_SEED  seed from which every benchmark dataset is generated, so that
+ *          each run of a given benchmark operates on identical data
+ */
+#define MB_SEED (0x6d6963726f62656eul)
+
+/**
+ * struct mb_bench - a microbenchmark
+ * @mb_name:     benchmark name, unique within its suite
+ * @mb_iters:    number of ops per timed repetition
+ * @mb_setup:    build the benchmark's dataset (optional)
+ * @mb_reset:    restore the dataset before each repetition, untimed (optional)
+ * @mb_run:      perform @iters ops, timed
+ * @mb_teardown: free the dataset (optional)
+ *
+ * The number of ops per repetition is fixed rather than calibrated so
+ * that ns/op and cache misses/op of different builds measure exactly
+ * the same work.
+ */
+struct mb_bench {
+    const char *mb_name;
+    uint64_t mb_iters;
+    merr_t (*mb_setup)(void **ctx);
+    void (*mb_reset)(void *ctx);
+    void (*mb_run)(void *ctx, uint64_t iters);
+    void (*mb_teardown)(void *ctx);
+};
+
+/**
+ * struct mb_suite - the microbenchmarks of one primitive
+ * @ms_name:   suite name
+ * @ms_benchc: number of elements in @ms_benchv
+ * @ms_benchv: benchmarks
+ */
+struct mb_suite {
+    const char *ms_name;
+    unsigned int ms_benchc;
+    const struct mb_bench *ms_benchv;
+};
+
+#define MB_SUITE(_name, _benchv) \
+    const struct mb_suite _name##_suite = { #_name, NELEM(_benchv), (_benchv) }
+
+/**
+ * mb_keys_create() - generate a fixed set of random keys
+ * @keyc: number of keys
+ * @klen: length of each key
+ * @seed: dataset seed
+ *
+ * Key i lives at offset (i * @klen) of the returned buffer, which the
+ * caller must free().
+ *
+ * Return: buffer of keys, or NULL on allocation failure
+ */
+void *
+mb_keys_create(uint64_t keyc, unsigned int klen, uint64_t seed);
+
+/**
+ * mb_sink() - consume a result so the compiler cannot elide its computation
+ * @val: result
+ */
+void
+mb_sink(uint64_t val);
+
+extern const struct mb_suite bin_heap_suite;
+extern const struct mb_suite bloom_filter_suite;
+extern const struct mb_suite bonsai_tree_suite;
+extern const struct mb_suite cursor_heap_suite;
+extern const struct mb_suite keycmp_suite;
+extern const struct mb_suite keylock_suite;
+extern const struct mb_suite omf_kmd_suite;
+extern const struct mb_suite slab_suite;
+extern const struct mb_suite wal_buffer_suite;
+extern const struct mb_suite wbt_reader_suite;
+
+#endif
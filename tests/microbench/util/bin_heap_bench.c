@@ -0,0 +1,148 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <stdlib.h>
+
+#include <hse/error/merr.h>
+#include <hse/util/base.h>
+#include <hse/util/bin_heap.h>
+#include <hse/util/element_source.h>
+#include <hse/util/keycmp.h>
+
+#include "microbench.h"
+
+/* Merge BH_WIDTH sorted sources of BH_KEYC / BH_WIDTH keys each, akin
+ * to a cursor or compaction merging the kvsets of a cn node.
+ */
+#define BH_WIDTH (16)
+#define BH_KEYC  (1024 * 1024)
+#define BH_SRCC  (BH_KEYC / BH_WIDTH)
+#define BH_KLEN  (16)
+
+struct bh_src {
+    struct element_source es;
+    const void **keyv;
+    uint32_t next;
+};
+
+struct bh_ctx {
+    struct bin_heap *bh;
+    uint8_t *keys;
+    struct bh_src srcv[BH_WIDTH];
+    struct element_source *esv[BH_WIDTH];
+};
+
+static int
+bh_cmp(const void *lhs, const void *rhs)
+{
+    return keycmp(lhs, BH_KLEN, rhs, BH_KLEN);
+}
+
+static int
+bh_qsort_cmp(const void *lhs, const void *rhs)
+{
+    return bh_cmp(*(const void **)lhs, *(const void **)rhs);
+}
+
+static bool
+bh_get_next(struct element_source *es, void **data)
+{
+    struct bh_src *src = container_of(es, struct bh_src, es);
+
+    if (src->next >= BH_SRCC)
+        return false;
+
+    *data = (void *)src->keyv[src->next++];
+
+    return true;
+}
+
+static void
+bh_reset(void *arg)
+{
+    struct bh_ctx *ctx = arg;
+
+    for (int i = 0; i < BH_WIDTH; i++)
+        ctx->srcv[i].next = 0;
+
+    if (bin_heap_prepare(ctx->bh, BH_WIDTH, ctx->esv))
+        abort();
+}
+
+static void
+bh_teardown(void *arg)
+{
+    struct bh_ctx *ctx = arg;
+
+    for (int i = 0; i < BH_WIDTH; i++)
+        free(ctx->srcv[i].keyv);
+    bin_heap_destroy(ctx->bh);
+    free(ctx->keys);
+    free(ctx);
+}
+
+static merr_t
+bh_setup(void **arg)
+{
+    struct bh_ctx *ctx;
+    merr_t err;
+
+    ctx = calloc(1, sizeof(*ctx));
+    if (!ctx)
+        return merr(ENOMEM);
+
+    err = bin_heap_create(BH_WIDTH, bh_cmp, &ctx->bh);
+    if (err) {
+        free(ctx);
+        return err;
+    }
+
+    ctx->keys = mb_keys_create(BH_KEYC, BH_KLEN, MB_SEED);
+    if (!ctx->keys) {
+        bh_teardown(ctx);
+        return merr(ENOMEM);
+    }
+
+    for (int i = 0; i < BH_WIDTH; i++) {
+        struct bh_src *src = ctx->srcv + i;
+
+        src->keyv = malloc(BH_SRCC * sizeof(*src->keyv));
+        if (!src->keyv) {
+            bh_teardown(ctx);
+            return merr(ENOMEM);
+        }
+
+        for (uint32_t j = 0; j < BH_SRCC; j++)
+            src->keyv[j] = ctx->keys + ((uint64_t)i * BH_SRCC + j) * BH_KLEN;
+
+        qsort(src->keyv, BH_SRCC, sizeof(*src->keyv), bh_qsort_cmp);
+
+        src->es = es_make(bh_get_next, NULL, NULL);
+        ctx->esv[i] = &src->es;
+    }
+
+    *arg = ctx;
+
+    return 0;
+}
+
+static void
+bh_pop_run(void *arg, uint64_t iters)
+{
+    struct bh_ctx *ctx = arg;
+    uint64_t popped = 0;
+    void *item;
+
+    while (iters-- > 0 && bin_heap_pop(ctx->bh, &item))
+        popped++;
+
+    mb_sink(popped);
+}
+
+static const struct mb_bench bh_benchv[] = {
+    { "merge", BH_KEYC, bh_setup, bh_reset, bh_pop_run, bh_teardown },
+};
+
+MB_SUITE(bin_heap, bh_benchv);
@@ -0,0 +1,142 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <hse/error/merr.h>
+#include <hse/util/bloom_filter.h>
+
+#include "microbench.h"
+
+/* BF_PROB matches the default of the cn_bloom_prob kvs rparam, and
+ * BF_KEYC yields a filter larger than a typical L2 cache.
+ */
+#define BF_KEYC (1024 * 1024)
+#define BF_PROB (10000)
+
+struct bf_ctx {
+    struct bloom_filter filter;
+    struct bf_bithash_desc desc;
+    uint8_t *storage;
+    uint32_t storagesz;
+    uint64_t *hashv;
+    uint64_t *missv;
+    bool prefill;
+};
+
+static void
+bf_reset(void *arg)
+{
+    struct bf_ctx *ctx = arg;
+
+    memset(ctx->storage, 0, ctx->storagesz);
+    bf_filter_init(&ctx->filter, ctx->desc, BF_KEYC, ctx->storage, ctx->storagesz);
+
+    if (ctx->prefill)
+        bf_filter_insert_by_hashv(&ctx->filter, ctx->hashv, BF_KEYC);
+}
+
+static merr_t
+bf_setup(void **arg, bool prefill)
+{
+    struct bf_ctx *ctx;
+
+    ctx = calloc(1, sizeof(*ctx));
+    if (!ctx)
+        return merr(ENOMEM);
+
+    ctx->prefill = prefill;
+    ctx->desc = bf_compute_bithash_est(BF_PROB);
+    ctx->storagesz = bf_size_estimate(ctx->desc, BF_KEYC);
+    ctx->storage = malloc(ctx->storagesz);
+    ctx->hashv = mb_keys_create(BF_KEYC, sizeof(uint64_t), MB_SEED);
+    ctx->missv = mb_keys_create(BF_KEYC, sizeof(uint64_t), ~MB_SEED);
+
+    if (!ctx->storage || !ctx->hashv || !ctx->missv) {
+        free(ctx->missv);
+        free(ctx->hashv);
+        free(ctx->storage);
+        free(ctx);
+        return merr(ENOMEM);
+    }
+
+    bf_reset(ctx);
+    *arg = ctx;
+
+    return 0;
+}
+
+static merr_t
+bf_insert_setup(void **arg)
+{
+    return bf_setup(arg, false);
+}
+
+static merr_t
+bf_lookup_setup(void **arg)
+{
+    return bf_setup(arg, true);
+}
+
+static void
+bf_insert_run(void *arg, uint64_t iters)
+{
+    struct bf_ctx *ctx = arg;
+
+    for (uint64_t i = 0; i < iters; i++)
+        bf_filter_insert_by_hash(&ctx->filter, ctx->hashv[i % BF_KEYC]);
+}
+
+static uint64_t
+bf_lookupv(const struct bloom_filter *bf, const uint64_t *hashv, uint64_t iters)
+{
+    uint64_t hits = 0;
+
+    for (uint64_t i = 0; i < iters; i++) {
+        const uint64_t hash = hashv[i % BF_KEYC];
+        const uint8_t *bitmap;
+
+        bitmap = bf->bf_bitmap + bf_hash2bkt(hash, bf->bf_modulus, bf->bf_bktshift);
+        hits += bf_lookup(hash, bitmap, bf->bf_n_hashes, bf->bf_rotl, bf->bf_bktmask);
+    }
+
+    return hits;
+}
+
+static void
+bf_hit_run(void *arg, uint64_t iters)
+{
+    struct bf_ctx *ctx = arg;
+
+    mb_sink(bf_lookupv(&ctx->filter, ctx->hashv, iters));
+}
+
+static void
+bf_miss_run(void *arg, uint64_t iters)
+{
+    struct bf_ctx *ctx = arg;
+
+    mb_sink(bf_lookupv(&ctx->filter, ctx->missv, iters));
+}
+
+static void
+bf_teardown(void *arg)
+{
+    struct bf_ctx *ctx = arg;
+
+    free(ctx->missv);
+    free(ctx->hashv);
+    free(ctx->storage);
+    free(ctx);
+}
+
+static const struct mb_bench bf_benchv[] = {
+    { "insert", BF_KEYC, bf_insert_setup, bf_reset, bf_insert_run, bf_teardown },
+    { "lookup_hit", BF_KEYC, bf_lookup_setup, NULL, bf_hit_run, bf_teardown },
+    { "lookup_miss", BF_KEYC, bf_lookup_setup, NULL, bf_miss_run, bf_teardown },
+};
+
+MB_SUITE(bloom_filter, bf_benchv);
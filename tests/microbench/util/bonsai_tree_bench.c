@@ -0,0 +1,168 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <hse/error/merr.h>
+#include <hse/util/bonsai_tree.h>
+#include <hse/util/cursor_heap.h>
+#include <hse/util/seqno.h>
+
+#include "microbench.h"
+
+#define BT_KEYC (256 * 1024)
+#define BT_KLEN (16)
+
+struct bt_ctx {
+    struct cheap *cheap;
+    struct bonsai_root *tree;
+    uint8_t *keys;
+    bool prefill;
+};
+
+/* c0 keeps a list of values per key, but every key inserted here is
+ * (with overwhelming probability) unique, so replacement merely swaps
+ * the head of the list.
+ */
+static void
+bt_ior_cb(
+    void *cbarg,
+    enum bonsai_ior_code *code,
+    struct bonsai_kv *kv,
+    struct bonsai_val *new_val,
+    struct bonsai_val **old_val,
+    uint height)
+{
+    if (IS_IOR_INS(*code)) {
+        kv->bkv_valcnt++;
+        return;
+    }
+
+    SET_IOR_REP(*code);
+    *old_val = rcu_dereference(kv->bkv_values);
+    new_val->bv_next = NULL;
+    rcu_assign_pointer(kv->bkv_values, new_val);
+}
+
+static void
+bt_insert(struct bt_ctx *ctx, uint64_t iters)
+{
+    rcu_read_lock();
+    for (uint64_t i = 0; i < iters; i++) {
+        struct bonsai_skey skey;
+        struct bonsai_sval sval;
+        void *key = ctx->keys + (i % BT_KEYC) * BT_KLEN;
+
+        bn_skey_init(key, BT_KLEN, 0, 0, &skey);
+        bn_sval_init(key, BT_KLEN, HSE_ORDNL_TO_SQNREF(i), &sval);
+
+        if (bn_insert_or_replace(ctx->tree, &skey, &sval))
+            abort();
+    }
+    rcu_read_unlock();
+}
+
+static void
+bt_reset(void *arg)
+{
+    struct bt_ctx *ctx = arg;
+
+    /* Only the insert benchmark modifies the tree.
+     */
+    if (ctx->prefill && ctx->tree)
+        return;
+
+    if (ctx->tree)
+        bn_destroy(ctx->tree);
+    cheap_reset(ctx->cheap, 0);
+
+    if (bn_create(ctx->cheap, bt_ior_cb, NULL, &ctx->tree))
+        abort();
+
+    if (ctx->prefill)
+        bt_insert(ctx, BT_KEYC);
+}
+
+static merr_t
+bt_setup(void **arg, bool prefill)
+{
+    struct bt_ctx *ctx;
+
+    ctx = calloc(1, sizeof(*ctx));
+    if (!ctx)
+        return merr(ENOMEM);
+
+    ctx->prefill = prefill;
+    ctx->keys = mb_keys_create(BT_KEYC, BT_KLEN, MB_SEED);
+    ctx->cheap = cheap_create(16, 256 << 20);
+
+    if (!ctx->keys || !ctx->cheap) {
+        cheap_destroy(ctx->cheap);
+        free(ctx->keys);
+        free(ctx);
+        return merr(ENOMEM);
+    }
+
+    *arg = ctx;
+
+    return 0;
+}
+
+static merr_t
+bt_insert_setup(void **arg)
+{
+    return bt_setup(arg, false);
+}
+
+static merr_t
+bt_find_setup(void **arg)
+{
+    return bt_setup(arg, true);
+}
+
+static void
+bt_insert_run(void *arg, uint64_t iters)
+{
+    bt_insert(arg, iters);
+}
+
+static void
+bt_find_run(void *arg, uint64_t iters)
+{
+    struct bt_ctx *ctx = arg;
+    uint64_t found = 0;
+
+    rcu_read_lock();
+    for (uint64_t i = 0; i < iters; i++) {
+        struct bonsai_skey skey;
+        struct bonsai_kv *kv;
+
+        bn_skey_init(ctx->keys + (i % BT_KEYC) * BT_KLEN, BT_KLEN, 0, 0, &skey);
+        found += bn_find(ctx->tree, &skey, &kv);
+    }
+    rcu_read_unlock();
+
+    mb_sink(found);
+}
+
+static void
+bt_teardown(void *arg)
+{
+    struct bt_ctx *ctx = arg;
+
+    if (ctx->tree)
+        bn_destroy(ctx->tree);
+    cheap_destroy(ctx->cheap);
+    free(ctx->keys);
+    free(ctx);
+}
+
+static const struct mb_bench bt_benchv[] = {
+    { "insert", BT_KEYC, bt_insert_setup, bt_reset, bt_insert_run, bt_teardown },
+    { "find", BT_KEYC, bt_find_setup, bt_reset, bt_find_run, bt_teardown },
+};
+
+MB_SUITE(bonsai_tree, bt_benchv);
@@ -0,0 +1,89 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <stdlib.h>
+
+#include <hse/error/merr.h>
+#include <hse/util/cursor_heap.h>
+
+#include "microbench.h"
+
+/* Allocation sizes vary between 16 and 142 bytes, like the keys, values
+ * and bonsai nodes allocated from a c0 kvms cheap.
+ */
+#define CH_ITERS  (1024 * 1024)
+#define CH_SIZEC  (4096)
+#define CH_HEAPSZ (256ul << 20)
+
+struct ch_ctx {
+    struct cheap *cheap;
+    uint8_t *sizev;
+};
+
+static merr_t
+ch_setup(void **arg)
+{
+    struct ch_ctx *ctx;
+
+    ctx = calloc(1, sizeof(*ctx));
+    if (!ctx)
+        return merr(ENOMEM);
+
+    ctx->cheap = cheap_create(16, CH_HEAPSZ);
+    ctx->sizev = mb_keys_create(CH_SIZEC, 1, MB_SEED);
+
+    if (!ctx->cheap || !ctx->sizev) {
+        free(ctx->sizev);
+        cheap_destroy(ctx->cheap);
+        free(ctx);
+        return merr(ENOMEM);
+    }
+
+    for (int i = 0; i < CH_SIZEC; i++)
+        ctx->sizev[i] = 16 + ctx->sizev[i] % 127;
+
+    *arg = ctx;
+
+    return 0;
+}
+
+static void
+ch_reset(void *arg)
+{
+    struct ch_ctx *ctx = arg;
+
+    cheap_reset(ctx->cheap, 0);
+}
+
+static void
+ch_malloc_run(void *arg, uint64_t iters)
+{
+    struct ch_ctx *ctx = arg;
+
+    for (uint64_t i = 0; i < iters; i++) {
+        uint64_t *mem = cheap_malloc(ctx->cheap, ctx->sizev[i % CH_SIZEC]);
+
+        if (!mem)
+            abort();
+
+        *mem = i;
+    }
+}
+
+static void
+ch_teardown(void *arg)
+{
+    struct ch_ctx *ctx = arg;
+
+    free(ctx->sizev);
+    cheap_destroy(ctx->cheap);
+    free(ctx);
+}
+
+static const struct mb_bench ch_benchv[] = {
+    { "malloc", CH_ITERS, ch_setup, ch_reset, ch_malloc_run, ch_teardown },
+};
+
+MB_SUITE(cursor_heap, ch_benchv);
@@ -0,0 +1,127 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <hse/error/merr.h>
+#include <hse/util/key_util.h>
+#include <hse/util/keycmp.h>
+
+#include "microbench.h"
+
+/* Keys share a KC_PFXLEN byte prefix, as do keys in the same kvs
+ * prefix, so that comparisons must look past the first word.  The
+ * dataset is small enough to stay cache resident, so these benchmarks
+ * measure the cost of a comparison rather than that of a cache miss.
+ */
+#define KC_KEYC   (4096)
+#define KC_KLEN   (32)
+#define KC_PFXLEN (12)
+#define KC_ITERS  (4 * 1024 * 1024)
+
+struct kc_ctx {
+    uint8_t *keys;
+    struct key_immediate *immv;
+    struct key_disc *discv;
+};
+
+static merr_t
+kc_setup(void **arg)
+{
+    struct kc_ctx *ctx;
+
+    ctx = calloc(1, sizeof(*ctx));
+    if (!ctx)
+        return merr(ENOMEM);
+
+    ctx->keys = mb_keys_create(KC_KEYC, KC_KLEN, MB_SEED);
+    ctx->immv = calloc(KC_KEYC, sizeof(*ctx->immv));
+    ctx->discv = calloc(KC_KEYC, sizeof(*ctx->discv));
+
+    if (!ctx->keys || !ctx->immv || !ctx->discv) {
+        free(ctx->discv);
+        free(ctx->immv);
+        free(ctx->keys);
+        free(ctx);
+        return merr(ENOMEM);
+    }
+
+    for (uint64_t i = 0; i < KC_KEYC; i++) {
+        uint8_t *key = ctx->keys + i * KC_KLEN;
+
+        memcpy(key, ctx->keys, KC_PFXLEN);
+        key_immediate_init(key, KC_KLEN, 0, ctx->immv + i);
+        key_disc_init(key, KC_KLEN, ctx->discv + i);
+    }
+
+    *arg = ctx;
+
+    return 0;
+}
+
+static void
+kc_keycmp_run(void *arg, uint64_t iters)
+{
+    struct kc_ctx *ctx = arg;
+    uint64_t lt = 0;
+
+    for (uint64_t i = 0; i < iters; i++) {
+        const void *k1 = ctx->keys + (i % KC_KEYC) * KC_KLEN;
+        const void *k2 = ctx->keys + ((i + 1) % KC_KEYC) * KC_KLEN;
+
+        lt += keycmp(k1, KC_KLEN, k2, KC_KLEN) < 0;
+    }
+
+    mb_sink(lt);
+}
+
+static void
+kc_full_cmp_run(void *arg, uint64_t iters)
+{
+    struct kc_ctx *ctx = arg;
+    uint64_t lt = 0;
+
+    for (uint64_t i = 0; i < iters; i++) {
+        const uint64_t i1 = i % KC_KEYC;
+        const uint64_t i2 = (i + 1) % KC_KEYC;
+
+        lt += key_full_cmp(ctx->immv + i1, ctx->keys + i1 * KC_KLEN, ctx->immv + i2,
+                           ctx->keys + i2 * KC_KLEN) < 0;
+    }
+
+    mb_sink(lt);
+}
+
+static void
+kc_disc_cmp_run(void *arg, uint64_t iters)
+{
+    struct kc_ctx *ctx = arg;
+    uint64_t lt = 0;
+
+    for (uint64_t i = 0; i < iters; i++)
+        lt += key_disc_cmp(ctx->discv + (i % KC_KEYC), ctx->discv + ((i + 1) % KC_KEYC)) < 0;
+
+    mb_sink(lt);
+}
+
+static void
+kc_teardown(void *arg)
+{
+    struct kc_ctx *ctx = arg;
+
+    free(ctx->discv);
+    free(ctx->immv);
+    free(ctx->keys);
+    free(ctx);
+}
+
+static const struct mb_bench kc_benchv[] = {
+    { "keycmp", KC_ITERS, kc_setup, NULL, kc_keycmp_run, kc_teardown },
+    { "key_full_cmp", KC_ITERS, kc_setup, NULL, kc_full_cmp_run, kc_teardown },
+    { "key_disc_cmp", KC_ITERS, kc_setup, NULL, kc_disc_cmp_run, kc_teardown },
+};
+
+MB_SUITE(keycmp, kc_benchv);
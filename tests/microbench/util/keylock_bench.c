@@ -0,0 +1,97 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <stdlib.h>
+
+#include <hse/error/merr.h>
+#include <hse/util/keylock.h>
+
+#include "microbench.h"
+
+/* Each op locks and later unlocks one key of a KL_BATCH key transaction
+ * while the table is held at a load factor of one half by KL_HELD keys
+ * of other transactions, so that lookups must probe past other entries.
+ */
+#define KL_HELD  (KLE_PSL_MAX / 2)
+#define KL_BATCH (64)
+#define KL_HASHC (256 * 1024)
+#define KL_ITERS (KL_HASHC)
+
+struct kl_ctx {
+    struct keylock *kl;
+    uint64_t *hashv;
+};
+
+static merr_t
+kl_setup(void **arg)
+{
+    struct kl_ctx *ctx;
+    uint64_t *heldv;
+    merr_t err;
+
+    ctx = calloc(1, sizeof(*ctx));
+    if (!ctx)
+        return merr(ENOMEM);
+
+    ctx->hashv = mb_keys_create(KL_HASHC, sizeof(uint64_t), MB_SEED);
+    heldv = mb_keys_create(KL_HELD, sizeof(uint64_t), ~MB_SEED);
+
+    err = (ctx->hashv && heldv) ? keylock_create(NULL, &ctx->kl) : merr(ENOMEM);
+
+    for (uint64_t i = 0; i < KL_HELD && !err; i++) {
+        bool inherited;
+
+        err = keylock_lock(ctx->kl, heldv[i], 0, 0, &inherited);
+    }
+
+    free(heldv);
+
+    if (err) {
+        keylock_destroy(ctx->kl);
+        free(ctx->hashv);
+        free(ctx);
+        return err;
+    }
+
+    *arg = ctx;
+
+    return 0;
+}
+
+static void
+kl_lock_unlock_run(void *arg, uint64_t iters)
+{
+    struct kl_ctx *ctx = arg;
+    uint64_t denied = 0;
+
+    for (uint64_t i = 0; i < iters; i += KL_BATCH) {
+        const uint64_t *hashv = ctx->hashv + (i % KL_HASHC);
+        bool inherited;
+
+        for (uint64_t j = 0; j < KL_BATCH; j++)
+            denied += !!keylock_lock(ctx->kl, hashv[j], 1, 1, &inherited);
+
+        for (uint64_t j = 0; j < KL_BATCH; j++)
+            keylock_unlock(ctx->kl, hashv[j], 1);
+    }
+
+    mb_sink(denied);
+}
+
+static void
+kl_teardown(void *arg)
+{
+    struct kl_ctx *ctx = arg;
+
+    keylock_destroy(ctx->kl);
+    free(ctx->hashv);
+    free(ctx);
+}
+
+static const struct mb_bench kl_benchv[] = {
+    { "lock_unlock", KL_ITERS, kl_setup, NULL, kl_lock_unlock_run, kl_teardown },
+};
+
+MB_SUITE(keylock, kl_benchv);
@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <stdlib.h>
+
+#include <hse/error/merr.h>
+#include <hse/util/slab.h>
+
+#include "microbench.h"
+
+#define SL_OBJSZ (128)
+#define SL_BATCH (1024)
+#define SL_ITERS (1024 * 1024)
+
+struct sl_ctx {
+    struct kmem_cache *zone;
+    void *objv[SL_BATCH];
+};
+
+static merr_t
+sl_setup(void **arg)
+{
+    struct sl_ctx *ctx;
+
+    ctx = calloc(1, sizeof(*ctx));
+    if (!ctx)
+        return merr(ENOMEM);
+
+    ctx->zone = kmem_cache_create("microbench", SL_OBJSZ, 0, 0, NULL);
+    if (!ctx->zone) {
+        free(ctx);
+        return merr(ENOMEM);
+    }
+
+    *arg = ctx;
+
+    return 0;
+}
+
+static void
+sl_alloc_free_run(void *arg, uint64_t iters)
+{
+    struct sl_ctx *ctx = arg;
+
+    for (uint64_t i = 0; i < iters; i++) {
+        void *obj = kmem_cache_alloc(ctx->zone);
+
+        if (!obj)
+            abort();
+
+        kmem_cache_free(ctx->zone, obj);
+    }
+}
+
+/* Allocate and then free objects in batches, so that the allocator
+ * must move beyond its per-cpu cache of free objects.
+ */
+static void
+sl_batch_run(void *arg, uint64_t iters)
+{
+    struct sl_ctx *ctx = arg;
+
+    for (uint64_t i = 0; i < iters; i += SL_BATCH) {
+        for (int j = 0; j < SL_BATCH; j++) {
+            ctx->objv[j] = kmem_cache_alloc(ctx->zone);
+            if (!ctx->objv[j])
+                abort();
+        }
+
+        for (int j = 0; j < SL_BATCH; j++)
+            kmem_cache_free(ctx->zone, ctx->objv[j]);
+    }
+}
+
+static void
+sl_teardown(void *arg)
+{
+    struct sl_ctx *ctx = arg;
+
+    kmem_cache_destroy(ctx->zone);
+    free(ctx);
+}
+
+static const struct mb_bench sl_benchv[] = {
+    { "alloc_free", SL_ITERS, sl_setup, NULL, sl_alloc_free_run, sl_teardown },
+    { "alloc_free_batch", SL_ITERS, sl_setup, NULL, sl_batch_run, sl_teardown },
+};
+
+MB_SUITE(slab, sl_benchv);
@@ -0,0 +1,94 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <hse/error/merr.h>
+#include <hse/util/atomic.h>
+
+#include "wal/wal_buffer.h"
+
+#include "microbench.h"
+
+/* Each op reserves, fills and completes one WAL record, as does a
+ * put to a kvs.  The bufset is never flushed, so it needs neither
+ * a fileset nor an io callback, but a repetition must not reach
+ * the buffer's high water mark (WB_BUFSZ less 8MiB) because the
+ * allocator would then wait forever for a flush.
+ */
+#define WB_BUFSZ  (64ul << 20)
+#define WB_RECLEN (64)
+#define WB_ITERS  (512 * 1024)
+
+struct wb_ctx {
+    struct wal_bufset *wbs;
+    atomic_ulong ingestgen;
+    uint8_t rec[WB_RECLEN];
+};
+
+static void
+wb_reset(void *arg)
+{
+    struct wb_ctx *ctx = arg;
+
+    wal_bufset_close(ctx->wbs);
+
+    ctx->wbs = wal_bufset_open(NULL, WB_BUFSZ, 32u << 20, &ctx->ingestgen, NULL);
+    if (!ctx->wbs)
+        abort();
+}
+
+static merr_t
+wb_setup(void **arg)
+{
+    struct wb_ctx *ctx;
+
+    ctx = calloc(1, sizeof(*ctx));
+    if (!ctx)
+        return merr(ENOMEM);
+
+    atomic_set(&ctx->ingestgen, 0);
+    memset(ctx->rec, 0xa5, sizeof(ctx->rec));
+
+    *arg = ctx;
+
+    return 0;
+}
+
+static void
+wb_alloc_run(void *arg, uint64_t iters)
+{
+    struct wb_ctx *ctx = arg;
+
+    for (uint64_t i = 0; i < iters; i++) {
+        int64_t cookie = -1;
+        uint64_t off;
+        uint32_t wbidx;
+        void *rec;
+
+        rec = wal_bufset_alloc(ctx->wbs, WB_RECLEN, &off, &wbidx, &cookie);
+        if (!rec)
+            abort();
+
+        memcpy(rec, ctx->rec, WB_RECLEN);
+        wal_bufset_finish(ctx->wbs, wbidx, WB_RECLEN, 1, off + WB_RECLEN);
+    }
+}
+
+static void
+wb_teardown(void *arg)
+{
+    struct wb_ctx *ctx = arg;
+
+    wal_bufset_close(ctx->wbs);
+    free(ctx);
+}
+
+static const struct mb_bench wb_benchv[] = {
+    { "alloc_finish", WB_ITERS, wb_setup, wb_reset, wb_alloc_run, wb_teardown },
+};
+
+MB_SUITE(wal_buffer, wb_benchv);
@@ -716,6 +716,7 @@ mock_cn_unset()
  */
 static struct mapi_injection c0_inject_list[] = {
     { mapi_idx_c0_cursor_update, MAPI_RC_SCALAR, 0 },
+    { mapi_idx_c0_cursor_rtombs, MAPI_RC_SCALAR, 0 },
     { mapi_idx_c0_cursor_bind_txn, MAPI_RC_SCALAR, 0 },
     { -1 },
 };
@@ -897,6 +898,7 @@ static struct mapi_injection wal_inject_list[] = {
     { mapi_idx_wal_put, MAPI_RC_SCALAR, 0 },
     { mapi_idx_wal_del, MAPI_RC_SCALAR, 0 },
     { mapi_idx_wal_del_pfx, MAPI_RC_SCALAR, 0 },
+    { mapi_idx_wal_del_range, MAPI_RC_SCALAR, 0 },
     { mapi_idx_wal_txn_begin, MAPI_RC_SCALAR, 0 },
     { mapi_idx_wal_txn_abort, MAPI_RC_SCALAR, 0 },
     { mapi_idx_wal_txn_commit, MAPI_RC_SCALAR, 0 },
@@ -722,6 +722,11 @@ _kvset_iter_seek(struct kv_iterator *kvi, const void *key, int len, bool *eof)
  */
 static struct mapi_injection inject_list[] = { { mapi_idx_kvset_kblk_start, MAPI_RC_SCALAR, 0 },
                                                { mapi_idx_kvset_set_rule, MAPI_RC_SCALAR, 0 },
+                                               { mapi_idx_kvset_get_rtombs, MAPI_RC_SCALAR, 0 },
+                                               { mapi_idx_kvset_get_heat, MAPI_RC_SCALAR, 0 },
+                                               { mapi_idx_kvset_set_heat, MAPI_RC_SCALAR, 0 },
+                                               { mapi_idx_kvset_heat_decay, MAPI_RC_SCALAR, 0 },
+                                               { mapi_idx_kvset_get_staging_alen, MAPI_RC_SCALAR, 0 },
                                                { -1 } };
 
 void
@@ -384,6 +384,19 @@ _mpool_mdc_append(struct mpool_mdc *mdc, void *data, size_t len, bool sync)
     return 0;
 }
 
+merr_t
+_mpool_mdc_append_async(struct mpool_mdc *mdc, void *data, size_t len, uint64_t *gen)
+{
+    *gen = 1;
+    return _mpool_mdc_append(mdc, data, len, false);
+}
+
+merr_t
+_mpool_mdc_sync_wait(struct mpool_mdc *mdc, uint64_t gen)
+{
+    return 0;
+}
+
 merr_t
 _mpool_mdc_rewind(struct mpool_mdc *mdc)
 {
@@ -681,12 +694,14 @@ mock_mpool_set(void)
     MOCK_SET(mpool, _mpool_mblock_write);
 
     MOCK_SET(mpool, _mpool_mdc_append);
+    MOCK_SET(mpool, _mpool_mdc_append_async);
     MOCK_SET(mpool, _mpool_mdc_cend);
     MOCK_SET(mpool, _mpool_mdc_close);
     MOCK_SET(mpool, _mpool_mdc_cstart);
     MOCK_SET(mpool, _mpool_mdc_open);
     MOCK_SET(mpool, _mpool_mdc_read);
     MOCK_SET(mpool, _mpool_mdc_rewind);
+    MOCK_SET(mpool, _mpool_mdc_sync_wait);
 
     MOCK_SET(mpool, _mpool_props_get);
 
@@ -707,12 +722,14 @@ mock_mpool_unset(void)
     MOCK_UNSET(mpool, _mpool_mblock_write);
 
     MOCK_UNSET(mpool, _mpool_mdc_append);
+    MOCK_UNSET(mpool, _mpool_mdc_append_async);
     MOCK_UNSET(mpool, _mpool_mdc_cend);
     MOCK_UNSET(mpool, _mpool_mdc_close);
     MOCK_UNSET(mpool, _mpool_mdc_cstart);
     MOCK_UNSET(mpool, _mpool_mdc_open);
     MOCK_UNSET(mpool, _mpool_mdc_read);
     MOCK_UNSET(mpool, _mpool_mdc_rewind);
+    MOCK_UNSET(mpool, _mpool_mdc_sync_wait);
 
     MOCK_UNSET(mpool, _mpool_props_get);
 
@@ -1149,4 +1149,81 @@ MTF_DEFINE_UTEST_PREPOST(c0_kvset_test, iterator, no_fail_pre, no_fail_post)
     c0kvs_destroy(kvs);
 }
 
+MTF_DEFINE_UTEST_PREPOST(c0_kvset_test, merge, no_fail_pre, no_fail_post)
+{
+    struct c0_kvset *kvs;
+    struct kvs_ktuple kt;
+    struct kvs_vtuple vt;
+    struct kvs_buf vb;
+    enum key_lookup_res res;
+    uintptr_t oseqnoref;
+    uint64_t val, opnd;
+    char vbuf[32];
+    merr_t err;
+
+    err = c0kvs_create(NULL, NULL, &kvs);
+    ASSERT_EQ(0, err);
+
+    kvs_ktuple_init(&kt, "counter", 7);
+
+    val = 5;
+    kvs_vtuple_init(&vt, &val, sizeof(val));
+    err = c0kvs_put(kvs, 0, &kt, &vt, HSE_ORDNL_TO_SQNREF(1));
+    ASSERT_EQ(0, err);
+
+    /* An operand with a new seqno is inserted as an operand...
+     */
+    opnd = 3;
+    kvs_vtuple_minit(&vt, &opnd, sizeof(opnd));
+    err = c0kvs_merge(kvs, 0, &kt, &vt, HSE_ORDNL_TO_SQNREF(2), MERGE_OP_ADD_U64);
+    ASSERT_EQ(0, err);
+
+    /* ...and folded into an operand with the same seqno, which remains an operand.
+     */
+    opnd = 4;
+    err = c0kvs_merge(kvs, 0, &kt, &vt, HSE_ORDNL_TO_SQNREF(2), MERGE_OP_ADD_U64);
+    ASSERT_EQ(0, err);
+
+    kvs_buf_init(&vb, vbuf, sizeof(vbuf));
+    err = c0kvs_get_excl(kvs, 0, &kt, 2, 0, &res, &vb, &oseqnoref);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(FOUND_MOPND, res);
+    ASSERT_EQ(2, HSE_SQNREF_TO_ORDNL(oseqnoref));
+    ASSERT_EQ(sizeof(uint64_t), vb.b_len);
+    ASSERT_EQ(7, *(uint64_t *)vbuf);
+
+    /* An operand with the same seqno as a value is folded into the value.
+     */
+    opnd = 10;
+    err = c0kvs_merge(kvs, 0, &kt, &vt, HSE_ORDNL_TO_SQNREF(1), MERGE_OP_ADD_U64);
+    ASSERT_EQ(0, err);
+
+    err = c0kvs_get_excl(kvs, 0, &kt, 1, 0, &res, &vb, &oseqnoref);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(FOUND_VAL, res);
+    ASSERT_EQ(1, HSE_SQNREF_TO_ORDNL(oseqnoref));
+    ASSERT_EQ(15, *(uint64_t *)vbuf);
+
+    /* An operand with the same seqno as a tombstone replaces it with a value.
+     */
+    err = c0kvs_del(kvs, 0, &kt, HSE_ORDNL_TO_SQNREF(3));
+    ASSERT_EQ(0, err);
+
+    kvs_vtuple_minit(&vt, "ab", 2);
+    err = c0kvs_merge(kvs, 0, &kt, &vt, HSE_ORDNL_TO_SQNREF(3), MERGE_OP_APPEND);
+    ASSERT_EQ(0, err);
+
+    kvs_vtuple_minit(&vt, "cd", 2);
+    err = c0kvs_merge(kvs, 0, &kt, &vt, HSE_ORDNL_TO_SQNREF(3), MERGE_OP_APPEND);
+    ASSERT_EQ(0, err);
+
+    err = c0kvs_get_excl(kvs, 0, &kt, 3, 0, &res, &vb, &oseqnoref);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(FOUND_VAL, res);
+    ASSERT_EQ(4, vb.b_len);
+    ASSERT_EQ(0, memcmp(vbuf, "abcd", 4));
+
+    c0kvs_destroy(kvs);
+}
+
 MTF_END_UTEST_COLLECTION(c0_kvset_test)
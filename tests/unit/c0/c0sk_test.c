@@ -12,11 +12,13 @@
 #include <hse/ikvdb/c0_kvmultiset.h>
 #include <hse/ikvdb/c0sk.h>
 #include <hse/ikvdb/c0snr_set.h>
+#include <hse/ikvdb/cn.h>
 #include <hse/ikvdb/cndb.h>
 #include <hse/ikvdb/cursor.h>
 #include <hse/ikvdb/kvdb_health.h>
 #include <hse/ikvdb/kvdb_rparams.h>
 #include <hse/ikvdb/kvs.h>
+#include <hse/ikvdb/kvs_cparams.h>
 #include <hse/ikvdb/kvset_builder.h>
 #include <hse/ikvdb/lc.h>
 #include <hse/ikvdb/limits.h>
@@ -2562,4 +2564,150 @@ MTF_DEFINE_UTEST_PREPOST(c0sk_test, c0_deregister, no_fail_pre, no_fail_post)
     destroy_mock_cn(mock_cn);
 }
 
+MTF_DEFINE_UTEST_PREPOST(c0sk_test, get_merged, no_fail_pre, no_fail_post)
+{
+    struct kvdb_rparams kvdb_rp;
+    struct c0sk_impl *self;
+    struct c0_kvmultiset *kvms;
+    struct kvs_ktuple kt;
+    struct kvs_vtuple vt;
+    struct kvs_buf vbuf;
+    struct c0sk_mres mres = { 0 };
+    struct c0sk_mscratch ms = { 0 };
+    char *vp, *op;
+    enum key_lookup_res res;
+    struct mock_kvdb mkvdb;
+    struct cn *mock_cn;
+    atomic_ulong seqno;
+    uint64_t val, opnd;
+    uint16_t skidx;
+    merr_t err;
+
+    kvdb_rp = kvdb_rparams_defaults();
+
+    atomic_set(&seqno, 1);
+    err = c0sk_open(&kvdb_rp, 0, "mock_mp", &mock_health, &seqno, 0, &mkvdb.ikdb_c0sk);
+    ASSERT_EQ(0, err);
+
+    err = create_mock_cn(&mock_cn, false, false, 0);
+    ASSERT_EQ(0, err);
+
+    cn_get_cparams(mock_cn)->merge_op = MERGE_OP_ADD_U64;
+
+    err = c0sk_c0_register(mkvdb.ikdb_c0sk, mock_cn, &skidx);
+    ASSERT_EQ(0, err);
+
+    self = c0sk_h2r(mkvdb.ikdb_c0sk);
+
+    err = c0kvms_create(1, &seqno, NULL, &kvms);
+    ASSERT_EQ(0, err);
+
+    err = c0sk_install_c0kvms(self, NULL, kvms);
+    ASSERT_EQ(0, err);
+
+    /* Neither lc nor cn has anything for these keys. */
+    mapi_inject(mapi_idx_lc_get, 0);
+    mapi_inject(mapi_idx_cn_get, 0);
+
+    /* "base": value 5 at seqno 1, operands 3 and 4 at seqnos 2 and 3 */
+    kvs_ktuple_init(&kt, "base", 4);
+
+    val = 5;
+    kvs_vtuple_init(&vt, &val, sizeof(val));
+    err = c0sk_put(mkvdb.ikdb_c0sk, skidx, &kt, &vt, HSE_SQNREF_SINGLE);
+    ASSERT_EQ(0, err);
+
+    for (opnd = 3; opnd <= 4; opnd++) {
+        atomic_inc(&seqno);
+        kvs_vtuple_minit(&vt, &opnd, sizeof(opnd));
+        err = c0sk_merge(mkvdb.ikdb_c0sk, skidx, &kt, &vt, HSE_SQNREF_SINGLE);
+        ASSERT_EQ(0, err);
+    }
+
+    kvs_buf_init(&vbuf, &val, sizeof(val));
+
+    err = c0sk_get(mkvdb.ikdb_c0sk, skidx, 0, &kt, 3, 0, &res, &vbuf);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(FOUND_MOPND, res);
+
+    err = c0sk_get_merged(mkvdb.ikdb_c0sk, skidx, 0, &kt, 3, &res, &vbuf);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(FOUND_VAL, res);
+    ASSERT_EQ(12, val);
+
+    err = c0sk_get_merged(mkvdb.ikdb_c0sk, skidx, 0, &kt, 2, &res, &vbuf);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(FOUND_VAL, res);
+    ASSERT_EQ(8, val);
+
+    err = c0sk_get_merged(mkvdb.ikdb_c0sk, skidx, 0, &kt, 1, &res, &vbuf);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(FOUND_VAL, res);
+    ASSERT_EQ(5, val);
+
+    /* The base value was found in c0, so lc and cn were never consulted. */
+    ASSERT_EQ(0, mapi_calls(mapi_idx_cn_get));
+
+    /* Each operand's result is recorded, oldest first. */
+    err = c0sk_get_merged_impl(self, skidx, 0, &kt, 3, NULL, &res, &vbuf, &ms, &mres);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(2, mres.mr_cnt);
+    ASSERT_EQ(2, mres.mr_entv[0].me_seq);
+    ASSERT_EQ(8, *(uint64_t *)(mres.mr_buf + mres.mr_entv[0].me_off));
+    ASSERT_EQ(3, mres.mr_entv[1].me_seq);
+    ASSERT_EQ(12, *(uint64_t *)(mres.mr_buf + mres.mr_entv[1].me_off));
+
+    /* The scratch buffers are retained and reused by the next lookup. */
+    ASSERT_NE(NULL, ms.ms_vbuf);
+    ASSERT_NE(NULL, ms.ms_obuf);
+    vp = ms.ms_vbuf;
+    op = ms.ms_obuf;
+
+    err = c0sk_get_merged_impl(self, skidx, 0, &kt, 3, NULL, &res, &vbuf, &ms, NULL);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(FOUND_VAL, res);
+    ASSERT_EQ(12, val);
+    ASSERT_EQ(vp, ms.ms_vbuf);
+    ASSERT_EQ(op, ms.ms_obuf);
+
+    c0sk_mscratch_fini(&ms);
+    ASSERT_EQ(NULL, ms.ms_vbuf);
+    ASSERT_EQ(NULL, ms.ms_obuf);
+    ASSERT_EQ(0, ms.ms_vbufsz);
+    ASSERT_EQ(0, ms.ms_obufsz);
+
+    free(mres.mr_entv);
+    free(mres.mr_buf);
+
+    /* "nobase": operands only, resolved against a missing value. */
+    kvs_ktuple_init(&kt, "nobase", 6);
+
+    for (opnd = 1; opnd <= 3; opnd++) {
+        atomic_inc(&seqno);
+        kvs_vtuple_minit(&vt, &opnd, sizeof(opnd));
+        err = c0sk_merge(mkvdb.ikdb_c0sk, skidx, &kt, &vt, HSE_SQNREF_SINGLE);
+        ASSERT_EQ(0, err);
+    }
+
+    err = c0sk_get_merged(mkvdb.ikdb_c0sk, skidx, 0, &kt, atomic_read(&seqno), &res, &vbuf);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(FOUND_VAL, res);
+    ASSERT_EQ(6, val);
+    ASSERT_EQ(1, mapi_calls_clear(mapi_idx_cn_get));
+
+    c0kvms_putref(kvms);
+
+    /* Ingest resolves all three operands of "nobase" with a single lookup.
+     */
+    err = c0sk_close(mkvdb.ikdb_c0sk);
+    ASSERT_EQ(0, err);
+
+    ASSERT_EQ(1, mapi_calls(mapi_idx_cn_get));
+
+    mapi_inject_unset(mapi_idx_lc_get);
+    mapi_inject_unset(mapi_idx_cn_get);
+
+    destroy_mock_cn(mock_cn);
+}
+
 MTF_END_UTEST_COLLECTION(c0sk_test)
@@ -68,7 +68,7 @@ MTF_DEFINE_UTEST_PRE(cn_api, basic, pre)
     mapi_inject_ptr(mapi_idx_ikvdb_kvdb_handle, NULL);
     mapi_inject_ptr(mapi_idx_kvdb_kvs_parent, NULL);
 
-    err = cn_kvdb_create(4, 4, &cn_kvdb);
+    err = cn_kvdb_create(4, 4, 4, 0, &cn_kvdb);
     ASSERT_EQ(0, err);
 
     err = cn_open(cn_kvdb, ds, &kk, cndb, 0, &rp, "mp", "kvs", &mock_health, 0, &cn);
@@ -198,6 +198,8 @@ MTF_DEFINE_UTEST_PRE(cn_ingest_test, commit_delete, test_pre)
     free_mblks(m, n_kvsets);
 
     init_mblks(m, n_kvsets, &k, &v);
+    for (uint i = 0; i < n_kvsets; i++)
+        m[i].bl_vadopted = v;
     mapi_calls_clear(mapi_idx_mpool_mblock_commit);
     err = cn_mblocks_commit(mock_ds, n_kvsets, m, CN_MUT_KCOMPACT);
     ASSERT_EQ(err, 0);
@@ -206,6 +208,18 @@ MTF_DEFINE_UTEST_PRE(cn_ingest_test, commit_delete, test_pre)
         n_kvsets * (1 + k)); /* kcompact ==> does not commit vblks, 1 for hblock */
     free_mblks(m, n_kvsets);
 
+    /* A kcompact commits the vblocks of relocated values which follow
+     * the adopted vblocks.
+     */
+    init_mblks(m, n_kvsets, &k, &v);
+    for (uint i = 0; i < n_kvsets; i++)
+        m[i].bl_vadopted = v - 2;
+    mapi_calls_clear(mapi_idx_mpool_mblock_commit);
+    err = cn_mblocks_commit(mock_ds, n_kvsets, m, CN_MUT_KCOMPACT);
+    ASSERT_EQ(err, 0);
+    ASSERT_EQ(mapi_calls(mapi_idx_mpool_mblock_commit), n_kvsets * (1 + k + 2));
+    free_mblks(m, n_kvsets);
+
     /* Test cn_mblocks_destroy with kcompact == false.
      * Should delete kblocks and vblocks.
      */
@@ -219,10 +233,33 @@ MTF_DEFINE_UTEST_PRE(cn_ingest_test, commit_delete, test_pre)
      * Should delete kblocks but not vblocks.
      */
     init_mblks(m, n_kvsets, &k, &v);
+    for (uint i = 0; i < n_kvsets; i++)
+        m[i].bl_vadopted = v;
     mapi_calls_clear(mapi_idx_mpool_mblock_delete);
     cn_mblocks_destroy(mock_ds, n_kvsets, m, 1);
     ASSERT_EQ(mapi_calls(mapi_idx_mpool_mblock_delete), n_kvsets * (1 + k)); /* 1 for hblock */
     free_mblks(m, n_kvsets);
+
+    /* Only the vblocks past the adopted vblocks are deleted, and with no
+     * adopted vblocks (every input relocated) all of them are.
+     */
+    init_mblks(m, n_kvsets, &k, &v);
+    for (uint i = 0; i < n_kvsets; i++)
+        m[i].bl_vadopted = i;
+    mapi_calls_clear(mapi_idx_mpool_mblock_delete);
+    cn_mblocks_destroy(mock_ds, n_kvsets, m, 1);
+    ASSERT_EQ(
+        mapi_calls(mapi_idx_mpool_mblock_delete),
+        n_kvsets * (1 + k + v) - (n_kvsets * (n_kvsets - 1)) / 2);
+    for (uint i = 0; i < n_kvsets; i++) {
+        for (uint j = 0; j < v; j++) {
+            if (j < i)
+                ASSERT_NE(0, m[i].vblks.idv[j]);
+            else
+                ASSERT_EQ(0, m[i].vblks.idv[j]);
+        }
+    }
+    free_mblks(m, n_kvsets);
 }
 
 MTF_DEFINE_UTEST_PRE(cn_ingest_test, worker, test_pre)
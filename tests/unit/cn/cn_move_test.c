@@ -9,6 +9,7 @@
 #include <hse/test/mock/mock_kvset.h>
 #include <hse/test/mtf/framework.h>
 
+#include "cn/blk_list.h"
 #include "cn/cn_tree_compact.h"
 #include "cn/cn_tree_internal.h"
 #include "cn/kvset.h"
@@ -71,6 +72,59 @@ get_kvset_cnt(struct cn_tree_node *tn)
     return cnt;
 }
 
+/* Migration mocks: every copy of mbid X yields X + MIGRATE_ID_OFFSET, and the
+ * copy numbered migrate_fail_at (1-based) fails with EIO.
+ */
+#define MIGRATE_ID_OFFSET 1000
+#define MIGRATE_WLEN      4096
+
+static uint64_t migrate_srcv[16];
+static uint migrate_copies;
+static uint migrate_fail_at;
+
+static merr_t
+mblock_props_get_mock(struct mpool *mp, uint64_t mbid, struct mblock_props *props)
+{
+    memset(props, 0, sizeof(*props));
+    props->mpr_objid = mbid;
+    props->mpr_write_len = MIGRATE_WLEN;
+
+    return 0;
+}
+
+static merr_t
+mblock_copy_mock(struct mpool *mp, uint64_t mbid, enum hse_mclass mclass, uint64_t *mbid_out)
+{
+    if (++migrate_copies == migrate_fail_at)
+        return merr(EIO);
+
+    if (migrate_copies <= NELEM(migrate_srcv))
+        migrate_srcv[migrate_copies - 1] = mbid;
+
+    *mbid_out = mbid + MIGRATE_ID_OFFSET;
+
+    return 0;
+}
+
+static const struct kvset_stats *
+kvset_statsp_mock(const struct kvset *ks)
+{
+    return &((const struct mock_kvset *)ks)->stats;
+}
+
+static void
+migrate_reset(struct cn_compaction_work *w, struct kvset_mblocks *outv, uint fail_at)
+{
+    blk_list_free(&outv->kblks);
+    blk_list_free(&outv->vblks);
+    memset(outv, 0, sizeof(*outv));
+    memset(&w->cw_stats, 0, sizeof(w->cw_stats));
+
+    memset(migrate_srcv, 0, sizeof(migrate_srcv));
+    migrate_copies = 0;
+    migrate_fail_at = fail_at;
+}
+
 /* ------------------------------------------------------------
  * Unit tests
  */
@@ -343,4 +397,125 @@ MTF_DEFINE_UTEST_PRE(move_test, dgen_compc_order, pre)
     rmlock_destroy(&tree.ct_lock);
 }
 
+MTF_DEFINE_UTEST_PRE(move_test, migrate, pre)
+{
+    struct cn_tree tree = { 0 };
+    struct cn_compaction_work w = { 0 };
+    struct cn_tree_node tn = { 0 };
+    struct kvset_list_entry le = { 0 };
+    struct kvset_mblocks outv = { 0 };
+    struct kvset_meta km = { 0 };
+    uint64_t kblkv[] = { 0x11, 0x12, 0x13 }, vblkv[] = { 0x21, 0x22 };
+    const struct kvset_stats *stats;
+    uint32_t nkblks, nvblks, ncopies;
+    atomic_int cancel;
+    struct kvset *ks;
+    merr_t err;
+
+    MOCK_SET_FN(mpool, mpool_mblock_props_get, mblock_props_get_mock);
+    MOCK_SET_FN(mpool, mpool_mblock_copy, mblock_copy_mock);
+    MOCK_SET_FN(kvset, kvset_statsp, kvset_statsp_mock);
+    mapi_inject(mapi_idx_kvset_get_hblock_id, 0x10);
+    mapi_inject(mapi_idx_kvset_get_seqno_max, 1234);
+
+    init_node(&tn, 1);
+    tree.cnid = 7;
+
+    km.km_nodeid = tn.tn_nodeid;
+    km.km_hblk_id = 0x10;
+    km.km_kblk_list.idv = kblkv;
+    km.km_kblk_list.idc = NELEM(kblkv);
+    km.km_vblk_list.idv = vblkv;
+    km.km_vblk_list.idc = NELEM(vblkv);
+    km.km_vused = 2000;
+
+    err = kvset_open(&tree, 1, &km, &ks);
+    ASSERT_EQ(0, err);
+
+    stats = kvset_statsp(ks);
+    nkblks = kvset_get_num_kblocks(ks);
+    nvblks = kvset_get_num_vblocks(ks);
+    ncopies = 1 + nkblks + nvblks;
+    ASSERT_EQ(NELEM(kblkv), nkblks);
+    ASSERT_EQ(NELEM(vblkv), nvblks);
+
+    atomic_set(&cancel, 0);
+    le.le_kvset = ks;
+    w.cw_tree = &tree;
+    w.cw_node = &tn;
+    w.cw_mark = &le;
+    w.cw_kvset_cnt = 1;
+    w.cw_outc = 1;
+    w.cw_outv = &outv;
+    w.cw_mclass = HSE_MCLASS_STAGING;
+    w.cw_cancel_request = &cancel;
+
+    /* Every mblock is copied in hblock, kblock, vblock order and the copies
+     * land in outv with the input kvset's value accounting.
+     */
+    migrate_reset(&w, &outv, 0);
+    err = cn_migrate(&w);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(ncopies, migrate_copies);
+
+    ASSERT_EQ(kvset_get_hblock_id(ks), migrate_srcv[0]);
+    ASSERT_EQ(kvset_get_hblock_id(ks) + MIGRATE_ID_OFFSET, outv.hblk_id);
+
+    ASSERT_EQ(nkblks, outv.kblks.idc);
+    for (uint32_t i = 0; i < nkblks; i++) {
+        ASSERT_EQ(kvset_get_nth_kblock_id(ks, i), migrate_srcv[1 + i]);
+        ASSERT_EQ(kvset_get_nth_kblock_id(ks, i) + MIGRATE_ID_OFFSET, outv.kblks.idv[i]);
+    }
+
+    ASSERT_EQ(nvblks, outv.vblks.idc);
+    for (uint32_t i = 0; i < nvblks; i++) {
+        ASSERT_EQ(kvset_get_nth_vblock_id(ks, i), migrate_srcv[1 + nkblks + i]);
+        ASSERT_EQ(kvset_get_nth_vblock_id(ks, i) + MIGRATE_ID_OFFSET, outv.vblks.idv[i]);
+    }
+
+    ASSERT_EQ(stats->kst_vulen, outv.bl_vused);
+    ASSERT_EQ(stats->kst_vulen + stats->kst_vgarb, outv.bl_vtotal);
+    ASSERT_EQ(1234, outv.bl_seqno_max);
+
+    ASSERT_EQ(1, w.cw_stats.ms_srcs);
+    ASSERT_EQ(stats->kst_keys, w.cw_stats.ms_keys_in);
+    ASSERT_EQ(stats->kst_keys, w.cw_stats.ms_keys_out);
+    ASSERT_EQ(1 + nkblks, w.cw_stats.ms_kblk_write.op_cnt);
+    ASSERT_EQ((1 + nkblks) * MIGRATE_WLEN, w.cw_stats.ms_kblk_write.op_size);
+    ASSERT_EQ(nvblks, w.cw_stats.ms_vblk_write.op_cnt);
+    ASSERT_EQ(nvblks * MIGRATE_WLEN, w.cw_stats.ms_vblk_write.op_size);
+
+    /* A failed copy stops the migration, and every copy made before it must
+     * be recorded in outv so that compaction cleanup can delete it.
+     */
+    for (uint fail_at = 1; fail_at <= ncopies; fail_at++) {
+        migrate_reset(&w, &outv, fail_at);
+        err = cn_migrate(&w);
+        ASSERT_EQ(EIO, merr_errno(err));
+        ASSERT_EQ(fail_at, migrate_copies);
+
+        ASSERT_EQ(fail_at > 1 ? kvset_get_hblock_id(ks) + MIGRATE_ID_OFFSET : 0, outv.hblk_id);
+        ASSERT_EQ(min_t(uint32_t, nkblks, fail_at > 1 ? fail_at - 2 : 0), outv.kblks.idc);
+        ASSERT_EQ(fail_at > 1 + nkblks ? fail_at - 2 - nkblks : 0, outv.vblks.idc);
+    }
+
+    /* A cancel request stops the migration before any copy is made.
+     */
+    migrate_reset(&w, &outv, 0);
+    atomic_set(&cancel, 1);
+    err = cn_migrate(&w);
+    ASSERT_EQ(ESHUTDOWN, merr_errno(err));
+    ASSERT_EQ(0, migrate_copies);
+    ASSERT_EQ(0, outv.hblk_id);
+
+    migrate_reset(&w, &outv, 0);
+    kvset_put_ref(ks);
+
+    mapi_inject_unset(mapi_idx_kvset_get_seqno_max);
+    mapi_inject_unset(mapi_idx_kvset_get_hblock_id);
+    MOCK_UNSET(kvset, _kvset_statsp);
+    MOCK_UNSET(mpool, _mpool_mblock_copy);
+    MOCK_UNSET(mpool, _mpool_mblock_props_get);
+}
+
 MTF_END_UTEST_COLLECTION(move_test)
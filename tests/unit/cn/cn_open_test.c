@@ -8,16 +8,22 @@
 #include <hse/error/merr.h>
 #include <hse/ikvdb/cn.h>
 #include <hse/ikvdb/cn_kvdb.h>
+#include <hse/ikvdb/cndb.h>
 #include <hse/ikvdb/kvdb_health.h>
 #include <hse/ikvdb/kvs_cparams.h>
+#include <hse/ikvdb/mclass_policy.h>
+#include <hse/util/atomic.h>
 
 #include <hse/test/mock/api.h>
+#include <hse/test/mock/mock_kvset.h>
 #include <hse/test/mtf/framework.h>
 
 #include "cn/cn_internal.h"
 #include "cn/cn_perfc.h"
 #include "cn/cn_tree.h"
 #include "cn/cn_tree_create.h"
+#include "cn/cn_tree_internal.h"
+#include "cn/kvset.h"
 
 static int
 init(struct mtf_test_info *lcl_ti)
@@ -98,7 +104,7 @@ pre(struct mtf_test_info *lcl_ti)
     h = &health;
     flags = 0;
 
-    err = cn_kvdb_create(4, 4, &cn_kvdb);
+    err = cn_kvdb_create(4, 4, 4, 0, &cn_kvdb);
 
     return merr_errno(err);
 }
@@ -191,4 +197,192 @@ MTF_DEFINE_UTEST_PREPOST(cn_open_test, cn_open_err_path, pre, post)
     ASSERT_EQ(err, 123);
 }
 
+/* Mocks for cn_open_kvsets: cndb yields KVSET_CNT kvsets with ascending
+ * dgens, all in the root node, and the kvset mocks count opens, inserts,
+ * preloads and releases.
+ */
+#define KVSET_CNT 300
+
+static atomic_int kvsets_opened;
+static atomic_int kvsets_released;
+static atomic_int kvsets_preloaded;
+static uint64_t kvset_failid;
+static uint64_t kvset_insertv[KVSET_CNT];
+static uint kvset_insertc;
+static struct mclass_policy kvset_mpolicy;
+
+static merr_t
+cndb_cn_instantiate_mock(struct cndb *cndb, uint64_t cnid, void *ctx, cn_init_callback *cb)
+{
+    for (uint64_t i = 0; i < KVSET_CNT; i++) {
+        struct kvset_meta km = { 0 };
+        merr_t err;
+
+        km.km_dgen_hi = i + 1;
+        km.km_dgen_lo = i + 1;
+
+        err = cb(ctx, &km, i + 1);
+        if (err)
+            return err;
+    }
+
+    return 0;
+}
+
+static merr_t
+kvset_open_mock(struct cn_tree *tree, uint64_t kvsetid, struct kvset_meta *km, struct kvset **ks)
+{
+    struct mock_kvset *mk;
+
+    if (kvsetid == kvset_failid)
+        return merr(EIO);
+
+    mk = calloc(1, sizeof(*mk));
+    if (!mk)
+        return merr(ENOMEM);
+
+    mk->entry.le_kvset = (void *)mk;
+    mk->iter_data = (void *)-1;
+    mk->ref = 1;
+    mk->dgen_hi = km->km_dgen_hi;
+    mk->dgen_lo = km->km_dgen_lo;
+    mk->nodeid = km->km_nodeid;
+    mk->kvsetid = kvsetid;
+    mk->stats.kst_keys = 1000;
+    mk->stats.kst_kvsets = 1;
+
+    atomic_inc(&kvsets_opened);
+    *ks = (void *)mk;
+
+    return 0;
+}
+
+static void
+kvset_put_ref_mock(struct kvset *ks)
+{
+    struct mock_kvset *mk = (void *)ks;
+
+    if (--mk->ref == 0) {
+        atomic_inc(&kvsets_released);
+        free(mk);
+    }
+}
+
+static void
+kvset_list_add_tail_mock(struct kvset *ks, struct list_head *head)
+{
+    struct mock_kvset *mk = (void *)ks;
+
+    if (kvset_insertc < KVSET_CNT)
+        kvset_insertv[kvset_insertc] = mk->kvsetid;
+    kvset_insertc++;
+
+    list_add_tail(&mk->entry.le_link, head);
+}
+
+static const struct kvset_stats *
+kvset_statsp_mock(const struct kvset *ks)
+{
+    return &((const struct mock_kvset *)ks)->stats;
+}
+
+static void
+kvset_preload_mock(struct kvset *ks)
+{
+    atomic_inc(&kvsets_preloaded);
+}
+
+static void
+kvset_mocks_set(uint64_t failid)
+{
+    mock_kvset_set();
+
+    MOCK_SET_FN(kvset, kvset_open, kvset_open_mock);
+    MOCK_SET_FN(kvset, kvset_put_ref, kvset_put_ref_mock);
+    MOCK_SET_FN(kvset, kvset_list_add_tail, kvset_list_add_tail_mock);
+    MOCK_SET_FN(kvset, kvset_statsp, kvset_statsp_mock);
+    MOCK_SET_FN(kvset, kvset_preload, kvset_preload_mock);
+
+    mapi_inject_unset(mapi_idx_cndb_cn_instantiate);
+    MOCK_SET_FN(cndb, cndb_cn_instantiate, cndb_cn_instantiate_mock);
+
+    /* A zeroed policy maps every age and data type to the capacity media class. */
+    mapi_inject_ptr(mapi_idx_ikvdb_get_mclass_policy, &kvset_mpolicy);
+
+    atomic_set(&kvsets_opened, 0);
+    atomic_set(&kvsets_released, 0);
+    atomic_set(&kvsets_preloaded, 0);
+    kvset_insertc = 0;
+    kvset_failid = failid;
+}
+
+static void
+kvset_mocks_unset(void)
+{
+    MOCK_UNSET_FN(cndb, cndb_cn_instantiate);
+    MOCK_UNSET_FN(kvset, kvset_preload);
+    MOCK_UNSET_FN(kvset, kvset_statsp);
+
+    mock_kvset_unset();
+}
+
+MTF_DEFINE_UTEST_PREPOST(cn_open_test, cn_open_kvsets, pre, post)
+{
+    struct kvset_list_entry *le;
+    struct cn_tree *tree;
+    uint64_t failidv[] = { 1, KVSET_CNT / 2, KVSET_CNT };
+    merr_t err;
+    struct cn *cn;
+    uint i;
+
+    rp->cn_bloom_preload = true;
+    rp->cn_close_wait = true;
+
+    /* A kvset that fails to open, whether first, last or in the middle,
+     * fails cn_open() without inserting any kvset, and every kvset that
+     * was opened is released.
+     */
+    for (i = 0; i < NELEM(failidv); i++) {
+        kvset_mocks_set(failidv[i]);
+
+        err = cn_open(CN_OPEN_ARGS, &cn);
+        ASSERT_EQ(EIO, merr_errno(err));
+
+        ASSERT_EQ(KVSET_CNT - 1, atomic_read(&kvsets_opened));
+        ASSERT_EQ(KVSET_CNT - 1, atomic_read(&kvsets_released));
+        ASSERT_EQ(0, kvset_insertc);
+        ASSERT_EQ(0, atomic_read(&kvsets_preloaded));
+
+        kvset_mocks_unset();
+    }
+
+    /* On success the kvsets are inserted in cndb order despite being
+     * opened concurrently, each is preloaded once, and the preload refs
+     * and tree refs are all dropped by cn_close().
+     */
+    kvset_mocks_set(0);
+
+    err = cn_open(CN_OPEN_ARGS, &cn);
+    ASSERT_EQ(0, err);
+
+    ASSERT_EQ(KVSET_CNT, atomic_read(&kvsets_opened));
+    ASSERT_EQ(KVSET_CNT, kvset_insertc);
+    for (i = 0; i < KVSET_CNT; i++)
+        ASSERT_EQ(i + 1, kvset_insertv[i]);
+
+    /* The root node lists its kvsets youngest first. */
+    tree = cn_get_tree(cn);
+    i = KVSET_CNT;
+    list_for_each_entry(le, &tree->ct_root->tn_kvset_list, le_link)
+        ASSERT_EQ(i--, kvset_get_id(le->le_kvset));
+    ASSERT_EQ(0, i);
+
+    cn_close(cn);
+
+    ASSERT_EQ(KVSET_CNT, atomic_read(&kvsets_preloaded));
+    ASSERT_EQ(KVSET_CNT, atomic_read(&kvsets_released));
+
+    kvset_mocks_unset();
+}
+
 MTF_END_UTEST_COLLECTION(cn_open_test)
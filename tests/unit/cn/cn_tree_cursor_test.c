@@ -22,6 +22,7 @@ struct cn_kv_item;
 
 struct cn_tree tree;
 struct kv_iterator dummy_kviter;
+int g_kvset_refs_calls;
 
 void *
 _cn_get_tree(const struct cn *cn)
@@ -32,6 +33,7 @@ _cn_get_tree(const struct cn *cn)
 merr_t
 cn_tree_kvset_refs(struct cn_tree_node *node, struct cn_level_cursor *lcur)
 {
+    ++g_kvset_refs_calls;
     return 0;
 }
 
@@ -202,6 +204,60 @@ cn_lcur_seek(struct cn_level_cursor *lcur, const void *key, uint32_t len)
     return 0;
 }
 
+/* Real implementations, weak in the library under test. */
+struct kv_iterator *
+cn_lcur_stash_take(struct cn_level_cursor *lcur, struct kvset *kvset, uint *hint);
+void
+cn_lcur_stash_release(struct cn_level_cursor *lcur);
+void
+cn_lcur_kvset_stash(struct cn_level_cursor *lcur);
+
+/* Stand-in kvsets identified by dgen, whose refs and iterators are tracked
+ * so the stash tests can tell which ones were kept and which released.
+ */
+struct fake_kvset {
+    uint64_t dgen;
+    int refs;
+    struct kv_iterator iter;
+    bool iter_released;
+};
+
+static uint64_t
+_kvset_get_dgen(const struct kvset *kvset)
+{
+    return ((const struct fake_kvset *)kvset)->dgen;
+}
+
+static void
+_kvset_put_ref(struct kvset *kvset)
+{
+    ((struct fake_kvset *)kvset)->refs--;
+}
+
+static void
+_kvset_iter_release(struct kv_iterator *handle)
+{
+    container_of(handle, struct fake_kvset, iter)->iter_released = true;
+}
+
+/* Fill a level cursor's kvref table as cn_tree_kvset_refs() would, each
+ * entry holding a ref, and return the table's length.
+ */
+static uint
+lcur_kvsets_set(struct cn_level_cursor *lcur, struct fake_kvset **kvsetv, uint kvsetc)
+{
+    table_reset(lcur->cnlc_kvref_tab);
+
+    for (uint i = 0; i < kvsetc; i++) {
+        struct kvref *k = table_append(lcur->cnlc_kvref_tab);
+
+        k->kvset = (struct kvset *)kvsetv[i];
+        kvsetv[i]->refs++;
+    }
+
+    return table_len(lcur->cnlc_kvref_tab);
+}
+
 int
 pre_test(struct mtf_test_info *lcl_ti)
 {
@@ -221,6 +277,7 @@ pre_test(struct mtf_test_info *lcl_ti)
     mapi_inject(mapi_idx_kvset_iter_seek, 0);
     mapi_inject(mapi_idx_kvset_iter_es_get, 0);
     mapi_inject(mapi_idx_kvset_iter_kvset_get, 0);
+    mapi_inject(mapi_idx_kvset_get_rtombs, 0);
 
     MOCK_SET(kvset, _kvset_iter_next_vref);
     MOCK_SET(kvset, _kvset_iter_val_get);
@@ -498,4 +555,161 @@ MTF_DEFINE_UTEST_PREPOST(cn_tree_cursor_test, with_ptomb, pre_test, post_test)
     route_map_destroy(tree.ct_route_map);
 }
 
+MTF_DEFINE_UTEST_PREPOST(cn_tree_cursor_test, pfx_node_prune, pre_test, post_test)
+{
+    merr_t err;
+    const char *pfxstr = "m";
+    struct cn_cursor cur = {
+        .cncur_seqno = 10,
+        .cncur_tree_pfxlen = 1,
+        .cncur_pfx = pfxstr,
+        .cncur_pfxlen = strlen(pfxstr),
+    };
+    struct cn_cursor rcur = {
+        .cncur_seqno = 10,
+        .cncur_tree_pfxlen = 1,
+        .cncur_pfx = pfxstr,
+        .cncur_pfxlen = strlen(pfxstr),
+        .cncur_reverse = 1,
+    };
+    struct cn_tree_node tn[4];
+    struct route_node *rnode[4];
+    const char *ekeys[] = { "b", "m", "n", "z" };
+    const char *seek;
+    uint i;
+
+    tree.ct_route_map = route_map_create(CN_FANOUT_MAX);
+    ASSERT_NE(NULL, tree.ct_route_map);
+
+    for (i = 0; i < NELEM(rnode); i++) {
+        rnode[i] = route_map_insert(tree.ct_route_map, &tn[i], ekeys[i], strlen(ekeys[i]));
+        ASSERT_NE(NULL, rnode[i]);
+    }
+
+    kv_start();
+    kv_end();
+
+    /* Forward: the node with edge key "n" may still hold keys such as "ma",
+     * but the node with edge key "z" cannot and must not be visited.
+     */
+    err = cn_tree_cursor_create(&cur);
+    ASSERT_EQ(0, err);
+
+    g_kvset_refs_calls = 0;
+    seek = "m";
+    err = cn_tree_cursor_seek(&cur, seek, strlen(seek), NULL);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(2, g_kvset_refs_calls);
+    ASSERT_TRUE(cur.cncur_lcur[1].cnlc_islast);
+
+    cn_tree_cursor_destroy(&cur);
+
+    /* Reverse: the seek lands in the node with edge key "n", then moves to the
+     * node with edge key "m", but the node with edge key "b" cannot hold the
+     * prefix and must not be visited.
+     */
+    err = cn_tree_cursor_create(&rcur);
+    ASSERT_EQ(0, err);
+
+    g_kvset_refs_calls = 0;
+    seek = "m\xff";
+    err = cn_tree_cursor_seek(&rcur, seek, strlen(seek), NULL);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(2, g_kvset_refs_calls);
+    ASSERT_TRUE(rcur.cncur_lcur[1].cnlc_islast);
+
+    cn_tree_cursor_destroy(&rcur);
+
+    for (i = 0; i < NELEM(rnode); i++)
+        route_map_delete(tree.ct_route_map, rnode[i]);
+    route_map_destroy(tree.ct_route_map);
+}
+
+MTF_DEFINE_UTEST_PREPOST(cn_tree_cursor_test, stash_reuse, pre_test, post_test)
+{
+    struct fake_kvset ks[6] = {
+        { .dgen = 9 }, { .dgen = 8 }, { .dgen = 7 }, { .dgen = 7 }, { .dgen = 6 }, { .dgen = 5 },
+    };
+    struct fake_kvset *before[] = { &ks[1], &ks[2], &ks[3], &ks[4], &ks[5] };
+    struct fake_kvset *after[] = { &ks[0], &ks[1], &ks[3], &ks[5] };
+    struct kv_iterator *itv[NELEM(after)];
+    struct cn_level_cursor lcur = {};
+    uint hint = 0, n;
+
+    mapi_inject_unset(mapi_idx_kvset_get_dgen);
+    mapi_inject_unset(mapi_idx_kvset_put_ref);
+    mapi_inject_unset(mapi_idx_kvset_iter_release);
+    MOCK_SET(kvset_view, _kvset_get_dgen);
+    MOCK_SET(kvset, _kvset_put_ref);
+    MOCK_SET(kvset, _kvset_iter_release);
+
+    lcur.cnlc_kvref_tab = table_create(8, sizeof(struct kvref), false);
+    lcur.cnlc_stash_tab = table_create(8, sizeof(struct kvref), false);
+    ASSERT_NE(NULL, lcur.cnlc_kvref_tab);
+    ASSERT_NE(NULL, lcur.cnlc_stash_tab);
+
+    lcur.cnlc_esrcc = 8;
+    lcur.cnlc_esrcv = calloc(lcur.cnlc_esrcc, sizeof(*lcur.cnlc_esrcv));
+    ASSERT_NE(NULL, lcur.cnlc_esrcv);
+
+    /* A level cursor with an iterator per kvset, newest first.
+     */
+    n = lcur_kvsets_set(&lcur, before, NELEM(before));
+    for (uint i = 0; i < n; i++)
+        lcur.cnlc_esrcv[i] = &before[i]->iter.kvi_es;
+    lcur.cnlc_iterc = n;
+
+    /* An update sets the iterators and refs aside.
+     */
+    cn_lcur_kvset_stash(&lcur);
+    ASSERT_EQ(0, lcur.cnlc_iterc);
+    ASSERT_EQ(n, lcur.cnlc_stash_iterc);
+    for (uint i = 0; i < NELEM(ks); i++) {
+        ASSERT_FALSE(ks[i].iter_released);
+        ASSERT_EQ(i == 0 ? 0 : 1, ks[i].refs);
+    }
+
+    /* Meanwhile, ks[0] was ingested, and ks[2] and ks[4] were compacted
+     * into ks[5]'s node.  ks[2] and ks[3] share a dgen, so only the kvset
+     * pointer tells them apart.
+     */
+    n = lcur_kvsets_set(&lcur, after, NELEM(after));
+    for (uint i = 0; i < n; i++)
+        itv[i] = cn_lcur_stash_take(&lcur, (struct kvset *)after[i], &hint);
+
+    ASSERT_EQ(NULL, itv[0]);
+    ASSERT_EQ(&ks[1].iter, itv[1]);
+    ASSERT_EQ(&ks[3].iter, itv[2]);
+    ASSERT_EQ(&ks[5].iter, itv[3]);
+
+    /* The stash's refs on the reused kvsets have been dropped, leaving the
+     * new kvref table's.
+     */
+    ASSERT_EQ(1, ks[1].refs);
+    ASSERT_EQ(1, ks[3].refs);
+    ASSERT_EQ(1, ks[5].refs);
+
+    /* Only the removed kvsets' iterators and refs are released.
+     */
+    cn_lcur_stash_release(&lcur);
+    ASSERT_EQ(0, lcur.cnlc_stash_iterc);
+    ASSERT_EQ(0, table_len(lcur.cnlc_stash_tab));
+
+    for (uint i = 0; i < NELEM(ks); i++) {
+        bool removed = (i == 2 || i == 4);
+
+        ASSERT_EQ(removed, ks[i].iter_released);
+        ASSERT_EQ(removed ? 0 : 1, ks[i].refs);
+    }
+
+    MOCK_UNSET(kvset, _kvset_iter_release);
+    MOCK_UNSET(kvset, _kvset_put_ref);
+    MOCK_UNSET(kvset_view, _kvset_get_dgen);
+
+    table_destroy(lcur.cnlc_kvref_tab);
+    table_destroy(lcur.cnlc_stash_tab);
+    free(lcur.cnlc_stash_esrcv);
+    free(lcur.cnlc_esrcv);
+}
+
 MTF_END_UTEST_COLLECTION(cn_tree_cursor_test)
@@ -344,6 +344,9 @@ struct mapi_injection inject_list[] = {
      * need the guts of an iterator b/c we mock
      * the actual compact/spill functions. */
     { mapi_idx_kvset_iter_set_stats, MAPI_RC_SCALAR, 0 },
+    { mapi_idx_kvset_iter_set_tbkt, MAPI_RC_SCALAR, 0 },
+    { mapi_idx_kvset_iter_skip_covered, MAPI_RC_SCALAR, 0 },
+    { mapi_idx_kvset_get_rtombs, MAPI_RC_SCALAR, 0 },
     { mapi_idx_kvset_iter_seek, MAPI_RC_SCALAR, -1 },
     { mapi_idx_kvset_iter_next_key, MAPI_RC_SCALAR, -1 },
     { mapi_idx_kvset_iter_val_get, MAPI_RC_SCALAR, -1 },
@@ -353,6 +356,7 @@ struct mapi_injection inject_list[] = {
     /* kvset_builder */
     { mapi_idx_kvset_builder_create, MAPI_RC_SCALAR, 0 },
     { mapi_idx_kvset_builder_set_merge_stats, MAPI_RC_SCALAR, 0 },
+    { mapi_idx_kvset_builder_set_tbkt, MAPI_RC_SCALAR, 0 },
     { mapi_idx_kvset_builder_set_agegroup, MAPI_RC_SCALAR, 0 },
     { mapi_idx_kvset_builder_get_mblocks, MAPI_RC_SCALAR, 0 },
 
@@ -13,6 +13,7 @@
 #include <hse/ikvdb/kvdb_health.h>
 #include <hse/ikvdb/kvdb_rparams.h>
 #include <hse/ikvdb/kvs_rparams.h>
+#include <hse/util/token_bucket.h>
 
 #include <hse/test/mock/alloc_tester.h>
 #include <hse/test/mock/api.h>
@@ -640,4 +641,229 @@ MTF_DEFINE_UTEST_PRE(test, t_sp3_one_big_tree_with_work, pre_test)
     sp3_destroy(cs);
 }
 
+/* Per-kvset heat and staged bytes, indexed by kvset id. */
+static uint64_t heatv[5];
+static size_t stagedv[5];
+
+static uint64_t
+_kvset_get_heat(const struct kvset *ks)
+{
+    return heatv[kvset_get_id(ks)];
+}
+
+static size_t
+_kvset_get_staging_alen(const struct kvset *ks)
+{
+    return stagedv[kvset_get_id(ks)];
+}
+
+static const struct kvset_stats *
+_kvset_statsp(const struct kvset *ks)
+{
+    return &((const struct mock_kvset *)ks)->stats;
+}
+
+MTF_DEFINE_UTEST_PRE(test, t_sp3_heat_candidate, pre_test)
+{
+    struct cn_tree tree = { 0 };
+    struct cn_tree_node tn = { 0 };
+    struct sp3_thresholds thresh = { 0 };
+    struct kvset *ksv[NELEM(heatv)];
+    struct kvset_list_entry *le;
+    const struct kvset_stats *stats;
+    enum cn_rule rule;
+    size_t alen;
+    merr_t err;
+
+    INIT_LIST_HEAD(&tn.tn_kvset_list);
+    tn.tn_nodeid = 1;
+
+    for (int i = 1; i < NELEM(ksv); i++) {
+        err = kvset_open(&tree, i, init_kvset_meta(ttv->dgen--), &ksv[i]);
+        ASSERT_EQ(0, err);
+        kvset_list_add_tail(ksv[i], &tn.tn_kvset_list);
+    }
+
+    MOCK_SET(kvset, _kvset_statsp);
+    MOCK_SET(kvset, _kvset_get_heat);
+    MOCK_SET(kvset, _kvset_get_staging_alen);
+
+    stats = kvset_statsp(ksv[1]);
+    alen = stats->kst_halen + stats->kst_kalen + stats->kst_valen;
+
+    memset(stagedv, 0, sizeof(stagedv));
+    heatv[1] = 80;
+    heatv[2] = 500;
+    heatv[3] = 50;
+    heatv[4] = 900;
+
+    thresh.heat_hot = 200;
+    thresh.heat_cold = 100;
+
+    /* A zero budget disables migration. */
+    le = sp3_work_heat_candidate(&tn, &thresh, &rule);
+    ASSERT_EQ(NULL, le);
+
+    thresh.heat_staging_max = 4 * alen;
+
+    /* The root node never migrates. */
+    tn.tn_nodeid = 0;
+    le = sp3_work_heat_candidate(&tn, &thresh, &rule);
+    ASSERT_EQ(NULL, le);
+    tn.tn_nodeid = 1;
+
+    /* The hottest kvset that isn't busy is promoted. */
+    le = sp3_work_heat_candidate(&tn, &thresh, &rule);
+    ASSERT_NE(NULL, le);
+    ASSERT_EQ(ksv[4], le->le_kvset);
+    ASSERT_EQ(CN_RULE_HOT, rule);
+
+    kvset_set_work(ksv[4], &thresh);
+    le = sp3_work_heat_candidate(&tn, &thresh, &rule);
+    ASSERT_NE(NULL, le);
+    ASSERT_EQ(ksv[2], le->le_kvset);
+    kvset_set_work(ksv[4], NULL);
+
+    /* Only what isn't already staged counts against the budget. */
+    thresh.heat_staging_used = thresh.heat_staging_max - alen / 2;
+    le = sp3_work_heat_candidate(&tn, &thresh, &rule);
+    ASSERT_EQ(NULL, le);
+
+    stagedv[4] = alen / 2;
+    le = sp3_work_heat_candidate(&tn, &thresh, &rule);
+    ASSERT_NE(NULL, le);
+    ASSERT_EQ(ksv[4], le->le_kvset);
+
+    /* Fully staged kvsets and kvsets below the hot threshold stay put. */
+    stagedv[4] = alen;
+    stagedv[2] = alen;
+    thresh.heat_staging_used = 2 * alen;
+    le = sp3_work_heat_candidate(&tn, &thresh, &rule);
+    ASSERT_EQ(NULL, le);
+
+    /* Over budget, the coldest staged kvset below the cold threshold is
+     * evicted, hot staged kvsets and unstaged cold kvsets are not.
+     */
+    thresh.heat_staging_max = alen;
+    le = sp3_work_heat_candidate(&tn, &thresh, &rule);
+    ASSERT_EQ(NULL, le);
+
+    stagedv[3] = alen;
+    stagedv[1] = alen;
+    le = sp3_work_heat_candidate(&tn, &thresh, &rule);
+    ASSERT_NE(NULL, le);
+    ASSERT_EQ(ksv[3], le->le_kvset);
+    ASSERT_EQ(CN_RULE_COLD, rule);
+
+    kvset_set_work(ksv[3], &thresh);
+    le = sp3_work_heat_candidate(&tn, &thresh, &rule);
+    ASSERT_NE(NULL, le);
+    ASSERT_EQ(ksv[1], le->le_kvset);
+    ASSERT_EQ(CN_RULE_COLD, rule);
+    kvset_set_work(ksv[3], NULL);
+
+    MOCK_UNSET(kvset, _kvset_get_staging_alen);
+    MOCK_UNSET(kvset, _kvset_get_heat);
+    MOCK_UNSET(kvset, _kvset_statsp);
+
+    for (int i = 1; i < NELEM(ksv); i++)
+        kvset_put_ref(ksv[i]);
+}
+
+/* Log of the token bucket resets made by the sp3 monitor. */
+static struct {
+    struct tbkt *tb;
+    uint64_t burst;
+    uint64_t rate;
+} reinitv[16];
+static atomic_uint reinitc;
+
+static void
+tbkt_reinit_mock(struct tbkt *tb, uint64_t burst, uint64_t rate)
+{
+    uint i = atomic_read(&reinitc);
+
+    if (i < NELEM(reinitv)) {
+        reinitv[i].tb = tb;
+        reinitv[i].burst = burst;
+        reinitv[i].rate = rate;
+    }
+
+    tb->tb_burst = burst;
+    tb->tb_rate = rate;
+    atomic_inc_rel(&reinitc);
+}
+
+static bool
+reinit_wait(uint cnt)
+{
+    for (int i = 0; i < 100; i++) {
+        if (atomic_read_acq(&reinitc) >= cnt)
+            return true;
+        usleep(50 * 1000);
+    }
+
+    return false;
+}
+
+MTF_DEFINE_UTEST_PRE(test, t_sp3_iobudget_toggle, pre_test)
+{
+    const uint64_t rd = 10ul << 20, wr = 20ul << 20;
+    struct test_tree *tt;
+    struct csched *cs;
+    merr_t err;
+
+    atomic_set(&reinitc, 0);
+    MOCK_SET_FN(token_bucket, tbkt_reinit, tbkt_reinit_mock);
+
+    kvdb_rp->csched_io_rd_mbps = rd >> 20;
+    kvdb_rp->csched_io_wr_mbps = wr >> 20;
+
+    err = sp3_create(kvdb_rp, mp, &health, &cs);
+    ASSERT_EQ(err, 0);
+
+    tt = new_tree(4);
+    ASSERT_NE(tt, NULL);
+
+    add_tree(tt->tree, cs);
+
+    /* Compaction is unrestricted while the foreground is idle, which is
+     * how the buckets start out, so there is nothing to reset.
+     */
+    usleep(DELAY_MS * 4 * 1000);
+    ASSERT_EQ(0, atomic_read(&reinitc));
+
+    /* A foreground read restricts both buckets, each starting out full.
+     */
+    atomic_set(&tt->tree->ct_fg_reads, 1);
+    ASSERT_TRUE(reinit_wait(2));
+    ASSERT_NE(reinitv[0].tb, reinitv[1].tb);
+    ASSERT_EQ(rd / 4, reinitv[0].burst);
+    ASSERT_EQ(rd, reinitv[0].rate);
+    ASSERT_EQ(wr / 4, reinitv[1].burst);
+    ASSERT_EQ(wr, reinitv[1].rate);
+
+    /* With no further reads, both are reset to unrestricted.
+     */
+    ASSERT_TRUE(reinit_wait(4));
+    ASSERT_EQ(reinitv[0].tb, reinitv[2].tb);
+    ASSERT_EQ(0, reinitv[2].rate);
+    ASSERT_EQ(reinitv[1].tb, reinitv[3].tb);
+    ASSERT_EQ(0, reinitv[3].rate);
+
+    /* And restricted again, afresh, when reads resume.
+     */
+    atomic_set(&tt->tree->ct_fg_reads, 1);
+    ASSERT_TRUE(reinit_wait(6));
+    ASSERT_EQ(rd / 4, reinitv[4].burst);
+    ASSERT_EQ(rd, reinitv[4].rate);
+    ASSERT_EQ(wr, reinitv[5].rate);
+
+    remove_tree(tt->tree, cs);
+    destroy_trees();
+    sp3_destroy(cs);
+
+    MOCK_UNSET(token_bucket, _tbkt_reinit);
+}
+
 MTF_END_UTEST_COLLECTION(test);
@@ -0,0 +1,217 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <hse/util/page.h>
+
+#include <hse/test/mtf/conditions.h>
+#include <hse/test/mtf/framework.h>
+
+#include "cn/hpcache.h"
+
+MTF_BEGIN_UTEST_COLLECTION(hpcache_test)
+
+MTF_DEFINE_UTEST(hpcache_test, disabled)
+{
+    struct hpcache *hpc = (void *)-1;
+    merr_t err;
+
+    err = hpcache_create(HPCACHE_RGN_SZ - 1, &hpc);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(NULL, hpc);
+
+    hpcache_destroy(hpc);
+}
+
+MTF_DEFINE_UTEST(hpcache_test, budget)
+{
+    struct hpcache_region *rgnv[3];
+    struct hpcache *hpc;
+    void *mem[3];
+    merr_t err;
+
+    err = hpcache_create(2 * HPCACHE_RGN_SZ, &hpc);
+    ASSERT_EQ(0, err);
+    ASSERT_NE(NULL, hpc);
+
+    mem[0] = hpcache_alloc(hpc, HPCACHE_RGN_SZ + 1, &rgnv[0]);
+    ASSERT_EQ(NULL, mem[0]);
+
+    /* Allocations are rounded up to a page and carved from the same region.
+     */
+    mem[0] = hpcache_alloc(hpc, 1, &rgnv[0]);
+    ASSERT_NE(NULL, mem[0]);
+    ASSERT_EQ(0, (uintptr_t)mem[0] % PAGE_SIZE);
+
+    mem[1] = hpcache_alloc(hpc, PAGE_SIZE, &rgnv[1]);
+    ASSERT_EQ(mem[0] + PAGE_SIZE, mem[1]);
+    ASSERT_EQ(rgnv[0], rgnv[1]);
+
+    /* Doesn't fit in the first region, so a second region is created.
+     */
+    mem[2] = hpcache_alloc(hpc, HPCACHE_RGN_SZ, &rgnv[2]);
+    ASSERT_NE(NULL, mem[2]);
+    ASSERT_NE(rgnv[0], rgnv[2]);
+    memset(mem[2], 0xa5, HPCACHE_RGN_SZ);
+
+    /* Budget exhausted, and the first region is short one page.
+     */
+    ASSERT_EQ(NULL, hpcache_alloc(hpc, HPCACHE_RGN_SZ - PAGE_SIZE, &rgnv[1]));
+
+    /* A freed page is reused while the rest of its region is still live.
+     */
+    hpcache_free(hpc, rgnv[1], mem[1]);
+
+    mem[1] = hpcache_alloc(hpc, PAGE_SIZE, &rgnv[1]);
+    ASSERT_EQ(mem[0] + PAGE_SIZE, mem[1]);
+    ASSERT_EQ(rgnv[0], rgnv[1]);
+
+    /* Releasing an emptied region makes room for a new one.
+     */
+    hpcache_free(hpc, rgnv[2], mem[2]);
+
+    mem[2] = hpcache_alloc(hpc, HPCACHE_RGN_SZ, &rgnv[2]);
+    ASSERT_NE(NULL, mem[2]);
+    ASSERT_NE(rgnv[0], rgnv[2]);
+
+    hpcache_free(hpc, rgnv[0], mem[0]);
+    hpcache_free(hpc, rgnv[1], mem[1]);
+    hpcache_free(hpc, rgnv[2], mem[2]);
+    hpcache_destroy(hpc);
+}
+
+MTF_DEFINE_UTEST(hpcache_test, churn)
+{
+    const size_t allocmax = HPCACHE_RGN_SZ / PAGE_SIZE;
+    struct hpcache_region **rgnv, *pin;
+    struct hpcache *hpc;
+    void **memv, *mem;
+    merr_t err;
+    size_t n;
+
+    memv = calloc(allocmax, sizeof(*memv));
+    rgnv = calloc(allocmax, sizeof(*rgnv));
+    ASSERT_NE(NULL, memv);
+    ASSERT_NE(NULL, rgnv);
+
+    err = hpcache_create(HPCACHE_RGN_SZ, &hpc);
+    ASSERT_EQ(0, err);
+    ASSERT_NE(NULL, hpc);
+
+    /* With a budget of one region, freeing every allocation must make the
+     * whole region available again, round after round.
+     */
+    for (int round = 0; round < 100; round++) {
+        for (n = 0; n < allocmax; n++) {
+            memv[n] = hpcache_alloc(hpc, PAGE_SIZE, &rgnv[n]);
+            ASSERT_NE(NULL, memv[n]);
+            ASSERT_EQ(rgnv[0], rgnv[n]);
+        }
+
+        ASSERT_EQ(NULL, hpcache_alloc(hpc, PAGE_SIZE, &pin));
+
+        /* Free in a different order each round. */
+        for (size_t i = 0; i < allocmax; i++) {
+            n = (i * 7 + round) % allocmax;
+            hpcache_free(hpc, rgnv[n], memv[n]);
+        }
+    }
+
+    /* A live allocation doesn't pin the space freed behind it.
+     */
+    memv[0] = hpcache_alloc(hpc, HPCACHE_RGN_SZ / 2, &pin);
+    ASSERT_NE(NULL, memv[0]);
+
+    memv[1] = hpcache_alloc(hpc, HPCACHE_RGN_SZ / 2, &rgnv[1]);
+    ASSERT_NE(NULL, memv[1]);
+    hpcache_free(hpc, rgnv[1], memv[1]);
+
+    mem = hpcache_alloc(hpc, HPCACHE_RGN_SZ / 2, &rgnv[1]);
+    ASSERT_EQ(memv[1], mem);
+    ASSERT_EQ(NULL, hpcache_alloc(hpc, PAGE_SIZE, &rgnv[2]));
+
+    hpcache_free(hpc, rgnv[1], memv[1]);
+    hpcache_free(hpc, pin, memv[0]);
+
+    memv[0] = hpcache_alloc(hpc, HPCACHE_RGN_SZ, &rgnv[0]);
+    ASSERT_NE(NULL, memv[0]);
+    memset(memv[0], 0x5a, HPCACHE_RGN_SZ);
+    hpcache_free(hpc, rgnv[0], memv[0]);
+
+    hpcache_destroy(hpc);
+    free(rgnv);
+    free(memv);
+}
+
+MTF_DEFINE_UTEST(hpcache_test, fragmentation)
+{
+    const size_t allocmax = HPCACHE_RGN_SZ / PAGE_SIZE;
+    struct hpcache_region **rgnv, *rgn;
+    struct hpcache *hpc;
+    void **memv, *mem;
+    merr_t err;
+
+    memv = calloc(allocmax, sizeof(*memv));
+    rgnv = calloc(allocmax, sizeof(*rgnv));
+    ASSERT_NE(NULL, memv);
+    ASSERT_NE(NULL, rgnv);
+
+    err = hpcache_create(HPCACHE_RGN_SZ, &hpc);
+    ASSERT_EQ(0, err);
+    ASSERT_NE(NULL, hpc);
+
+    for (size_t n = 0; n < allocmax; n++) {
+        memv[n] = hpcache_alloc(hpc, PAGE_SIZE, &rgnv[n]);
+        ASSERT_NE(NULL, memv[n]);
+    }
+
+    /* Free every other page: half the region is free, but no two free
+     * pages are adjacent.
+     */
+    for (size_t n = 1; n < allocmax; n += 2)
+        hpcache_free(hpc, rgnv[n], memv[n]);
+
+    ASSERT_EQ(NULL, hpcache_alloc(hpc, 2 * PAGE_SIZE, &rgn));
+
+    /* Single pages are placed first-fit in the holes.
+     */
+    mem = hpcache_alloc(hpc, PAGE_SIZE, &rgn);
+    ASSERT_EQ(memv[1], mem);
+    hpcache_free(hpc, rgn, mem);
+
+    /* Freeing a live neighbour coalesces a run of three pages.
+     */
+    hpcache_free(hpc, rgnv[4], memv[4]);
+
+    mem = hpcache_alloc(hpc, 3 * PAGE_SIZE, &rgn);
+    ASSERT_EQ(memv[3], mem);
+    ASSERT_EQ(NULL, hpcache_alloc(hpc, 2 * PAGE_SIZE, &rgnv[4]));
+
+    /* Freeing a multi-page allocation releases all of its pages.
+     */
+    hpcache_free(hpc, rgn, mem);
+
+    mem = hpcache_alloc(hpc, 3 * PAGE_SIZE, &rgn);
+    ASSERT_EQ(memv[3], mem);
+    hpcache_free(hpc, rgn, mem);
+
+    for (size_t n = 0; n < allocmax; n += 2) {
+        if (n != 4)
+            hpcache_free(hpc, rgnv[n], memv[n]);
+    }
+
+    mem = hpcache_alloc(hpc, HPCACHE_RGN_SZ, &rgn);
+    ASSERT_NE(NULL, mem);
+    hpcache_free(hpc, rgn, mem);
+
+    hpcache_destroy(hpc);
+    free(rgnv);
+    free(memv);
+}
+
+MTF_END_UTEST_COLLECTION(hpcache_test);
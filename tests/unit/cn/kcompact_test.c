@@ -7,6 +7,7 @@
 
 #include <hse/ikvdb/kvs_rparams.h>
 #include <hse/ikvdb/kvset_builder.h>
+#include <hse/ikvdb/limits.h>
 #include <hse/ikvdb/tuple.h>
 #include <hse/util/platform.h>
 #include <hse/util/slab.h>
@@ -16,6 +17,7 @@
 #include <hse/test/mock/mock_kvset_builder.h>
 #include <hse/test/mtf/framework.h>
 
+#include "cn/blk_list.h"
 #include "cn/cn_metrics.h"
 #include "cn/cn_tree_compact.h"
 #include "cn/kcompact.h"
@@ -238,7 +240,7 @@ MTF_DEFINE_UTEST_PRE(kcompact_test, keep, pre)
     for (i = 0; i < NITER; ++i)
         ASSERT_EQ(0, mock_make_vblocks(&itv[i], &rp, i));
 
-    err = kvset_keep_vblocks(&vbmap, &vgmap, itv, NITER);
+    err = kvset_keep_vblocks(&vbmap, &vgmap, itv, NITER, NULL);
     ASSERT_EQ(err, 0);
 
     /* verify each map is cumulative of what came before */
@@ -258,6 +260,50 @@ MTF_DEFINE_UTEST_PRE(kcompact_test, keep, pre)
 #undef NITER
 }
 
+MTF_DEFINE_UTEST_PRE(kcompact_test, keep_reloc, pre)
+{
+#define NITER 8
+    struct kvs_rparams rp = kvs_rparams_defaults();
+    struct kvset_vblk_map vbmap = { 0 };
+    struct vgmap *vgmap;
+    bool relocv[NITER];
+    int i, j;
+    merr_t err;
+
+    memset(itv, 0, sizeof(itv));
+
+    /* 1..NITER vblocks, relocate the values of every other iterator */
+    for (i = 0; i < NITER; ++i) {
+        ASSERT_EQ(0, mock_make_vblocks(&itv[i], &rp, i + 1));
+        relocv[i] = i & 1;
+    }
+
+    err = kvset_keep_vblocks(&vbmap, &vgmap, itv, NITER, relocv);
+    ASSERT_EQ(err, 0);
+
+    /* only the vblocks of the kept iterators are mapped */
+    for (j = i = 0; i < NITER; ++i) {
+        ASSERT_EQ(vbmap.vbm_map[i], j);
+        if (!relocv[i])
+            j += i + 1;
+    }
+
+    ASSERT_EQ(j, vbmap.vbm_blkc);
+    ASSERT_NE(NULL, vgmap);
+    ASSERT_EQ(NITER / 2, vgmap->nvgroups);
+    ASSERT_EQ(j - 1, vgmap->vbidx_out[vgmap->nvgroups - 1]);
+
+    free(vbmap.vbm_blkv);
+    vgmap_free(vgmap);
+    for (i = 0; i < NITER; ++i) {
+        struct mock_kv_iterator *iter = container_of(itv[i], typeof(*iter), kvi);
+
+        kvset_put_ref((struct kvset *)iter->kvset);
+        kvset_iter_release(itv[i]);
+    }
+#undef NITER
+}
+
 MTF_DEFINE_UTEST_PRE(kcompact_test, four_into_one, pre)
 {
 #define NITER 4
@@ -291,7 +337,7 @@ MTF_DEFINE_UTEST_PRE(kcompact_test, four_into_one, pre)
         ASSERT_EQ(0, mock_make_kvi(&itv[i], i, &rp, &nkv));
     }
 
-    err = kvset_keep_vblocks(&vbmap, &vgmap, itv, NITER);
+    err = kvset_keep_vblocks(&vbmap, &vgmap, itv, NITER, NULL);
     ASSERT_EQ(0, err);
 
     st.kwant = 1;
@@ -327,6 +373,191 @@ MTF_DEFINE_UTEST_PRE(kcompact_test, four_into_one, pre)
 #undef NITER
 }
 
+/* Keys of each input kvset in the vreloc test, which are disjoint so that
+ * every input contributes values to the output.
+ */
+#define VRELOC_NKEYS 10
+
+static const bool *vreloc_relocv;
+static const uint *vreloc_vbmap;
+static uint vreloc_vrefc, vreloc_valc;
+
+static int
+vreloc_src(void)
+{
+    return (st.kwant - 1) / VRELOC_NKEYS;
+}
+
+static merr_t
+vreloc_add_vref(
+    struct kvset_builder *self,
+    uint64_t seq,
+    uint vbidx,
+    uint vboff,
+    uint vlen,
+    uint complen)
+{
+    const int src = vreloc_src();
+
+    /* The mock iterators report their source index as the vblock index,
+     * which must be mapped past the vblocks kept from newer inputs.
+     */
+    VERIFY_FALSE_RET(vreloc_relocv[src], __LINE__);
+    VERIFY_EQ_RET(src + vreloc_vbmap[src], vbidx, __LINE__);
+
+    st.have.nvals++;
+    st.have.vtype = VTYPE_UCVAL;
+    st.have.vlen = vlen;
+    st.have.value = *(char *)mock_vref_to_vdata(itv[src], vboff);
+    VERIFY_EQ_RET(st.kwant - 1, st.have.value, __LINE__);
+    vreloc_vrefc++;
+
+    return 0;
+}
+
+static merr_t
+vreloc_add_val(
+    struct kvset_builder *self,
+    const struct key_obj *kobj,
+    const void *vdata,
+    uint vlen,
+    uint64_t seq,
+    uint complen)
+{
+    VERIFY_TRUE_RET(vreloc_relocv[vreloc_src()], __LINE__);
+
+    st.have.nvals++;
+    st.have.vtype = VTYPE_UCVAL;
+    st.have.vlen = vlen;
+    st.have.value = *(const char *)vdata;
+    VERIFY_EQ_RET(st.kwant - 1, st.have.value, __LINE__);
+    vreloc_valc++;
+
+    return 0;
+}
+
+static merr_t
+vreloc_iter_val_get(
+    struct kv_iterator *kvi,
+    struct kvset_iter_vctx *vc,
+    enum kmd_vtype vtype,
+    uint vbidx,
+    uint vboff,
+    const void **vdata,
+    uint *vlen,
+    uint *complen)
+{
+    VERIFY_EQ_RET(VTYPE_UCVAL, vtype, __LINE__);
+
+    *vdata = mock_vref_to_vdata(kvi, vboff);
+
+    return 0;
+}
+
+static merr_t
+vreloc_get_mblocks(struct kvset_builder *self, struct kvset_mblocks *mblks)
+{
+    /* Two new vblocks follow the adopted ones. */
+    for (uint i = 0; i < 4; i++) {
+        merr_t err = blk_list_append(&mblks->vblks, 0x3000 + i);
+
+        if (err)
+            return err;
+    }
+
+    return 0;
+}
+
+MTF_DEFINE_UTEST_PREPOST(kcompact_test, vreloc, mixed_pre, mixed_post)
+{
+#define NITER 4
+    struct cn_compaction_work w = { 0 };
+    struct kvset_vblk_map vbmap = { 0 };
+    struct vgmap *vgmap, *vgmap2;
+    struct kvs_rparams rp = kvs_rparams_defaults();
+    struct kvset_mblocks output = {};
+    struct cn_tree_node *output_node = NULL;
+    uint64_t kvsetidv = 1;
+    const bool relocv[NITER] = { false, true, false, true };
+    const uint vlen = 1 + CN_SMALL_VALUE_THRESHOLD;
+    struct nkv_tab nkv;
+    atomic_int c;
+    int i;
+    merr_t err;
+
+    memset(itv, 0, sizeof(itv));
+    atomic_set(&c, 0);
+
+    /* Input i holds keys i*10+1..i*10+10 with values i*10..i*10+9, in
+     * vblocks.  The values of inputs 1 and 3 are relocated.
+     */
+    nkv.nkeys = VRELOC_NKEYS;
+    nkv.be = KVDATA_INT_KEY;
+    nkv.vmix = VMX_BUF;
+    for (i = 0; i < NITER; ++i) {
+        nkv.key1 = i * VRELOC_NKEYS + 1;
+        nkv.val1 = i * VRELOC_NKEYS;
+        nkv.dgen = NITER - i;
+        ASSERT_EQ(0, mock_make_kvi(&itv[i], i, &rp, &nkv));
+    }
+
+    err = kvset_keep_vblocks(&vbmap, &vgmap, itv, NITER, relocv);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(2, vbmap.vbm_blkc);
+
+    vreloc_relocv = relocv;
+    vreloc_vbmap = vbmap.vbm_map;
+    vreloc_vrefc = vreloc_valc = 0;
+
+    MOCK_SET_FN(kvset_builder, kvset_builder_add_vref, vreloc_add_vref);
+    MOCK_SET_FN(kvset_builder, kvset_builder_add_val, vreloc_add_val);
+    MOCK_SET_FN(kvset, kvset_iter_val_get, vreloc_iter_val_get);
+    mapi_inject_unset(mapi_idx_kvset_builder_get_mblocks);
+    MOCK_SET_FN(kvset_builder, kvset_builder_get_mblocks, vreloc_get_mblocks);
+
+    st.kwant = 1;
+    st.vwant = 0;
+
+    init_work(
+        &w, (struct mpool *)1, &rp, NITER, itv, &c, &output, &output_node, &kvsetidv, &vbmap,
+        &vgmap);
+    w.cw_vreloc = (bool *)relocv;
+
+    vgmap2 = vgmap;
+    err = cn_kcompact(&w);
+    ASSERT_EQ(0, err);
+
+    MOCK_UNSET_FN(kvset_builder, kvset_builder_get_mblocks);
+
+    /* Every key made it out, with the values of sparse inputs copied and
+     * the others referenced in place.
+     */
+    ASSERT_EQ(NITER * VRELOC_NKEYS + 1, st.kwant);
+    ASSERT_EQ(2 * VRELOC_NKEYS, vreloc_vrefc);
+    ASSERT_EQ(2 * VRELOC_NKEYS, vreloc_valc);
+
+    ASSERT_EQ(NITER * VRELOC_NKEYS, w.cw_stats.ms_keys_out);
+    ASSERT_EQ(NITER * VRELOC_NKEYS * vlen, w.cw_stats.ms_val_bytes_out);
+    ASSERT_EQ(2 * VRELOC_NKEYS * vlen, w.cw_vbmap.vbm_used);
+
+    /* Only the vblocks past the adopted ones are counted as relocated. */
+    ASSERT_EQ(4, output.vblks.idc);
+    ASSERT_EQ(2, w.cw_vreloc_vblks);
+    ASSERT_EQ(0, w.cw_vbmap.vbm_blkc);
+
+    blk_list_free(&output.vblks);
+    for (i = 0; i < NITER; ++i) {
+        struct mock_kv_iterator *iter = container_of(itv[i], typeof(*iter), kvi);
+
+        kvset_put_ref((struct kvset *)iter->kvset);
+        kvset_iter_release(itv[i]);
+    }
+
+    free(vbmap.vbm_blkv);
+    vgmap_free(vgmap2);
+#undef NITER
+}
+
 MTF_DEFINE_UTEST_PRE(kcompact_test, all_gone, pre)
 {
     struct cn_compaction_work w = { 0 };
@@ -363,7 +594,7 @@ MTF_DEFINE_UTEST_PRE(kcompact_test, all_gone, pre)
         ASSERT_EQ(0, mock_make_kvi(&itv[i], i, &rp, &nkv));
     }
 
-    err = kvset_keep_vblocks(&vbmap, &vgmap, itv, 5);
+    err = kvset_keep_vblocks(&vbmap, &vgmap, itv, 5, NULL);
     ASSERT_EQ(0, err);
 
     /* HSE_REVISIT: is it possible to detect a memory overwrite here? */
@@ -435,7 +666,7 @@ MTF_DEFINE_UTEST_PREPOST(kcompact_test, all_gone_mixed, mixed_pre, mixed_post)
         ASSERT_EQ(0, mock_make_kvi(&itv[i], i, &rp, &nkv));
     }
 
-    err = kvset_keep_vblocks(&vbmap, &vgmap, itv, 5);
+    err = kvset_keep_vblocks(&vbmap, &vgmap, itv, 5, NULL);
     ASSERT_EQ(0, err);
 
     /* HSE_REVISIT: is it possible to detect a memory overwrite here? */
@@ -504,7 +735,7 @@ MTF_DEFINE_UTEST_PREPOST(kcompact_test, four_into_one_mixed, mixed_pre, mixed_po
         ASSERT_EQ(0, mock_make_kvi(&itv[i], i, &rp, &nkv));
     }
 
-    err = kvset_keep_vblocks(&vbmap, &vgmap, itv, NITER);
+    err = kvset_keep_vblocks(&vbmap, &vgmap, itv, NITER, NULL);
     ASSERT_EQ(0, err);
 
     st.kwant = 1;
@@ -573,7 +804,7 @@ run_kcompact(struct mtf_test_info *lcl_ti, int expect)
         ASSERT_EQ_RET(0, mock_make_kvi(&itv[i], i, &rp, &nkv), 1);
     }
 
-    err = kvset_keep_vblocks(&vbmap, &vgmap, itv, 5);
+    err = kvset_keep_vblocks(&vbmap, &vgmap, itv, 5, NULL);
     ASSERT_EQ_RET(err, 0, 1);
 
     /* HSE_REVISIT: is it possible to detect a memory overwrite here? */
@@ -674,6 +905,7 @@ pre(struct mtf_test_info *info)
     mapi_inject(mapi_idx_cndb_kvsetid_mint, 1);
     mapi_inject(mapi_idx_kvset_builder_set_agegroup, 0);
     mapi_inject(mapi_idx_kvset_builder_set_merge_stats, 0);
+    mapi_inject(mapi_idx_kvset_builder_set_tbkt, 0);
 
     return 0;
 }
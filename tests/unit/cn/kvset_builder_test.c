@@ -9,10 +9,18 @@
 #include <hse/ikvdb/cn.h>
 #include <hse/ikvdb/kvs_rparams.h>
 #include <hse/ikvdb/kvset_builder.h>
+#include <hse/ikvdb/omf_kmd.h>
+#include <hse/util/base.h>
 
 #include <hse/test/mock/mock_kbb_vbb.h>
 #include <hse/test/mtf/framework.h>
 
+#include "cn/blk_list.h"
+#include "cn/kvset.h"
+#include "cn/kvset_builder_internal.h"
+#include "cn/vblock_builder.h"
+#include "cn/vgmap.h"
+
 static struct key_obj kobj;
 
 int
@@ -349,6 +357,248 @@ MTF_DEFINE_UTEST_PREPOST(test, t_kvset_builder_get_mblocks, pre, post)
     kvset_builder_destroy(bld);
 }
 
+/* Relocated values are written to new vblocks, which the vbb mocks below
+ * number from 0 and which follow the adopted vblocks in the kvset.
+ */
+#define RELOC_ADOPTED 3
+#define RELOC_NEW     2
+#define RELOC_VBIDX   1
+#define RELOC_VBOFF   4096
+
+static uint reloc_kmd_vbidx, reloc_kmd_vboff;
+static merr_t reloc_vbb_finish_err;
+static uint64_t reloc_deleted[RELOC_ADOPTED + RELOC_NEW];
+static uint reloc_deletedc;
+
+static merr_t
+reloc_vbb_add_entry(
+    struct vblock_builder *bld,
+    const struct key_obj *kobj,
+    const void *vdata,
+    uint vlen,
+    uint64_t *vbidout,
+    uint *vbidxout,
+    uint *vboffout)
+{
+    *vbidout = 0x200 + RELOC_VBIDX;
+    *vbidxout = RELOC_VBIDX;
+    *vboffout = RELOC_VBOFF;
+
+    return 0;
+}
+
+static merr_t
+reloc_vbb_finish(struct vblock_builder *bld, struct blk_list *vblks, const struct key_obj *max_kobj)
+{
+    blk_list_init(vblks);
+
+    if (reloc_vbb_finish_err)
+        return reloc_vbb_finish_err;
+
+    for (uint i = 0; i < RELOC_NEW; i++) {
+        merr_t err = blk_list_append(vblks, 0x200 + i);
+
+        if (err)
+            return err;
+    }
+
+    return 0;
+}
+
+static merr_t
+reloc_kbb_add_entry(
+    struct kblock_builder *bld,
+    const struct key_obj *kobj,
+    const void *kmd,
+    uint kmd_len,
+    struct key_stats *stats)
+{
+    enum kmd_vtype vtype;
+    uint64_t seq;
+    size_t off = 0;
+    uint vlen;
+
+    kmd_type_seq(kmd, &off, &vtype, &seq);
+    if (vtype != VTYPE_UCVAL)
+        return merr(EINVAL);
+
+    kmd_val(kmd, &off, &reloc_kmd_vbidx, &reloc_kmd_vboff, &vlen);
+
+    return 0;
+}
+
+static void
+reloc_delete_mblocks(struct mpool *mp, struct blk_list *blks)
+{
+    for (uint i = 0; i < blks->idc; i++) {
+        if (blks->idv[i] && reloc_deletedc < NELEM(reloc_deleted))
+            reloc_deleted[reloc_deletedc++] = blks->idv[i];
+        blks->idv[i] = 0;
+    }
+}
+
+/* Create a builder which has adopted RELOC_ADOPTED vblocks in two vgroups
+ * and has written one relocated value.
+ */
+static merr_t
+reloc_builder_create(struct kvset_builder **bldp)
+{
+    char value[CN_SMALL_VALUE_THRESHOLD + 100] = { 0 };
+    struct kvset_builder *bld;
+    struct vgmap *vgmap;
+    uint64_t *idv;
+    merr_t err;
+
+    err = kvset_builder_create(&bld, (void *)-1, 0, 1);
+    if (err)
+        return err;
+
+    idv = malloc(RELOC_ADOPTED * sizeof(*idv));
+    vgmap = vgmap_alloc(2);
+    if (!idv || !vgmap) {
+        free(idv);
+        vgmap_free(vgmap);
+        kvset_builder_destroy(bld);
+        return merr(ENOMEM);
+    }
+
+    for (uint i = 0; i < RELOC_ADOPTED; i++)
+        idv[i] = 0x100 + i;
+
+    vgmap_vbidx_set(NULL, 0, vgmap, 0, 0);
+    vgmap_vbidx_set(NULL, RELOC_ADOPTED - 1, vgmap, RELOC_ADOPTED - 1, 1);
+
+    kvset_builder_adopt_vblocks(bld, RELOC_ADOPTED, idv, 3000, vgmap);
+
+    err = kvset_builder_add_val(bld, &kobj, value, sizeof(value), 1, 0);
+    if (!err)
+        err = kvset_builder_add_key(bld, &kobj);
+    if (err) {
+        kvset_builder_destroy(bld);
+        return err;
+    }
+
+    *bldp = bld;
+
+    return 0;
+}
+
+static void
+reloc_mocks_set(void)
+{
+    mapi_inject_unset(mapi_idx_vbb_add_entry);
+    mapi_inject_unset(mapi_idx_vbb_finish);
+    mapi_inject_unset(mapi_idx_kbb_add_entry);
+    mapi_inject_unset(mapi_idx_delete_mblocks);
+
+    MOCK_SET_FN(vblock_builder, vbb_add_entry, reloc_vbb_add_entry);
+    MOCK_SET_FN(vblock_builder, vbb_finish, reloc_vbb_finish);
+    MOCK_SET_FN(kblock_builder, kbb_add_entry, reloc_kbb_add_entry);
+    MOCK_SET_FN(blk_list, delete_mblocks, reloc_delete_mblocks);
+
+    mapi_inject(mapi_idx_kbb_is_empty, 0);
+    mapi_inject(mapi_idx_kbb_curr_kblk_min_max_keys, 0);
+    mapi_inject(mapi_idx_vbb_vlen_get, 500);
+
+    reloc_vbb_finish_err = 0;
+    reloc_deletedc = 0;
+}
+
+static void
+reloc_mocks_unset(void)
+{
+    MOCK_UNSET_FN(vblock_builder, vbb_add_entry);
+    MOCK_UNSET_FN(vblock_builder, vbb_finish);
+    MOCK_UNSET_FN(kblock_builder, kbb_add_entry);
+    MOCK_UNSET_FN(blk_list, delete_mblocks);
+
+    mapi_inject_unset(mapi_idx_kbb_curr_kblk_min_max_keys);
+    mapi_inject_unset(mapi_idx_vbb_vlen_get);
+}
+
+MTF_DEFINE_UTEST_PREPOST(test, t_kvset_builder_reloc, pre, post)
+{
+    struct kvset_builder *bld;
+    struct kvset_mblocks blks = {};
+    struct vgmap *vgmap;
+    uint32_t api;
+    merr_t err;
+
+    reloc_mocks_set();
+
+    err = reloc_builder_create(&bld);
+    ASSERT_EQ(0, err);
+
+    /* The vref of a relocated value indexes the new vblocks past the
+     * adopted vblocks.
+     */
+    ASSERT_EQ(RELOC_ADOPTED + RELOC_VBIDX, reloc_kmd_vbidx);
+    ASSERT_EQ(RELOC_VBOFF, reloc_kmd_vboff);
+
+    err = kvset_builder_get_mblocks(bld, &blks);
+    ASSERT_EQ(0, err);
+
+    ASSERT_EQ(RELOC_ADOPTED + RELOC_NEW, blks.vblks.idc);
+    ASSERT_EQ(RELOC_ADOPTED, blks.bl_vadopted);
+    for (uint i = 0; i < RELOC_ADOPTED; i++)
+        ASSERT_EQ(0x100 + i, blks.vblks.idv[i]);
+    for (uint i = 0; i < RELOC_NEW; i++)
+        ASSERT_EQ(0x200 + i, blks.vblks.idv[RELOC_ADOPTED + i]);
+    ASSERT_EQ(3000 + 500, blks.bl_vtotal);
+
+    /* The new vblocks form one more vgroup. */
+    vgmap = bld->vgmap;
+    ASSERT_EQ(3, vgmap->nvgroups);
+    ASSERT_EQ(0, vgmap->vbidx_out[0]);
+    ASSERT_EQ(RELOC_ADOPTED - 1, vgmap->vbidx_out[1]);
+    ASSERT_EQ(RELOC_ADOPTED + RELOC_NEW - 1, vgmap->vbidx_out[2]);
+    for (uint i = 0; i < vgmap->nvgroups; i++)
+        ASSERT_EQ(0, vgmap->vbidx_adj[i]);
+
+    kvset_builder_destroy(bld);
+    ASSERT_EQ(0, reloc_deletedc);
+    blk_list_free(&blks.kblks);
+    blk_list_free(&blks.vblks);
+
+    /* No relocated vblocks to delete if their builder fails. */
+    err = reloc_builder_create(&bld);
+    ASSERT_EQ(0, err);
+
+    reloc_vbb_finish_err = merr(EIO);
+    err = kvset_builder_get_mblocks(bld, &blks);
+    ASSERT_EQ(EIO, merr_errno(err));
+    ASSERT_EQ(0, reloc_deletedc);
+    ASSERT_EQ(2, bld->vgmap->nvgroups);
+
+    kvset_builder_destroy(bld);
+    ASSERT_EQ(0, reloc_deletedc);
+    reloc_vbb_finish_err = 0;
+
+    /* Failures after the relocated vblocks are finished delete them,
+     * exactly once, but never the adopted vblocks.
+     */
+    for (uint i = 0; i < 2; i++) {
+        api = i ? mapi_idx_hbb_finish : mapi_idx_kbb_finish;
+
+        err = reloc_builder_create(&bld);
+        ASSERT_EQ(0, err);
+
+        reloc_deletedc = 0;
+        mapi_inject(api, merr(EIO));
+        err = kvset_builder_get_mblocks(bld, &blks);
+        ASSERT_EQ(EIO, merr_errno(err));
+        mapi_inject(api, 0);
+
+        kvset_builder_destroy(bld);
+
+        ASSERT_EQ(RELOC_NEW, reloc_deletedc);
+        for (uint j = 0; j < RELOC_NEW; j++)
+            ASSERT_EQ(0x200 + j, reloc_deleted[j]);
+    }
+
+    reloc_mocks_unset();
+}
+
 MTF_DEFINE_UTEST_PREPOST(test, t_kvset_build_destroy, pre, post)
 {
     kvset_builder_destroy(NULL);
@@ -0,0 +1,264 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <hse/ikvdb/kvs_rparams.h>
+#include <hse/ikvdb/rtomb.h>
+#include <hse/util/base.h>
+
+#include <hse/test/mock/api.h>
+#include <hse/test/mtf/framework.h>
+
+#include "cn/kvset.h"
+#include "cn/kvset_internal.h"
+#include "cn/wbt_reader.h"
+
+/* A fake kvset whose kblocks are served by a mocked wbt iterator that
+ * returns each kblock's min and max keys.  The mock records which kblocks
+ * were opened so that tests can verify which ones the kvset iterator read.
+ */
+#define KBLK_CNT 3
+
+static const char *kblk_keys[KBLK_CNT][2] = {
+    { "a0", "a9" },
+    { "b0", "b9" },
+    { "c0", "c9" },
+};
+
+static uint8_t kblk_map[KBLK_CNT][8];
+static int kblk_opened[KBLK_CNT];
+
+struct fake_wbti {
+    int kbidx;
+    int keyx;
+};
+
+static struct fake_wbti fake_wbtiv[KBLK_CNT];
+static struct kvs_rparams rp;
+static struct kvset *ks;
+
+static merr_t
+_wbti_create(
+    struct wbti **wbti,
+    const void *base,
+    struct wbt_desc *wbd,
+    struct kvs_ktuple *seek,
+    bool reverse,
+    bool cache)
+{
+    for (int i = 0; i < KBLK_CNT; i++) {
+        if (base == kblk_map[i]) {
+            kblk_opened[i]++;
+            fake_wbtiv[i].kbidx = i;
+            fake_wbtiv[i].keyx = 0;
+            *wbti = (struct wbti *)&fake_wbtiv[i];
+            return 0;
+        }
+    }
+
+    return merr(EBUG);
+}
+
+static void
+_wbti_destroy(struct wbti *wbti)
+{
+}
+
+static void
+_wbti_prefix(struct wbti *self, const void **pfx, uint *pfx_len)
+{
+    *pfx = NULL;
+    *pfx_len = 0;
+}
+
+static bool
+_wbti_next(struct wbti *wbti, const void **kdata, uint *klen, const void **kmd)
+{
+    struct fake_wbti *fw = (struct fake_wbti *)wbti;
+
+    if (fw->keyx >= 2)
+        return false;
+
+    *kdata = kblk_keys[fw->kbidx][fw->keyx++];
+    *klen = strlen(*kdata);
+    *kmd = NULL;
+
+    return true;
+}
+
+static int
+collection_pre(struct mtf_test_info *lcl_ti)
+{
+    rp = kvs_rparams_defaults();
+
+    return merr_errno(kvset_init());
+}
+
+static int
+collection_post(struct mtf_test_info *lcl_ti)
+{
+    kvset_fini();
+
+    return 0;
+}
+
+static int
+test_pre(struct mtf_test_info *lcl_ti)
+{
+    size_t sz = sizeof(*ks) + KBLK_CNT * sizeof(ks->ks_kblks[0]);
+
+    ks = aligned_alloc(alignof(*ks), roundup(sz, alignof(*ks)));
+    ASSERT_NE_RET(NULL, ks, -1);
+
+    memset(ks, 0, sz);
+    memset(kblk_opened, 0, sizeof(kblk_opened));
+
+    ks->ks_rp = &rp;
+    ks->ks_seqno_min = 1;
+    ks->ks_seqno_max = 10;
+    ks->ks_st.kst_kblks = KBLK_CNT;
+    atomic_set(&ks->ks_ref, 1);
+
+    for (int i = 0; i < KBLK_CNT; i++) {
+        struct kvset_kblk *kb = ks->ks_kblks + i;
+
+        kb->kb_kblk_desc.map_base = kblk_map[i];
+        kb->kb_koff_min = kblk_keys[i][0];
+        kb->kb_klen_min = strlen(kblk_keys[i][0]);
+        kb->kb_koff_max = kblk_keys[i][1];
+        kb->kb_klen_max = strlen(kblk_keys[i][1]);
+    }
+
+    MOCK_SET(wbt_reader, _wbti_create);
+    MOCK_SET(wbt_reader, _wbti_destroy);
+    MOCK_SET(wbt_reader, _wbti_prefix);
+    MOCK_SET(wbt_reader, _wbti_next);
+
+    return 0;
+}
+
+static int
+test_post(struct mtf_test_info *lcl_ti)
+{
+    MOCK_UNSET(wbt_reader, _wbti_create);
+    MOCK_UNSET(wbt_reader, _wbti_destroy);
+    MOCK_UNSET(wbt_reader, _wbti_prefix);
+    MOCK_UNSET(wbt_reader, _wbti_next);
+
+    ASSERT_EQ_RET(1, atomic_read(&ks->ks_ref), -1);
+    free(ks);
+    ks = NULL;
+
+    return 0;
+}
+
+/* Iterate over the fake kvset as a compaction would, skipping kblocks
+ * covered by @rt, and return the number of keys read.
+ */
+static int
+scan(struct mtf_test_info *lcl_ti, const struct rtomb *rt, uint64_t horizon)
+{
+    struct kvset_iter_vctx vc;
+    struct kv_iterator *it;
+    struct key_obj kobj;
+    int keyc = 0;
+    merr_t err;
+
+    err = kvset_iter_create(
+        ks, NULL, NULL, NULL, kvset_iter_flag_mmap | kvset_iter_flag_fullscan, &it);
+    ASSERT_EQ_RET(0, err, -1);
+
+    err = kvset_iter_skip_covered(it, rt, rt ? 1 : 0, horizon);
+    ASSERT_EQ_RET(0, err, -1);
+
+    while (1) {
+        err = kvset_iter_next_key(it, &kobj, &vc);
+        ASSERT_EQ_RET(0, err, -1);
+
+        if (it->kvi_eof)
+            break;
+
+        keyc++;
+    }
+
+    kvset_iter_release(it);
+
+    return keyc;
+}
+
+#define RTOMB(_start, _end, _seqno) \
+    {                               \
+        .rt_start = (_start),       \
+        .rt_end = (_end),           \
+        .rt_seqno = (_seqno),       \
+        .rt_slen = strlen(_start),  \
+        .rt_elen = strlen(_end),    \
+    }
+
+MTF_BEGIN_UTEST_COLLECTION_PREPOST(kvset_test, collection_pre, collection_post)
+
+MTF_DEFINE_UTEST_PREPOST(kvset_test, skip_covered_kblock, test_pre, test_post)
+{
+    const struct rtomb rt = RTOMB("b", "c", 20);
+
+    ASSERT_EQ(4, scan(lcl_ti, &rt, 30));
+
+    ASSERT_EQ(1, kblk_opened[0]);
+    ASSERT_EQ(0, kblk_opened[1]);
+    ASSERT_EQ(1, kblk_opened[2]);
+}
+
+MTF_DEFINE_UTEST_PREPOST(kvset_test, skip_all_kblocks, test_pre, test_post)
+{
+    const struct rtomb rt = RTOMB("a", "z", 20);
+
+    ASSERT_EQ(0, scan(lcl_ti, &rt, 20));
+
+    for (int i = 0; i < KBLK_CNT; i++)
+        ASSERT_EQ(0, kblk_opened[i]);
+}
+
+MTF_DEFINE_UTEST_PREPOST(kvset_test, keep_partially_covered, test_pre, test_post)
+{
+    const struct rtomb straddle = RTOMB("a5", "c5", 20);
+    const struct rtomb exclusive = RTOMB("b0", "b9", 20);
+
+    /* Only the middle kblock lies entirely within [a5, c5).
+     */
+    ASSERT_EQ(4, scan(lcl_ti, &straddle, 30));
+    ASSERT_EQ(1, kblk_opened[0]);
+    ASSERT_EQ(0, kblk_opened[1]);
+    ASSERT_EQ(1, kblk_opened[2]);
+
+    /* The end key is exclusive, so [b0, b9) doesn't cover b9.
+     */
+    ASSERT_EQ(6, scan(lcl_ti, &exclusive, 30));
+    ASSERT_EQ(1, kblk_opened[1]);
+}
+
+MTF_DEFINE_UTEST_PREPOST(kvset_test, keep_visible_entries, test_pre, test_post)
+{
+    const struct rtomb older = RTOMB("a", "z", 10);
+    const struct rtomb newer = RTOMB("a", "z", 31);
+
+    /* An rtomb no newer than the kvset may not hide all of its entries.
+     */
+    ASSERT_EQ(6, scan(lcl_ti, &older, 30));
+
+    /* An rtomb beyond the horizon may still be invisible to some views.
+     */
+    ASSERT_EQ(6, scan(lcl_ti, &newer, 30));
+
+    ASSERT_EQ(6, scan(lcl_ti, NULL, 30));
+
+    for (int i = 0; i < KBLK_CNT; i++)
+        ASSERT_EQ(3, kblk_opened[i]);
+}
+
+MTF_END_UTEST_COLLECTION(kvset_test)
@@ -1156,8 +1156,10 @@ test_prehook(struct mtf_test_info *info)
     /* Neuter the following APIs */
     mapi_inject_ptr(mapi_idx_cn_tree_get_cn, NULL);
     mapi_inject(mapi_idx_kvset_builder_set_merge_stats, 0);
+    mapi_inject(mapi_idx_kvset_builder_set_tbkt, 0);
     mapi_inject(mapi_idx_cndb_kvsetid_mint, 1);
     mapi_inject(mapi_idx_cn_tree_get_cndb, 0);
+    mapi_inject(mapi_idx_kvset_get_rtombs, 0);
 
     return 0;
 }
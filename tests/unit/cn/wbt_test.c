@@ -570,4 +570,73 @@ MTF_DEFINE_UTEST_PREPOST(wbt_test, skip_keys, pre_test, post_test)
     free(ql.buf);
 }
 
+MTF_DEFINE_UTEST_PREPOST(wbt_test, reverse_readahead, pre_test, post_test)
+{
+    char buf[HSE_KVS_KEY_LEN_MAX];
+    struct wbt_hdr_omf hdr;
+    struct wbt_desc wbd;
+    struct kvs_ktuple kt;
+    struct wbti *wbti;
+    const void *kdata, *kmd_read;
+    uint32_t node_idx;
+    void *tree;
+    uint klen;
+    merr_t err;
+    int i, rc;
+
+    memset(buf, 0xfe, sizeof(buf));
+
+    for (i = 0; i < 40 * 1000; i++) {
+        snprintf(buf, sizeof(buf), "key-%032d", i);
+        ASSERT_TRUE(add_key(&key_list, buf, 64));
+    }
+
+    rc = tree_construct(lcl_ti, &tree, &hdr);
+    ASSERT_EQ(0, rc);
+
+    wbd = (struct wbt_desc){
+        .wbd_first_page = 0,
+        .wbd_n_pages = wbt_pgc,
+        .wbd_version = WBT_TREE_VERSION,
+        .wbd_root = omf_wbt_root(&hdr),
+        .wbd_leaf = omf_wbt_leaf(&hdr),
+        .wbd_leaf_cnt = omf_wbt_leaf_cnt(&hdr),
+        .wbd_kmd_pgc = omf_wbt_kmd_pgc(&hdr),
+    };
+    ASSERT_GT(wbd.wbd_leaf_cnt, 4 * WBTI_REV_RA_PAGES);
+
+    /* Without a seek, readahead starts below the last leaf.
+     */
+    err = wbti_create(&wbti, tree, &wbd, NULL, true, false);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(wbd.wbd_leaf + wbd.wbd_leaf_cnt - 1, wbti->node_idx);
+    ASSERT_EQ(wbti->node_idx - WBTI_REV_RA_PAGES, wbti->ra_idx);
+
+    /* A seek restarts readahead below the seek leaf, wherever the last
+     * window was.
+     */
+    snprintf(buf, sizeof(buf), "key-%032d", 20 * 1000);
+    kvs_ktuple_init_nohash(&kt, buf, 64);
+
+    wbti_reset(wbti, tree, &wbd, &kt, true, false);
+    ASSERT_LT(wbti->node_idx, wbd.wbd_leaf + wbd.wbd_leaf_cnt - 2 * WBTI_REV_RA_PAGES);
+    ASSERT_EQ(wbti->node_idx - WBTI_REV_RA_PAGES, wbti->ra_idx);
+
+    /* The next window is requested once half of the current one has been
+     * consumed, and the window never drops below the first leaf.
+     */
+    node_idx = wbti->node_idx;
+    while (wbti_next(wbti, &kdata, &klen, &kmd_read)) {
+        ASSERT_LE(wbti->ra_idx, wbti->node_idx);
+        ASSERT_LE(wbti->node_idx, wbti->ra_idx + WBTI_REV_RA_PAGES + WBTI_REV_RA_PAGES / 2);
+
+        if (wbti->node_idx == node_idx - WBTI_REV_RA_PAGES / 2 - 1)
+            ASSERT_EQ(node_idx - 2 * WBTI_REV_RA_PAGES, wbti->ra_idx);
+    }
+    ASSERT_EQ(wbd.wbd_leaf, wbti->ra_idx);
+
+    wbti_destroy(wbti);
+    free(tree);
+}
+
 MTF_END_UTEST_COLLECTION(wbt_test)
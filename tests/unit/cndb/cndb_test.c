@@ -4,6 +4,7 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 
 #include <hse/error/merr.h>
 #include <hse/ikvdb/cndb.h>
@@ -97,6 +98,13 @@ _mpool_mdc_append(struct mpool_mdc *mdc, void *data, size_t len, bool sync)
     return 0;
 }
 
+merr_t
+_mpool_mdc_append_async(struct mpool_mdc *mdc, void *data, size_t len, uint64_t *gen)
+{
+    *gen = 1;
+    return _mpool_mdc_append(mdc, data, len, false);
+}
+
 merr_t
 _mpool_mdc_rewind(struct mpool_mdc *mdc)
 {
@@ -125,11 +133,16 @@ _mpool_mdc_read(struct mpool_mdc *mdc, void *data, size_t max, size_t *dlen)
     return 0;
 }
 
+static int g_mdc_cstart_calls;
+static uint64_t g_mdc_used = 10;
+
 merr_t
 _mpool_mdc_cstart(struct mpool_mdc *mdc)
 {
     struct mock_mdc *m = _mock_mdc;
 
+    g_mdc_cstart_calls++;
+
     m->read_curr = m->head;
     while (m->read_curr) {
         struct mock_mdc_record *n = m->read_curr->next;
@@ -142,6 +155,85 @@ _mpool_mdc_cstart(struct mpool_mdc *mdc)
     return 0;
 }
 
+static int g_mdc_cstart_bg_calls;
+static struct mock_mdc *g_mdc_img;
+static struct mock_mdc_record *g_mdc_delta;
+static void (*g_mdc_cend_bg_hook)(void);
+
+static void
+mock_mdc_free_records(struct mock_mdc_record *r, struct mock_mdc_record *end)
+{
+    while (r != end) {
+        struct mock_mdc_record *n = r->next;
+
+        free(r);
+        r = n;
+    }
+}
+
+merr_t
+_mpool_mdc_cstart_bg(struct mpool_mdc *mdc, struct mpool_mdc **img)
+{
+    struct mock_mdc *m = (void *)mdc;
+
+    g_mdc_cstart_bg_calls++;
+
+    g_mdc_img = calloc(1, sizeof(*g_mdc_img));
+    if (!g_mdc_img)
+        return merr(ENOMEM);
+
+    /* Records appended after the current tail are the delta. */
+    g_mdc_delta = m->append_curr;
+
+    *img = (void *)g_mdc_img;
+    return 0;
+}
+
+void
+_mpool_mdc_cabort(struct mpool_mdc *mdc)
+{
+    mock_mdc_free_records(g_mdc_img->head, NULL);
+    free(g_mdc_img);
+    g_mdc_img = NULL;
+}
+
+merr_t
+_mpool_mdc_cend_bg(struct mpool_mdc *mdc)
+{
+    struct mock_mdc *m = (void *)mdc;
+    struct mock_mdc_record *delta;
+
+    /* Runs where the image would be written, without the cndb mutex. */
+    if (g_mdc_cend_bg_hook)
+        g_mdc_cend_bg_hook();
+
+    delta = g_mdc_delta ? g_mdc_delta->next : m->head;
+    if (g_mdc_delta)
+        g_mdc_delta->next = NULL;
+
+    mock_mdc_free_records(m->head, delta);
+
+    /* The compacted log is the image followed by the delta. */
+    m->head = g_mdc_img->head;
+    m->append_curr = g_mdc_img->append_curr;
+    if (delta) {
+        if (m->append_curr)
+            m->append_curr->next = delta;
+        else
+            m->head = delta;
+
+        while (delta->next)
+            delta = delta->next;
+        m->append_curr = delta;
+    }
+    m->read_curr = m->head;
+
+    free(g_mdc_img);
+    g_mdc_img = NULL;
+
+    return 0;
+}
+
 merr_t
 _mpool_mdc_close(struct mpool_mdc *mdc)
 {
@@ -152,7 +244,7 @@ merr_t
 _mpool_mdc_usage(struct mpool_mdc *mdc, uint64_t *size, uint64_t *allocated, uint64_t *used)
 {
     *size = 100;
-    *used = 10;
+    *used = g_mdc_used;
     *allocated = 100;
 
     return 0;
@@ -166,14 +258,19 @@ collection_pre(struct mtf_test_info *ti)
     MOCK_SET(mpool, _mpool_mdc_open);
     MOCK_SET(mpool, _mpool_mdc_close);
     MOCK_SET(mpool, _mpool_mdc_append);
+    MOCK_SET(mpool, _mpool_mdc_append_async);
     MOCK_SET(mpool, _mpool_mdc_rewind);
     MOCK_SET(mpool, _mpool_mdc_read);
     MOCK_SET(mpool, _mpool_mdc_usage);
     MOCK_SET(mpool, _mpool_mdc_cstart);
+    MOCK_SET(mpool, _mpool_mdc_cstart_bg);
+    MOCK_SET(mpool, _mpool_mdc_cend_bg);
+    MOCK_SET(mpool, _mpool_mdc_cabort);
 
     mapi_inject(mapi_idx_mpool_mdc_commit, 0);
     mapi_inject(mapi_idx_mpool_mdc_cend, 0);
     mapi_inject(mapi_idx_mpool_mdc_sync, 0);
+    mapi_inject(mapi_idx_mpool_mdc_sync_wait, 0);
 
     mapi_inject(mapi_idx_mpool_mclass_is_configured, 1);
     mapi_inject(mapi_idx_mpool_mblock_props_get, 0);
@@ -843,6 +940,153 @@ MTF_DEFINE_UTEST_PREPOST(cndb_test, compact_no_recovery, test_pre, test_post)
     ASSERT_EQ(2, g_cb_ctr); /* kvsetid_left and kvsetid_right */
 }
 
+static int g_hook_kvsets;
+
+/* Records a kvset while a background compaction is writing its image.
+ */
+static void
+compact_background_hook(void)
+{
+    struct t_kvset k = { .nid = 0, .kb = BLKS(3), .vb = BLKS(30) };
+    struct cndb_txn *tx;
+    uint64_t kvsetid;
+    void *cookie;
+    merr_t err;
+
+    err = txstart(cndb, 1, 0, &tx);
+    if (err)
+        return;
+
+    cookie = kvset_add(cndb, tx, 100, k, &kvsetid);
+    if (cookie && !cndb_record_kvset_add_ack(cndb, tx, cookie))
+        g_hook_kvsets++;
+}
+
+MTF_DEFINE_UTEST_PREPOST(cndb_test, compact_background, test_pre, test_post)
+{
+    merr_t err;
+    void *c1;
+    uint64_t dgen = 0;
+    uint64_t kvsetid;
+    struct cndb_txn *tx;
+    struct mpool *mp = (void *)-1;
+    uint64_t seqno_out, ingestid_out, txhorizon_out;
+    struct kvdb_rparams rp = kvdb_rparams_defaults();
+    struct t_kvset k = { .nid = 0, .kb = BLKS(1, 2), .vb = BLKS(10, 20) };
+
+    g_mbid = 0;
+
+    /* A log that is nearly full is compacted inline by the caller.
+     */
+    g_mdc_used = 95;
+    g_mdc_cstart_calls = 0;
+
+    err = txstart(cndb, 1, 0, &tx);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(1, g_mdc_cstart_calls);
+
+    g_mdc_used = 10;
+
+    c1 = kvset_add(cndb, tx, ++dgen, k, &kvsetid);
+    ASSERT_NE(0, c1);
+
+    err = cndb_record_kvset_add_ack(cndb, tx, c1);
+    ASSERT_EQ(0, err);
+
+    /* Crossing the high water mark schedules a background compaction,
+     * which must have completed by the time cndb_close() returns.  The
+     * cndb remains writable while the image is written, and a kvset
+     * recorded meanwhile must survive the switch to the compacted log.
+     */
+    g_mdc_used = 85;
+    g_mdc_cstart_calls = 0;
+    g_mdc_cstart_bg_calls = 0;
+    g_hook_kvsets = 0;
+    g_mdc_cend_bg_hook = compact_background_hook;
+
+    err = txstart(cndb, 1, 0, &tx);
+    ASSERT_EQ(0, err);
+
+    err = cndb_close(cndb);
+    g_mdc_cend_bg_hook = NULL;
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(0, g_mdc_cstart_calls);
+    ASSERT_EQ(1, g_mdc_cstart_bg_calls);
+    ASSERT_EQ(1, g_hook_kvsets);
+
+    g_mdc_used = 10;
+
+    err = cndb_open(mp, 0, 0, &rp, &cndb);
+    ASSERT_EQ(0, err);
+
+    err = cndb_replay(cndb, &seqno_out, &ingestid_out, &txhorizon_out);
+    ASSERT_EQ(0, err);
+
+    g_cb_ctr = 0;
+    err = cndb_cn_instantiate(cndb, cnid, NULL, (void *)replay_full_cb);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(2, g_cb_ctr);
+}
+
+static merr_t
+assert_kvset_snap(void *ctx, struct kvset_meta *km, uint64_t kvsetid)
+{
+    const char *snap = ctx;
+
+    if (km->km_snaplen != strlen(snap) + 1 || memcmp(km->km_snap, snap, km->km_snaplen))
+        return merr(EINVAL);
+
+    g_cb_ctr++;
+
+    return 0;
+}
+
+MTF_DEFINE_UTEST_PREPOST(cndb_test, kvset_snap, test_pre, test_post)
+{
+    merr_t err;
+    void *cookie;
+    struct cndb_txn *tx;
+    uint64_t kvsetid;
+    struct mpool *mp = (void *)-1;
+    uint64_t seqno_out, ingestid_out, txhorizon_out;
+    struct kvdb_rparams rp = kvdb_rparams_defaults();
+    struct t_kvset k = { .nid = 0, .kb = BLKS(1, 2), .vb = BLKS(10) };
+    const char snap[] = "kvset snapshot";
+
+    g_mbid = 0;
+
+    err = txstart(cndb, 1, 0, &tx);
+    ASSERT_EQ(0, err);
+
+    cookie = kvset_add(cndb, tx, 1, k, &kvsetid);
+    ASSERT_NE(0, cookie);
+
+    err = cndb_record_kvset_add_ack(cndb, tx, cookie);
+    ASSERT_EQ(0, err);
+
+    err = cndb_kvset_snap_set(cndb, cnid + 1, kvsetid, snap, sizeof(snap));
+    ASSERT_EQ(ENOENT, merr_errno(err));
+
+    err = cndb_kvset_snap_set(cndb, cnid, kvsetid, snap, sizeof(snap));
+    ASSERT_EQ(0, err);
+
+    /* A clean close persists the snapshot.
+     */
+    err = cndb_close(cndb);
+    ASSERT_EQ(0, err);
+
+    err = cndb_open(mp, 0, 0, &rp, &cndb);
+    ASSERT_EQ(0, err);
+
+    err = cndb_replay(cndb, &seqno_out, &ingestid_out, &txhorizon_out);
+    ASSERT_EQ(0, err);
+
+    g_cb_ctr = 0;
+    err = cndb_cn_instantiate(cndb, cnid, (void *)snap, assert_kvset_snap);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(1, g_cb_ctr);
+}
+
 MTF_DEFINE_UTEST_PREPOST(cndb_test, only_deletes_rollforward, test_pre, test_post)
 {
     merr_t err;
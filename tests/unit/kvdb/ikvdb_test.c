@@ -24,6 +24,7 @@
 #include <hse/ikvdb/kvs.h>
 #include <hse/ikvdb/kvs_cparams.h>
 #include <hse/ikvdb/kvs_rparams.h>
+#include <hse/ikvdb/kvset_builder.h>
 #include <hse/ikvdb/rparam_debug_flags.h>
 #include <hse/util/dax.h>
 
@@ -198,6 +199,24 @@ collection_post(struct mtf_test_info *t1)
     return 0;
 }
 
+static uint64_t ingested_valv[8];
+static int ingested_valc;
+
+static merr_t
+_kvset_builder_add_val(
+    struct kvset_builder *self,
+    const struct key_obj *kobj,
+    const void *vdata,
+    uint vlen,
+    uint64_t seq,
+    uint complen)
+{
+    if (vlen == sizeof(uint64_t) && ingested_valc < NELEM(ingested_valv))
+        memcpy(&ingested_valv[ingested_valc++], vdata, vlen);
+
+    return 0;
+}
+
 MTF_BEGIN_UTEST_COLLECTION_PREPOST(ikvdb_test, collection_pre, collection_post);
 
 MTF_DEFINE_UTEST_PREPOST(ikvdb_test, init, test_pre, test_post)
@@ -1661,6 +1680,230 @@ MTF_DEFINE_UTEST_PREPOST(ikvdb_test, cursor_2, test_pre_c0, test_post_c0)
 }
 #endif
 
+MTF_DEFINE_UTEST_PREPOST(ikvdb_test, snapshot, test_pre_c0, test_post_c0)
+{
+    struct ikvdb *h = NULL;
+    struct hse_kvs *kvs_h = NULL;
+    const char *mpool = __func__;
+    const char * const kvdb_open_paramv[] = { "c0_diag_mode=true" };
+    struct kvdb_rparams params = kvdb_rparams_defaults();
+    struct kvs_rparams kvs_rp = kvs_rparams_defaults();
+    struct kvs_cparams kvs_cp = kvs_cparams_defaults();
+    struct hse_kvdb_snapshot *snap;
+    struct hse_kvs_cursor *cur;
+    uint64_t horizon;
+    struct kvs_ktuple kt = { 0 };
+    struct kvs_vtuple vt = { 0 };
+    struct kvs_buf vbuf;
+    enum key_lookup_res res;
+    const void *key, *val;
+    size_t klen, vlen;
+    char buf[32];
+    merr_t err;
+    bool eof;
+
+    err = kvdb_rparams_from_paramv(&params, NELEM(kvdb_open_paramv), kvdb_open_paramv);
+    ASSERT_EQ(0, err);
+
+    err = ikvdb_open(mpool, &params, &h);
+    ASSERT_EQ(0, err);
+
+    err = ikvdb_kvs_create(h, "kvs", &kvs_cp);
+    ASSERT_EQ(0, err);
+
+    mapi_inject(mapi_idx_mpool_mclass_props_get, 0);
+    err = ikvdb_kvs_open(h, "kvs", &kvs_rp, 0, &kvs_h);
+    ASSERT_EQ(0, err);
+
+    kvs_ktuple_init(&kt, "key", 3);
+    kvs_vtuple_init(&vt, "old", 3);
+    err = ikvdb_kvs_put(kvs_h, 0, NULL, &kt, &vt);
+    ASSERT_EQ(0, err);
+
+    err = ikvdb_snapshot_create(h, &snap);
+    ASSERT_EQ(0, err);
+    ASSERT_NE(NULL, snap);
+
+    /* Neither an overwrite nor a new key may be visible in the snapshot. */
+    kvs_vtuple_init(&vt, "new", 3);
+    err = ikvdb_kvs_put(kvs_h, 0, NULL, &kt, &vt);
+    ASSERT_EQ(0, err);
+
+    kvs_ktuple_init(&kt, "key2", 4);
+    err = ikvdb_kvs_put(kvs_h, 0, NULL, &kt, &vt);
+    ASSERT_EQ(0, err);
+
+    kvs_ktuple_init(&kt, "key", 3);
+    kvs_buf_init(&vbuf, buf, sizeof(buf));
+    err = ikvdb_kvs_snapshot_get(kvs_h, 0, snap, &kt, &res, &vbuf);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(FOUND_VAL, res);
+    ASSERT_EQ(3, vbuf.b_len);
+    ASSERT_EQ(0, memcmp(buf, "old", 3));
+
+    kvs_buf_init(&vbuf, buf, sizeof(buf));
+    err = ikvdb_kvs_get(kvs_h, 0, NULL, &kt, &res, &vbuf);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(FOUND_VAL, res);
+    ASSERT_EQ(0, memcmp(buf, "new", 3));
+
+    err = ikvdb_kvs_snapshot_cursor_create(kvs_h, 0, snap, NULL, 0, &cur);
+    ASSERT_EQ(0, err);
+
+    /* The cursor keeps the snapshot's view, and with it the horizon,
+     * after the snapshot is released.
+     */
+    horizon = ikvdb_horizon(h);
+    ikvdb_snapshot_release(h, snap);
+    ASSERT_EQ(horizon, ikvdb_horizon(h));
+
+    err = ikvdb_kvs_cursor_read(cur, 0, &key, &klen, &val, &vlen, &eof);
+    ASSERT_EQ(0, err);
+    ASSERT_FALSE(eof);
+    ASSERT_EQ(3, klen);
+    ASSERT_EQ(0, memcmp(key, "key", 3));
+    ASSERT_EQ(3, vlen);
+    ASSERT_EQ(0, memcmp(val, "old", 3));
+
+    err = ikvdb_kvs_cursor_read(cur, 0, &key, &klen, &val, &vlen, &eof);
+    ASSERT_EQ(0, err);
+    ASSERT_TRUE(eof);
+
+    /* Updating the view moves the cursor to the current view and lets
+     * go of the snapshot's.
+     */
+    err = ikvdb_kvs_cursor_update_view(cur, 0);
+    ASSERT_EQ(0, err);
+    ASSERT_GT(ikvdb_horizon(h), horizon);
+
+    err = ikvdb_kvs_cursor_seek(cur, 0, "key", 3, NULL, 0, NULL);
+    ASSERT_EQ(0, err);
+
+    err = ikvdb_kvs_cursor_read(cur, 0, &key, &klen, &val, &vlen, &eof);
+    ASSERT_EQ(0, err);
+    ASSERT_FALSE(eof);
+    ASSERT_EQ(0, memcmp(val, "new", 3));
+
+    err = ikvdb_kvs_cursor_read(cur, 0, &key, &klen, &val, &vlen, &eof);
+    ASSERT_EQ(0, err);
+    ASSERT_FALSE(eof);
+    ASSERT_EQ(4, klen);
+
+    err = ikvdb_kvs_cursor_destroy(cur);
+    ASSERT_EQ(0, err);
+
+    err = ikvdb_kvs_close(kvs_h);
+    ASSERT_EQ(0, err);
+
+    err = ikvdb_close(h);
+    ASSERT_EQ(0, err);
+}
+
+/* Snapshots the application never released are freed at close. */
+MTF_DEFINE_UTEST_PREPOST(ikvdb_test, snapshot_close, test_pre_c0, test_post_c0)
+{
+    struct ikvdb *h = NULL;
+    const char *mpool = __func__;
+    struct kvdb_rparams params = kvdb_rparams_defaults();
+    struct hse_kvdb_snapshot *snapv[3];
+    merr_t err;
+
+    err = ikvdb_open(mpool, &params, &h);
+    ASSERT_EQ(0, err);
+
+    for (int i = 0; i < NELEM(snapv); i++) {
+        err = ikvdb_snapshot_create(h, &snapv[i]);
+        ASSERT_EQ(0, err);
+    }
+
+    ikvdb_snapshot_release(h, snapv[1]);
+
+    err = ikvdb_close(h);
+    ASSERT_EQ(0, err);
+}
+
+MTF_DEFINE_UTEST_PREPOST(ikvdb_test, wal_replay_merge, test_pre_c0, test_post_c0)
+{
+    struct ikvdb *h = NULL;
+    struct hse_kvs *kvs_h = NULL;
+    struct ikvdb_kvs_hdl *ikvsh;
+    const char *mpool = __func__;
+    struct kvdb_rparams params = kvdb_rparams_defaults();
+    struct kvs_rparams kvs_rp = kvs_rparams_defaults();
+    struct kvs_cparams kvs_cp = kvs_cparams_defaults();
+    struct kvs_ktuple kt = { 0 };
+    struct kvs_vtuple vt = { 0 };
+    uint64_t cnid, val, opnd;
+    merr_t err;
+
+    err = ikvdb_open(mpool, &params, &h);
+    ASSERT_EQ(0, err);
+
+    err = ikvdb_kvs_create(h, "kvs", &kvs_cp);
+    ASSERT_EQ(0, err);
+
+    kvs_cp.merge_op = MERGE_OP_ADD_U64;
+    mapi_inject_ptr(mapi_idx_cn_get_cparams, &kvs_cp);
+    mapi_inject(mapi_idx_mpool_mclass_props_get, 0);
+
+    err = ikvdb_kvs_open(h, "kvs", &kvs_rp, 0, &kvs_h);
+    ASSERT_EQ(0, err);
+
+    cnid = kvdb_kvs_cnid((struct kvdb_kvs *)kvs_h);
+
+    err = ikvdb_kvs_close(kvs_h);
+    ASSERT_EQ(0, err);
+
+    err = ikvdb_wal_replay_open(h, &ikvsh);
+    ASSERT_EQ(0, err);
+
+    kvs_ktuple_init(&kt, "counter", 7);
+
+    val = 5;
+    kvs_vtuple_init(&vt, &val, sizeof(val));
+    err = ikvdb_wal_replay_put(h, ikvsh, cnid, 10, &kt, &vt);
+    ASSERT_EQ(0, err);
+
+    opnd = 3;
+    kvs_vtuple_minit(&vt, &opnd, sizeof(opnd));
+    err = ikvdb_wal_replay_merge(h, ikvsh, cnid, 11, &kt, &vt);
+    ASSERT_EQ(0, err);
+
+    opnd = 4;
+    err = ikvdb_wal_replay_merge(h, ikvsh, cnid, 12, &kt, &vt);
+    ASSERT_EQ(0, err);
+
+    /* A merge record must carry an operand. */
+    kvs_vtuple_init(&vt, &opnd, sizeof(opnd));
+    err = ikvdb_wal_replay_merge(h, ikvsh, cnid, 13, &kt, &vt);
+    ASSERT_EQ(EPROTO, merr_errno(err));
+
+    /* Records for a dropped kvs are skipped. */
+    kvs_vtuple_minit(&vt, &opnd, sizeof(opnd));
+    err = ikvdb_wal_replay_merge(h, ikvsh, cnid + 1000, 13, &kt, &vt);
+    ASSERT_EQ(0, err);
+
+    /* Closing the replay handles ingests c0, which must resolve each
+     * replayed operand at its own seqno (newest first).
+     */
+    ingested_valc = 0;
+    mapi_inject_unset(mapi_idx_kvset_builder_add_val);
+    MOCK_SET(kvset_builder, _kvset_builder_add_val);
+
+    ikvdb_wal_replay_close(h, ikvsh);
+
+    MOCK_UNSET(kvset_builder, _kvset_builder_add_val);
+    mapi_inject(mapi_idx_kvset_builder_add_val, 0);
+
+    ASSERT_EQ(3, ingested_valc);
+    ASSERT_EQ(12, ingested_valv[0]);
+    ASSERT_EQ(8, ingested_valv[1]);
+    ASSERT_EQ(5, ingested_valv[2]);
+
+    err = ikvdb_close(h);
+    ASSERT_EQ(0, err);
+}
+
 MTF_DEFINE_UTEST_PREPOST(ikvdb_test, kvdb_sync_test, test_pre, test_post)
 {
     struct ikvdb *h = NULL;
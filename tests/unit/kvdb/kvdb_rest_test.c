@@ -825,4 +825,80 @@ MTF_DEFINE_UTEST(kvdb_rest_test, perfc)
     ASSERT_EQ(0, merr_errno(err));
 }
 
+static merr_t
+check_waiters_cb(
+    const long status,
+    const char * const headers,
+    const size_t headers_len,
+    const char * const output,
+    const size_t output_len,
+    void * const arg)
+{
+    merr_t err = 0;
+    cJSON *body, *waiters;
+    const int *limit = arg;
+
+    if (status != REST_STATUS_OK)
+        return merr(EINVAL);
+
+    if (!strstr(headers, REST_MAKE_STATIC_HEADER(REST_HEADER_CONTENT_TYPE, REST_APPLICATION_JSON)))
+        return merr(EINVAL);
+
+    body = cJSON_ParseWithLength(output, output_len);
+    if (!body) {
+        if (cJSON_GetErrorPtr()) {
+            return merr(EPROTO);
+        } else {
+            return merr(ENOMEM);
+        }
+    }
+
+    if (!cJSON_IsObject(body) || !cJSON_IsObject(cJSON_GetObjectItem(body, "totals"))) {
+        err = merr(EINVAL);
+        goto out;
+    }
+
+    waiters = cJSON_GetObjectItem(body, "waiters");
+    if (!cJSON_IsArray(waiters) || cJSON_GetArraySize(waiters) > *limit) {
+        err = merr(EINVAL);
+        goto out;
+    }
+
+out:
+    cJSON_Delete(body);
+
+    return err;
+}
+
+MTF_DEFINE_UTEST(kvdb_rest_test, waiters)
+{
+    merr_t err;
+    int limit;
+    long status = REST_STATUS_BAD_REQUEST;
+    const char *alias = ikvdb_alias((struct ikvdb *)kvdb);
+
+    err = rest_client_fetch(
+        "GET", NULL, NULL, 0, check_status_cb, &status, "/kvdbs/%s/waiters?pretty=xyz", alias);
+    ASSERT_EQ(0, merr_errno(err));
+
+    err = rest_client_fetch(
+        "GET", NULL, NULL, 0, check_status_cb, &status, "/kvdbs/%s/waiters?reset=xyz", alias);
+    ASSERT_EQ(0, merr_errno(err));
+
+    err = rest_client_fetch(
+        "GET", NULL, NULL, 0, check_status_cb, &status, "/kvdbs/%s/waiters?limit=xyz", alias);
+    ASSERT_EQ(0, merr_errno(err));
+
+    limit = 10;
+    err = rest_client_fetch(
+        "GET", NULL, NULL, 0, check_waiters_cb, &limit, "/kvdbs/%s/waiters", alias);
+    ASSERT_EQ(0, merr_errno(err));
+
+    limit = 0;
+    err = rest_client_fetch(
+        "GET", NULL, NULL, 0, check_waiters_cb, &limit, "/kvdbs/%s/waiters?limit=0&reset=true",
+        alias);
+    ASSERT_EQ(0, merr_errno(err));
+}
+
 MTF_END_UTEST_COLLECTION(kvdb_rest_test)
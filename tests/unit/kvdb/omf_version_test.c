@@ -20,14 +20,15 @@ MTF_DEFINE_UTEST(omf_version_test, omf_version)
      */
 
     /* Global OMF version */
-    ASSERT_EQ(GLOBAL_OMF_VERSION, 4);
+    ASSERT_EQ(GLOBAL_OMF_VERSION, 6);
 
     /* Low-level OMF versions */
-    ASSERT_EQ(CNDB_VERSION, 1);
-    ASSERT_EQ(HBLOCK_HDR_VERSION, 1);
+    ASSERT_EQ(CNDB_VERSION, 2);
+    ASSERT_EQ(HBLOCK_HDR_VERSION, 2);
     ASSERT_EQ(KBLOCK_HDR_VERSION, 6);
     ASSERT_EQ(VBLOCK_FOOTER_VERSION, 1);
     ASSERT_EQ(BLOOM_OMF_VERSION, 5);
+    ASSERT_EQ(KVSET_SNAP_VERSION, 1);
     ASSERT_EQ(WBT_TREE_VERSION, 6);
     ASSERT_EQ(CN_TSTATE_VERSION, 2);
     ASSERT_EQ(MBLOCK_METAHDR_VERSION, 2);
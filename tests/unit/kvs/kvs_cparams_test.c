@@ -8,6 +8,7 @@
 #include <hse/config/params.h>
 #include <hse/ikvdb/kvs_cparams.h>
 #include <hse/ikvdb/limits.h>
+#include <hse/util/base.h>
 
 #include <hse/test/mtf/framework.h>
 
@@ -77,6 +78,52 @@ MTF_DEFINE_UTEST_PRE(kvs_cparams_test, kvs_ext01, test_pre)
     ASSERT_EQ(UINT32_MAX, ps->ps_bounds.as_uscalar.ps_max);
 }
 
+MTF_DEFINE_UTEST_PRE(kvs_cparams_test, value_merge_operator, test_pre)
+{
+    merr_t err;
+    char buf[128];
+    size_t needed_sz;
+    const struct param_spec *ps = ps_get("value.merge.operator");
+    const char *paramv[1];
+
+    ASSERT_NE(NULL, ps);
+    ASSERT_NE(NULL, ps->ps_description);
+    ASSERT_EQ(PARAM_EXPERIMENTAL, ps->ps_flags);
+    ASSERT_EQ(PARAM_TYPE_ENUM, ps->ps_type);
+    ASSERT_EQ(offsetof(struct kvs_cparams, merge_op), ps->ps_offset);
+    ASSERT_EQ(sizeof(enum merge_op), ps->ps_size);
+    ASSERT_NE((uintptr_t)ps->ps_convert, (uintptr_t)param_default_converter);
+    ASSERT_EQ((uintptr_t)ps->ps_validate, (uintptr_t)param_default_validator);
+    ASSERT_NE((uintptr_t)ps->ps_stringify, (uintptr_t)param_default_stringify);
+    ASSERT_NE((uintptr_t)ps->ps_jsonify, (uintptr_t)param_default_jsonify);
+    ASSERT_EQ(MERGE_OP_NONE, params.merge_op);
+    ASSERT_EQ(MERGE_OP_MIN, ps->ps_bounds.as_enum.ps_min);
+    ASSERT_EQ(MERGE_OP_MAX, ps->ps_bounds.as_enum.ps_max);
+
+    ps->ps_stringify(ps, &params.merge_op, buf, sizeof(buf), &needed_sz);
+    ASSERT_STREQ("\"none\"", buf);
+    ASSERT_EQ(6, needed_sz);
+
+    paramv[0] = "value.merge.operator=add_u64";
+    err = kvs_cparams_from_paramv(&params, NELEM(paramv), paramv);
+    ASSERT_EQ(0, merr_errno(err));
+    ASSERT_EQ(MERGE_OP_ADD_U64, params.merge_op);
+
+    paramv[0] = "value.merge.operator=append";
+    err = kvs_cparams_from_paramv(&params, NELEM(paramv), paramv);
+    ASSERT_EQ(0, merr_errno(err));
+    ASSERT_EQ(MERGE_OP_APPEND, params.merge_op);
+
+    paramv[0] = "value.merge.operator=none";
+    err = kvs_cparams_from_paramv(&params, NELEM(paramv), paramv);
+    ASSERT_EQ(0, merr_errno(err));
+    ASSERT_EQ(MERGE_OP_NONE, params.merge_op);
+
+    paramv[0] = "value.merge.operator=does-not-exist";
+    err = kvs_cparams_from_paramv(&params, NELEM(paramv), paramv);
+    ASSERT_NE(0, merr_errno(err));
+}
+
 MTF_DEFINE_UTEST(kvs_cparams_test, get)
 {
     merr_t err;
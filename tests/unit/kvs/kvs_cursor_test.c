@@ -8,16 +8,20 @@
 #include <hse/ikvdb/c0.h>
 #include <hse/ikvdb/kvs.h>
 #include <hse/ikvdb/lc.h>
+#include <hse/util/compression_lz4.h>
+#include <hse/util/page.h>
 #include <hse/util/seqno.h>
 
 #include <hse/test/mock/mock_c0cn.h>
 #include <hse/test/mtf/framework.h>
 
+#include "cn/cn_cursor.h"
 #include "kvdb/kvdb_kvs.h"
 
 static struct ikvs *kvs;
 static struct lc *lc;
 static struct kvdb_health mock_health;
+static bool zcopy;
 
 static int
 test_pre(struct mtf_test_info *lcl_ti)
@@ -27,11 +31,13 @@ test_pre(struct mtf_test_info *lcl_ti)
     struct kvs_rparams rp = kvs_rparams_defaults();
     struct kvdb_kvs kvdb_kvs;
 
+    rp.kvs_cursor_zcopy = zcopy;
+
     strlcpy(kvdb_kvs.kk_name, "dummy", sizeof(kvdb_kvs.kk_name));
 
     mock_c0cn_set();
 
-    err = lc_create(&lc, &mock_health);
+    err = lc_create(&lc, 0, &mock_health);
     ASSERT_EQ_RET(0, err, -1);
 
     lc_ingest_seqno_set(lc, 1);
@@ -223,4 +229,352 @@ MTF_DEFINE_UTEST_PREPOST(kvs_cursor_test, val_copy_null_val_out, test_pre, test_
     kvs_cursor_destroy(cur);
 }
 
+/* A fake vblock from which the mocked cn cursor serves its values, all
+ * uncompressed except for ZC_COMPRESSED.  The kvset pins taken by a
+ * zero-copy cursor are counted rather than backed by a real kvset.
+ */
+#define ZC_CNT        4
+#define ZC_VLEN       128
+#define ZC_COMPRESSED 2
+
+static char zc_vblock[PAGE_SIZE];
+static uint zc_voff[ZC_CNT];
+static uint zc_clen[ZC_CNT];
+static int zc_next;
+static int zc_pins;
+static int zc_unpins;
+
+static void
+zc_key(char *buf, size_t bufsz, int idx)
+{
+    snprintf(buf, bufsz, "zc-%02d", idx);
+}
+
+static merr_t
+_cn_cursor_read(struct cn_cursor *cursor, struct kvs_cursor_element *elem, bool *eof)
+{
+    static char keyv[ZC_CNT][8];
+
+    *eof = zc_next >= ZC_CNT;
+    if (*eof)
+        return 0;
+
+    memset(elem, 0, sizeof(*elem));
+    zc_key(keyv[zc_next], sizeof(keyv[0]), zc_next);
+    key2kobj(&elem->kce_kobj, keyv[zc_next], strlen(keyv[zc_next]));
+    kvs_vtuple_init(&elem->kce_vt, zc_vblock + zc_voff[zc_next], ZC_VLEN);
+    elem->kce_complen = zc_clen[zc_next];
+    ++zc_next;
+
+    return 0;
+}
+
+static merr_t
+_cn_cursor_seek(struct cn_cursor *cursor, const void *key, uint32_t len, struct kc_filter *filter)
+{
+    char buf[8];
+
+    for (zc_next = 0; zc_next < ZC_CNT; ++zc_next) {
+        zc_key(buf, sizeof(buf), zc_next);
+        if (keycmp(key, len, buf, strlen(buf)) <= 0)
+            break;
+    }
+
+    return 0;
+}
+
+static struct kvset *
+_cn_cursor_elem_pin(struct cn_cursor *cncur)
+{
+    ++zc_pins;
+
+    return (struct kvset *)zc_vblock;
+}
+
+static void
+_cn_cursor_elem_unpin(struct kvset *ks)
+{
+    if (ks) {
+        --zc_pins;
+        ++zc_unpins;
+    }
+}
+
+static int
+zcopy_pre(struct mtf_test_info *lcl_ti)
+{
+    char val[ZC_VLEN];
+    uint off = 0;
+    merr_t err;
+    int rc;
+
+    for (int i = 0; i < ZC_CNT; ++i) {
+        memset(val, 'a' + i, sizeof(val));
+        zc_voff[i] = off;
+        zc_clen[i] = 0;
+
+        if (i == ZC_COMPRESSED) {
+            err = compress_lz4_ops.cop_compress(
+                val, sizeof(val), zc_vblock + off, sizeof(zc_vblock) - off, &zc_clen[i]);
+            ASSERT_EQ_RET(0, err, -1);
+            off += zc_clen[i];
+        } else {
+            memcpy(zc_vblock + off, val, sizeof(val));
+            off += sizeof(val);
+        }
+    }
+
+    zc_next = 0;
+    zc_pins = 0;
+    zc_unpins = 0;
+
+    zcopy = true;
+    rc = test_pre(lcl_ti);
+    zcopy = false;
+
+    MOCK_SET(cn_cursor, _cn_cursor_read);
+    MOCK_SET(cn_cursor, _cn_cursor_seek);
+    MOCK_SET(cn_cursor, _cn_cursor_elem_pin);
+    MOCK_SET(cn_cursor, _cn_cursor_elem_unpin);
+
+    return rc;
+}
+
+static int
+zcopy_post(struct mtf_test_info *lcl_ti)
+{
+    MOCK_UNSET(cn_cursor, _cn_cursor_elem_unpin);
+    MOCK_UNSET(cn_cursor, _cn_cursor_elem_pin);
+    MOCK_UNSET(cn_cursor, _cn_cursor_seek);
+    MOCK_UNSET(cn_cursor, _cn_cursor_read);
+
+    return test_post(lcl_ti);
+}
+
+/* Read the next key and verify both it and its value.  Return true if
+ * the value was returned in place from the fake vblock.
+ */
+static bool
+zc_read(struct mtf_test_info *lcl_ti, struct hse_kvs_cursor *cur, int idx)
+{
+    const void *key, *val;
+    size_t key_len, vlen;
+    char buf[8], expect[ZC_VLEN];
+    merr_t err;
+    bool eof;
+
+    err = kvs_cursor_read(cur, 0, &eof);
+    ASSERT_EQ_RET(0, err, false);
+    ASSERT_FALSE_RET(eof, false);
+
+    zc_key(buf, sizeof(buf), idx);
+    kvs_cursor_key_copy(cur, NULL, 0, &key, &key_len);
+    ASSERT_EQ_RET(strlen(buf), key_len, false);
+    ASSERT_EQ_RET(0, memcmp(key, buf, key_len), false);
+
+    err = kvs_cursor_val_copy(cur, NULL, 0, &val, &vlen);
+    ASSERT_EQ_RET(0, err, false);
+    ASSERT_EQ_RET(ZC_VLEN, vlen, false);
+
+    memset(expect, 'a' + idx, sizeof(expect));
+    ASSERT_EQ_RET(0, memcmp(val, expect, vlen), false);
+
+    return val >= (void *)zc_vblock && val < (void *)zc_vblock + sizeof(zc_vblock);
+}
+
+MTF_DEFINE_UTEST_PREPOST(kvs_cursor_test, val_copy_zcopy, zcopy_pre, zcopy_post)
+{
+    struct hse_kvs_cursor *cur;
+    struct kvs_ktuple kt;
+    char buf[8];
+    merr_t err;
+    int unpins;
+
+    cur = kvs_cursor_alloc(kvs, NULL, 0, false);
+    ASSERT_NE(NULL, cur);
+
+    err = kvs_cursor_init(cur, NULL);
+    ASSERT_EQ(0, err);
+
+    /* Uncompressed values point into the vblock, and each read drops the
+     * pin on the previous element's kvset.
+     */
+    ASSERT_TRUE(zc_read(lcl_ti, cur, 0));
+    ASSERT_EQ(1, zc_pins);
+    unpins = zc_unpins;
+
+    ASSERT_TRUE(zc_read(lcl_ti, cur, 1));
+    ASSERT_EQ(1, zc_pins);
+    ASSERT_EQ(unpins + 1, zc_unpins);
+
+    /* Compressed values are decompressed into the cursor's buffer.
+     */
+    ASSERT_FALSE(zc_read(lcl_ti, cur, ZC_COMPRESSED));
+    ASSERT_EQ(1, zc_pins);
+    ASSERT_EQ(unpins + 2, zc_unpins);
+
+    /* A seek drops the pin before peeking at the key it lands on.
+     */
+    zc_key(buf, sizeof(buf), 1);
+    err = kvs_cursor_seek(cur, buf, strlen(buf), NULL, 0, &kt);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(unpins + 3, zc_unpins);
+
+    ASSERT_TRUE(zc_read(lcl_ti, cur, 1));
+    ASSERT_EQ(1, zc_pins);
+
+    kvs_cursor_destroy(cur);
+    ASSERT_EQ(0, zc_pins);
+}
+
+/* c0 holds a merge operand for the compressed cn key, whose value the
+ * cursor must apply the operand to without a point get.
+ */
+static struct element_source mo_es;
+static struct kvs_cursor_element mo_elem;
+static char mo_base[ZC_VLEN];
+static uint32_t mo_base_len;
+static int mo_next;
+static int mo_calls;
+
+static bool
+mo_es_next(struct element_source *es, void **element)
+{
+    static char key[8];
+
+    if (mo_next++ > 0)
+        return false;
+
+    memset(&mo_elem, 0, sizeof(mo_elem));
+    zc_key(key, sizeof(key), ZC_COMPRESSED);
+    key2kobj(&mo_elem.kce_kobj, key, strlen(key));
+    kvs_vtuple_init(&mo_elem.kce_vt, "+", 1);
+    mo_elem.kce_seqnoref = HSE_ORDNL_TO_SQNREF(2);
+    mo_elem.kce_source = KCE_SOURCE_C0;
+    mo_elem.kce_is_mopnd = true;
+
+    *element = &mo_elem;
+    return true;
+}
+
+static struct element_source *
+_c0_cursor_es_make(struct c0_cursor *c0cur)
+{
+    mo_es = es_make(mo_es_next, 0, 0);
+    return &mo_es;
+}
+
+static merr_t
+_c0_cursor_seek(struct c0_cursor *cur, const void *prefix, size_t pfx_len, struct kc_filter *filter)
+{
+    mo_next = 0;
+    return 0;
+}
+
+static merr_t
+_c0_get_merged_onto(
+    struct c0 *self,
+    struct kvs_ktuple *key,
+    uint64_t view_seqno,
+    const void *base,
+    uint32_t base_len,
+    enum key_lookup_res *res,
+    struct kvs_buf *vbuf)
+{
+    ++mo_calls;
+
+    mo_base_len = min_t(uint32_t, base_len, sizeof(mo_base));
+    memcpy(mo_base, base, mo_base_len);
+
+    /* Append the operand to the base, as MERGE_OP_APPEND would. */
+    memmove(vbuf->b_buf, base, base_len);
+    ((char *)vbuf->b_buf)[base_len] = '+';
+    vbuf->b_len = base_len + 1;
+
+    *res = FOUND_VAL;
+    return 0;
+}
+
+static int
+mopnd_pre(struct mtf_test_info *lcl_ti)
+{
+    int rc;
+
+    rc = zcopy_pre(lcl_ti);
+
+    mo_next = 0;
+    mo_calls = 0;
+    mo_base_len = 0;
+
+    MOCK_SET(c0, _c0_cursor_es_make);
+    MOCK_SET(c0, _c0_cursor_seek);
+    MOCK_SET(c0, _c0_get_merged_onto);
+
+    return rc;
+}
+
+static int
+mopnd_post(struct mtf_test_info *lcl_ti)
+{
+    MOCK_UNSET(c0, _c0_get_merged_onto);
+    MOCK_UNSET(c0, _c0_cursor_seek);
+    MOCK_UNSET(c0, _c0_cursor_es_make);
+
+    return zcopy_post(lcl_ti);
+}
+
+MTF_DEFINE_UTEST_PREPOST(kvs_cursor_test, val_merged_cursor_base, mopnd_pre, mopnd_post)
+{
+    struct hse_kvs_cursor *cur;
+    char buf[8], expect[ZC_VLEN + 1];
+    const void *key, *val;
+    size_t key_len, vlen;
+    merr_t err;
+    bool eof;
+
+    cur = kvs_cursor_alloc(kvs, NULL, 0, false);
+    ASSERT_NE(NULL, cur);
+
+    err = kvs_cursor_init(cur, NULL);
+    ASSERT_EQ(0, err);
+
+    ASSERT_TRUE(zc_read(lcl_ti, cur, 0));
+    ASSERT_TRUE(zc_read(lcl_ti, cur, 1));
+    ASSERT_EQ(0, mo_calls);
+
+    /* The operand is resolved once, against the decompressed cn value
+     * that the cursor's own cn source produced for the key.
+     */
+    err = kvs_cursor_read(cur, 0, &eof);
+    ASSERT_EQ(0, err);
+    ASSERT_FALSE(eof);
+    ASSERT_EQ(1, mo_calls);
+
+    zc_key(buf, sizeof(buf), ZC_COMPRESSED);
+    kvs_cursor_key_copy(cur, NULL, 0, &key, &key_len);
+    ASSERT_EQ(strlen(buf), key_len);
+    ASSERT_EQ(0, memcmp(key, buf, key_len));
+
+    memset(expect, 'a' + ZC_COMPRESSED, ZC_VLEN);
+    expect[ZC_VLEN] = '+';
+
+    ASSERT_EQ(ZC_VLEN, mo_base_len);
+    ASSERT_EQ(0, memcmp(mo_base, expect, mo_base_len));
+
+    err = kvs_cursor_val_copy(cur, NULL, 0, &val, &vlen);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(sizeof(expect), vlen);
+    ASSERT_EQ(0, memcmp(val, expect, vlen));
+
+    /* The cn element was consumed as the base, not returned on its own. */
+    ASSERT_TRUE(zc_read(lcl_ti, cur, 3));
+
+    err = kvs_cursor_read(cur, 0, &eof);
+    ASSERT_EQ(0, err);
+    ASSERT_TRUE(eof);
+    ASSERT_EQ(1, mo_calls);
+
+    kvs_cursor_destroy(cur);
+}
+
 MTF_END_UTEST_COLLECTION(kvs_cursor_test);
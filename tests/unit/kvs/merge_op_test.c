@@ -0,0 +1,102 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <hse/limits.h>
+
+#include <hse/ikvdb/merge_op.h>
+
+#include <hse/test/mtf/framework.h>
+
+MTF_BEGIN_UTEST_COLLECTION(merge_op_test)
+
+MTF_DEFINE_UTEST(merge_op_test, validate)
+{
+    uint64_t v = 1;
+    merr_t err;
+
+    err = merge_op_validate(MERGE_OP_NONE, &v, sizeof(v));
+    ASSERT_EQ(ENOTSUP, merr_errno(err));
+
+    err = merge_op_validate(MERGE_OP_ADD_U64, &v, sizeof(v));
+    ASSERT_EQ(0, err);
+
+    err = merge_op_validate(MERGE_OP_ADD_U64, &v, sizeof(v) - 1);
+    ASSERT_EQ(EINVAL, merr_errno(err));
+
+    err = merge_op_validate(MERGE_OP_ADD_U64, NULL, sizeof(v));
+    ASSERT_EQ(EINVAL, merr_errno(err));
+
+    err = merge_op_validate(MERGE_OP_APPEND, NULL, 0);
+    ASSERT_EQ(0, err);
+
+    err = merge_op_validate(MERGE_OP_APPEND, NULL, 1);
+    ASSERT_EQ(EINVAL, merr_errno(err));
+}
+
+MTF_DEFINE_UTEST(merge_op_test, add_u64)
+{
+    uint64_t acc = 0, opnd = 5;
+    uint32_t acc_len = 0;
+
+    /* No base value.
+     */
+    merge_op_apply(MERGE_OP_ADD_U64, &acc, sizeof(acc), &acc_len, &opnd, sizeof(opnd));
+    ASSERT_EQ(sizeof(acc), acc_len);
+    ASSERT_EQ(5, acc);
+
+    opnd = 7;
+    merge_op_apply(MERGE_OP_ADD_U64, &acc, sizeof(acc), &acc_len, &opnd, sizeof(opnd));
+    ASSERT_EQ(12, acc);
+
+    /* A base value of the wrong length counts as zero.
+     */
+    acc_len = 3;
+    merge_op_apply(MERGE_OP_ADD_U64, &acc, sizeof(acc), &acc_len, &opnd, sizeof(opnd));
+    ASSERT_EQ(sizeof(acc), acc_len);
+    ASSERT_EQ(7, acc);
+
+    ASSERT_EQ(sizeof(uint64_t), merge_op_result_len(MERGE_OP_ADD_U64, 100, 8));
+}
+
+MTF_DEFINE_UTEST(merge_op_test, append)
+{
+    char acc[8];
+    uint32_t acc_len = 0;
+
+    merge_op_apply(MERGE_OP_APPEND, acc, sizeof(acc), &acc_len, "abc", 3);
+    ASSERT_EQ(3, acc_len);
+    ASSERT_EQ(0, memcmp(acc, "abc", 3));
+
+    merge_op_apply(MERGE_OP_APPEND, acc, sizeof(acc), &acc_len, "defgh", 5);
+    ASSERT_EQ(8, acc_len);
+    ASSERT_EQ(0, memcmp(acc, "abcdefgh", 8));
+
+    /* Results are truncated to the accumulator capacity.
+     */
+    merge_op_apply(MERGE_OP_APPEND, acc, sizeof(acc), &acc_len, "xyz", 3);
+    ASSERT_EQ(8, acc_len);
+    ASSERT_EQ(0, memcmp(acc, "abcdefgh", 8));
+
+    ASSERT_EQ(10, merge_op_result_len(MERGE_OP_APPEND, 7, 3));
+    ASSERT_EQ(HSE_KVS_VALUE_LEN_MAX, merge_op_result_len(MERGE_OP_APPEND, HSE_KVS_VALUE_LEN_MAX, 3));
+}
+
+MTF_DEFINE_UTEST(merge_op_test, none)
+{
+    char acc[8];
+    uint32_t acc_len = 0;
+
+    merge_op_apply(MERGE_OP_NONE, acc, sizeof(acc), &acc_len, "abc", 3);
+    ASSERT_EQ(3, acc_len);
+
+    merge_op_apply(MERGE_OP_NONE, acc, sizeof(acc), &acc_len, "de", 2);
+    ASSERT_EQ(2, acc_len);
+    ASSERT_EQ(0, memcmp(acc, "de", 2));
+}
+
+MTF_END_UTEST_COLLECTION(merge_op_test)
@@ -0,0 +1,142 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <hse/ikvdb/rtomb.h>
+
+#include <hse/test/mtf/framework.h>
+
+static void
+rtomb_make(struct rtomb *rt, const char *start, const char *end, uint64_t seqno)
+{
+    rt->rt_start = start;
+    rt->rt_slen = strlen(start);
+    rt->rt_end = end;
+    rt->rt_elen = strlen(end);
+    rt->rt_seqno = seqno;
+}
+
+MTF_BEGIN_UTEST_COLLECTION(rtomb_test)
+
+MTF_DEFINE_UTEST(rtomb_test, covers)
+{
+    struct rtomb rt;
+
+    rtomb_make(&rt, "bb", "dd", 10);
+
+    ASSERT_FALSE(rtomb_covers(&rt, "b", 1));
+    ASSERT_TRUE(rtomb_covers(&rt, "bb", 2));
+    ASSERT_TRUE(rtomb_covers(&rt, "c", 1));
+    ASSERT_TRUE(rtomb_covers(&rt, "dc", 2));
+    ASSERT_FALSE(rtomb_covers(&rt, "dd", 2));
+    ASSERT_FALSE(rtomb_covers(&rt, "e", 1));
+}
+
+MTF_DEFINE_UTEST(rtomb_test, overlaps)
+{
+    struct rtomb rt;
+
+    rtomb_make(&rt, "bb", "dd", 10);
+
+    ASSERT_TRUE(rtomb_overlaps(&rt, NULL, 0, NULL, 0));
+    ASSERT_TRUE(rtomb_overlaps(&rt, NULL, 0, "bb", 2));
+    ASSERT_FALSE(rtomb_overlaps(&rt, NULL, 0, "b", 1));
+    ASSERT_TRUE(rtomb_overlaps(&rt, "dc", 2, NULL, 0));
+    ASSERT_FALSE(rtomb_overlaps(&rt, "dd", 2, NULL, 0));
+    ASSERT_TRUE(rtomb_overlaps(&rt, "a", 1, "z", 1));
+    ASSERT_TRUE(rtomb_overlaps(&rt, "c", 1, "cc", 2));
+    ASSERT_FALSE(rtomb_overlaps(&rt, "e", 1, "f", 1));
+}
+
+MTF_DEFINE_UTEST(rtomb_test, lookup)
+{
+    struct rtomb_vec rv;
+    struct rtomb rt;
+    merr_t err;
+
+    rtomb_vec_init(&rv);
+
+    ASSERT_EQ(0, rtomb_vec_lookup(&rv, "c", 1, UINT64_MAX));
+
+    rtomb_make(&rt, "m", "p", 30);
+    err = rtomb_vec_add(&rv, &rt);
+    ASSERT_EQ(0, err);
+
+    rtomb_make(&rt, "a", "n", 10);
+    err = rtomb_vec_add(&rv, &rt);
+    ASSERT_EQ(0, err);
+    ASSERT_FALSE(rv.rv_sorted);
+
+    rtomb_make(&rt, "c", "e", 20);
+    err = rtomb_vec_add(&rv, &rt);
+    ASSERT_EQ(0, err);
+
+    rtomb_vec_sort(&rv);
+    ASSERT_TRUE(rv.rv_sorted);
+    ASSERT_EQ(3, rv.rv_cnt);
+
+    for (uint32_t i = 1; i < rv.rv_cnt; i++)
+        ASSERT_LE(keycmp(rv.rv_rtv[i - 1].rt_start, rv.rv_rtv[i - 1].rt_slen,
+                         rv.rv_rtv[i].rt_start, rv.rv_rtv[i].rt_slen), 0);
+
+    /* Newest covering rtomb wins.
+     */
+    ASSERT_EQ(10, rtomb_vec_lookup(&rv, "b", 1, UINT64_MAX));
+    ASSERT_EQ(20, rtomb_vec_lookup(&rv, "d", 1, UINT64_MAX));
+    ASSERT_EQ(30, rtomb_vec_lookup(&rv, "mm", 2, UINT64_MAX));
+    ASSERT_EQ(30, rtomb_vec_lookup(&rv, "o", 1, UINT64_MAX));
+
+    /* The end key is exclusive.
+     */
+    ASSERT_EQ(10, rtomb_vec_lookup(&rv, "e", 1, UINT64_MAX));
+    ASSERT_EQ(0, rtomb_vec_lookup(&rv, "p", 1, UINT64_MAX));
+    ASSERT_EQ(0, rtomb_vec_lookup(&rv, "", 0, UINT64_MAX));
+
+    /* Rtombs newer than the view are invisible.
+     */
+    ASSERT_EQ(10, rtomb_vec_lookup(&rv, "d", 1, 19));
+    ASSERT_EQ(10, rtomb_vec_lookup(&rv, "mm", 2, 29));
+    ASSERT_EQ(0, rtomb_vec_lookup(&rv, "o", 1, 29));
+    ASSERT_EQ(0, rtomb_vec_lookup(&rv, "b", 1, 9));
+
+    rtomb_vec_reset(&rv);
+    ASSERT_EQ(0, rv.rv_cnt);
+    ASSERT_EQ(0, rtomb_vec_lookup(&rv, "b", 1, UINT64_MAX));
+
+    rtomb_vec_fini(&rv);
+    ASSERT_EQ(NULL, rv.rv_rtv);
+}
+
+MTF_DEFINE_UTEST(rtomb_test, grow)
+{
+    static char keyv[64][4];
+    struct rtomb_vec rv;
+    struct rtomb rt;
+    merr_t err;
+
+    rtomb_vec_init(&rv);
+
+    for (int i = 0; i < 64; i++) {
+        snprintf(keyv[i], sizeof(keyv[i]), "%03d", i);
+        rtomb_make(&rt, keyv[i], "zzz", i + 1);
+
+        err = rtomb_vec_add(&rv, &rt);
+        ASSERT_EQ(0, err);
+    }
+
+    ASSERT_EQ(64, rv.rv_cnt);
+    ASSERT_GE(rv.rv_max, rv.rv_cnt);
+    ASSERT_TRUE(rv.rv_sorted);
+
+    ASSERT_EQ(64, rtomb_vec_lookup(&rv, "999", 3, UINT64_MAX));
+    ASSERT_EQ(11, rtomb_vec_lookup(&rv, "010", 3, UINT64_MAX));
+
+    rtomb_vec_fini(&rv);
+}
+
+MTF_END_UTEST_COLLECTION(rtomb_test)
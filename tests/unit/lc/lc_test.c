@@ -4,10 +4,12 @@
  */
 
 #include <stdint.h>
+#include <unistd.h>
 
 #include <hse/ikvdb/cursor.h>
 #include <hse/ikvdb/kvdb_health.h>
 #include <hse/ikvdb/lc.h>
+#include <hse/ikvdb/query_ctx.h>
 #include <hse/ikvdb/tuple.h>
 #include <hse/util/bonsai_tree.h>
 #include <hse/util/keycmp.h>
@@ -36,7 +38,7 @@ test_pre(struct mtf_test_info *lcl_ti)
 {
     merr_t err;
 
-    err = lc_create(&lc, &mock_health);
+    err = lc_create(&lc, 0, &mock_health);
     ASSERT_EQ_RET(0, err, -1);
 
     lc_ingest_seqno_set(lc, 0);
@@ -166,6 +168,45 @@ MTF_DEFINE_UTEST_PREPOST(lc_test, put_get_basic, test_pre, test_post)
     ASSERT_EQ(FOUND_VAL, res);
 }
 
+MTF_DEFINE_UTEST_PREPOST(lc_test, get_other_kvs, test_pre, test_post)
+{
+    merr_t err;
+    char *key = "ab1";
+    struct kvs_buf vbuf, kbuf;
+    enum key_lookup_res res;
+    struct query_ctx qctx = { 0 };
+    unsigned char valbuf[32], keybuf[32];
+
+    struct kv_elem elem[] = {
+        { 1, key, { SO(10, "ab1-val") } },
+        { 1, "ab", { SO(5, HSE_CORE_TOMB_PFX) } },
+    };
+
+    struct kvs_ktuple kt = {
+        .kt_data = key,
+        .kt_len = strlen(key),
+    };
+
+    insert_keys(lcl_ti, NELEM(elem), elem);
+
+    /* Only the kvs that owns the keys finds them, other kvses skip LC altogether.
+     */
+    kvs_buf_init(&vbuf, valbuf, sizeof(valbuf));
+    err = lc_get(lc, 1, 2, &kt, 100, 0, &res, &vbuf);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(FOUND_VAL, res);
+
+    err = lc_get(lc, 2, 2, &kt, 100, 0, &res, &vbuf);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(NOT_FOUND, res);
+
+    kvs_buf_init(&kbuf, keybuf, sizeof(keybuf));
+    err = lc_pfx_probe(lc, &kt, 2, 100, 0, 2, &res, &qctx, &kbuf, &vbuf);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(NOT_FOUND, res);
+    ASSERT_EQ(0, qctx.seen);
+}
+
 MTF_DEFINE_UTEST_PREPOST(lc_test, put_get_multiple_vals, test_pre, test_post)
 {
     merr_t err;
@@ -638,4 +679,54 @@ MTF_DEFINE_UTEST_PREPOST(lc_test, cursor_horizon, test_pre, test_post)
     lc_cursor_destroy(cur);
 }
 
+MTF_DEFINE_UTEST(lc_test, mem_bound)
+{
+    struct kv_elem elem[] = {
+        { 0, "ab1", { SO(10, "ab1-val1"), SO(11, "ab1-val2") } },
+        { 0, "ab2", { SO(12, "ab2-val") } },
+        { 1, "ab3", { SO(13, "ab3-val") } },
+    };
+    size_t used;
+    merr_t err;
+    int i;
+
+    err = lc_create(&lc, 1, &mock_health);
+    ASSERT_EQ(0, err);
+
+    lc_ingest_seqno_set(lc, 0);
+    ASSERT_EQ(0, lc_mem_used(lc));
+    ASSERT_FALSE(lc_mem_exceeded(lc));
+
+    insert_keys(lcl_ti, NELEM(elem), elem);
+
+    used = lc_mem_used(lc);
+    ASSERT_LT(strlen("ab1ab2ab3ab1-val1ab1-val2ab2-valab3-val"), used);
+    ASSERT_TRUE(lc_mem_exceeded(lc));
+
+    /* Moving the horizon past every value kicks GC without waiting for its interval.
+     */
+    lc_ingest_seqno_set(lc, 20);
+
+    for (i = 0; i < 500 && lc_mem_used(lc) > 0; i++)
+        usleep(10 * 1000);
+
+    ASSERT_EQ(0, lc_mem_used(lc));
+    ASSERT_FALSE(lc_mem_exceeded(lc));
+
+    lc_destroy(lc);
+    lc = NULL;
+
+    /* A zero bound never reports LC as full. */
+    err = lc_create(&lc, 0, &mock_health);
+    ASSERT_EQ(0, err);
+
+    lc_ingest_seqno_set(lc, 0);
+    insert_keys(lcl_ti, NELEM(elem), elem);
+    ASSERT_EQ(used, lc_mem_used(lc));
+    ASSERT_FALSE(lc_mem_exceeded(lc));
+
+    lc_destroy(lc);
+    lc = NULL;
+}
+
 MTF_END_UTEST_COLLECTION(lc_test)
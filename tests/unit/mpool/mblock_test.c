@@ -8,6 +8,7 @@
 #include <limits.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include <bsd/string.h>
 #include <sys/stat.h>
@@ -15,6 +16,7 @@
 #include <hse/error/merr.h>
 #include <hse/ikvdb/omf_version.h>
 #include <hse/mpool/mpool.h>
+#include <hse/util/base.h>
 #include <hse/util/minmax.h>
 #include <hse/util/page.h>
 
@@ -26,6 +28,7 @@
 #include "mblock_file.h"
 #include "mblock_fset.h"
 #include "mpool_internal.h"
+#include "mpool_sys.h"
 
 MTF_BEGIN_UTEST_COLLECTION_PRE(mblock_test, mpool_collection_pre)
 
@@ -851,6 +854,138 @@ MTF_DEFINE_UTEST_PREPOST(mblock_test, mblock_clone, mpool_test_pre, mpool_test_p
     free(wbuf);
 }
 
+static int copy_calls;
+
+/* Copies half the range then fails as copy_file_range() does across
+ * file systems.
+ */
+static merr_t
+_mpool_sys_copy_file_range(
+    int src_fd,
+    off_t *src_off,
+    int tgt_fd,
+    off_t *tgt_off,
+    size_t len,
+    size_t *copied)
+{
+    ssize_t cc;
+
+    if (copy_calls++ > 0)
+        return merr(EXDEV);
+
+    cc = copy_file_range(src_fd, src_off, tgt_fd, tgt_off, len / 2, 0);
+    if (cc == -1)
+        return merr(errno);
+
+    *copied = cc;
+
+    return 0;
+}
+
+MTF_DEFINE_UTEST_PREPOST(mblock_test, mblock_copy, mpool_test_pre, mpool_test_post)
+{
+    struct mpool *mp;
+    struct mblock_props props = { 0 };
+    uint64_t mbid, tgt_mbid;
+    size_t bufsz = 4 * MB;
+    char *wbuf, *rbuf;
+    merr_t err;
+    int rc;
+
+    err = mpool_create(mtf_kvdb_home, &tcparams);
+    ASSERT_EQ(0, err);
+
+    err = mpool_open(mtf_kvdb_home, &trparams, O_RDWR, &mp);
+    ASSERT_EQ(0, err);
+
+    rc = posix_memalign((void **)&wbuf, PAGE_SIZE, bufsz * 2);
+    ASSERT_EQ(0, rc);
+    rbuf = wbuf + bufsz;
+
+    randomize_buffer(wbuf, bufsz, 173);
+
+    err = mpool_mblock_alloc(mp, HSE_MCLASS_CAPACITY, 0, &mbid, NULL);
+    ASSERT_EQ(0, err);
+
+    err = mblock_rw(mp, mbid, wbuf, bufsz, 0, true);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mblock_commit(mp, mbid);
+    ASSERT_EQ(0, err);
+
+    /* copy_file_range() */
+    err = mpool_mblock_copy(mp, mbid, HSE_MCLASS_CAPACITY, &tgt_mbid);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mblock_commit(mp, tgt_mbid);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mblock_props_get(mp, tgt_mbid, &props);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(bufsz, props.mpr_write_len);
+
+    memset(rbuf, 0, bufsz);
+    err = mblock_rw(mp, tgt_mbid, rbuf, bufsz, 0, false);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(0, memcmp(wbuf, rbuf, bufsz));
+
+    err = mpool_mblock_delete(mp, tgt_mbid);
+    ASSERT_EQ(0, err);
+
+    /* Kernels that refuse the copy fall back to a bounce-buffer copy. */
+    for (int i = 0; i < 3; i++) {
+        const int errv[] = { EXDEV, EOPNOTSUPP, EINVAL };
+
+        mapi_inject(mapi_idx_mpool_sys_copy_file_range, merr(errv[i]));
+
+        err = mpool_mblock_copy(mp, mbid, HSE_MCLASS_CAPACITY, &tgt_mbid);
+        ASSERT_EQ(0, err);
+
+        mapi_inject_unset(mapi_idx_mpool_sys_copy_file_range);
+
+        err = mpool_mblock_commit(mp, tgt_mbid);
+        ASSERT_EQ(0, err);
+
+        memset(rbuf, 0, bufsz);
+        err = mblock_rw(mp, tgt_mbid, rbuf, bufsz, 0, false);
+        ASSERT_EQ(0, err);
+        ASSERT_EQ(0, memcmp(wbuf, rbuf, bufsz));
+
+        err = mpool_mblock_delete(mp, tgt_mbid);
+        ASSERT_EQ(0, err);
+    }
+
+    /* Other errors fail the copy. */
+    mapi_inject(mapi_idx_mpool_sys_copy_file_range, merr(EIO));
+
+    tgt_mbid = 0;
+    err = mpool_mblock_copy(mp, mbid, HSE_MCLASS_CAPACITY, &tgt_mbid);
+    ASSERT_EQ(EIO, merr_errno(err));
+    ASSERT_EQ(0, tgt_mbid);
+
+    mapi_inject_unset(mapi_idx_mpool_sys_copy_file_range);
+
+    /* Once part of the range has been copied there is no fallback. */
+    copy_calls = 0;
+    MOCK_SET(mpool_sys, _mpool_sys_copy_file_range);
+
+    err = mpool_mblock_copy(mp, mbid, HSE_MCLASS_CAPACITY, &tgt_mbid);
+    ASSERT_EQ(EXDEV, merr_errno(err));
+    ASSERT_EQ(2, copy_calls);
+
+    MOCK_UNSET(mpool_sys, _mpool_sys_copy_file_range);
+
+    err = mpool_mblock_delete(mp, mbid);
+    ASSERT_EQ(0, err);
+
+    free(wbuf);
+
+    err = mpool_close(mp);
+    ASSERT_EQ(0, err);
+
+    mpool_destroy(mtf_kvdb_home, &tdparams);
+}
+
 MTF_DEFINE_UTEST_PREPOST(mblock_test, mblock_punch_test, mpool_test_pre, mpool_test_post)
 {
     struct mblock_props props = { 0 };
@@ -1059,4 +1194,319 @@ MTF_DEFINE_UTEST_PREPOST(mblock_test, mblock_punch_test, mpool_test_pre, mpool_t
     free(wbuf);
 }
 
+MTF_DEFINE_UTEST_PREPOST(mblock_test, mblock_blkdev, mpool_test_pre, mpool_test_post)
+{
+    struct mpool *mp;
+    char path[PATH_MAX];
+    merr_t err;
+    int fd, rc;
+
+    /* A data file link which does not refer to a block device is rejected. */
+    snprintf(
+        path, sizeof(path), "%s/%s-%d-%d", capacity_path, MBLOCK_BLKDEV_PFX, MCID_CAPACITY, 1);
+    fd = open(path, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+    ASSERT_GE(fd, 0);
+    close(fd);
+
+    err = mpool_create(mtf_kvdb_home, &tcparams);
+    ASSERT_EQ(ENOTBLK, merr_errno(err));
+
+    /* The link is left in place as it is owned by the user. */
+    rc = access(path, F_OK);
+    ASSERT_EQ(0, rc);
+
+    rc = unlink(path);
+    ASSERT_EQ(0, rc);
+
+    err = mpool_create(mtf_kvdb_home, &tcparams);
+    ASSERT_EQ(0, err);
+
+    err = mpool_open(mtf_kvdb_home, &trparams, O_RDWR, &mp);
+    ASSERT_EQ(0, err);
+
+    err = mpool_close(mp);
+    ASSERT_EQ(0, err);
+
+    mpool_destroy(mtf_kvdb_home, &tdparams);
+}
+
+static merr_t blkdev_size_err;
+static uint64_t blkdev_size;
+
+static merr_t
+_mpool_sys_blkdev_size(int fd, uint64_t *size)
+{
+    *size = blkdev_size;
+
+    return blkdev_size_err;
+}
+
+static merr_t blkdev_discard_err;
+static int blkdev_discard_calls;
+static off_t blkdev_discard_off;
+static size_t blkdev_discard_len;
+
+static merr_t
+_mpool_sys_blkdev_discard(int fd, off_t off, size_t len)
+{
+    blkdev_discard_calls++;
+    blkdev_discard_off = off;
+    blkdev_discard_len = len;
+
+    return blkdev_discard_err;
+}
+
+/* Allocated but unwritten capacity bytes, in which the metadata file's
+ * usage, counted as both, cancels out.
+ */
+static uint64_t
+capacity_slack(struct mpool *mp)
+{
+    struct mpool_info info;
+    merr_t err;
+
+    err = mpool_info_get(mp, &info);
+    if (err)
+        return UINT64_MAX;
+
+    return info.mclass[HSE_MCLASS_CAPACITY].mi_allocated_bytes -
+        info.mclass[HSE_MCLASS_CAPACITY].mi_used_bytes;
+}
+
+MTF_DEFINE_UTEST_PREPOST(mblock_test, mblock_blkdev_mocked, mpool_test_pre, mpool_test_post)
+{
+    const size_t mblocksz = MPOOL_MBLOCK_SIZE_DEFAULT;
+    const uint64_t fszmax = MPOOL_MCLASS_FILESZ_DEFAULT;
+    struct mblock_props props;
+    struct mpool *mp;
+    char path[PATH_MAX];
+    uint64_t mbid, base;
+    size_t bufsz = 4 * PAGE_SIZE;
+    char *buf;
+    merr_t err;
+    int fd, rc;
+
+    /* A regular file stands in for the device, whose type and size are mocked.
+     */
+    setup_mclass_with_params(HSE_MCLASS_CAPACITY, 1, mblocksz, fszmax);
+
+    snprintf(
+        path, sizeof(path), "%s/%s-%d-%d", capacity_path, MBLOCK_BLKDEV_PFX, MCID_CAPACITY, 1);
+    fd = open(path, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+    ASSERT_GE(fd, 0);
+    close(fd);
+
+    MOCK_SET(mpool_sys, _mpool_sys_blkdev_size);
+    MOCK_SET(mpool_sys, _mpool_sys_blkdev_discard);
+
+    blkdev_size_err = 0;
+    blkdev_size = fszmax - 1;
+    err = mpool_create(mtf_kvdb_home, &tcparams);
+    ASSERT_EQ(ENOSPC, merr_errno(err));
+
+    blkdev_size_err = merr(ENOTBLK);
+    err = mpool_create(mtf_kvdb_home, &tcparams);
+    ASSERT_EQ(ENOTBLK, merr_errno(err));
+
+    blkdev_size_err = 0;
+    blkdev_size = fszmax;
+    err = mpool_create(mtf_kvdb_home, &tcparams);
+    ASSERT_EQ(0, err);
+
+    err = mpool_open(mtf_kvdb_home, &trparams, O_RDWR, &mp);
+    ASSERT_EQ(0, err);
+
+    rc = posix_memalign((void **)&buf, PAGE_SIZE, bufsz);
+    ASSERT_EQ(0, rc);
+    randomize_buffer(buf, bufsz, 41);
+
+    /* Every block of a device is allocated, so the space in use is the
+     * number of mblocks times their size rather than the file's st_blocks.
+     */
+    ASSERT_EQ(0, capacity_slack(mp));
+
+    /* Preallocation needs no fallocate() on a device. */
+    err = mpool_mblock_alloc(mp, HSE_MCLASS_CAPACITY, MPOOL_MBLOCK_PREALLOC, &mbid, &props);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(mblocksz, props.mpr_alloc_cap);
+
+    base = (mbid & MBID_BLOCK_MASK) * mblocksz;
+
+    ASSERT_EQ(mblocksz, capacity_slack(mp));
+
+    err = mblock_rw(mp, mbid, buf, bufsz, 0, true);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mblock_commit(mp, mbid);
+    ASSERT_EQ(0, err);
+
+    ASSERT_EQ(mblocksz - bufsz, capacity_slack(mp));
+
+    /* A punch is a discard of the same range of the device. */
+    blkdev_discard_calls = 0;
+    err = mpool_mblock_punch(mp, mbid, 0, PAGE_SIZE);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(1, blkdev_discard_calls);
+    ASSERT_EQ(base, blkdev_discard_off);
+    ASSERT_EQ(PAGE_SIZE, blkdev_discard_len);
+
+    /* Discarded ranges stay allocated. */
+    err = mpool_mblock_props_get(mp, mbid, &props);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(bufsz, props.mpr_write_len);
+    ASSERT_EQ(mblocksz, props.mpr_alloc_cap);
+
+    /* Devices which do not support discard are fine... */
+    blkdev_discard_err = merr(EOPNOTSUPP);
+    err = mpool_mblock_punch(mp, mbid, PAGE_SIZE, PAGE_SIZE);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(2, blkdev_discard_calls);
+    ASSERT_EQ(base + PAGE_SIZE, blkdev_discard_off);
+
+    /* ...but other errors fail the punch. */
+    blkdev_discard_err = merr(EIO);
+    err = mpool_mblock_punch(mp, mbid, 2 * PAGE_SIZE, PAGE_SIZE);
+    ASSERT_EQ(EIO, merr_errno(err));
+    ASSERT_EQ(3, blkdev_discard_calls);
+
+    /* A delete discards the whole mblock, and ignores a failure to do so. */
+    err = mpool_mblock_delete(mp, mbid);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(4, blkdev_discard_calls);
+    ASSERT_EQ(base, blkdev_discard_off);
+    ASSERT_EQ(mblocksz, blkdev_discard_len);
+
+    ASSERT_EQ(0, capacity_slack(mp));
+
+    blkdev_discard_err = 0;
+
+    /* A punch hole allocation discards the whole mblock up front. */
+    err = mpool_mblock_alloc(mp, HSE_MCLASS_CAPACITY, MPOOL_MBLOCK_PUNCH_HOLE, &mbid, &props);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(5, blkdev_discard_calls);
+    ASSERT_EQ((mbid & MBID_BLOCK_MASK) * mblocksz, blkdev_discard_off);
+    ASSERT_EQ(mblocksz, blkdev_discard_len);
+
+    err = mpool_mblock_delete(mp, mbid);
+    ASSERT_EQ(0, err);
+
+    free(buf);
+
+    err = mpool_close(mp);
+    ASSERT_EQ(0, err);
+
+    MOCK_UNSET(mpool_sys, _mpool_sys_blkdev_discard);
+    MOCK_UNSET(mpool_sys, _mpool_sys_blkdev_size);
+
+    mpool_destroy(mtf_kvdb_home, &tdparams);
+
+    /* The link is owned by the user. */
+    rc = unlink(path);
+    ASSERT_EQ(0, rc);
+}
+
+/* Number of mblocks in a minimum size file of maximum size mblocks. */
+#define RGNMAP_KEYMAX ((MPOOL_MCLASS_FILESZ_MIN) / MPOOL_MBLOCK_SIZE_MAX)
+
+MTF_DEFINE_UTEST_PREPOST(mblock_test, mblock_rgnmap, mpool_test_pre, mpool_test_post)
+{
+    const uint32_t keymax = RGNMAP_KEYMAX;
+    uint64_t mbidv[RGNMAP_KEYMAX], mbid, past[] = { keymax, keymax + 1, MBID_BLOCK_MASK };
+    enum { LIVE, DELETED, UNCOMMITTED } statev[RGNMAP_KEYMAX];
+    struct mblock_props props;
+    struct mpool *mp;
+    uint32_t allocc;
+    merr_t err;
+
+    /* A single small file so that its keys can be exhausted.
+     */
+    setup_mclass_with_params(
+        HSE_MCLASS_CAPACITY, 1, MPOOL_MBLOCK_SIZE_MAX, MPOOL_MCLASS_FILESZ_MIN);
+
+    err = mpool_create(mtf_kvdb_home, &tcparams);
+    ASSERT_EQ(0, err);
+
+    err = mpool_open(mtf_kvdb_home, &trparams, O_RDWR, &mp);
+    ASSERT_EQ(0, err);
+
+    for (uint32_t i = 0; i < keymax; i++) {
+        err = mpool_mblock_alloc(mp, HSE_MCLASS_CAPACITY, 0, &mbidv[i], NULL);
+        ASSERT_EQ(0, err);
+        ASSERT_EQ(i, mbidv[i] & MBID_BLOCK_MASK);
+    }
+
+    err = mpool_mblock_alloc(mp, HSE_MCLASS_CAPACITY, 0, &mbid, NULL);
+    ASSERT_EQ(ENOSPC, merr_errno(err));
+
+    for (uint32_t i = 0; i < keymax; i++) {
+        statev[i] = i % 3;
+
+        if (statev[i] != UNCOMMITTED) {
+            err = mpool_mblock_commit(mp, mbidv[i]);
+            ASSERT_EQ(0, err);
+        }
+
+        if (statev[i] == DELETED) {
+            err = mpool_mblock_delete(mp, mbidv[i]);
+            ASSERT_EQ(0, err);
+        }
+    }
+
+    /* Lookups agree with what was allocated and freed.
+     */
+    for (uint32_t i = 0; i < keymax; i++) {
+        err = mpool_mblock_props_get(mp, mbidv[i], &props);
+        ASSERT_EQ(statev[i] == DELETED ? ENOENT : 0, merr_errno(err));
+    }
+
+    /* Keys past the end of the file are never allocated.
+     */
+    for (uint32_t i = 0; i < NELEM(past); i++) {
+        mbid = (mbidv[0] & ~MBID_BLOCK_MASK) | past[i];
+
+        err = mpool_mblock_props_get(mp, mbid, &props);
+        ASSERT_EQ(ENOENT, merr_errno(err));
+
+        err = mpool_mblock_commit(mp, mbid);
+        ASSERT_EQ(ENOENT, merr_errno(err));
+
+        err = mpool_mblock_delete(mp, mbid);
+        ASSERT_EQ(ENOENT, merr_errno(err));
+    }
+
+    err = mpool_close(mp);
+    ASSERT_EQ(0, err);
+
+    /* After a reload only the committed mblocks remain.
+     */
+    err = mpool_open(mtf_kvdb_home, &trparams, O_RDWR, &mp);
+    ASSERT_EQ(0, err);
+
+    for (uint32_t i = 0; i < keymax; i++) {
+        err = mpool_mblock_props_get(mp, mbidv[i], &props);
+        ASSERT_EQ(statev[i] == LIVE ? 0 : ENOENT, merr_errno(err));
+    }
+
+    /* And every other key can be allocated again, without disturbing them.
+     */
+    allocc = 0;
+    while (!(err = mpool_mblock_alloc(mp, HSE_MCLASS_CAPACITY, 0, &mbid, NULL))) {
+        uint32_t block = mbid & MBID_BLOCK_MASK;
+
+        ASSERT_LT(block, keymax);
+        ASSERT_NE(LIVE, statev[block]);
+        ++allocc;
+    }
+    ASSERT_EQ(ENOSPC, merr_errno(err));
+
+    for (uint32_t i = 0; i < keymax; i++)
+        allocc += (statev[i] == LIVE);
+    ASSERT_EQ(keymax, allocc);
+
+    err = mpool_close(mp);
+    ASSERT_EQ(0, err);
+
+    mpool_destroy(mtf_kvdb_home, &tdparams);
+}
+
 MTF_END_UTEST_COLLECTION(mblock_test);
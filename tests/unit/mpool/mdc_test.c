@@ -4,10 +4,12 @@
  */
 
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdint.h>
 
 #include <hse/error/merr.h>
 #include <hse/mpool/mpool.h>
+#include <hse/util/base.h>
 #include <hse/util/minmax.h>
 
 #include <hse/test/mock/api.h>
@@ -17,6 +19,7 @@
 #include "common.h"
 #include "mdc.h"
 #include "mdc_file.h"
+#include "mpool_internal.h"
 
 #define MDC_TEST_CAP   (1 << 20)
 #define MDC_TEST_MAGIC (0xabbaabba)
@@ -649,4 +652,382 @@ MTF_DEFINE_UTEST_PREPOST(mdc_test, mdc_io_reopen, mpool_test_pre, mpool_test_pos
     free(buf);
     free(rdbuf);
 }
+
+MTF_DEFINE_UTEST_PREPOST(mdc_test, mdc_io_async, mpool_test_pre, mpool_test_post)
+{
+    struct mpool *mp;
+    struct mpool_mdc *mdc;
+    uint64_t logid1, logid2, gen[4];
+    char rdbuf[32];
+    size_t rdlen;
+    merr_t err;
+
+    err = mpool_create(mtf_kvdb_home, &tcparams);
+    ASSERT_EQ(0, err);
+
+    err = mpool_open(mtf_kvdb_home, &trparams, O_RDWR, &mp);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_alloc(mp, MDC_TEST_MAGIC, MDC_TEST_CAP, HSE_MCLASS_CAPACITY, &logid1, &logid2);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_commit(mp, logid1, logid2);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_open(mp, logid1, logid2, false, &mdc);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_append_async(mdc, "async", 5, NULL);
+    ASSERT_EQ(EINVAL, merr_errno(err));
+
+    err = mpool_mdc_sync_wait(NULL, 1);
+    ASSERT_EQ(EINVAL, merr_errno(err));
+
+    for (int i = 0; i < NELEM(gen); i++) {
+        err = mpool_mdc_append_async(mdc, "async", 5, &gen[i]);
+        ASSERT_EQ(0, err);
+        ASSERT_GT(gen[i], i ? gen[i - 1] : 0);
+    }
+
+    /* The first wait syncs all four records, the rest find them durable. */
+    for (int i = NELEM(gen) - 1; i >= 0; i--) {
+        err = mpool_mdc_sync_wait(mdc, gen[i]);
+        ASSERT_EQ(0, err);
+    }
+
+    err = mpool_mdc_close(mdc);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_open(mp, logid1, logid2, false, &mdc);
+    ASSERT_EQ(0, err);
+
+    for (int i = 0; i < NELEM(gen); i++) {
+        err = mpool_mdc_read(mdc, rdbuf, sizeof(rdbuf), &rdlen);
+        ASSERT_EQ(0, err);
+        ASSERT_EQ(5, rdlen);
+        ASSERT_EQ(0, memcmp(rdbuf, "async", rdlen));
+    }
+
+    err = mpool_mdc_close(mdc);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_delete(mp, logid1, logid2);
+    ASSERT_EQ(0, err);
+
+    err = mpool_close(mp);
+    ASSERT_EQ(0, err);
+
+    mpool_destroy(mtf_kvdb_home, &tdparams);
+}
+
+#define ASYNC_THREADS (4)
+#define ASYNC_RECORDS (64)
+
+struct async_arg {
+    struct mpool_mdc *mdc;
+    merr_t err;
+};
+
+static void *
+async_main(void *arg)
+{
+    struct async_arg *aa = arg;
+    uint64_t gen;
+
+    for (int i = 0; i < ASYNC_RECORDS && !aa->err; i++) {
+        aa->err = mpool_mdc_append_async(aa->mdc, "async", 5, &gen);
+        if (!aa->err)
+            aa->err = mpool_mdc_sync_wait(aa->mdc, gen);
+    }
+
+    return NULL;
+}
+
+/* Concurrent appenders and waiters, the sync runs without the MDC lock
+ * so appends proceed while another thread is syncing the log.
+ */
+MTF_DEFINE_UTEST_PREPOST(mdc_test, mdc_io_async_mt, mpool_test_pre, mpool_test_post)
+{
+    struct async_arg argv[ASYNC_THREADS];
+    pthread_t tidv[ASYNC_THREADS];
+    struct mpool *mp;
+    struct mpool_mdc *mdc;
+    uint64_t logid1, logid2;
+    char rdbuf[32];
+    size_t rdlen;
+    merr_t err;
+    int rc;
+
+    err = mpool_create(mtf_kvdb_home, &tcparams);
+    ASSERT_EQ(0, err);
+
+    err = mpool_open(mtf_kvdb_home, &trparams, O_RDWR, &mp);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_alloc(mp, MDC_TEST_MAGIC, MDC_TEST_CAP, HSE_MCLASS_CAPACITY, &logid1, &logid2);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_commit(mp, logid1, logid2);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_open(mp, logid1, logid2, false, &mdc);
+    ASSERT_EQ(0, err);
+
+    for (int i = 0; i < ASYNC_THREADS; i++) {
+        argv[i].mdc = mdc;
+        argv[i].err = 0;
+
+        rc = pthread_create(tidv + i, NULL, async_main, argv + i);
+        ASSERT_EQ(0, rc);
+    }
+
+    for (int i = 0; i < ASYNC_THREADS; i++) {
+        rc = pthread_join(tidv[i], NULL);
+        ASSERT_EQ(0, rc);
+        ASSERT_EQ(0, argv[i].err);
+    }
+
+    err = mpool_mdc_close(mdc);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_open(mp, logid1, logid2, false, &mdc);
+    ASSERT_EQ(0, err);
+
+    for (int i = 0; i < ASYNC_THREADS * ASYNC_RECORDS; i++) {
+        err = mpool_mdc_read(mdc, rdbuf, sizeof(rdbuf), &rdlen);
+        ASSERT_EQ(0, err);
+        ASSERT_EQ(5, rdlen);
+        ASSERT_EQ(0, memcmp(rdbuf, "async", rdlen));
+    }
+
+    err = mpool_mdc_read(mdc, rdbuf, sizeof(rdbuf), &rdlen);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(0, rdlen);
+
+    err = mpool_mdc_close(mdc);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_delete(mp, logid1, logid2);
+    ASSERT_EQ(0, err);
+
+    err = mpool_close(mp);
+    ASSERT_EQ(0, err);
+
+    mpool_destroy(mtf_kvdb_home, &tdparams);
+}
+
+MTF_DEFINE_UTEST_PREPOST(mdc_test, mdc_compact_bg, mpool_test_pre, mpool_test_post)
+{
+    struct mpool *mp;
+    struct mpool_mdc *mdc, *img;
+    uint64_t logid1, logid2;
+    const char *expv[] = { "image", "delta" };
+    char rdbuf[32];
+    size_t rdlen;
+    merr_t err;
+
+    err = mpool_create(mtf_kvdb_home, &tcparams);
+    ASSERT_EQ(0, err);
+
+    err = mpool_open(mtf_kvdb_home, &trparams, O_RDWR, &mp);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_alloc(mp, MDC_TEST_MAGIC, MDC_TEST_CAP, HSE_MCLASS_CAPACITY, &logid1, &logid2);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_commit(mp, logid1, logid2);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_open(mp, logid1, logid2, false, &mdc);
+    ASSERT_EQ(0, err);
+
+    for (int i = 0; i < 3; i++) {
+        err = mpool_mdc_append(mdc, "stale", 5, true);
+        ASSERT_EQ(0, err);
+    }
+
+    err = mpool_mdc_cstart_bg(mdc, NULL);
+    ASSERT_EQ(EINVAL, merr_errno(err));
+
+    /* An abandoned compaction leaves the active log as it was.
+     */
+    err = mpool_mdc_cstart_bg(mdc, &img);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_append(img, "image", 5, true);
+    ASSERT_EQ(0, err);
+
+    mpool_mdc_cabort(mdc);
+
+    err = mpool_mdc_cstart_bg(mdc, &img);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_cstart(mdc);
+    ASSERT_EQ(EBUSY, merr_errno(err));
+
+    err = mpool_mdc_append(img, "image", 5, true);
+    ASSERT_EQ(0, err);
+
+    /* Appends made during the compaction go to the active log and follow
+     * the image in the compacted log.
+     */
+    err = mpool_mdc_append(mdc, "delta", 5, true);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_cend_bg(mdc);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_cend_bg(mdc);
+    ASSERT_EQ(EINVAL, merr_errno(err));
+
+    err = mpool_mdc_close(mdc);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_open(mp, logid1, logid2, false, &mdc);
+    ASSERT_EQ(0, err);
+
+    for (int i = 0; i < NELEM(expv); i++) {
+        err = mpool_mdc_read(mdc, rdbuf, sizeof(rdbuf), &rdlen);
+        ASSERT_EQ(0, err);
+        ASSERT_EQ(5, rdlen);
+        ASSERT_EQ(0, memcmp(rdbuf, expv[i], rdlen));
+    }
+
+    err = mpool_mdc_read(mdc, rdbuf, sizeof(rdbuf), &rdlen);
+    ASSERT_EQ(0, err);
+    ASSERT_EQ(0, rdlen);
+
+    err = mpool_mdc_close(mdc);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_delete(mp, logid1, logid2);
+    ASSERT_EQ(0, err);
+
+    err = mpool_close(mp);
+    ASSERT_EQ(0, err);
+
+    mpool_destroy(mtf_kvdb_home, &tdparams);
+}
+
+/* The sync point bounds what an unlocked sync covers and the sync offset
+ * advances only when that sync succeeds on the same log generation.
+ */
+MTF_DEFINE_UTEST_PREPOST(mdc_test, mdc_file_syncpt, mpool_test_pre, mpool_test_post)
+{
+    struct mdc_file_syncpt sp, sp2;
+    struct mdc_file *mfp;
+    struct mpool *mp;
+    char name[MDC_NAME_LENGTH_MAX];
+    char big[4 * PAGE_SIZE];
+    uint64_t logid1, logid2, gen;
+    int dirfd, dummy;
+    merr_t err;
+
+    err = mpool_create(mtf_kvdb_home, &tcparams);
+    ASSERT_EQ(0, err);
+
+    err = mpool_open(mtf_kvdb_home, &trparams, O_RDWR, &mp);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_alloc(mp, MDC_TEST_MAGIC, MDC_TEST_CAP, HSE_MCLASS_CAPACITY, &logid1, &logid2);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_commit(mp, logid1, logid2);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mclass_dirfd(mp, HSE_MCLASS_CAPACITY, &dirfd);
+    ASSERT_EQ(0, err);
+
+    mdc_filename_gen(name, sizeof(name), logid1);
+    err = mdc_file_open((void *)&dummy, dirfd, name, logid1, false, false, &gen, &mfp);
+    ASSERT_EQ(0, err);
+
+    err = mdc_file_datasync(NULL, &sp);
+    ASSERT_EQ(EINVAL, merr_errno(err));
+
+    /* Records appended through the mapping are msync'd from the sync offset. */
+    err = mdc_file_append(mfp, "mem", 3, false);
+    ASSERT_EQ(0, err);
+
+    mdc_file_datasync_begin(mfp, &sp);
+    ASSERT_EQ(MDC_LOGHDR_LEN, sp.off);
+    ASSERT_GT(sp.end, sp.off);
+    ASSERT_FALSE(sp.dsync);
+
+    err = mdc_file_append(mfp, "mem", 3, false);
+    ASSERT_EQ(0, err);
+
+    err = mdc_file_datasync(mfp, &sp);
+    ASSERT_EQ(0, err);
+
+    mdc_file_datasync_end(mfp, &sp, 0);
+
+    mdc_file_datasync_begin(mfp, &sp2);
+    ASSERT_EQ(sp.end, sp2.off);
+    ASSERT_GT(sp2.end, sp.end);
+
+    /* A failed sync leaves the sync offset alone. */
+    mdc_file_datasync_end(mfp, &sp2, merr(EIO));
+
+    mdc_file_datasync_begin(mfp, &sp);
+    ASSERT_EQ(sp2.off, sp.off);
+
+    /* Large records are written through the fd and need an fdatasync,
+     * which a later append through the fd must not lose.
+     */
+    memset(big, 'b', sizeof(big));
+    err = mdc_file_append(mfp, big, sizeof(big), false);
+    ASSERT_EQ(0, err);
+
+    mdc_file_datasync_begin(mfp, &sp);
+    ASSERT_TRUE(sp.dsync);
+
+    err = mdc_file_append(mfp, big, sizeof(big), false);
+    ASSERT_EQ(0, err);
+
+    err = mdc_file_datasync(mfp, &sp);
+    ASSERT_EQ(0, err);
+
+    mdc_file_datasync_end(mfp, &sp, 0);
+
+    mdc_file_datasync_begin(mfp, &sp);
+    ASSERT_TRUE(sp.dsync);
+
+    err = mdc_file_datasync(mfp, &sp);
+    ASSERT_EQ(0, err);
+
+    mdc_file_datasync_end(mfp, &sp, 0);
+
+    mdc_file_datasync_begin(mfp, &sp2);
+    ASSERT_FALSE(sp2.dsync);
+    ASSERT_EQ(sp.end, sp2.off);
+
+    /* A sync that spans an erase doesn't touch the new generation. */
+    err = mdc_file_append(mfp, "mem", 3, false);
+    ASSERT_EQ(0, err);
+
+    mdc_file_datasync_begin(mfp, &sp);
+
+    err = mdc_file_erase(mfp, gen + 1);
+    ASSERT_EQ(0, err);
+
+    mdc_file_datasync_end(mfp, &sp, 0);
+
+    mdc_file_datasync_begin(mfp, &sp2);
+    ASSERT_EQ(gen + 1, sp2.gen);
+    ASSERT_EQ(MDC_LOGHDR_LEN, sp2.off);
+    ASSERT_EQ(MDC_LOGHDR_LEN, sp2.end);
+
+    err = mdc_file_close(mfp);
+    ASSERT_EQ(0, err);
+
+    err = mpool_mdc_delete(mp, logid1, logid2);
+    ASSERT_EQ(0, err);
+
+    err = mpool_close(mp);
+    ASSERT_EQ(0, err);
+
+    mpool_destroy(mtf_kvdb_home, &tdparams);
+}
+
 MTF_END_UTEST_COLLECTION(mdc_test);
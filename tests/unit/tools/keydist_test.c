@@ -0,0 +1,171 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <hse/util/base.h>
+#include <hse/util/xrand.h>
+
+#include <hse/test/mtf/framework.h>
+
+#include "keydist.h"
+
+#define NKEYS (1000)
+#define DRAWS (100 * 1000)
+
+static const uint64_t seedv[] = { 1, 2, 1234, (uint64_t)-1234, UINT64_MAX };
+
+/* Draw DRAWS keys from NKEYS and return the hit count of each key.
+ */
+static uint64_t *
+keydist_hits(enum keydist_type type, uint64_t seed)
+{
+    struct keydist kd;
+    struct xrand xr;
+    uint64_t *hitv;
+
+    hitv = calloc(NKEYS, sizeof(*hitv));
+    if (!hitv)
+        return NULL;
+
+    keydist_init(&kd, type, NKEYS);
+    xrand_init(&xr, seed);
+
+    for (uint i = 0; i < DRAWS; i++) {
+        uint64_t k = keydist_next(&kd, &xr, NKEYS);
+
+        if (k >= NKEYS) {
+            free(hitv);
+            return NULL;
+        }
+
+        hitv[k]++;
+    }
+
+    return hitv;
+}
+
+static int
+compare_u64_desc(const void *ptr_a, const void *ptr_b)
+{
+    uint64_t a = *(uint64_t *)ptr_a;
+    uint64_t b = *(uint64_t *)ptr_b;
+
+    return (a < b) - (a > b);
+}
+
+static uint64_t
+sum_u64(const uint64_t *v, uint n)
+{
+    uint64_t sum = 0;
+
+    for (uint i = 0; i < n; i++)
+        sum += v[i];
+
+    return sum;
+}
+
+MTF_BEGIN_UTEST_COLLECTION(keydist_test);
+
+MTF_DEFINE_UTEST(keydist_test, seed_test)
+{
+    enum keydist_type typev[] = { KD_UNIFORM, KD_ZIPF, KD_LATEST };
+
+    for (uint tx = 0; tx < NELEM(typev); tx++) {
+        struct keydist kd1, kd2;
+
+        keydist_init(&kd1, typev[tx], NKEYS);
+        keydist_init(&kd2, typev[tx], NKEYS);
+
+        for (uint sx = 0; sx < NELEM(seedv); sx++) {
+            struct xrand xr1, xr2;
+            uint diff = 0;
+
+            /* Same seed ==> same sequence. */
+            xrand_init(&xr1, seedv[sx]);
+            xrand_init(&xr2, seedv[sx]);
+
+            for (uint i = 0; i < DRAWS; i++)
+                ASSERT_EQ(keydist_next(&kd1, &xr1, NKEYS), keydist_next(&kd2, &xr2, NKEYS));
+
+            /* Different seed ==> different sequence.  The skewed
+             * distributions draw the popular keys often enough that
+             * some draws match, but the vast majority must not.
+             */
+            xrand_init(&xr1, seedv[sx]);
+            xrand_init(&xr2, seedv[sx] + 1);
+
+            for (uint i = 0; i < DRAWS; i++)
+                diff += keydist_next(&kd1, &xr1, NKEYS) != keydist_next(&kd2, &xr2, NKEYS);
+
+            ASSERT_GT(diff, DRAWS * 9 / 10);
+        }
+    }
+}
+
+MTF_DEFINE_UTEST(keydist_test, skew_test)
+{
+    for (uint sx = 0; sx < NELEM(seedv); sx++) {
+        uint64_t *hitv;
+
+        /* Uniform: no key is drawn much more often than the mean.
+         */
+        hitv = keydist_hits(KD_UNIFORM, seedv[sx]);
+        ASSERT_NE(NULL, hitv);
+
+        qsort(hitv, NKEYS, sizeof(*hitv), compare_u64_desc);
+        ASSERT_LT(hitv[0], 2 * DRAWS / NKEYS);
+        ASSERT_LT(sum_u64(hitv, 10), DRAWS / 50);
+        free(hitv);
+
+        /* Zipf: the hottest key draws about 1/zeta(10^10, 0.99) of the
+         * keys (~3.8%) and the ten hottest about 12%, but scrambling
+         * spreads them across the key space.
+         */
+        hitv = keydist_hits(KD_ZIPF, seedv[sx]);
+        ASSERT_NE(NULL, hitv);
+
+        qsort(hitv, NKEYS, sizeof(*hitv), compare_u64_desc);
+        ASSERT_GT(hitv[0], DRAWS * 3 / 100);
+        ASSERT_GT(sum_u64(hitv, 10), DRAWS / 10);
+        free(hitv);
+
+        /* Latest: the newest key is the hottest and draws about
+         * 1/zeta(NKEYS, 0.99) of the keys (~13%), the ten newest draw
+         * about 40%, and the oldest half of the keys fewer than 10%.
+         */
+        hitv = keydist_hits(KD_LATEST, seedv[sx]);
+        ASSERT_NE(NULL, hitv);
+
+        ASSERT_GT(hitv[NKEYS - 1], DRAWS / 10);
+        ASSERT_GT(hitv[NKEYS - 1], hitv[NKEYS - 2]);
+        ASSERT_GT(hitv[NKEYS - 2], hitv[NKEYS - 10]);
+        ASSERT_GT(sum_u64(hitv + NKEYS - 10, 10), DRAWS * 3 / 10);
+        ASSERT_LT(sum_u64(hitv, NKEYS / 2), DRAWS * 3 / 20);
+        free(hitv);
+    }
+}
+
+MTF_DEFINE_UTEST(keydist_test, parse_test)
+{
+    enum keydist_type typev[] = { KD_UNIFORM, KD_ZIPF, KD_LATEST };
+    struct keydist kd;
+    struct xrand xr;
+
+    for (uint tx = 0; tx < NELEM(typev); tx++) {
+        ASSERT_EQ(typev[tx], keydist_parse(keydist_name(typev[tx])));
+
+        /* No keys ==> index 0. */
+        keydist_init(&kd, typev[tx], NKEYS);
+        xrand_init(&xr, 1);
+        ASSERT_EQ(0, keydist_next(&kd, &xr, 0));
+    }
+
+    ASSERT_EQ(KD_DEFAULT, keydist_parse("bogus"));
+    ASSERT_STREQ("invalid", keydist_name(KD_LATEST + 1));
+}
+
+MTF_END_UTEST_COLLECTION(keydist_test)
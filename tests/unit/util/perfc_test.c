@@ -236,4 +236,160 @@ MTF_DEFINE_UTEST(perfc, perfc_rollup)
     perfc_free(&perfc_rollup_pc);
 }
 
+MTF_DEFINE_UTEST(perfc, perfc_hdr_bkt_bounds)
+{
+    uint64_t samplev[] = { 0, 1, 7, 8, 9, 15, 16, 17, 1000, 123456789, 1ul << 47 };
+    uint prev = 0;
+
+    for (size_t i = 0; i < NELEM(samplev); ++i) {
+        uint64_t sample = samplev[i];
+        uint bkt = perfc_hdr_bkt(sample);
+
+        ASSERT_LT(bkt, PERFC_HDR_BKTS);
+        ASSERT_GE(bkt, prev);
+        ASSERT_GE(perfc_hdr_value(bkt), sample);
+        ASSERT_LE(perfc_hdr_value(bkt) - sample, sample / PERFC_HDR_SUBCNT);
+
+        if (bkt > 0)
+            ASSERT_LT(perfc_hdr_value(bkt - 1), sample);
+        prev = bkt;
+    }
+
+    ASSERT_EQ(PERFC_HDR_BKTS - 1, perfc_hdr_bkt(UINT64_MAX));
+}
+
+MTF_DEFINE_UTEST(perfc, perfc_hdr_percentile_interval)
+{
+    enum perfc_hdr_sidx {
+        PERFC_DI_HDRTEST_DIS,
+        PERFC_LT_HDRTEST_OFF,
+        PERFC_EN_HDRTEST
+    };
+    struct perfc_name perfc_hdr_op[] = {
+        NE(PERFC_DI_HDRTEST_DIS, 0, "hdrtest_dis", "hdrtest_dis"),
+        NE(PERFC_LT_HDRTEST_OFF, 3, "hdrtest_off", "hdrtest_off"),
+    };
+
+    uint64_t bktv[PERFC_HDR_BKTS] = { 0 };
+    struct perfc_set pc;
+    struct perfc_dis *dis;
+    uint64_t boundv[] = { 10, 100 };
+    struct perfc_ivl *ivl;
+    uint64_t val;
+    merr_t err;
+
+    /* Percentiles over a uniform distribution of 1..10000.
+     */
+    for (uint64_t i = 1; i <= 10000; ++i)
+        bktv[perfc_hdr_bkt(i)]++;
+
+    val = perfc_hdr_percentile(bktv, 10000, 50);
+    ASSERT_GE(val, 5000);
+    ASSERT_LE(val, 5000 + 5000 / PERFC_HDR_SUBCNT);
+
+    val = perfc_hdr_percentile(bktv, 10000, 99.9);
+    ASSERT_GE(val, 9990);
+    ASSERT_LE(val, 9990 + 9990 / PERFC_HDR_SUBCNT);
+
+    ASSERT_EQ(0, perfc_hdr_percentile(bktv, 0, 99));
+
+    err = perfc_ivl_create(NELEM(boundv), boundv, &ivl);
+    ASSERT_EQ(0, err);
+
+    perfc_hdr_op[0].pcn_ivl = ivl;
+
+    err = perfc_alloc_impl(
+        1, "hdr", perfc_hdr_op, PERFC_EN_HDRTEST, "set", REL_FILE(__FILE__), __LINE__, &pc);
+    ASSERT_EQ(0, err);
+
+    /* A counter disabled at allocation gets no histogram.
+     */
+    dis = &pc.ps_seti->pcs_ctrv[PERFC_LT_HDRTEST_OFF].dis;
+    ASSERT_EQ(NULL, dis->pdi_hdrv);
+    ASSERT_EQ(NULL, dis->pdi_hdrbase);
+
+    dis = &pc.ps_seti->pcs_ctrv[PERFC_DI_HDRTEST_DIS].dis;
+    ASSERT_NE(NULL, dis->pdi_hdrv);
+
+    for (uint64_t i = 1; i <= 1000; ++i)
+        perfc_dis_record(&pc, PERFC_DI_HDRTEST_DIS, 1000000);
+
+    /* After an interval reset only subsequent samples contribute
+     * to the interval percentiles.
+     */
+    err = perfc_interval_reset(PERFC_DT_PATH "/hdr");
+    ASSERT_EQ(0, err);
+
+    for (uint64_t i = 1; i <= 1000; ++i)
+        perfc_dis_record(&pc, PERFC_DI_HDRTEST_DIS, 100);
+
+    for (uint i = 0; i < PERFC_HDR_BKTS; ++i) {
+        bktv[i] = 0;
+        for (uint j = 0; j < PERFC_HDR_GRP_MAX; ++j)
+            bktv[i] += atomic_read(dis->pdi_hdrv + j * PERFC_HDR_BKTS + i);
+    }
+
+    val = perfc_hdr_percentile(bktv, 2000, 99);
+    ASSERT_GE(val, 1000000);
+
+    for (uint i = 0; i < PERFC_HDR_BKTS; ++i)
+        bktv[i] -= dis->pdi_hdrbase[i];
+
+    val = perfc_hdr_percentile(bktv, 1000, 99);
+    ASSERT_GE(val, 100);
+    ASSERT_LT(val, 1000);
+
+    err = perfc_interval_reset("/data/bogus");
+    ASSERT_EQ(EINVAL, merr_errno(err));
+
+    perfc_free(&pc);
+    perfc_ivl_destroy(ivl);
+}
+
+MTF_DEFINE_UTEST(perfc, perfc_dis_read_interval)
+{
+    enum perfc_rd_sidx {
+        PERFC_DI_RDTEST_DIS,
+        PERFC_EN_RDTEST
+    };
+    struct perfc_name perfc_rd_op[] = {
+        NE(PERFC_DI_RDTEST_DIS, 0, "rdtest_dis", "rdtest_dis"),
+    };
+
+    uint64_t boundv[] = { 10, 100 };
+    struct perfc_ivl *ivl;
+    struct perfc_set pc;
+    uint64_t hits, sum;
+    merr_t err;
+
+    err = perfc_ivl_create(NELEM(boundv), boundv, &ivl);
+    ASSERT_EQ(0, err);
+
+    perfc_rd_op[0].pcn_ivl = ivl;
+
+    err = perfc_alloc_impl(
+        1, "rd", perfc_rd_op, PERFC_EN_RDTEST, "set", REL_FILE(__FILE__), __LINE__, &pc);
+    ASSERT_EQ(0, err);
+
+    for (uint i = 0; i < 10; ++i)
+        perfc_dis_record(&pc, PERFC_DI_RDTEST_DIS, 100);
+
+    err = perfc_interval_reset(PERFC_DT_PATH "/rd");
+    ASSERT_EQ(0, err);
+
+    for (uint i = 0; i < 5; ++i)
+        perfc_dis_record(&pc, PERFC_DI_RDTEST_DIS, 7);
+
+    perfc_dis_read(pc.ps_seti, PERFC_DI_RDTEST_DIS, false, &hits, &sum);
+    ASSERT_EQ(15, hits);
+    ASSERT_EQ(1035, sum);
+
+    perfc_dis_read(pc.ps_seti, PERFC_DI_RDTEST_DIS, true, &hits, &sum);
+    ASSERT_EQ(5, hits);
+    ASSERT_EQ(35, sum);
+
+    perfc_free(&pc);
+    perfc_ivl_destroy(ivl);
+}
+
 MTF_END_UTEST_COLLECTION(perfc)
@@ -0,0 +1,120 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <stdlib.h>
+
+#include <hse/ikvdb/hse_gparams.h>
+#include <hse/util/base.h>
+#include <hse/util/rtrace.h>
+
+#include <hse/test/mtf/framework.h>
+
+static struct rtrace_rec recv[RTRACE_RING_MAX];
+
+static int
+test_pre(struct mtf_test_info *lcl_ti)
+{
+    hse_gparams.gp_rtrace_ppm = 1000000;
+    rtrace_reset();
+
+    return 0;
+}
+
+static int
+test_post(struct mtf_test_info *lcl_ti)
+{
+    hse_gparams.gp_rtrace_ppm = 0;
+
+    return 0;
+}
+
+MTF_BEGIN_UTEST_COLLECTION(rtrace_test);
+
+MTF_DEFINE_UTEST_PREPOST(rtrace_test, basic, test_pre, test_post)
+{
+    uint64_t start;
+    uint n;
+
+    rtrace_begin(RTRACE_OP_GET);
+
+    start = rtrace_span_start();
+    ASSERT_NE(0, start);
+    rtrace_span_record(RTRACE_EV_C0, start);
+
+    start = rtrace_span_start();
+    rtrace_span_record(RTRACE_EV_CN, start);
+
+    rtrace_end();
+
+    /* Spans outside of a traced request are ignored.
+     */
+    ASSERT_EQ(0, rtrace_span_start());
+
+    n = rtrace_read(recv, NELEM(recv));
+    ASSERT_EQ(1, n);
+    ASSERT_EQ(RTRACE_OP_GET, recv[0].rr_op);
+    ASSERT_EQ(2, recv[0].rr_spanc);
+    ASSERT_EQ(RTRACE_EV_C0, recv[0].rr_spanv[0].rs_ev);
+    ASSERT_EQ(RTRACE_EV_CN, recv[0].rr_spanv[1].rs_ev);
+    ASSERT_LE(recv[0].rr_spanv[1].rs_off + recv[0].rr_spanv[1].rs_dur, recv[0].rr_dur);
+
+    rtrace_reset();
+    ASSERT_EQ(0, rtrace_read(recv, NELEM(recv)));
+}
+
+MTF_DEFINE_UTEST_PREPOST(rtrace_test, nested, test_pre, test_post)
+{
+    uint n;
+
+    rtrace_begin(RTRACE_OP_PUT);
+    rtrace_begin(RTRACE_OP_GET);
+    rtrace_span_record(RTRACE_EV_THROTTLE, rtrace_span_start());
+    rtrace_end();
+    rtrace_span_record(RTRACE_EV_C0, rtrace_span_start());
+    rtrace_end();
+
+    n = rtrace_read(recv, NELEM(recv));
+    ASSERT_EQ(1, n);
+    ASSERT_EQ(RTRACE_OP_PUT, recv[0].rr_op);
+    ASSERT_EQ(2, recv[0].rr_spanc);
+}
+
+MTF_DEFINE_UTEST_PREPOST(rtrace_test, overflow, test_pre, test_post)
+{
+    uint n;
+
+    /* Excess spans are dropped, and the ring retains only the
+     * most recent traces.
+     */
+    for (int i = 0; i < RTRACE_RING_MAX + 7; ++i) {
+        rtrace_begin(RTRACE_OP_CURSOR_READ);
+        for (int j = 0; j < RTRACE_SPAN_MAX + 3; ++j)
+            rtrace_span_record(RTRACE_EV_MBREAD, rtrace_span_start());
+        rtrace_end();
+    }
+
+    n = rtrace_read(recv, NELEM(recv));
+    ASSERT_EQ(RTRACE_RING_MAX, n);
+    ASSERT_EQ(RTRACE_SPAN_MAX, recv[0].rr_spanc);
+
+    for (uint i = 1; i < n; ++i)
+        ASSERT_LE(recv[i - 1].rr_start, recv[i].rr_start);
+
+    n = rtrace_read(recv, 3);
+    ASSERT_EQ(3, n);
+}
+
+MTF_DEFINE_UTEST_PREPOST(rtrace_test, disabled, test_pre, test_post)
+{
+    hse_gparams.gp_rtrace_ppm = 0;
+
+    rtrace_begin(RTRACE_OP_GET);
+    ASSERT_EQ(0, rtrace_span_start());
+    rtrace_end();
+
+    ASSERT_EQ(0, rtrace_read(recv, NELEM(recv)));
+}
+
+MTF_END_UTEST_COLLECTION(rtrace_test)
@@ -121,4 +121,41 @@ MTF_DEFINE_UTEST(test, t_token_bucket)
     }
 }
 
+MTF_DEFINE_UTEST(test, t_token_bucket_throttle)
+{
+    struct tbkt tb;
+    uint64_t t0, dt;
+
+    /* A zero rate means unrestricted, so requests never sleep.
+     */
+    tbkt_init(&tb, 0, 0);
+
+    t0 = get_time_ns();
+    for (int i = 0; i < 1000; i++)
+        tbkt_throttle(&tb, 1 * G);
+    dt = get_time_ns() - t0;
+
+    ASSERT_LT(dt, NSEC_PER_SEC / 10);
+
+    /* Overdraw an empty bucket by 100ms worth of tokens.
+     */
+    tbkt_adjust(&tb, 0, 10 * M);
+
+    t0 = get_time_ns();
+    tbkt_throttle(&tb, 1 * M);
+    dt = get_time_ns() - t0;
+
+    ASSERT_GE(dt, NSEC_PER_SEC / 20);
+
+    /* Unlike an adjustment, which carries the debt over, reinitializing
+     * the bucket leaves it full.
+     */
+    tbkt_request(&tb, 1 * M, &t0);
+    tbkt_adjust(&tb, 1 * M, 10 * M);
+    ASSERT_GT(tbkt_request(&tb, 1 * M, &t0), 0);
+
+    tbkt_reinit(&tb, 1 * M, 10 * M);
+    ASSERT_EQ(0, tbkt_request(&tb, 1 * M, &t0));
+}
+
 MTF_END_UTEST_COLLECTION(test);
@@ -3,6 +3,9 @@
  * SPDX-FileCopyrightText: Copyright 2015 Micron Technology, Inc.
  */
 
+#include <pthread.h>
+#include <sched.h>
+
 #include <hse/logging/logging.h>
 #include <hse/util/platform.h>
 #include <hse/util/workqueue.h>
@@ -909,4 +912,145 @@ MTF_DEFINE_UTEST(workqueue_test, requeue)
     free(workv);
 }
 
+static void
+fifo_cb(struct work_struct *work)
+{
+    struct mywork *w = container_of(work, struct mywork, wstruct);
+
+    w->counter = atomic_inc_return(&counter);
+}
+
+/* Test that a single-threaded workqueue dispatches work in the order
+ * in which it was queued, regardless of the submitting thread's cpu.
+ */
+MTF_DEFINE_UTEST(workqueue_test, fifo)
+{
+    struct workqueue_struct *wq;
+    struct mywork *workv;
+    const int workmax = 1024;
+
+    workv = calloc(workmax, sizeof(*workv));
+    ASSERT_TRUE(workv != NULL);
+
+    atomic_set(&counter, 0);
+
+    wq = alloc_workqueue(__func__, 0, 1, 1);
+    ASSERT_TRUE(wq);
+
+    for (int i = 0; i < workmax; ++i) {
+        INIT_WORK(&workv[i].wstruct, fifo_cb);
+        queue_work(wq, &workv[i].wstruct);
+
+        if (i % 64 == 0)
+            usleep(10);
+    }
+
+    flush_workqueue(wq);
+
+    for (int i = 0; i < workmax; ++i)
+        ASSERT_EQ(workv[i].counter, i + 1);
+
+    destroy_workqueue(wq);
+    free(workv);
+}
+
+struct floodwork {
+    struct work_struct wstruct;
+    struct workqueue_struct *wq;
+};
+
+static void
+flood_cb(struct work_struct *work)
+{
+    struct floodwork *fw = container_of(work, struct floodwork, wstruct);
+
+    if (atomic_read(&counter2) == 0)
+        queue_work(fw->wq, work);
+}
+
+static void
+victim_cb(struct work_struct *work)
+{
+    atomic_set(&counter, 1);
+}
+
+/* Test that work which keeps the workers' home shard from ever emptying
+ * does not starve work queued to another shard.
+ */
+MTF_DEFINE_UTEST(workqueue_test, flood)
+{
+    struct workqueue_struct *wq;
+    struct floodwork *floodv;
+    struct work_struct victim;
+    const int workers = 4;
+    const int floodmax = workers * 4;
+    cpu_set_t omask, mask;
+    int cpua = -1, cpub = -1;
+    int rc;
+
+    rc = pthread_getaffinity_np(pthread_self(), sizeof(omask), &omask);
+    ASSERT_EQ(0, rc);
+
+    /* We need two cpus whose work lands in different shards.
+     */
+    for (int i = 0; i < CPU_SETSIZE; ++i) {
+        if (!CPU_ISSET(i, &omask))
+            continue;
+
+        if (cpua < 0) {
+            cpua = i;
+        } else if (i % workers != cpua % workers) {
+            cpub = i;
+            break;
+        }
+    }
+
+    if (cpub < 0)
+        return;
+
+    floodv = calloc(floodmax, sizeof(*floodv));
+    ASSERT_TRUE(floodv != NULL);
+
+    atomic_set(&counter, 0);
+    atomic_set(&counter2, 0);
+
+    /* Worker threads inherit our affinity, so they all share one home
+     * shard.  Each flood item requeues itself to that shard, and there
+     * are more of them than workers, so the home shard never empties.
+     */
+    CPU_ZERO(&mask);
+    CPU_SET(cpua, &mask);
+    rc = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+    ASSERT_EQ(0, rc);
+
+    wq = alloc_workqueue(__func__, 0, workers, workers);
+    ASSERT_TRUE(wq);
+
+    for (int i = 0; i < floodmax; ++i) {
+        floodv[i].wq = wq;
+        INIT_WORK(&floodv[i].wstruct, flood_cb);
+        queue_work(wq, &floodv[i].wstruct);
+    }
+
+    usleep(100 * 1000);
+
+    CPU_ZERO(&mask);
+    CPU_SET(cpub, &mask);
+    rc = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+    ASSERT_EQ(0, rc);
+
+    INIT_WORK(&victim, victim_cb);
+    queue_work(wq, &victim);
+
+    for (int i = 0; i < 10 * 1000 && atomic_read(&counter) == 0; ++i)
+        usleep(1000);
+
+    atomic_set(&counter2, 1);
+    pthread_setaffinity_np(pthread_self(), sizeof(omask), &omask);
+    destroy_workqueue(wq);
+    free(floodv);
+
+    ASSERT_EQ(1, atomic_read(&counter));
+}
+
 MTF_END_UTEST_COLLECTION(workqueue_test)
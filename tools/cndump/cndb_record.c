@@ -33,6 +33,8 @@ cndb_rec_type_name(enum cndb_rec_type rtype)
         return "ack";
     case CNDB_TYPE_NAK:
         return "nak";
+    case CNDB_TYPE_KVSET_SNAP:
+        return "kvset_snap";
     }
     return "unknown";
 }
@@ -154,6 +156,12 @@ cndb_rec_parse(struct cndb_rec *rec)
         cndb_omf_nak_read(rec->buf, &r->txid);
         break;
     }
+
+    case CNDB_TYPE_KVSET_SNAP: {
+        struct cndb_rec_kvset_snap *r = &rec->rec.kvset_snap;
+        cndb_omf_kvset_snap_read(rec->buf, &r->cnid, &r->kvsetid, &r->snaplen, &r->snap);
+        break;
+    }
     }
 }
 
@@ -280,5 +288,13 @@ cndb_rec_print(const struct cndb_rec *rec, bool oneline)
         printf("%*s txid %lu reclen %zu\n", indent, rec_type_name, r->txid, reclen);
         break;
     }
+
+    case CNDB_TYPE_KVSET_SNAP: {
+        const struct cndb_rec_kvset_snap *r = &rec->rec.kvset_snap;
+        printf(
+            "%*s cnid %lu kvsetid %lu snaplen %u reclen %zu\n", indent, rec_type_name, r->cnid,
+            r->kvsetid, r->snaplen, reclen);
+        break;
+    }
     }
 }
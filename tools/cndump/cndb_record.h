@@ -84,6 +84,13 @@ struct cndb_rec_nak {
     uint64_t txid;
 };
 
+struct cndb_rec_kvset_snap {
+    uint64_t cnid;
+    uint64_t kvsetid;
+    uint32_t snaplen;
+    const void *snap;
+};
+
 struct cndb_rec {
     size_t len;
     enum cndb_rec_type type;
@@ -100,6 +107,7 @@ struct cndb_rec {
         struct cndb_rec_kvset_move kvset_move;
         struct cndb_rec_ack ack;
         struct cndb_rec_nak nak;
+        struct cndb_rec_kvset_snap kvset_snap;
     } rec;
 };
 
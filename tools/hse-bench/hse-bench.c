@@ -0,0 +1,1017 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+/* hse-bench runs a sequence of standard workload mixes (YCSB A-F,
+ * sequential and random load, prefix scans, transaction contention and
+ * large values) in-process against a KVDB in any local directory, and
+ * reports throughput and latency percentiles in a form that can be
+ * compared across commits.
+ *
+ * Records are addressed by index.  The key of record i is its 64-bit
+ * big-endian index padded out to the key length, so that key order is
+ * index order.  Workloads run against one of three KVSs: "bench" holds
+ * the YCSB records, while "bench_txn" (transactions enabled) and
+ * "bench_large" are loaded on first use by the txn and large workloads.
+ */
+
+#include <assert.h>
+#include <endian.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+
+#include <hdr/hdr_histogram.h>
+
+#include <hse/cli/param.h>
+#include <hse/cli/program.h>
+#include <hse/hse.h>
+
+#include <hse/tools/common.h>
+#include <hse/tools/parm_groups.h>
+#include <hse/util/atomic.h>
+#include <hse/util/base.h>
+#include <hse/util/compiler.h>
+#include <hse/util/log2.h>
+#include <hse/util/minmax.h>
+#include <hse/util/platform.h>
+#include <hse/util/xrand.h>
+
+#include "hse-bench.h"
+
+/* clang-format off */
+
+#define BENCH_KEY_LEN_MIN   (sizeof(uint64_t))
+#define BENCH_LAT_MAX       (60ul * NSEC_PER_SEC)
+#define BENCH_LAT_SIGFIGS   (3)
+#define BENCH_PSCAN_SHIFT   (8)
+
+/* clang-format on */
+
+const char * const bench_op2name[] = {
+    "read", "update", "insert", "scan", "pscan", "rmw", "txn",
+};
+
+static_assert(NELEM(bench_op2name) == BOP_MAX, "bench_op2name[] mismatch");
+
+enum bench_kvs {
+    BKVS_MAIN,
+    BKVS_TXN,
+    BKVS_LARGE,
+    BKVS_MAX,
+};
+
+static const char * const bench_kvs2name[] = {
+    "bench",
+    "bench_txn",
+    "bench_large",
+};
+
+static_assert(NELEM(bench_kvs2name) == BKVS_MAX, "bench_kvs2name[] mismatch");
+
+/* WLF_LOAD     insert opts.records keys starting from index zero
+ * WLF_SCATTER  insert in a scattered rather than sequential order
+ */
+#define WLF_LOAD    (0x01u)
+#define WLF_SCATTER (0x02u)
+
+/**
+ * struct workload - a workload mix
+ * @wl_name:  workload name
+ * @wl_desc:  one line description
+ * @wl_kvs:   kvs against which the workload runs
+ * @wl_flags: WLF_* flags
+ * @wl_dist:  key distribution, KD_DEFAULT for opts.dist
+ * @wl_pct:   percentage of each op in the mix
+ */
+struct workload {
+    const char *wl_name;
+    const char *wl_desc;
+    enum bench_kvs wl_kvs;
+    unsigned int wl_flags;
+    enum keydist_type wl_dist;
+    unsigned int wl_pct[BOP_MAX];
+};
+
+/* The ycsb_* mixes follow the YCSB core workload definitions.
+ */
+static const struct workload workloads[] = {
+    { "load_seq", "insert all records in key order", BKVS_MAIN, WLF_LOAD, KD_DEFAULT,
+      { [BOP_INSERT] = 100 } },
+    { "load_rand", "insert all records in random order", BKVS_MAIN, WLF_LOAD | WLF_SCATTER,
+      KD_DEFAULT, { [BOP_INSERT] = 100 } },
+    { "ycsb_a", "50% read, 50% update", BKVS_MAIN, 0, KD_DEFAULT,
+      { [BOP_READ] = 50, [BOP_UPDATE] = 50 } },
+    { "ycsb_b", "95% read, 5% update", BKVS_MAIN, 0, KD_DEFAULT,
+      { [BOP_READ] = 95, [BOP_UPDATE] = 5 } },
+    { "ycsb_c", "100% read", BKVS_MAIN, 0, KD_DEFAULT, { [BOP_READ] = 100 } },
+    { "ycsb_d", "95% read, 5% insert, latest keys", BKVS_MAIN, 0, KD_LATEST,
+      { [BOP_READ] = 95, [BOP_INSERT] = 5 } },
+    { "ycsb_e", "95% scan, 5% insert", BKVS_MAIN, 0, KD_DEFAULT,
+      { [BOP_SCAN] = 95, [BOP_INSERT] = 5 } },
+    { "ycsb_f", "50% read, 50% read-modify-write", BKVS_MAIN, 0, KD_DEFAULT,
+      { [BOP_READ] = 50, [BOP_RMW] = 50 } },
+    { "pscan", "100% prefix scan of 256 records", BKVS_MAIN, 0, KD_DEFAULT,
+      { [BOP_PSCAN] = 100 } },
+    { "txn", "2-key read-modify-write txns on hot keys", BKVS_TXN, 0, KD_DEFAULT,
+      { [BOP_TXN] = 100 } },
+    { "large", "50% read, 50% update of large values", BKVS_LARGE, 0, KD_DEFAULT,
+      { [BOP_READ] = 50, [BOP_UPDATE] = 50 } },
+};
+
+static const struct workload workload_setup = {
+    "setup", "load a kvs", BKVS_MAX, WLF_LOAD | WLF_SCATTER, KD_UNIFORM, { [BOP_INSERT] = 100 },
+};
+
+/**
+ * struct bench_run - state shared by the workers of one workload
+ * @run_wl:       workload
+ * @run_kvdb:     kvdb handle
+ * @run_kvs:      kvs handle
+ * @run_kd:       key distribution
+ * @run_vlen:     value length
+ * @run_loadc:    number of records inserted by a load workload
+ * @run_ops:      number of ops to issue
+ * @run_start:    start time (nsecs)
+ * @run_deadline: time at which to stop issuing ops, zero for none
+ * @run_interval: per-worker interval between intended op start times
+ * @run_issued:   number of ops claimed by workers
+ * @run_next:     next record index to insert
+ */
+struct bench_run {
+    const struct workload *run_wl;
+    struct hse_kvdb *run_kvdb;
+    struct hse_kvs *run_kvs;
+    const struct keydist *run_kd;
+    size_t run_vlen;
+    uint64_t run_loadc;
+    uint64_t run_ops;
+    uint64_t run_start;
+    uint64_t run_deadline;
+    uint64_t run_interval;
+    atomic_ulong run_issued HSE_L1D_ALIGNED;
+    atomic_ulong run_next HSE_L1D_ALIGNED;
+};
+
+/**
+ * struct bench_worker - per-thread state
+ * @bw_run:  shared workload state
+ * @bw_tid:  thread handle
+ * @bw_xr:   PRNG state, seeded from opts.seed and the worker index
+ * @bw_txn:  transaction handle (txn kvs only)
+ * @bw_kbuf: key buffer
+ * @bw_vbuf: value buffer, also used to read values
+ * @bw_opv:  per-op results
+ */
+struct bench_worker {
+    struct bench_run *bw_run;
+    pthread_t bw_tid;
+    struct xrand bw_xr;
+    struct hse_kvdb_txn *bw_txn;
+    char bw_kbuf[HSE_KVS_KEY_LEN_MAX];
+    char *bw_vbuf;
+    struct bench_opstats bw_opv[BOP_MAX];
+} HSE_L1D_ALIGNED;
+
+struct bench_opts opts = {
+    .records = 1000000,
+    .threads = 8,
+    .klen = 24,
+    .vlen = 1000,
+    .lvlen = 256 * 1024,
+    .scanmax = 100,
+    .hotkeys = 1024,
+    .seed = 1,
+    .dist = KD_ZIPF,
+    .workloads = "load_rand,ycsb_a,ycsb_b,ycsb_c,ycsb_f,ycsb_d,ycsb_e",
+};
+
+static struct hse_kvs *bench_kvsv[BKVS_MAX];
+
+/* Number of records in each kvs, grown by the inserts of ycsb_d/e.
+ */
+static uint64_t bench_itemv[BKVS_MAX];
+
+static void
+syntax(const char *fmt, ...)
+{
+    char msg[256];
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+
+    fprintf(stderr, "%s: %s, use -h for help\n", progname, msg);
+}
+
+static const struct workload *
+workload_find(const char *name)
+{
+    for (size_t i = 0; i < NELEM(workloads); i++) {
+        if (!strcmp(name, workloads[i].wl_name))
+            return workloads + i;
+    }
+
+    return NULL;
+}
+
+static enum bench_op
+workload_pick(const struct workload *wl, struct xrand *xr)
+{
+    unsigned int r = xrand64(xr) % 100;
+    int op;
+
+    for (op = 0; op < BOP_MAX - 1; op++) {
+        if (r < wl->wl_pct[op])
+            break;
+        r -= wl->wl_pct[op];
+    }
+
+    return op;
+}
+
+/* Map [0, n) onto itself in a scattered order.  An odd multiplier plus
+ * an xor-shift is a bijection on [0, 2^k), and walking the cycle until
+ * the result falls below n restricts it to a bijection on [0, n).
+ */
+static uint64_t
+scatter(uint64_t i, uint64_t n)
+{
+    uint64_t mask;
+    uint shift;
+
+    if (n < 2)
+        return i;
+
+    mask = roundup_pow_of_two(n) - 1;
+    shift = (ilog2(mask) + 1) / 2 + 1;
+
+    do {
+        i = (i * 0x9e3779b97f4a7c15ul + 0x632be59bd9b4e019ul) & mask;
+        i ^= i >> shift;
+    } while (i >= n);
+
+    return i;
+}
+
+static size_t
+make_key(struct bench_worker *bw, uint64_t idx)
+{
+    uint64_t be = htobe64(idx);
+
+    memcpy(bw->bw_kbuf, &be, sizeof(be));
+
+    return opts.klen;
+}
+
+static void
+stamp_value(struct bench_worker *bw, uint64_t idx)
+{
+    memcpy(bw->bw_vbuf, &idx, sizeof(idx));
+}
+
+static void
+bench_put(struct bench_worker *bw, uint64_t idx)
+{
+    struct bench_run *run = bw->bw_run;
+    size_t klen = make_key(bw, idx);
+    hse_err_t err;
+
+    stamp_value(bw, idx);
+
+    if (bw->bw_txn) {
+        err = hse_kvdb_txn_begin(run->run_kvdb, bw->bw_txn);
+        if (!err)
+            err = hse_kvs_put(run->run_kvs, 0, bw->bw_txn, bw->bw_kbuf, klen, bw->bw_vbuf,
+                              run->run_vlen);
+        if (!err)
+            err = hse_kvdb_txn_commit(run->run_kvdb, bw->bw_txn);
+        else
+            hse_kvdb_txn_abort(run->run_kvdb, bw->bw_txn);
+    } else {
+        err = hse_kvs_put(run->run_kvs, 0, NULL, bw->bw_kbuf, klen, bw->bw_vbuf, run->run_vlen);
+    }
+
+    if (err)
+        fatal(err, "put");
+}
+
+static bool
+bench_get(struct bench_worker *bw, struct hse_kvdb_txn *txn, uint64_t idx)
+{
+    struct bench_run *run = bw->bw_run;
+    size_t klen = make_key(bw, idx);
+    hse_err_t err;
+    size_t vlen;
+    bool found;
+
+    err = hse_kvs_get(run->run_kvs, 0, txn, bw->bw_kbuf, klen, &found, bw->bw_vbuf,
+                      run->run_vlen, &vlen);
+    if (err)
+        fatal(err, "get");
+
+    return found;
+}
+
+static void
+bench_scan(struct bench_worker *bw, uint64_t idx, bool pfx)
+{
+    struct bench_run *run = bw->bw_run;
+    struct hse_kvs_cursor *cur;
+    uint64_t n, limit;
+    hse_err_t err;
+    size_t klen;
+
+    if (pfx) {
+        /* Keys that share all but the last byte of their index form a
+         * prefix of (1 << BENCH_PSCAN_SHIFT) consecutive records.
+         */
+        make_key(bw, idx);
+        err = hse_kvs_cursor_create(run->run_kvs, 0, NULL, bw->bw_kbuf, sizeof(idx) - 1, &cur);
+        limit = UINT64_MAX;
+    } else {
+        err = hse_kvs_cursor_create(run->run_kvs, 0, NULL, NULL, 0, &cur);
+        limit = 1 + xrand64(&bw->bw_xr) % opts.scanmax;
+    }
+
+    if (err)
+        fatal(err, "cursor create");
+
+    if (!pfx) {
+        klen = make_key(bw, idx);
+        err = hse_kvs_cursor_seek(cur, 0, bw->bw_kbuf, klen, NULL, NULL);
+        if (err)
+            fatal(err, "cursor seek");
+    }
+
+    for (n = 0; n < limit; n++) {
+        const void *key, *val;
+        size_t vlen;
+        bool eof;
+
+        err = hse_kvs_cursor_read(cur, 0, &key, &klen, &val, &vlen, &eof);
+        if (err)
+            fatal(err, "cursor read");
+
+        if (eof)
+            break;
+    }
+
+    hse_kvs_cursor_destroy(cur);
+}
+
+static void
+bench_txn(struct bench_worker *bw, struct bench_opstats *bs, uint64_t n)
+{
+    struct bench_run *run = bw->bw_run;
+    hse_err_t err;
+
+    err = hse_kvdb_txn_begin(run->run_kvdb, bw->bw_txn);
+    if (err)
+        fatal(err, "txn begin");
+
+    for (int i = 0; i < 2 && !err; i++) {
+        uint64_t idx = keydist_next(run->run_kd, &bw->bw_xr, n);
+        size_t klen;
+
+        if (!bench_get(bw, bw->bw_txn, idx))
+            bs->bs_notfound++;
+
+        klen = make_key(bw, idx);
+        stamp_value(bw, idx);
+
+        err = hse_kvs_put(run->run_kvs, 0, bw->bw_txn, bw->bw_kbuf, klen, bw->bw_vbuf,
+                          run->run_vlen);
+    }
+
+    if (!err)
+        err = hse_kvdb_txn_commit(run->run_kvdb, bw->bw_txn);
+
+    if (err) {
+        if (hse_err_to_errno(err) != ECANCELED)
+            fatal(err, "txn");
+
+        hse_kvdb_txn_abort(run->run_kvdb, bw->bw_txn);
+        bs->bs_conflicts++;
+    }
+}
+
+static uint64_t
+bench_insert_idx(struct bench_run *run)
+{
+    uint64_t idx = atomic_inc_return(&run->run_next) - 1;
+
+    if (run->run_wl->wl_flags & WLF_SCATTER)
+        idx = scatter(idx, run->run_loadc);
+
+    return idx;
+}
+
+static void
+bench_exec(struct bench_worker *bw, enum bench_op op)
+{
+    struct bench_run *run = bw->bw_run;
+    struct bench_opstats *bs = bw->bw_opv + op;
+    uint64_t n = atomic_read(&run->run_next);
+    uint64_t idx;
+
+    switch (op) {
+    case BOP_READ:
+        if (!bench_get(bw, NULL, keydist_next(run->run_kd, &bw->bw_xr, n)))
+            bs->bs_notfound++;
+        break;
+
+    case BOP_UPDATE:
+        bench_put(bw, keydist_next(run->run_kd, &bw->bw_xr, n));
+        break;
+
+    case BOP_INSERT:
+        bench_put(bw, bench_insert_idx(run));
+        break;
+
+    case BOP_SCAN:
+        bench_scan(bw, keydist_next(run->run_kd, &bw->bw_xr, n), false);
+        break;
+
+    case BOP_PSCAN:
+        idx = keydist_next(run->run_kd, &bw->bw_xr, n);
+        bench_scan(bw, idx & ~((1ul << BENCH_PSCAN_SHIFT) - 1), true);
+        break;
+
+    case BOP_RMW:
+        idx = keydist_next(run->run_kd, &bw->bw_xr, n);
+        if (!bench_get(bw, NULL, idx))
+            bs->bs_notfound++;
+        bench_put(bw, idx);
+        break;
+
+    case BOP_TXN:
+        bench_txn(bw, bs, n);
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void
+sleep_until(uint64_t when)
+{
+    struct timespec ts = {
+        .tv_sec = when / NSEC_PER_SEC,
+        .tv_nsec = when % NSEC_PER_SEC,
+    };
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        continue;
+}
+
+static void *
+bench_worker_main(void *arg)
+{
+    struct bench_worker *bw = arg;
+    struct bench_run *run = bw->bw_run;
+    uint64_t intended = run->run_start;
+
+    pthread_setname_np(pthread_self(), "hse_bench");
+
+    while (atomic_inc_return(&run->run_issued) <= run->run_ops) {
+        enum bench_op op = workload_pick(run->run_wl, &bw->bw_xr);
+        struct bench_opstats *bs = bw->bw_opv + op;
+        uint64_t start, now;
+
+        now = get_time_ns();
+        if (run->run_deadline && now >= run->run_deadline)
+            break;
+
+        /* In open loop mode each op has an intended start time, and its
+         * latency is measured from that time rather than from when the
+         * worker got around to issuing it.
+         */
+        if (run->run_interval) {
+            if (now < intended)
+                sleep_until(intended);
+            start = intended;
+            intended += run->run_interval;
+        } else {
+            start = now;
+        }
+
+        bench_exec(bw, op);
+
+        now = get_time_ns() - start;
+        hdr_record_value(bs->bs_hist, now < BENCH_LAT_MAX ? now : BENCH_LAT_MAX);
+        bs->bs_count++;
+    }
+
+    return NULL;
+}
+
+static void
+bench_run(
+    const struct workload *wl,
+    struct hse_kvdb *kvdb,
+    enum bench_kvs kvs,
+    uint64_t ops,
+    struct bench_result *res)
+{
+    struct bench_worker *bwv;
+    struct bench_run run = { 0 };
+    struct keydist kd;
+    uint64_t rate;
+    int rc;
+
+    res->br_name = wl->wl_name;
+    res->br_dist = wl->wl_dist ?: opts.dist;
+
+    keydist_init(&kd, res->br_dist, bench_itemv[kvs]);
+
+    run.run_wl = wl;
+    run.run_kvdb = kvdb;
+    run.run_kvs = bench_kvsv[kvs];
+    run.run_kd = &kd;
+    run.run_vlen = kvs == BKVS_LARGE ? opts.lvlen : opts.vlen;
+    run.run_ops = ops;
+    atomic_set(&run.run_next, bench_itemv[kvs]);
+
+    if (wl->wl_flags & WLF_LOAD) {
+        run.run_loadc = ops;
+        atomic_set(&run.run_next, 0);
+    }
+
+    /* The setup workload loads keys untimed, the target rate and
+     * duration apply only to the workloads being measured.
+     */
+    rate = wl == &workload_setup ? 0 : opts.rate;
+    if (rate)
+        run.run_interval = max_t(uint64_t, 1, opts.threads * NSEC_PER_SEC / rate);
+
+    bwv = aligned_alloc(alignof(struct bench_worker), sizeof(*bwv) * opts.threads);
+    if (!bwv)
+        fatal(ENOMEM, "cannot allocate workers");
+
+    memset(bwv, 0, sizeof(*bwv) * opts.threads);
+
+    for (unsigned int i = 0; i < opts.threads; i++) {
+        struct bench_worker *bw = bwv + i;
+
+        bw->bw_run = &run;
+        xrand_init(&bw->bw_xr, opts.seed * 1000003 + i + 1);
+        memset(bw->bw_kbuf, 'k', sizeof(bw->bw_kbuf));
+
+        bw->bw_vbuf = malloc(run.run_vlen + sizeof(uint64_t));
+        if (!bw->bw_vbuf)
+            fatal(ENOMEM, "cannot allocate value buffer");
+
+        for (size_t j = 0; j < run.run_vlen; j += sizeof(uint64_t)) {
+            uint64_t r = xrand64(&bw->bw_xr);
+
+            memcpy(bw->bw_vbuf + j, &r, sizeof(r));
+        }
+
+        if (kvs == BKVS_TXN) {
+            bw->bw_txn = hse_kvdb_txn_alloc(kvdb);
+            if (!bw->bw_txn)
+                fatal(ENOMEM, "cannot allocate txn");
+        }
+
+        for (int op = 0; op < BOP_MAX; op++) {
+            if (!wl->wl_pct[op])
+                continue;
+
+            rc = hdr_init(1, BENCH_LAT_MAX, BENCH_LAT_SIGFIGS, &bw->bw_opv[op].bs_hist);
+            if (rc)
+                fatal(rc, "cannot allocate histogram");
+        }
+    }
+
+    run.run_start = get_time_ns();
+    if (opts.duration && wl != &workload_setup)
+        run.run_deadline = run.run_start + opts.duration * NSEC_PER_SEC;
+
+    for (unsigned int i = 0; i < opts.threads; i++) {
+        rc = pthread_create(&bwv[i].bw_tid, NULL, bench_worker_main, bwv + i);
+        if (rc)
+            fatal(rc, "pthread_create");
+    }
+
+    for (unsigned int i = 0; i < opts.threads; i++)
+        pthread_join(bwv[i].bw_tid, NULL);
+
+    res->br_elapsed = get_time_ns() - run.run_start;
+
+    for (unsigned int i = 0; i < opts.threads; i++) {
+        struct bench_worker *bw = bwv + i;
+
+        for (int op = 0; op < BOP_MAX; op++) {
+            struct bench_opstats *dst = res->br_opv + op;
+            struct bench_opstats *src = bw->bw_opv + op;
+
+            if (!src->bs_hist)
+                continue;
+
+            if (dst->bs_hist) {
+                hdr_add(dst->bs_hist, src->bs_hist);
+                hdr_close(src->bs_hist);
+            } else {
+                dst->bs_hist = src->bs_hist;
+            }
+
+            dst->bs_count += src->bs_count;
+            dst->bs_notfound += src->bs_notfound;
+            dst->bs_conflicts += src->bs_conflicts;
+            res->br_ops += src->bs_count;
+        }
+
+        if (bw->bw_txn)
+            hse_kvdb_txn_free(kvdb, bw->bw_txn);
+        free(bw->bw_vbuf);
+    }
+
+    free(bwv);
+
+    if (wl->wl_flags & WLF_LOAD)
+        bench_itemv[kvs] = max_t(uint64_t, bench_itemv[kvs], run.run_loadc);
+    else
+        bench_itemv[kvs] = atomic_read(&run.run_next);
+}
+
+static void
+bench_result_fini(struct bench_result *res)
+{
+    for (int op = 0; op < BOP_MAX; op++)
+        hdr_close(res->br_opv[op].bs_hist);
+}
+
+static void
+bench_kvs_open(
+    struct hse_kvdb *kvdb,
+    enum bench_kvs kvs,
+    bool reuse,
+    struct svec *kvs_cparms,
+    struct svec *kvs_oparms)
+{
+    const char *name = bench_kvs2name[kvs];
+    struct bench_result res = { 0 };
+    hse_err_t err;
+    uint64_t loadc;
+
+    if (bench_kvsv[kvs])
+        return;
+
+    if (!reuse) {
+        err = hse_kvdb_kvs_drop(kvdb, name);
+        if (err && hse_err_to_errno(err) != ENOENT)
+            fatal(err, "cannot drop kvs %s", name);
+    }
+
+    err = hse_kvdb_kvs_create(kvdb, name, kvs_cparms->strc, kvs_cparms->strv);
+    if (err && !(reuse && hse_err_to_errno(err) == EEXIST))
+        fatal(err, "cannot create kvs %s", name);
+
+    err = hse_kvdb_kvs_open(kvdb, name, kvs_oparms->strc, kvs_oparms->strv, &bench_kvsv[kvs]);
+    if (err)
+        fatal(err, "cannot open kvs %s", name);
+
+    switch (kvs) {
+    case BKVS_TXN:
+        loadc = opts.hotkeys;
+        break;
+
+    case BKVS_LARGE:
+        loadc = max_t(uint64_t, 16, opts.records / 1024);
+        break;
+
+    default:
+        bench_itemv[kvs] = opts.records;
+        return;
+    }
+
+    bench_itemv[kvs] = loadc;
+    if (reuse)
+        return;
+
+    printf("loading %lu records into %s\n", loadc, name);
+
+    bench_run(&workload_setup, kvdb, kvs, loadc, &res);
+    bench_result_fini(&res);
+}
+
+static void
+usage(void)
+{
+    printf(
+        "usage: %s [options] kvdb_home [param=value ...]\n"
+        "-B file   Compare results with the JSON report of a previous run\n"
+        "-d secs   Max duration of each workload (default: none)\n"
+        "-D dist   Key distribution: uniform, zipf or latest (default: %s)\n"
+        "-h        Print this help menu\n"
+        "-H keys   Number of hot keys used by the txn workload (default: %u)\n"
+        "-j jobs   Number of worker threads (default: %u)\n"
+        "-k klen   Key length (default: %u)\n"
+        "-l        List workloads\n"
+        "-L vlen   Value length of the large workload (default: %u)\n"
+        "-n recs   Number of records (default: %lu)\n"
+        "-o ops    Number of ops per workload (default: number of records)\n"
+        "-O file   Write a JSON report to file, '-' for stdout\n"
+        "-r        Reuse the KVSs and records of a previous run\n"
+        "-s seed   PRNG seed (default: %lu)\n"
+        "-S len    Max number of records read by a scan (default: %u)\n"
+        "-t rate   Target ops/sec, measures latency from intended start (default: closed loop)\n"
+        "-v vlen   Value length (default: %u)\n"
+        "-w list   Comma separated list of workloads (default: %s)\n"
+        "-Z config Path to global config file\n"
+        "\n"
+        "The KVDB is created if it does not exist.  The KVSs used by the\n"
+        "benchmark are dropped and recreated unless -r is given.\n",
+        progname, keydist_name(opts.dist), opts.hotkeys, opts.threads, opts.klen, opts.lvlen,
+        opts.records, opts.seed, opts.scanmax, opts.vlen, opts.workloads);
+}
+
+static void
+list_workloads(void)
+{
+    for (size_t i = 0; i < NELEM(workloads); i++)
+        printf("%-10s %s\n", workloads[i].wl_name, workloads[i].wl_desc);
+}
+
+int
+main(int argc, char **argv)
+{
+    struct parm_groups *pg = NULL;
+    struct svec hse_gparms = { 0 };
+    struct svec kvdb_cparms = { 0 };
+    struct svec kvdb_oparms = { 0 };
+    struct svec kvs_cparms = { 0 };
+    struct svec kvs_oparms = { 0 };
+    struct svec kvs_txn_oparms = { 0 };
+    const struct workload *wlv[64];
+    struct bench_result *resv;
+    const char *config = NULL, *home;
+    const char *json = NULL, *baseline = NULL;
+    struct hse_kvdb *kvdb;
+    bool reuse = false;
+    unsigned int wlc = 0;
+    char *list, *name, *save;
+    hse_err_t err;
+    int c, rc;
+
+    progname_set(argv[0]);
+
+    rc = pg_create(&pg, PG_HSE_GLOBAL, PG_KVDB_CREATE, PG_KVDB_OPEN, PG_KVS_CREATE, PG_KVS_OPEN,
+                   NULL);
+    if (rc)
+        fatal(rc, "pg_create");
+
+    while ((c = getopt(argc, argv, ":B:d:D:hH:j:k:lL:n:o:O:rs:S:t:v:w:Z:")) != -1) {
+        char *errmsg, *end;
+
+        errmsg = end = NULL;
+        errno = 0;
+
+        switch (c) {
+        case 'B':
+            baseline = optarg;
+            break;
+        case 'd':
+            opts.duration = strtoul(optarg, &end, 0);
+            errmsg = "invalid duration";
+            break;
+        case 'D':
+            opts.dist = keydist_parse(optarg);
+            if (opts.dist == KD_DEFAULT) {
+                syntax("invalid distribution '%s'", optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case 'h':
+            usage();
+            exit(0);
+        case 'H':
+            opts.hotkeys = strtoul(optarg, &end, 0);
+            errmsg = "invalid number of hot keys";
+            break;
+        case 'j':
+            opts.threads = strtoul(optarg, &end, 0);
+            errmsg = "invalid thread count";
+            break;
+        case 'k':
+            opts.klen = strtoul(optarg, &end, 0);
+            errmsg = "invalid key length";
+            break;
+        case 'l':
+            list_workloads();
+            exit(0);
+        case 'L':
+            opts.lvlen = strtoul(optarg, &end, 0);
+            errmsg = "invalid large value length";
+            break;
+        case 'n':
+            opts.records = strtoul(optarg, &end, 0);
+            errmsg = "invalid number of records";
+            break;
+        case 'o':
+            opts.ops = strtoul(optarg, &end, 0);
+            errmsg = "invalid number of ops";
+            break;
+        case 'O':
+            json = optarg;
+            break;
+        case 'r':
+            reuse = true;
+            break;
+        case 's':
+            opts.seed = strtoul(optarg, &end, 0);
+            errmsg = "invalid seed";
+            break;
+        case 'S':
+            opts.scanmax = strtoul(optarg, &end, 0);
+            errmsg = "invalid scan length";
+            break;
+        case 't':
+            opts.rate = strtoul(optarg, &end, 0);
+            errmsg = "invalid rate";
+            break;
+        case 'v':
+            opts.vlen = strtoul(optarg, &end, 0);
+            errmsg = "invalid value length";
+            break;
+        case 'w':
+            opts.workloads = optarg;
+            break;
+        case 'Z':
+            config = optarg;
+            break;
+        case '?':
+            syntax("invalid option -%c", optopt);
+            exit(EX_USAGE);
+        case ':':
+            syntax("option -%c requires a parameter", optopt);
+            exit(EX_USAGE);
+        default:
+            fprintf(stderr, "option -%c ignored\n", c);
+            break;
+        }
+
+        if (errno && errmsg) {
+            syntax("%s", errmsg);
+            exit(EX_USAGE);
+        } else if (end && *end) {
+            syntax("%s '%s'", errmsg, optarg);
+            exit(EX_USAGE);
+        }
+    }
+
+    if (argc - optind < 1) {
+        syntax("missing required parameters");
+        exit(EX_USAGE);
+    }
+
+    if (opts.klen < BENCH_KEY_LEN_MIN || opts.klen > HSE_KVS_KEY_LEN_MAX) {
+        syntax("key length must be from %zu to %u", BENCH_KEY_LEN_MIN, HSE_KVS_KEY_LEN_MAX);
+        exit(EX_USAGE);
+    }
+
+    if (opts.vlen < sizeof(uint64_t) || opts.vlen > HSE_KVS_VALUE_LEN_MAX ||
+        opts.lvlen < sizeof(uint64_t) || opts.lvlen > HSE_KVS_VALUE_LEN_MAX) {
+        syntax("value lengths must be from %zu to %u", sizeof(uint64_t), HSE_KVS_VALUE_LEN_MAX);
+        exit(EX_USAGE);
+    }
+
+    if (!opts.threads || !opts.records || !opts.scanmax || !opts.hotkeys) {
+        syntax("threads, records, scan length and hot keys must be non-zero");
+        exit(EX_USAGE);
+    }
+
+    list = strdup(opts.workloads);
+    if (!list)
+        fatal(ENOMEM, "strdup");
+
+    for (name = strtok_r(list, ",", &save); name; name = strtok_r(NULL, ",", &save)) {
+        if (wlc >= NELEM(wlv)) {
+            syntax("too many workloads");
+            exit(EX_USAGE);
+        }
+
+        wlv[wlc] = workload_find(name);
+        if (!wlv[wlc]) {
+            syntax("unknown workload '%s', use -l to list workloads", name);
+            exit(EX_USAGE);
+        }
+
+        wlc++;
+    }
+
+    free(list);
+
+    home = argv[optind++];
+
+    rc = pg_parse_argv(pg, argc, argv, &optind);
+    switch (rc) {
+    case 0:
+        if (optind < argc)
+            fatal(0, "unknown parameter: %s", argv[optind]);
+        break;
+    case EINVAL:
+        fatal(0, "missing group name (e.g. %s) before parameter %s\n", PG_KVDB_OPEN, argv[optind]);
+        break;
+    default:
+        fatal(rc, "error processing parameter %s\n", argv[optind]);
+        break;
+    }
+
+    rc = rc ?: svec_append_pg(&hse_gparms, pg, PG_HSE_GLOBAL, NULL);
+    rc = rc ?: svec_append_pg(&kvdb_cparms, pg, PG_KVDB_CREATE, NULL);
+    rc = rc ?: svec_append_pg(&kvdb_oparms, pg, PG_KVDB_OPEN, NULL);
+    rc = rc ?: svec_append_pg(&kvs_cparms, pg, PG_KVS_CREATE, NULL);
+    rc = rc ?: svec_append_pg(&kvs_oparms, pg, PG_KVS_OPEN, NULL);
+    rc = rc ?: svec_append_pg(&kvs_txn_oparms, pg, PG_KVS_OPEN, "transactions.enabled=true", NULL);
+    if (rc)
+        fatal(rc, "failed to parse params\n");
+
+    err = hse_init(config, hse_gparms.strc, hse_gparms.strv);
+    if (err)
+        fatal(err, "failed to initialize kvdb");
+
+    err = hse_kvdb_open(home, kvdb_oparms.strc, kvdb_oparms.strv, &kvdb);
+    if (err && hse_err_to_errno(err) == ENOENT) {
+        err = hse_kvdb_create(home, kvdb_cparms.strc, kvdb_cparms.strv);
+        if (err)
+            fatal(err, "cannot create kvdb %s", home);
+
+        err = hse_kvdb_open(home, kvdb_oparms.strc, kvdb_oparms.strv, &kvdb);
+    }
+    if (err)
+        fatal(err, "cannot open kvdb %s", home);
+
+    resv = calloc(wlc, sizeof(*resv));
+    if (!resv)
+        fatal(ENOMEM, "cannot allocate results");
+
+    for (unsigned int i = 0; i < wlc; i++) {
+        const struct workload *wl = wlv[i];
+        enum bench_kvs kvs = wl->wl_kvs;
+        uint64_t ops;
+
+        bench_kvs_open(kvdb, kvs, reuse, &kvs_cparms,
+                       kvs == BKVS_TXN ? &kvs_txn_oparms : &kvs_oparms);
+
+        ops = (wl->wl_flags & WLF_LOAD) ? opts.records : (opts.ops ?: opts.records);
+
+        bench_run(wl, kvdb, kvs, ops, resv + i);
+
+        /* Flush loads so that they do not skew the workloads that follow.
+         */
+        if (wl->wl_flags & WLF_LOAD) {
+            err = hse_kvdb_sync(kvdb, 0);
+            if (err)
+                fatal(err, "kvdb sync");
+        }
+
+        report_print(json && !strcmp(json, "-") ? stderr : stdout, resv + i);
+    }
+
+    if (json) {
+        rc = report_write(json, resv, wlc);
+        if (rc)
+            fatal(rc, "cannot write report %s", json);
+    }
+
+    if (baseline) {
+        FILE *fp = json && !strcmp(json, "-") ? stderr : stdout;
+
+        rc = report_compare(fp, baseline, resv, wlc);
+        if (rc)
+            fatal(rc, "cannot compare with %s", baseline);
+    }
+
+    for (unsigned int i = 0; i < wlc; i++)
+        bench_result_fini(resv + i);
+    free(resv);
+
+    for (int i = 0; i < BKVS_MAX; i++) {
+        if (bench_kvsv[i])
+            hse_kvdb_kvs_close(bench_kvsv[i]);
+    }
+
+    hse_kvdb_close(kvdb);
+    hse_fini();
+
+    svec_reset(&kvs_txn_oparms);
+    svec_reset(&kvs_oparms);
+    svec_reset(&kvs_cparms);
+    svec_reset(&kvdb_oparms);
+    svec_reset(&kvdb_cparms);
+    svec_reset(&hse_gparms);
+    pg_destroy(pg);
+
+    return 0;
+}
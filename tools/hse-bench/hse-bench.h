@@ -0,0 +1,128 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#ifndef HSE_BENCH_H
+#define HSE_BENCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <hdr/hdr_histogram.h>
+
+#include "keydist.h"
+
+/* If you perturb bench_op then be certain to update bench_op2name[]
+ * to match.
+ */
+enum bench_op {
+    BOP_READ,
+    BOP_UPDATE,
+    BOP_INSERT,
+    BOP_SCAN,
+    BOP_PSCAN,
+    BOP_RMW,
+    BOP_TXN,
+    BOP_MAX,
+};
+
+extern const char * const bench_op2name[];
+
+/**
+ * struct bench_opts - benchmark configuration
+ * @records:   number of records loaded into the main kvs
+ * @ops:       number of ops per workload (0: @records)
+ * @threads:   number of worker threads
+ * @klen:      key length
+ * @vlen:      value length
+ * @lvlen:     value length of the "large" workload
+ * @scanmax:   max number of records read by a scan
+ * @hotkeys:   size of the key set of the "txn" workload
+ * @rate:      target op rate per second, zero for closed loop
+ * @duration:  max duration per workload in seconds, zero for no limit
+ * @seed:      PRNG seed
+ * @dist:      key distribution, for workloads that do not dictate one
+ * @workloads: comma separated list of workloads to run
+ */
+struct bench_opts {
+    uint64_t records;
+    uint64_t ops;
+    unsigned int threads;
+    unsigned int klen;
+    unsigned int vlen;
+    unsigned int lvlen;
+    unsigned int scanmax;
+    unsigned int hotkeys;
+    uint64_t rate;
+    unsigned int duration;
+    uint64_t seed;
+    enum keydist_type dist;
+    const char *workloads;
+};
+
+extern struct bench_opts opts;
+
+/**
+ * struct bench_opstats - per-op results
+ * @bs_hist:      latency histogram (nsecs), NULL if the op is not in the mix
+ * @bs_count:     number of ops completed
+ * @bs_notfound:  number of reads of keys that did not exist
+ * @bs_conflicts: number of transactions aborted due to write conflicts
+ */
+struct bench_opstats {
+    struct hdr_histogram *bs_hist;
+    uint64_t bs_count;
+    uint64_t bs_notfound;
+    uint64_t bs_conflicts;
+};
+
+/**
+ * struct bench_result - results of one workload
+ * @br_name:    workload name
+ * @br_dist:    key distribution used
+ * @br_ops:     number of ops completed
+ * @br_elapsed: elapsed time (nsecs)
+ * @br_opv:     per-op results
+ */
+struct bench_result {
+    const char *br_name;
+    enum keydist_type br_dist;
+    uint64_t br_ops;
+    uint64_t br_elapsed;
+    struct bench_opstats br_opv[BOP_MAX];
+};
+
+/**
+ * report_print() - print a human readable summary of a workload's results
+ * @fp:  output stream
+ * @res: workload results
+ */
+void
+report_print(FILE *fp, const struct bench_result *res);
+
+/**
+ * report_write() - write the results of all workloads as JSON
+ * @path: output file, "-" for stdout
+ * @resv: vector of workload results
+ * @resc: number of elements in @resv
+ *
+ * Return: 0 on success, otherwise an errno
+ */
+int
+report_write(const char *path, const struct bench_result *resv, unsigned int resc);
+
+/**
+ * report_compare() - compare results with those of a previous run
+ * @fp:   output stream
+ * @path: JSON report of the previous run
+ * @resv: vector of workload results
+ * @resc: number of elements in @resv
+ *
+ * Return: 0 on success, otherwise an errno
+ */
+int
+report_compare(FILE *fp, const char *path, const struct bench_result *resv, unsigned int resc);
+
+#endif
@@ -0,0 +1,133 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <hse/util/base.h>
+#include <hse/util/hash.h>
+
+#include "keydist.h"
+
+/* clang-format off */
+
+/* YCSB's default skew.  The scrambled zipfian distribution draws from
+ * a fixed space of 10^10 items, whose zeta is precomputed, and hashes
+ * the result into the key space so that the popular keys are spread
+ * throughout the key space rather than clustered at its start.
+ */
+#define ZIPF_THETA              (0.99)
+#define ZIPF_SCRAMBLED_ITEMS    (10000000000ul)
+#define ZIPF_SCRAMBLED_ZETAN    (26.46902820178302)
+
+/* clang-format on */
+
+static const char * const keydist_namev[] = {
+    [KD_DEFAULT] = "default",
+    [KD_UNIFORM] = "uniform",
+    [KD_ZIPF] = "zipf",
+    [KD_LATEST] = "latest",
+};
+
+static double
+zeta(uint64_t n, double theta)
+{
+    double sum = 0;
+
+    for (uint64_t i = 1; i <= n; i++)
+        sum += 1.0 / pow(i, theta);
+
+    return sum;
+}
+
+static void
+zipf_init(struct zipf *zf, uint64_t items, double theta, double zetan)
+{
+    if (items < 2)
+        items = 2;
+
+    zf->zf_items = items;
+    zf->zf_theta = theta;
+    zf->zf_alpha = 1.0 / (1.0 - theta);
+    zf->zf_zetan = zetan > 0 ? zetan : zeta(items, theta);
+    zf->zf_eta = (1.0 - pow(2.0 / items, 1.0 - theta)) / (1.0 - zeta(2, theta) / zf->zf_zetan);
+    zf->zf_half = 1.0 + pow(0.5, theta);
+}
+
+static uint64_t
+zipf_next(const struct zipf *zf, struct xrand *xr)
+{
+    double u, uz;
+    uint64_t v;
+
+    u = (xrand64(xr) >> 11) * 0x1.0p-53;
+    uz = u * zf->zf_zetan;
+
+    if (uz < 1.0)
+        return 0;
+
+    if (uz < zf->zf_half)
+        return 1;
+
+    v = zf->zf_items * pow(zf->zf_eta * u - zf->zf_eta + 1, zf->zf_alpha);
+
+    return v < zf->zf_items ? v : zf->zf_items - 1;
+}
+
+void
+keydist_init(struct keydist *kd, enum keydist_type type, uint64_t items)
+{
+    memset(kd, 0, sizeof(*kd));
+    kd->kd_type = type;
+
+    if (type == KD_ZIPF)
+        zipf_init(&kd->kd_zipf, ZIPF_SCRAMBLED_ITEMS, ZIPF_THETA, ZIPF_SCRAMBLED_ZETAN);
+    else if (type == KD_LATEST)
+        zipf_init(&kd->kd_zipf, items, ZIPF_THETA, 0);
+}
+
+uint64_t
+keydist_next(const struct keydist *kd, struct xrand *xr, uint64_t n)
+{
+    uint64_t v;
+
+    if (n == 0)
+        return 0;
+
+    switch (kd->kd_type) {
+    case KD_ZIPF:
+        v = zipf_next(&kd->kd_zipf, xr);
+        return hse_hash64(&v, sizeof(v)) % n;
+
+    case KD_LATEST:
+        /* YCSB's skewed-latest generator grows zeta as keys are
+         * inserted.  Inserts are a small fraction of the ops in the
+         * workloads that use it, so zeta is computed once and the
+         * rank is simply folded into the current key count.
+         */
+        v = zipf_next(&kd->kd_zipf, xr);
+        return n - 1 - (v % n);
+
+    default:
+        return xrand64(xr) % n;
+    }
+}
+
+const char *
+keydist_name(enum keydist_type type)
+{
+    return type < NELEM(keydist_namev) ? keydist_namev[type] : "invalid";
+}
+
+enum keydist_type
+keydist_parse(const char *name)
+{
+    for (size_t i = KD_UNIFORM; i < NELEM(keydist_namev); i++) {
+        if (!strcmp(name, keydist_namev[i]))
+            return i;
+    }
+
+    return KD_DEFAULT;
+}
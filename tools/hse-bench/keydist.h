@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#ifndef HSE_BENCH_KEYDIST_H
+#define HSE_BENCH_KEYDIST_H
+
+#include <stdint.h>
+
+#include <hse/util/xrand.h>
+
+enum keydist_type {
+    KD_DEFAULT,
+    KD_UNIFORM,
+    KD_ZIPF,
+    KD_LATEST,
+};
+
+/**
+ * struct zipf - YCSB zipfian generator over [0, items)
+ * @zf_items: number of items
+ * @zf_theta: skew
+ * @zf_alpha: 1 / (1 - theta)
+ * @zf_zetan: zeta(items, theta)
+ * @zf_eta:   derived constant (see Gray et al, "Quickly Generating
+ *            Billion-Record Synthetic Databases", SIGMOD 1994)
+ * @zf_half:  1 + 0.5^theta
+ */
+struct zipf {
+    uint64_t zf_items;
+    double zf_theta;
+    double zf_alpha;
+    double zf_zetan;
+    double zf_eta;
+    double zf_half;
+};
+
+/**
+ * struct keydist - key selection distribution
+ * @kd_type: distribution type
+ * @kd_zipf: zipfian generator (zipf and latest only)
+ */
+struct keydist {
+    enum keydist_type kd_type;
+    struct zipf kd_zipf;
+};
+
+/**
+ * keydist_init() - initialize a key distribution
+ * @kd:    key distribution
+ * @type:  distribution type
+ * @items: expected number of items (only used by latest)
+ *
+ * Initializing the latest distribution computes zeta(@items), which
+ * is linear in @items.
+ */
+void
+keydist_init(struct keydist *kd, enum keydist_type type, uint64_t items);
+
+/**
+ * keydist_next() - select the index of the next key
+ * @kd: key distribution
+ * @xr: PRNG state
+ * @n:  number of keys currently in existence
+ *
+ * Return: key index in [0, @n)
+ */
+uint64_t
+keydist_next(const struct keydist *kd, struct xrand *xr, uint64_t n);
+
+const char *
+keydist_name(enum keydist_type type);
+
+enum keydist_type
+keydist_parse(const char *name);
+
+#endif
@@ -0,0 +1,404 @@
+/* SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * SPDX-FileCopyrightText: Copyright 2022 Micron Technology, Inc.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cjson/cJSON.h>
+
+#include <hse/version.h>
+
+#include <hse/util/base.h>
+
+#include "hse-bench.h"
+
+/* Bump REPORT_VERSION whenever the meaning of an existing field changes,
+ * so that reports from different commits are not compared blindly.
+ */
+#define REPORT_VERSION (1)
+
+static const struct {
+    const char *name;
+    double pct;
+} report_pctv[] = {
+    { "p50", 50.0 }, { "p90", 90.0 }, { "p99", 99.0 }, { "p99.9", 99.9 }, { "p99.99", 99.99 },
+};
+
+static const char *
+report_latency_mode(void)
+{
+    /* With a target rate, latency is measured from the time at which an
+     * op was scheduled to start, so that a stall is charged to every op
+     * that queued behind it (i.e., it is free of coordinated omission).
+     * A closed loop can only measure service time.
+     */
+    return opts.rate ? "intended" : "service";
+}
+
+void
+report_print(FILE *fp, const struct bench_result *res)
+{
+    double secs = res->br_elapsed / 1e9;
+
+    fprintf(
+        fp, "\n%s: %lu ops in %.3f s, %.0f ops/s, dist %s, latency %s (usecs)\n", res->br_name,
+        res->br_ops, secs, secs > 0 ? res->br_ops / secs : 0, keydist_name(res->br_dist),
+        report_latency_mode());
+
+    fprintf(
+        fp, "  %-8s %12s %10s %10s %9s %9s %9s %9s %9s %9s %9s\n", "op", "count", "notfound",
+        "conflicts", "mean", "p50", "p90", "p99", "p99.9", "p99.99", "max");
+
+    for (int op = 0; op < BOP_MAX; op++) {
+        const struct bench_opstats *bs = res->br_opv + op;
+        struct hdr_histogram *h = bs->bs_hist;
+
+        if (!h)
+            continue;
+
+        fprintf(
+            fp, "  %-8s %12lu %10lu %10lu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+            bench_op2name[op], bs->bs_count, bs->bs_notfound, bs->bs_conflicts,
+            hdr_mean(h) / 1000, hdr_value_at_percentile(h, 50.0) / 1000.0,
+            hdr_value_at_percentile(h, 90.0) / 1000.0, hdr_value_at_percentile(h, 99.0) / 1000.0,
+            hdr_value_at_percentile(h, 99.9) / 1000.0,
+            hdr_value_at_percentile(h, 99.99) / 1000.0, hdr_max(h) / 1000.0);
+    }
+}
+
+static cJSON *
+report_config(void)
+{
+    cJSON *cfg;
+    bool bad;
+
+    cfg = cJSON_CreateObject();
+    if (!cfg)
+        return NULL;
+
+    bad = !cJSON_AddNumberToObject(cfg, "records", opts.records);
+    bad |= !cJSON_AddNumberToObject(cfg, "ops", opts.ops);
+    bad |= !cJSON_AddNumberToObject(cfg, "threads", opts.threads);
+    bad |= !cJSON_AddNumberToObject(cfg, "key_length", opts.klen);
+    bad |= !cJSON_AddNumberToObject(cfg, "value_length", opts.vlen);
+    bad |= !cJSON_AddNumberToObject(cfg, "large_value_length", opts.lvlen);
+    bad |= !cJSON_AddNumberToObject(cfg, "scan_max", opts.scanmax);
+    bad |= !cJSON_AddNumberToObject(cfg, "hot_keys", opts.hotkeys);
+    bad |= !cJSON_AddNumberToObject(cfg, "rate", opts.rate);
+    bad |= !cJSON_AddNumberToObject(cfg, "duration", opts.duration);
+    bad |= !cJSON_AddNumberToObject(cfg, "seed", opts.seed);
+    bad |= !cJSON_AddStringToObject(cfg, "distribution", keydist_name(opts.dist));
+    bad |= !cJSON_AddStringToObject(cfg, "latency", report_latency_mode());
+
+    if (bad) {
+        cJSON_Delete(cfg);
+        return NULL;
+    }
+
+    return cfg;
+}
+
+static cJSON *
+report_opstats(const struct bench_opstats *bs)
+{
+    struct hdr_histogram *h = bs->bs_hist;
+    cJSON *obj, *lat;
+    bool bad;
+
+    obj = cJSON_CreateObject();
+    if (!obj)
+        return NULL;
+
+    bad = !cJSON_AddNumberToObject(obj, "count", bs->bs_count);
+    bad |= !cJSON_AddNumberToObject(obj, "not_found", bs->bs_notfound);
+    bad |= !cJSON_AddNumberToObject(obj, "conflicts", bs->bs_conflicts);
+
+    lat = cJSON_AddObjectToObject(obj, "latency_ns");
+    bad |= !lat;
+
+    if (!bad) {
+        bad |= !cJSON_AddNumberToObject(lat, "min", hdr_min(h));
+        bad |= !cJSON_AddNumberToObject(lat, "mean", hdr_mean(h));
+        for (size_t i = 0; i < NELEM(report_pctv); i++)
+            bad |= !cJSON_AddNumberToObject(
+                lat, report_pctv[i].name, hdr_value_at_percentile(h, report_pctv[i].pct));
+        bad |= !cJSON_AddNumberToObject(lat, "max", hdr_max(h));
+    }
+
+    if (bad) {
+        cJSON_Delete(obj);
+        return NULL;
+    }
+
+    return obj;
+}
+
+static cJSON *
+report_result(const struct bench_result *res)
+{
+    double secs = res->br_elapsed / 1e9;
+    cJSON *obj, *ops;
+    bool bad;
+
+    obj = cJSON_CreateObject();
+    if (!obj)
+        return NULL;
+
+    bad = !cJSON_AddStringToObject(obj, "name", res->br_name);
+    bad |= !cJSON_AddStringToObject(obj, "distribution", keydist_name(res->br_dist));
+    bad |= !cJSON_AddNumberToObject(obj, "ops", res->br_ops);
+    bad |= !cJSON_AddNumberToObject(obj, "elapsed_ns", res->br_elapsed);
+    bad |= !cJSON_AddNumberToObject(obj, "ops_per_sec", secs > 0 ? res->br_ops / secs : 0);
+
+    ops = cJSON_AddObjectToObject(obj, "operations");
+    bad |= !ops;
+
+    for (int op = 0; op < BOP_MAX && !bad; op++) {
+        cJSON *item;
+
+        if (!res->br_opv[op].bs_hist)
+            continue;
+
+        item = report_opstats(res->br_opv + op);
+        bad |= !item || !cJSON_AddItemToObject(ops, bench_op2name[op], item);
+        if (!item)
+            break;
+    }
+
+    if (bad) {
+        cJSON_Delete(obj);
+        return NULL;
+    }
+
+    return obj;
+}
+
+static cJSON *
+report_create(const struct bench_result *resv, unsigned int resc)
+{
+    cJSON *root, *cfg, *wlv;
+    char tbuf[32];
+    struct tm tm;
+    time_t now;
+    bool bad;
+
+    root = cJSON_CreateObject();
+    if (!root)
+        return NULL;
+
+    now = time(NULL);
+    strftime(tbuf, sizeof(tbuf), "%FT%TZ", gmtime_r(&now, &tm));
+
+    bad = !cJSON_AddNumberToObject(root, "version", REPORT_VERSION);
+    bad |= !cJSON_AddStringToObject(root, "hse_version", HSE_VERSION_STRING);
+    bad |= !cJSON_AddStringToObject(root, "timestamp", tbuf);
+    bad |= !cJSON_AddNumberToObject(root, "cpus", sysconf(_SC_NPROCESSORS_ONLN));
+
+    cfg = report_config();
+    bad |= !cfg || !cJSON_AddItemToObject(root, "config", cfg);
+    if (!cfg)
+        goto out;
+
+    wlv = cJSON_AddArrayToObject(root, "workloads");
+    bad |= !wlv;
+
+    for (unsigned int i = 0; i < resc && !bad; i++) {
+        cJSON *wl = report_result(resv + i);
+
+        bad |= !wl || !cJSON_AddItemToArray(wlv, wl);
+        if (!wl)
+            break;
+    }
+
+out:
+    if (bad) {
+        cJSON_Delete(root);
+        return NULL;
+    }
+
+    return root;
+}
+
+int
+report_write(const char *path, const struct bench_result *resv, unsigned int resc)
+{
+    cJSON *root;
+    char *data;
+    FILE *fp;
+    int rc = 0;
+
+    root = report_create(resv, resc);
+    if (!root)
+        return ENOMEM;
+
+    data = cJSON_Print(root);
+    cJSON_Delete(root);
+    if (!data)
+        return ENOMEM;
+
+    fp = strcmp(path, "-") ? fopen(path, "w") : stdout;
+    if (!fp) {
+        rc = errno;
+        goto out;
+    }
+
+    if (fprintf(fp, "%s\n", data) < 0)
+        rc = EIO;
+
+    if (fp != stdout && fclose(fp) && !rc)
+        rc = errno;
+
+out:
+    cJSON_free(data);
+
+    return rc;
+}
+
+static char *
+report_slurp(const char *path)
+{
+    size_t len = 0, sz = 64 * 1024;
+    char *buf, *tmp;
+    FILE *fp;
+
+    fp = fopen(path, "r");
+    if (!fp)
+        return NULL;
+
+    buf = malloc(sz);
+
+    while (buf) {
+        len += fread(buf + len, 1, sz - len - 1, fp);
+        if (len < sz - 1)
+            break;
+
+        sz *= 2;
+        tmp = realloc(buf, sz);
+        if (!tmp)
+            free(buf);
+        buf = tmp;
+    }
+
+    if (buf)
+        buf[len] = '\0';
+
+    fclose(fp);
+
+    return buf;
+}
+
+static double
+report_number(const cJSON *obj, const char *name)
+{
+    const cJSON *item = cJSON_GetObjectItemCaseSensitive(obj, name);
+
+    return cJSON_IsNumber(item) ? item->valuedouble : 0;
+}
+
+static const cJSON *
+report_find(const cJSON *wlv, const char *name)
+{
+    const cJSON *wl;
+
+    cJSON_ArrayForEach(wl, wlv)
+    {
+        const cJSON *item = cJSON_GetObjectItemCaseSensitive(wl, "name");
+
+        if (cJSON_IsString(item) && !strcmp(item->valuestring, name))
+            return wl;
+    }
+
+    return NULL;
+}
+
+static double
+report_delta(double base, double cur)
+{
+    return base > 0 ? (cur - base) * 100.0 / base : 0;
+}
+
+int
+report_compare(FILE *fp, const char *path, const struct bench_result *resv, unsigned int resc)
+{
+    const cJSON *wlv;
+    cJSON *base, *cfg;
+    char *data;
+
+    data = report_slurp(path);
+    if (!data)
+        return errno ?: ENOMEM;
+
+    base = cJSON_Parse(data);
+    free(data);
+    if (!base)
+        return EINVAL;
+
+    if (report_number(base, "version") != REPORT_VERSION) {
+        cJSON_Delete(base);
+        return EPROTO;
+    }
+
+    cfg = report_config();
+    if (cfg && !cJSON_Compare(cJSON_GetObjectItemCaseSensitive(base, "config"), cfg, true))
+        fprintf(fp, "\nwarning: %s was produced with a different configuration\n", path);
+    cJSON_Delete(cfg);
+
+    fprintf(
+        fp, "\nComparison with %s (hse %s)\n  %-10s %-12s %14s %14s %8s\n", path,
+        cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(base, "hse_version")) ?: "?",
+        "workload", "metric", "baseline", "current", "delta%");
+
+    wlv = cJSON_GetObjectItemCaseSensitive(base, "workloads");
+
+    for (unsigned int i = 0; i < resc; i++) {
+        const struct bench_result *res = resv + i;
+        const cJSON *wl, *ops;
+        double secs, cur, prev;
+
+        wl = report_find(wlv, res->br_name);
+        if (!wl) {
+            fprintf(fp, "  %-10s not in baseline\n", res->br_name);
+            continue;
+        }
+
+        secs = res->br_elapsed / 1e9;
+        cur = secs > 0 ? res->br_ops / secs : 0;
+        prev = report_number(wl, "ops_per_sec");
+
+        fprintf(
+            fp, "  %-10s %-12s %14.0f %14.0f %+8.1f\n", res->br_name, "ops/s", prev, cur,
+            report_delta(prev, cur));
+
+        ops = cJSON_GetObjectItemCaseSensitive(wl, "operations");
+
+        for (int op = 0; op < BOP_MAX; op++) {
+            const cJSON *lat;
+            char metric[32];
+
+            if (!res->br_opv[op].bs_hist)
+                continue;
+
+            lat = cJSON_GetObjectItemCaseSensitive(
+                cJSON_GetObjectItemCaseSensitive(ops, bench_op2name[op]), "latency_ns");
+            if (!lat)
+                continue;
+
+            cur = hdr_value_at_percentile(res->br_opv[op].bs_hist, 99.0);
+            prev = report_number(lat, "p99");
+
+            snprintf(metric, sizeof(metric), "%s.p99", bench_op2name[op]);
+            fprintf(
+                fp, "  %-10s %-12s %14.0f %14.0f %+8.1f\n", "", metric, prev, cur,
+                report_delta(prev, cur));
+        }
+    }
+
+    cJSON_Delete(base);
+
+    return 0;
+}